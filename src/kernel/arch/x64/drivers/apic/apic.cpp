@@ -461,11 +461,14 @@ void init()
  */
 void apic_timer_handler(irq::InterruptFrame* frame)
 {
-    interrupt_deadline += interrupt_delta;
+    // interrupt_delta is one millisecond, the period is a tunable
+    const std::uint64_t period_ms = timer::tick_period_ms();
+
+    interrupt_deadline += interrupt_delta * period_ms;
     cpu::wrmsr(IA32_TSC_DEADLINE, interrupt_deadline);
 
     send_eoi();
-    timer::tick(frame);
+    timer::tick(frame, period_ms);
     scheduler::tick();
 }
 
@@ -520,7 +523,7 @@ void timer_init()
     constexpr std::uint64_t interrupt_duration_ns = interrupt_duration_ms * 1000000;
 
     interrupt_delta = (tsc::get_tsc_freq() * interrupt_duration_ns) / 1000000000;
-    interrupt_deadline = interrupt_delta;
+    interrupt_deadline = interrupt_delta * timer::tick_period_ms();
 
     // Step 5: Register our handler for timer interrupts.
     // From this point on, apic_timer_handler is called every calibration_ms (10ms)
@@ -4,6 +4,7 @@
 #include <containers/kvector.hpp>
 #include <exclusive/kspinlock_irqsave.hpp>
 #include <log/log.hpp>
+#include <process/wait_queue.hpp>
 
 namespace x64::drivers::keyboard {
 
@@ -16,6 +17,8 @@ static bool caps_lock = false;
 
 static kspinlock_irqsave g_keyboard_spinlock;
 
+static process::WaitQueue g_waiters;
+
 void update_modifiers(ScanCode scancode, ExtendedScanCode extended, bool released)
 {
     // Standard scancodes
@@ -49,6 +52,11 @@ void push_event(const KeyEvent& event)
     g_keyboard_spinlock.unlock();
 }
 
+process::WaitQueue& wait_queue()
+{
+    return g_waiters;
+}
+
 KeyEvent* poll()
 {
     g_keyboard_spinlock.lock();
@@ -3,6 +3,10 @@
 #include "ps2.hpp"
 #include <cstdint>
 
+namespace process {
+class WaitQueue;
+}
+
 namespace x64::drivers::keyboard {
 // =========================================================================
 // Key Event
@@ -43,6 +47,12 @@ KeyEvent* poll();
  */
 KeyEvent* read();
 
+/**
+ * @brief Tasks waiting for key events, woken by the backends after they
+ *        push new ones.
+ */
+process::WaitQueue& wait_queue();
+
 /**
  * @brief Pushes a key event to the buffer (called by backends).
  * @param event The key event to push.
@@ -1,13 +1,12 @@
 #include "ps2.hpp"
 #include "keyboard.hpp"
-#include "scheduler/scheduler.hpp"
 
 #include <arch/x64/cpu/cpu.hpp>
 #include <arch/x64/drivers/apic/apic.hpp>
 #include <arch/x64/interrupts/irq.hpp>
 #include <kpanic/kpanic.hpp>
 #include <log/log.hpp>
-#include <process/process.hpp>
+#include <process/wait_queue.hpp>
 
 namespace x64::drivers::keyboard {
 static bool extended_pending = false;
@@ -136,9 +135,8 @@ static void keyboard_interrupt_handler(irq::InterruptFrame*)
         handle_scancode(byte);
     }
 
-    // Tell the scheduler there is keyboard input ready for any process
-    // that is currently waiting for it
-    scheduler::get_scheduler()->wake_single(process::WaitReason::KEYBOARD);
+    // Wake the tty and anything polling it, they pick the events up
+    wait_queue().wake_all();
 
     apic::send_eoi();
 }
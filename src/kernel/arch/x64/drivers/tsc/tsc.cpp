@@ -55,6 +55,12 @@ std::uint64_t get_tsc_freq()
     return tsc_freq;
 }
 
+// The TSC value get_time_ns() counts from
+std::uint64_t get_boot_tsc()
+{
+    return boot_tsc;
+}
+
 static bool check_support()
 {
     std::uint32_t eax;
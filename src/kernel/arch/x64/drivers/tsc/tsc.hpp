@@ -13,5 +13,6 @@ std::uint64_t get_time_ns();
 std::uint64_t get_time_us();
 std::uint64_t get_time_ms();
 std::uint64_t get_tsc_freq();
+std::uint64_t get_boot_tsc();
 
 }
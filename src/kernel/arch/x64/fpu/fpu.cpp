@@ -0,0 +1,466 @@
+#include "fpu.hpp"
+
+#include <arch/x64/cpu/cpu.hpp>
+#include <arch/x64/percpu/percpu.hpp>
+#include <crt/crt.h>
+#include <fmt/fmt.hpp>
+#include <kassert/kassert.hpp>
+#include <kpanic/kpanic.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+
+#include <cpuid.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace x64::fpu {
+
+constexpr std::uint64_t CR0_TS = 1 << 3;
+constexpr std::uint64_t CR4_OSXSAVE = 1 << 18;
+
+constexpr std::uint32_t CPUID_1_ECX_XSAVE = 1 << 26;
+constexpr std::uint32_t CPUID_D_1_EAX_XSAVEOPT = 1 << 0;
+constexpr std::uint32_t CPUID_D_1_EAX_XSAVEC = 1 << 1;
+
+constexpr std::size_t FXSAVE_SIZE = 512;
+constexpr std::size_t STATE_ALIGN = 64;
+
+// Offsets into the legacy region shared by FXSAVE and XSAVE
+constexpr std::size_t FCW_OFFSET = 0;
+constexpr std::size_t MXCSR_OFFSET = 24;
+
+constexpr std::uint16_t FCW_DEFAULT = 0x037F;   // all x87 exceptions masked
+constexpr std::uint32_t MXCSR_DEFAULT = 0x1F80; // all SSE exceptions masked
+
+enum class SaveMethod : std::uint8_t {
+    FXSAVE,
+    XSAVE,
+    XSAVEOPT, // skips components that were not modified since the last XRSTOR
+    XSAVEC    // compacted format, skips components in their init state
+};
+
+static SaveMethod g_method = SaveMethod::FXSAVE;
+static std::uint64_t g_xcr0 = 0;
+static std::size_t g_state_size = FXSAVE_SIZE;
+
+static const char* method_name(SaveMethod method)
+{
+    switch (method) {
+    case SaveMethod::FXSAVE:
+        return "FXSAVE";
+    case SaveMethod::XSAVE:
+        return "XSAVE";
+    case SaveMethod::XSAVEOPT:
+        return "XSAVEOPT";
+    case SaveMethod::XSAVEC:
+        return "XSAVEC";
+    }
+
+    return "?";
+}
+
+[[gnu::always_inline]]
+static inline std::uint64_t read_cr0()
+{
+    std::uint64_t value;
+    asm volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+[[gnu::always_inline]]
+static inline void clts()
+{
+    asm volatile("clts" : : : "memory");
+}
+
+[[gnu::always_inline]]
+static inline void set_ts()
+{
+    const std::uint64_t cr0 = read_cr0();
+
+    // Writing CR0 serialises the CPU, so skip it when TS is already set
+    if (!(cr0 & CR0_TS)) {
+        asm volatile("mov %0, %%cr0" : : "r"(cr0 | CR0_TS) : "memory");
+    }
+}
+
+[[gnu::always_inline]]
+static inline void xsetbv(std::uint32_t index, std::uint64_t value)
+{
+    asm volatile("xsetbv"
+                 :
+                 : "c"(index), "a"(static_cast<std::uint32_t>(value)), "d"(static_cast<std::uint32_t>(value >> 32))
+                 : "memory");
+}
+
+/// @brief save the registers into state
+///
+/// @note CR0.TS must be clear
+///
+static void save(void* state)
+{
+    const auto lo = static_cast<std::uint32_t>(g_xcr0);
+    const auto hi = static_cast<std::uint32_t>(g_xcr0 >> 32);
+
+    switch (g_method) {
+    case SaveMethod::FXSAVE:
+        asm volatile("fxsave64 (%0)" : : "r"(state) : "memory");
+        break;
+    case SaveMethod::XSAVE:
+        asm volatile("xsave64 (%0)" : : "r"(state), "a"(lo), "d"(hi) : "memory");
+        break;
+    case SaveMethod::XSAVEOPT:
+        asm volatile("xsaveopt64 (%0)" : : "r"(state), "a"(lo), "d"(hi) : "memory");
+        break;
+    case SaveMethod::XSAVEC:
+        asm volatile("xsavec64 (%0)" : : "r"(state), "a"(lo), "d"(hi) : "memory");
+        break;
+    }
+}
+
+/// @brief load the registers from state
+///
+/// @note CR0.TS must be clear
+///
+static void restore(const void* state)
+{
+    const auto lo = static_cast<std::uint32_t>(g_xcr0);
+    const auto hi = static_cast<std::uint32_t>(g_xcr0 >> 32);
+
+    if (g_method == SaveMethod::FXSAVE) {
+        asm volatile("fxrstor64 (%0)" : : "r"(state) : "memory");
+    } else {
+        asm volatile("xrstor64 (%0)" : : "r"(state), "a"(lo), "d"(hi) : "memory");
+    }
+}
+
+/// @brief write the registers back to the state area of their owner
+///
+/// @note interrupts must be disabled
+///
+static void flush_owner(percpu::PerCPU* cpu)
+{
+    if (cpu->fpu_owner == nullptr) {
+        return;
+    }
+
+    const bool ts = read_cr0() & CR0_TS;
+
+    clts();
+    save(cpu->fpu_owner);
+
+    if (ts) {
+        set_ts();
+    }
+}
+
+void init()
+{
+    log::init_start("FPU");
+
+    std::uint32_t eax, ebx, ecx, edx;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+
+    if (ecx & CPUID_1_ECX_XSAVE) {
+        cpu::write_cr4(cpu::read_cr4() | CR4_OSXSAVE);
+
+        __cpuid_count(0xD, 0, eax, ebx, ecx, edx);
+
+        const std::uint64_t supported = eax | (static_cast<std::uint64_t>(edx) << 32);
+
+        g_xcr0 = supported & (XCR0_X87 | XCR0_SSE | XCR0_AVX | XCR0_AVX512);
+
+        // The three AVX-512 components can only be enabled together, on top of AVX
+        if ((g_xcr0 & XCR0_AVX512) != XCR0_AVX512 || !(g_xcr0 & XCR0_AVX)) {
+            g_xcr0 &= ~XCR0_AVX512;
+        }
+
+        xsetbv(0, g_xcr0);
+
+        // EBX now reports the size needed for the components enabled in XCR0
+        __cpuid_count(0xD, 0, eax, ebx, ecx, edx);
+        g_state_size = ebx;
+
+        __cpuid_count(0xD, 1, eax, ebx, ecx, edx);
+
+        if (eax & CPUID_D_1_EAX_XSAVEOPT) {
+            g_method = SaveMethod::XSAVEOPT;
+        } else if (eax & CPUID_D_1_EAX_XSAVEC) {
+            g_method = SaveMethod::XSAVEC;
+        } else {
+            g_method = SaveMethod::XSAVE;
+        }
+    }
+
+    // Nobody owns the registers yet, the first user of the FPU takes a #NM
+    set_ts();
+
+    log::info("FPU: ", method_name(g_method), ", XCR0 = ", fmt::hex{g_xcr0}, ", state size = ", g_state_size, " bytes");
+
+    log::init_end("FPU");
+}
+
+std::size_t state_size()
+{
+    return g_state_size;
+}
+
+void* alloc_state()
+{
+    // kmalloc only guarantees 8 byte alignment, so over-allocate and keep
+    // the raw pointer just below the aligned area for free_state()
+    auto* raw = static_cast<std::uint8_t*>(kmalloc(g_state_size + STATE_ALIGN));
+    kassert_not_null(raw);
+
+    const auto aligned = (reinterpret_cast<std::uintptr_t>(raw) + STATE_ALIGN) & ~(STATE_ALIGN - 1);
+    auto* state = reinterpret_cast<void*>(aligned);
+
+    reinterpret_cast<void**>(state)[-1] = raw;
+    reset_state(state);
+
+    return state;
+}
+
+void free_state(void* state)
+{
+    if (state == nullptr) {
+        return;
+    }
+
+    auto* cpu = percpu::get();
+
+    if (cpu->fpu_owner == state) {
+        cpu->fpu_owner = nullptr;
+    }
+
+    kfree(reinterpret_cast<void**>(state)[-1]);
+}
+
+void reset_state(void* state)
+{
+    kassert_not_null(state);
+
+    auto* cpu = percpu::get();
+
+    // The registers no longer match the area, make the next use reload it
+    if (cpu->fpu_owner == state) {
+        cpu->fpu_owner = nullptr;
+
+        if (cpu->fpu_state == state) {
+            set_ts();
+        }
+    }
+
+    // An all zero XSAVE header (XSTATE_BV = 0) makes XRSTOR put every
+    // component in its init state, only MXCSR is always read from memory
+    auto* bytes = static_cast<std::uint8_t*>(state);
+
+    memset(bytes, 0, g_state_size);
+    *reinterpret_cast<std::uint16_t*>(bytes + FCW_OFFSET) = FCW_DEFAULT;
+    *reinterpret_cast<std::uint32_t*>(bytes + MXCSR_OFFSET) = MXCSR_DEFAULT;
+}
+
+void copy_state(void* dst, const void* src)
+{
+    kassert_not_null(dst);
+    kassert_not_null(src);
+
+    auto* cpu = percpu::get();
+
+    if (cpu->fpu_owner == src) {
+        const std::uint64_t rflags = cpu::read_rflags();
+        cpu::cli();
+
+        flush_owner(cpu);
+
+        cpu::write_rflags(rflags);
+    }
+
+    memcpy(dst, src, g_state_size);
+}
+
+void switch_to(void* state)
+{
+    auto* cpu = percpu::get();
+
+    kassert(!cpu->kernel_fpu_active);
+
+    cpu->fpu_state = state;
+
+    if (state != nullptr && state == cpu->fpu_owner) {
+        clts();
+    } else {
+        set_ts();
+    }
+}
+
+void handle_device_not_available()
+{
+    auto* cpu = percpu::get();
+
+    // Kernel threads have no state area, and the kernel must not touch
+    // vector registers outside of kernel_fpu_begin()/kernel_fpu_end()
+    if (cpu->fpu_state == nullptr || cpu->kernel_fpu_active) {
+        kpanic("#NM: FPU used without a state area (kernel code outside kernel_fpu_begin?)");
+    }
+
+    clts();
+
+    if (cpu->fpu_owner != cpu->fpu_state) {
+        if (cpu->fpu_owner != nullptr) {
+            save(cpu->fpu_owner);
+        }
+
+        restore(cpu->fpu_state);
+        cpu->fpu_owner = cpu->fpu_state;
+    }
+}
+
+void kernel_fpu_begin()
+{
+    auto* cpu = percpu::get();
+
+    kassert(!cpu->kernel_fpu_active);
+
+    // The registers are about to hold kernel values, so this task must not
+    // be switched out (and have them saved as its own) until kernel_fpu_end()
+    cpu->kernel_fpu_preempt = cpu->preemption_enabled;
+    percpu::disable_preemption();
+
+    const std::uint64_t rflags = cpu::read_rflags();
+    cpu::cli();
+
+    flush_owner(cpu);
+    cpu->fpu_owner = nullptr;
+    clts();
+    cpu->kernel_fpu_active = true;
+
+    cpu::write_rflags(rflags);
+}
+
+void kernel_fpu_end()
+{
+    auto* cpu = percpu::get();
+
+    kassert(cpu->kernel_fpu_active);
+
+    // Nobody owns the registers now, the current task reloads on next use
+    set_ts();
+    cpu->kernel_fpu_active = false;
+
+    if (cpu->kernel_fpu_preempt) {
+        percpu::enable_preemption();
+    }
+}
+
+/// @brief byte copy until dst is aligned to align bytes
+///
+static void align_dst(std::uint8_t*& d, const std::uint8_t*& s, std::size_t& size, std::size_t align)
+{
+    while ((reinterpret_cast<std::uintptr_t>(d) & (align - 1)) != 0 && size > 0) {
+        *d++ = *s++;
+        size--;
+    }
+}
+
+/// @brief copy the remaining tail, after making the streaming stores visible
+///
+static void finish_nontemporal(std::uint8_t* d, const std::uint8_t* s, std::size_t size)
+{
+    // Non-temporal stores are weakly ordered, make them visible before returning
+    asm volatile("sfence" : : : "memory");
+
+    while (size > 0) {
+        *d++ = *s++;
+        size--;
+    }
+}
+
+static void copy_nontemporal_sse(void* dst, const void* src, std::size_t size)
+{
+    auto* d = static_cast<std::uint8_t*>(dst);
+    const auto* s = static_cast<const std::uint8_t*>(src);
+
+    // MOVNTDQ needs a 16 byte aligned destination
+    align_dst(d, s, size, 16);
+
+    // No xmm clobbers are listed: with -mgeneral-regs-only the compiler can
+    // not name them, and never keeps anything in vector registers anyway
+    while (size >= 64) {
+        asm volatile("movdqu 0(%0), %%xmm0\n"
+                     "movdqu 16(%0), %%xmm1\n"
+                     "movdqu 32(%0), %%xmm2\n"
+                     "movdqu 48(%0), %%xmm3\n"
+                     "movntdq %%xmm0, 0(%1)\n"
+                     "movntdq %%xmm1, 16(%1)\n"
+                     "movntdq %%xmm2, 32(%1)\n"
+                     "movntdq %%xmm3, 48(%1)\n"
+                     :
+                     : "r"(s), "r"(d)
+                     : "memory");
+
+        d += 64;
+        s += 64;
+        size -= 64;
+    }
+
+    finish_nontemporal(d, s, size);
+}
+
+static void copy_nontemporal_avx(void* dst, const void* src, std::size_t size)
+{
+    auto* d = static_cast<std::uint8_t*>(dst);
+    const auto* s = static_cast<const std::uint8_t*>(src);
+
+    // VMOVNTDQ with ymm needs a 32 byte aligned destination
+    align_dst(d, s, size, 32);
+
+    // Two cache lines per iteration. VZEROUPPER avoids the SSE/AVX transition
+    // penalty for whoever uses the registers next
+    while (size >= 128) {
+        asm volatile("vmovdqu 0(%0), %%ymm0\n"
+                     "vmovdqu 32(%0), %%ymm1\n"
+                     "vmovdqu 64(%0), %%ymm2\n"
+                     "vmovdqu 96(%0), %%ymm3\n"
+                     "vmovntdq %%ymm0, 0(%1)\n"
+                     "vmovntdq %%ymm1, 32(%1)\n"
+                     "vmovntdq %%ymm2, 64(%1)\n"
+                     "vmovntdq %%ymm3, 96(%1)\n"
+                     :
+                     : "r"(s), "r"(d)
+                     : "memory");
+
+        d += 128;
+        s += 128;
+        size -= 128;
+    }
+
+    asm volatile("vzeroupper" : : : "memory");
+
+    finish_nontemporal(d, s, size);
+}
+
+bool has_avx()
+{
+    return g_xcr0 & XCR0_AVX;
+}
+
+void copy_nontemporal_with(bool avx, void* dst, const void* src, std::size_t size)
+{
+    kassert(percpu::get()->kernel_fpu_active);
+    kassert(!avx || has_avx());
+
+    if (avx) {
+        copy_nontemporal_avx(dst, src, size);
+    } else {
+        copy_nontemporal_sse(dst, src, size);
+    }
+}
+
+void copy_nontemporal(void* dst, const void* src, std::size_t size)
+{
+    copy_nontemporal_with(has_avx(), dst, src, size);
+}
+
+}
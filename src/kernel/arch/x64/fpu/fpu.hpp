@@ -0,0 +1,66 @@
+/**
+ * @file fpu.hpp
+ * @brief Lazy x87/SSE/AVX register state management.
+ *
+ * Every user task owns an extended state area (x87, SSE, AVX and AVX-512
+ * when present) sized from CPUID leaf 0xD. The registers are NOT saved on
+ * every context switch. Instead CR0.TS is set when switching to a task whose
+ * state is not the one loaded in the registers, and the first FPU/SIMD
+ * instruction that task executes raises #NM. The #NM handler saves the
+ * previous owner's registers and loads the task's own. Tasks that never
+ * touch vector registers between switches never pay for a save/restore.
+ *
+ * A fresh state area has an all zero XSAVE header, so its first XRSTOR
+ * takes the processor's init-optimised path instead of copying ~1KB.
+ *
+ * The kernel itself is built with -mgeneral-regs-only. Kernel code that
+ * wants SIMD must bracket it with kernel_fpu_begin()/kernel_fpu_end(),
+ * which stash the user registers and keep the task on this CPU.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace x64::fpu {
+constexpr std::uint64_t XCR0_X87 = 1 << 0;
+constexpr std::uint64_t XCR0_SSE = 1 << 1;
+constexpr std::uint64_t XCR0_AVX = 1 << 2;
+constexpr std::uint64_t XCR0_AVX512 = (1 << 5) | (1 << 6) | (1 << 7); // opmask, ZMM_Hi256, Hi16_ZMM
+
+void init();
+
+// Size in bytes of one task's state area
+std::size_t state_size();
+
+// State areas are 64 byte aligned and start out in the init state
+void* alloc_state();
+void free_state(void* state);
+
+// Put state back into the init state, e.g. on execve()
+void reset_state(void* state);
+
+// Copy src into dst, saving the live registers first if src is loaded
+void copy_state(void* dst, const void* src);
+
+// Called on every context switch with the incoming task's state (null for kthreads)
+void switch_to(void* state);
+
+// #NM handler, loads the current task's state into the registers
+void handle_device_not_available();
+
+void kernel_fpu_begin();
+void kernel_fpu_end();
+
+// True when XCR0 enables the AVX (ymm) state
+bool has_avx();
+
+// Copy using non-temporal SSE stores, which bypass the cache. Ideal for
+// write-only targets like the framebuffer. Uses 32 byte AVX stores when the
+// CPU has them. Must be called between kernel_fpu_begin() and kernel_fpu_end().
+void copy_nontemporal(void* dst, const void* src, std::size_t size);
+
+// Same, forcing the SSE (avx = false) or AVX variant, for benchmarking
+void copy_nontemporal_with(bool avx, void* dst, const void* src, std::size_t size);
+}
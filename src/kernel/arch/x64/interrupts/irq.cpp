@@ -79,8 +79,13 @@
 #include "irq.hpp"
 
 #include <arch/x64/cpu/cpu.hpp>
+#include <arch/x64/memory/uaccess.hpp>
+#include <arch/x64/percpu/percpu.hpp>
 #include <cstdint>
 #include <log/log.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <syscall/sys_proc.hpp>
 
 namespace x64::irq {
 // Handler function pointers for each interrupt vector.
@@ -226,9 +231,25 @@ extern "C" void interrupt_handler(x64::irq::InterruptFrame* frame)
 {
     const auto vector = frame->vector;
 
-    if (vector <= x64::irq::EXC_MAX) {
+    if (vector == x64::irq::EXC_DEVICE_NOT_AVAIL) {
+        // Not an error, a task touched the FPU after a lazy switch, see fpu.hpp
+        x64::fpu::handle_device_not_available();
+    } else if (vector == x64::irq::EXC_PAGE_FAULT && (frame->cs & 3) == 0 && x64::uaccess::fixup_exception(frame)) {
+        // A user access (get_user(), copy_from_user(), ...) hit an unmapped
+        // page, it resumes at its fixup and returns -EFAULT
+    } else if (vector <= x64::irq::EXC_MAX) {
         x64::irq::handle_exception(frame);
     } else {
         x64::irq::handle_irq(frame);
+
+        // An IRQ handler may have woken a more important process (e.g. a
+        // real-time one waiting on the keyboard), run it right away
+        scheduler::preempt_if_needed();
+    }
+
+    // A thread interrupted in user mode whose group was killed meanwhile,
+    // e.g. one spinning without ever making a syscall
+    if ((frame->cs & 3) != 0 && x64::percpu::current_process()->kill_pending) {
+        syscall::exit_killed();
     }
 }
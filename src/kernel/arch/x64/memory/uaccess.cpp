@@ -0,0 +1,93 @@
+#include "uaccess.hpp"
+
+#include <arch/x64/interrupts/irq.hpp>
+#include <arch/x64/memory/vmm.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+// Bounds of the __ex_table section, provided by the linker
+extern "C" const x64::uaccess::ExTableEntry __start___ex_table[];
+extern "C" const x64::uaccess::ExTableEntry __stop___ex_table[];
+
+namespace x64::uaccess {
+
+static std::uintptr_t entry_insn(const ExTableEntry* entry)
+{
+    return reinterpret_cast<std::uintptr_t>(&entry->insn) + entry->insn;
+}
+
+static std::uintptr_t entry_fixup(const ExTableEntry* entry)
+{
+    return reinterpret_cast<std::uintptr_t>(&entry->fixup) + entry->fixup;
+}
+
+/// @brief resume a faulting user access at its fixup code
+///
+/// The table has one entry per get_user()/put_user() call site plus the
+/// routines in uaccess.s, and is only searched when the kernel faults, so
+/// a linear scan is fine.
+///
+bool fixup_exception(irq::InterruptFrame* frame)
+{
+    for (const ExTableEntry* entry = __start___ex_table; entry < __stop___ex_table; entry++) {
+        if (entry_insn(entry) == frame->rip) {
+            frame->rip = entry_fixup(entry);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int copy_to_user(void* __user dst, const void* src, std::size_t size)
+{
+    if (!vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(dst), size)) {
+        return -EFAULT;
+    }
+
+    return uaccess_copy(dst, src, size) == 0 ? 0 : -EFAULT;
+}
+
+int copy_from_user(void* dst, const void* __user src, std::size_t size)
+{
+    if (!vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(src), size)) {
+        return -EFAULT;
+    }
+
+    return uaccess_copy(dst, src, size) == 0 ? 0 : -EFAULT;
+}
+
+long strncpy_from_user(char* dst, const char* __user src, std::size_t size)
+{
+    const auto addr = reinterpret_cast<std::uintptr_t>(src);
+
+    if (size == 0 || !vmm::is_user_addr(addr, 1)) {
+        return -EFAULT;
+    }
+
+    // Never read past the end of user space, a string that runs into it
+    // faults just like one that runs into an unmapped page
+    std::size_t limit = size - 1;
+    bool clamped = false;
+
+    if (!vmm::is_user_addr(addr, limit)) {
+        limit = vmm::USER_MAX_ADDR - addr;
+        clamped = true;
+    }
+
+    const long length = uaccess_strncpy(dst, src, limit);
+
+    if (length < 0) {
+        return length;
+    }
+
+    if (static_cast<std::size_t>(length) == limit) {
+        return clamped ? -EFAULT : -ENAMETOOLONG;
+    }
+
+    return length;
+}
+
+}
@@ -0,0 +1,174 @@
+/**
+ * @file uaccess.hpp
+ * @brief Fault tolerant access to user memory.
+ *
+ * Every access to a user pointer goes through one of these. They check the
+ * pointer against the user address limit, open SMAP only around the access
+ * itself, and return -EFAULT instead of panicking when the memory turns out
+ * not to be mapped: the accessing instructions are listed in the exception
+ * table (__ex_table) and the #PF handler resumes at their fixup code, see
+ * fixup_exception().
+ *
+ * get_user()/put_user() are inlined single moves for the fixed-size values
+ * syscalls pass by pointer (ints, futex words, pointers). Bulk copies and
+ * strings use the out-of-line routines in uaccess.s.
+ */
+
+#pragma once
+
+#include <arch/x64/memory/vmm.hpp>
+
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifndef __user
+#define __user
+#endif
+
+namespace x64::irq {
+struct InterruptFrame;
+}
+
+extern "C" std::size_t uaccess_copy(void* dst, const void* src, std::size_t size);
+extern "C" long uaccess_strncpy(char* dst, const char* src, std::size_t size);
+
+namespace x64::uaccess {
+
+// One entry of the exception table, both fields are relative to their own address
+struct ExTableEntry {
+    std::int32_t insn;
+    std::int32_t fixup;
+};
+
+// Called by the #PF handler for kernel mode faults. If the faulting
+// instruction is a user access, point the frame at its fixup and return true
+bool fixup_exception(irq::InterruptFrame* frame);
+
+// Copy size bytes, returns 0 or -EFAULT
+int copy_to_user(void* __user dst, const void* src, std::size_t size);
+int copy_from_user(void* dst, const void* __user src, std::size_t size);
+
+// Copy a NUL terminated string of at most size - 1 characters into dst,
+// always terminating it. Returns the length, -ENAMETOOLONG if src does not
+// fit, or -EFAULT
+long strncpy_from_user(char* dst, const char* __user src, std::size_t size);
+
+// Copy count elements of an array in one go, e.g. an iovec array, after
+// checking that count * sizeof(T) does not overflow
+template <typename T>
+int copy_array_from_user(T* dst, const T* __user src, std::size_t count)
+{
+    if (count > SIZE_MAX / sizeof(T)) {
+        return -EFAULT;
+    }
+
+    return copy_from_user(dst, src, count * sizeof(T));
+}
+
+namespace detail {
+
+template <std::size_t N>
+struct uint_of_size;
+
+template <>
+struct uint_of_size<1> {
+    using type = std::uint8_t;
+};
+
+template <>
+struct uint_of_size<2> {
+    using type = std::uint16_t;
+};
+
+template <>
+struct uint_of_size<4> {
+    using type = std::uint32_t;
+};
+
+template <>
+struct uint_of_size<8> {
+    using type = std::uint64_t;
+};
+
+template <typename T>
+concept UserValue = std::is_trivially_copyable_v<T>
+    && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+}
+
+/// @brief read one value from user memory
+///
+/// @return 0, or -EFAULT with value zeroed
+///
+template <detail::UserValue T>
+inline int get_user(T& value, const T* __user ptr)
+{
+    using U = typename detail::uint_of_size<sizeof(T)>::type;
+
+    if (!vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(ptr), sizeof(T))) {
+        return -EFAULT;
+    }
+
+    int err = 0;
+    U raw = 0;
+
+    asm volatile("stac\n"
+                 "1: mov %[src], %[raw]\n"
+                 "2: clac\n"
+                 ".pushsection .text.fixup, \"ax\"\n"
+                 "3: mov %[efault], %[err]\n"
+                 "   jmp 2b\n"
+                 ".popsection\n"
+                 ".pushsection __ex_table, \"a\"\n"
+                 ".balign 4\n"
+                 ".long 1b - .\n"
+                 ".long 3b - .\n"
+                 ".popsection\n"
+                 : [err] "+r"(err), [raw] "+r"(raw)
+                 : [src] "m"(*reinterpret_cast<const U*>(ptr)), [efault] "i"(-EFAULT)
+                 : "memory");
+
+    // raw is still 0 if the load faulted
+    value = std::bit_cast<T>(raw);
+
+    return err;
+}
+
+/// @brief write one value to user memory
+///
+/// @return 0 or -EFAULT
+///
+template <detail::UserValue T>
+inline int put_user(const T& value, T* __user ptr)
+{
+    using U = typename detail::uint_of_size<sizeof(T)>::type;
+
+    if (!vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(ptr), sizeof(T))) {
+        return -EFAULT;
+    }
+
+    int err = 0;
+
+    asm volatile("stac\n"
+                 "1: mov %[raw], %[dst]\n"
+                 "2: clac\n"
+                 ".pushsection .text.fixup, \"ax\"\n"
+                 "3: mov %[efault], %[err]\n"
+                 "   jmp 2b\n"
+                 ".popsection\n"
+                 ".pushsection __ex_table, \"a\"\n"
+                 ".balign 4\n"
+                 ".long 1b - .\n"
+                 ".long 3b - .\n"
+                 ".popsection\n"
+                 : [err] "+r"(err), [dst] "=m"(*reinterpret_cast<U*>(ptr))
+                 : [raw] "r"(std::bit_cast<U>(value)), [efault] "i"(-EFAULT)
+                 : "memory");
+
+    return err;
+}
+
+}
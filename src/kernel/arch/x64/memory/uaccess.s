@@ -0,0 +1,90 @@
+# =============================================================================
+# uaccess.s — Fault tolerant copies to and from user memory
+# =============================================================================
+#
+# The kernel checks that a user pointer lies below the user address limit,
+# but it can't cheaply check that every page of it is mapped. Instead the
+# instructions that touch user memory are listed in the exception table
+# (__ex_table) together with a fixup address. When one of them page faults,
+# the #PF handler finds the faulting RIP in the table and resumes at the
+# fixup instead of panicking (see uaccess.cpp), which returns an error.
+#
+# Each __ex_table entry is two 32-bit offsets relative to the entry itself:
+#
+#   .long <faulting instruction> - .
+#   .long <fixup>                - .
+#
+# SMAP is opened with stac only around the accessing instructions, and
+# closed again on both the normal and the fixup path, so callers never have
+# to save and restore RFLAGS.AC.
+#
+# =============================================================================
+
+.code64
+
+.macro EX_TABLE insn, fixup
+    .pushsection __ex_table, "a"
+    .balign 4
+    .long \insn - .
+    .long \fixup - .
+    .popsection
+.endm
+
+.set EFAULT, 14
+
+.section .text
+
+# =============================================================================
+# uaccess_copy - memcpy() where either side may be user memory
+# =============================================================================
+# Input:  RDI = destination, RSI = source, RDX = byte count
+# Output: RAX = number of bytes NOT copied (0 on success)
+#
+# rep movsb leaves RCX at the number of bytes still to go when it faults,
+# which is exactly the return value.
+
+.global uaccess_copy
+uaccess_copy:
+    mov %rdx, %rcx
+    stac
+1:  rep movsb
+    clac
+    xor %eax, %eax
+    ret
+
+2:  clac
+    mov %rcx, %rax
+    ret
+
+    EX_TABLE 1b, 2b
+
+# =============================================================================
+# uaccess_strncpy - copy a NUL terminated user string, at most RDX bytes
+# =============================================================================
+# Input:  RDI = kernel destination, RSI = user source, RDX = maximum bytes
+# Output: RAX = length of the string without the NUL when one was found,
+#         RDX when there was no NUL in the first RDX bytes (the destination
+#         is then not terminated), or -EFAULT
+
+.global uaccess_strncpy
+uaccess_strncpy:
+    xor %eax, %eax
+    stac
+
+1:  cmp %rdx, %rax
+    je 3f
+2:  movb (%rsi,%rax), %cl
+    movb %cl, (%rdi,%rax)
+    test %cl, %cl
+    jz 3f
+    inc %rax
+    jmp 1b
+
+3:  clac
+    ret
+
+4:  clac
+    mov $-EFAULT, %rax
+    ret
+
+    EX_TABLE 2b, 4b
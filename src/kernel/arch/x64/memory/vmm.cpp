@@ -51,6 +51,9 @@ static Heap kheap{};
 
 static kspinlock_irqsave g_vmm_lock{};
 
+// PTE software bits (avl)
+constexpr std::uint64_t PTE_AVL_SHARED = 0x1; // frame mapped with PAGE_SHARED
+
 template <typename T>
 static T hhdm_ptov(std::uintptr_t phys) { return reinterpret_cast<T>(phys + hhdm_offset); }
 
@@ -230,6 +233,7 @@ static void populate_pte(PTE& pte, std::uint64_t phys_frame, int flags)
     pte.d = 0;
     pte.pat = 0;
     pte.g = (flags & PAGE_GLOBAL) ? 1 : 0;
+    pte.avl = (flags & PAGE_SHARED) ? PTE_AVL_SHARED : 0;
     pte.addr = phys_frame >> 12;
     pte.nx = (flags & PAGE_NX) ? 1 : 0;
 }
@@ -252,9 +256,17 @@ static void free_pde(PDE& pde)
     pde.p = 0;
 }
 
+static bool is_shared_pte(const PTE& pte)
+{
+    return (pte.avl & PTE_AVL_SHARED) != 0;
+}
+
 static void free_pte(PTE& pte)
 {
-    pmm::free_frame(pte.addr << 12);
+    if (!is_shared_pte(pte)) {
+        pmm::free_frame(pte.addr << 12);
+    }
+
     pte.p = 0;
 }
 
@@ -408,6 +420,21 @@ void map_user_pages(PML4E* pml4, std::uintptr_t virt, std::size_t bytes)
     map_pages(pml4, virt, bytes, PAGE_USER | PAGE_WRITE);
 }
 
+/**
+ * @brief Maps an already allocated physical frame at a specific virtual address.
+ *
+ * @param pml4 Page table to modify.
+ * @param virt Virtual address to map (must be page-aligned).
+ * @param phys Physical frame to map (must be page-aligned).
+ * @param flags Page flags, PAGE_SHARED if the caller keeps ownership of the frame.
+ */
+void map_frame(PML4E* pml4, std::uintptr_t virt, std::uintptr_t phys, int flags)
+{
+    g_vmm_lock.lock();
+    map_page_to_frame(pml4, virt, phys, flags);
+    g_vmm_lock.unlock();
+}
+
 /**
  * @brief Unmaps a virtual address and frees its physical frame.
  *  
@@ -422,11 +449,14 @@ static void unmap_page(PML4E* pml4, std::uintptr_t virt_page)
     PTE* pte = find_pte(pml4, virt_page);
 
     if (pte == nullptr) {
-        log::warn("Attempt to unmap virt addr that is not mapped: ", fmt::hex{virt_page});
+        log::warn<log::Subsystem::MEMORY>("Attempt to unmap virt addr that is not mapped: ", fmt::hex{virt_page});
         return;
     }
 
-    pmm::free_frame(get_pte_phys_frame(*pte));
+    if (!is_shared_pte(*pte)) {
+        pmm::free_frame(get_pte_phys_frame(*pte));
+    }
+
     *pte = {};
     asm volatile("invlpg (%0)" : : "r"(virt_page) : "memory");
 }
@@ -497,6 +527,23 @@ void* map_heap_pages(PML4E* pml4, Heap* heap, std::size_t bytes, int flags)
     return first_page + 1;
 }
 
+std::uintptr_t reserve_heap_pages(Heap* heap, std::size_t num_pages)
+{
+    kassert_not_null(heap);
+
+    g_vmm_lock.lock();
+
+    const std::uintptr_t first_page = get_next_heap_virt_page(heap);
+
+    for (std::size_t page = 0; page < num_pages; page++) {
+        advance_heap(heap);
+    }
+
+    g_vmm_lock.unlock();
+
+    return first_page;
+}
+
 /**
  * @brief Allocates contiguous kernel memory with embedded size tracking.
  *
@@ -665,7 +712,12 @@ void free_user_pml4(PML4E* pml4)
                         continue;
                     }
 
-                    log::debugf("freeing PTE at pml4={} pdpt={} pd={} pt={}", pml4_idx, pdpt_idx, pd_idx, pt_idx);
+                    log::debugf<log::Subsystem::MEMORY>(
+                        "freeing PTE at pml4={} pdpt={} pd={} pt={}",
+                        pml4_idx,
+                        pdpt_idx,
+                        pd_idx,
+                        pt_idx);
 
                     free_pte(pt[pt_idx]);
                 }
@@ -730,7 +782,17 @@ PML4E* clone_user_pml4(PML4E* pml4)
                         continue;
                     }
 
-                    log::debugf("found mapped user page at pml4={}, pdpt={}, pd={}, pt={}", pml4_idx, pdpt_idx, pd_idx, pt_idx);
+                    log::debugf<log::Subsystem::MEMORY>(
+                        "found mapped user page at pml4={}, pdpt={}, pd={}, pt={}",
+                        pml4_idx,
+                        pdpt_idx,
+                        pd_idx,
+                        pt_idx);
+
+                    if (is_shared_pte(pt[pt_idx])) {
+                        new_pt[pt_idx] = pt[pt_idx];
+                        continue;
+                    }
 
                     std::uintptr_t phys_frame = pmm::alloc_frame();
 
@@ -787,6 +849,20 @@ Heap clone_user_heap(Heap* existing, PML4E* pml4)
     return heap;
 }
 
+std::uintptr_t virt_to_phys(PML4E* pml4, std::uintptr_t virt)
+{
+    kassert_not_null(pml4);
+
+    g_vmm_lock.lock();
+
+    const PTE* pte = find_pte(pml4, virt);
+    const std::uintptr_t phys = pte != nullptr ? get_pte_phys_frame(*pte) + (virt & 0xFFF) : 0;
+
+    g_vmm_lock.unlock();
+
+    return phys;
+}
+
 void switch_pml4(PML4E* pml4)
 {
     kassert_not_null(pml4);
@@ -799,21 +875,19 @@ PML4E* get_kernel_pml4() { return kernel_pml4; }
 
 void switch_kernel_pml4() { switch_pml4(kernel_pml4); }
 
-constexpr std::uintptr_t user_max_addr = 0x0000800000000000ULL;
-
 bool is_user_addr(void* addr)
 {
-    return reinterpret_cast<std::uintptr_t>(addr) < user_max_addr;
+    return reinterpret_cast<std::uintptr_t>(addr) < USER_MAX_ADDR;
 }
 
 bool is_user_addr(const void* addr)
 {
-    return reinterpret_cast<std::uintptr_t>(addr) < user_max_addr;
+    return reinterpret_cast<std::uintptr_t>(addr) < USER_MAX_ADDR;
 }
 
 bool is_user_addr(std::uintptr_t addr, std::size_t size)
 {
-    return addr < user_max_addr && size <= user_max_addr - addr;
+    return addr < USER_MAX_ADDR && size <= USER_MAX_ADDR - addr;
 }
 
 static void init_cr4()
@@ -855,9 +929,9 @@ void init(std::uintptr_t offset)
     init_kheap();
     init_cr4();
 
-    log::infof("VMM: Kernel HHDM @ {}", fmt::hex{hhdm_offset});
-    log::infof("VMM: Kernel PML4 @ {}", fmt::hex{kernel_pml4});
-    log::infof("VMM: cr4 = {} ({})", fmt::hex{cpu::read_cr4()}, fmt::bin{cpu::read_cr4()});
+    log::infof<log::Subsystem::MEMORY>("VMM: Kernel HHDM @ {}", fmt::hex{hhdm_offset});
+    log::infof<log::Subsystem::MEMORY>("VMM: Kernel PML4 @ {}", fmt::hex{kernel_pml4});
+    log::infof<log::Subsystem::MEMORY>("VMM: cr4 = {} ({})", fmt::hex{cpu::read_cr4()}, fmt::bin{cpu::read_cr4()});
 }
 
 } // namespace x64::vmm
@@ -21,6 +21,11 @@ constexpr std::uint32_t PAGE_CACHE_DISABLE = 0x08;
 constexpr std::uint32_t PAGE_GLOBAL = 0x10;
 constexpr std::uint32_t PAGE_NX = 0x20;
 
+// The frame is not owned by the address space it is mapped into (e.g. the
+// vDSO): unmapping or tearing down the address space leaves it alone, and
+// cloning maps the same frame instead of copying it.
+constexpr std::uint32_t PAGE_SHARED = 0x40;
+
 // PML4 entry — points to a PDPT. Bit 7 is reserved and must be 0.
 struct PML4E {
     std::uint64_t p    : 1;  // present
@@ -114,7 +119,11 @@ void init(std::uintptr_t hhdm_offset);
 // User memory access — SMAP-safe primitives
 // ============================================================================
 
+// First address above the lower canonical half, where user space ends
+constexpr std::uintptr_t USER_MAX_ADDR = 0x0000800000000000ULL;
+
 // Returns true if the entire range [addr, addr+size) lies within user space.
+// The pages may still be unmapped, see uaccess.hpp for access that can't panic
 bool is_user_addr(void* addr);
 bool is_user_addr(const void* addr);
 bool is_user_addr(std::uintptr_t addr, std::size_t size);
@@ -151,13 +160,24 @@ Heap clone_user_heap(Heap* existing, PML4E* pml4);
 // Map bytes into the next available slot in a heap, allocating physical frames.
 void* map_heap_pages(PML4E* pml4, Heap* heap, std::size_t bytes, int flags);
 
+// Take the next num_pages pages of a heap's range without mapping anything
+// there, for the caller to map_frame() into. Returns the first page.
+std::uintptr_t reserve_heap_pages(Heap* heap, std::size_t num_pages);
+
 // Low-level: map bytes at a specific virtual address with explicit flags.
 void map_pages(PML4E* pml4, std::uintptr_t virt, std::size_t bytes, int flags);
 void map_user_pages(PML4E* pml4, std::uintptr_t virt, std::size_t bytes);
 
+// Map an existing frame at a specific virtual address. Pass PAGE_SHARED if the
+// frame must outlive the address space.
+void map_frame(PML4E* pml4, std::uintptr_t virt, std::uintptr_t phys, int flags);
+
 // Unmap num_pages pages starting at virt, freeing their physical frames.
 void unmap_mem_at(PML4E* pml4, std::uintptr_t virt, std::size_t num_pages);
 
+// Translate a virtual address through pml4, returns 0 if it is not mapped.
+std::uintptr_t virt_to_phys(PML4E* pml4, std::uintptr_t virt);
+
 // Switch the active address space.
 void switch_pml4(PML4E* pml4);
 void switch_kernel_pml4();
@@ -91,6 +91,12 @@ void early_init()
     per.process = nullptr;
     per.idle_process = nullptr;
     per.preemption_enabled = false;
+    per.need_resched = false;
+    per.fpu_owner = nullptr;
+    per.fpu_state = nullptr;
+    per.kernel_fpu_active = false;
+    per.kernel_fpu_preempt = false;
+    per.log_ring = nullptr;
 
     cpu::wrmsr(MSR_GS_BASE, reinterpret_cast<std::uintptr_t>(&per));
     cpu::wrmsr(MSR_KERNEL_GS_BASE, 0);
@@ -125,6 +131,12 @@ void init()
     per_cpu_data->idle_process = new process::KThread(idle_process_kthread);
     per_cpu_data->process = per_cpu_data->idle_process;
     per_cpu_data->preemption_enabled = true;
+    per_cpu_data->need_resched = false;
+    per_cpu_data->fpu_owner = nullptr;
+    per_cpu_data->fpu_state = nullptr;
+    per_cpu_data->kernel_fpu_active = false;
+    per_cpu_data->kernel_fpu_preempt = false;
+    per_cpu_data->log_ring = nullptr;
 
     log::info("GS_BASE = ", fmt::hex{reinterpret_cast<std::uintptr_t>(per_cpu_data)});
 
@@ -29,6 +29,12 @@ struct [[gnu::packed]] PerCPU {
     process::Process* process; // Current process running on this CPU
     process::Process* idle_process;
     bool preemption_enabled;
+    bool need_resched; // A more important process became READY, preempt soon
+    void* fpu_owner;         // State area whose values are in the FPU registers
+    void* fpu_state;         // State area of the running process, see fpu.hpp
+    bool kernel_fpu_active;  // Inside kernel_fpu_begin()/kernel_fpu_end()
+    bool kernel_fpu_preempt; // Preemption state to restore in kernel_fpu_end()
+    void* log_ring;          // This CPU's log record ring, see log.cpp
 };
 
 void early_init();
@@ -71,7 +71,7 @@
  *                                ▼
  *                          syscall_dispatcher (this file)
  *                                │
- *                                │ Switch on RAX (syscall number)
+ *                                │ Look up RAX (syscall number) in TABLE
  *                                │ Call sys_read/sys_write/etc.
  *                                │ Return result in RAX
  *                                │
@@ -105,176 +105,302 @@
 #include <linux/syscall.hpp>
 #include <log/log.hpp>
 #include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
 #include <syscall/sys_fd.hpp>
 #include <syscall/sys_mem.hpp>
 #include <syscall/sys_prctl.hpp>
 #include <syscall/sys_proc.hpp>
+#include <syscall/sys_futex.hpp>
+#include <syscall/sys_io_uring.hpp>
+#include <syscall/sys_poll.hpp>
+#include <syscall/sys_sched.hpp>
 #include <syscall/sys_sleep.hpp>
 #include <syscall/sys_thread.hpp>
+#include <syscall/sys_time.hpp>
+#include <syscall/syscall_stats.hpp>
 
 #include <cerrno>
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 
 extern "C" void syscall_entry();
 
+// Never defined and not constexpr, so reaching it while building the
+// dispatch table is a compile error
+void duplicate_or_out_of_range_syscall_number();
+
+namespace {
+
+using Handler = std::uint64_t (*)(x64::trap::SyscallFrame* frame);
+
+template <std::size_t I, typename... Ts>
+struct nth_type;
+
+template <std::size_t I, typename T, typename... Ts>
+struct nth_type<I, T, Ts...> {
+    using type = typename nth_type<I - 1, Ts...>::type;
+};
+
+template <typename T, typename... Ts>
+struct nth_type<0, T, Ts...> {
+    using type = T;
+};
+
+// clone() and fork() need the saved user registers, they take the frame as
+// their first parameter instead of a register argument
+template <typename... Args>
+constexpr bool takes_frame = false;
+
+template <typename... Rest>
+constexpr bool takes_frame<x64::trap::SyscallFrame*, Rest...> = true;
+
+template <typename T>
+T from_register(std::uint64_t value)
+{
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(value);
+    } else {
+        return static_cast<T>(value);
+    }
+}
+
+/**
+ * @brief Adapts a typed sys_* function to the common Handler signature.
+ *
+ * The parameter list of the implementation decides how many argument
+ * registers are used and what each one is converted to, so a table entry
+ * can never pass the wrong number or kind of arguments.
+ */
+template <auto Fn>
+struct SyscallAdapter;
+
+template <typename R, typename... Args, R (*Fn)(Args...)>
+struct SyscallAdapter<Fn> {
+    static constexpr std::size_t offset = takes_frame<Args...> ? 1 : 0;
+    static constexpr std::size_t num_args = sizeof...(Args) - offset;
+
+    static_assert(num_args <= 6, "syscalls take at most 6 register arguments");
+
+    static std::uint64_t invoke(x64::trap::SyscallFrame* frame)
+    {
+        const std::uint64_t regs[6] = {frame->rdi, frame->rsi, frame->rdx, frame->r10, frame->r8, frame->r9};
+
+        (void)regs;
+
+        return [&]<std::size_t... I>(std::index_sequence<I...>) -> std::uint64_t {
+            if constexpr (takes_frame<Args...>) {
+                return static_cast<std::uint64_t>(Fn(frame, from_register<typename nth_type<I + offset, Args...>::type>(regs[I])...));
+            } else {
+                return static_cast<std::uint64_t>(Fn(from_register<typename nth_type<I, Args...>::type>(regs[I])...));
+            }
+        }(std::make_index_sequence<num_args>{});
+    }
+};
+
+struct SyscallDef {
+    std::uint64_t nr;
+    const char* name;
+    Handler handler;
+    std::uint8_t num_args;
+};
+
+template <auto Fn>
+constexpr SyscallDef def(std::uint64_t nr, const char* name)
+{
+    return {nr, name, &SyscallAdapter<Fn>::invoke, SyscallAdapter<Fn>::num_args};
+}
+
+// Every implemented syscall. To add one, implement sys_<name> in
+// lib/syscall/ and list it here, the dispatch table is generated from this
+constexpr SyscallDef SYSCALLS[] = {
+    def<syscall::sys_read>(linux::SYS_READ, "read"),
+    def<syscall::sys_write>(linux::SYS_WRITE, "write"),
+    def<syscall::sys_open>(linux::SYS_OPEN, "open"),
+    def<syscall::sys_close>(linux::SYS_CLOSE, "close"),
+    def<syscall::sys_stat>(linux::SYS_STAT, "stat"),
+    def<syscall::sys_fstat>(linux::SYS_FSTAT, "fstat"),
+    def<syscall::sys_poll>(linux::SYS_POLL, "poll"),
+    def<syscall::sys_lseek>(linux::SYS_LSEEK, "lseek"),
+    def<syscall::sys_mmap>(linux::SYS_MMAP, "mmap"),
+    def<syscall::sys_mprotect>(linux::SYS_MPROTECT, "mprotect"),
+    def<syscall::sys_munmap>(linux::SYS_MUNMAP, "munmap"),
+    def<syscall::sys_brk>(linux::SYS_BRK, "brk"),
+    def<syscall::sys_ioctl>(linux::SYS_IOCTL, "ioctl"),
+    def<syscall::sys_readv>(linux::SYS_READV, "readv"),
+    def<syscall::sys_writev>(linux::SYS_WRITEV, "writev"),
+    def<syscall::sys_pipe>(linux::SYS_PIPE, "pipe"),
+    def<syscall::sys_select>(linux::SYS_SELECT, "select"),
+    def<syscall::sys_dup>(linux::SYS_DUP, "dup"),
+    def<syscall::sys_dup2>(linux::SYS_DUP2, "dup2"),
+    def<syscall::sys_sleep_ms>(linux::SYS_NANOSLEEP, "nanosleep"),
+    def<syscall::sys_getpid>(linux::SYS_GETPID, "getpid"),
+    def<syscall::sys_sendfile>(linux::SYS_SENDFILE, "sendfile"),
+    def<syscall::sys_clone>(linux::SYS_CLONE, "clone"),
+    def<syscall::sys_fork>(linux::SYS_FORK, "fork"),
+    def<syscall::sys_vfork>(linux::SYS_VFORK, "vfork"),
+    def<syscall::sys_execve>(linux::SYS_EXECVE, "execve"),
+    def<syscall::sys_exit>(linux::SYS_EXIT, "exit"),
+    def<syscall::sys_wait4>(linux::SYS_WAIT4, "wait4"),
+    def<syscall::sys_fcntl>(linux::SYS_FNCTL, "fcntl"),
+    def<syscall::sys_fsync>(linux::SYS_FSYNC, "fsync"),
+    def<syscall::sys_truncate>(linux::SYS_TRUNCATE, "truncate"),
+    def<syscall::sys_ftruncate>(linux::SYS_FTRUNCATE, "ftruncate"),
+    def<syscall::sys_getcwd>(linux::SYS_GETCWD, "getcwd"),
+    def<syscall::sys_chdir>(linux::SYS_CHDIR, "chdir"),
+    def<syscall::sys_fchdir>(linux::SYS_FCHDIR, "fchdir"),
+    def<syscall::sys_rename>(linux::SYS_RENAME, "rename"),
+    def<syscall::sys_mkdir>(linux::SYS_MKDIR, "mkdir"),
+    def<syscall::sys_rmdir>(linux::SYS_RMDIR, "rmdir"),
+    def<syscall::sys_unlink>(linux::SYS_UNLINK, "unlink"),
+    def<syscall::sys_gettimeofday>(linux::SYS_GETTIMEOFDAY, "gettimeofday"),
+    def<syscall::sys_getpriority>(linux::SYS_GETPRIORITY, "getpriority"),
+    def<syscall::sys_setpriority>(linux::SYS_SETPRIORITY, "setpriority"),
+    def<syscall::sys_sched_setparam>(linux::SYS_SCHED_SETPARAM, "sched_setparam"),
+    def<syscall::sys_sched_getparam>(linux::SYS_SCHED_GETPARAM, "sched_getparam"),
+    def<syscall::sys_sched_setscheduler>(linux::SYS_SCHED_SETSCHEDULER, "sched_setscheduler"),
+    def<syscall::sys_sched_getscheduler>(linux::SYS_SCHED_GETSCHEDULER, "sched_getscheduler"),
+    def<syscall::sys_sched_get_priority_max>(linux::SYS_SCHED_GET_PRIORITY_MAX, "sched_get_priority_max"),
+    def<syscall::sys_sched_get_priority_min>(linux::SYS_SCHED_GET_PRIORITY_MIN, "sched_get_priority_min"),
+    def<syscall::sys_arch_prctl>(linux::SYS_ARCH_PRCTL, "arch_prctl"),
+    def<syscall::sys_sync>(linux::SYS_SYNC, "sync"),
+    def<syscall::sys_mount>(linux::SYS_MOUNT, "mount"),
+    def<syscall::sys_gettid>(linux::SYS_GETTID, "gettid"),
+    def<syscall::sys_time>(linux::SYS_TIME, "time"),
+    def<syscall::sys_futex>(linux::SYS_FUTEX, "futex"),
+    def<syscall::sys_epoll_create>(linux::SYS_EPOLL_CREATE, "epoll_create"),
+    def<syscall::sys_getdents64>(linux::SYS_GETDENTS64, "getdents64"),
+    def<syscall::sys_set_tid_address>(linux::SYS_SET_TID_ADDR, "set_tid_address"),
+    def<syscall::sys_clock_settime>(linux::SYS_CLOCK_SETTIME, "clock_settime"),
+    def<syscall::sys_clock_gettime>(linux::SYS_CLOCK_GETTIME, "clock_gettime"),
+    def<syscall::sys_exit_group>(linux::SYS_EXIT_GROUP, "exit_group"),
+    def<syscall::sys_epoll_wait>(linux::SYS_EPOLL_WAIT, "epoll_wait"),
+    def<syscall::sys_epoll_ctl>(linux::SYS_EPOLL_CTL, "epoll_ctl"),
+    def<syscall::sys_ppoll>(linux::SYS_PPOLL, "ppoll"),
+    def<syscall::sys_splice>(linux::SYS_SPLICE, "splice"),
+    def<syscall::sys_epoll_pwait>(linux::SYS_EPOLL_PWAIT, "epoll_pwait"),
+    def<syscall::sys_epoll_create1>(linux::SYS_EPOLL_CREATE1, "epoll_create1"),
+    def<syscall::sys_dup3>(linux::SYS_DUP3, "dup3"),
+    def<syscall::sys_pipe2>(linux::SYS_PIPE2, "pipe2"),
+    def<syscall::sys_copy_file_range>(linux::SYS_COPY_FILE_RANGE, "copy_file_range"),
+    def<syscall::sys_io_uring_setup>(linux::SYS_IO_URING_SETUP, "io_uring_setup"),
+    def<syscall::sys_io_uring_enter>(linux::SYS_IO_URING_ENTER, "io_uring_enter"),
+};
+
+constexpr std::size_t NUM_DEFINED = sizeof(SYSCALLS) / sizeof(SYSCALLS[0]);
+
+struct SyscallEntry {
+    Handler handler;   // nullptr if not implemented
+    std::uint16_t slot; // Index into SYSCALLS and g_counters
+};
+
+struct SyscallTable {
+    SyscallEntry entries[x64::trap::NUM_SYSCALLS];
+};
+
+// Indexed by syscall number, so dispatch is one bounds check and a load
+constexpr SyscallTable TABLE = [] {
+    SyscallTable table{};
+
+    for (std::size_t slot = 0; slot < NUM_DEFINED; slot++) {
+        const SyscallDef& def = SYSCALLS[slot];
+
+        if (def.nr >= x64::trap::NUM_SYSCALLS || table.entries[def.nr].handler != nullptr) {
+            duplicate_or_out_of_range_syscall_number();
+        }
+
+        table.entries[def.nr] = {def.handler, static_cast<std::uint16_t>(slot)};
+    }
+
+    return table;
+}();
+
+syscall::stats::Counters g_counters[NUM_DEFINED];
+
+}
+
 static const char* syscall_name(std::uint64_t syscall_num)
 {
-    switch (syscall_num) {
-    case linux::SYS_READ:
-        return "read";
-    case linux::SYS_WRITE:
-        return "write";
-    case linux::SYS_OPEN:
-        return "open";
-    case linux::SYS_CLOSE:
-        return "close";
-    case linux::SYS_STAT:
-        return "stat";
-    case linux::SYS_FSTAT:
-        return "fstat";
-    case linux::SYS_LSEEK:
-        return "lseek";
-    case linux::SYS_NANOSLEEP:
-        return "nanosleep";
-    case linux::SYS_GETPID:
-        return "getpid";
-    case linux::SYS_MMAP:
-        return "mmap";
-    case linux::SYS_MUNMAP:
-        return "munmap";
-    case linux::SYS_IOCTL:
-        return "ioctl";
-    case linux::SYS_READV:
-        return "readv";
-    case linux::SYS_WRITEV:
-        return "writev";
-    case linux::SYS_BRK:
-        return "brk";
-    case linux::SYS_EXIT:
-        return "exit";
-    case linux::SYS_EXIT_GROUP:
-        return "exit_group";
-    case linux::SYS_GETCWD:
-        return "getcwd";
-    case linux::SYS_CHDIR:
-        return "chdir";
-    case linux::SYS_MKDIR:
-        return "mkdir";
-    case linux::SYS_ARCH_PRCTL:
-        return "arch_prctl";
-    case linux::SYS_SET_TID_ADDR:
-        return "set_tid_addr";
-    case linux::SYS_FCHDIR:
-        return "fchdir";
-    case linux::SYS_FNCTL:
-        return "fnctl";
-    case linux::SYS_GETDENTS64:
-        return "getdents64";
-    case linux::SYS_FORK:
-        return "fork";
-    case linux::SYS_VFORK:
-        return "vfork";
-    case linux::SYS_WAIT4:
-        return "wait4";
-    case linux::SYS_EXECVE:
-        return "execve";
-    default:
+    if (syscall_num >= x64::trap::NUM_SYSCALLS || TABLE.entries[syscall_num].handler == nullptr) {
         return "unknown syscall";
     }
+
+    return SYSCALLS[TABLE.entries[syscall_num].slot].name;
 }
 
 /**
  * @brief Routes syscalls to their implementations based on syscall number.
  * @param frame Pointer to saved registers on kernel stack (built by syscall_entry.s).
+ * @return Syscall result.
+ */
+static std::uint64_t dispatch(x64::trap::SyscallFrame* frame)
+{
+    const std::uint64_t syscall_num = frame->rax;
+    const std::uint64_t args[6] = {frame->rdi, frame->rsi, frame->rdx, frame->r10, frame->r8, frame->r9};
+
+    if (syscall_num >= x64::trap::NUM_SYSCALLS || TABLE.entries[syscall_num].handler == nullptr) {
+        log::error<log::Subsystem::SYSCALL>("Unsupported syscall: ", syscall_num);
+        return -ENOSYS;
+    }
+
+    const SyscallEntry& entry = TABLE.entries[syscall_num];
+
+    log::debugf<log::Subsystem::SYSCALL>("**** syscall entry ****");
+    log::debugf<log::Subsystem::SYSCALL>("* syscall  = {} ({})", syscall_name(syscall_num), syscall_num);
+
+    for (std::size_t i = 0; i < SYSCALLS[entry.slot].num_args; i++) {
+        log::debugf<log::Subsystem::SYSCALL>("* arg{} = {}", i + 1, fmt::hex{args[i]});
+    }
+
+    syscall::stats::Counters& counters = g_counters[entry.slot];
+
+    const std::uint64_t start = syscall::stats::begin(counters);
+    const std::uint64_t result = entry.handler(frame);
+
+    syscall::stats::end(counters, start, result);
+
+    return result;
+}
+
+/**
+ * @brief Entry point from syscall_entry.s.
+ * @param frame Pointer to saved registers on kernel stack (built by syscall_entry.s).
  * @return Syscall result (placed in RAX by syscall_entry.s before sysretq).
  *
  * Called from syscall_entry.s after registers are saved. The syscall number is
  * in frame->rax, arguments in frame->rdi, rsi, rdx (matching System V ABI).
+ * If the syscall woke a more important process (e.g. a real-time one), it
+ * runs before we return to userspace. A task whose thread group was killed
+ * meanwhile exits here instead of returning.
  */
 extern "C" std::uint64_t syscall_dispatcher(x64::trap::SyscallFrame* frame)
 {
-    const std::uint64_t syscall_num = frame->rax;
-    const std::uint64_t arg1 = frame->rdi;
-    const std::uint64_t arg2 = frame->rsi;
-    const std::uint64_t arg3 = frame->rdx;
-    const std::uint64_t arg4 = frame->r10;
-    const std::uint64_t arg5 = frame->r8;
-    const std::uint64_t arg6 = frame->r9;
-
-    log::debugf("**** syscall entry ****");
-    log::debugf("* syscall  = {} ({})", syscall_name(syscall_num), syscall_num);
-    log::debugf("* arg1 = {}", fmt::hex{arg1});
-    log::debugf("* arg2 = {}", fmt::hex{arg2});
-    log::debugf("* arg3 = {}", fmt::hex{arg3});
-    log::debugf("* arg4 = {}", fmt::hex{arg4});
-    log::debugf("* arg5 = {}", fmt::hex{arg5});
-    log::debugf("* arg6 = {}", fmt::hex{arg6});
-
-    switch (syscall_num) {
-    case linux::SYS_READ:
-        return syscall::sys_read(arg1, reinterpret_cast<char*>(arg2), arg3);
-    case linux::SYS_WRITE:
-        return syscall::sys_write(arg1, reinterpret_cast<const char*>(arg2), arg3);
-    case linux::SYS_OPEN:
-        return syscall::sys_open(reinterpret_cast<const char*>(arg1), arg2);
-    case linux::SYS_CLOSE:
-        return syscall::sys_close(arg1);
-    case linux::SYS_STAT:
-        return syscall::sys_stat(reinterpret_cast<const char*>(arg1), reinterpret_cast<fs::Stat*>(arg2));
-    case linux::SYS_FSTAT:
-        return syscall::sys_fstat(arg1, reinterpret_cast<fs::Stat*>(arg2));
-    case linux::SYS_LSEEK:
-        return syscall::sys_lseek(arg1, arg2, arg3);
-    case linux::SYS_NANOSLEEP:
-        return syscall::sys_sleep_ms(arg1);
-    case linux::SYS_GETPID:
-        return syscall::sys_getpid();
-    case linux::SYS_MMAP:
-        return syscall::sys_mmap(reinterpret_cast<void*>(arg1), arg2, arg3, arg4, arg5, arg6);
-    case linux::SYS_MUNMAP:
-        return syscall::sys_munmap(reinterpret_cast<void*>(arg1), arg2);
-    case linux::SYS_IOCTL:
-        return syscall::sys_ioctl(arg1, arg2, reinterpret_cast<void*>(arg3));
-    case linux::SYS_READV:
-        return syscall::sys_readv(arg1, reinterpret_cast<const linux::iovec*>(arg2), arg3);
-    case linux::SYS_WRITEV:
-        return syscall::sys_writev(arg1, reinterpret_cast<const linux::iovec*>(arg2), arg3);
-    case linux::SYS_BRK:
-        return syscall::sys_brk(reinterpret_cast<void*>(arg1));
-    case linux::SYS_EXIT:
-    case linux::SYS_EXIT_GROUP:
-        return syscall::sys_exit(arg1);
-    case linux::SYS_GETCWD:
-        return syscall::sys_getcwd(reinterpret_cast<char*>(arg1), arg2);
-    case linux::SYS_CHDIR:
-        return syscall::sys_chdir(reinterpret_cast<const char*>(arg1));
-    case linux::SYS_MKDIR:
-        return syscall::sys_mkdir(reinterpret_cast<const char*>(arg1), arg2);
-    case linux::SYS_ARCH_PRCTL:
-        return syscall::sys_arch_prctl(arg1, arg2);
-    case linux::SYS_SET_TID_ADDR:
-        return syscall::sys_set_tid_address(reinterpret_cast<int*>(arg1));
-    case linux::SYS_FCHDIR:
-        return syscall::sys_fchdir(arg1);
-    case linux::SYS_FNCTL:
-        return syscall::sys_fcntl(arg1, arg2, arg3);
-    case linux::SYS_GETDENTS64:
-        return syscall::sys_getdents64(arg1, reinterpret_cast<void*>(arg2), arg3);
-    case linux::SYS_FORK:
-        return syscall::sys_fork(frame);
-    case linux::SYS_VFORK:
-        return syscall::sys_vfork();
-    case linux::SYS_WAIT4:
-        return syscall::sys_wait4(arg1, reinterpret_cast<int*>(arg2), arg3, reinterpret_cast<void*>(arg4));
-    case linux::SYS_EXECVE:
-        return syscall::sys_execve(reinterpret_cast<const char*>(arg1), reinterpret_cast<char**>(arg2), nullptr);
-    default:
-        log::error("Unsupported syscall: ", syscall_num);
-        return -ENOSYS;
+    const std::uint64_t result = dispatch(frame);
+
+    scheduler::preempt_if_needed();
+
+    if (x64::percpu::current_process()->kill_pending) {
+        syscall::exit_killed();
     }
+
+    return result;
 }
 
 namespace x64::trap {
+
+std::size_t num_syscalls()
+{
+    return NUM_DEFINED;
+}
+
+SyscallInfo syscall_info(std::size_t index)
+{
+    const SyscallDef& def = SYSCALLS[index];
+
+    return {def.nr, def.name, def.num_args, &g_counters[index]};
+}
+
 /**
  * @brief Configures the CPU for SYSCALL/SYSRET operation.
  *
@@ -299,9 +425,9 @@ void init()
     cpu::wrmsr(MSR_SFMASK, sfmask);
     cpu::wrmsr(MSR_EFER, efer);
 
-    log::infof("syscall: STAR   = {}", fmt::hex{star});
-    log::infof("syscall: LSTAR  = {}", fmt::hex{lstar});
-    log::infof("syscall: SFMASK = {}", fmt::hex{sfmask});
-    log::infof("syscall: EFER   = {}", fmt::hex{efer});
+    log::infof<log::Subsystem::SYSCALL>("syscall: STAR   = {}", fmt::hex{star});
+    log::infof<log::Subsystem::SYSCALL>("syscall: LSTAR  = {}", fmt::hex{lstar});
+    log::infof<log::Subsystem::SYSCALL>("syscall: SFMASK = {}", fmt::hex{sfmask});
+    log::infof<log::Subsystem::SYSCALL>("syscall: EFER   = {}", fmt::hex{efer});
 }
 }
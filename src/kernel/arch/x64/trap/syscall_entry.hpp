@@ -1,5 +1,8 @@
 #pragma once
 
+#include <syscall/syscall_stats.hpp>
+
+#include <cstddef>
 #include <cstdint>
 
 namespace x64::trap {
@@ -20,6 +23,20 @@ struct [[gnu::packed]] SyscallFrame {
     std::uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax, rsp;
 };
 
+// Size of the dispatch table, above the highest syscall number implemented
+constexpr std::size_t NUM_SYSCALLS = 512;
+
+struct SyscallInfo {
+    std::uint64_t nr;
+    const char* name;
+    std::uint8_t num_args;
+    syscall::stats::Counters* counters;
+};
+
 void init();
 
+// The implemented syscalls in table order, e.g. for /proc/syscalls
+std::size_t num_syscalls();
+SyscallInfo syscall_info(std::size_t index);
+
 }
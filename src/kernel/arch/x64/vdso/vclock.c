@@ -0,0 +1,120 @@
+/**
+ * @file vclock.c
+ * @brief The vDSO: clock functions that run entirely in userspace.
+ *
+ * Built as a tiny shared library (linux-vdso.so.1) that the kernel maps into
+ * every process and advertises with AT_SYSINFO_EHDR. libc looks the
+ * __vdso_* symbols up at startup and calls them instead of entering the
+ * kernel, so a clock read is an rdtsc and a multiply.
+ *
+ * This is user code: it has no libc, no relocations, and must not write
+ * anything, the only memory it touches is the read-only data page the
+ * kernel maps directly in front of the image (see vdso.lds).
+ */
+
+#include "vdso_data.h"
+
+#define SYS_gettimeofday 96
+#define SYS_time 201
+#define SYS_clock_gettime 228
+
+struct vdso_timespec {
+    long tv_sec;
+    long tv_nsec;
+};
+
+struct vdso_timeval {
+    long tv_sec;
+    long tv_usec;
+};
+
+struct vdso_timezone {
+    int tz_minuteswest;
+    int tz_dsttime;
+};
+
+extern const struct vdso_data vdso_data __attribute__((visibility("hidden")));
+
+static long vdso_syscall2(long num, long arg1, long arg2)
+{
+    long ret;
+
+    __asm__ volatile("syscall"
+                     : "=a"(ret)
+                     : "a"(num), "D"(arg1), "S"(arg2)
+                     : "rcx", "r11", "memory");
+
+    return ret;
+}
+
+int __vdso_clock_gettime(int clock, struct vdso_timespec* ts)
+{
+    uint64_t ns;
+
+    // Clocks the data page can't answer (e.g. CPU time) go to the kernel
+    if (vdso_clock_read(&vdso_data, clock, &ns) != 0) {
+        return (int)vdso_syscall2(SYS_clock_gettime, clock, (long)ts);
+    }
+
+    ts->tv_sec = (long)(ns / VDSO_NSEC_PER_SEC);
+    ts->tv_nsec = (long)(ns % VDSO_NSEC_PER_SEC);
+
+    return 0;
+}
+
+int __vdso_gettimeofday(struct vdso_timeval* tv, struct vdso_timezone* tz)
+{
+    uint64_t ns;
+
+    vdso_clock_read(&vdso_data, VDSO_CLOCK_REALTIME, &ns);
+
+    if (tv != 0) {
+        tv->tv_sec = (long)(ns / VDSO_NSEC_PER_SEC);
+        tv->tv_usec = (long)(ns % VDSO_NSEC_PER_SEC / 1000);
+    }
+
+    // Always UTC
+    if (tz != 0) {
+        tz->tz_minuteswest = 0;
+        tz->tz_dsttime = 0;
+    }
+
+    return 0;
+}
+
+long __vdso_time(long* t)
+{
+    uint64_t ns;
+
+    vdso_clock_read(&vdso_data, VDSO_CLOCK_REALTIME, &ns);
+
+    const long secs = (long)(ns / VDSO_NSEC_PER_SEC);
+
+    if (t != 0) {
+        *t = secs;
+    }
+
+    return secs;
+}
+
+int __vdso_getcpu(unsigned* cpu, unsigned* node, void* unused)
+{
+    (void)unused;
+
+    uint32_t aux = 0;
+
+    // The kernel stores (node << 12) | cpu in IA32_TSC_AUX, which rdtscp returns in ecx
+    if (vdso_data.has_rdtscp) {
+        __asm__ volatile("rdtscp" : "=c"(aux) : : "eax", "edx");
+    }
+
+    if (cpu != 0) {
+        *cpu = aux & 0xFFF;
+    }
+
+    if (node != 0) {
+        *node = aux >> 12;
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "vdso.hpp"
+#include "vdso_data.h"
+
+#include <arch/x64/cpu/cpu.hpp>
+#include <arch/x64/drivers/tsc/tsc.hpp>
+#include <boot/boot.hpp>
+#include <crt/crt.h>
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <kassert/kassert.hpp>
+#include <log/log.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" const std::uint8_t vdso_image_start[];
+extern "C" const std::uint8_t vdso_image_end[];
+
+namespace x64::vdso {
+
+constexpr std::uint32_t CPUID_FEAT_EDX_RDTSCP = (1 << 27);
+constexpr std::uint32_t MSR_TSC_AUX = 0xC0000103;
+
+// The image is ~3KB, this leaves plenty of room to grow
+constexpr std::size_t MAX_IMAGE_PAGES = 4;
+
+// ns = (cycles * mult) >> TSC_SHIFT, 2^32 keeps the rounding error of mult
+// well below 1ns per second for any realistic TSC frequency
+constexpr std::uint32_t TSC_SHIFT = 32;
+
+static vdso_data* g_data = nullptr;
+static std::uintptr_t g_data_frame = 0;
+
+static std::uintptr_t g_image_frames[MAX_IMAGE_PAGES];
+static std::size_t g_image_pages = 0;
+
+// Serializes writers, readers only ever look at seq
+static kspinlock_irqsave g_write_lock{};
+
+static void write_begin()
+{
+    g_write_lock.lock();
+    __atomic_store_n(&g_data->seq, g_data->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end()
+{
+    __atomic_store_n(&g_data->seq, g_data->seq + 1, __ATOMIC_RELEASE);
+    g_write_lock.unlock();
+}
+
+static bool has_rdtscp()
+{
+    std::uint32_t eax;
+    std::uint32_t edx;
+
+    cpu::cpuid(0x80000001, &eax, &edx);
+
+    return (edx & CPUID_FEAT_EDX_RDTSCP) != 0;
+}
+
+static void init_image()
+{
+    const std::size_t size = static_cast<std::size_t>(vdso_image_end - vdso_image_start);
+
+    kassert(size > 0);
+    kassert(memcmp(vdso_image_start, "\x7F" "ELF", 4) == 0);
+
+    g_image_pages = (size + vmm::PAGE_SIZE - 1) / vmm::PAGE_SIZE;
+
+    kassert(g_image_pages <= MAX_IMAGE_PAGES);
+
+    for (std::size_t i = 0; i < g_image_pages; i++) {
+        const std::size_t offset = i * vmm::PAGE_SIZE;
+        const std::size_t chunk = size - offset < vmm::PAGE_SIZE ? size - offset : vmm::PAGE_SIZE;
+
+        auto* page = static_cast<std::uint8_t*>(vmm::alloc_kernel_page());
+
+        memset(page, 0, vmm::PAGE_SIZE);
+        memcpy(page, vdso_image_start + offset, chunk);
+
+        g_image_frames[i] = vmm::virt_to_phys(vmm::get_kernel_pml4(), reinterpret_cast<std::uintptr_t>(page));
+    }
+}
+
+static void init_data()
+{
+    g_data = static_cast<vdso_data*>(vmm::alloc_kernel_page());
+    g_data_frame = vmm::virt_to_phys(vmm::get_kernel_pml4(), reinterpret_cast<std::uintptr_t>(g_data));
+
+    memset(g_data, 0, vmm::PAGE_SIZE);
+
+    const std::uint64_t tsc_freq = drivers::tsc::get_tsc_freq();
+
+    kassert(tsc_freq > 0);
+
+    // Counting from the same TSC value as tsc::get_time_ns() keeps
+    // CLOCK_MONOTONIC equal to the kernel's own uptime
+    write_begin();
+    g_data->shift = TSC_SHIFT;
+    g_data->mult = (VDSO_NSEC_PER_SEC << TSC_SHIFT) / tsc_freq;
+    g_data->tsc_base = drivers::tsc::get_boot_tsc();
+    g_data->mono_base_ns = 0;
+    g_data->realtime_offset_ns = boot::get_boot_time() * static_cast<std::int64_t>(VDSO_NSEC_PER_SEC);
+    g_data->has_rdtscp = has_rdtscp() ? 1 : 0;
+    write_end();
+
+    // getcpu() reads (node << 12) | cpu back with rdtscp, everything runs on cpu 0 node 0
+    if (g_data->has_rdtscp) {
+        cpu::wrmsr(MSR_TSC_AUX, 0);
+    }
+}
+
+void init()
+{
+    log::init_start("vDSO");
+
+    init_image();
+    init_data();
+
+    log::infof("vDSO: {} byte image, mult = {}, shift = {}, rdtscp = {}",
+        static_cast<std::size_t>(vdso_image_end - vdso_image_start),
+        g_data->mult,
+        g_data->shift,
+        g_data->has_rdtscp != 0);
+
+    log::init_end("vDSO");
+}
+
+void map_into(vmm::PML4E* pml4)
+{
+    kassert_not_null(g_data);
+
+    vmm::map_frame(pml4, VDSO_BASE, g_data_frame, vmm::PAGE_USER | vmm::PAGE_SHARED);
+
+    for (std::size_t i = 0; i < g_image_pages; i++) {
+        vmm::map_frame(pml4, image_base() + i * vmm::PAGE_SIZE, g_image_frames[i], vmm::PAGE_USER | vmm::PAGE_SHARED);
+    }
+}
+
+std::uintptr_t image_base()
+{
+    return VDSO_BASE + vmm::PAGE_SIZE;
+}
+
+int clock_gettime_ns(int clock, std::uint64_t* ns)
+{
+    if (vdso_clock_read(g_data, clock, ns) != 0) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+void set_realtime_ns(std::uint64_t ns)
+{
+    std::uint64_t mono;
+    vdso_clock_read(g_data, VDSO_CLOCK_MONOTONIC, &mono);
+
+    write_begin();
+    g_data->realtime_offset_ns = static_cast<std::int64_t>(ns - mono);
+    write_end();
+}
+
+}
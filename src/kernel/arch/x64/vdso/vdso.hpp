@@ -0,0 +1,43 @@
+/**
+ * @file vdso.hpp
+ * @brief The vDSO, a shared library mapped into every user process.
+ *
+ * It serves clock_gettime(), gettimeofday(), time() and getcpu() without
+ * entering the kernel by reading a TSC conversion the kernel publishes in a
+ * read-only data page (see vdso_data.h and vclock.c).
+ *
+ * Both pages are shared by every process: the image and data frames are
+ * allocated once at boot and mapped with PAGE_SHARED, so fork() and exit()
+ * never copy or free them.
+ *
+ *   VDSO_BASE               data page (struct vdso_data), read-only
+ *   VDSO_BASE + PAGE_SIZE   the ELF image, AT_SYSINFO_EHDR points here
+ */
+
+#pragma once
+
+#include <arch/x64/memory/vmm.hpp>
+
+#include <cstdint>
+
+namespace x64::vdso {
+
+// Near the top of the user half, well clear of the ELF, stack and heap
+constexpr std::uintptr_t VDSO_BASE = 0x00007FFFFF000000;
+
+void init();
+
+// Map the data page and image into a user address space
+void map_into(vmm::PML4E* pml4);
+
+// User address of the image's ELF header, for AT_SYSINFO_EHDR
+std::uintptr_t image_base();
+
+// Read a clock through the same data page userspace uses, so the syscall
+// fallback and the vDSO always agree. Returns -EINVAL for unknown clocks.
+int clock_gettime_ns(int clock, std::uint64_t* ns);
+
+// Step CLOCK_REALTIME, CLOCK_MONOTONIC is never affected
+void set_realtime_ns(std::uint64_t ns);
+
+}
@@ -0,0 +1,115 @@
+/**
+ * @file vdso_data.h
+ * @brief Layout of the vDSO data page and the clock read both sides share.
+ *
+ * Included by the kernel (vdso.cpp) and by the vDSO itself (vclock.c), so
+ * this header is plain C with no kernel dependencies.
+ *
+ * The kernel publishes a TSC -> nanoseconds conversion here:
+ *
+ *   CLOCK_MONOTONIC = mono_base_ns + ((rdtsc() - tsc_base) * mult) >> shift
+ *   CLOCK_REALTIME  = CLOCK_MONOTONIC + realtime_offset_ns
+ *
+ * Updates are protected by a sequence counter: the kernel makes seq odd,
+ * writes the fields, then makes it even again. Readers retry if seq was odd
+ * or changed while they were reading, so they never see a half-written
+ * conversion and never take a lock.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define VDSO_CLOCK_REALTIME 0
+#define VDSO_CLOCK_MONOTONIC 1
+#define VDSO_CLOCK_MONOTONIC_RAW 4
+#define VDSO_CLOCK_REALTIME_COARSE 5
+#define VDSO_CLOCK_MONOTONIC_COARSE 6
+#define VDSO_CLOCK_BOOTTIME 7
+
+#define VDSO_NSEC_PER_SEC 1000000000ULL
+
+struct vdso_data {
+    uint32_t seq;               // Odd while the kernel is updating the page
+    uint32_t shift;             // TSC cycles -> ns scale is mult / 2^shift
+    uint64_t mult;
+    uint64_t tsc_base;          // TSC value at which CLOCK_MONOTONIC was mono_base_ns
+    uint64_t mono_base_ns;
+    int64_t realtime_offset_ns; // CLOCK_REALTIME - CLOCK_MONOTONIC
+    uint32_t has_rdtscp;        // IA32_TSC_AUX holds the cpu number
+};
+
+static inline uint64_t vdso_rdtsc(void)
+{
+    uint32_t lo;
+    uint32_t hi;
+
+    // lfence keeps rdtsc from being executed ahead of the seq load
+    __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint32_t vdso_read_begin(const struct vdso_data* vd)
+{
+    uint32_t seq;
+
+    while ((seq = __atomic_load_n(&vd->seq, __ATOMIC_ACQUIRE)) & 1) {
+        __asm__ volatile("pause");
+    }
+
+    return seq;
+}
+
+static inline int vdso_read_retry(const struct vdso_data* vd, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&vd->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/// @brief read one of the TSC based clocks
+///
+/// The coarse clocks are served with full precision, reading the TSC is
+/// already cheaper than anything a coarse clock could save.
+///
+/// @return 0 with *ns set, or -1 if the clock is not one of the above
+///
+static inline int vdso_clock_read(const struct vdso_data* vd, int clock, uint64_t* ns)
+{
+    uint32_t seq;
+    uint64_t mono;
+    int64_t offset;
+
+    switch (clock) {
+    case VDSO_CLOCK_REALTIME:
+    case VDSO_CLOCK_REALTIME_COARSE:
+    case VDSO_CLOCK_MONOTONIC:
+    case VDSO_CLOCK_MONOTONIC_RAW:
+    case VDSO_CLOCK_MONOTONIC_COARSE:
+    case VDSO_CLOCK_BOOTTIME:
+        break;
+    default:
+        return -1;
+    }
+
+    do {
+        seq = vdso_read_begin(vd);
+
+        const uint64_t delta = vdso_rdtsc() - __atomic_load_n(&vd->tsc_base, __ATOMIC_RELAXED);
+        const uint64_t mult = __atomic_load_n(&vd->mult, __ATOMIC_RELAXED);
+        const uint32_t shift = __atomic_load_n(&vd->shift, __ATOMIC_RELAXED);
+
+        mono = __atomic_load_n(&vd->mono_base_ns, __ATOMIC_RELAXED)
+             + (uint64_t)(((unsigned __int128)delta * mult) >> shift);
+        offset = __atomic_load_n(&vd->realtime_offset_ns, __ATOMIC_RELAXED);
+    } while (vdso_read_retry(vd, seq));
+
+    if (clock == VDSO_CLOCK_REALTIME || clock == VDSO_CLOCK_REALTIME_COARSE) {
+        *ns = mono + (uint64_t)offset;
+    } else {
+        *ns = mono;
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+# =============================================================================
+# vDSO image
+# =============================================================================
+#
+# Embeds the vDSO shared library (built from vclock.c, see CMakeLists.txt)
+# into the kernel. vdso.cpp copies it into pages at boot and maps those into
+# every process.
+#
+# =============================================================================
+
+.section .rodata
+.balign 4096
+
+.global vdso_image_start
+.global vdso_image_end
+
+vdso_image_start:
+    .incbin "vdso.so"
+vdso_image_end:
@@ -5,6 +5,7 @@
 #include <containers/klist.hpp>
 #include <containers/kstring.hpp>
 #include <containers/kvector.hpp>
+#include <utility>
 
 namespace algo {
 // Splits a string into components around a delim.
@@ -74,6 +75,40 @@ kstring join(const klist<T>& list, char delim = ' ')
     return result;
 }
 
+// Sorts [first, last) in place with heapsort: O(n log n) and no extra
+// memory, but not stable.
+template <typename T, typename Less>
+void sort(T* first, T* last, Less less)
+{
+    const std::size_t n = last - first;
+
+    auto sift_down = [&](std::size_t root, std::size_t end) {
+        while (2 * root + 1 < end) {
+            std::size_t child = 2 * root + 1;
+
+            if (child + 1 < end && less(first[child], first[child + 1])) {
+                child++;
+            }
+
+            if (!less(first[root], first[child])) {
+                return;
+            }
+
+            std::swap(first[root], first[child]);
+            root = child;
+        }
+    };
+
+    for (std::size_t i = n / 2; i > 0; i--) {
+        sift_down(i - 1, n);
+    }
+
+    for (std::size_t end = n; end > 1; end--) {
+        std::swap(first[0], first[end - 1]);
+        sift_down(0, end - 1);
+    }
+}
+
 template <std::integral T>
 T max(T a, T b)
 {
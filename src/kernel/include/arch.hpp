@@ -6,15 +6,19 @@
 #include <arch/x64/drivers/keyboard/keyboard.hpp>
 #include <arch/x64/drivers/serial/serial.hpp>
 #include <arch/x64/drivers/tsc/tsc.hpp>
+#include <arch/x64/fpu/fpu.hpp>
 #include <arch/x64/gdt/gdt.hpp>
+#include <arch/x64/memory/uaccess.hpp>
 #include <arch/x64/memory/vmm.hpp>
 #include <arch/x64/percpu/percpu.hpp>
 #include <arch/x64/tls/tls.hpp>
 #include <arch/x64/trap/syscall_entry.hpp>
+#include <arch/x64/vdso/vdso.hpp>
 
 // Allows kernel library code to indirectly access the current CPU architecture
 namespace arch {
 namespace vmm = ::x64::vmm;
+namespace uaccess = ::x64::uaccess;
 namespace cpu = ::x64::cpu;
 namespace irq = ::x64::irq;
 namespace drivers = ::x64::drivers;
@@ -22,5 +26,7 @@ namespace context = ::x64::context;
 namespace trap = ::x64::trap;
 namespace percpu = ::x64::percpu;
 namespace tls = ::x64::tls;
+namespace fpu = ::x64::fpu;
 namespace gdt = ::x64::gdt;
+namespace vdso = ::x64::vdso;
 }
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <containers/kstring_view.hpp>
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <process/wait_queue.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file block.hpp
+ * @brief Block devices and their request queue.
+ *
+ * A block device is an array of fixed-size sectors, read and written by
+ * submitting Requests. Submission does not wait: each request's done()
+ * callback is called with 0 or -errno once its transfer has finished,
+ * which may be before submit() returns (a RAM disk) or later from an
+ * interrupt (real hardware).
+ *
+ * Queued requests are kept in sector order, and a request that continues
+ * one already queued in the same direction is merged into it, so the
+ * driver sees one transfer per contiguous run instead of one per request.
+ * Runs are handed to the driver in ascending sector order, an elevator
+ * sweep. Queueing only pays off when several requests are submitted
+ * together, which is what plug() and unplug() are for:
+ *
+ *     dev->plug();
+ *     for (...) dev->submit(&requests[i]);
+ *     dev->unplug(); // dispatches the merged runs
+ *
+ * Outside a plug every request is dispatched as soon as it is submitted.
+ */
+
+namespace block {
+
+constexpr std::size_t SECTOR_SIZE = 512;
+
+enum class Op : std::uint8_t {
+    READ,
+    WRITE,
+};
+
+struct Request;
+
+using DoneFunc = void (*)(Request* req, int status);
+
+/**
+ * @brief One transfer of count sectors between the device and buffer.
+ *
+ * Owned by the submitter, which must keep it and buffer alive until done()
+ * is called. buffer is kernel memory, completion may run in another task.
+ */
+struct Request {
+    Op op = Op::READ;
+    std::uint64_t sector = 0;
+    std::uint32_t count = 0;
+    void* buffer = nullptr;
+    DoneFunc done = nullptr;
+    void* data = nullptr; // For done()
+
+    Request* next = nullptr; // Set while queued
+};
+
+/**
+ * @brief Requests merged into one contiguous run, what a driver transfers.
+ *
+ * first to last are in sector order, each starting where the one before
+ * ends. A driver copies each request's sectors to or from its own buffer.
+ */
+struct Batch {
+    Op op;
+    std::uint64_t sector;
+    std::uint32_t count;
+    Request* first;
+    Request* last;
+    std::uint32_t requests;
+
+    Batch* next;
+};
+
+struct QueueStats {
+    std::uint64_t submitted;  // Requests accepted
+    std::uint64_t merged;     // Requests that joined an existing batch
+    std::uint64_t dispatched; // Batches handed to the driver
+    std::uint64_t sectors;    // Sectors in those batches
+};
+
+class BlockDevice {
+private:
+    kspinlock_irqsave _lock; // Guards the queue, done() may submit from an IRQ
+    Batch* _queue = nullptr; // Sorted by sector, batches never overlap
+    std::uint32_t _queued = 0;
+    std::uint32_t _plugs = 0;
+    QueueStats _stats{};
+
+    bool merge(Request* req);
+    bool overlaps(const Request* req) const;
+    void insert(Request* req);
+    Batch* take_queue();
+    void dispatch(Batch* batches);
+
+protected:
+    // Start the transfer of batch, then call complete() when it is done,
+    // from inside transfer() or later
+    virtual void transfer(Batch* batch) = 0;
+
+    void complete(Batch* batch, int status);
+
+public:
+    const char* name;
+    std::uint64_t sectors;
+    std::uint32_t max_sectors; // Longest run the driver takes in one transfer
+
+    BlockDevice(const char* name, std::uint64_t sectors, std::uint32_t max_sectors);
+    virtual ~BlockDevice() = default;
+    BlockDevice(const BlockDevice&) = delete;
+    BlockDevice& operator=(const BlockDevice&) = delete;
+
+    void submit(Request* req);
+    void plug();
+    void unplug();
+
+    std::uint64_t size() const { return sectors * SECTOR_SIZE; }
+    QueueStats stats();
+};
+
+/**
+ * @brief Waits for any number of requests to finish.
+ *
+ * add() points a request's done() here, wait() returns once every added
+ * request has completed, with the first error among them or 0.
+ */
+class Completion final {
+private:
+    kspinlock_irqsave _lock;
+    std::uint32_t _pending = 0;
+    int _status = 0;
+    process::WaitQueue _queue;
+
+    static void done(Request* req, int status);
+
+public:
+    Completion() = default;
+    Completion(const Completion&) = delete;
+    Completion& operator=(const Completion&) = delete;
+
+    void add(Request* req);
+    int wait();
+};
+
+void register_device(BlockDevice* dev);
+BlockDevice* find(kstring_view name);
+
+// Transfer count sectors and wait for them, 0 or -errno
+int read(BlockDevice* dev, std::uint64_t sector, std::uint32_t count, void* buffer);
+int write(BlockDevice* dev, std::uint64_t sector, std::uint32_t count, const void* buffer);
+
+}
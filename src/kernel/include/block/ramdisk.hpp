@@ -0,0 +1,37 @@
+#pragma once
+
+#include <block/block.hpp>
+#include <exclusive/kspinlock.hpp>
+#include <fs/page_tree.hpp>
+
+#include <cstdint>
+
+namespace block {
+
+/**
+ * @brief A block device kept in kernel pages.
+ *
+ * The disk is sparse: a page is only allocated the first time one of its
+ * sectors is written, and sectors never written read back as zeros.
+ * Transfers are memcpy()s done inside transfer(), so every request has
+ * completed by the time submit() or unplug() returns.
+ */
+class RamDisk final : public BlockDevice {
+private:
+    fs::PageTree _pages;
+    kspinlock _lock; // Guards _pages
+
+protected:
+    void transfer(Batch* batch) override;
+
+public:
+    RamDisk(const char* name, std::uint64_t bytes);
+
+    // Pages written so far
+    std::size_t pages();
+};
+
+// Create and register ram0, sized by the block.ram0_mb tunable
+void init_ramdisk();
+
+}
@@ -1,5 +1,14 @@
 #pragma once
 
+#include <containers/kstring_view.hpp>
+
+#include <cstdint>
+
 namespace boot {
 void init();
+
+kstring_view get_cmdline();
+kstring_view get_cmdline_option(const char* key);
+
+std::int64_t get_boot_time();
 }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file lz4.hpp
+ * @brief LZ4 frame decoder, as written by the `lz4` command line tool.
+ *
+ * Blocks are decoded one after another straight into the destination, so
+ * there is no window buffer: matches are copied out of what was already
+ * decoded, which works for linked and independent blocks alike. Checksums
+ * in the frame are skipped over, not verified.
+ */
+
+namespace compress::lz4 {
+
+constexpr std::uint32_t FRAME_MAGIC = 0x184D2204;
+
+bool is_frame(const std::uint8_t* src, std::size_t src_len);
+
+std::uint64_t content_size(const std::uint8_t* src, std::size_t src_len);
+
+long decompress_frame(const std::uint8_t* src, std::size_t src_len, std::uint8_t* dst, std::size_t dst_len);
+
+}
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <cstddef>
+
+// Intrusive red-black tree. Elements embed a krbnode<T> and are linked into
+// the tree without any allocation, so insert/erase are safe to call with
+// interrupts disabled (e.g. from the scheduler while holding its lock).
+//
+// The tree caches its leftmost node, so first() is O(1) while insert() and
+// erase() are O(log n). Equal keys are allowed and keep insertion order.
+template <typename T>
+struct krbnode final {
+    T* owner = nullptr;
+    krbnode* parent = nullptr;
+    krbnode* left = nullptr;
+    krbnode* right = nullptr;
+    bool red = false;
+    bool linked = false;
+};
+
+template <typename T, krbnode<T> T::* Node, typename Less>
+class krbtree final {
+private:
+    using node = krbnode<T>;
+
+    node* _root;
+    node* _leftmost;
+
+    std::size_t _size;
+
+    static node* minimum(const node* n)
+    {
+        while (n->left != nullptr) {
+            n = n->left;
+        }
+
+        return const_cast<node*>(n);
+    }
+
+    static bool is_red(const node* n) { return n != nullptr && n->red; }
+
+    void rotate_left(node* x)
+    {
+        node* y = x->right;
+
+        x->right = y->left;
+
+        if (y->left != nullptr) {
+            y->left->parent = x;
+        }
+
+        replace_child(x, y);
+
+        y->left = x;
+        x->parent = y;
+    }
+
+    void rotate_right(node* x)
+    {
+        node* y = x->left;
+
+        x->left = y->right;
+
+        if (y->right != nullptr) {
+            y->right->parent = x;
+        }
+
+        replace_child(x, y);
+
+        y->right = x;
+        x->parent = y;
+    }
+
+    // Points whatever referenced `old_child` (its parent or the root) at `new_child`
+    void replace_child(node* old_child, node* new_child)
+    {
+        node* parent = old_child->parent;
+
+        if (new_child != nullptr) {
+            new_child->parent = parent;
+        }
+
+        if (parent == nullptr) {
+            _root = new_child;
+        } else if (parent->left == old_child) {
+            parent->left = new_child;
+        } else {
+            parent->right = new_child;
+        }
+    }
+
+    void insert_fixup(node* n)
+    {
+        while (is_red(n->parent)) {
+            node* parent = n->parent;
+            node* grandparent = parent->parent;
+
+            if (parent == grandparent->left) {
+                node* uncle = grandparent->right;
+
+                if (is_red(uncle)) {
+                    parent->red = false;
+                    uncle->red = false;
+                    grandparent->red = true;
+                    n = grandparent;
+                    continue;
+                }
+
+                if (n == parent->right) {
+                    n = parent;
+                    rotate_left(n);
+                    parent = n->parent;
+                }
+
+                parent->red = false;
+                grandparent->red = true;
+                rotate_right(grandparent);
+            } else {
+                node* uncle = grandparent->left;
+
+                if (is_red(uncle)) {
+                    parent->red = false;
+                    uncle->red = false;
+                    grandparent->red = true;
+                    n = grandparent;
+                    continue;
+                }
+
+                if (n == parent->left) {
+                    n = parent;
+                    rotate_right(n);
+                    parent = n->parent;
+                }
+
+                parent->red = false;
+                grandparent->red = true;
+                rotate_left(grandparent);
+            }
+        }
+
+        _root->red = false;
+    }
+
+    // `x` may be null (a black leaf), so its parent is passed explicitly
+    void erase_fixup(node* x, node* parent)
+    {
+        while (x != _root && !is_red(x)) {
+            if (x == parent->left) {
+                node* sibling = parent->right;
+
+                if (is_red(sibling)) {
+                    sibling->red = false;
+                    parent->red = true;
+                    rotate_left(parent);
+                    sibling = parent->right;
+                }
+
+                if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                    sibling->red = true;
+                    x = parent;
+                    parent = x->parent;
+                    continue;
+                }
+
+                if (!is_red(sibling->right)) {
+                    sibling->left->red = false;
+                    sibling->red = true;
+                    rotate_right(sibling);
+                    sibling = parent->right;
+                }
+
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->right->red = false;
+                rotate_left(parent);
+                x = _root;
+            } else {
+                node* sibling = parent->left;
+
+                if (is_red(sibling)) {
+                    sibling->red = false;
+                    parent->red = true;
+                    rotate_right(parent);
+                    sibling = parent->left;
+                }
+
+                if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                    sibling->red = true;
+                    x = parent;
+                    parent = x->parent;
+                    continue;
+                }
+
+                if (!is_red(sibling->left)) {
+                    sibling->right->red = false;
+                    sibling->red = true;
+                    rotate_left(sibling);
+                    sibling = parent->left;
+                }
+
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->left->red = false;
+                rotate_right(parent);
+                x = _root;
+            }
+        }
+
+        if (x != nullptr) {
+            x->red = false;
+        }
+    }
+
+public:
+    krbtree()
+        : _root{nullptr}
+        , _leftmost{nullptr}
+        , _size{0}
+    {
+    }
+
+    ~krbtree() = default;
+
+    krbtree(const krbtree&) = delete;
+    krbtree(krbtree&&) = delete;
+    krbtree& operator=(const krbtree&) = delete;
+    krbtree& operator=(krbtree&&) = delete;
+
+    std::size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    bool contains(const T* t) const { return (t->*Node).linked; }
+
+    T* first() const { return _leftmost == nullptr ? nullptr : _leftmost->owner; }
+
+    void insert(T* t)
+    {
+        node* n = &(t->*Node);
+        node* parent = nullptr;
+        node** link = &_root;
+        bool leftmost = true;
+
+        while (*link != nullptr) {
+            parent = *link;
+
+            if (Less{}(*t, *parent->owner)) {
+                link = &parent->left;
+            } else {
+                link = &parent->right;
+                leftmost = false;
+            }
+        }
+
+        n->owner = t;
+        n->parent = parent;
+        n->left = nullptr;
+        n->right = nullptr;
+        n->red = true;
+        n->linked = true;
+
+        *link = n;
+
+        if (leftmost) {
+            _leftmost = n;
+        }
+
+        insert_fixup(n);
+
+        _size++;
+    }
+
+    void erase(T* t)
+    {
+        node* z = &(t->*Node);
+
+        if (!z->linked) {
+            return;
+        }
+
+        if (z == _leftmost) {
+            _leftmost = z->right != nullptr ? minimum(z->right) : z->parent;
+        }
+
+        node* x;
+        node* x_parent;
+        bool removed_red = z->red;
+
+        if (z->left == nullptr) {
+            x = z->right;
+            x_parent = z->parent;
+            replace_child(z, z->right);
+        } else if (z->right == nullptr) {
+            x = z->left;
+            x_parent = z->parent;
+            replace_child(z, z->left);
+        } else {
+            // Two children: splice out the in-order successor `y` and put it
+            // where `z` used to be, inheriting z's color
+            node* y = minimum(z->right);
+
+            removed_red = y->red;
+            x = y->right;
+
+            if (y->parent == z) {
+                x_parent = y;
+            } else {
+                x_parent = y->parent;
+                replace_child(y, y->right);
+                y->right = z->right;
+                y->right->parent = y;
+            }
+
+            replace_child(z, y);
+            y->left = z->left;
+            y->left->parent = y;
+            y->red = z->red;
+        }
+
+        if (!removed_red) {
+            erase_fixup(x, x_parent);
+        }
+
+        z->parent = nullptr;
+        z->left = nullptr;
+        z->right = nullptr;
+        z->linked = false;
+
+        _size--;
+    }
+
+    T* pop_first()
+    {
+        T* t = first();
+
+        if (t != nullptr) {
+            erase(t);
+        }
+
+        return t;
+    }
+
+    // In-order successor, or nullptr if `t` is the last element
+    T* next(const T* t) const
+    {
+        const node* n = &(t->*Node);
+
+        if (n->right != nullptr) {
+            return minimum(n->right)->owner;
+        }
+
+        while (n->parent != nullptr && n == n->parent->right) {
+            n = n->parent;
+        }
+
+        return n->parent == nullptr ? nullptr : n->parent->owner;
+    }
+
+    // Walks the tree and checks every red-black invariant. Returns the black
+    // height, or -1 if the tree is malformed. Intended for tests.
+    int validate() const
+    {
+        if (is_red(_root)) {
+            return -1;
+        }
+
+        if ((_root == nullptr) != (_leftmost == nullptr)) {
+            return -1;
+        }
+
+        if (_root != nullptr && _leftmost != minimum(_root)) {
+            return -1;
+        }
+
+        return validate(_root);
+    }
+
+private:
+    static int validate(const node* n)
+    {
+        if (n == nullptr) {
+            return 1;
+        }
+
+        if (n->red && (is_red(n->left) || is_red(n->right))) {
+            return -1;
+        }
+
+        if (n->left != nullptr && (n->left->parent != n || Less{}(*n->owner, *n->left->owner))) {
+            return -1;
+        }
+
+        if (n->right != nullptr && (n->right->parent != n || Less{}(*n->right->owner, *n->owner))) {
+            return -1;
+        }
+
+        const int left = validate(n->left);
+        const int right = validate(n->right);
+
+        if (left < 0 || right < 0 || left != right) {
+            return -1;
+        }
+
+        return left + (n->red ? 0 : 1);
+    }
+};
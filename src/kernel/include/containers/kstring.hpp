@@ -213,7 +213,7 @@ public:
         }
 
         ensure_capacity(count + 1);
-        memcpy(_data, s, count + 1);
+        memcpy(_data, s, count);
         _length = count;
         _data[_length] = '\0';
     }
@@ -222,7 +222,7 @@ public:
         : kstring{}
     {
         ensure_capacity(sv.length() + 1);
-        memcpy(_data, sv.c_str(), sv.length() + 1);
+        memcpy(_data, sv.c_str(), sv.length());
         _length = sv.length();
         _data[_length] = '\0';
     }
@@ -592,7 +592,9 @@ public:
 
     bool ends_with(char c) const { return _length > 0 && back() == c; }
 
-    static kstring from_userspace(const char* chars);
+    // Copy a NUL terminated user string of at most max_length characters
+    // into out. Returns 0, -EFAULT or -ENAMETOOLONG
+    static int from_user(const char* chars, std::size_t max_length, kstring& out);
 };
 
 inline kstring operator+(const char* lhs, const kstring& rhs)
@@ -160,8 +160,6 @@ public:
         return kstring_view{_data + pos, len};
     }
 
-    static kstring_view from_userspace(const char* chars);
-
     friend bool operator==(const kstring_view& lhs, const kstring_view& rhs)
     {
         if (lhs.length() != rhs.length()) {
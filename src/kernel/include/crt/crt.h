@@ -22,6 +22,21 @@ char* strcpy(char* dest, const char* src);
 char* strncpy(char* dest, const char* src, size_t n);
 char* strcat(char* dest, const char* src);
 
+// One way of doing memcpy()/memset(). crt_init() picks the fastest one the
+// CPU supports, until then the "rep movsq" variant is used, which works
+// everywhere
+struct crt_mem_impl {
+    const char* name;
+    void* (*copy)(void* dest, const void* src, size_t count);
+    void* (*set)(void* dest, int val, size_t count);
+};
+
+void crt_init(void);
+
+size_t crt_num_mem_impls(void);
+const struct crt_mem_impl* crt_get_mem_impl(size_t index);
+const struct crt_mem_impl* crt_active_mem_impl(void);
+
 #ifdef __cplusplus
 }
 #endif
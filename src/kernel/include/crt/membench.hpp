@@ -0,0 +1,18 @@
+/**
+ * @file membench.hpp
+ * @brief Boot time benchmark of the memcpy()/memset() variants.
+ *
+ * Enabled with `membench=1` on the kernel command line. Every variant in
+ * crt.c, plus the non-temporal SSE/AVX copies, is timed on buffer sizes
+ * from 8 bytes to 8 MiB and the throughput is logged, so the variant
+ * crt_init() picked can be checked against the others on real hardware.
+ */
+
+#pragma once
+
+namespace membench {
+
+// Runs only when the command line has membench=1
+void run();
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <exclusive/kspinlock.hpp>
+#include <process/wait_queue.hpp>
+
+/**
+ * @brief A lock whose waiters sleep instead of spinning.
+ *
+ * For long critical sections that may block themselves, e.g. on disk I/O,
+ * which a spinlock must never be held across. Only usable from a task,
+ * never from an interrupt handler.
+ */
+class kmutex final {
+private:
+    kspinlock _lock; // Guards _locked
+    bool _locked = false;
+    process::WaitQueue _queue;
+
+public:
+    kmutex() = default;
+    ~kmutex() = default;
+    kmutex(const kmutex&) = delete;
+    kmutex(kmutex&&) = delete;
+    kmutex& operator=(const kmutex&) = delete;
+    kmutex& operator=(kmutex&&) = delete;
+
+    void lock()
+    {
+        _lock.lock();
+
+        while (_locked) {
+            _queue.prepare();
+            _lock.unlock();
+            _queue.sleep();
+            _lock.lock();
+        }
+
+        _locked = true;
+        _lock.unlock();
+    }
+
+    bool try_lock()
+    {
+        _lock.lock();
+
+        const bool taken = !_locked;
+
+        _locked = true;
+        _lock.unlock();
+
+        return taken;
+    }
+
+    void unlock()
+    {
+        _lock.lock();
+        _locked = false;
+        _queue.wake_one();
+        _lock.unlock();
+    }
+};
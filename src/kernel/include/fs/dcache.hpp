@@ -0,0 +1,62 @@
+#pragma once
+
+#include <containers/kstring.hpp>
+#include <containers/kstring_view.hpp>
+#include <fs/fs.hpp>
+
+#include <cstdint>
+
+/**
+ * @file dcache.hpp
+ * @brief Cache of path component lookups, keyed on (parent inode, name).
+ *
+ * Path resolution probes here before calling Inode::lookup(), so walking a
+ * path that was walked before costs one hash probe per component instead
+ * of a scan of each directory's children and of the mount table. Misses
+ * are cached too (negative entries), as are mounts: an entry for a
+ * directory something is mounted on already points at the mounted root.
+ *
+ * Filesystems never see the cache. The VFS drops the affected entry after
+ * anything that adds or removes a name, everything under a directory that
+ * is removed, and everything on mount.
+ */
+
+namespace fs::dcache {
+
+struct Dentry {
+    Inode* parent;
+    Inode* inode;      // nullptr for a negative entry
+    MountPoint* mount; // Mounted on inode, resolution continues at its root
+    std::uint64_t hash;
+    kstring name;
+    Dentry* next;
+};
+
+// Result of a probe
+enum class Lookup : std::uint8_t {
+    MISS,     // Not cached, ask the filesystem
+    NEGATIVE, // Cached as not existing
+    HIT,
+};
+
+struct Stats {
+    std::uint64_t hits;
+    std::uint64_t negative_hits;
+    std::uint64_t misses;
+    std::uint64_t entries;
+};
+
+bool enabled();
+
+Lookup lookup(Inode* parent, kstring_view name, Inode** inode);
+
+std::uint64_t begin_fill(Inode* parent, kstring_view name);
+void fill(Inode* parent, kstring_view name, Inode* inode, MountPoint* mount, std::uint64_t seq);
+
+void invalidate(Inode* parent, kstring_view name);
+void invalidate_dir(const Inode* dir);
+void flush();
+
+Stats stats();
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <block/block.hpp>
+#include <fs/fs.hpp>
+
+namespace fs::devfs {
+
+// A block device as a file of its bytes. Reads and writes may start and end
+// anywhere, they go to the device as page-sized requests under one plug, a
+// partly written page is read in first
+class DevBlockInode final : public Inode {
+private:
+    block::BlockDevice* dev;
+
+public:
+    DevBlockInode(MountPoint* mp, Inode* parent, int ino, block::BlockDevice* dev);
+
+    int open(FileDescriptor* fd, int) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor*) override;
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+    int ioctl(unsigned long request, void* arg) override;
+};
+
+}
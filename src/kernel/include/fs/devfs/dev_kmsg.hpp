@@ -0,0 +1,21 @@
+#pragma once
+
+#include <fs/fs.hpp>
+
+namespace fs::devfs {
+
+// Read-only view of the kernel log, one "<prio>,<seq>,<usec>,-;text" line per
+// record. Each open file descriptor keeps its own position in the log.
+class DevKmsgInode final : public Inode {
+public:
+    DevKmsgInode(MountPoint* mp, Inode* parent, int ino);
+
+    int open(FileDescriptor*, int) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor*, const void*, std::size_t count) override;
+    int close(FileDescriptor*) override;
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include <arch.hpp>
 #include <containers/kstring.hpp>
+#include <exclusive/kspinlock.hpp>
 #include <fs/fs.hpp>
 
 namespace process {
@@ -19,6 +20,15 @@ private:
     std::size_t buffer_index = 0;
     std::size_t history_index = 0;
 
+    // Line finished with Enter and not read yet, editing the next one waits
+    // until it is
+    kstring line{};
+    bool line_ready = false;
+
+    kspinlock input_lock; // read() and poll() both edit the line
+
+    bool process_input();
+
     void page_up();
     void page_down();
     void insert_char(char c);
@@ -44,6 +54,7 @@ public:
     int lseek(FileDescriptor* fd, int offset, int whence) override;
     int stat(Stat* stat) override;
     int ioctl(unsigned long request, void* arg) override;
+    std::uint32_t poll(FileDescriptor* fd, PollTable* table) override;
 };
 
 void init_tty();
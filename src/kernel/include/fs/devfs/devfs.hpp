@@ -1,5 +1,7 @@
 #pragma once
 
+#include <fs/devfs/dev_block.hpp>
+#include <fs/devfs/dev_kmsg.hpp>
 #include <fs/devfs/dev_null.hpp>
 #include <fs/devfs/dev_tty.hpp>
 #include <fs/fs.hpp>
@@ -12,6 +14,8 @@ constexpr int DEV_ROOT_INO = 1;
 constexpr int DEV_NULL_INO = 2;
 constexpr int DEV_TTY1_INO = 3;
 constexpr int DEV_TTY2_INO = 4;
+constexpr int DEV_KMSG_INO = 5;
+constexpr int DEV_RAM0_INO = 6;
 
 class DevDirectoryInode final : public DirectoryInode {
 private:
@@ -19,7 +23,7 @@ public:
     DevDirectoryInode(DevMountPoint* mp, int ino);
 
     Inode* lookup(const char* name) override;
-    int readdir(kvector<DirEntry>& entries) override;
+    int iterate(DirContext& ctx) override;
     int mkdir(const char* name, int mode) override;
     int create(const char* name, int mode) override;
     int open(FileDescriptor* fd, int flags) override;
@@ -32,6 +36,8 @@ public:
     DevNullInode* null_inode;
     DevTtyInode* tty1_inode;
     DevTtyInode* tty2_inode;
+    DevKmsgInode* kmsg_inode;
+    DevBlockInode* ram0_inode; // nullptr without a RAM disk
 
     DevMountPoint();
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <containers/kstring_view.hpp>
+#include <containers/kvector.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+class Inode;
+
+/**
+ * @brief The entries of an in-memory directory, by name and in order.
+ *
+ * Entries live in an array in the order they were added, with an open
+ * addressing hash table of positions in that array on the side, so finding
+ * a name is one probe on average and listing is a walk of the array.
+ *
+ * An entry keeps its position until it is removed, the slot it leaves is
+ * a hole that readers skip. Positions are what readdir cursors hold, so
+ * holes are only squeezed out while nobody has the directory open, see
+ * pin(). The name of an entry is the inode's own name, which must not
+ * change while it is in the index.
+ */
+class DirIndex final {
+private:
+    struct Slot {
+        std::uint32_t hash;  // Low bits of the name hash, to skip most compares
+        std::uint32_t index; // Position + 1, or EMPTY/DELETED
+    };
+
+    static constexpr std::uint32_t EMPTY = 0;
+    static constexpr std::uint32_t DELETED = ~0u;
+
+    kvector<Inode*> _order; // nullptr where an entry was removed
+    kvector<Slot> _slots;   // Power of two sized, or empty
+    std::size_t _live = 0;
+    std::size_t _deleted = 0; // DELETED slots
+    std::size_t _pins = 0;
+
+    std::size_t probe(kstring_view name, std::uint64_t hash) const;
+    void rehash(std::size_t capacity);
+    void maybe_compact();
+
+public:
+    DirIndex() = default;
+    DirIndex(const DirIndex&) = delete;
+    DirIndex& operator=(const DirIndex&) = delete;
+
+    Inode* find(kstring_view name) const;
+    bool insert(Inode* inode);
+    Inode* remove(kstring_view name);
+
+    std::size_t size() const { return _live; }
+    bool empty() const { return _live == 0; }
+
+    // Positions for readdir, at() is nullptr for a hole
+    std::size_t end() const { return _order.size(); }
+    Inode* at(std::size_t pos) const { return _order[pos]; }
+
+    // Held while the directory is open, keeps every position where it is
+    void pin();
+    void unpin();
+};
+
+}
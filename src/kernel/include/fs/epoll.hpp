@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * @file epoll.hpp
+ * @brief epoll instances.
+ *
+ * Each watched file gets an EpollItem whose PollTable stays hooked on the
+ * file's wait queues. A wakeup there puts the item on its instance's ready
+ * list, so epoll_wait() only ever looks at files that changed, however
+ * many are watched.
+ */
+
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <fs/fs.hpp>
+#include <fs/poll.hpp>
+#include <linux/poll.hpp>
+#include <process/wait_queue.hpp>
+
+#include <cstdint>
+
+namespace fs {
+
+class EpollInode;
+
+struct EpollItem {
+    EpollInode* epoll;
+    FileDescriptor* file;
+    int fd; // Together with file, the key EPOLL_CTL_MOD/DEL look up
+    std::uint32_t events;
+    std::uint64_t data;
+
+    PollTable table;
+
+    EpollItem* next;      // Instance's list of items
+    EpollItem* file_next; // File's list of items, see FileDescriptor::epoll_items
+    EpollItem* ready_next;
+    bool ready;
+
+    EpollItem(EpollInode* epoll, FileDescriptor* file, int fd);
+};
+
+class EpollInode final : public Inode {
+private:
+    friend struct EpollItem;
+
+    EpollItem* _items = nullptr;
+
+    kspinlock_irqsave _ready_lock; // Item wakeups may run in IRQs
+    EpollItem* _ready_head = nullptr;
+    EpollItem* _ready_tail = nullptr;
+
+    process::WaitQueue _waiters;
+
+    static void item_wake(process::WaitEntry* entry);
+
+    EpollItem* find(FileDescriptor* file, int fd);
+    void mark_ready(EpollItem* item);
+    void unmark_ready(EpollItem* item);
+    void remove(EpollItem* item);
+
+    int harvest(linux::epoll_event* events, int max_events);
+
+public:
+    EpollInode();
+    ~EpollInode() override;
+
+    int ctl(int op, int fd, FileDescriptor* file, std::uint32_t events, std::uint64_t data);
+    int wait(linux::epoll_event* events, int max_events, int timeout_ms);
+
+    // Called when a watched file is closed for the last time
+    static void release(FileDescriptor* file);
+
+    int open(FileDescriptor* fd, int flags) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor* fd) override;
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+    std::uint32_t poll(FileDescriptor* fd, PollTable* table) override;
+};
+
+FileDescriptor* create_epoll();
+EpollInode* to_epoll(FileDescriptor* fd);
+
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <block/block.hpp>
+#include <exclusive/kmutex.hpp>
+#include <fs/fs.hpp>
+#include <fs/page_cache.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file ext2.hpp
+ * @brief The second extended filesystem, read and written on a block device.
+ *
+ * Everything goes through the page cache. Metadata (superblock, group
+ * descriptors, bitmaps, inode tables and indirect blocks) is read from the
+ * raw device through one DeviceMapping, file and directory contents through
+ * a FileMapping per inode, whose map() turns file offsets into sectors.
+ * Nothing is written synchronously: changes only dirty cached pages, which
+ * the writeback thread or sync() write out later.
+ *
+ * Inodes are created the first time a lookup reaches them and stay in
+ * memory until they are deleted, the VFS and the dentry cache keep plain
+ * pointers to them. The pages behind them are evicted like any others.
+ *
+ * Not supported: the journal and extents of ext3/ext4, hashed directory
+ * indexes (they are cleared, which ext2 allows), hard links, symlinks and
+ * device nodes (listed, but not opened as such) and unmounting.
+ */
+
+namespace fs::ext2 {
+
+constexpr std::uint16_t MAGIC = 0xEF53;
+constexpr std::uint32_t ROOT_INO = 2;
+
+// Byte offset of the superblock on the device, whatever the block size
+constexpr std::uint64_t SUPERBLOCK_OFFSET = 1024;
+
+constexpr std::uint32_t INCOMPAT_FILETYPE = 0x0002;
+constexpr std::uint32_t RO_COMPAT_SPARSE_SUPER = 0x0001;
+constexpr std::uint32_t RO_COMPAT_LARGE_FILE = 0x0002;
+
+// i_mode file types
+constexpr std::uint16_t S_IFMT = 0xF000;
+constexpr std::uint16_t S_IFIFO = 0x1000;
+constexpr std::uint16_t S_IFCHR = 0x2000;
+constexpr std::uint16_t S_IFDIR = 0x4000;
+constexpr std::uint16_t S_IFBLK = 0x6000;
+constexpr std::uint16_t S_IFREG = 0x8000;
+constexpr std::uint16_t S_IFLNK = 0xA000;
+
+// Directory entry file types
+constexpr std::uint8_t FT_UNKNOWN = 0;
+constexpr std::uint8_t FT_REG_FILE = 1;
+constexpr std::uint8_t FT_DIR = 2;
+constexpr std::uint8_t FT_CHRDEV = 3;
+constexpr std::uint8_t FT_BLKDEV = 4;
+constexpr std::uint8_t FT_FIFO = 5;
+
+// i_flags bit for a hashed directory index
+constexpr std::uint32_t INDEX_FL = 0x1000;
+
+constexpr std::size_t DIRECT_BLOCKS = 12;
+constexpr std::size_t IND_BLOCK = 12;
+constexpr std::size_t DIND_BLOCK = 13;
+constexpr std::size_t TIND_BLOCK = 14;
+constexpr std::size_t N_BLOCKS = 15;
+
+struct [[gnu::packed]] Superblock {
+    std::uint32_t inodes_count;
+    std::uint32_t blocks_count;
+    std::uint32_t r_blocks_count;
+    std::uint32_t free_blocks_count;
+    std::uint32_t free_inodes_count;
+    std::uint32_t first_data_block;
+    std::uint32_t log_block_size; // Block size is 1024 << log_block_size
+    std::uint32_t log_frag_size;
+    std::uint32_t blocks_per_group;
+    std::uint32_t frags_per_group;
+    std::uint32_t inodes_per_group;
+    std::uint32_t mtime;
+    std::uint32_t wtime;
+    std::uint16_t mnt_count;
+    std::int16_t max_mnt_count;
+    std::uint16_t magic;
+    std::uint16_t state;
+    std::uint16_t errors;
+    std::uint16_t minor_rev_level;
+    std::uint32_t lastcheck;
+    std::uint32_t checkinterval;
+    std::uint32_t creator_os;
+    std::uint32_t rev_level;
+    std::uint16_t def_resuid;
+    std::uint16_t def_resgid;
+
+    // Dynamic revision (rev_level 1) only
+    std::uint32_t first_ino;
+    std::uint16_t inode_size;
+    std::uint16_t block_group_nr;
+    std::uint32_t feature_compat;
+    std::uint32_t feature_incompat;
+    std::uint32_t feature_ro_compat;
+    std::uint8_t uuid[16];
+    char volume_name[16];
+    char last_mounted[64];
+    std::uint32_t algo_bitmap;
+    std::uint8_t prealloc_blocks;
+    std::uint8_t prealloc_dir_blocks;
+    std::uint16_t padding;
+    std::uint8_t reserved[816];
+};
+
+static_assert(sizeof(Superblock) == 1024);
+
+struct [[gnu::packed]] GroupDesc {
+    std::uint32_t block_bitmap;
+    std::uint32_t inode_bitmap;
+    std::uint32_t inode_table;
+    std::uint16_t free_blocks_count;
+    std::uint16_t free_inodes_count;
+    std::uint16_t used_dirs_count;
+    std::uint16_t padding;
+    std::uint8_t reserved[12];
+};
+
+static_assert(sizeof(GroupDesc) == 32);
+
+// Every field falls on its natural alignment, so this is not packed and
+// bmap() can point into block[]
+struct DiskInode {
+    std::uint16_t mode;
+    std::uint16_t uid;
+    std::uint32_t size;
+    std::uint32_t atime;
+    std::uint32_t ctime;
+    std::uint32_t mtime;
+    std::uint32_t dtime;
+    std::uint16_t gid;
+    std::uint16_t links_count;
+    std::uint32_t blocks; // In 512-byte sectors, indirect blocks included
+    std::uint32_t flags;
+    std::uint32_t osd1;
+    std::uint32_t block[N_BLOCKS];
+    std::uint32_t generation;
+    std::uint32_t file_acl;
+    std::uint32_t size_high; // i_dir_acl, the upper size bits of a regular file
+    std::uint32_t faddr;
+    std::uint8_t osd2[12];
+};
+
+static_assert(sizeof(DiskInode) == 128);
+
+// Header of a directory entry, the name follows without a NUL
+struct [[gnu::packed]] DirEntryHeader {
+    std::uint32_t inode; // 0 for an unused entry
+    std::uint16_t rec_len;
+    std::uint8_t name_len;
+    std::uint8_t file_type;
+};
+
+class Ext2MountPoint;
+struct Node;
+
+/**
+ * @brief The contents of one inode, in the page cache.
+ */
+class FileMapping final : public cache::Mapping {
+public:
+    Ext2MountPoint* mp;
+    Node* node;
+
+    FileMapping(Ext2MountPoint* mp, Node* node);
+
+    std::uint64_t end() override;
+    int map(cache::Page* page) override;
+};
+
+/**
+ * @brief What files and directories both keep of an inode.
+ */
+struct Node {
+    Inode* inode;
+    DiskInode disk;
+    FileMapping data;
+    std::uint32_t goal = 0;   // Allocate the next block after this one
+    int opens = 0;            // Open fds, an unlinked inode is freed at the last close
+    bool unlinked = false;
+    Node* hash_next = nullptr; // The mount's other cached inodes
+
+    Node(Ext2MountPoint* mp, Inode* inode);
+};
+
+class Ext2FileInode final : public Inode {
+public:
+    Node node;
+
+    Ext2FileInode(Ext2MountPoint* mp, std::uint32_t ino);
+
+    int open(FileDescriptor* fd, int flags) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor* fd) override;
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+    int truncate(std::size_t length) override;
+};
+
+class Ext2DirInode final : public DirectoryInode {
+public:
+    Node node;
+
+    Ext2DirInode(Ext2MountPoint* mp, std::uint32_t ino);
+
+    Inode* lookup(const char* name) override;
+    int iterate(DirContext& ctx) override;
+    int mkdir(const char* name, int mode) override;
+    int create(const char* name, int mode) override;
+    int unlink(const char* name) override;
+    int rmdir(const char* name) override;
+    int rename(const char* name, Inode* new_dir, const char* new_name) override;
+    int open(FileDescriptor* fd, int flags) override;
+    int close(FileDescriptor* fd) override;
+    int stat(Stat* stat) override;
+};
+
+class Ext2MountPoint final : public MountPoint {
+public:
+    static constexpr std::size_t NODE_BUCKETS = 256;
+
+    kmutex lock; // Held by every operation, guards everything below
+    block::BlockDevice* dev;
+    cache::DeviceMapping meta;
+    cache::Page* sb_page; // Pinned for as long as the mount lives
+    Superblock* sb;
+    std::uint32_t block_size;
+    std::uint32_t groups;
+    std::uint32_t inode_size;
+    std::uint32_t first_ino;
+    bool read_only;
+    Node* nodes[NODE_BUCKETS] = {};
+
+    explicit Ext2MountPoint(block::BlockDevice* dev);
+
+    int load();
+    Inode* get_inode(std::uint32_t ino, Inode* parent, kstring_view name);
+};
+
+class Ext2FileSystem final : public FileSystem {
+public:
+    const char* name() override;
+    MountPoint* mount(const char* source) override;
+};
+
+}
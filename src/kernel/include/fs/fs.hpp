@@ -1,9 +1,10 @@
 #pragma once
 
-#include "containers/klist.hpp"
 #include <cerrno>
 #include <containers/kstring.hpp>
+#include <containers/kstring_view.hpp>
 #include <containers/kvector.hpp>
+#include <fs/dir_index.hpp>
 
 #include <cstddef>
 #include <cstdint>
@@ -14,24 +15,38 @@ enum class FileType : std::uint8_t {
     REGULAR = 1,
     DIRECTORY = 2,
     CHAR_DEVICE = 3,
+    FIFO = 4,
+    BLOCK_DEVICE = 5,
 };
 
 constexpr int O_RDONLY = 0x00;
 constexpr int O_WRONLY = 0x01;
 constexpr int O_RDWR = 0x02;
+constexpr int O_ACCMODE = 0x03;
+constexpr int O_CREAT = 0x40;
+constexpr int O_NONBLOCK = 0x800;
+constexpr int O_CLOEXEC = 0x80000;
 
 constexpr int SEEK_SET = 0;
 constexpr int SEEK_CUR = 1;
 constexpr int SEEK_END = 2;
 
+// Longest path a syscall accepts, including the terminating NUL
+constexpr std::size_t MAX_PATH = 4096;
+
+// Longest single path component, not including a NUL
+constexpr std::size_t MAX_NAME = 255;
+
 struct FileDescriptor;
 struct Stat;
 struct DirEntry;
+struct EpollItem;
 
 class Inode;
 class DirectoryInode;
 class FileSystem;
 class MountPoint;
+class PollTable;
 
 /**
  * @brief File metadata (for stat() without opening).
@@ -56,6 +71,22 @@ struct DirEntry {
     }
 };
 
+/**
+ * @brief Where a directory listing goes, see Inode::iterate().
+ *
+ * pos is the cursor, an opaque position the directory starts listing at.
+ * emit() is given each entry and the cursor just past it, and returns false
+ * if there is no room for it, in which case the listing stops there and
+ * pos is left pointing at that entry for the next call.
+ */
+class DirContext {
+public:
+    std::size_t pos = 0;
+
+    virtual ~DirContext() = default;
+    virtual bool emit(kstring_view name, std::uint64_t ino, FileType type, std::size_t next) = 0;
+};
+
 /**
  * @brief An open file handle (per-process).
  */
@@ -64,6 +95,11 @@ struct FileDescriptor {
     kstring path;
     std::size_t offset;
     int flags;
+    int refs = 1; // fd table slots pointing here, see dup() and fork()
+    EpollItem* epoll_items = nullptr; // epoll instances watching this file
+
+    void get();
+    int put();
 };
 
 class FileSystem {
@@ -113,10 +149,53 @@ public:
 
     virtual int ioctl(unsigned long, void*) { return -ENOTTY; }
 
+    // Bulk transfer source (sendfile, splice, copy_file_range): point *data
+    // at up to count bytes of the file's own memory at fd->offset, without
+    // copying or moving the offset. The pointer is good until the file is
+    // next truncated, or for as long as a map() reference is held on it.
+    // Files that can not be mapped never free that memory. Returns the
+    // bytes available there, 0 at end of file, or -EOPNOTSUPP if the
+    // contents are not in memory, in which case the caller read()s into a
+    // bounce buffer instead
+    virtual int read_direct(FileDescriptor*, const void**, std::size_t) { return -EOPNOTSUPP; }
+
+    // Set the size of a regular file, what is cut off is gone and what is
+    // added reads as zeros
+    virtual int truncate(std::size_t) { return -EINVAL; }
+
+    // MAP_SHARED mmap: every mapping holds a reference from map() until
+    // unmap(), map_page() gives the frame behind page index of the file,
+    // filling a hole first. A frame that may be mapped is not freed before
+    // the last unmap(), even if the file is truncated or unlinked
+    virtual int map() { return -ENODEV; }
+    virtual void unmap() {}
+    virtual int map_page(std::size_t, std::uintptr_t*) { return -ENODEV; }
+
+    // Readiness for poll()/epoll: return the POLL* events that would not
+    // block right now. With a table, also table->wait() on every queue
+    // that is woken when that changes. Files that never block keep the
+    // default of always readable and writable
+    virtual std::uint32_t poll(FileDescriptor* fd, PollTable* table);
+
     virtual Inode* lookup(const char*) { return nullptr; }
-    virtual int readdir(kvector<DirEntry>&) { return -ENOTDIR; }
+
+    // List the directory from ctx.pos on, advancing it past every entry
+    // that was taken. Returns 0 or -errno
+    virtual int iterate(DirContext&) { return -ENOTDIR; }
+
+    // The whole listing at once, returns the number of entries or -errno
+    int readdir(kvector<DirEntry>& entries);
     virtual int mkdir(const char*, int) { return -ENOTDIR; }
     virtual int create(const char*, int) { return -ENOTDIR; }
+
+    // Remove a name from this directory. The VFS has already checked that
+    // nothing is mounted on it. The inode goes away once no fd has it open
+    virtual int unlink(const char*) { return -ENOTDIR; }
+    virtual int rmdir(const char*) { return -ENOTDIR; }
+
+    // Move name to new_name in new_dir, on the same mount, replacing what is
+    // there if the types allow it
+    virtual int rename(const char*, Inode*, const char*) { return -ENOTDIR; }
 };
 
 class ReadOnlyInode : public Inode {
@@ -133,7 +212,7 @@ public:
 
 class DirectoryInode : public Inode {
 public:
-    klist<Inode*> children;
+    DirIndex children;
 
     explicit DirectoryInode(MountPoint* mpt);
     DirectoryInode() = delete;
@@ -145,7 +224,15 @@ public:
 
     int read(FileDescriptor*, void*, std::size_t) final override { return -EISDIR; }
     int write(FileDescriptor*, const void*, std::size_t) final override { return -EISDIR; }
-    int lseek(FileDescriptor*, int, int) final override { return -EISDIR; }
+    int lseek(FileDescriptor* fd, int offset, int whence) final override;
+
+    // Lists children, for directories that keep their entries there
+    int iterate(DirContext& ctx) override;
+
+    // Directories that do not support removing entries
+    int unlink(const char*) override { return -EPERM; }
+    int rmdir(const char*) override { return -EPERM; }
+    int rename(const char*, Inode*, const char*) override { return -EPERM; }
 };
 
 // ============================================================================
@@ -155,9 +242,14 @@ public:
 kstring getcwd(const Inode* inode);
 void register_mount(const char* path, MountPoint* mp);
 FileDescriptor* open(kstring_view path, int flags);
-void mount(const char* path, FileSystem* fs, const char* source);
+int mount(const char* path, FileSystem* fs, const char* source);
 
 int stat(const kstring& path, Stat* out);
+long transfer(FileDescriptor* in, FileDescriptor* out, std::size_t count);
 int readdir(const kstring& path, kvector<DirEntry>& out);
 int mkdir(const kstring& path, int mode);
+int unlink(const kstring& path);
+int rmdir(const kstring& path);
+int rename(const kstring& old_path, const kstring& new_path);
+int truncate(const kstring& path, std::size_t length);
 }
@@ -2,6 +2,10 @@
 
 #include "fs/fs.hpp"
 #include "lib/fs/initramfs/tar.hpp"
+#include <containers/kstring_view.hpp>
+#include <containers/kvector.hpp>
+#include <exclusive/kspinlock.hpp>
+
 #include <cstddef>
 #include <cstdint>
 
@@ -13,12 +17,18 @@ class InitramfsDirectoryInode;
 
 class InitramfsDirectoryInode final : public DirectoryInode {
 public:
-    explicit InitramfsDirectoryInode(MountPoint* mp);
+    std::size_t entry;      // Index in the mount's path table
+    bool populated = false; // Every child has an inode in children
+
+    InitramfsDirectoryInode(MountPoint* mp, std::size_t entry);
 
     Inode* lookup(const char* name) override;
-    int readdir(kvector<DirEntry>& entries) override;
+    int iterate(DirContext& ctx) override;
     int mkdir(const char* name, int mode) override;
     int create(const char* name, int mode) override;
+    int unlink(const char* name) override;
+    int rmdir(const char* name) override;
+    int rename(const char* name, Inode* new_dir, const char* new_name) override;
     int open(FileDescriptor* fd, int flags) override;
     int close(FileDescriptor* fd) override;
     int stat(Stat* stat) override;
@@ -36,25 +46,52 @@ public:
     int close(FileDescriptor* fd) override;
     int lseek(FileDescriptor* fd, int offset, int whence) override;
     int stat(Stat* stat) override;
+    int read_direct(FileDescriptor* fd, const void** data, std::size_t count) override;
 };
 
+/**
+ * @brief A tar archive in memory, mounted read-only.
+ *
+ * Mounting makes one pass over the tar headers and records each path in a
+ * table with the offset of its header in the archive, sorted so that '/'
+ * comes before every other character. A directory's whole subtree then follows it in the table
+ * and any path is a binary search away. Inodes are only created when a
+ * lookup reaches them, or for all of a directory's children when it is
+ * listed.
+ */
 class InitramfsMountPoint final : public MountPoint {
 private:
+    struct Entry {
+        std::uint64_t key;    // First bytes of the path, compares in path order
+        std::uint32_t path;   // Offset of the path in paths
+        std::uint32_t header; // Offset of the tar header, NO_HEADER if only implied by a path
+        std::uint16_t length; // Path length, without a trailing '/'
+        bool directory;
+    };
+
+    static constexpr std::uint32_t NO_HEADER = UINT32_MAX;
+
     std::uint8_t* tar_buffer;
     std::size_t tar_size;
-    int next_ino = 1;
+    kvector<Entry> entries;
+    kvector<char> paths; // Every path back to back, sorting reads them a lot
+    kspinlock lock; // Inodes are created under it
 
-    bool is_empty_header(tar::TarHeader* header);
-    void parse_tar_headers();
-    void insert_inode(const char* path, Inode* inode);
+    const char* entry_path(const Entry& entry) const;
+    void add_parents(const char* path, std::size_t length, std::uint32_t offset, kstring_view* last_parent);
+    void index();
+    void dedup();
+    Inode* materialise(std::size_t entry, InitramfsDirectoryInode* parent);
 
 public:
-    InitramfsMountPoint(std::uint8_t* buffer, std::size_t size)
-        : tar_buffer{buffer}
-        , tar_size{size}
-    {
-        parse_tar_headers();
-    }
+    static constexpr std::size_t ROOT = SIZE_MAX;
+
+    InitramfsMountPoint(std::uint8_t* buffer, std::size_t size);
+
+    std::size_t size() const { return entries.size(); }
+
+    Inode* lookup(InitramfsDirectoryInode* dir, const char* name);
+    void populate(InitramfsDirectoryInode* dir);
 };
 
 class InitramfsFileSystem final : public FileSystem {
@@ -65,4 +102,10 @@ public:
     MountPoint* mount_from_mem(std::uint8_t* buffer, std::size_t size);
 };
 
+/// @brief mount a boot module, either a plain tar or an LZ4 frame holding one
+///
+/// @return nullptr if a compressed image can not be decoded
+///
+InitramfsMountPoint* load(std::uint8_t* image, std::size_t size);
+
 }
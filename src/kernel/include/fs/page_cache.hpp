@@ -0,0 +1,115 @@
+#pragma once
+
+#include <block/block.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file page_cache.hpp
+ * @brief Pages of block-backed files and devices, cached in memory.
+ *
+ * One cache serves every Mapping: a file's data, a directory's blocks and
+ * the raw sectors of a device that filesystem metadata is read from. Pages
+ * are found through a hash of (mapping, index) and kept on one LRU list,
+ * the least recently used unpinned clean page is evicted once the cache is
+ * over cache.max_mb.
+ *
+ * Each 1 KiB of a page records the device sector it lives at, which the
+ * mapping fills in with map() when the page is read and the filesystem
+ * updates when it allocates blocks. Writeback needs nothing else, so it
+ * never calls back into the filesystem or takes its locks: a kernel thread
+ * writes dirty pages out every cache.writeback_ms, sorted so the block
+ * layer merges neighbouring ones into one transfer.
+ *
+ * A miss reads a window of pages ahead in the same batch of requests. The
+ * window starts small and doubles while a mapping is read sequentially.
+ */
+
+namespace fs::cache {
+
+// The unit a page is mapped and written back in, the smallest ext2 block
+constexpr std::size_t SUBPAGE_SIZE = 1024;
+constexpr std::size_t SUBPAGES = 4;
+
+// Where a subpage with nothing on disk lives, it reads as zeros
+constexpr std::uint64_t HOLE = ~0ULL;
+
+class Mapping;
+
+struct Page {
+    Mapping* mapping; // nullptr once dropped, freed by the last put()
+    std::uint64_t index;
+    std::uint8_t* data;
+    std::uint64_t sector[SUBPAGES]; // First device sector of each subpage, or HOLE
+    std::uint8_t dirty;             // Subpages written since the last writeback
+    bool uptodate;                  // data holds what is on disk
+    bool busy;                      // A read or writeback is in flight
+    std::uint32_t refs;             // Pins, a pinned page is never evicted
+
+    Page* hash_next;
+    Page* lru_prev;  // Towards more recently used
+    Page* lru_next;
+    Page* map_prev;  // The mapping's other pages
+    Page* map_next;
+};
+
+/**
+ * @brief Something cached a page at a time, all on one block device.
+ */
+class Mapping {
+public:
+    block::BlockDevice* dev;
+    std::uint64_t ra_next = 0; // Index a sequential reader asks for next
+    std::uint32_t ra_pages = 0; // Last readahead window
+    std::size_t pages = 0;      // Cached right now
+    Page* page_list = nullptr;
+
+    explicit Mapping(block::BlockDevice* dev);
+    virtual ~Mapping();
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    // Pages with data, readahead stops here
+    virtual std::uint64_t end() = 0;
+
+    // Fill in page->sector before the page is read, 0 or -errno
+    virtual int map(Page* page) = 0;
+};
+
+/**
+ * @brief The sectors of a whole block device, page index i is bytes
+ *        [i * PAGE_SIZE, (i + 1) * PAGE_SIZE).
+ */
+class DeviceMapping final : public Mapping {
+public:
+    explicit DeviceMapping(block::BlockDevice* dev);
+
+    std::uint64_t end() override;
+    int map(Page* page) override;
+};
+
+struct Stats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t readahead; // Pages read in ahead of a miss
+    std::uint64_t evicted;
+    std::uint64_t written;   // Pages written back
+    std::size_t pages;
+    std::size_t dirty;
+};
+
+int get(Mapping* mapping, std::uint64_t index, Page** out);
+Page* grab(Mapping* mapping, std::uint64_t index);
+void put(Page* page);
+
+void mark_dirty(Page* page, std::size_t offset, std::size_t length);
+void discard(Page* page, std::size_t offset, std::size_t length);
+void balance_dirty();
+void truncate(Mapping* mapping, std::uint64_t first);
+int sync(Mapping* mapping = nullptr);
+
+Stats stats();
+void start_writeback();
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <containers/kvector.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+/**
+ * @brief The pages of a file, by page index, in a radix tree.
+ *
+ * Each node has 64 slots, so a tree of height h covers 64^h pages and
+ * finding a page is h steps: 3 levels reach 1 GiB of file. The tree only
+ * grows upwards as the file does, and a page that was never written is a
+ * hole with no page (or nodes) behind it.
+ *
+ * Pages are whole kernel pages from alloc_kernel_page(), zeroed when they
+ * are created.
+ */
+class PageTree final {
+private:
+    static constexpr std::size_t BITS = 6;
+    static constexpr std::size_t SLOTS = 1 << BITS;
+
+    struct Node {
+        void* slots[SLOTS]; // Child nodes, or pages at height 1
+        std::size_t count;  // Slots in use
+    };
+
+    Node* _root = nullptr;
+    std::size_t _height = 0; // 0 while the tree is empty
+    std::size_t _pages = 0;
+
+    std::size_t capacity() const;
+    void grow(std::size_t index);
+    void drop(Node* node, std::size_t height, std::size_t first, kvector<std::uint8_t*>* detached);
+
+public:
+    PageTree() = default;
+    ~PageTree();
+    PageTree(const PageTree&) = delete;
+    PageTree& operator=(const PageTree&) = delete;
+
+    std::uint8_t* find(std::size_t index) const;
+    std::uint8_t* find_or_create(std::size_t index);
+
+    void truncate(std::size_t first, kvector<std::uint8_t*>* detached = nullptr);
+
+    // Pages present, holes not counted
+    std::size_t pages() const { return _pages; }
+};
+
+}
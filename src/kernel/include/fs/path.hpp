@@ -0,0 +1,82 @@
+#pragma once
+
+#include <containers/kstring_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+/// @brief FNV-1a hash of a name, for the dentry cache and directory indexes
+inline std::uint64_t hash_name(kstring_view name)
+{
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (std::size_t i = 0; i < name.length(); i++) {
+        hash = (hash ^ static_cast<std::uint8_t>(name[i])) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Walks the components of a path in place, without allocating.
+ *
+ * Empty components from repeated or trailing slashes are skipped, so
+ * "/a//b/" yields "a" then "b". Each component is a view into the path and
+ * is not NUL terminated.
+ *
+ *     PathIterator it{path};
+ *     kstring_view name{""};
+ *
+ *     while (it.next(&name)) {
+ *         ...
+ *     }
+ */
+class PathIterator final {
+private:
+    kstring_view _path;
+    std::size_t _pos = 0;
+
+public:
+    explicit PathIterator(kstring_view path)
+        : _path{path}
+    {
+    }
+
+    /// @return false once there are no components left
+    bool next(kstring_view* component)
+    {
+        while (_pos < _path.length() && _path[_pos] == '/') {
+            _pos++;
+        }
+
+        if (_pos == _path.length()) {
+            return false;
+        }
+
+        const std::size_t start = _pos;
+
+        while (_pos < _path.length() && _path[_pos] != '/') {
+            _pos++;
+        }
+
+        *component = kstring_view{_path.data() + start, _pos - start};
+
+        return true;
+    }
+
+    /// @return true if no components are left after the current one
+    bool at_end() const
+    {
+        for (std::size_t i = _pos; i < _path.length(); i++) {
+            if (_path[i] != '/') {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+}
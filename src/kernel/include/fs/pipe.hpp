@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * @file pipe.hpp
+ * @brief Anonymous pipes.
+ *
+ * Data goes through a ring of kernel pages: write() copies straight from
+ * the writer's buffer into the ring and read() straight out of it into the
+ * reader's, so nothing is copied more than once on each side.
+ */
+
+#include <arch.hpp>
+#include <exclusive/kspinlock.hpp>
+#include <fs/fs.hpp>
+#include <process/wait_queue.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+// Writes up to this size are never interleaved with another writer's data,
+// POSIX PIPE_BUF (not named that, <climits> may already define it)
+constexpr std::size_t PIPE_ATOMIC_WRITE = 4096;
+
+class PipeInode final : public Inode {
+public:
+    static constexpr std::size_t NUM_PAGES = 16;
+    static constexpr std::size_t CAPACITY = NUM_PAGES * arch::vmm::PAGE_SIZE;
+
+private:
+    kspinlock _lock;
+    process::WaitQueue _readers; // Waiting for data
+    process::WaitQueue _writers; // Waiting for space
+
+    std::uint8_t* _pages[NUM_PAGES];
+
+    // Free running byte counts, the ring holds [_head, _tail)
+    std::size_t _head = 0;
+    std::size_t _tail = 0;
+
+    // Open ends, the pipe frees itself once both reach zero
+    int _num_readers = 1;
+    int _num_writers = 1;
+
+    bool copy_in(std::size_t pos, const std::uint8_t* src, std::size_t count);
+    bool copy_out(std::size_t pos, std::uint8_t* dst, std::size_t count);
+
+public:
+    PipeInode();
+    ~PipeInode() override;
+
+    int open(FileDescriptor* fd, int flags) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor* fd) override;
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+    std::uint32_t poll(FileDescriptor* fd, PollTable* table) override;
+};
+
+int create_pipe(int flags, FileDescriptor** read_end, FileDescriptor** write_end);
+
+}
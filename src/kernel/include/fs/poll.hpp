@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * @file poll.hpp
+ * @brief Readiness notification for poll(), select() and epoll.
+ *
+ * Inode::poll() reports which events a file is ready for and, given a
+ * PollTable, hooks the table onto the wait queues that get woken when that
+ * changes. poll() and select() build a table that wakes the caller, epoll
+ * keeps one per watched file that marks it ready instead.
+ */
+
+#include <process/wait_queue.hpp>
+
+#include <cstdint>
+
+namespace fs {
+
+// Event bits, same values as Linux's POLL* and EPOLL*
+constexpr std::uint32_t POLLIN = 0x001;
+constexpr std::uint32_t POLLPRI = 0x002;
+constexpr std::uint32_t POLLOUT = 0x004;
+constexpr std::uint32_t POLLERR = 0x008;
+constexpr std::uint32_t POLLHUP = 0x010;
+constexpr std::uint32_t POLLNVAL = 0x020;
+constexpr std::uint32_t POLLRDNORM = 0x040;
+constexpr std::uint32_t POLLRDBAND = 0x080;
+constexpr std::uint32_t POLLWRNORM = 0x100;
+constexpr std::uint32_t POLLWRBAND = 0x200;
+
+// Always reported, whether asked for or not
+constexpr std::uint32_t POLL_ALWAYS = POLLERR | POLLHUP | POLLNVAL;
+
+/**
+ * @brief The wait queues one poller is registered on.
+ *
+ * Every entry runs the same wakeup: func with data, or waking the task
+ * that built the table when func is null.
+ */
+class PollTable final {
+private:
+    struct Entry {
+        process::WaitEntry wait;
+        Entry* next;
+    };
+
+    Entry* _entries = nullptr;
+    process::WakeFunc _func;
+    void* _data;
+
+public:
+    PollTable(process::WakeFunc func = nullptr, void* data = nullptr);
+    ~PollTable();
+    PollTable(const PollTable&) = delete;
+    PollTable& operator=(const PollTable&) = delete;
+
+    void wait(process::WaitQueue& queue);
+    void clear();
+};
+
+}
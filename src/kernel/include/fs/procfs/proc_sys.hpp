@@ -0,0 +1,39 @@
+#pragma once
+
+#include <fs/fs.hpp>
+#include <tunable/tunable.hpp>
+
+namespace fs::procfs {
+
+// /proc/sys and one subdirectory per tunable group, e.g. /proc/sys/sched
+class ProcSysDirectoryInode final : public DirectoryInode {
+public:
+    ProcSysDirectoryInode(MountPoint* mp, Inode* parent, int ino, kstring_view name);
+
+    Inode* lookup(const char* name) override;
+    int mkdir(const char*, int) override { return -EPERM; }
+    int create(const char*, int) override { return -EPERM; }
+    int open(FileDescriptor*, int) override { return 0; }
+    int close(FileDescriptor*) override { return 0; }
+    int stat(Stat* stat) override;
+};
+
+// Reads as the tunable's current value, writing a new value applies it
+class ProcTunableInode final : public Inode {
+private:
+    tunable::TunableBase* _tunable;
+
+public:
+    ProcTunableInode(MountPoint* mp, Inode* parent, int ino, kstring_view name, tunable::TunableBase* t);
+
+    int open(FileDescriptor* fd, int flags) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor*) override { return 0; }
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+};
+
+ProcSysDirectoryInode* build_sys_tree(MountPoint* mp, Inode* parent, int* ino);
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <fs/fs.hpp>
+
+namespace fs::procfs {
+
+// Per-syscall call/error counts and latency histograms, one line for each
+// syscall that has been called. Writing anything resets the counters.
+class ProcSyscallsInode final : public Inode {
+public:
+    ProcSyscallsInode(MountPoint* mp, Inode* parent, int ino);
+
+    int open(FileDescriptor* fd, int flags) override;
+    int read(FileDescriptor* fd, void* buf, std::size_t count) override;
+    int write(FileDescriptor* fd, const void* buf, std::size_t count) override;
+    int close(FileDescriptor*) override { return 0; }
+    int lseek(FileDescriptor* fd, int offset, int whence) override;
+    int stat(Stat* stat) override;
+};
+
+}
@@ -2,6 +2,8 @@
 
 #include <fs/fs.hpp>
 #include <fs/procfs/proc_self.hpp>
+#include <fs/procfs/proc_syscalls.hpp>
+#include <fs/procfs/proc_sys.hpp>
 
 namespace fs::procfs {
 
@@ -10,6 +12,8 @@ constexpr int PROCFS_ROOT_INODE = 1;
 class ProcMountPoint final : public MountPoint {
 public:
     ProcSelfInode* self_inode;
+    ProcSysDirectoryInode* sys_inode;
+    ProcSyscallsInode* syscalls_inode;
 
     ProcMountPoint();
 };
@@ -19,7 +23,7 @@ public:
     ProcDirectoryInode(ProcMountPoint* mp, int ino);
 
     Inode* lookup(const char* name) override;
-    int readdir(kvector<DirEntry>& entries) override;
+    int iterate(DirContext& ctx) override;
     int mkdir(const char* name, int mode) override;
     int create(const char* name, int mode) override;
     int open(FileDescriptor* fd, int flags) override;
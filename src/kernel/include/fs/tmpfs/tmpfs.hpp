@@ -1,12 +1,17 @@
 #pragma once
 
 #include "fs/fs.hpp"
+#include "fs/page_tree.hpp"
 
 namespace fs::tmpfs {
 
 class TmpFileInode final : public Inode {
 public:
-    kvector<std::uint8_t> data;
+    PageTree pages;
+    kvector<std::uint8_t*> detached; // Truncated off while mapped, freed at the last unmap
+    int opens = 0;                   // Open fds, an unlinked file is freed at the last close
+    int maps = 0;                    // Shared mappings, which keep the file like an open fd
+    bool unlinked = false;
 
     TmpFileInode(kstring name, Inode* parent);
 
@@ -16,17 +21,27 @@ public:
     int close(FileDescriptor* fd) override;
     int lseek(FileDescriptor* fd, int offset, int whence) override;
     int stat(Stat* stat) override;
+    int read_direct(FileDescriptor* fd, const void** data, std::size_t count) override;
+    int truncate(std::size_t length) override;
+    int map() override;
+    void unmap() override;
+    int map_page(std::size_t index, std::uintptr_t* phys) override;
 };
 
 class TmpDirectoryInode final : public DirectoryInode {
 public:
+    int opens = 0; // Open fds, as for TmpFileInode
+    bool unlinked = false;
+
     TmpDirectoryInode(MountPoint* mp);
     TmpDirectoryInode(kstring name, Inode* parent);
 
     Inode* lookup(const char* name) override;
-    int readdir(kvector<DirEntry>& entries) override;
     int mkdir(const char* name, int mode) override;
     int create(const char* name, int mode) override;
+    int unlink(const char* name) override;
+    int rmdir(const char* name) override;
+    int rename(const char* name, Inode* new_dir, const char* new_name) override;
     int open(FileDescriptor* fd, int flags) override;
     int close(FileDescriptor* fd) override;
     int stat(Stat* stat) override;
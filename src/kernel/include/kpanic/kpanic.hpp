@@ -8,10 +8,14 @@
 [[noreturn]]
 void kpanic_halt();
 
+// Prints log records klogd has not written out yet, so they show up before the panic
+void kpanic_flush_log();
+
 template <typename T, typename... Rest>
 [[noreturn]]
 void kpanicf(kstring_view format, T&& first, Rest&&... rest)
 {
+    kpanic_flush_log();
     kprintln("*** !! KERNEL PANIC !! ***");
     kprintf(format, first, std::forward<Rest>(rest)..., '\n');
     kprintln("System halted.");
@@ -23,6 +27,7 @@ template <typename... Ts>
 [[noreturn]]
 void kpanic(Ts... args)
 {
+    kpanic_flush_log();
     kprintln("*** !! KERNEL PANIC !! ***");
     kprintln(args...);
     kprintln("System halted.");
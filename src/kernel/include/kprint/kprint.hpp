@@ -16,121 +16,153 @@ namespace serial = arch::drivers::serial;
 
 namespace kprint_detail {
 
-inline void print_one(const char* str)
+// Everything printed goes through a sink, which only needs putchar() and
+// puts(). kprint()/kprintf() write straight to the serial port, the logger
+// formats into a log record instead (see log.hpp)
+struct SerialSink {
+    void putchar(char c) { serial::putchar(c); }
+    void puts(kstring_view sv) { serial::puts(sv); }
+    void puts(const char* str) { serial::puts(str); }
+    void puts(const unsigned char* str) { serial::puts(str); }
+};
+
+template <typename Sink>
+inline void print_one(Sink& sink, const char* str)
 {
-    serial::puts(str);
+    sink.puts(str);
 }
 
-inline void print_one(kstring_view sv)
+template <typename Sink>
+inline void print_one(Sink& sink, kstring_view sv)
 {
-    serial::puts(sv);
+    sink.puts(sv);
 }
 
-template <typename T>
-inline void print_one(const klist<T>& list)
+template <typename Sink, typename T>
+inline void print_one(Sink& sink, const klist<T>& list)
 {
-    serial::putchar('[');
-    serial::puts(algo::join(list, ','));
-    serial::putchar(']');
+    sink.putchar('[');
+    sink.puts(algo::join(list, ','));
+    sink.putchar(']');
 }
 
-template <typename T>
-inline void print_one(const kvector<T>& v)
+template <typename Sink, typename T>
+inline void print_one(Sink& sink, const kvector<T>& v)
 {
-    serial::putchar('[');
-    serial::puts(algo::join(v, ','));
-    serial::putchar(']');
+    sink.putchar('[');
+    sink.puts(algo::join(v, ','));
+    sink.putchar(']');
 }
 
-inline void print_one(bool b)
+template <typename Sink>
+inline void print_one(Sink& sink, bool b)
 {
-    serial::puts(b ? "true" : "false");
+    sink.puts(b ? "true" : "false");
 }
 
-inline void print_one(unsigned char* str)
+template <typename Sink>
+inline void print_one(Sink& sink, unsigned char* str)
 {
-    serial::puts(str);
+    sink.puts(str);
 }
 
-inline void print_one(char c)
+template <typename Sink>
+inline void print_one(Sink& sink, char c)
 {
-    serial::putchar(c);
+    sink.putchar(c);
 }
 
-inline void print_one(std::integral auto num)
+template <typename Sink>
+inline void print_one(Sink& sink, std::integral auto num)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(num, buffer));
+    sink.puts(fmt::to_string(num, buffer));
 }
 
-template <std::integral T>
-inline void print_one(fmt::hex<T> h)
+template <typename Sink, std::integral T>
+inline void print_one(Sink& sink, fmt::hex<T> h)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(h, buffer));
+    sink.puts(fmt::to_string(h, buffer));
 }
 
-template <fmt::ptr_type T>
-inline void print_one(fmt::hex<T> h)
+template <typename Sink, fmt::ptr_type T>
+inline void print_one(Sink& sink, fmt::hex<T> h)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(h, buffer));
+    sink.puts(fmt::to_string(h, buffer));
 }
 
-template <std::integral T>
-inline void print_one(fmt::bin<T> b)
+template <typename Sink, std::integral T>
+inline void print_one(Sink& sink, fmt::bin<T> b)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(b, buffer));
+    sink.puts(fmt::to_string(b, buffer));
 }
 
-template <std::integral T>
-inline void print_one(fmt::oct<T> o)
+template <typename Sink, std::integral T>
+inline void print_one(Sink& sink, fmt::oct<T> o)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(o, buffer));
+    sink.puts(fmt::to_string(o, buffer));
 }
 
-inline void print_one(fmt::ptr_type auto ptr)
+template <typename Sink>
+inline void print_one(Sink& sink, fmt::ptr_type auto ptr)
 {
     char buffer[32];
-    serial::puts(fmt::to_string(ptr, buffer));
+    sink.puts(fmt::to_string(ptr, buffer));
 }
 }
 
-template <typename... Args>
-void kprint(Args... args)
+template <typename Sink, typename... Args>
+void kprint_to(Sink& sink, Args... args)
 {
-    (kprint_detail::print_one(args), ...);
+    (kprint_detail::print_one(sink, args), ...);
 }
 
-inline void kprintf(kstring_view format)
+template <typename Sink>
+void kprintf_to(Sink& sink, kstring_view format)
 {
-    serial::puts(format);
+    sink.puts(format);
 }
 
-template <typename T, typename... Rest>
-void kprintf(kstring_view format, T&& first, Rest&&... rest)
+template <typename Sink, typename T, typename... Rest>
+void kprintf_to(Sink& sink, kstring_view format, T&& first, Rest&&... rest)
 {
     const auto pos = format.find("{}");
 
     if (pos != kstring_view::npos) {
-        kprint_detail::print_one(format.substr(0, pos));
-        kprint_detail::print_one(first);
+        kprint_detail::print_one(sink, format.substr(0, pos));
+        kprint_detail::print_one(sink, first);
 
-        kprintf(format.substr(pos + 2), std::forward<Rest>(rest)...);
+        kprintf_to(sink, format.substr(pos + 2), std::forward<Rest>(rest)...);
     } else {
-        kprint_detail::print_one(format);
+        kprint_detail::print_one(sink, format);
     }
 }
 
+template <typename... Args>
+void kprint(Args... args)
+{
+    kprint_detail::SerialSink sink;
+    kprint_to(sink, args...);
+}
+
+template <typename... Args>
+void kprintf(kstring_view format, Args&&... args)
+{
+    kprint_detail::SerialSink sink;
+    kprintf_to(sink, format, std::forward<Args>(args)...);
+}
+
 inline void kprintln()
 {
-    kprint_detail::print_one('\n');
+    kprint('\n');
 }
 
 template <typename... Args>
 void kprintln(Args... args)
 {
-    (kprint_detail::print_one(args), ..., kprintln());
+    kprint(args..., '\n');
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * @file auxv.hpp
+ * @brief Linux auxiliary vector entry types.
+ *
+ * The auxiliary vector follows envp[] on a new program's stack as
+ * (type, value) pairs terminated by AT_NULL.
+ * See: include/uapi/linux/auxvec.h in the Linux source.
+ */
+
+// clang-format off
+
+#include <cstdint>
+
+namespace linux {
+
+constexpr std::uint64_t AT_NULL         = 0;
+constexpr std::uint64_t AT_SYSINFO_EHDR = 33;
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * @file fcntl.hpp
+ * @brief Linux fcntl() commands.
+ *
+ * Values match Linux's include/uapi/asm-generic/fcntl.h and
+ * include/uapi/linux/fcntl.h. The O_* open flags are fs::O_*.
+ */
+
+namespace linux {
+constexpr unsigned int F_DUPFD = 0;
+constexpr unsigned int F_GETFD = 1;
+constexpr unsigned int F_SETFD = 2;
+constexpr unsigned int F_GETFL = 3;
+constexpr unsigned int F_SETFL = 4;
+constexpr unsigned int F_DUPFD_CLOEXEC = 1030;
+
+// The only fd flag, as opposed to the open file's status flags
+constexpr int FD_CLOEXEC = 1;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file io_uring.hpp
+ * @brief Linux io_uring structures and constants.
+ *
+ * Layouts and values match Linux's include/uapi/linux/io_uring.h. Only the
+ * opcodes and flags listed here are supported, see sys_io_uring.cpp.
+ */
+
+#include <cstdint>
+
+namespace linux {
+
+// Submission queue entry, one per queued operation
+struct io_uring_sqe {
+    std::uint8_t opcode;
+    std::uint8_t flags; // IOSQE_*, none are supported yet
+    std::uint16_t ioprio;
+    std::int32_t fd;
+    std::uint64_t off; // File offset, or -1 for the current position
+    std::uint64_t addr; // Buffer or path
+    std::uint32_t len;
+    std::uint32_t op_flags; // rw_flags / fsync_flags / open_flags
+    std::uint64_t user_data; // Copied to the completion untouched
+    std::uint16_t buf_index;
+    std::uint16_t personality;
+    std::uint32_t file_index;
+    std::uint64_t addr3;
+    std::uint64_t pad;
+};
+static_assert(sizeof(io_uring_sqe) == 64);
+
+// Completion queue entry, posted by the kernel when an operation finishes
+struct io_uring_cqe {
+    std::uint64_t user_data;
+    std::int32_t res; // Return value of the operation, or -errno
+    std::uint32_t flags;
+};
+static_assert(sizeof(io_uring_cqe) == 16);
+
+// Byte offsets of the submission ring fields from cq_off.user_addr
+struct io_sqring_offsets {
+    std::uint32_t head;
+    std::uint32_t tail;
+    std::uint32_t ring_mask;
+    std::uint32_t ring_entries;
+    std::uint32_t flags;
+    std::uint32_t dropped;
+    std::uint32_t array;
+    std::uint32_t resv1;
+    std::uint64_t user_addr; // IORING_SETUP_NO_MMAP: the sqe array
+};
+
+// Byte offsets of the completion ring fields from cq_off.user_addr
+struct io_cqring_offsets {
+    std::uint32_t head;
+    std::uint32_t tail;
+    std::uint32_t ring_mask;
+    std::uint32_t ring_entries;
+    std::uint32_t overflow;
+    std::uint32_t cqes;
+    std::uint32_t flags;
+    std::uint32_t resv1;
+    std::uint64_t user_addr; // IORING_SETUP_NO_MMAP: the rings
+};
+
+struct io_uring_params {
+    std::uint32_t sq_entries;
+    std::uint32_t cq_entries;
+    std::uint32_t flags;
+    std::uint32_t sq_thread_cpu;
+    std::uint32_t sq_thread_idle;
+    std::uint32_t features;
+    std::uint32_t wq_fd;
+    std::uint32_t resv[3];
+    io_sqring_offsets sq_off;
+    io_cqring_offsets cq_off;
+};
+static_assert(sizeof(io_uring_params) == 120);
+
+// io_uring_setup() flags
+constexpr std::uint32_t IORING_SETUP_CQSIZE = 1U << 3;
+constexpr std::uint32_t IORING_SETUP_NO_MMAP = 1U << 14;
+
+// io_uring_params.features
+constexpr std::uint32_t IORING_FEAT_SINGLE_MMAP = 1U << 0;
+
+// io_uring_enter() flags
+constexpr std::uint32_t IORING_ENTER_GETEVENTS = 1U << 0;
+
+// Opcodes
+constexpr std::uint8_t IORING_OP_NOP = 0;
+constexpr std::uint8_t IORING_OP_FSYNC = 3;
+constexpr std::uint8_t IORING_OP_OPENAT = 18;
+constexpr std::uint8_t IORING_OP_CLOSE = 19;
+constexpr std::uint8_t IORING_OP_READ = 22;
+constexpr std::uint8_t IORING_OP_WRITE = 23;
+
+constexpr int AT_FDCWD = -100;
+
+}
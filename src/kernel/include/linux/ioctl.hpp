@@ -4,7 +4,8 @@
  * @file ioctl.hpp
  * @brief Linux ioctl constants and struct layouts.
  *
- * Terminal ioctl values match Linux's asm-generic/ioctls.h.
+ * Terminal ioctl values match Linux's asm-generic/ioctls.h, block device
+ * ones include/uapi/linux/fs.h.
  * Struct layouts match Linux's include/uapi/asm-generic/termbits.h.
  */
 
@@ -13,6 +14,10 @@
 namespace linux {
 constexpr unsigned long TIOCGWINSZ = 0x5413;
 
+constexpr unsigned long BLKGETSIZE = 0x1260;       // Size in 512-byte sectors, an unsigned long
+constexpr unsigned long BLKSSZGET = 0x1268;        // Sector size, an int
+constexpr unsigned long BLKGETSIZE64 = 0x80081272; // Size in bytes, a uint64_t
+
 struct winsize {
     std::uint16_t ws_row;
     std::uint16_t ws_col;
@@ -24,4 +29,7 @@ struct iovec {
     void* iov_base;
     std::size_t iov_len;
 };
+
+// Most iovecs one readv()/writev() accepts
+constexpr int UIO_MAXIOV = 1024;
 }
@@ -13,6 +13,7 @@ constexpr int PROT_READ = 0x1;
 constexpr int PROT_WRITE = 0x2;
 constexpr int PROT_EXEC = 0x4;
 
+constexpr int MAP_SHARED = 0x01;
 constexpr int MAP_PRIVATE = 0x02;
 constexpr int MAP_ANONYMOUS = 0x20;
 }
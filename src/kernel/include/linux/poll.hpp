@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * @file poll.hpp
+ * @brief Linux poll(), select() and epoll structures and constants.
+ *
+ * Layouts and values match Linux's include/uapi/asm-generic/poll.h,
+ * include/uapi/linux/eventpoll.h and include/uapi/linux/posix_types.h.
+ * The event bits themselves are fs::POLL*, see fs/poll.hpp.
+ */
+
+#include <cstdint>
+
+namespace linux {
+
+struct pollfd {
+    int fd; // Negative to skip the entry
+    short events;
+    short revents;
+};
+static_assert(sizeof(pollfd) == 8);
+
+constexpr int EPOLL_CTL_ADD = 1;
+constexpr int EPOLL_CTL_DEL = 2;
+constexpr int EPOLL_CTL_MOD = 3;
+
+constexpr int EPOLL_CLOEXEC = 0x80000;
+
+constexpr std::uint32_t EPOLLRDHUP = 0x2000;
+constexpr std::uint32_t EPOLLEXCLUSIVE = 1U << 28;
+constexpr std::uint32_t EPOLLWAKEUP = 1U << 29;
+constexpr std::uint32_t EPOLLONESHOT = 1U << 30; // Disarm after one report
+constexpr std::uint32_t EPOLLET = 1U << 31;      // Report on changes only
+
+// Packed on x86_64 only, to match the 32-bit layout
+struct [[gnu::packed]] epoll_event {
+    std::uint32_t events;
+    std::uint64_t data;
+};
+static_assert(sizeof(epoll_event) == 12);
+
+constexpr int FD_SETSIZE = 1024;
+
+struct fd_set {
+    std::uint64_t bits[FD_SETSIZE / 64];
+};
+
+}
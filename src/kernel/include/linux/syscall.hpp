@@ -20,29 +20,71 @@ constexpr std::uint64_t SYS_OPEN         = 2;
 constexpr std::uint64_t SYS_CLOSE        = 3;
 constexpr std::uint64_t SYS_STAT         = 4;
 constexpr std::uint64_t SYS_FSTAT        = 5;
+constexpr std::uint64_t SYS_POLL         = 7;
 constexpr std::uint64_t SYS_LSEEK        = 8;
 constexpr std::uint64_t SYS_MMAP         = 9;
+constexpr std::uint64_t SYS_MPROTECT     = 10;
 constexpr std::uint64_t SYS_MUNMAP       = 11;
 constexpr std::uint64_t SYS_BRK          = 12;
 constexpr std::uint64_t SYS_IOCTL        = 16;
 constexpr std::uint64_t SYS_READV        = 19;
 constexpr std::uint64_t SYS_WRITEV       = 20;
+constexpr std::uint64_t SYS_PIPE         = 22;
+constexpr std::uint64_t SYS_SELECT       = 23;
+constexpr std::uint64_t SYS_DUP          = 32;
+constexpr std::uint64_t SYS_DUP2         = 33;
 constexpr std::uint64_t SYS_NANOSLEEP    = 35;
 constexpr std::uint64_t SYS_GETPID       = 39;
+constexpr std::uint64_t SYS_SENDFILE     = 40;
+constexpr std::uint64_t SYS_CLONE        = 56;
 constexpr std::uint64_t SYS_FORK         = 57;
 constexpr std::uint64_t SYS_VFORK        = 58;
 constexpr std::uint64_t SYS_EXECVE       = 59;
 constexpr std::uint64_t SYS_EXIT         = 60;
 constexpr std::uint64_t SYS_WAIT4        = 61;
 constexpr std::uint64_t SYS_FNCTL        = 72;
+constexpr std::uint64_t SYS_FSYNC        = 74;
+constexpr std::uint64_t SYS_TRUNCATE     = 76;
+constexpr std::uint64_t SYS_FTRUNCATE    = 77;
+constexpr std::uint64_t SYS_GETDENTS     = 78;
 constexpr std::uint64_t SYS_GETCWD       = 79;
 constexpr std::uint64_t SYS_CHDIR        = 80;
 constexpr std::uint64_t SYS_FCHDIR       = 81;
+constexpr std::uint64_t SYS_RENAME       = 82;
 constexpr std::uint64_t SYS_MKDIR        = 83;
-constexpr std::uint64_t SYS_GETDENTS     = 141;
+constexpr std::uint64_t SYS_RMDIR        = 84;
+constexpr std::uint64_t SYS_UNLINK       = 87;
+constexpr std::uint64_t SYS_GETTIMEOFDAY = 96;
+constexpr std::uint64_t SYS_GETPRIORITY  = 140;
+constexpr std::uint64_t SYS_SETPRIORITY  = 141;
+constexpr std::uint64_t SYS_SCHED_SETPARAM = 142;
+constexpr std::uint64_t SYS_SCHED_GETPARAM = 143;
+constexpr std::uint64_t SYS_SCHED_SETSCHEDULER = 144;
+constexpr std::uint64_t SYS_SCHED_GETSCHEDULER = 145;
+constexpr std::uint64_t SYS_SCHED_GET_PRIORITY_MAX = 146;
+constexpr std::uint64_t SYS_SCHED_GET_PRIORITY_MIN = 147;
 constexpr std::uint64_t SYS_ARCH_PRCTL   = 158;
+constexpr std::uint64_t SYS_SYNC         = 162;
+constexpr std::uint64_t SYS_MOUNT        = 165;
+constexpr std::uint64_t SYS_GETTID       = 186;
+constexpr std::uint64_t SYS_TIME         = 201;
+constexpr std::uint64_t SYS_FUTEX        = 202;
+constexpr std::uint64_t SYS_EPOLL_CREATE = 213;
 constexpr std::uint64_t SYS_GETDENTS64   = 217;
 constexpr std::uint64_t SYS_SET_TID_ADDR = 218;
+constexpr std::uint64_t SYS_CLOCK_SETTIME = 227;
+constexpr std::uint64_t SYS_CLOCK_GETTIME = 228;
 constexpr std::uint64_t SYS_EXIT_GROUP   = 231;
+constexpr std::uint64_t SYS_EPOLL_WAIT   = 232;
+constexpr std::uint64_t SYS_EPOLL_CTL    = 233;
+constexpr std::uint64_t SYS_PPOLL        = 271;
+constexpr std::uint64_t SYS_SPLICE       = 275;
+constexpr std::uint64_t SYS_EPOLL_PWAIT  = 281;
+constexpr std::uint64_t SYS_EPOLL_CREATE1 = 291;
+constexpr std::uint64_t SYS_DUP3         = 292;
+constexpr std::uint64_t SYS_PIPE2        = 293;
+constexpr std::uint64_t SYS_COPY_FILE_RANGE = 326;
+constexpr std::uint64_t SYS_IO_URING_SETUP = 425;
+constexpr std::uint64_t SYS_IO_URING_ENTER = 426;
 
 }
@@ -4,103 +4,202 @@
 #include <containers/kstring_view.hpp>
 #include <kprint/kprint.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <utility>
 
+// Messages below this level are compiled out entirely, set with
+// KERNEL_LOG_LEVEL in CMakeLists.txt (0 = debug ... 4 = error)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
 namespace log {
 
-inline void print_timestamp()
+enum class Level : std::uint8_t {
+    DEBUG = 0,
+    INFO = 1,
+    SUCCESS = 2,
+    WARN = 3,
+    ERROR = 4
+};
+
+// Each subsystem has its own runtime level, so e.g. syscall tracing can be
+// turned on with `log.syscall=debug` without drowning in everything else
+enum class Subsystem : std::uint8_t {
+    KERNEL = 0,
+    MEMORY,
+    SCHED,
+    PROCESS,
+    SYSCALL,
+    FS,
+    DRIVER,
+    COUNT
+};
+
+constexpr std::size_t NUM_SUBSYSTEMS = static_cast<std::size_t>(Subsystem::COUNT);
+
+// Runtime minimum level of each subsystem, see log.cpp
+extern Level g_levels[NUM_SUBSYSTEMS];
+
+void init();
+void start_klogd();
+void flush();
+
+const char* level_name(Level level);
+const char* subsystem_name(Subsystem subsystem);
+
+bool parse_level(kstring_view str, Level* level);
+void set_level(Subsystem subsystem, Level level);
+Level get_level(Subsystem subsystem);
+
+// Copy formatted records out of the /dev/kmsg buffer, see log.cpp
+std::size_t read_kmsg(std::uint64_t* offset, char* buf, std::size_t size);
+
+template <Level L, Subsystem S>
+inline bool enabled()
 {
-    const auto ns = arch::drivers::tsc::get_time_us();
-    kprint("[t=", ns, "us] ");
+    if constexpr (static_cast<int>(L) < LOG_COMPILE_LEVEL) {
+        return false;
+    } else {
+        return L >= g_levels[static_cast<std::size_t>(S)];
+    }
 }
 
-template <typename... Ts>
-void info(Ts... args)
+namespace detail {
+
+// Formats a message straight into a reserved ring buffer slot, anything
+// past the end of the slot is dropped
+struct RecordSink {
+    char* text;
+    std::size_t capacity;
+    std::size_t length;
+    void* slot;
+    std::uint64_t seq;
+
+    void putchar(char c)
+    {
+        if (length < capacity) {
+            text[length++] = c;
+        }
+    }
+
+    void puts(kstring_view sv)
+    {
+        for (std::size_t i = 0; i < sv.length(); i++) {
+            putchar(sv[i]);
+        }
+    }
+
+    void puts(const char* str)
+    {
+        while (*str) {
+            putchar(*str++);
+        }
+    }
+
+    void puts(const unsigned char* str) { puts(reinterpret_cast<const char*>(str)); }
+};
+
+RecordSink begin_record(Level level, Subsystem subsystem);
+void commit_record(RecordSink& sink);
+
+// Formatting is kept out of line, a call site only pays for the level test
+// and a call. The format stays a plain C string and the arguments stay
+// references up to here, so a disabled level runs no strlen() and copies no
+// kstring. Arguments arrive decayed, every string literal length does not
+// get its own copy
+template <Level L, Subsystem S, typename... Ts>
+[[gnu::noinline]] void emit(const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<INFO> ", args...);
+    RecordSink sink = begin_record(L, S);
+    kprint_to(sink, args...);
+    commit_record(sink);
 }
 
-inline void infof(kstring_view format)
+template <Level L, Subsystem S, typename... Ts>
+[[gnu::noinline]] void emitf(const char* format, const Ts&... args)
 {
-    print_timestamp();
-    kprint("<INFO> ");
-    kprintln(format);
+    RecordSink sink = begin_record(L, S);
+    kprintf_to(sink, kstring_view{format}, args...);
+    commit_record(sink);
+}
+
 }
 
-template <typename T, typename... Rest>
-void infof(kstring_view format, T first, Rest... rest)
+template <Level L, Subsystem S, typename... Ts>
+[[gnu::always_inline]] inline void write(const Ts&... args)
 {
-    print_timestamp();
-    kprint("<INFO> ");
-    kprintf(format, first, rest...);
-    kprintln();
+    if (enabled<L, S>()) {
+        detail::emit<L, S, std::decay_t<const Ts>...>(args...);
+    }
 }
 
-inline void init_start(const char* str)
+template <Level L, Subsystem S, typename... Ts>
+[[gnu::always_inline]] inline void writef(const char* format, const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<INFO> ", str, " initializing...");
+    if (enabled<L, S>()) {
+        detail::emitf<L, S, std::decay_t<const Ts>...>(format, args...);
+    }
 }
 
-inline void init_end(const char* str)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void info(const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<INFO> ", str, " initialized!");
+    write<Level::INFO, S>(args...);
 }
 
-template <typename... Ts>
-void warn(Ts... args)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void infof(const char* format, const Ts&... args)
+{
+    writef<Level::INFO, S>(format, args...);
+}
+
+inline void init_start(const char* str)
+{
+    info(str, " initializing...");
+}
+
+inline void init_end(const char* str)
 {
-    print_timestamp();
-    kprintln("<WARN> ", args...);
+    info(str, " initialized!");
 }
 
-template <typename... Ts>
-void error(Ts... args)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void warn(const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<ERROR> ", args...);
+    write<Level::WARN, S>(args...);
 }
 
-template <typename T, typename... Rest>
-void errorf(kstring_view format, T&& first, Rest&&... rest)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void error(const Ts&... args)
 {
-    print_timestamp();
-    kprint("<ERROR> ");
-    kprintf(format, first, std::forward<Rest>(rest)...);
-    kprintln();
+    write<Level::ERROR, S>(args...);
 }
 
-template <typename... Ts>
-void success(Ts... args)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void errorf(const char* format, const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<SUCCESS> ", args...);
+    writef<Level::ERROR, S>(format, args...);
 }
 
-template <typename... Ts>
-void debug(Ts... args)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void success(const Ts&... args)
 {
-    print_timestamp();
-    kprintln("<DEBUG> ", args...);
+    write<Level::SUCCESS, S>(args...);
 }
 
-inline void debugf(kstring_view format)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void debug(const Ts&... args)
 {
-    print_timestamp();
-    kprint("<DEBUG> ");
-    kprint(format);
-    kprintln();
+    write<Level::DEBUG, S>(args...);
 }
 
-template <typename T, typename... Rest>
-void debugf(kstring_view format, T first, Rest... rest)
+template <Subsystem S = Subsystem::KERNEL, typename... Ts>
+[[gnu::always_inline]] inline void debugf(const char* format, const Ts&... args)
 {
-    print_timestamp();
-    kprint("<DEBUG> ");
-    kprintf(format, first, rest...);
-    kprintln();
+    writef<Level::DEBUG, S>(format, args...);
 }
 
 }
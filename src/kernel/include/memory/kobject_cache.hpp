@@ -0,0 +1,90 @@
+#pragma once
+
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <memory/memory.hpp>
+
+#include <cstddef>
+
+// Keeps up to `Capacity` freed blocks of `Size` bytes around so that objects
+// which are constantly created and destroyed (processes, kernel stacks) skip
+// kmalloc/kfree and the page table work behind large allocations.
+//
+// Free blocks form an intrusive singly linked list: the first 8 bytes of each
+// cached block point at the next one. Once the cache is full, free() hands
+// blocks back to kfree() so memory is never held hostage.
+template <std::size_t Size, std::size_t Capacity>
+class kobject_cache final {
+private:
+    static_assert(Size >= sizeof(void*), "cached blocks must fit a free list pointer");
+
+    struct free_block {
+        free_block* next;
+    };
+
+    kspinlock_irqsave _lock;
+
+    free_block* _head;
+
+    std::size_t _count;
+
+public:
+    kobject_cache()
+        : _head{nullptr}
+        , _count{0}
+    {
+    }
+
+    ~kobject_cache()
+    {
+        while (_head != nullptr) {
+            free_block* next = _head->next;
+            kfree(_head);
+            _head = next;
+        }
+    }
+
+    kobject_cache(const kobject_cache&) = delete;
+    kobject_cache(kobject_cache&&) = delete;
+    kobject_cache& operator=(const kobject_cache&) = delete;
+    kobject_cache& operator=(kobject_cache&&) = delete;
+
+    std::size_t cached() const { return _count; }
+
+    void* alloc()
+    {
+        _lock.lock();
+
+        free_block* block = _head;
+
+        if (block != nullptr) {
+            _head = block->next;
+            _count--;
+        }
+
+        _lock.unlock();
+
+        return block != nullptr ? block : kmalloc(Size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr == nullptr) {
+            return;
+        }
+
+        _lock.lock();
+
+        if (_count < Capacity) {
+            auto* block = static_cast<free_block*>(ptr);
+
+            block->next = _head;
+            _head = block;
+            _count++;
+            ptr = nullptr;
+        }
+
+        _lock.unlock();
+
+        kfree(ptr);
+    }
+};
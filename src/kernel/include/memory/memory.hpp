@@ -2,7 +2,9 @@
 
 #include <cstddef>
 
+#ifndef __user
 #define __user
+#endif
 
 // Allocates n bytes of memory
 void* kmalloc(std::size_t n);
@@ -16,8 +18,9 @@ T* kalloc(std::size_t num)
 
 void kfree(void* ptr);
 
-// Copy size bytes from kernel src into user-space dst. Panics if dst is not a user address.
-void kcopy_to_user(void* __user dst, const void* src, std::size_t size);
+// Copy size bytes from kernel src into user-space dst. Returns 0, or -EFAULT
+// if dst is not a user address or not mapped (see arch/x64/memory/uaccess.hpp)
+int kcopy_to_user(void* __user dst, const void* src, std::size_t size);
 
-// Copy size bytes from user-space src into kernel dst. Panics if src is not a user address.
-void kcopy_from_user(void* dst, const void* __user src, std::size_t size);
+// Copy size bytes from user-space src into kernel dst. Returns 0 or -EFAULT
+int kcopy_from_user(void* dst, const void* __user src, std::size_t size);
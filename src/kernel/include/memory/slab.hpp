@@ -28,6 +28,7 @@ struct SizeClass {
     std::size_t num_slabs;        // Total number of slabs in the linked list
     Slab* first_slab;             // Pointer to first slab in the slab linked list
     std::uint8_t chunks_per_slab; // Number of chunks per slab (constant for this size class)
+    std::size_t num_empty_slabs;  // Slabs with every chunk free
 };
 
 bool can_alloc(std::size_t bytes);
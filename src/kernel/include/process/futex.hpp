@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory/memory.hpp>
+#include <process/process.hpp>
+
+#include <cstdint>
+
+namespace process::futex {
+
+// Passed as timeout_ms to wait() to block until woken
+constexpr std::uint64_t NO_TIMEOUT = ~0ull;
+
+// Identifies a futex word. Private futexes (the common case, only shared by
+// threads of one process) are keyed by address space and virtual address,
+// shared ones by the physical page so that every mapping of the page agrees.
+struct Key {
+    std::uintptr_t base;
+    std::uintptr_t offset;
+
+    bool operator==(const Key& other) const { return base == other.base && offset == other.offset; }
+};
+
+// Lives on the kernel stack of a task blocked in wait()
+struct Waiter {
+    Process* process;
+    Key key;
+    bool woken;
+};
+
+int wait(std::uint32_t* __user uaddr, std::uint32_t expected, bool is_private, std::uint64_t timeout_ms);
+int wake(std::uint32_t* __user uaddr, int count, bool is_private);
+int requeue(std::uint32_t* __user uaddr,
+            std::uint32_t* __user uaddr2,
+            int wake_count,
+            int requeue_count,
+            bool is_private,
+            const std::uint32_t* expected);
+
+void cancel(Process* p);
+
+}
@@ -1,14 +1,23 @@
 #pragma once
 
 #include <arch.hpp>
+#include <containers/krbtree.hpp>
+#include <containers/kstring.hpp>
 #include <containers/kvector.hpp>
+#include <exclusive/katomic.hpp>
+#include <exclusive/kspinlock.hpp>
 #include <fs/fs.hpp>
+#include <process/wait_queue.hpp>
 
 #include <cstddef>
 #include <cstdint>
 
 namespace process {
 
+namespace futex {
+struct Waiter;
+}
+
 enum class ProcessState : std::uint8_t {
     NEW = 0,
     RUNNING = 1,
@@ -24,16 +33,99 @@ enum class WaitReason : std::uint8_t {
     KEYBOARD = 1,
     SLEEP = 2,
     FRAMEBUFFER = 3,
-    CHILD_PROCESS = 4
+    CHILD_PROCESS = 4,
+    REAPER = 5,
+    FUTEX = 6,
+    WAIT_QUEUE = 7,
+    GROUP_EXIT = 8
+};
+
+// Matches the Linux SCHED_OTHER/SCHED_FIFO/SCHED_RR policy numbers
+enum class SchedPolicy : std::uint8_t {
+    NORMAL = 0,
+    FIFO = 1,
+    RR = 2
+};
+
+// A MAP_SHARED mapping of a file. The frames belong to the file and are
+// mapped PAGE_SHARED, the mapping holds a reference on the inode instead
+// (Inode::map()) until it is unmapped or the address space is freed
+struct FileMapping {
+    std::uintptr_t start;
+    std::size_t pages;
+    fs::Inode* inode;
+};
+
+// Memory shared by every thread of a process (CLONE_VM). Each Process holds
+// one reference, the page tables are freed when the last thread is gone.
+struct AddressSpace final {
+    katomic<int> refs;
+
+    arch::vmm::PML4E* pml4;
+    std::uintptr_t heap_break;
+    std::uintptr_t mmap_min_addr;
+
+    arch::vmm::Heap uheap;
+
+    kspinlock maps_lock;
+    kvector<FileMapping> file_maps;
+
+    AddressSpace(arch::vmm::PML4E* pml4);
+
+    AddressSpace* clone();
+
+    void get();
+    void put();
+};
+
+// Open files and working directory shared by every thread of a process
+// (CLONE_FILES/CLONE_FS). Descriptors are closed when the last thread is gone.
+struct FileTable final {
+    katomic<int> refs;
+
+    kvector<fs::FileDescriptor*> fds;
+
+    // The working directory, kept open so it outlives an rmdir like any
+    // other open directory. nullptr is the root
+    fs::FileDescriptor* cwd;
+
+    // FD_CLOEXEC of each fd, a property of the fd number rather than of the
+    // open file it shares with dup()s. Sized for syscall::MAX_FDS
+    std::uint64_t cloexec[16];
+
+    FileTable();
+
+    FileTable* clone() const;
+
+    fs::Inode* cwd_inode() const;
+    void set_cwd(fs::FileDescriptor* desc);
+
+    bool is_cloexec(int fd) const;
+    void set_cloexec(int fd, bool on);
+    void close_on_exec();
+
+    void get();
+    void put();
 };
 
+// Subset of the Linux clone() flags that are understood, others are ignored
+constexpr std::uint64_t CLONE_VM = 0x00000100;
+constexpr std::uint64_t CLONE_FS = 0x00000200;
+constexpr std::uint64_t CLONE_FILES = 0x00000400;
+constexpr std::uint64_t CLONE_THREAD = 0x00010000;
+constexpr std::uint64_t CLONE_SETTLS = 0x00080000;
+constexpr std::uint64_t CLONE_PARENT_SETTID = 0x00100000;
+constexpr std::uint64_t CLONE_CHILD_CLEARTID = 0x00200000;
+constexpr std::uint64_t CLONE_CHILD_SETTID = 0x01000000;
+
 struct Process {
 private:
     void terminate();
 
 public:
     // Process meta info
-    int pid;
+    int pid;  // Unique per task, this is the tid of a thread
+    int tgid; // pid of the thread group leader, what getpid() returns
     Process* parent;
     ProcessState state;
     WaitReason wait_reason;
@@ -42,14 +134,21 @@ public:
     std::uint64_t context_switches;
     std::uint64_t wake_time_ms;
 
-    fs::Inode* cwd_inode;
+    // Fair scheduling state, see FairScheduler.cpp
+    int nice = 0;
+    std::uint64_t vruntime = 0;
+    std::uint64_t exec_start_ns = 0;
+    std::uint64_t slice_start_ns = 0;
+    std::uint64_t sum_exec_runtime_ns = 0;
+    krbnode<Process> run_node;
 
-    // Address space
-    arch::vmm::PML4E* pml4;
-    std::uintptr_t heap_break;
-    std::uintptr_t mmap_min_addr;
+    // Real-time scheduling state, see Scheduler::pick_next()
+    SchedPolicy policy = SchedPolicy::NORMAL;
+    int rt_priority = 0;
+    std::uint64_t rt_slice_left_ns = 0;
 
-    arch::vmm::Heap uheap;
+    AddressSpace* mm;
+    FileTable* files;
 
     std::uint8_t* kernel_stack;      // Base of kernel stack
     std::uintptr_t kernel_rsp;       // Top of stack (initially)
@@ -58,16 +157,31 @@ public:
     arch::context::ContextFrame* context_frame;
     arch::trap::SyscallFrame* syscall_frame;
 
-    kvector<fs::FileDescriptor*> fd_table;
-
     std::uintptr_t entry;
 
     std::uint64_t fs_base; // For thread local storage (TLS)
-    int* tidptr;
+    void* fpu_state;       // x87/SSE/AVX registers, loaded lazily (null for kthreads)
+    int* tidptr;           // Zeroed (and woken) on exit, see CLONE_CHILD_CLEARTID
+
+    // Futex wait state, see futex.cpp
+    futex::Waiter* futex_waiter; // Set while queued in a futex bucket
+    bool wake_pending;           // A wakeup arrived before the task blocked
+
+    WaitEntry wait_entry;      // Queued on a WaitQueue between prepare() and sleep()
+    fs::PollTable* poll_table; // Queues a poll() in progress is registered on
+
+    // Group exit, see Scheduler::kill_other_threads(). The task unwinds and
+    // exits with exit_status on its next way back to user mode
+    bool kill_pending = false;
+    bool killable = false; // The current block ends early for a kill
 
     Process() = default;
     virtual ~Process();
 
+    // Processes are recycled through a cache instead of kmalloc/kfree
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
     Process(const Process&) = delete;
     Process(Process&&) = delete;
 
@@ -75,6 +189,7 @@ public:
     Process& operator=(Process&&) = delete;
 
     Process* fork(arch::trap::SyscallFrame* parent_frame);
+    Process* clone(arch::trap::SyscallFrame* parent_frame, std::uint64_t flags, std::uintptr_t stack, std::uintptr_t tls);
 
     const char* get_state_str() const;
 
@@ -85,6 +200,8 @@ public:
     bool is_zombie() const;
     bool is_dead() const;
     bool is_blocked() const;
+    bool is_realtime() const;
+    bool is_thread() const;
     bool is_waiting_for(WaitReason reason) const;
     bool is_waiting_for_child(int pid) const;
 
@@ -98,9 +215,9 @@ public:
     void zombify();
     void wait_for(WaitReason reason);
     void wait_for_child(int child_pid);
-    void sleep_until(std::uint64_t wake_time_ms);
 
-    void exec_elf64(std::uint8_t* buffer, std::size_t size, char* const argv[], char* const envp[]);
+    // argv and envp were already copied in from user memory by sys_execve()
+    void exec_elf64(std::uint8_t* buffer, std::size_t size, const kvector<kstring>& argv, const kvector<kstring>& envp);
 };
 
 struct KThread final : public Process {
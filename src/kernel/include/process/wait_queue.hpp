@@ -0,0 +1,87 @@
+#pragma once
+
+#include <exclusive/kspinlock_irqsave.hpp>
+
+#include <cstdint>
+
+namespace process {
+
+struct Process;
+struct WaitEntry;
+class WaitQueue;
+
+using WakeFunc = void (*)(WaitEntry* entry);
+
+/**
+ * @brief One waiter on one WaitQueue.
+ *
+ * Linked into the queue directly, so queueing never allocates and can be
+ * undone from anywhere. A plain entry wakes its task and leaves the queue.
+ * An entry with a func has that called instead and stays queued until it
+ * is removed, which is how poll() and epoll watch many queues at once.
+ */
+struct WaitEntry {
+    Process* process = nullptr;
+    WakeFunc func = nullptr;
+    void* data = nullptr;
+
+    WaitQueue* queue = nullptr; // Set while queued
+    WaitEntry* prev = nullptr;
+    WaitEntry* next = nullptr;
+};
+
+/**
+ * @brief Tasks sleeping until some condition becomes true.
+ *
+ * The condition is protected by the owner's own lock, a sleeper queues
+ * itself before dropping that lock so a wakeup can never be missed:
+ *
+ *     lock.lock();
+ *     while (!condition) {
+ *         queue.prepare();
+ *         lock.unlock();
+ *         queue.sleep();
+ *         lock.lock();
+ *     }
+ *
+ * and a waker makes the condition true under the same lock, then calls
+ * wake_one() or wake_all(). A wakeup that lands between prepare() and
+ * sleep() is remembered in Process::wake_pending. A condition set from an
+ * IRQ, with no lock to hold, is checked after prepare() instead, and
+ * finish() backs out when it is already true.
+ *
+ * Waits on user space, which may never end, use the killable sleeps and
+ * leave the loop with -EINTR when the thread group is killed.
+ */
+class WaitQueue final {
+private:
+    kspinlock_irqsave _lock; // Only guards the list, wakers may run in IRQs
+    WaitEntry* _head = nullptr;
+    WaitEntry* _tail = nullptr;
+
+    void link(WaitEntry* entry);
+    void unlink(WaitEntry* entry);
+
+public:
+    WaitQueue() = default;
+    WaitQueue(const WaitQueue&) = delete;
+    WaitQueue& operator=(const WaitQueue&) = delete;
+
+    void prepare();
+    void sleep();
+    void sleep_timeout(std::uint64_t timeout_ms);
+    int sleep_killable();
+    int sleep_killable_timeout(std::uint64_t timeout_ms);
+    void finish();
+
+    void add(WaitEntry* entry);
+    static void remove(WaitEntry* entry);
+
+    void wake_one();
+    void wake_all();
+
+    // Drop a task killed while asleep, see Process::terminate()
+    static void cancel(Process* p);
+};
+
+}
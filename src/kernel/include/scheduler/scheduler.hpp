@@ -2,23 +2,76 @@
 
 #include "exclusive/kspinlock_irqsave.hpp"
 #include <containers/klist.hpp>
+#include <containers/krbtree.hpp>
 #include <process/process.hpp>
 
 #include <cstdint>
 
 namespace scheduler {
 
+constexpr int RT_PRIORITY_MIN = 1;
+constexpr int RT_PRIORITY_MAX = 99;
+
+// READY SCHED_FIFO/SCHED_RR processes, one FIFO queue per priority level
+class RealtimeRunQueue final {
+private:
+    static constexpr int NUM_PRIORITIES = RT_PRIORITY_MAX + 1;
+
+    klist<process::Process*> _queues[NUM_PRIORITIES];
+
+    // bit n is set when _queues[n] is non-empty, so the highest queued
+    // priority is found with a single count-leading-zeros
+    std::uint64_t _bitmap[2];
+
+    std::size_t _size;
+
+public:
+    RealtimeRunQueue();
+
+    bool empty() const { return _size == 0; }
+    std::size_t size() const { return _size; }
+
+    void enqueue(process::Process* p, bool at_head);
+    bool dequeue(process::Process* p);
+
+    process::Process* first() const;
+};
+
 class Scheduler {
 private:
-    static constexpr std::uint64_t REAP_INTERVAL_MS = 100;
+    RealtimeRunQueue _rt_queue;
+
+    // DEAD processes waiting to be freed, and the kthread that frees them
+    klist<process::Process*> _reap_list;
+    process::Process* _reaper;
+
+    std::uint64_t _rt_period_start_ns;
+    std::uint64_t _rt_period_runtime_ns;
+    bool _rt_throttled;
+
+    void release(process::Process* p);
+    void thread_exited(process::Process* thread);
+    bool has_live_threads(const process::Process* leader) const;
+    int block_current(process::WaitReason reason, std::uint64_t wake_time_ms, bool killable);
+
+    void account_realtime(process::Process* current, std::uint64_t now_ns);
+    bool realtime_throttled(std::uint64_t now_ns);
+    bool realtime_should_yield(process::Process* current, process::Process* waiting) const;
 
 protected:
     kspinlock_irqsave _processes_lock;
 
     klist<process::Process*> _processes;
 
+    void make_ready(process::Process* p);
+    void enqueue(process::Process* p, bool wakeup);
+    void remove_from_queue(process::Process* p);
+
+    process::Process* find_process(int pid);
+    process::Process* pick_next();
+
 public:
-    Scheduler() = default;
+    Scheduler();
     virtual ~Scheduler() = default;
 
     Scheduler(Scheduler&) = delete;
@@ -28,18 +81,34 @@ public:
     Scheduler& operator=(Scheduler&&) = delete;
 
     virtual process::Process* next_ready_process() = 0;
-    virtual process::Process* find_child(process::Process* parent, int pid) = 0;
+    virtual process::Process* find_child(process::Process* parent, int pid);
+
+    bool is_waitable(const process::Process* p) const;
 
     virtual void add_process(process::Process* p) = 0;
+    virtual void enqueue_ready(process::Process* p, bool wakeup) = 0;
+    virtual void dequeue(process::Process* p) = 0;
+
+    virtual const char* name() const = 0;
+
+    bool get_nice(int pid, int* nice);
+    bool set_nice(int pid, int nice);
+
+    int get_policy(int pid, process::SchedPolicy* policy, int* rt_priority);
+    int kill_other_threads(process::Process* self, int exit_status);
+    int wait_other_threads(process::Process* self);
+    int set_policy(int pid, process::SchedPolicy policy, int rt_priority);
 
     void wake_single(process::WaitReason reason);
     void wake_all(process::WaitReason reason);
     void wake_parents(int pid);
     void wake_sleepers();
+    void wake_process(process::Process* p, process::WaitReason reason);
 
     void activate_process(process::Process* p);
     void preempt();
     void reap();
+    void start_reaper();
 
     [[noreturn]]
     void yield_dead();
@@ -52,6 +121,9 @@ public:
 
     void yield_sleep(std::uint64_t sleep_time_ms);
     void yield_blocked(process::WaitReason reason);
+    void yield_blocked_timeout(process::WaitReason reason, std::uint64_t timeout_ms);
+    int yield_killable(process::WaitReason reason);
+    int yield_killable_timeout(process::WaitReason reason, std::uint64_t timeout_ms);
 
     int yield_to_child(int child_pid);
 };
@@ -64,15 +136,56 @@ public:
     virtual ~RoundRobinScheduler() = default;
 
     process::Process* next_ready_process() override;
-    process::Process* find_child(process::Process* parent, int pid) override;
 
     void add_process(process::Process* p) override;
+    void enqueue_ready(process::Process* p, bool wakeup) override;
+    void dequeue(process::Process* p) override;
+
+    const char* name() const override { return "Round Robin"; }
+};
+
+struct VruntimeLess {
+    bool operator()(const process::Process& a, const process::Process& b) const
+    {
+        return static_cast<std::int64_t>(a.vruntime - b.vruntime) < 0;
+    }
+};
+
+class FairScheduler final : public Scheduler {
+private:
+    krbtree<process::Process, &process::Process::run_node, VruntimeLess> _runqueue;
+
+    std::uint64_t _min_vruntime;
+    std::uint64_t _queued_weight;
+
+    void update_current(process::Process* current, std::uint64_t now_ns);
+    void update_min_vruntime(process::Process* current);
+
+    std::uint64_t ideal_slice(const process::Process* p) const;
+    bool should_preempt(const process::Process* current) const;
+
+protected:
+public:
+    FairScheduler();
+    virtual ~FairScheduler() = default;
+
+    process::Process* next_ready_process() override;
+
+    void add_process(process::Process* p) override;
+    void enqueue_ready(process::Process* p, bool wakeup) override;
+    void dequeue(process::Process* p) override;
+
+    const char* name() const override { return "Completely Fair"; }
 };
 
+std::uint32_t nice_to_weight(int nice);
+
 Scheduler* get_scheduler();
 
 void init();
 
 void tick();
 
+void preempt_if_needed();
+
 }
@@ -3,22 +3,61 @@
 #include <containers/kvector.hpp>
 #include <fs/fs.hpp>
 #include <linux/ioctl.hpp>
+#include <memory/memory.hpp>
 
 namespace syscall {
+// Highest fd number plus one, the RLIMIT_NOFILE Linux starts processes with
+constexpr int MAX_FDS = 1024;
+
+// Lookup and allocation in the current process's fd table, for syscalls
+// outside sys_fd.cpp that hand out or consume fds
+fs::FileDescriptor* get_fd(int fd);
+int install_fd(fs::FileDescriptor* desc, int flags = 0, int min = 0);
+
 int sys_open(const char* path, int flags);
 int sys_read(int fd, void* buffer, std::size_t count);
 int sys_write(int fd, const void* buffer, std::size_t count);
-int sys_readv(int fd, const linux::iovec* iov, int iovcnt);
-int sys_writev(int fd, const linux::iovec* iov, int iovcnt);
+int sys_readv(int fd, const linux::iovec* __user iov, int iovcnt);
+int sys_writev(int fd, const linux::iovec* __user iov, int iovcnt);
 int sys_ioctl(int fd, unsigned long request, void* arg = nullptr);
 int sys_close(int fd);
-int sys_stat(const char* path, fs::Stat* stat);
-int sys_fstat(int fd, fs::Stat* stat);
+int sys_stat(const char* __user path, fs::Stat* __user stat);
+int sys_fstat(int fd, fs::Stat* __user stat);
 int sys_lseek(int fd, std::size_t offset, int whence);
 long sys_getcwd(char* buffer, std::size_t size);
 int sys_chdir(const char* buffer);
 int sys_fchdir(int fd);
-int sys_mkdir(const char* path, int mode);
+int sys_mkdir(const char* __user path, int mode);
+int sys_unlink(const char* __user path);
+int sys_rmdir(const char* __user path);
+int sys_rename(const char* __user old_path, const char* __user new_path);
+int sys_truncate(const char* __user path, long length);
+int sys_ftruncate(int fd, long length);
 int sys_fcntl(int fd, unsigned int cmd, unsigned long arg);
-int sys_getdents64(int fd, void* buffer, unsigned int count);
+int sys_fsync(int fd);
+int sys_sync();
+int sys_mount(const char* __user source,
+              const char* __user target,
+              const char* __user fstype,
+              unsigned long flags,
+              const void* __user data);
+int sys_getdents64(int fd, void* __user buffer, unsigned int count);
+int sys_pipe(int* __user fds);
+int sys_pipe2(int* __user fds, int flags);
+int sys_dup(int oldfd);
+int sys_dup2(int oldfd, int newfd);
+int sys_dup3(int oldfd, int newfd, int flags);
+long sys_sendfile(int out_fd, int in_fd, std::int64_t* __user offset, std::size_t count);
+long sys_splice(int fd_in,
+                std::int64_t* __user off_in,
+                int fd_out,
+                std::int64_t* __user off_out,
+                std::size_t len,
+                unsigned int flags);
+long sys_copy_file_range(int fd_in,
+                         std::int64_t* __user off_in,
+                         int fd_out,
+                         std::int64_t* __user off_out,
+                         std::size_t len,
+                         unsigned int flags);
 }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory/memory.hpp>
+
+#include <cstdint>
+
+namespace syscall {
+constexpr int FUTEX_WAIT = 0;
+constexpr int FUTEX_WAKE = 1;
+constexpr int FUTEX_REQUEUE = 3;
+constexpr int FUTEX_CMP_REQUEUE = 4;
+
+constexpr int FUTEX_PRIVATE_FLAG = 128;
+
+struct futex_timespec {
+    long tv_sec;
+    long tv_nsec;
+};
+
+long sys_futex(std::uint32_t* __user uaddr,
+               int op,
+               std::uint32_t val,
+               std::uintptr_t timeout_or_val2,
+               std::uint32_t* __user uaddr2,
+               std::uint32_t val3);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <linux/io_uring.hpp>
+#include <memory/memory.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall {
+// Most entries a submission ring can have, the completion ring gets up to
+// twice as many
+constexpr std::uint32_t IORING_MAX_ENTRIES = 4096;
+
+long sys_io_uring_setup(std::uint32_t entries, linux::io_uring_params* __user params);
+long sys_io_uring_enter(unsigned int fd,
+                        std::uint32_t to_submit,
+                        std::uint32_t min_complete,
+                        std::uint32_t flags,
+                        const void* __user sig,
+                        std::size_t sigsz);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <linux/poll.hpp>
+#include <memory/memory.hpp>
+#include <syscall/sys_time.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall {
+// There are no signals, the sigmask arguments of ppoll and epoll_pwait are
+// accepted and ignored
+int sys_poll(linux::pollfd* __user fds, unsigned int nfds, int timeout_ms);
+int sys_ppoll(linux::pollfd* __user fds,
+              unsigned int nfds,
+              const kernel_timespec* __user timeout,
+              const void* __user sigmask,
+              std::size_t sigsetsize);
+int sys_select(int nfds,
+               linux::fd_set* __user readfds,
+               linux::fd_set* __user writefds,
+               linux::fd_set* __user exceptfds,
+               kernel_timeval* __user timeout);
+int sys_epoll_create(int size);
+int sys_epoll_create1(int flags);
+int sys_epoll_ctl(int epfd, int op, int fd, linux::epoll_event* __user event);
+int sys_epoll_wait(int epfd, linux::epoll_event* __user events, int max_events, int timeout_ms);
+int sys_epoll_pwait(int epfd,
+                    linux::epoll_event* __user events,
+                    int max_events,
+                    int timeout_ms,
+                    const void* __user sigmask,
+                    std::size_t sigsetsize);
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <arch.hpp>
+#include <memory/memory.hpp>
+
+#include <cstdint>
 
 namespace syscall {
 
@@ -8,13 +11,26 @@ int sys_getpid();
 
 int sys_fork(arch::trap::SyscallFrame* syscall_frame);
 
+int sys_clone(arch::trap::SyscallFrame* syscall_frame,
+    std::uint64_t flags,
+    std::uintptr_t stack,
+    int* __user parent_tid,
+    int* __user child_tid,
+    std::uintptr_t tls);
+
 int sys_vfork();
 
 int sys_wait4(int pid, int* wstatus, int options, void* unused);
 
-int sys_execve(const char* path, char* argv[], char* envp[]);
+int sys_execve(const char* __user path, char* const __user argv[], char* const __user envp[]);
 
 [[noreturn]]
 int sys_exit(int status);
 
+[[noreturn]]
+int sys_exit_group(int status);
+
+[[noreturn]]
+void exit_killed();
+
 }
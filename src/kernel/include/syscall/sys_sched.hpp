@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory/memory.hpp>
+
+namespace syscall {
+constexpr int PRIO_PROCESS = 0;
+constexpr int PRIO_PGRP = 1;
+constexpr int PRIO_USER = 2;
+
+constexpr int SCHED_OTHER = 0;
+constexpr int SCHED_FIFO = 1;
+constexpr int SCHED_RR = 2;
+
+struct sched_param {
+    int sched_priority;
+};
+
+int sys_getpriority(int which, int who);
+int sys_setpriority(int which, int who, int prio);
+
+int sys_sched_setparam(int pid, const sched_param* __user param);
+int sys_sched_getparam(int pid, sched_param* __user param);
+int sys_sched_setscheduler(int pid, int policy, const sched_param* __user param);
+int sys_sched_getscheduler(int pid);
+int sys_sched_get_priority_max(int policy);
+int sys_sched_get_priority_min(int policy);
+}
@@ -2,4 +2,5 @@
 
 namespace syscall {
 long sys_set_tid_address(int* tidptr);
+long sys_gettid();
 }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory/memory.hpp>
+
+#include <cstdint>
+
+namespace syscall {
+constexpr int CLOCK_REALTIME = 0;
+constexpr int CLOCK_MONOTONIC = 1;
+
+struct kernel_timespec {
+    long tv_sec;
+    long tv_nsec;
+};
+
+struct kernel_timeval {
+    long tv_sec;
+    long tv_usec;
+};
+
+// Normally served by the vDSO without entering the kernel, these are the
+// fallback for libcs that don't use it and for clocks it can't answer
+int sys_clock_gettime(int clock, kernel_timespec* __user ts);
+int sys_clock_settime(int clock, const kernel_timespec* __user ts);
+int sys_gettimeofday(kernel_timeval* __user tv, void* __user tz);
+long sys_time(long* __user t);
+}
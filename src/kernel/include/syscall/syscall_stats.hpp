@@ -0,0 +1,37 @@
+#pragma once
+
+#include <containers/kstring.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall::stats {
+
+// Bucket i counts calls that took [2^i, 2^(i+1)) ns, the last one everything slower
+constexpr std::size_t NUM_BUCKETS = 32;
+
+// One per syscall in the dispatch table, updated with relaxed atomics since
+// a syscall can be preempted part way through
+struct Counters {
+    std::uint64_t calls;
+    std::uint64_t errors;    // Returned -4095..-1
+    std::uint64_t total_ns;  // Summed over calls that returned
+    std::uint64_t max_ns;
+    std::uint32_t histogram[NUM_BUCKETS];
+};
+
+// Timestamp to pass to end(), 0 if the syscall.stats tunable is off
+std::uint64_t begin(Counters& counters);
+
+// Record a returned call. exit() and friends never get here, so the
+// histogram can count fewer calls than `calls`
+void end(Counters& counters, std::uint64_t start, std::uint64_t result);
+
+void reset(Counters& counters);
+
+// One /proc/syscalls line: name, calls, errors, average and max latency and
+// the non-empty histogram buckets
+void format(kstring& out, const char* name, const Counters& counters);
+void format_header(kstring& out);
+
+}
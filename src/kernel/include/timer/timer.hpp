@@ -7,8 +7,13 @@
 namespace timer {
 using TickHandler = void (*)(std::uintmax_t ticks, arch::irq::InterruptFrame* frame);
 
-void tick(arch::irq::InterruptFrame* frame);
+// Called by the timer interrupt, elapsed_ms is the period it was armed with
+void tick(arch::irq::InterruptFrame* frame, std::uint64_t elapsed_ms);
 void register_handler(TickHandler handler);
 
+// Milliseconds since the timer started, advanced by the tick period on every tick
 std::uintmax_t get_ticks();
+
+// The timer.tick_ms tunable
+std::uint64_t tick_period_ms();
 }
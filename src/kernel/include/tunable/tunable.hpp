@@ -0,0 +1,93 @@
+/**
+ * @file tunable.hpp
+ * @brief Kernel parameters that can be changed without rebuilding.
+ *
+ * A subsystem declares each of its knobs as a global Tunable next to the
+ * code that uses it:
+ *
+ *     static tunable::Tunable<std::uint32_t> g_target_fps{
+ *         "fb.target_fps", 30, 1, 240, "compositor frames per second"};
+ *
+ * and reads it with g_target_fps.value(), a single load. Constructors of
+ * globals run before kernel_main(), so every tunable is registered before
+ * anything can look for it.
+ *
+ * Values come from three places, in order:
+ *   1. the default given in the declaration
+ *   2. /etc/kernel.conf, read once the initramfs is mounted
+ *   3. writes to /proc/sys/<group>/<name> at runtime
+ */
+
+#pragma once
+
+#include <containers/kstring_view.hpp>
+
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace tunable {
+
+class TunableBase {
+public:
+    const char* name;        // "<group>.<name>", exposed as /proc/sys/<group>/<name>
+    const char* description; // One line, shown in kernel.conf
+    TunableBase* next;       // Registry link, see tunable.cpp
+
+    TunableBase(const char* name, const char* description);
+    TunableBase(const TunableBase&) = delete;
+    TunableBase& operator=(const TunableBase&) = delete;
+
+    virtual std::int64_t get() const = 0;
+
+    // Returns -EINVAL if value is out of range
+    virtual int set(std::int64_t value) = 0;
+
+    // Text <-> value conversion, decimal integers unless overridden
+    virtual bool parse(kstring_view text, std::int64_t* value) const;
+    virtual std::size_t format(char* buf, std::size_t size) const;
+};
+
+template <std::integral T>
+class Tunable final : public TunableBase {
+private:
+    T _value;
+    const T _min;
+    const T _max;
+
+public:
+    Tunable(const char* name, T value, T min, T max, const char* description)
+        : TunableBase{name, description}
+        , _value{value}
+        , _min{min}
+        , _max{max}
+    {
+    }
+
+    // Written from /proc/sys at any time, so always read through here
+    T value() const { return __atomic_load_n(&_value, __ATOMIC_RELAXED); }
+
+    std::int64_t get() const override { return static_cast<std::int64_t>(value()); }
+
+    int set(std::int64_t value) override
+    {
+        if (std::cmp_less(value, _min) || std::cmp_greater(value, _max)) {
+            return -EINVAL;
+        }
+
+        __atomic_store_n(&_value, static_cast<T>(value), __ATOMIC_RELAXED);
+
+        return 0;
+    }
+};
+
+TunableBase* first();
+TunableBase* find(kstring_view name);
+
+int set(kstring_view name, kstring_view value);
+
+void load_config(const char* path);
+
+}
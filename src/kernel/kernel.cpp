@@ -4,17 +4,23 @@
 #include <arch/x64/drivers/pic/pic.hpp>
 #include <arch/x64/drivers/serial/serial.hpp>
 #include <arch/x64/drivers/tsc/tsc.hpp>
+#include <arch/x64/fpu/fpu.hpp>
 #include <arch/x64/gdt/gdt.hpp>
 #include <arch/x64/interrupts/idt.hpp>
 #include <arch/x64/percpu/percpu.hpp>
 #include <arch/x64/trap/syscall_entry.hpp>
+#include <arch/x64/vdso/vdso.hpp>
 
+#include <block/ramdisk.hpp>
 #include <boot/boot.hpp>
 #include <console/console.hpp>
 #include <containers/kstring.hpp>
+#include <crt/crt.h>
+#include <crt/membench.hpp>
 #include <framebuffer/framebuffer.hpp>
 #include <fs/devfs/dev_tty.hpp>
 #include <fs/devfs/devfs.hpp>
+#include <fs/page_cache.hpp>
 #include <fs/procfs/procfs.hpp>
 #include <fs/tmpfs/tmpfs.hpp>
 #include <log/log.hpp>
@@ -32,11 +38,15 @@ void kernel_main()
     x64::percpu::early_init();
     x64::drivers::serial::init();
     x64::drivers::tsc::init();
+    x64::fpu::init();
+    crt_init();
 
     log::info("hltOS booted into kernel_main() using Limine.");
     log::info("Serial ouput on COM1 initialized");
+    log::info("memcpy/memset: ", crt_active_mem_impl()->name);
 
     boot::init();
+    log::start_klogd();
 
     x64::drivers::pic::init();
     x64::drivers::apic::init();
@@ -46,11 +56,15 @@ void kernel_main()
     x64::idt::init();
     x64::trap::init();
     x64::percpu::init();
+    x64::vdso::init();
 
     log::success("all core kernel features initialized!");
 
     x64::cpu::dump();
 
+    // Before devfs, which looks ram0 up when it is mounted
+    block::init_ramdisk();
+
     auto* devfs = new fs::devfs::DevFileSystem{};
     auto* tmpfs = new fs::tmpfs::TmpFileSystem{};
     auto* procfs = new fs::procfs::ProcFileSystem{};
@@ -59,10 +73,14 @@ void kernel_main()
     fs::mount("/tmp", tmpfs, nullptr);
     fs::mount("/proc", procfs, nullptr);
 
+    fs::cache::start_writeback();
+
 #ifdef KERNEL_TESTS
     test::run_all();
 #endif
 
+    membench::run();
+
     console::init();
     fs::devfs::init_tty();
 
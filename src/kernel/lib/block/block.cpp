@@ -0,0 +1,333 @@
+#include <block/block.hpp>
+#include <containers/kvector.hpp>
+#include <exclusive/kspinlock.hpp>
+#include <log/log.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace block {
+
+// Requests a plug may hold before they are dispatched anyway, so a long
+// burst does not wait for unplug() with everything it has queued
+constexpr std::uint32_t MAX_PLUGGED = 128;
+
+static kvector<BlockDevice*> g_devices;
+static kspinlock g_devices_lock;
+
+BlockDevice::BlockDevice(const char* name, std::uint64_t sectors, std::uint32_t max_sectors)
+    : name{name}
+    , sectors{sectors}
+    , max_sectors{max_sectors}
+{
+}
+
+static bool fits(const Batch* batch, const Request* req, std::uint32_t max_sectors)
+{
+    return batch->op == req->op && batch->count + req->count <= max_sectors;
+}
+
+/// @brief add req to the batch it continues or is continued by
+///
+/// A request that fills the gap between two batches joins them into one.
+///
+/// @return false if req touches no batch it may join
+///
+bool BlockDevice::merge(Request* req)
+{
+    for (Batch* batch = _queue; batch; batch = batch->next) {
+        if (!fits(batch, req, max_sectors)) {
+            continue;
+        }
+
+        // Back merge, req follows the batch
+        if (batch->sector + batch->count == req->sector) {
+            batch->last->next = req;
+            batch->last = req;
+            batch->count += req->count;
+            batch->requests++;
+
+            Batch* next = batch->next;
+
+            if (next && next->op == batch->op && batch->sector + batch->count == next->sector &&
+                batch->count + next->count <= max_sectors) {
+                batch->last->next = next->first;
+                batch->last = next->last;
+                batch->count += next->count;
+                batch->requests += next->requests;
+                batch->next = next->next;
+
+                delete next;
+            }
+
+            return true;
+        }
+
+        // Front merge, req comes right before the batch
+        if (req->sector + req->count == batch->sector) {
+            req->next = batch->first;
+            batch->first = req;
+            batch->sector = req->sector;
+            batch->count += req->count;
+            batch->requests++;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// @brief whether req shares a sector with anything queued
+///
+bool BlockDevice::overlaps(const Request* req) const
+{
+    for (const Batch* batch = _queue; batch; batch = batch->next) {
+        if (req->sector < batch->sector + batch->count && batch->sector < req->sector + req->count) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// @brief queue req as a batch of its own, in sector order
+///
+void BlockDevice::insert(Request* req)
+{
+    auto* batch = new Batch{req->op, req->sector, req->count, req, req, 1, nullptr};
+    Batch** link = &_queue;
+
+    while (*link && (*link)->sector < req->sector) {
+        link = &(*link)->next;
+    }
+
+    batch->next = *link;
+    *link = batch;
+}
+
+/// @brief empty the queue, returning what was in it
+///
+Batch* BlockDevice::take_queue()
+{
+    Batch* batches = _queue;
+
+    for (const Batch* batch = batches; batch; batch = batch->next) {
+        _stats.dispatched++;
+        _stats.sectors += batch->count;
+    }
+
+    _queue = nullptr;
+    _queued = 0;
+
+    return batches;
+}
+
+/// @brief hand batches to the driver, lowest sector first
+///
+void BlockDevice::dispatch(Batch* batches)
+{
+    while (batches) {
+        // Completion may free the batch before transfer() returns
+        Batch* next = batches->next;
+
+        batches->next = nullptr;
+        transfer(batches);
+        batches = next;
+    }
+}
+
+/// @brief finish every request in batch with status, then free it
+///
+void BlockDevice::complete(Batch* batch, int status)
+{
+    Request* req = batch->first;
+
+    delete batch;
+
+    while (req) {
+        // done() may reuse req straight away
+        Request* next = req->next;
+
+        req->next = nullptr;
+        req->done(req, status);
+        req = next;
+    }
+}
+
+/// @brief queue req, or fail it with -EIO if it does not fit on the device
+///
+/// A request that overlaps one already queued first sends the queue on its
+/// way, so the queue never reorders two requests for the same sector.
+///
+void BlockDevice::submit(Request* req)
+{
+    if (req->count == 0 || req->sector > sectors || req->count > sectors - req->sector) {
+        req->done(req, -EIO);
+        return;
+    }
+
+    req->next = nullptr;
+
+    _lock.lock();
+
+    Batch* earlier = overlaps(req) ? take_queue() : nullptr;
+
+    _stats.submitted++;
+
+    if (merge(req)) {
+        _stats.merged++;
+    } else {
+        insert(req);
+    }
+
+    _queued++;
+
+    Batch* ready = _plugs == 0 || _queued >= MAX_PLUGGED ? take_queue() : nullptr;
+
+    _lock.unlock();
+
+    dispatch(earlier);
+    dispatch(ready);
+}
+
+/// @brief hold submitted requests back until the matching unplug()
+///
+void BlockDevice::plug()
+{
+    _lock.lock();
+    _plugs++;
+    _lock.unlock();
+}
+
+/// @brief dispatch what was queued while plugged, once the last plug is gone
+///
+void BlockDevice::unplug()
+{
+    _lock.lock();
+
+    Batch* ready = --_plugs == 0 ? take_queue() : nullptr;
+
+    _lock.unlock();
+
+    dispatch(ready);
+}
+
+QueueStats BlockDevice::stats()
+{
+    _lock.lock();
+
+    const QueueStats stats = _stats;
+
+    _lock.unlock();
+
+    return stats;
+}
+
+void Completion::done(Request* req, int status)
+{
+    auto* completion = static_cast<Completion*>(req->data);
+
+    // The waiter returns as soon as it sees _pending reach 0 under the lock,
+    // so nothing here may touch the completion after unlock()
+    completion->_lock.lock();
+
+    if (status < 0 && completion->_status == 0) {
+        completion->_status = status;
+    }
+
+    if (--completion->_pending == 0) {
+        completion->_queue.wake_all();
+    }
+
+    completion->_lock.unlock();
+}
+
+void Completion::add(Request* req)
+{
+    _lock.lock();
+    _pending++;
+    _lock.unlock();
+
+    req->done = done;
+    req->data = this;
+}
+
+/// @brief sleep until every request added has completed
+///
+/// @return 0, or the first error a request completed with
+///
+int Completion::wait()
+{
+    _lock.lock();
+
+    while (_pending > 0) {
+        _queue.prepare();
+        _lock.unlock();
+        _queue.sleep();
+        _lock.lock();
+    }
+
+    const int status = _status;
+
+    _lock.unlock();
+
+    return status;
+}
+
+void register_device(BlockDevice* dev)
+{
+    g_devices_lock.lock();
+    g_devices.push_back(dev);
+    g_devices_lock.unlock();
+
+    log::infof<log::Subsystem::DRIVER>("block: {} registered, {} sectors ({} KiB)", dev->name, dev->sectors,
+        dev->size() / 1024);
+}
+
+BlockDevice* find(kstring_view name)
+{
+    BlockDevice* found = nullptr;
+
+    g_devices_lock.lock();
+
+    for (BlockDevice* dev : g_devices) {
+        if (kstring_view{dev->name} == name) {
+            found = dev;
+            break;
+        }
+    }
+
+    g_devices_lock.unlock();
+
+    return found;
+}
+
+static int transfer_sync(BlockDevice* dev, Op op, std::uint64_t sector, std::uint32_t count, void* buffer)
+{
+    Request req;
+    Completion completion;
+
+    req.op = op;
+    req.sector = sector;
+    req.count = count;
+    req.buffer = buffer;
+
+    completion.add(&req);
+    dev->submit(&req);
+
+    return completion.wait();
+}
+
+int read(BlockDevice* dev, std::uint64_t sector, std::uint32_t count, void* buffer)
+{
+    return transfer_sync(dev, Op::READ, sector, count, buffer);
+}
+
+int write(BlockDevice* dev, std::uint64_t sector, std::uint32_t count, const void* buffer)
+{
+    return transfer_sync(dev, Op::WRITE, sector, count, const_cast<void*>(buffer));
+}
+
+}
@@ -0,0 +1,95 @@
+#include <arch.hpp>
+#include <block/block.hpp>
+#include <block/ramdisk.hpp>
+#include <crt/crt.h>
+#include <log/log.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace block {
+
+static tunable::Tunable<std::uint32_t> g_ram0_mb{
+    "block.ram0_mb", 64, 0, 4096, "size of the /dev/ram0 RAM disk in MiB, read once at boot, 0 for none"};
+
+// 1 MiB, a merged run is copied page by page anyway
+constexpr std::uint32_t RAMDISK_MAX_SECTORS = 2048;
+
+RamDisk::RamDisk(const char* name, std::uint64_t bytes)
+    : BlockDevice{name, bytes / SECTOR_SIZE, RAMDISK_MAX_SECTORS}
+{
+}
+
+/// @brief copy each request of batch to or from the pages behind it
+///
+void RamDisk::transfer(Batch* batch)
+{
+    int status = 0;
+
+    _lock.lock();
+
+    for (Request* req = batch->first; req && status == 0; req = req->next) {
+        const std::size_t start = req->sector * SECTOR_SIZE;
+        const std::size_t length = static_cast<std::size_t>(req->count) * SECTOR_SIZE;
+        auto* buffer = static_cast<std::uint8_t*>(req->buffer);
+        std::size_t done = 0;
+
+        while (done < length) {
+            const std::size_t pos = start + done;
+            const std::size_t offset = pos % arch::vmm::PAGE_SIZE;
+            const std::size_t left = arch::vmm::PAGE_SIZE - offset;
+            const std::size_t chunk = length - done < left ? length - done : left;
+
+            if (batch->op == Op::READ) {
+                const std::uint8_t* page = _pages.find(pos / arch::vmm::PAGE_SIZE);
+
+                if (page) {
+                    memcpy(buffer + done, page + offset, chunk);
+                } else {
+                    memset(buffer + done, 0, chunk);
+                }
+            } else {
+                std::uint8_t* page = _pages.find_or_create(pos / arch::vmm::PAGE_SIZE);
+
+                if (!page) {
+                    status = -ENOMEM;
+                    break;
+                }
+
+                memcpy(page + offset, buffer + done, chunk);
+            }
+
+            done += chunk;
+        }
+    }
+
+    _lock.unlock();
+
+    complete(batch, status);
+}
+
+std::size_t RamDisk::pages()
+{
+    _lock.lock();
+
+    const std::size_t pages = _pages.pages();
+
+    _lock.unlock();
+
+    return pages;
+}
+
+void init_ramdisk()
+{
+    const std::uint64_t mb = g_ram0_mb.value();
+
+    if (mb == 0) {
+        return;
+    }
+
+    register_device(new RamDisk{"ram0", mb * 1024 * 1024});
+}
+
+}
@@ -13,6 +13,9 @@
 #include <log/log.hpp>
 #include <memory/pmm.hpp>
 #include <scheduler/scheduler.hpp>
+#include <tunable/tunable.hpp>
+
+#include <crt/crt.h>
 
 #include <cstddef>
 #include <cstdint>
@@ -73,6 +76,20 @@ static volatile limine_module_request module_request
         .internal_module_count = 0,
         .internal_modules = nullptr};
 
+[[gnu::used, gnu::section(".limine_requests")]]
+static volatile limine_executable_cmdline_request cmdline_request
+    = {
+        .id = LIMINE_EXECUTABLE_CMDLINE_REQUEST_ID,
+        .revision = 0,
+        .response = nullptr};
+
+[[gnu::used, gnu::section(".limine_requests")]]
+static volatile limine_date_at_boot_request date_at_boot_request
+    = {
+        .id = LIMINE_DATE_AT_BOOT_REQUEST_ID,
+        .revision = 0,
+        .response = nullptr};
+
 [[gnu::used, gnu::section(".limine_requests_end")]]
 static volatile std::uint64_t limine_requests_end_marker[]
     = LIMINE_REQUESTS_END_MARKER;
@@ -177,9 +194,16 @@ static void init_modules()
         log::infof("  [{}] {} ({} bytes)", i, path, size);
 
         // TODO: Check module type/extension before assuming initramfs
-        // For now, we assume all modules are TAR archives for initramfs
+        // For now, we assume all modules are (possibly LZ4-compressed) TAR
+        // archives for initramfs
+
+        auto* mp = fs::initramfs::load(addr, size);
+
+        if (mp == nullptr) {
+            log::warn("Module could not be loaded as an initramfs");
+            continue;
+        }
 
-        auto* mp = new fs::initramfs::InitramfsMountPoint{addr, size};
         fs::register_mount("/", mp);
     }
 }
@@ -202,14 +226,82 @@ static void init_framebuffer()
 
 namespace boot {
 
+/// @brief the kernel command line set with `cmdline:` in limine.conf
+///
+kstring_view get_cmdline()
+{
+    if (cmdline_request.response == nullptr || cmdline_request.response->cmdline == nullptr) {
+        return kstring_view{""};
+    }
+
+    return kstring_view{cmdline_request.response->cmdline};
+}
+
+/// @brief the wall clock time Limine read from the RTC before starting the kernel
+///
+/// @return seconds since the UNIX epoch, or 0 if the bootloader did not provide it
+///
+std::int64_t get_boot_time()
+{
+    if (date_at_boot_request.response == nullptr) {
+        return 0;
+    }
+
+    return date_at_boot_request.response->timestamp;
+}
+
+/// @brief find the value of a `key=value` option on the kernel command line
+///
+/// @param key the option name
+///
+/// @return the value, or an empty view if the option is not present
+///
+kstring_view get_cmdline_option(const char* key)
+{
+    const kstring_view cmdline = get_cmdline();
+    const std::size_t key_len = strlen(key);
+
+    std::size_t i = 0;
+
+    while (i < cmdline.length()) {
+        while (i < cmdline.length() && cmdline[i] == ' ') {
+            i++;
+        }
+
+        const std::size_t start = i;
+
+        while (i < cmdline.length() && cmdline[i] != ' ') {
+            i++;
+        }
+
+        // substr() falls back to strlen() for long lengths, so build the
+        // views by hand to keep them bounded to this one option
+        const kstring_view option{cmdline.data() + start, i - start};
+
+        if (option.length() > key_len
+            && option[key_len] == '='
+            && memcmp(option.data(), key, key_len) == 0) {
+            return kstring_view{option.data() + key_len + 1, option.length() - key_len - 1};
+        }
+    }
+
+    return kstring_view{""};
+}
+
 void init()
 {
+    log::init();
     log::info("Parsing Limine headers");
 
     validate_limine_responses();
     init_memory();
     init_acpi();
     init_modules();
+
+    // Needs the initramfs mounted, and has to come before the APIC timer is
+    // armed with timer.tick_ms
+    tunable::load_config("/etc/kernel.conf");
+
     init_framebuffer();
 }
 
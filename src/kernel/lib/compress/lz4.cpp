@@ -0,0 +1,253 @@
+#include <compress/lz4.hpp>
+#include <crt/crt.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace compress::lz4 {
+
+// Frame descriptor FLG bits
+constexpr std::uint8_t FLG_VERSION_MASK = 0xC0;
+constexpr std::uint8_t FLG_VERSION = 0x40;
+constexpr std::uint8_t FLG_BLOCK_CHECKSUM = 0x10;
+constexpr std::uint8_t FLG_CONTENT_SIZE = 0x08;
+constexpr std::uint8_t FLG_DICT_ID = 0x01;
+
+// Block size word: the high bit marks a block stored uncompressed
+constexpr std::uint32_t BLOCK_UNCOMPRESSED = 0x80000000;
+
+constexpr std::size_t MIN_MATCH = 4;
+
+// Magic, FLG, BD and the header checksum
+constexpr std::size_t MIN_HEADER = 7;
+
+static std::uint32_t read_le32(const std::uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+static std::uint64_t read_le64(const std::uint8_t* p)
+{
+    return read_le32(p) | (static_cast<std::uint64_t>(read_le32(p + 4)) << 32);
+}
+
+/// @brief add the extra length bytes that follow a nibble of 15
+///
+static bool read_length(const std::uint8_t** ip, const std::uint8_t* iend, std::size_t* length)
+{
+    std::uint8_t byte;
+
+    do {
+        if (*ip == iend) {
+            return false;
+        }
+
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+
+    return true;
+}
+
+/// @brief copy a match that may overlap its own output
+///
+/// Each pass copies from twice as far back as the last, the bytes behind op
+/// repeat every offset bytes so any multiple of it is as good a source.
+/// A run of zeros takes a handful of memcpy()s instead of a byte loop
+///
+static void copy_match(std::uint8_t* op, std::size_t offset, std::size_t length)
+{
+    std::size_t distance = offset;
+
+    while (length > 0) {
+        const std::size_t chunk = length < distance ? length : distance;
+
+        memcpy(op, op - distance, chunk);
+
+        op += chunk;
+        length -= chunk;
+        distance *= 2;
+    }
+}
+
+/// @brief decode one block to dst + pos
+///
+/// dst[0, pos) is what earlier blocks decoded, matches may reach back
+/// into it
+///
+/// @return the bytes decoded, or -EINVAL if the block is corrupt or does
+///         not fit before dst_len
+///
+static long decode_block(const std::uint8_t* ip, std::size_t len, std::uint8_t* dst, std::size_t pos, std::size_t dst_len)
+{
+    const std::uint8_t* const iend = ip + len;
+    std::uint8_t* op = dst + pos;
+    std::uint8_t* const oend = dst + dst_len;
+
+    while (true) {
+        if (ip == iend) {
+            return -EINVAL;
+        }
+
+        const std::uint8_t token = *ip++;
+        std::size_t literals = token >> 4;
+
+        if (literals == 15 && !read_length(&ip, iend, &literals)) {
+            return -EINVAL;
+        }
+
+        if (literals > static_cast<std::size_t>(iend - ip) || literals > static_cast<std::size_t>(oend - op)) {
+            return -EINVAL;
+        }
+
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+
+        // The last sequence of a block has literals only
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -EINVAL;
+        }
+
+        const std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > static_cast<std::size_t>(op - dst)) {
+            return -EINVAL;
+        }
+
+        std::size_t match = token & 15;
+
+        if (match == 15 && !read_length(&ip, iend, &match)) {
+            return -EINVAL;
+        }
+
+        match += MIN_MATCH;
+
+        if (match > static_cast<std::size_t>(oend - op)) {
+            return -EINVAL;
+        }
+
+        copy_match(op, offset, match);
+        op += match;
+    }
+
+    return op - (dst + pos);
+}
+
+/// @brief size of the frame header, 0 if src does not start with a valid one
+///
+static std::size_t header_size(const std::uint8_t* src, std::size_t src_len)
+{
+    if (src_len < MIN_HEADER || read_le32(src) != FRAME_MAGIC) {
+        return 0;
+    }
+
+    const std::uint8_t flg = src[4];
+
+    if ((flg & FLG_VERSION_MASK) != FLG_VERSION) {
+        return 0;
+    }
+
+    std::size_t size = MIN_HEADER;
+
+    if (flg & FLG_CONTENT_SIZE) {
+        size += 8;
+    }
+
+    if (flg & FLG_DICT_ID) {
+        size += 4;
+    }
+
+    return size <= src_len ? size : 0;
+}
+
+bool is_frame(const std::uint8_t* src, std::size_t src_len)
+{
+    return header_size(src, src_len) != 0;
+}
+
+/// @return the decompressed size stored in the frame header, or 0 if the
+///         frame was written without one (lz4 --content-size)
+///
+std::uint64_t content_size(const std::uint8_t* src, std::size_t src_len)
+{
+    if (header_size(src, src_len) == 0 || (src[4] & FLG_CONTENT_SIZE) == 0) {
+        return 0;
+    }
+
+    return read_le64(src + 6);
+}
+
+/// @brief decompress the LZ4 frame at src into dst
+///
+/// @return the decompressed size, or -EINVAL if the frame is corrupt or
+///         does not fit in dst_len bytes
+///
+long decompress_frame(const std::uint8_t* src, std::size_t src_len, std::uint8_t* dst, std::size_t dst_len)
+{
+    std::size_t pos = header_size(src, src_len);
+
+    if (pos == 0) {
+        return -EINVAL;
+    }
+
+    const bool block_checksum = src[4] & FLG_BLOCK_CHECKSUM;
+    std::size_t out = 0;
+
+    while (true) {
+        if (src_len - pos < 4) {
+            return -EINVAL;
+        }
+
+        const std::uint32_t word = read_le32(src + pos);
+        const std::size_t size = word & ~BLOCK_UNCOMPRESSED;
+
+        pos += 4;
+
+        // End mark, a content checksum may follow
+        if (word == 0) {
+            break;
+        }
+
+        if (size > src_len - pos) {
+            return -EINVAL;
+        }
+
+        if (word & BLOCK_UNCOMPRESSED) {
+            if (size > dst_len - out) {
+                return -EINVAL;
+            }
+
+            memcpy(dst + out, src + pos, size);
+            out += size;
+        } else {
+            const long decoded = decode_block(src + pos, size, dst, out, dst_len);
+
+            if (decoded < 0) {
+                return decoded;
+            }
+
+            out += decoded;
+        }
+
+        pos += size;
+
+        if (block_checksum) {
+            pos += 4;
+        }
+
+        if (pos > src_len) {
+            return -EINVAL;
+        }
+    }
+
+    return static_cast<long>(out);
+}
+
+}
@@ -87,7 +87,7 @@ void erase_in_line(const kvector<kstring>& args)
     } else if (val == 2) {
         console::erase_in_line(0, console::get_screen_cols());
     } else {
-        log::warn("Invalid Erase In Line arg: ", val);
+        log::warn<log::Subsystem::DRIVER>("Invalid Erase In Line arg: ", val);
     }
 }
 
@@ -115,7 +115,7 @@ std::size_t parse_csi(kstring::const_iterator begin, kstring::const_iterator str
     }
 
     if (iter == str_end) {
-        log::warn("Unsupported ANSI escape sequence");
+        log::warn<log::Subsystem::DRIVER>("Unsupported ANSI escape sequence");
         return 0;
     }
 
@@ -124,31 +124,31 @@ std::size_t parse_csi(kstring::const_iterator begin, kstring::const_iterator str
     kstring default_arg = get_default_arg(code);
     kvector<kstring> args = algo::tokenize(begin + 2, iter, ';');
 
-    log::debug("num args: ", args.size());
+    log::debug<log::Subsystem::DRIVER>("num args: ", args.size());
 
     if (args.empty()) {
         args.push_back(default_arg);
     } else {
         for (auto& arg : args) {
-            log::debug("arg: '", arg.size(), "'");
+            log::debug<log::Subsystem::DRIVER>("arg: '", arg.size(), "'");
 
             if (arg.empty()) {
-                log::debug("empty arg");
+                log::debug<log::Subsystem::DRIVER>("empty arg");
                 arg = default_arg;
             }
         }
     }
 
-    log::debug("ANSI code: ", code);
-    log::debug("Default arg: ", default_arg);
+    log::debug<log::Subsystem::DRIVER>("ANSI code: ", code);
+    log::debug<log::Subsystem::DRIVER>("Default arg: ", default_arg);
 
     for (const auto& arg : args) {
-        log::debug("Arg: ", arg);
+        log::debug<log::Subsystem::DRIVER>("Arg: ", arg);
     }
 
     auto distance = (iter - begin) + 1;
 
-    log::debug("str len = ", distance);
+    log::debug<log::Subsystem::DRIVER>("str len = ", distance);
 
     switch (code) {
     case CURSOR_FORWARD:
@@ -174,7 +174,7 @@ std::size_t parse_ansi_escape(kstring::const_iterator iter, kstring::const_itera
         return parse_csi(iter, str_end);
     }
 
-    log::warn("Unsupported ANSI escape sequence");
+    log::warn<log::Subsystem::DRIVER>("Unsupported ANSI escape sequence");
 
     return 1; // return 1 so this character isn't parsed again
 }
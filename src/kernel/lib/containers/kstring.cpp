@@ -1,17 +1,43 @@
 #include <arch.hpp>
 #include <containers/kstring.hpp>
-#include <kassert/kassert.hpp>
 
-#include <cstdint>
+#include <cerrno>
+#include <cstddef>
+#include <utility>
 
-kstring kstring::from_userspace(const char* chars)
+int kstring::from_user(const char* chars, std::size_t max_length, kstring& out)
 {
-    kassert(arch::vmm::is_user_addr(chars));
+    // Most strings (paths, argv) fit in one chunk on the stack
+    char chunk[256];
+    kstring result;
 
-    const std::uint64_t rflags = arch::cpu::read_rflags();
-    arch::cpu::stac();
-    kstring str{chars};
-    arch::cpu::write_rflags(rflags);
+    while (true) {
+        const long copied = arch::uaccess::strncpy_from_user(chunk, chars, sizeof(chunk));
 
-    return str;
+        if (copied >= 0) {
+            result += chunk;
+            break;
+        }
+
+        if (copied != -ENAMETOOLONG) {
+            return static_cast<int>(copied);
+        }
+
+        // A full chunk without a NUL, keep going from where it stopped
+        chunk[sizeof(chunk) - 1] = '\0';
+        result += chunk;
+        chars += sizeof(chunk) - 1;
+
+        if (result.length() > max_length) {
+            return -ENAMETOOLONG;
+        }
+    }
+
+    if (result.length() > max_length) {
+        return -ENAMETOOLONG;
+    }
+
+    out = std::move(result);
+
+    return 0;
 }
@@ -1,5 +1,8 @@
 #include <crt/crt.h>
 
+#include <cpuid.h>
+#include <stdint.h>
+
 // =============================================================================
 // Memory Functions
 // =============================================================================
@@ -7,41 +10,185 @@
 // Required by GCC in freestanding mode. The compiler may emit calls to these
 // even without explicit use in source code (e.g., struct copies, zeroing).
 
-void* memcpy(void* dest, const void* src, size_t count) {
+// Every memcpy()/memset() goes through g_mem_impl, which crt_init() points at
+// the best variant for this CPU once at boot:
+//
+//   generic       8 bytes at a time in C, the reference implementation
+//   rep movsq     8 bytes per iteration in microcode, fine on any x86_64
+//   rep movsb     with ERMS the microcode moves whole cache lines, but has a
+//                 startup cost of a few dozen cycles, so short copies still
+//                 use the word loop
+//   rep movsb     with FSRM the startup cost is gone, rep movsb for any size
+//
+// The kernel is built with -mgeneral-regs-only and user SIMD registers are
+// switched lazily, so none of these touch vector registers. Bulk copies that
+// can afford kernel_fpu_begin() use fpu::copy_nontemporal() instead.
+
+#define CPUID_7_EBX_ERMS (1u << 9)
+#define CPUID_7_EDX_FSRM (1u << 4)
+
+// Short copies are faster in C than paying for rep movsb's startup
+#define ERMS_THRESHOLD 64
+
+// Lets the word loops read and write unaligned words without breaking
+// strict aliasing
+typedef uint64_t word_t __attribute__((may_alias, aligned(1)));
+
+#define WORD_ONES 0x0101010101010101ull
+#define WORD_HIGHS 0x8080808080808080ull
+
+static void* copy_generic(void* dest, const void* src, size_t count) {
     unsigned char* d = (unsigned char*)dest;
     const unsigned char* s = (const unsigned char*)src;
-    for (size_t i = 0; i < count; i++) {
-        d[i] = s[i];
+    while (count >= 8) {
+        *(word_t*)d = *(const word_t*)s;
+        d += 8;
+        s += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        *d++ = *s++;
+        count--;
     }
     return dest;
 }
 
-void* memmove(void* dest, const void* src, size_t count) {
+static void* set_generic(void* dest, int val, size_t count) {
     unsigned char* d = (unsigned char*)dest;
-    const unsigned char* s = (const unsigned char*)src;
-    if (d < s) {
-        for (size_t i = 0; i < count; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        for (size_t i = count; i > 0; i--) {
-            d[i - 1] = s[i - 1];
-        }
+    const uint64_t word = (unsigned char)val * WORD_ONES;
+    while (count >= 8) {
+        *(word_t*)d = word;
+        d += 8;
+        count -= 8;
+    }
+    while (count > 0) {
+        *d++ = (unsigned char)val;
+        count--;
     }
     return dest;
 }
 
-void* memset(void* dest, int val, size_t count) {
+static void* copy_movsq(void* dest, const void* src, size_t count) {
+    void* d = dest;
+    size_t words = count >> 3;
+    size_t bytes = count & 7;
+    asm volatile("rep movsq" : "+D"(d), "+S"(src), "+c"(words) : : "memory");
+    asm volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(bytes) : : "memory");
+    return dest;
+}
+
+static void* set_stosq(void* dest, int val, size_t count) {
+    void* d = dest;
+    size_t words = count >> 3;
+    size_t bytes = count & 7;
+    const uint64_t word = (unsigned char)val * WORD_ONES;
+    asm volatile("rep stosq" : "+D"(d), "+c"(words) : "a"(word) : "memory");
+    asm volatile("rep stosb" : "+D"(d), "+c"(bytes) : "a"(word) : "memory");
+    return dest;
+}
+
+static void* copy_movsb(void* dest, const void* src, size_t count) {
+    void* d = dest;
+    asm volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(count) : : "memory");
+    return dest;
+}
+
+static void* set_stosb(void* dest, int val, size_t count) {
+    void* d = dest;
+    asm volatile("rep stosb" : "+D"(d), "+c"(count) : "a"(val) : "memory");
+    return dest;
+}
+
+static void* copy_erms(void* dest, const void* src, size_t count) {
+    if (count < ERMS_THRESHOLD) {
+        return copy_generic(dest, src, count);
+    }
+    return copy_movsb(dest, src, count);
+}
+
+static void* set_erms(void* dest, int val, size_t count) {
+    if (count < ERMS_THRESHOLD) {
+        return set_generic(dest, val, count);
+    }
+    return set_stosb(dest, val, count);
+}
+
+enum { MEM_GENERIC, MEM_MOVSQ, MEM_ERMS, MEM_FSRM, NUM_MEM_IMPLS };
+
+static const struct crt_mem_impl mem_impls[NUM_MEM_IMPLS] = {
+    [MEM_GENERIC] = {"generic", copy_generic, set_generic},
+    [MEM_MOVSQ] = {"rep movsq", copy_movsq, set_stosq},
+    [MEM_ERMS] = {"rep movsb (ERMS)", copy_erms, set_erms},
+    [MEM_FSRM] = {"rep movsb (FSRM)", copy_movsb, set_stosb},
+};
+
+static const struct crt_mem_impl* g_mem_impl = &mem_impls[MEM_MOVSQ];
+
+void crt_init(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, 0) < 7) {
+        return;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (edx & CPUID_7_EDX_FSRM) {
+        g_mem_impl = &mem_impls[MEM_FSRM];
+    } else if (ebx & CPUID_7_EBX_ERMS) {
+        g_mem_impl = &mem_impls[MEM_ERMS];
+    }
+}
+
+size_t crt_num_mem_impls(void) {
+    return NUM_MEM_IMPLS;
+}
+
+const struct crt_mem_impl* crt_get_mem_impl(size_t index) {
+    return index < NUM_MEM_IMPLS ? &mem_impls[index] : NULL;
+}
+
+const struct crt_mem_impl* crt_active_mem_impl(void) {
+    return g_mem_impl;
+}
+
+void* memcpy(void* dest, const void* src, size_t count) {
+    return g_mem_impl->copy(dest, src, count);
+}
+
+void* memmove(void* dest, const void* src, size_t count) {
     unsigned char* d = (unsigned char*)dest;
-    for (size_t i = 0; i < count; i++) {
-        d[i] = (unsigned char)val;
+    const unsigned char* s = (const unsigned char*)src;
+    // Every variant copies forwards one element at a time, so a destination
+    // below the source never overwrites bytes that are still to be read
+    if (d <= s || d >= s + count) {
+        return memcpy(dest, src, count);
+    }
+    d += count;
+    s += count;
+    while (count >= 8) {
+        d -= 8;
+        s -= 8;
+        *(word_t*)d = *(const word_t*)s;
+        count -= 8;
+    }
+    while (count > 0) {
+        *--d = *--s;
+        count--;
     }
     return dest;
 }
 
+void* memset(void* dest, int val, size_t count) {
+    return g_mem_impl->set(dest, val, count);
+}
+
 int memcmp(const void* s1, const void* s2, size_t count) {
     const unsigned char* a = (const unsigned char*)s1;
     const unsigned char* b = (const unsigned char*)s2;
+    // Skip equal words, the byte loop then finds the first difference
+    while (count >= 8 && *(const word_t*)a == *(const word_t*)b) {
+        a += 8;
+        b += 8;
+        count -= 8;
+    }
     for (size_t i = 0; i < count; i++) {
         if (a[i] != b[i]) {
             return a[i] - b[i];
@@ -55,9 +202,25 @@ int memcmp(const void* s1, const void* s2, size_t count) {
 // =============================================================================
 
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len]) len++;
-    return len;
+    const char* c = str;
+    // Byte by byte up to a word boundary. An aligned word never crosses a
+    // page boundary, so reading past the terminator is safe from there on
+    while ((uintptr_t)c & 7) {
+        if (*c == '\0') {
+            return c - str;
+        }
+        c++;
+    }
+    const word_t* w = (const word_t*)c;
+    // Nonzero exactly when one of the bytes is zero
+    while (((*w - WORD_ONES) & ~*w & WORD_HIGHS) == 0) {
+        w++;
+    }
+    c = (const char*)w;
+    while (*c) {
+        c++;
+    }
+    return c - str;
 }
 
 int strcmp(const char* s1, const char* s2) {
@@ -0,0 +1,196 @@
+#include <arch.hpp>
+#include <arch/x64/drivers/tsc/tsc.hpp>
+#include <arch/x64/fpu/fpu.hpp>
+#include <boot/boot.hpp>
+#include <crt/crt.h>
+#include <crt/membench.hpp>
+#include <log/log.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace membench {
+
+namespace tsc = x64::drivers::tsc;
+namespace fpu = x64::fpu;
+
+constexpr std::size_t MIN_SIZE = 8;
+constexpr std::size_t MAX_SIZE = 8 * 1024 * 1024;
+
+// Each measurement moves about this much data, so small sizes loop often
+// enough for the TSC to resolve them and large ones still finish quickly
+constexpr std::size_t BYTES_PER_RUN = 32 * 1024 * 1024;
+
+// Sizes below this are not worth kernel_fpu_begin(), skip the SIMD columns
+constexpr std::size_t NONTEMPORAL_MIN_SIZE = 4096;
+
+using CopyFn = void (*)(void* dst, const void* src, std::size_t size);
+
+struct Buffers {
+    std::uint8_t* dst;
+    std::uint8_t* src;
+};
+
+static std::size_t iterations(std::size_t size)
+{
+    const std::size_t n = BYTES_PER_RUN / size;
+    return n == 0 ? 1 : n;
+}
+
+/// @brief throughput in MB/s of moving size bytes iterations times in ticks
+///
+static std::uint64_t mb_per_sec(std::size_t size, std::size_t n, std::uint64_t ticks)
+{
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    const auto bytes = static_cast<unsigned __int128>(size) * n;
+
+    return static_cast<std::uint64_t>(bytes * tsc::get_tsc_freq() / ticks / 1000000);
+}
+
+static std::uint64_t time_copy(const crt_mem_impl* impl, const Buffers& buf, std::size_t size)
+{
+    const std::size_t n = iterations(size);
+
+    // Warm up the caches and the TLB the same way for every variant
+    impl->copy(buf.dst, buf.src, size);
+
+    const std::uint64_t start = tsc::get_ticks();
+
+    for (std::size_t i = 0; i < n; i++) {
+        impl->copy(buf.dst, buf.src, size);
+        asm volatile("" : : : "memory");
+    }
+
+    return mb_per_sec(size, n, tsc::get_ticks() - start);
+}
+
+static std::uint64_t time_set(const crt_mem_impl* impl, const Buffers& buf, std::size_t size)
+{
+    const std::size_t n = iterations(size);
+
+    impl->set(buf.dst, 0x5A, size);
+
+    const std::uint64_t start = tsc::get_ticks();
+
+    for (std::size_t i = 0; i < n; i++) {
+        impl->set(buf.dst, 0x5A, size);
+        asm volatile("" : : : "memory");
+    }
+
+    return mb_per_sec(size, n, tsc::get_ticks() - start);
+}
+
+static std::uint64_t time_nontemporal(bool avx, const Buffers& buf, std::size_t size)
+{
+    const std::size_t n = iterations(size);
+
+    fpu::kernel_fpu_begin();
+
+    fpu::copy_nontemporal_with(avx, buf.dst, buf.src, size);
+
+    const std::uint64_t start = tsc::get_ticks();
+
+    for (std::size_t i = 0; i < n; i++) {
+        fpu::copy_nontemporal_with(avx, buf.dst, buf.src, size);
+    }
+
+    const std::uint64_t ticks = tsc::get_ticks() - start;
+
+    fpu::kernel_fpu_end();
+
+    return mb_per_sec(size, n, ticks);
+}
+
+static void bench_copy(const Buffers& buf)
+{
+    log::info("membench: memcpy, MB/s");
+
+    for (std::size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        kstring line = "membench: ";
+        char number[32];
+
+        line += fmt::to_string(size, number);
+        line += " B:";
+
+        for (std::size_t i = 0; i < crt_num_mem_impls(); i++) {
+            const crt_mem_impl* impl = crt_get_mem_impl(i);
+
+            line += " [";
+            line += impl->name;
+            line += "] ";
+            line += fmt::to_string(time_copy(impl, buf, size), number);
+        }
+
+        if (size >= NONTEMPORAL_MIN_SIZE) {
+            line += " [nt sse] ";
+            line += fmt::to_string(time_nontemporal(false, buf, size), number);
+
+            if (fpu::has_avx()) {
+                line += " [nt avx] ";
+                line += fmt::to_string(time_nontemporal(true, buf, size), number);
+            }
+        }
+
+        log::info(line.c_str());
+    }
+}
+
+static void bench_set(const Buffers& buf)
+{
+    log::info("membench: memset, MB/s");
+
+    for (std::size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        kstring line = "membench: ";
+        char number[32];
+
+        line += fmt::to_string(size, number);
+        line += " B:";
+
+        for (std::size_t i = 0; i < crt_num_mem_impls(); i++) {
+            const crt_mem_impl* impl = crt_get_mem_impl(i);
+
+            line += " [";
+            line += impl->name;
+            line += "] ";
+            line += fmt::to_string(time_set(impl, buf, size), number);
+        }
+
+        log::info(line.c_str());
+    }
+}
+
+void run()
+{
+    if (boot::get_cmdline_option("membench") != kstring_view{"1"}) {
+        return;
+    }
+
+    log::info("membench: active variant is ", crt_active_mem_impl()->name);
+
+    Buffers buf = {
+        .dst = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel(MAX_SIZE)),
+        .src = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel(MAX_SIZE)),
+    };
+
+    if (buf.dst == nullptr || buf.src == nullptr) {
+        log::warn("membench: not enough memory for ", MAX_SIZE, " byte buffers");
+        arch::vmm::free_kernel(buf.dst);
+        arch::vmm::free_kernel(buf.src);
+        return;
+    }
+
+    for (std::size_t i = 0; i < MAX_SIZE; i++) {
+        buf.src[i] = static_cast<std::uint8_t>(i);
+    }
+
+    bench_copy(buf);
+    bench_set(buf);
+
+    arch::vmm::free_kernel(buf.dst);
+    arch::vmm::free_kernel(buf.src);
+}
+
+}
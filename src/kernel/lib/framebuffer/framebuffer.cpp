@@ -9,11 +9,14 @@
 #include <process/process.hpp>
 #include <scheduler/scheduler.hpp>
 #include <timer/timer.hpp>
+#include <tunable/tunable.hpp>
 
 #include <cstdint>
 
 namespace framebuffer {
 
+constexpr int COMPOSITOR_RT_PRIORITY = 10;
+
 static std::uint64_t fb_width;
 static std::uint64_t fb_height;
 static std::uint64_t fb_num_pixels;
@@ -49,20 +52,26 @@ inline constexpr std::size_t get_pixel_offset(std::uint32_t x, std::uint32_t y)
 static void redraw()
 {
     g_fb_spinlock.lock();
-    memcpy(vram, static_cast<const std::uint8_t*>(vram_buff), vram_size);
+
+    // vram is only ever written, streaming stores keep the back buffer
+    // copy from evicting everything else from the cache
+    arch::fpu::kernel_fpu_begin();
+    arch::fpu::copy_nontemporal(vram, vram_buff, vram_size);
+    arch::fpu::kernel_fpu_end();
+
     needs_redraw = false;
     g_fb_spinlock.unlock();
 }
 
+static tunable::Tunable<std::uint32_t> g_target_fps{
+    "fb.target_fps", 30, 1, 240, "compositor frames per second"};
+
 static void redraw_kthread()
 {
-    constexpr int target_fps = 30;
-    constexpr int ms_per_frame = 1000 / target_fps;
-
     while (true) {
         redraw();
 
-        scheduler::get_scheduler()->yield_sleep(ms_per_frame);
+        scheduler::get_scheduler()->yield_sleep(1000 / g_target_fps.value());
     }
 }
 
@@ -81,7 +90,13 @@ void init(const FrameBufferInfo& info)
     vram_buff = kalloc<std::uint8_t>(vram_size);
     vram_buff_end = vram_buff + vram_size;
 
-    scheduler::get_scheduler()->add_process(new process::KThread(redraw_kthread));
+    // The compositor runs as a low priority real-time thread so frames are
+    // not delayed by CPU-bound user processes
+    auto* redraw_thread = new process::KThread(redraw_kthread);
+    redraw_thread->policy = process::SchedPolicy::FIFO;
+    redraw_thread->rt_priority = COMPOSITOR_RT_PRIORITY;
+
+    scheduler::get_scheduler()->add_process(redraw_thread);
 
     log::infof("Framebuffer: {}x{} @ {} bpp (pitch={})", fb_width, fb_height, fb_bpp, fb_pitch);
     log::infof("Framebuffer: {} total pixels", fb_num_pixels);
@@ -0,0 +1,288 @@
+#include <crt/crt.h>
+#include <exclusive/kspinlock.hpp>
+#include <fs/dcache.hpp>
+#include <fs/path.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs::dcache {
+
+static tunable::Tunable<std::uint32_t> g_enabled{
+    "fs.dcache", 1, 0, 1, "cache path component lookups, 0 to always ask the filesystem"};
+
+constexpr std::size_t BUCKET_BITS = 10;
+constexpr std::size_t NUM_BUCKETS = 1 << BUCKET_BITS;
+
+// Longest chain kept per bucket, the oldest entry is dropped past this. Keeps
+// the cache bounded without an LRU list to maintain on every hit
+constexpr std::size_t MAX_CHAIN = 8;
+
+struct Bucket {
+    kspinlock lock;
+    Dentry* head;
+    std::size_t count;
+    std::uint64_t seq; // Bumped by every invalidation, see begin_fill()
+};
+
+static Bucket g_buckets[NUM_BUCKETS];
+
+static std::uint64_t g_hits;
+static std::uint64_t g_negative_hits;
+static std::uint64_t g_misses;
+static std::uint64_t g_entries;
+
+static void count(std::uint64_t* counter, std::int64_t delta)
+{
+    __atomic_fetch_add(counter, delta, __ATOMIC_RELAXED);
+}
+
+static std::uint64_t hash_of(const Inode* parent, kstring_view name)
+{
+    // Fibonacci hashing to spread the parent in
+    return (hash_name(name) ^ reinterpret_cast<std::uintptr_t>(parent)) * 0x9E3779B97F4A7C15ull;
+}
+
+static Bucket& bucket_for(std::uint64_t hash)
+{
+    return g_buckets[hash >> (64 - BUCKET_BITS)];
+}
+
+static bool matches(const Dentry* d, const Inode* parent, kstring_view name, std::uint64_t hash)
+{
+    return d->hash == hash && d->parent == parent && d->name.length() == name.length() &&
+           memcmp(d->name.c_str(), name.data(), name.length()) == 0;
+}
+
+/// @brief unlink and return the entry for (parent, name), with the bucket locked
+///
+static Dentry* unlink(Bucket& bucket, const Inode* parent, kstring_view name, std::uint64_t hash)
+{
+    for (Dentry** link = &bucket.head; *link != nullptr; link = &(*link)->next) {
+        Dentry* d = *link;
+
+        if (matches(d, parent, name, hash)) {
+            *link = d->next;
+            bucket.count--;
+            return d;
+        }
+    }
+
+    return nullptr;
+}
+
+bool enabled()
+{
+    return g_enabled.value() != 0;
+}
+
+/// @brief probe for name in parent
+///
+/// @param inode set on a HIT, to the mounted root if something is mounted there
+///
+Lookup lookup(Inode* parent, kstring_view name, Inode** inode)
+{
+    if (!enabled()) {
+        return Lookup::MISS;
+    }
+
+    const std::uint64_t hash = hash_of(parent, name);
+    Bucket& bucket = bucket_for(hash);
+    Lookup result = Lookup::MISS;
+
+    bucket.lock.lock();
+
+    for (Dentry* d = bucket.head; d != nullptr; d = d->next) {
+        if (matches(d, parent, name, hash)) {
+            if (d->inode == nullptr) {
+                result = Lookup::NEGATIVE;
+            } else {
+                result = Lookup::HIT;
+                *inode = d->mount ? d->mount->root_inode : d->inode;
+            }
+
+            break;
+        }
+    }
+
+    bucket.lock.unlock();
+
+    switch (result) {
+    case Lookup::HIT:
+        count(&g_hits, 1);
+        break;
+    case Lookup::NEGATIVE:
+        count(&g_negative_hits, 1);
+        break;
+    case Lookup::MISS:
+        count(&g_misses, 1);
+        break;
+    }
+
+    return result;
+}
+
+/// @brief call before asking the filesystem about a miss
+///
+/// @return a token for fill(), which drops the result if (parent, name) was
+///         invalidated in between and the answer may already be stale
+///
+std::uint64_t begin_fill(Inode* parent, kstring_view name)
+{
+    return __atomic_load_n(&bucket_for(hash_of(parent, name)).seq, __ATOMIC_ACQUIRE);
+}
+
+/// @brief cache what the filesystem said about name in parent
+///
+/// @param inode nullptr to cache that name does not exist
+/// @param mount what is mounted on inode, if anything
+/// @param seq from begin_fill()
+///
+void fill(Inode* parent, kstring_view name, Inode* inode, MountPoint* mount, std::uint64_t seq)
+{
+    if (!enabled()) {
+        return;
+    }
+
+    const std::uint64_t hash = hash_of(parent, name);
+    Bucket& bucket = bucket_for(hash);
+
+    // Built before locking, most fills are kept
+    auto* entry = new Dentry{parent, inode, mount, hash, kstring{name}, nullptr};
+    Dentry* stale = nullptr;
+
+    bucket.lock.lock();
+
+    if (bucket.seq != seq) {
+        bucket.lock.unlock();
+        delete entry;
+        return;
+    }
+
+    // Another walker may have filled it first, theirs is just as good
+    Dentry* old = unlink(bucket, parent, name, hash);
+
+    if (old == nullptr && bucket.count == MAX_CHAIN) {
+        Dentry** link = &bucket.head;
+
+        while ((*link)->next != nullptr) {
+            link = &(*link)->next;
+        }
+
+        stale = *link;
+        *link = nullptr;
+        bucket.count--;
+    }
+
+    entry->next = bucket.head;
+    bucket.head = entry;
+    bucket.count++;
+
+    bucket.lock.unlock();
+
+    if (old == nullptr && stale == nullptr) {
+        count(&g_entries, 1);
+    }
+
+    delete old;
+    delete stale;
+}
+
+/// @brief forget name in parent, after it was created, removed or mounted on
+///
+void invalidate(Inode* parent, kstring_view name)
+{
+    const std::uint64_t hash = hash_of(parent, name);
+    Bucket& bucket = bucket_for(hash);
+
+    bucket.lock.lock();
+
+    Dentry* old = unlink(bucket, parent, name, hash);
+    __atomic_add_fetch(&bucket.seq, 1, __ATOMIC_RELEASE);
+
+    bucket.lock.unlock();
+
+    if (old) {
+        count(&g_entries, -1);
+        delete old;
+    }
+}
+
+/// @brief forget every name cached under dir, before dir is freed
+///
+/// A new directory could be allocated at the same address and would
+/// otherwise inherit dir's entries. dir is only compared, never touched
+///
+void invalidate_dir(const Inode* dir)
+{
+    for (Bucket& bucket : g_buckets) {
+        Dentry* dropped = nullptr;
+
+        bucket.lock.lock();
+
+        for (Dentry** link = &bucket.head; *link != nullptr;) {
+            Dentry* d = *link;
+
+            if (d->parent == dir) {
+                *link = d->next;
+                d->next = dropped;
+                dropped = d;
+                bucket.count--;
+            } else {
+                link = &d->next;
+            }
+        }
+
+        if (dropped) {
+            __atomic_add_fetch(&bucket.seq, 1, __ATOMIC_RELEASE);
+        }
+
+        bucket.lock.unlock();
+
+        while (dropped) {
+            Dentry* next = dropped->next;
+            count(&g_entries, -1);
+            delete dropped;
+            dropped = next;
+        }
+    }
+}
+
+/// @brief forget everything
+///
+void flush()
+{
+    for (Bucket& bucket : g_buckets) {
+        bucket.lock.lock();
+
+        Dentry* d = bucket.head;
+        const std::size_t dropped = bucket.count;
+
+        bucket.head = nullptr;
+        bucket.count = 0;
+        __atomic_add_fetch(&bucket.seq, 1, __ATOMIC_RELEASE);
+
+        bucket.lock.unlock();
+
+        count(&g_entries, -static_cast<std::int64_t>(dropped));
+
+        while (d) {
+            Dentry* next = d->next;
+            delete d;
+            d = next;
+        }
+    }
+}
+
+Stats stats()
+{
+    return {
+        __atomic_load_n(&g_hits, __ATOMIC_RELAXED),
+        __atomic_load_n(&g_negative_hits, __ATOMIC_RELAXED),
+        __atomic_load_n(&g_misses, __ATOMIC_RELAXED),
+        __atomic_load_n(&g_entries, __ATOMIC_RELAXED),
+    };
+}
+
+}
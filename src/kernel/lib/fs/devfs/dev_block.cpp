@@ -0,0 +1,277 @@
+#include <arch.hpp>
+#include <block/block.hpp>
+#include <crt/crt.h>
+#include <fs/devfs/dev_block.hpp>
+#include <fs/fs.hpp>
+#include <linux/ioctl.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs::devfs {
+
+// Pages one read() or write() sends to the device at a time, 128 KiB
+constexpr std::size_t CHUNK_PAGES = 32;
+
+constexpr std::uint64_t PAGE_SECTORS = arch::vmm::PAGE_SIZE / block::SECTOR_SIZE;
+
+DevBlockInode::DevBlockInode(MountPoint* mp, Inode* parent, int ino, block::BlockDevice* dev)
+    : Inode{mp}
+    , dev{dev}
+{
+    this->type = FileType::BLOCK_DEVICE;
+    this->parent = parent;
+    this->ino = ino;
+    this->size = dev->size();
+}
+
+/// @brief transfer pages [first, first + n) of dev to or from the bounce buffer
+///
+/// Each page is its own request, submitted under one plug so the queue
+/// merges them back into one run.
+///
+static int transfer_pages(block::BlockDevice* dev, block::Op op, std::uint64_t first, std::size_t n, std::uint8_t* bounce)
+{
+    block::Request requests[CHUNK_PAGES];
+    block::Completion completion;
+
+    dev->plug();
+
+    for (std::size_t i = 0; i < n; i++) {
+        const std::uint64_t sector = (first + i) * PAGE_SECTORS;
+
+        requests[i].op = op;
+        requests[i].sector = sector;
+        requests[i].count = dev->sectors - sector < PAGE_SECTORS ? dev->sectors - sector : PAGE_SECTORS;
+        requests[i].buffer = bounce + i * arch::vmm::PAGE_SIZE;
+
+        completion.add(&requests[i]);
+        dev->submit(&requests[i]);
+    }
+
+    dev->unplug();
+
+    return completion.wait();
+}
+
+static std::size_t pages_spanned(std::size_t pos, std::size_t count)
+{
+    const std::size_t first = pos / arch::vmm::PAGE_SIZE;
+    const std::size_t end = (pos + count + arch::vmm::PAGE_SIZE - 1) / arch::vmm::PAGE_SIZE;
+    const std::size_t pages = end - first;
+
+    return pages < CHUNK_PAGES ? pages : CHUNK_PAGES;
+}
+
+int DevBlockInode::open(FileDescriptor* fd, int)
+{
+    fd->offset = 0;
+
+    return 0;
+}
+
+int DevBlockInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    if (fd->offset >= size) {
+        return 0;
+    }
+
+    if (count > size - fd->offset) {
+        count = size - fd->offset;
+    }
+
+    if (count > INT_MAX) {
+        count = INT_MAX;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    const bool user = arch::vmm::is_user_addr(buf);
+    auto* dst = static_cast<std::uint8_t*>(buf);
+    auto* bounce = static_cast<std::uint8_t*>(
+        arch::vmm::alloc_kernel(pages_spanned(fd->offset, count) * arch::vmm::PAGE_SIZE));
+    std::size_t done = 0;
+    int status = 0;
+
+    while (done < count) {
+        const std::size_t pos = fd->offset + done;
+        const std::size_t skip = pos % arch::vmm::PAGE_SIZE;
+        const std::size_t n = pages_spanned(pos, count - done);
+        const std::size_t room = n * arch::vmm::PAGE_SIZE - skip;
+        const std::size_t chunk = count - done < room ? count - done : room;
+
+        status = transfer_pages(dev, block::Op::READ, pos / arch::vmm::PAGE_SIZE, n, bounce);
+
+        if (status < 0) {
+            break;
+        }
+
+        if (user) {
+            if (kcopy_to_user(dst + done, bounce + skip, chunk) < 0) {
+                status = -EFAULT;
+                break;
+            }
+        } else {
+            memcpy(dst + done, bounce + skip, chunk);
+        }
+
+        done += chunk;
+    }
+
+    arch::vmm::free_kernel(bounce);
+
+    fd->offset += done;
+
+    return done > 0 ? static_cast<int>(done) : status;
+}
+
+int DevBlockInode::write(FileDescriptor* fd, const void* buf, std::size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    if (fd->offset >= size) {
+        return -ENOSPC;
+    }
+
+    if (count > size - fd->offset) {
+        count = size - fd->offset;
+    }
+
+    if (count > INT_MAX) {
+        count = INT_MAX;
+    }
+
+    const bool user = arch::vmm::is_user_addr(buf);
+    const auto* src = static_cast<const std::uint8_t*>(buf);
+    auto* bounce = static_cast<std::uint8_t*>(
+        arch::vmm::alloc_kernel(pages_spanned(fd->offset, count) * arch::vmm::PAGE_SIZE));
+    std::size_t done = 0;
+    int status = 0;
+
+    while (done < count) {
+        const std::size_t pos = fd->offset + done;
+        const std::size_t first = pos / arch::vmm::PAGE_SIZE;
+        const std::size_t skip = pos % arch::vmm::PAGE_SIZE;
+        const std::size_t n = pages_spanned(pos, count - done);
+        const std::size_t room = n * arch::vmm::PAGE_SIZE - skip;
+        const std::size_t chunk = count - done < room ? count - done : room;
+        const std::size_t tail = (skip + chunk) % arch::vmm::PAGE_SIZE;
+
+        // Pages only partly overwritten keep the rest of their bytes
+        if (skip != 0) {
+            status = transfer_pages(dev, block::Op::READ, first, 1, bounce);
+        }
+
+        if (status == 0 && tail != 0 && (n > 1 || skip == 0)) {
+            status = transfer_pages(dev, block::Op::READ, first + n - 1, 1,
+                bounce + (n - 1) * arch::vmm::PAGE_SIZE);
+        }
+
+        if (status < 0) {
+            break;
+        }
+
+        if (user) {
+            if (kcopy_from_user(bounce + skip, src + done, chunk) < 0) {
+                status = -EFAULT;
+                break;
+            }
+        } else {
+            memcpy(bounce + skip, src + done, chunk);
+        }
+
+        status = transfer_pages(dev, block::Op::WRITE, first, n, bounce);
+
+        if (status < 0) {
+            break;
+        }
+
+        done += chunk;
+    }
+
+    arch::vmm::free_kernel(bounce);
+
+    fd->offset += done;
+
+    return done > 0 ? static_cast<int>(done) : status;
+}
+
+int DevBlockInode::close(FileDescriptor*)
+{
+    return 0;
+}
+
+int DevBlockInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    const auto fd_offset = static_cast<std::intmax_t>(fd->offset);
+    const auto dev_size = static_cast<std::intmax_t>(size);
+
+    switch (whence) {
+    case SEEK_SET:
+        if (offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset = offset;
+        break;
+    case SEEK_CUR:
+        if (fd_offset + offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset += offset;
+        break;
+    case SEEK_END:
+        if (dev_size + offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset = size + offset;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int DevBlockInode::stat(Stat* stat)
+{
+    stat->size = size;
+    stat->type = FileType::BLOCK_DEVICE;
+
+    return 0;
+}
+
+int DevBlockInode::ioctl(unsigned long request, void* arg)
+{
+    switch (request) {
+    case linux::BLKGETSIZE64: {
+        const std::uint64_t bytes = size;
+
+        return kcopy_to_user(arg, &bytes, sizeof(bytes));
+    }
+    case linux::BLKGETSIZE: {
+        const unsigned long sectors = dev->sectors;
+
+        return kcopy_to_user(arg, &sectors, sizeof(sectors));
+    }
+    case linux::BLKSSZGET: {
+        const int sector_size = block::SECTOR_SIZE;
+
+        return kcopy_to_user(arg, &sector_size, sizeof(sector_size));
+    }
+    default:
+        return -ENOTTY;
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#include <arch.hpp>
+#include <fs/devfs/dev_kmsg.hpp>
+#include <fs/fs.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace fs::devfs {
+
+DevKmsgInode::DevKmsgInode(MountPoint* mp, Inode* parent, int ino)
+    : Inode{mp}
+{
+    this->type = FileType::CHAR_DEVICE;
+    this->parent = parent;
+    this->ino = ino;
+}
+
+int DevKmsgInode::open(FileDescriptor* fd, int)
+{
+    fd->offset = 0;
+
+    return 0;
+}
+
+/// @brief read the log from where this descriptor left off
+///
+/// @return bytes read, 0 once the reader has caught up with the log
+///
+int DevKmsgInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    if (!arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(buf), count)) {
+        return -EFAULT;
+    }
+
+    // The log buffer is behind a spinlock, so copy out through a bounce buffer
+    // rather than touching user memory with it held
+    char chunk[256];
+    auto* dst = static_cast<std::uint8_t*>(buf);
+    std::size_t total = 0;
+
+    while (total < count) {
+        const std::size_t want = count - total < sizeof(chunk) ? count - total : sizeof(chunk);
+        std::uint64_t offset = fd->offset;
+        const std::size_t got = log::read_kmsg(&offset, chunk, want);
+
+        fd->offset = offset;
+
+        if (got == 0) {
+            break;
+        }
+
+        if (kcopy_to_user(dst + total, chunk, got) < 0) {
+            return total > 0 ? static_cast<int>(total) : -EFAULT;
+        }
+
+        total += got;
+    }
+
+    return total;
+}
+
+int DevKmsgInode::write(FileDescriptor*, const void*, std::size_t)
+{
+    return -EPERM;
+}
+
+int DevKmsgInode::close(FileDescriptor*)
+{
+    return 0;
+}
+
+/// @brief only rewinding to the oldest record (SEEK_SET 0) is supported
+///
+int DevKmsgInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    if (whence != SEEK_SET || offset != 0) {
+        return -EINVAL;
+    }
+
+    fd->offset = 0;
+
+    return 0;
+}
+
+int DevKmsgInode::stat(Stat* stat)
+{
+    stat->size = 0;
+    stat->type = FileType::CHAR_DEVICE;
+
+    return 0;
+}
+
+}
@@ -7,10 +7,12 @@
 #include <fs/devfs/dev_tty.hpp>
 #include <fs/fs.hpp>
 #include <fs/fs_file_ops.hpp>
+#include <fs/poll.hpp>
 #include <linux/ioctl.hpp>
 #include <log/log.hpp>
 #include <memory/memory.hpp>
 #include <process/process.hpp>
+#include <process/wait_queue.hpp>
 #include <scheduler/scheduler.hpp>
 
 #include <cerrno>
@@ -356,14 +358,14 @@ void run_tty_program(const kstring& name)
     fs::FileDescriptor* fd = fs::open(name.c_str(), 0);
 
     if (!fd) {
-        log::warn("run_tty_program: failed to open ", name);
+        log::warn<log::Subsystem::DRIVER>("run_tty_program: failed to open ", name);
         return;
     }
 
     auto size = fd->inode->size;
     auto* data = new std::uint8_t[size];
 
-    log::debugf("loaded tty program addr={}, size={}", fd, size);
+    log::debugf<log::Subsystem::DRIVER>("loaded tty program addr={}, size={}", fd, size);
 
     fd->inode->read(fd, data, size);
 
@@ -385,73 +387,145 @@ int DevTtyInode::open(FileDescriptor*, int)
     return 0;
 }
 
-int DevTtyInode::read(FileDescriptor*, void* buff, std::size_t count)
+/// @brief apply pending key events to the line being edited
+///
+/// @return true once a line has been finished with Enter, it is in line
+///
+bool DevTtyInode::process_input()
 {
-    buffer = "";
-    buffer_index = 0;
+    input_lock.lock();
+
+    while (!line_ready) {
+        keyboard::KeyEvent* event = keyboard::poll();
+
+        if (event == nullptr) {
+            break;
+        }
+
+        keyboard::ScanCode scancode = event->scancode;
+        keyboard::ExtendedScanCode extended = event->extended_scancode;
+
+        if (event->released) {
+            continue;
+        }
+
+        bool caps = event->shift_held || event->caps_lock_on;
+        bool ctrl = event->control_held;
+
+        char ascii = scancode_to_ascii(scancode, caps);
+
+        if (ctrl) {
+            process_ctrl(scancode, extended);
+        } else if (ascii != '\0') {
+            insert_char(ascii);
+        } else if (scancode == ScanCode::Backspace) {
+            delete_back();
+        } else if (scancode == ScanCode::Enter) {
+            add_buffer_history();
+
+            line = buffer;
+            line_ready = true;
+            buffer = "";
+            buffer_index = 0;
+
+            console::newline();
+            break;
+        } else if (extended == ExtendedScanCode::LeftArrow) {
+            move_left();
+        } else if (extended == ExtendedScanCode::RightArrow) {
+            move_right();
+        } else if (extended == ExtendedScanCode::Delete) {
+            delete_forward();
+        } else if (extended == ExtendedScanCode::UpArrow) {
+            buffer_history_up();
+        } else if (extended == ExtendedScanCode::DownArrow) {
+            buffer_history_down();
+        } else if (extended == ExtendedScanCode::PageUp) {
+            page_up();
+        } else if (extended == ExtendedScanCode::PageDown) {
+            page_down();
+        }
+
+        console::redraw();
+    }
+
+    const bool ready = line_ready;
+
+    input_lock.unlock();
+
+    return ready;
+}
+
+int DevTtyInode::read(FileDescriptor* fd, void* buff, std::size_t count)
+{
+    process::WaitQueue& queue = keyboard::wait_queue();
 
     while (true) {
-        while (keyboard::KeyEvent* event = keyboard::poll()) {
-            keyboard::ScanCode scancode = event->scancode;
-            keyboard::ExtendedScanCode extended = event->extended_scancode;
-
-            if (event->released) {
-                continue;
-            }
-
-            bool caps = event->shift_held || event->caps_lock_on;
-            bool ctrl = event->control_held;
-
-            char ascii = scancode_to_ascii(scancode, caps);
-
-            if (ctrl) {
-                process_ctrl(scancode, extended);
-            } else if (ascii != '\0') {
-                insert_char(ascii);
-            } else if (scancode == ScanCode::Backspace) {
-                delete_back();
-            } else if (scancode == ScanCode::Enter) {
-                add_buffer_history();
-
-                std::size_t len = buffer.size();
-                kcopy_to_user(buff, buffer.c_str(), len > count ? count : len);
-                console::newline();
-
-                return len;
-            } else if (extended == ExtendedScanCode::LeftArrow) {
-                move_left();
-            } else if (extended == ExtendedScanCode::RightArrow) {
-                move_right();
-            } else if (extended == ExtendedScanCode::Delete) {
-                delete_forward();
-            } else if (extended == ExtendedScanCode::UpArrow) {
-                buffer_history_up();
-            } else if (extended == ExtendedScanCode::DownArrow) {
-                buffer_history_down();
-            } else if (extended == ExtendedScanCode::PageUp) {
-                page_up();
-            } else if (extended == ExtendedScanCode::PageDown) {
-                page_down();
-            }
-
-            console::redraw();
+        // Queued before looking, key events arrive from the keyboard IRQ
+        queue.prepare();
+
+        if (process_input()) {
+            queue.finish();
+            break;
+        }
+
+        if (fd->flags & O_NONBLOCK) {
+            queue.finish();
+            return -EAGAIN;
         }
 
-        scheduler::get_scheduler()->yield_blocked(process::WaitReason::KEYBOARD);
+        if (queue.sleep_killable() < 0) {
+            return -EINTR;
+        }
     }
+
+    input_lock.lock();
+
+    const kstring result = line;
+    line_ready = false;
+
+    input_lock.unlock();
+
+    const std::size_t len = result.size() > count ? count : result.size();
+    const int err = kcopy_to_user(buff, result.c_str(), len);
+
+    return err < 0 ? err : len;
 }
 
 int DevTtyInode::write(FileDescriptor*, const void* buffer, std::size_t count)
 {
-    char* str_buffer = new char[count];
-    kcopy_from_user(str_buffer, buffer, count);
+    // Kernel buffers (sendfile, splice) go straight to the console
+    if (!arch::vmm::is_user_addr(buffer)) {
+        console::put(kstring_view{static_cast<const char*>(buffer), count});
+        console::redraw();
+
+        return count;
+    }
 
-    kstring_view str(str_buffer, count);
+    // User buffers are staged through the stack a chunk at a time rather
+    // than a heap copy of the whole write
+    char chunk[256];
+    const auto* src = static_cast<const char*>(buffer);
+    std::size_t written = 0;
+
+    while (written < count) {
+        const std::size_t n = count - written < sizeof(chunk) ? count - written : sizeof(chunk);
+
+        if (kcopy_from_user(chunk, src + written, n) < 0) {
+            break;
+        }
+
+        console::put(kstring_view{chunk, n});
+        written += n;
+    }
 
-    console::put(str);
     console::redraw();
 
-    return str.size();
+    if (written == 0 && count > 0) {
+        return -EFAULT;
+    }
+
+    return written;
 }
 
 int DevTtyInode::close(FileDescriptor*)
@@ -483,12 +557,23 @@ int DevTtyInode::ioctl(unsigned long request, void* arg)
         ws.ws_xpixel = 0;
         ws.ws_ypixel = 0;
 
-        kcopy_to_user(arg, &ws, sizeof(linux::winsize));
-
-        return 0;
+        return kcopy_to_user(arg, &ws, sizeof(linux::winsize));
     }
 
     return -ENOTTY;
 }
 
+/// @brief readable once a whole line has been typed, always writable
+///
+std::uint32_t DevTtyInode::poll(FileDescriptor*, PollTable* table)
+{
+    if (table) {
+        table->wait(keyboard::wait_queue());
+    }
+
+    const std::uint32_t events = POLLOUT | POLLWRNORM;
+
+    return process_input() ? events | POLLIN | POLLRDNORM : events;
+}
+
 }
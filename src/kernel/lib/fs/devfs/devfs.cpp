@@ -1,3 +1,6 @@
+#include <block/block.hpp>
+#include <fs/devfs/dev_block.hpp>
+#include <fs/devfs/dev_kmsg.hpp>
 #include <fs/devfs/dev_null.hpp>
 #include <fs/devfs/dev_tty.hpp>
 #include <fs/devfs/devfs.hpp>
@@ -29,16 +32,35 @@ Inode* DevDirectoryInode::lookup(const char* name)
         return dev_mp->tty2_inode;
     }
 
+    if (name_str == "kmsg") {
+        return dev_mp->kmsg_inode;
+    }
+
+    if (name_str == "ram0") {
+        return dev_mp->ram0_inode;
+    }
+
     return nullptr;
 }
 
-int DevDirectoryInode::readdir(kvector<DirEntry>& entries)
+/// @brief list the devices, the cursor is an index into them
+///
+int DevDirectoryInode::iterate(DirContext& ctx)
 {
-    entries.emplace_back("null", FileType::CHAR_DEVICE);
-    entries.emplace_back("tty1", FileType::CHAR_DEVICE);
-    entries.emplace_back("tty2", FileType::CHAR_DEVICE);
+    auto dev_mp = static_cast<DevMountPoint*>(mountpoint);
+    const Inode* devices[] = {
+        dev_mp->null_inode, dev_mp->tty1_inode, dev_mp->tty2_inode, dev_mp->kmsg_inode, dev_mp->ram0_inode};
+    const char* names[] = {"null", "tty1", "tty2", "kmsg", "ram0"};
+
+    for (std::size_t i = ctx.pos; i < 5; i++) {
+        if (devices[i] && !ctx.emit(names[i], devices[i]->ino, devices[i]->type, i + 1)) {
+            break;
+        }
 
-    return entries.size();
+        ctx.pos = i + 1;
+    }
+
+    return 0;
 }
 
 int DevDirectoryInode::mkdir(const char*, int)
@@ -72,6 +94,12 @@ DevMountPoint::DevMountPoint()
     null_inode = new DevNullInode{this, root_inode, DEV_NULL_INO};
     tty1_inode = new DevTtyInode{this, root_inode, DEV_TTY1_INO};
     tty2_inode = new DevTtyInode{this, root_inode, DEV_TTY2_INO};
+    kmsg_inode = new DevKmsgInode{this, root_inode, DEV_KMSG_INO};
+    ram0_inode = nullptr;
+
+    if (auto* ram0 = block::find("ram0")) {
+        ram0_inode = new DevBlockInode{this, root_inode, DEV_RAM0_INO, ram0};
+    }
 }
 
 const char* DevFileSystem::name()
@@ -0,0 +1,179 @@
+#include <crt/crt.h>
+#include <fs/dir_index.hpp>
+#include <fs/fs.hpp>
+#include <fs/path.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace fs {
+
+constexpr std::size_t MIN_SLOTS = 8;
+
+// Holes are squeezed out once there are more of them than entries, and at
+// least this many, so that a small directory does not compact on every
+// unlink
+constexpr std::size_t MIN_HOLES_TO_COMPACT = 32;
+
+static bool name_is(const Inode* inode, kstring_view name)
+{
+    return inode->name.length() == name.length() && memcmp(inode->name.c_str(), name.data(), name.length()) == 0;
+}
+
+/// @brief find the slot holding name, or the empty slot ending its probe
+///
+/// @return the slot, meaningless if the table is empty
+///
+std::size_t DirIndex::probe(kstring_view name, std::uint64_t hash) const
+{
+    if (_slots.empty()) {
+        return 0;
+    }
+
+    const std::size_t mask = _slots.size() - 1;
+    const auto tag = static_cast<std::uint32_t>(hash);
+
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = _slots[i];
+
+        if (slot.index == EMPTY) {
+            return i;
+        }
+
+        if (slot.index != DELETED && slot.hash == tag && name_is(_order[slot.index - 1], name)) {
+            return i;
+        }
+    }
+}
+
+/// @brief rebuild the table with room for capacity slots, dropping DELETED ones
+///
+void DirIndex::rehash(std::size_t capacity)
+{
+    std::size_t size = MIN_SLOTS;
+
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    _slots = kvector<Slot>(size, Slot{0, EMPTY});
+    _deleted = 0;
+
+    const std::size_t mask = size - 1;
+
+    for (std::size_t pos = 0; pos < _order.size(); pos++) {
+        if (_order[pos] == nullptr) {
+            continue;
+        }
+
+        const std::uint64_t hash = hash_name(_order[pos]->name);
+        std::size_t i = hash & mask;
+
+        while (_slots[i].index != EMPTY) {
+            i = (i + 1) & mask;
+        }
+
+        _slots[i] = {static_cast<std::uint32_t>(hash), static_cast<std::uint32_t>(pos + 1)};
+    }
+}
+
+/// @brief squeeze the holes out of _order, unless someone holds positions
+///
+void DirIndex::maybe_compact()
+{
+    const std::size_t holes = _order.size() - _live;
+
+    if (_pins != 0 || holes < MIN_HOLES_TO_COMPACT || holes <= _live) {
+        return;
+    }
+
+    kvector<Inode*> order{};
+    order.reserve(_live);
+
+    for (Inode* inode : _order) {
+        if (inode != nullptr) {
+            order.push_back(inode);
+        }
+    }
+
+    _order = std::move(order);
+    rehash(_live * 2);
+}
+
+Inode* DirIndex::find(kstring_view name) const
+{
+    const std::size_t i = probe(name, hash_name(name));
+
+    if (_slots.empty() || _slots[i].index == EMPTY) {
+        return nullptr;
+    }
+
+    return _order[_slots[i].index - 1];
+}
+
+/// @brief add inode under its name
+///
+/// @return false if the name is already taken
+///
+bool DirIndex::insert(Inode* inode)
+{
+    // Keep at least a quarter of the slots EMPTY so every probe ends quickly
+    if ((_live + _deleted + 1) * 4 > _slots.size() * 3) {
+        rehash((_live + 1) * 2);
+    }
+
+    const std::uint64_t hash = hash_name(inode->name);
+    const std::size_t i = probe(inode->name, hash);
+
+    if (_slots[i].index != EMPTY) {
+        return false;
+    }
+
+    _order.push_back(inode);
+    _slots[i] = {static_cast<std::uint32_t>(hash), static_cast<std::uint32_t>(_order.size())};
+    _live++;
+
+    return true;
+}
+
+/// @return the removed inode, or nullptr if name is not there
+///
+Inode* DirIndex::remove(kstring_view name)
+{
+    const std::size_t i = probe(name, hash_name(name));
+
+    if (_slots.empty() || _slots[i].index == EMPTY) {
+        return nullptr;
+    }
+
+    const std::size_t pos = _slots[i].index - 1;
+    Inode* inode = _order[pos];
+
+    _order[pos] = nullptr;
+    _slots[i].index = DELETED;
+    _deleted++;
+    _live--;
+
+    // Trailing holes can go right away, no position past them is in use
+    while (!_order.empty() && _order[_order.size() - 1] == nullptr && _pins == 0) {
+        _order.pop_back();
+    }
+
+    maybe_compact();
+
+    return inode;
+}
+
+void DirIndex::pin()
+{
+    _pins++;
+}
+
+void DirIndex::unpin()
+{
+    _pins--;
+    maybe_compact();
+}
+
+}
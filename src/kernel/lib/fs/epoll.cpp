@@ -0,0 +1,404 @@
+#include <exclusive/kspinlock.hpp>
+#include <fs/epoll.hpp>
+#include <fs/fs.hpp>
+#include <fs/poll.hpp>
+#include <linux/poll.hpp>
+#include <timer/timer.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace fs {
+
+// epoll instances are not in any filesystem, this only tells them apart
+static MountPoint g_epoll_mount{};
+static std::uint64_t g_next_epoll_ino = 1;
+
+// Guards the item lists of every instance and every file. Holding it while
+// polling an item keeps the file alive, a last close has to come through
+// release() first
+static kspinlock g_epoll_lock;
+
+EpollItem::EpollItem(EpollInode* epoll, FileDescriptor* file, int fd)
+    : epoll{epoll}
+    , file{file}
+    , fd{fd}
+    , events{0}
+    , data{0}
+    , table{EpollInode::item_wake, this}
+    , next{nullptr}
+    , file_next{nullptr}
+    , ready_next{nullptr}
+    , ready{false}
+{
+}
+
+EpollInode::EpollInode()
+    : Inode{&g_epoll_mount}
+{
+    type = FileType::NONE;
+    size = 0;
+    ino = __atomic_fetch_add(&g_next_epoll_ino, 1, __ATOMIC_RELAXED);
+}
+
+EpollInode::~EpollInode() = default;
+
+/// @brief wakeup of a watched file, may run in an IRQ
+///
+/// Only queues the item, epoll_wait() polls it to see what actually changed
+///
+void EpollInode::item_wake(process::WaitEntry* entry)
+{
+    auto* item = static_cast<EpollItem*>(entry->data);
+
+    item->epoll->mark_ready(item);
+}
+
+void EpollInode::mark_ready(EpollItem* item)
+{
+    _ready_lock.lock();
+
+    if (!item->ready) {
+        item->ready = true;
+        item->ready_next = nullptr;
+
+        if (_ready_tail) {
+            _ready_tail->ready_next = item;
+        } else {
+            _ready_head = item;
+        }
+
+        _ready_tail = item;
+    }
+
+    _ready_lock.unlock();
+
+    _waiters.wake_all();
+}
+
+void EpollInode::unmark_ready(EpollItem* item)
+{
+    _ready_lock.lock();
+
+    if (item->ready) {
+        EpollItem* prev = nullptr;
+
+        for (EpollItem* i = _ready_head; i != item; i = i->ready_next) {
+            prev = i;
+        }
+
+        if (prev) {
+            prev->ready_next = item->ready_next;
+        } else {
+            _ready_head = item->ready_next;
+        }
+
+        if (_ready_tail == item) {
+            _ready_tail = prev;
+        }
+
+        item->ready = false;
+    }
+
+    _ready_lock.unlock();
+}
+
+EpollItem* EpollInode::find(FileDescriptor* file, int fd)
+{
+    for (EpollItem* item = _items; item != nullptr; item = item->next) {
+        if (item->file == file && item->fd == fd) {
+            return item;
+        }
+    }
+
+    return nullptr;
+}
+
+/// @brief stop watching item's file and free it, with g_epoll_lock held
+///
+void EpollInode::remove(EpollItem* item)
+{
+    // No wakeup can reach the item once it is off every queue
+    item->table.clear();
+    unmark_ready(item);
+
+    EpollItem** link = &_items;
+
+    while (*link != item) {
+        link = &(*link)->next;
+    }
+
+    *link = item->next;
+
+    link = &item->file->epoll_items;
+
+    while (*link != item) {
+        link = &(*link)->file_next;
+    }
+
+    *link = item->file_next;
+
+    delete item;
+}
+
+/// @brief add, change or remove the watch on one file
+///
+/// @return 0, -EEXIST/-ENOENT for an item that is/is not already there,
+///         -EINVAL for a bad op or an epoll instance as the target
+///
+int EpollInode::ctl(int op, int fd, FileDescriptor* file, std::uint32_t events, std::uint64_t data)
+{
+    // Nested epoll instances could wake each other in a loop
+    if (to_epoll(file)) {
+        return -EINVAL;
+    }
+
+    // Errors and hangups are always reported, as with poll()
+    events |= POLLERR | POLLHUP;
+
+    g_epoll_lock.lock();
+
+    EpollItem* item = find(file, fd);
+    std::uint32_t ready = 0;
+    int result = 0;
+
+    switch (op) {
+    case linux::EPOLL_CTL_ADD:
+        if (item) {
+            result = -EEXIST;
+            break;
+        }
+
+        item = new EpollItem{this, file, fd};
+        item->events = events;
+        item->data = data;
+        item->next = _items;
+        _items = item;
+        item->file_next = file->epoll_items;
+        file->epoll_items = item;
+
+        ready = file->inode->poll(file, &item->table) & events;
+        break;
+    case linux::EPOLL_CTL_MOD:
+        if (!item) {
+            result = -ENOENT;
+            break;
+        }
+
+        item->events = events;
+        item->data = data;
+
+        ready = file->inode->poll(file, nullptr) & events;
+        break;
+    case linux::EPOLL_CTL_DEL:
+        if (!item) {
+            result = -ENOENT;
+            break;
+        }
+
+        remove(item);
+        break;
+    default:
+        result = -EINVAL;
+        break;
+    }
+
+    // Already ready, the wakeup that would have queued it came before us
+    if (ready) {
+        mark_ready(item);
+    }
+
+    g_epoll_lock.unlock();
+
+    return result;
+}
+
+/// @brief report up to max_events ready items, with g_epoll_lock held
+///
+/// Every queued item is polled again, those no longer ready are dropped.
+/// Level-triggered ones that are go back on the list, so the next call
+/// checks them again
+///
+int EpollInode::harvest(linux::epoll_event* events, int max_events)
+{
+    _ready_lock.lock();
+
+    EpollItem* item = _ready_head;
+    _ready_head = _ready_tail = nullptr;
+
+    for (EpollItem* i = item; i != nullptr; i = i->ready_next) {
+        i->ready = false;
+    }
+
+    _ready_lock.unlock();
+
+    int count = 0;
+
+    while (item) {
+        EpollItem* next = item->ready_next;
+
+        if (count == max_events) {
+            mark_ready(item);
+            item = next;
+            continue;
+        }
+
+        const std::uint32_t ready = item->file->inode->poll(item->file, nullptr) & item->events;
+
+        if (ready) {
+            events[count].events = ready;
+            events[count].data = item->data;
+            count++;
+
+            if (item->events & linux::EPOLLONESHOT) {
+                item->events = 0; // Until re-armed with EPOLL_CTL_MOD
+            } else if (!(item->events & linux::EPOLLET)) {
+                mark_ready(item);
+            }
+        }
+
+        item = next;
+    }
+
+    return count;
+}
+
+/// @brief wait for events on the watched files
+///
+/// @param events kernel buffer for at least max_events entries
+/// @param timeout_ms how long to wait, 0 not at all, negative forever
+///
+/// @return the number of events written, or -EINTR if the thread group is
+///         killed
+///
+int EpollInode::wait(linux::epoll_event* events, int max_events, int timeout_ms)
+{
+    const std::uint64_t deadline = timer::get_ticks() + (timeout_ms > 0 ? timeout_ms : 0);
+
+    while (true) {
+        g_epoll_lock.lock();
+        const int count = harvest(events, max_events);
+        g_epoll_lock.unlock();
+
+        if (count > 0 || timeout_ms == 0) {
+            return count;
+        }
+
+        _ready_lock.lock();
+
+        while (_ready_head == nullptr) {
+            const std::uint64_t now = timer::get_ticks();
+
+            if (timeout_ms > 0 && now >= deadline) {
+                _ready_lock.unlock();
+                return 0;
+            }
+
+            _waiters.prepare();
+            _ready_lock.unlock();
+
+            const int err = timeout_ms > 0 ? _waiters.sleep_killable_timeout(deadline - now) : _waiters.sleep_killable();
+
+            if (err < 0) {
+                return err;
+            }
+
+            _ready_lock.lock();
+        }
+
+        _ready_lock.unlock();
+    }
+}
+
+/// @brief drop every item watching file, before its last close
+///
+void EpollInode::release(FileDescriptor* file)
+{
+    g_epoll_lock.lock();
+
+    while (file->epoll_items) {
+        EpollItem* item = file->epoll_items;
+
+        item->epoll->remove(item);
+    }
+
+    g_epoll_lock.unlock();
+}
+
+int EpollInode::open(FileDescriptor*, int)
+{
+    return 0;
+}
+
+int EpollInode::read(FileDescriptor*, void*, std::size_t)
+{
+    return -EINVAL;
+}
+
+int EpollInode::write(FileDescriptor*, const void*, std::size_t)
+{
+    return -EINVAL;
+}
+
+/// @brief last close of the instance, frees it and all of its items
+///
+int EpollInode::close(FileDescriptor*)
+{
+    g_epoll_lock.lock();
+
+    while (_items) {
+        remove(_items);
+    }
+
+    g_epoll_lock.unlock();
+
+    delete this;
+
+    return 0;
+}
+
+int EpollInode::lseek(FileDescriptor*, int, int)
+{
+    return -ESPIPE;
+}
+
+int EpollInode::stat(Stat* stat)
+{
+    stat->type = type;
+    stat->size = 0;
+
+    return 0;
+}
+
+/// @brief an epoll fd is readable while it has ready items
+///
+std::uint32_t EpollInode::poll(FileDescriptor*, PollTable* table)
+{
+    if (table) {
+        table->wait(_waiters);
+    }
+
+    _ready_lock.lock();
+    const bool ready = _ready_head != nullptr;
+    _ready_lock.unlock();
+
+    return ready ? POLLIN | POLLRDNORM : 0;
+}
+
+FileDescriptor* create_epoll()
+{
+    return new FileDescriptor{new EpollInode{}, "anon_inode:[eventpoll]", 0, O_RDWR};
+}
+
+/// @return fd's epoll instance, or nullptr if it is some other file
+///
+EpollInode* to_epoll(FileDescriptor* fd)
+{
+    if (fd->inode->mountpoint != &g_epoll_mount) {
+        return nullptr;
+    }
+
+    return static_cast<EpollInode*>(fd->inode);
+}
+
+}
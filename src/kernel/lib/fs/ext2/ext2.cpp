@@ -0,0 +1,2180 @@
+#include <arch.hpp>
+#include <block/block.hpp>
+#include <containers/kvector.hpp>
+#include <crt/crt.h>
+#include <exclusive/kspinlock.hpp>
+#include <fmt/fmt.hpp>
+#include <fs/ext2/ext2.hpp>
+#include <fs/fs.hpp>
+#include <fs/page_cache.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <syscall/sys_time.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs::ext2 {
+
+constexpr std::size_t PAGE_SIZE = arch::vmm::PAGE_SIZE;
+
+// Devices with a filesystem mounted, each may only be mounted once since
+// two mounts would cache the same blocks apart
+static kvector<block::BlockDevice*> g_mounted;
+static kspinlock g_mounted_lock;
+
+static std::uint32_t now()
+{
+    std::uint64_t ns = 0;
+
+    arch::vdso::clock_gettime_ns(syscall::CLOCK_REALTIME, &ns);
+
+    return static_cast<std::uint32_t>(ns / 1'000'000'000);
+}
+
+static Node* node_of(Inode* inode)
+{
+    if (inode->type == FileType::DIRECTORY) {
+        return &static_cast<Ext2DirInode*>(inode)->node;
+    }
+
+    return &static_cast<Ext2FileInode*>(inode)->node;
+}
+
+static Ext2MountPoint* mount_of(Node* node)
+{
+    return node->data.mp;
+}
+
+// Device nodes keep their number in i_block and fast symlinks their target
+static bool has_blocks(const DiskInode& disk)
+{
+    const std::uint16_t type = disk.mode & S_IFMT;
+
+    return type == S_IFREG || type == S_IFDIR || (type == S_IFLNK && disk.blocks != 0);
+}
+
+static FileType file_type_of(std::uint8_t type)
+{
+    switch (type) {
+    case FT_REG_FILE:
+        return FileType::REGULAR;
+    case FT_DIR:
+        return FileType::DIRECTORY;
+    case FT_CHRDEV:
+        return FileType::CHAR_DEVICE;
+    case FT_BLKDEV:
+        return FileType::BLOCK_DEVICE;
+    case FT_FIFO:
+        return FileType::FIFO;
+    default:
+        return FileType::NONE;
+    }
+}
+
+// ============================================================================
+// Metadata, read and written through the device mapping
+// ============================================================================
+
+/// @brief pin the cached page holding byte of the device
+///
+/// @param out points at that byte until the page is put()
+///
+static int pin(Ext2MountPoint* mp, std::uint64_t byte, cache::Page** page, std::uint8_t** out)
+{
+    const int err = cache::get(&mp->meta, byte / PAGE_SIZE, page);
+
+    if (err < 0) {
+        return err;
+    }
+
+    *out = (*page)->data + byte % PAGE_SIZE;
+
+    return 0;
+}
+
+static void dirty(cache::Page* page, const void* ptr, std::size_t length)
+{
+    cache::mark_dirty(page, static_cast<const std::uint8_t*>(ptr) - page->data, length);
+}
+
+static void dirty_sb(Ext2MountPoint* mp)
+{
+    dirty(mp->sb_page, mp->sb, sizeof(Superblock));
+}
+
+static std::uint64_t group_desc_offset(Ext2MountPoint* mp, std::uint32_t group)
+{
+    return static_cast<std::uint64_t>(mp->sb->first_data_block + 1) * mp->block_size + group * sizeof(GroupDesc);
+}
+
+static int pin_group(Ext2MountPoint* mp, std::uint32_t group, cache::Page** page, GroupDesc** out)
+{
+    std::uint8_t* ptr;
+    const int err = pin(mp, group_desc_offset(mp, group), page, &ptr);
+
+    if (err < 0) {
+        return err;
+    }
+
+    *out = reinterpret_cast<GroupDesc*>(ptr);
+
+    return 0;
+}
+
+static int pin_block(Ext2MountPoint* mp, std::uint32_t block, cache::Page** page, std::uint8_t** out)
+{
+    return pin(mp, static_cast<std::uint64_t>(block) * mp->block_size, page, out);
+}
+
+/// @brief pin the on-disk inode ino, which may be inode_size long
+///
+static int pin_inode(Ext2MountPoint* mp, std::uint32_t ino, cache::Page** page, std::uint8_t** out)
+{
+    if (ino == 0 || ino > mp->sb->inodes_count) {
+        return -EIO;
+    }
+
+    const std::uint32_t group = (ino - 1) / mp->sb->inodes_per_group;
+    const std::uint32_t index = (ino - 1) % mp->sb->inodes_per_group;
+    cache::Page* gd_page;
+    GroupDesc* gd;
+    int err = pin_group(mp, group, &gd_page, &gd);
+
+    if (err < 0) {
+        return err;
+    }
+
+    const std::uint64_t table = gd->inode_table;
+
+    cache::put(gd_page);
+
+    return pin(mp, table * mp->block_size + static_cast<std::uint64_t>(index) * mp->inode_size, page, out);
+}
+
+static int read_inode(Ext2MountPoint* mp, std::uint32_t ino, DiskInode* disk)
+{
+    cache::Page* page;
+    std::uint8_t* ptr;
+    const int err = pin_inode(mp, ino, &page, &ptr);
+
+    if (err < 0) {
+        return err;
+    }
+
+    memcpy(disk, ptr, sizeof(DiskInode));
+    cache::put(page);
+
+    return 0;
+}
+
+static int write_inode(Ext2MountPoint* mp, Node* node)
+{
+    cache::Page* page;
+    std::uint8_t* ptr;
+    const int err = pin_inode(mp, node->inode->ino, &page, &ptr);
+
+    if (err < 0) {
+        return err;
+    }
+
+    node->disk.size = static_cast<std::uint32_t>(node->inode->size);
+
+    if ((node->disk.mode & S_IFMT) == S_IFREG) {
+        node->disk.size_high = static_cast<std::uint32_t>(node->inode->size >> 32);
+    }
+
+    memcpy(ptr, &node->disk, sizeof(DiskInode));
+    dirty(page, ptr, sizeof(DiskInode));
+    cache::put(page);
+
+    return 0;
+}
+
+/// @brief the first clear bit of bits[0, count) from start on, or -1
+///
+static std::int64_t find_clear(const std::uint8_t* bits, std::uint32_t count, std::uint32_t start)
+{
+    for (std::uint32_t i = start; i < count; i++) {
+        if (bits[i / 8] == 0xFF) {
+            i |= 7;
+            continue;
+        }
+
+        if (!(bits[i / 8] & (1 << (i % 8)))) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/// @brief allocate a block, the first free one from goal on if there is one
+///
+static int alloc_block(Ext2MountPoint* mp, std::uint32_t goal, std::uint32_t* out)
+{
+    const Superblock* sb = mp->sb;
+
+    if (sb->free_blocks_count == 0) {
+        return -ENOSPC;
+    }
+
+    if (goal < sb->first_data_block || goal >= sb->blocks_count) {
+        goal = sb->first_data_block;
+    }
+
+    const std::uint32_t first_group = (goal - sb->first_data_block) / sb->blocks_per_group;
+
+    for (std::uint32_t i = 0; i < mp->groups; i++) {
+        const std::uint32_t group = (first_group + i) % mp->groups;
+        const std::uint32_t base = sb->first_data_block + group * sb->blocks_per_group;
+        const std::uint32_t count = sb->blocks_count - base < sb->blocks_per_group ? sb->blocks_count - base : sb->blocks_per_group;
+        const std::uint32_t start = i == 0 ? goal - base : 0;
+        cache::Page* gd_page;
+        cache::Page* bitmap_page;
+        GroupDesc* gd;
+        std::uint8_t* bits;
+        int err = pin_group(mp, group, &gd_page, &gd);
+
+        if (err < 0) {
+            return err;
+        }
+
+        if (gd->free_blocks_count == 0) {
+            cache::put(gd_page);
+            continue;
+        }
+
+        err = pin_block(mp, gd->block_bitmap, &bitmap_page, &bits);
+
+        if (err < 0) {
+            cache::put(gd_page);
+            return err;
+        }
+
+        std::int64_t bit = find_clear(bits, count, start);
+
+        if (bit < 0) {
+            bit = find_clear(bits, start, 0);
+        }
+
+        if (bit >= 0) {
+            bits[bit / 8] |= static_cast<std::uint8_t>(1 << (bit % 8));
+            dirty(bitmap_page, &bits[bit / 8], 1);
+
+            gd->free_blocks_count--;
+            dirty(gd_page, gd, sizeof(GroupDesc));
+
+            mp->sb->free_blocks_count--;
+            dirty_sb(mp);
+
+            *out = base + static_cast<std::uint32_t>(bit);
+        }
+
+        cache::put(bitmap_page);
+        cache::put(gd_page);
+
+        if (bit >= 0) {
+            return 0;
+        }
+    }
+
+    return -ENOSPC;
+}
+
+static void free_block(Ext2MountPoint* mp, std::uint32_t block)
+{
+    const std::uint32_t group = (block - mp->sb->first_data_block) / mp->sb->blocks_per_group;
+    const std::uint32_t bit = (block - mp->sb->first_data_block) % mp->sb->blocks_per_group;
+    cache::Page* gd_page;
+    cache::Page* bitmap_page;
+    GroupDesc* gd;
+    std::uint8_t* bits;
+
+    if (block < mp->sb->first_data_block || block >= mp->sb->blocks_count) {
+        log::warn<log::Subsystem::FS>("ext2: freeing block ", block, " out of range");
+        return;
+    }
+
+    if (pin_group(mp, group, &gd_page, &gd) < 0) {
+        return;
+    }
+
+    if (pin_block(mp, gd->block_bitmap, &bitmap_page, &bits) == 0) {
+        bits[bit / 8] &= static_cast<std::uint8_t>(~(1 << (bit % 8)));
+        dirty(bitmap_page, &bits[bit / 8], 1);
+        cache::put(bitmap_page);
+
+        gd->free_blocks_count++;
+        dirty(gd_page, gd, sizeof(GroupDesc));
+
+        mp->sb->free_blocks_count++;
+        dirty_sb(mp);
+    }
+
+    cache::put(gd_page);
+}
+
+/// @brief allocate an inode, in group if it has one free
+///
+static int alloc_inode(Ext2MountPoint* mp, std::uint32_t group, bool directory, std::uint32_t* out)
+{
+    const Superblock* sb = mp->sb;
+
+    if (sb->free_inodes_count == 0) {
+        return -ENOSPC;
+    }
+
+    for (std::uint32_t i = 0; i < mp->groups; i++) {
+        const std::uint32_t g = (group + i) % mp->groups;
+        // The reserved inodes are all in group 0
+        const std::uint32_t start = g == 0 ? mp->first_ino - 1 : 0;
+        cache::Page* gd_page;
+        cache::Page* bitmap_page;
+        GroupDesc* gd;
+        std::uint8_t* bits;
+        int err = pin_group(mp, g, &gd_page, &gd);
+
+        if (err < 0) {
+            return err;
+        }
+
+        if (gd->free_inodes_count == 0) {
+            cache::put(gd_page);
+            continue;
+        }
+
+        err = pin_block(mp, gd->inode_bitmap, &bitmap_page, &bits);
+
+        if (err < 0) {
+            cache::put(gd_page);
+            return err;
+        }
+
+        const std::int64_t bit = find_clear(bits, sb->inodes_per_group, start);
+
+        if (bit >= 0) {
+            bits[bit / 8] |= static_cast<std::uint8_t>(1 << (bit % 8));
+            dirty(bitmap_page, &bits[bit / 8], 1);
+
+            gd->free_inodes_count--;
+            gd->used_dirs_count += directory ? 1 : 0;
+            dirty(gd_page, gd, sizeof(GroupDesc));
+
+            mp->sb->free_inodes_count--;
+            dirty_sb(mp);
+
+            *out = g * sb->inodes_per_group + static_cast<std::uint32_t>(bit) + 1;
+        }
+
+        cache::put(bitmap_page);
+        cache::put(gd_page);
+
+        if (bit >= 0) {
+            return 0;
+        }
+    }
+
+    return -ENOSPC;
+}
+
+static void free_inode(Ext2MountPoint* mp, std::uint32_t ino, bool directory)
+{
+    const std::uint32_t group = (ino - 1) / mp->sb->inodes_per_group;
+    const std::uint32_t bit = (ino - 1) % mp->sb->inodes_per_group;
+    cache::Page* gd_page;
+    cache::Page* bitmap_page;
+    GroupDesc* gd;
+    std::uint8_t* bits;
+
+    if (pin_group(mp, group, &gd_page, &gd) < 0) {
+        return;
+    }
+
+    if (pin_block(mp, gd->inode_bitmap, &bitmap_page, &bits) == 0) {
+        bits[bit / 8] &= static_cast<std::uint8_t>(~(1 << (bit % 8)));
+        dirty(bitmap_page, &bits[bit / 8], 1);
+        cache::put(bitmap_page);
+
+        gd->free_inodes_count++;
+        gd->used_dirs_count -= directory && gd->used_dirs_count > 0 ? 1 : 0;
+        dirty(gd_page, gd, sizeof(GroupDesc));
+
+        mp->sb->free_inodes_count++;
+        dirty_sb(mp);
+    }
+
+    cache::put(gd_page);
+}
+
+// ============================================================================
+// Block maps
+// ============================================================================
+
+/// @brief allocate a block for node near its last one, zeroed if it is
+///        going to be an indirect block
+///
+static int new_block(Ext2MountPoint* mp, Node* node, bool indirect, std::uint32_t* out)
+{
+    std::uint32_t goal = node->goal + 1;
+
+    if (node->goal == 0) {
+        const std::uint32_t group = (node->inode->ino - 1) / mp->sb->inodes_per_group;
+
+        goal = mp->sb->first_data_block + group * mp->sb->blocks_per_group;
+    }
+
+    int err = alloc_block(mp, goal, out);
+
+    if (err < 0) {
+        return err;
+    }
+
+    node->goal = *out;
+    node->disk.blocks += mp->block_size / block::SECTOR_SIZE;
+
+    if (indirect) {
+        cache::Page* page;
+        std::uint8_t* ptr;
+
+        err = pin_block(mp, *out, &page, &ptr);
+
+        if (err < 0) {
+            return err;
+        }
+
+        memset(ptr, 0, mp->block_size);
+        dirty(page, ptr, mp->block_size);
+        cache::put(page);
+    }
+
+    return 0;
+}
+
+/// @brief the device block behind block fblock of node's data, 0 for a hole
+///
+/// @param create allocate it, and the indirect blocks on the way, if it is
+///        missing. The caller writes the inode afterwards
+///
+static int bmap(Ext2MountPoint* mp, Node* node, std::uint64_t fblock, bool create, std::uint32_t* out)
+{
+    const std::uint64_t per = mp->block_size / sizeof(std::uint32_t);
+    std::uint64_t offsets[3];
+    std::size_t depth;
+    std::uint32_t* slot;
+
+    if (fblock < DIRECT_BLOCKS) {
+        depth = 0;
+        slot = &node->disk.block[fblock];
+    } else if ((fblock -= DIRECT_BLOCKS) < per) {
+        depth = 1;
+        slot = &node->disk.block[IND_BLOCK];
+        offsets[0] = fblock;
+    } else if ((fblock -= per) < per * per) {
+        depth = 2;
+        slot = &node->disk.block[DIND_BLOCK];
+        offsets[0] = fblock / per;
+        offsets[1] = fblock % per;
+    } else if ((fblock -= per * per) < per * per * per) {
+        depth = 3;
+        slot = &node->disk.block[TIND_BLOCK];
+        offsets[0] = fblock / (per * per);
+        offsets[1] = fblock / per % per;
+        offsets[2] = fblock % per;
+    } else {
+        return -EFBIG;
+    }
+
+    std::uint32_t block = *slot;
+
+    if (block == 0) {
+        if (!create) {
+            *out = 0;
+            return 0;
+        }
+
+        const int err = new_block(mp, node, depth > 0, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        *slot = block;
+    }
+
+    for (std::size_t i = 0; i < depth; i++) {
+        cache::Page* page;
+        std::uint8_t* ptr;
+        int err = pin(mp, static_cast<std::uint64_t>(block) * mp->block_size + offsets[i] * sizeof(std::uint32_t), &page, &ptr);
+
+        if (err < 0) {
+            return err;
+        }
+
+        auto* entry = reinterpret_cast<std::uint32_t*>(ptr);
+
+        if (*entry == 0 && create) {
+            std::uint32_t next;
+
+            err = new_block(mp, node, i + 1 < depth, &next);
+
+            if (err == 0) {
+                *entry = next;
+                dirty(page, entry, sizeof(*entry));
+            }
+        }
+
+        block = *entry;
+        cache::put(page);
+
+        if (err < 0) {
+            return err;
+        }
+
+        if (block == 0) {
+            break;
+        }
+    }
+
+    *out = block;
+
+    return 0;
+}
+
+static void release_block(Ext2MountPoint* mp, Node* node, std::uint32_t block, bool indirect)
+{
+    // A dirty copy of an indirect block must not land on the block's next owner
+    if (indirect) {
+        cache::Page* page;
+        std::uint8_t* ptr;
+
+        if (pin_block(mp, block, &page, &ptr) == 0) {
+            cache::discard(page, ptr - page->data, mp->block_size);
+            cache::put(page);
+        }
+    }
+
+    free_block(mp, block);
+    node->disk.blocks -= mp->block_size / block::SECTOR_SIZE;
+}
+
+/// @brief free the blocks of the tree at *slot that hold file blocks from
+///        keep on
+///
+/// The tree holds file blocks [base, base + per^depth), depth 0 being a
+/// data block. *slot is cleared if the whole tree goes.
+///
+static void truncate_tree(Ext2MountPoint* mp, Node* node, std::uint32_t* slot, std::size_t depth,
+    std::uint64_t base, std::uint64_t keep)
+{
+    const std::uint64_t per = mp->block_size / sizeof(std::uint32_t);
+    std::uint64_t span = 1;
+
+    for (std::size_t i = 0; i < depth; i++) {
+        span *= per;
+    }
+
+    if (*slot == 0 || keep >= base + span) {
+        return;
+    }
+
+    if (depth > 0) {
+        const std::uint64_t child_span = span / per;
+        cache::Page* page;
+        std::uint8_t* ptr;
+
+        if (pin_block(mp, *slot, &page, &ptr) < 0) {
+            return;
+        }
+
+        auto* entries = reinterpret_cast<std::uint32_t*>(ptr);
+
+        for (std::uint64_t i = 0; i < per; i++) {
+            const std::uint64_t child_base = base + i * child_span;
+
+            if (keep >= child_base + child_span || entries[i] == 0) {
+                continue;
+            }
+
+            truncate_tree(mp, node, &entries[i], depth - 1, child_base, keep);
+
+            // Only worth writing if this block stays
+            if (keep > base) {
+                dirty(page, &entries[i], sizeof(std::uint32_t));
+            }
+        }
+
+        cache::put(page);
+    }
+
+    if (keep <= base) {
+        release_block(mp, node, *slot, depth > 0);
+        *slot = 0;
+    }
+}
+
+/// @brief free every block of node past its first keep blocks
+///
+static void free_blocks(Ext2MountPoint* mp, Node* node, std::uint64_t keep)
+{
+    const std::uint64_t per = mp->block_size / sizeof(std::uint32_t);
+
+    for (std::size_t i = keep < DIRECT_BLOCKS ? keep : DIRECT_BLOCKS; i < DIRECT_BLOCKS; i++) {
+        if (node->disk.block[i] != 0) {
+            release_block(mp, node, node->disk.block[i], false);
+            node->disk.block[i] = 0;
+        }
+    }
+
+    truncate_tree(mp, node, &node->disk.block[IND_BLOCK], 1, DIRECT_BLOCKS, keep);
+    truncate_tree(mp, node, &node->disk.block[DIND_BLOCK], 2, DIRECT_BLOCKS + per, keep);
+    truncate_tree(mp, node, &node->disk.block[TIND_BLOCK], 3, DIRECT_BLOCKS + per + per * per, keep);
+
+    node->goal = 0;
+}
+
+FileMapping::FileMapping(Ext2MountPoint* mp, Node* node)
+    : Mapping{mp->dev}
+    , mp{mp}
+    , node{node}
+{
+}
+
+std::uint64_t FileMapping::end()
+{
+    return (node->inode->size + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+/// @brief look up the sector of each subpage of page, HOLE where the file
+///        has no block
+///
+int FileMapping::map(cache::Page* page)
+{
+    const std::uint32_t sectors_per_block = mp->block_size / block::SECTOR_SIZE;
+    std::uint64_t last = ~0ULL;
+    std::uint32_t phys = 0;
+
+    for (std::size_t i = 0; i < cache::SUBPAGES; i++) {
+        const std::uint64_t offset = page->index * PAGE_SIZE + i * cache::SUBPAGE_SIZE;
+        const std::uint64_t fblock = offset / mp->block_size;
+
+        if (fblock != last) {
+            if (!has_blocks(node->disk)) {
+                phys = 0;
+            } else {
+                const int err = bmap(mp, node, fblock, false, &phys);
+
+                if (err < 0) {
+                    return err;
+                }
+            }
+
+            last = fblock;
+        }
+
+        page->sector[i] = phys == 0 ? cache::HOLE
+                                    : static_cast<std::uint64_t>(phys) * sectors_per_block
+                                          + offset % mp->block_size / block::SECTOR_SIZE;
+    }
+
+    return 0;
+}
+
+Node::Node(Ext2MountPoint* mp, Inode* inode)
+    : inode{inode}
+    , disk{}
+    , data{mp, this}
+{
+}
+
+// ============================================================================
+// Inodes in memory
+// ============================================================================
+
+Ext2MountPoint::Ext2MountPoint(block::BlockDevice* dev)
+    : dev{dev}
+    , meta{dev}
+{
+}
+
+/// @brief the inode ino, read in if it is not in memory yet
+///
+/// @param parent the directory it was found in, and name its name there
+///
+Inode* Ext2MountPoint::get_inode(std::uint32_t ino, Inode* parent, kstring_view name)
+{
+    for (Node* node = nodes[ino % NODE_BUCKETS]; node; node = node->hash_next) {
+        if (node->inode->ino == ino) {
+            return node->inode;
+        }
+    }
+
+    DiskInode disk;
+
+    if (read_inode(this, ino, &disk) < 0) {
+        return nullptr;
+    }
+
+    Inode* inode;
+
+    if ((disk.mode & S_IFMT) == S_IFDIR) {
+        inode = new Ext2DirInode{this, ino};
+    } else {
+        inode = new Ext2FileInode{this, ino};
+    }
+
+    Node* node = node_of(inode);
+
+    node->disk = disk;
+    inode->parent = parent;
+    inode->name = kstring{name};
+    inode->size = disk.size;
+
+    if ((disk.mode & S_IFMT) == S_IFREG) {
+        inode->size |= static_cast<std::uint64_t>(disk.size_high) << 32;
+    }
+
+    node->hash_next = nodes[ino % NODE_BUCKETS];
+    nodes[ino % NODE_BUCKETS] = node;
+
+    return inode;
+}
+
+/// @brief free an inode whose last link is gone and that no fd has open
+///
+static void destroy(Ext2MountPoint* mp, Node* node)
+{
+    const bool directory = node->inode->type == FileType::DIRECTORY;
+    const auto ino = static_cast<std::uint32_t>(node->inode->ino);
+
+    cache::truncate(&node->data, 0);
+
+    if (has_blocks(node->disk)) {
+        free_blocks(mp, node, 0);
+    }
+
+    node->inode->size = 0;
+    node->disk.links_count = 0;
+    node->disk.dtime = now();
+    write_inode(mp, node);
+    free_inode(mp, ino, directory);
+
+    for (Node** link = &mp->nodes[ino % Ext2MountPoint::NODE_BUCKETS]; *link; link = &(*link)->hash_next) {
+        if (*link == node) {
+            *link = node->hash_next;
+            break;
+        }
+    }
+
+    delete node->inode;
+}
+
+/// @brief drop one link to node, freeing it now or at its last close if
+///        that was the last
+///
+static void drop_link(Ext2MountPoint* mp, Node* node)
+{
+    if (node->disk.links_count > 0) {
+        node->disk.links_count--;
+    }
+
+    node->disk.ctime = now();
+
+    if (node->disk.links_count > 0) {
+        write_inode(mp, node);
+        return;
+    }
+
+    node->unlinked = true;
+
+    // The old parent may be freed first, a cwd left here must not walk
+    // back up into it
+    node->inode->parent = nullptr;
+
+    if (node->opens == 0) {
+        destroy(mp, node);
+    } else {
+        write_inode(mp, node);
+    }
+}
+
+// ============================================================================
+// Directories, read and written through their own mapping
+// ============================================================================
+
+static std::uint32_t rec_size(std::size_t name_len)
+{
+    return static_cast<std::uint32_t>((sizeof(DirEntryHeader) + name_len + 3) & ~std::size_t{3});
+}
+
+/// @brief pin directory block fblock of node
+///
+static int pin_dir_block(Node* node, std::uint64_t fblock, cache::Page** page, std::uint8_t** out)
+{
+    const std::uint64_t offset = fblock * mount_of(node)->block_size;
+    const int err = cache::get(&node->data, offset / PAGE_SIZE, page);
+
+    if (err < 0) {
+        return err;
+    }
+
+    *out = (*page)->data + offset % PAGE_SIZE;
+
+    return 0;
+}
+
+/// @brief the entry at offset of a directory block, nullptr if it is corrupt
+///
+static DirEntryHeader* entry_at(Ext2MountPoint* mp, std::uint8_t* block, std::uint32_t offset)
+{
+    auto* entry = reinterpret_cast<DirEntryHeader*>(block + offset);
+
+    if (offset + sizeof(DirEntryHeader) > mp->block_size || entry->rec_len < sizeof(DirEntryHeader)
+        || entry->rec_len % 4 != 0 || offset + entry->rec_len > mp->block_size
+        || sizeof(DirEntryHeader) + entry->name_len > entry->rec_len) {
+        log::warn<log::Subsystem::FS>("ext2: corrupt directory entry at offset ", offset);
+        return nullptr;
+    }
+
+    return entry;
+}
+
+static const char* entry_name(const DirEntryHeader* entry)
+{
+    return reinterpret_cast<const char*>(entry + 1);
+}
+
+static bool entry_is(const DirEntryHeader* entry, const char* name, std::size_t length)
+{
+    return entry->inode != 0 && entry->name_len == length && memcmp(entry_name(entry), name, length) == 0;
+}
+
+static bool is_dot(const DirEntryHeader* entry)
+{
+    return entry_is(entry, ".", 1) || entry_is(entry, "..", 2);
+}
+
+/// @brief find name in dir
+///
+/// @param type gets the entry's file type, if given
+///
+/// @return 0 with *ino set, -ENOENT or -EIO
+///
+static int find_entry(Node* dir, const char* name, std::uint32_t* ino, std::uint8_t* type = nullptr)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::size_t length = strlen(name);
+    const std::uint64_t blocks = dir->inode->size / mp->block_size;
+
+    for (std::uint64_t fblock = 0; fblock < blocks; fblock++) {
+        cache::Page* page;
+        std::uint8_t* block;
+        const int err = pin_dir_block(dir, fblock, &page, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            const DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                cache::put(page);
+                return -EIO;
+            }
+
+            if (entry_is(entry, name, length)) {
+                *ino = entry->inode;
+
+                if (type) {
+                    *type = entry->file_type;
+                }
+
+                cache::put(page);
+                return 0;
+            }
+
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+    }
+
+    return -ENOENT;
+}
+
+/// @brief grow dir by a zeroed block
+///
+/// @param page gets the page holding it, pinned, and block the block
+///
+static int append_block(Node* dir, cache::Page** page, std::uint8_t** block)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::uint64_t fblock = dir->inode->size / mp->block_size;
+    std::uint32_t phys;
+    int err = bmap(mp, dir, fblock, true, &phys);
+
+    if (err < 0) {
+        return err;
+    }
+
+    err = pin_dir_block(dir, fblock, page, block);
+
+    if (err < 0) {
+        return err;
+    }
+
+    // The page may have been cached while the block was still a hole
+    err = dir->data.map(*page);
+
+    if (err < 0) {
+        cache::put(*page);
+        return err;
+    }
+
+    memset(*block, 0, mp->block_size);
+    dir->inode->size += mp->block_size;
+
+    return 0;
+}
+
+/// @brief add an entry for ino to dir, in the first gap big enough or a
+///        new block. The caller writes dir's inode afterwards
+///
+static int add_entry(Node* dir, const char* name, std::uint32_t ino, std::uint8_t type)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::size_t length = strlen(name);
+    const std::uint32_t needed = rec_size(length);
+    const std::uint64_t blocks = dir->inode->size / mp->block_size;
+
+    if (!(mp->sb->feature_incompat & INCOMPAT_FILETYPE)) {
+        type = FT_UNKNOWN;
+    }
+
+    for (std::uint64_t fblock = 0; fblock < blocks; fblock++) {
+        cache::Page* page;
+        std::uint8_t* block;
+        int err = pin_dir_block(dir, fblock, &page, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                cache::put(page);
+                return -EIO;
+            }
+
+            const std::uint32_t used = entry->inode ? rec_size(entry->name_len) : 0;
+
+            if (entry->rec_len - used >= needed) {
+                DirEntryHeader* added = entry;
+
+                if (used > 0) {
+                    added = reinterpret_cast<DirEntryHeader*>(block + offset + used);
+                    added->rec_len = static_cast<std::uint16_t>(entry->rec_len - used);
+                    entry->rec_len = static_cast<std::uint16_t>(used);
+                }
+
+                added->inode = ino;
+                added->name_len = static_cast<std::uint8_t>(length);
+                added->file_type = type;
+                memcpy(added + 1, name, length);
+
+                dirty(page, block, mp->block_size);
+                cache::put(page);
+
+                // The hash index, if there was one, no longer matches
+                dir->disk.flags &= ~INDEX_FL;
+                dir->disk.mtime = dir->disk.ctime = now();
+
+                return 0;
+            }
+
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+    }
+
+    cache::Page* page;
+    std::uint8_t* block;
+    const int err = append_block(dir, &page, &block);
+
+    if (err < 0) {
+        return err;
+    }
+
+    auto* added = reinterpret_cast<DirEntryHeader*>(block);
+
+    added->inode = ino;
+    added->rec_len = static_cast<std::uint16_t>(mp->block_size);
+    added->name_len = static_cast<std::uint8_t>(length);
+    added->file_type = type;
+    memcpy(added + 1, name, length);
+
+    dirty(page, block, mp->block_size);
+    cache::put(page);
+
+    dir->disk.flags &= ~INDEX_FL;
+    dir->disk.mtime = dir->disk.ctime = now();
+
+    return 0;
+}
+
+/// @brief take name out of dir, its space goes to the entry before it
+///
+static int remove_entry(Node* dir, const char* name)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::size_t length = strlen(name);
+    const std::uint64_t blocks = dir->inode->size / mp->block_size;
+
+    for (std::uint64_t fblock = 0; fblock < blocks; fblock++) {
+        cache::Page* page;
+        std::uint8_t* block;
+        const int err = pin_dir_block(dir, fblock, &page, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        DirEntryHeader* prev = nullptr;
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                cache::put(page);
+                return -EIO;
+            }
+
+            if (entry_is(entry, name, length)) {
+                if (prev) {
+                    prev->rec_len = static_cast<std::uint16_t>(prev->rec_len + entry->rec_len);
+                } else {
+                    entry->inode = 0;
+                }
+
+                dirty(page, block, mp->block_size);
+                cache::put(page);
+
+                dir->disk.flags &= ~INDEX_FL;
+                dir->disk.mtime = dir->disk.ctime = now();
+
+                return 0;
+            }
+
+            prev = entry;
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+    }
+
+    return -ENOENT;
+}
+
+/// @brief point the existing entry for name in dir at ino, for a rename
+///        over it. Needs no room, so unlike remove then add it can not fail
+///        with -ENOSPC halfway
+///
+static int replace_entry(Node* dir, const char* name, std::uint32_t ino, std::uint8_t type)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::size_t length = strlen(name);
+    const std::uint64_t blocks = dir->inode->size / mp->block_size;
+
+    if (!(mp->sb->feature_incompat & INCOMPAT_FILETYPE)) {
+        type = FT_UNKNOWN;
+    }
+
+    for (std::uint64_t fblock = 0; fblock < blocks; fblock++) {
+        cache::Page* page;
+        std::uint8_t* block;
+        const int err = pin_dir_block(dir, fblock, &page, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                cache::put(page);
+                return -EIO;
+            }
+
+            if (entry_is(entry, name, length)) {
+                entry->inode = ino;
+                entry->file_type = type;
+
+                dirty(page, entry, sizeof(DirEntryHeader));
+                cache::put(page);
+
+                dir->disk.mtime = dir->disk.ctime = now();
+
+                return 0;
+            }
+
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+    }
+
+    return -ENOENT;
+}
+
+/// @return 1 if dir has nothing but "." and "..", 0 if it has, or -errno
+///
+static int dir_empty(Node* dir)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const std::uint64_t blocks = dir->inode->size / mp->block_size;
+
+    for (std::uint64_t fblock = 0; fblock < blocks; fblock++) {
+        cache::Page* page;
+        std::uint8_t* block;
+        const int err = pin_dir_block(dir, fblock, &page, &block);
+
+        if (err < 0) {
+            return err;
+        }
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            const DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                cache::put(page);
+                return -EIO;
+            }
+
+            if (entry->inode != 0 && !is_dot(entry)) {
+                cache::put(page);
+                return 0;
+            }
+
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+    }
+
+    return 1;
+}
+
+/// @brief point the ".." of dir, the second entry of its first block, at parent
+///
+static int set_dotdot(Node* dir, std::uint32_t parent)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    cache::Page* page;
+    std::uint8_t* block;
+    const int err = pin_dir_block(dir, 0, &page, &block);
+
+    if (err < 0) {
+        return err;
+    }
+
+    const DirEntryHeader* dot = entry_at(mp, block, 0);
+    DirEntryHeader* dotdot = dot ? entry_at(mp, block, dot->rec_len) : nullptr;
+
+    if (!dotdot || !entry_is(dotdot, "..", 2)) {
+        cache::put(page);
+        return -EIO;
+    }
+
+    dotdot->inode = parent;
+    dirty(page, dotdot, sizeof(DirEntryHeader));
+    cache::put(page);
+
+    return 0;
+}
+
+/// @brief create an inode of mode and link it into dir as name
+///
+/// @return the new inode, or nullptr with *err set
+///
+static Inode* new_inode(Node* dir, const char* name, std::uint16_t mode, int* err)
+{
+    Ext2MountPoint* mp = mount_of(dir);
+    const bool directory = (mode & S_IFMT) == S_IFDIR;
+    const std::uint32_t group = (dir->inode->ino - 1) / mp->sb->inodes_per_group;
+    std::uint32_t ino = 0;
+
+    *err = alloc_inode(mp, group, directory, &ino);
+
+    if (*err < 0) {
+        return nullptr;
+    }
+
+    // Zeroes all of a large inode, not only the 128 bytes kept in memory
+    cache::Page* page;
+    std::uint8_t* ptr;
+
+    *err = pin_inode(mp, ino, &page, &ptr);
+
+    if (*err < 0) {
+        free_inode(mp, ino, directory);
+        return nullptr;
+    }
+
+    auto* disk = reinterpret_cast<DiskInode*>(ptr);
+    const std::uint32_t generation = disk->generation + 1;
+    const std::uint32_t time = now();
+
+    memset(ptr, 0, mp->inode_size);
+
+    disk->mode = mode;
+    disk->links_count = directory ? 2 : 1;
+    disk->atime = disk->ctime = disk->mtime = time;
+    disk->generation = generation;
+
+    dirty(page, ptr, mp->inode_size);
+    cache::put(page);
+
+    Inode* inode = mp->get_inode(ino, dir->inode, name);
+
+    if (!inode) {
+        free_inode(mp, ino, directory);
+        *err = -EIO;
+        return nullptr;
+    }
+
+    Node* node = node_of(inode);
+
+    if (directory) {
+        cache::Page* block_page;
+        std::uint8_t* block;
+
+        *err = append_block(node, &block_page, &block);
+
+        if (*err == 0) {
+            auto* dot = reinterpret_cast<DirEntryHeader*>(block);
+            auto* dotdot = reinterpret_cast<DirEntryHeader*>(block + rec_size(1));
+            const bool typed = mp->sb->feature_incompat & INCOMPAT_FILETYPE;
+
+            dot->inode = ino;
+            dot->rec_len = static_cast<std::uint16_t>(rec_size(1));
+            dot->name_len = 1;
+            dot->file_type = typed ? FT_DIR : FT_UNKNOWN;
+            memcpy(dot + 1, ".", 1);
+
+            dotdot->inode = static_cast<std::uint32_t>(dir->inode->ino);
+            dotdot->rec_len = static_cast<std::uint16_t>(mp->block_size - rec_size(1));
+            dotdot->name_len = 2;
+            dotdot->file_type = dot->file_type;
+            memcpy(dotdot + 1, "..", 2);
+
+            dirty(block_page, block, mp->block_size);
+            cache::put(block_page);
+        }
+    }
+
+    if (*err == 0) {
+        *err = add_entry(dir, name, ino, directory ? FT_DIR : FT_REG_FILE);
+    }
+
+    if (*err < 0) {
+        node->disk.links_count = 1;
+        drop_link(mp, node);
+        return nullptr;
+    }
+
+    write_inode(mp, node);
+
+    if (directory) {
+        dir->disk.links_count++;
+    }
+
+    write_inode(mp, dir);
+
+    return inode;
+}
+
+// ============================================================================
+// Files
+// ============================================================================
+
+Ext2FileInode::Ext2FileInode(Ext2MountPoint* mp, std::uint32_t ino)
+    : Inode{mp}
+    , node{mp, this}
+{
+    this->type = FileType::REGULAR;
+    this->ino = ino;
+}
+
+int Ext2FileInode::open(FileDescriptor* fd, int)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    mp->lock.lock();
+    node.opens++;
+    fd->offset = 0;
+    mp->lock.unlock();
+
+    return 0;
+}
+
+int Ext2FileInode::close(FileDescriptor*)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    mp->lock.lock();
+
+    if (--node.opens == 0 && node.unlinked) {
+        destroy(mp, &node);
+    }
+
+    mp->lock.unlock();
+
+    return 0;
+}
+
+/// @brief copy out of cached pages, reading in only what is not cached
+///
+int Ext2FileInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    const bool user = arch::vmm::is_user_addr(buf);
+    auto* dst = static_cast<std::uint8_t*>(buf);
+    std::size_t done = 0;
+    int status = 0;
+
+    mp->lock.lock();
+
+    if (fd->offset >= size) {
+        mp->lock.unlock();
+        return 0;
+    }
+
+    if (count > size - fd->offset) {
+        count = size - fd->offset;
+    }
+
+    if (count > INT_MAX) {
+        count = INT_MAX;
+    }
+
+    while (done < count) {
+        const std::size_t pos = fd->offset + done;
+        const std::size_t offset = pos % PAGE_SIZE;
+        const std::size_t left = PAGE_SIZE - offset;
+        const std::size_t chunk = count - done < left ? count - done : left;
+        cache::Page* page;
+
+        status = cache::get(&node.data, pos / PAGE_SIZE, &page);
+
+        if (status < 0) {
+            break;
+        }
+
+        if (user) {
+            if (kcopy_to_user(dst + done, page->data + offset, chunk) < 0) {
+                status = -EFAULT;
+            }
+        } else {
+            memcpy(dst + done, page->data + offset, chunk);
+        }
+
+        cache::put(page);
+
+        if (status < 0) {
+            break;
+        }
+
+        done += chunk;
+    }
+
+    fd->offset += done;
+
+    mp->lock.unlock();
+
+    return done > 0 ? static_cast<int>(done) : status;
+}
+
+/// @brief copy into cached pages and mark them dirty, allocating blocks
+///        first where the file has none
+///
+/// Pages written whole, or past the end of the file, are not read in first.
+/// Every block touched is written back whole, so the bytes of a new block
+/// that this write does not cover reach the disk as zeros.
+///
+int Ext2FileInode::write(FileDescriptor* fd, const void* buf, std::size_t count)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    const bool user = arch::vmm::is_user_addr(buf);
+    const auto* src = static_cast<const std::uint8_t*>(buf);
+    const std::size_t block_size = mp->block_size;
+    std::size_t done = 0;
+    int status = 0;
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    if (count > INT_MAX) {
+        count = INT_MAX;
+    }
+
+    mp->lock.lock();
+
+    while (done < count) {
+        const std::size_t pos = fd->offset + done;
+        const std::size_t offset = pos % PAGE_SIZE;
+        const std::size_t left = PAGE_SIZE - offset;
+        const std::size_t chunk = count - done < left ? count - done : left;
+        const std::size_t page_start = pos - offset;
+        cache::Page* page;
+        std::uint32_t phys;
+
+        // Read the page before allocating, a hole reads as zeros but a new
+        // block holds whatever was last written there
+        if (chunk == PAGE_SIZE || page_start >= size) {
+            page = cache::grab(&node.data, pos / PAGE_SIZE);
+        } else {
+            status = cache::get(&node.data, pos / PAGE_SIZE, &page);
+
+            if (status < 0) {
+                break;
+            }
+        }
+
+        for (std::size_t fblock = pos / block_size; fblock <= (pos + chunk - 1) / block_size; fblock++) {
+            status = bmap(mp, &node, fblock, true, &phys);
+
+            if (status < 0) {
+                break;
+            }
+        }
+
+        // Blocks just allocated are not in the page yet
+        if (status == 0) {
+            status = node.data.map(page);
+        }
+
+        if (status == 0) {
+            if (user) {
+                if (kcopy_from_user(page->data + offset, src + done, chunk) < 0) {
+                    status = -EFAULT;
+                }
+            } else {
+                memcpy(page->data + offset, src + done, chunk);
+            }
+        }
+
+        if (status == 0) {
+            const std::size_t first = offset - offset % block_size;
+            const std::size_t end = (offset + chunk + block_size - 1) / block_size * block_size;
+
+            cache::mark_dirty(page, first, end - first);
+        }
+
+        cache::put(page);
+
+        if (status < 0) {
+            break;
+        }
+
+        done += chunk;
+
+        if (pos + chunk > size) {
+            size = pos + chunk;
+        }
+    }
+
+    fd->offset += done;
+
+    if (done > 0) {
+        if (size > INT32_MAX && !(mp->sb->feature_ro_compat & RO_COMPAT_LARGE_FILE)) {
+            mp->sb->feature_ro_compat |= RO_COMPAT_LARGE_FILE;
+            dirty_sb(mp);
+        }
+
+        node.disk.mtime = node.disk.ctime = now();
+    }
+
+    // Blocks may have been allocated even if nothing was written
+    write_inode(mp, &node);
+
+    mp->lock.unlock();
+
+    cache::balance_dirty();
+
+    return done > 0 ? static_cast<int>(done) : status;
+}
+
+/// @brief cut the file at length or let it grow a hole up to it
+///
+int Ext2FileInode::truncate(std::size_t length)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    const std::size_t block_size = mp->block_size;
+    int status = 0;
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    if (length < size) {
+        const std::uint64_t keep = (length + block_size - 1) / block_size;
+
+        // The page the file now ends in stays. What is past the end of it
+        // must read as zeros if the file grows again, and must not be
+        // written into the blocks freed below
+        if (length % PAGE_SIZE != 0) {
+            cache::Page* page;
+
+            status = cache::get(&node.data, length / PAGE_SIZE, &page);
+
+            if (status == 0) {
+                const std::size_t offset = length % PAGE_SIZE;
+                const std::size_t kept = keep * block_size - (length - offset);
+
+                memset(page->data + offset, 0, PAGE_SIZE - offset);
+                cache::mark_dirty(page, offset, kept - offset);
+                cache::discard(page, kept, PAGE_SIZE - kept);
+                cache::put(page);
+            }
+        }
+
+        // Only now, get() may have read ahead into the pages being cut off
+        if (status == 0) {
+            cache::truncate(&node.data, (length + PAGE_SIZE - 1) / PAGE_SIZE);
+            free_blocks(mp, &node, keep);
+        }
+    }
+
+    if (status == 0) {
+        size = length;
+        node.disk.mtime = node.disk.ctime = now();
+        write_inode(mp, &node);
+    }
+
+    mp->lock.unlock();
+
+    return status;
+}
+
+int Ext2FileInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    const auto fd_offset = static_cast<std::intmax_t>(fd->offset);
+    const auto ino_size = static_cast<std::intmax_t>(size);
+
+    switch (whence) {
+    case SEEK_SET:
+        if (offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset = offset;
+        break;
+    case SEEK_CUR:
+        if (fd_offset + offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset += offset;
+        break;
+    case SEEK_END:
+        if (ino_size + offset < 0) {
+            return -EINVAL;
+        }
+
+        fd->offset = size + offset;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int Ext2FileInode::stat(Stat* stat)
+{
+    stat->size = size;
+    stat->type = type;
+
+    return 0;
+}
+
+// ============================================================================
+// Directories
+// ============================================================================
+
+Ext2DirInode::Ext2DirInode(Ext2MountPoint* mp, std::uint32_t ino)
+    : DirectoryInode{mp}
+    , node{mp, this}
+{
+    this->ino = ino;
+}
+
+Inode* Ext2DirInode::lookup(const char* name)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    Inode* inode = nullptr;
+    std::uint32_t ino;
+
+    mp->lock.lock();
+
+    if (find_entry(&node, name, &ino) == 0) {
+        inode = mp->get_inode(ino, this, name);
+    }
+
+    mp->lock.unlock();
+
+    return inode;
+}
+
+/// @brief list entries from ctx.pos, a byte offset into the directory
+///
+/// A listing always restarts from the top of the block ctx.pos is in, so a
+/// cursor left inside an entry that has since been merged into the one
+/// before it still finds the next one.
+///
+int Ext2DirInode::iterate(DirContext& ctx)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    const bool typed = mp->sb->feature_incompat & INCOMPAT_FILETYPE;
+    int status = 0;
+
+    mp->lock.lock();
+
+    while (ctx.pos < size) {
+        const std::uint64_t base = ctx.pos - ctx.pos % mp->block_size;
+        cache::Page* page;
+        std::uint8_t* block;
+
+        status = pin_dir_block(&node, base / mp->block_size, &page, &block);
+
+        if (status < 0) {
+            break;
+        }
+
+        for (std::uint32_t offset = 0; offset < mp->block_size;) {
+            const DirEntryHeader* entry = entry_at(mp, block, offset);
+
+            if (!entry) {
+                status = -EIO;
+                break;
+            }
+
+            const std::uint64_t next = base + offset + entry->rec_len;
+
+            if (base + offset >= ctx.pos && entry->inode != 0 && !is_dot(entry)) {
+                const kstring_view name{entry_name(entry), entry->name_len};
+                const FileType type = typed ? file_type_of(entry->file_type) : FileType::NONE;
+
+                if (!ctx.emit(name, entry->inode, type, next)) {
+                    cache::put(page);
+                    mp->lock.unlock();
+                    return 0;
+                }
+            }
+
+            if (next > ctx.pos) {
+                ctx.pos = next;
+            }
+
+            offset += entry->rec_len;
+        }
+
+        cache::put(page);
+
+        if (status < 0) {
+            break;
+        }
+    }
+
+    mp->lock.unlock();
+
+    return status;
+}
+
+int Ext2DirInode::mkdir(const char* name, int mode)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    std::uint32_t ino;
+    int err = 0;
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    if (find_entry(&node, name, &ino) == 0) {
+        err = -EEXIST;
+    } else {
+        const auto perms = static_cast<std::uint16_t>(mode & 0777 ? mode & 0777 : 0755);
+
+        new_inode(&node, name, S_IFDIR | perms, &err);
+    }
+
+    mp->lock.unlock();
+
+    return err;
+}
+
+int Ext2DirInode::create(const char* name, int mode)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+    std::uint32_t ino;
+    int err = 0;
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    if (find_entry(&node, name, &ino) == 0) {
+        err = -EEXIST;
+    } else {
+        const auto perms = static_cast<std::uint16_t>(mode & 0777 ? mode & 0777 : 0644);
+
+        new_inode(&node, name, S_IFREG | perms, &err);
+    }
+
+    mp->lock.unlock();
+
+    return err;
+}
+
+static int unlink_locked(Ext2MountPoint* mp, Node* dir, const char* name)
+{
+    std::uint32_t ino;
+    int err = find_entry(dir, name, &ino);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Inode* child = mp->get_inode(ino, dir->inode, name);
+
+    if (!child) {
+        return -EIO;
+    }
+
+    if (child->type == FileType::DIRECTORY) {
+        return -EISDIR;
+    }
+
+    err = remove_entry(dir, name);
+
+    if (err < 0) {
+        return err;
+    }
+
+    write_inode(mp, dir);
+    drop_link(mp, node_of(child));
+
+    return 0;
+}
+
+int Ext2DirInode::unlink(const char* name)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    const int err = unlink_locked(mp, &node, name);
+
+    mp->lock.unlock();
+
+    return err;
+}
+
+static int rmdir_locked(Ext2MountPoint* mp, Node* dir, const char* name)
+{
+    std::uint32_t ino;
+    int err = find_entry(dir, name, &ino);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Inode* child = mp->get_inode(ino, dir->inode, name);
+
+    if (!child) {
+        return -EIO;
+    }
+
+    if (child->type != FileType::DIRECTORY) {
+        return -ENOTDIR;
+    }
+
+    Node* victim = node_of(child);
+
+    err = dir_empty(victim);
+
+    if (err <= 0) {
+        return err < 0 ? err : -ENOTEMPTY;
+    }
+
+    err = remove_entry(dir, name);
+
+    if (err < 0) {
+        return err;
+    }
+
+    // Its ".." goes with it
+    dir->disk.links_count--;
+    write_inode(mp, dir);
+
+    victim->disk.links_count = 1;
+    drop_link(mp, victim);
+
+    return 0;
+}
+
+int Ext2DirInode::rmdir(const char* name)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    const int err = rmdir_locked(mp, &node, name);
+
+    mp->lock.unlock();
+
+    return err;
+}
+
+static int rename_locked(Ext2MountPoint* mp, Ext2DirInode* dir, const char* name, Ext2DirInode* target,
+    const char* new_name)
+{
+    std::uint32_t ino;
+    std::uint8_t type;
+    int err = find_entry(&dir->node, name, &ino, &type);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Inode* child = mp->get_inode(ino, dir, name);
+
+    if (!child) {
+        return -EIO;
+    }
+
+    std::uint32_t victim_ino;
+    Inode* victim = nullptr;
+
+    if (find_entry(&target->node, new_name, &victim_ino) == 0) {
+        victim = mp->get_inode(victim_ino, target, new_name);
+
+        if (!victim) {
+            return -EIO;
+        }
+    }
+
+    if (victim == child) {
+        return 0;
+    }
+
+    const bool directory = child->type == FileType::DIRECTORY;
+
+    if (directory) {
+        // A directory can not be moved under itself
+        for (Inode* up = target; up != nullptr && up->mountpoint == mp; up = up->parent) {
+            if (up == child) {
+                return -EINVAL;
+            }
+        }
+    }
+
+    if (victim) {
+        if (directory && victim->type != FileType::DIRECTORY) {
+            return -ENOTDIR;
+        }
+
+        if (!directory && victim->type == FileType::DIRECTORY) {
+            return -EISDIR;
+        }
+
+        if (victim->type == FileType::DIRECTORY) {
+            err = dir_empty(node_of(victim));
+
+            if (err <= 0) {
+                return err < 0 ? err : -ENOTEMPTY;
+            }
+        }
+
+        err = replace_entry(&target->node, new_name, ino, type);
+    } else {
+        err = add_entry(&target->node, new_name, ino, type);
+    }
+
+    if (err < 0) {
+        return err;
+    }
+
+    err = remove_entry(&dir->node, name);
+
+    if (err < 0) {
+        return err;
+    }
+
+    if (directory && target != dir) {
+        set_dotdot(node_of(child), static_cast<std::uint32_t>(target->ino));
+        dir->node.disk.links_count--;
+        target->node.disk.links_count++;
+    }
+
+    child->name = new_name;
+    child->parent = target;
+
+    if (victim) {
+        Node* gone = node_of(victim);
+
+        if (victim->type == FileType::DIRECTORY) {
+            target->node.disk.links_count--;
+            gone->disk.links_count = 1;
+        }
+
+        drop_link(mp, gone);
+    }
+
+    write_inode(mp, &dir->node);
+
+    if (target != dir) {
+        write_inode(mp, &target->node);
+    }
+
+    return 0;
+}
+
+/// @brief move name to new_name in new_dir, which the VFS has checked is a
+///        directory of this mount
+///
+int Ext2DirInode::rename(const char* name, Inode* new_dir, const char* new_name)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    if (mp->read_only) {
+        return -EROFS;
+    }
+
+    mp->lock.lock();
+
+    const int err = rename_locked(mp, this, name, static_cast<Ext2DirInode*>(new_dir), new_name);
+
+    mp->lock.unlock();
+
+    return err;
+}
+
+int Ext2DirInode::open(FileDescriptor*, int)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    mp->lock.lock();
+    node.opens++;
+    mp->lock.unlock();
+
+    return 0;
+}
+
+int Ext2DirInode::close(FileDescriptor*)
+{
+    auto* mp = static_cast<Ext2MountPoint*>(mountpoint);
+
+    mp->lock.lock();
+
+    if (--node.opens == 0 && node.unlinked) {
+        destroy(mp, &node);
+    }
+
+    mp->lock.unlock();
+
+    return 0;
+}
+
+int Ext2DirInode::stat(Stat* stat)
+{
+    stat->size = size;
+    stat->type = type;
+
+    return 0;
+}
+
+// ============================================================================
+// Mounting
+// ============================================================================
+
+/// @brief whether this driver can mount the filesystem sb describes
+///
+static bool supported(const Superblock* sb, const block::BlockDevice* dev)
+{
+    if (sb->magic != MAGIC) {
+        log::warn<log::Subsystem::FS>("ext2: no ext2 superblock on ", dev->name);
+        return false;
+    }
+
+    if (sb->log_block_size > 2) {
+        log::warn<log::Subsystem::FS>("ext2: block size ", 1024u << sb->log_block_size, " not supported");
+        return false;
+    }
+
+    if (sb->feature_incompat & ~INCOMPAT_FILETYPE) {
+        log::warn<log::Subsystem::FS>("ext2: incompatible features ", fmt::hex{sb->feature_incompat});
+        return false;
+    }
+
+    const std::uint32_t block_size = 1024u << sb->log_block_size;
+    const std::uint32_t inode_size = sb->rev_level == 0 ? sizeof(DiskInode) : sb->inode_size;
+
+    if (inode_size < sizeof(DiskInode) || inode_size > block_size || (inode_size & (inode_size - 1))) {
+        log::warn<log::Subsystem::FS>("ext2: inode size ", inode_size, " not supported");
+        return false;
+    }
+
+    // Each group's bitmaps are one block
+    if (sb->blocks_per_group == 0 || sb->blocks_per_group > block_size * 8 || sb->inodes_per_group == 0
+        || sb->inodes_per_group > block_size * 8 || sb->blocks_count <= sb->first_data_block) {
+        log::warn<log::Subsystem::FS>("ext2: corrupt superblock on ", dev->name);
+        return false;
+    }
+
+    if (static_cast<std::uint64_t>(sb->blocks_count) * block_size > dev->size()) {
+        log::warn<log::Subsystem::FS>("ext2: filesystem is bigger than ", dev->name);
+        return false;
+    }
+
+    return true;
+}
+
+/// @brief check the superblock and read the root directory
+///
+/// @return 0, or -EINVAL if this is not an ext2 filesystem this driver can
+///         handle. Nothing is left pinned on failure
+///
+int Ext2MountPoint::load()
+{
+    std::uint8_t* ptr;
+    const int err = pin(this, SUPERBLOCK_OFFSET, &sb_page, &ptr);
+
+    if (err < 0) {
+        return err;
+    }
+
+    sb = reinterpret_cast<Superblock*>(ptr);
+
+    if (!supported(sb, dev)) {
+        cache::put(sb_page);
+        return -EINVAL;
+    }
+
+    block_size = 1024u << sb->log_block_size;
+    inode_size = sb->rev_level == 0 ? sizeof(DiskInode) : sb->inode_size;
+    first_ino = sb->rev_level == 0 ? 11 : sb->first_ino;
+    groups = (sb->blocks_count - sb->first_data_block + sb->blocks_per_group - 1) / sb->blocks_per_group;
+
+    // Unknown read-only features only matter to whoever writes
+    read_only = sb->feature_ro_compat & ~(RO_COMPAT_SPARSE_SUPER | RO_COMPAT_LARGE_FILE);
+
+    root_inode = get_inode(ROOT_INO, nullptr, "");
+
+    if (!root_inode || root_inode->type != FileType::DIRECTORY) {
+        log::warn<log::Subsystem::FS>("ext2: no root directory on ", dev->name);
+        cache::put(sb_page);
+        return -EINVAL;
+    }
+
+    if (!read_only) {
+        sb->mnt_count++;
+        sb->mtime = now();
+        dirty_sb(this);
+    }
+
+    log::infof<log::Subsystem::FS>("ext2: {} mounted, {} KiB blocks, {} of {} free{}", dev->name,
+        block_size / 1024, sb->free_blocks_count, sb->blocks_count, read_only ? ", read-only" : "");
+
+    return 0;
+}
+
+const char* Ext2FileSystem::name() { return "ext2"; }
+
+/// @brief mount the filesystem on the block device source, "ram0" or "/dev/ram0"
+///
+MountPoint* Ext2FileSystem::mount(const char* source)
+{
+    if (!source) {
+        return nullptr;
+    }
+
+    kstring_view name{source};
+
+    if (name.length() > 5 && memcmp(source, "/dev/", 5) == 0) {
+        name = name.substr(5);
+    }
+
+    block::BlockDevice* dev = block::find(name);
+
+    if (!dev) {
+        log::warn<log::Subsystem::FS>("ext2: no block device ", source);
+        return nullptr;
+    }
+
+    g_mounted_lock.lock();
+
+    for (block::BlockDevice* mounted : g_mounted) {
+        if (mounted == dev) {
+            g_mounted_lock.unlock();
+            log::warn<log::Subsystem::FS>("ext2: ", dev->name, " is already mounted");
+            return nullptr;
+        }
+    }
+
+    g_mounted.push_back(dev);
+    g_mounted_lock.unlock();
+
+    auto* mp = new Ext2MountPoint{dev};
+
+    mp->lock.lock();
+
+    const int err = mp->load();
+
+    mp->lock.unlock();
+
+    if (err < 0) {
+        delete mp;
+
+        g_mounted_lock.lock();
+
+        for (std::size_t i = 0; i < g_mounted.size(); i++) {
+            if (g_mounted[i] == dev) {
+                g_mounted[i] = g_mounted.back();
+                g_mounted.pop_back();
+                break;
+            }
+        }
+
+        g_mounted_lock.unlock();
+
+        return nullptr;
+    }
+
+    return mp;
+}
+
+}
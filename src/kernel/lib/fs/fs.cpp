@@ -1,8 +1,14 @@
 #include <algo/algo.hpp>
+#include <containers/klist.hpp>
 #include <containers/kstring.hpp>
+#include <crt/crt.h>
 #include <exclusive/kspinlock_irqsave.hpp>
+#include <fs/dcache.hpp>
 #include <fs/devfs/devfs.hpp>
+#include <fs/epoll.hpp>
 #include <fs/fs.hpp>
+#include <fs/path.hpp>
+#include <fs/poll.hpp>
 #include <kpanic/kpanic.hpp>
 #include <log/log.hpp>
 #include <process/process.hpp>
@@ -31,6 +37,101 @@ DirectoryInode::DirectoryInode(MountPoint* mp)
     size = 0;
 }
 
+/// @brief rewinddir()/seekdir(), only to a cursor a listing handed out
+///
+int DirectoryInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    if (whence != SEEK_SET || offset < 0) {
+        return -EINVAL;
+    }
+
+    fd->offset = offset;
+
+    return 0;
+}
+
+/// @brief list children from ctx.pos, which is a DirIndex position
+///
+int DirectoryInode::iterate(DirContext& ctx)
+{
+    for (std::size_t pos = ctx.pos; pos < children.end(); pos++) {
+        const Inode* child = children.at(pos);
+
+        if (child == nullptr) {
+            continue;
+        }
+
+        if (!ctx.emit(child->name, child->ino, child->type, pos + 1)) {
+            return 0;
+        }
+
+        ctx.pos = pos + 1;
+    }
+
+    if (ctx.pos < children.end()) {
+        ctx.pos = children.end();
+    }
+
+    return 0;
+}
+
+// Collects a whole listing for readdir()
+class DirEntryCollector final : public DirContext {
+public:
+    kvector<DirEntry>& entries;
+
+    explicit DirEntryCollector(kvector<DirEntry>& entries)
+        : entries{entries}
+    {
+    }
+
+    bool emit(kstring_view name, std::uint64_t, FileType type, std::size_t) override
+    {
+        entries.emplace_back(kstring{name}, type);
+        return true;
+    }
+};
+
+int Inode::readdir(kvector<DirEntry>& entries)
+{
+    DirEntryCollector collector{entries};
+    const std::size_t before = entries.size();
+    const int err = iterate(collector);
+
+    return err < 0 ? err : static_cast<int>(entries.size() - before);
+}
+
+std::uint32_t Inode::poll(FileDescriptor*, PollTable*)
+{
+    return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+}
+
+void FileDescriptor::get()
+{
+    __atomic_add_fetch(&refs, 1, __ATOMIC_RELAXED);
+}
+
+/// @brief drop a reference, closing the file when it was the last one
+///
+/// @return the result of Inode::close(), or 0 if the file is still open
+///
+int FileDescriptor::put()
+{
+    if (__atomic_sub_fetch(&refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return 0;
+    }
+
+    if (epoll_items) {
+        EpollInode::release(this);
+    }
+
+    const int result = inode->close(this);
+
+    delete this;
+
+    return result;
+}
+
 kstring getcwd(const Inode* inode)
 {
     klist<kstring> path{};
@@ -57,7 +158,62 @@ MountPoint* find_mount_at(Inode* inode)
     return nullptr;
 }
 
-Inode* resolve_path(kstring_view path, const kvector<kstring>& tokens)
+/// @brief NUL terminate a path component for the Inode calls that take one
+///
+/// @return false if name is too long
+///
+static bool copy_name(kstring_view name, char (&buf)[MAX_NAME + 1])
+{
+    if (name.length() > MAX_NAME) {
+        return false;
+    }
+
+    memcpy(buf, name.data(), name.length());
+    buf[name.length()] = '\0';
+
+    return true;
+}
+
+/// @brief find name in dir, through the dentry cache
+///
+/// @return the inode, or the root of whatever is mounted on it, or nullptr
+///
+static Inode* lookup_component(Inode* dir, kstring_view name)
+{
+    Inode* inode = nullptr;
+
+    switch (dcache::lookup(dir, name, &inode)) {
+    case dcache::Lookup::HIT:
+        return inode;
+    case dcache::Lookup::NEGATIVE:
+        return nullptr;
+    case dcache::Lookup::MISS:
+        break;
+    }
+
+    char buf[MAX_NAME + 1];
+
+    if (!copy_name(name, buf)) {
+        return nullptr;
+    }
+
+    const std::uint64_t seq = dcache::begin_fill(dir, name);
+
+    inode = dir->lookup(buf);
+
+    MountPoint* mp = inode ? find_mount_at(inode) : nullptr;
+
+    dcache::fill(dir, name, inode, mp, seq);
+
+    return mp ? mp->root_inode : inode;
+}
+
+/// @brief walk path from the root or the cwd
+///
+/// @param last if given, the final component is not looked up but stored
+///        here, and the directory holding it is returned
+///
+static Inode* walk(kstring_view path, kstring_view* last)
 {
     if (!g_root_mountpoint) {
         kpanic("!! VFS: Root is NULL !!");
@@ -67,18 +223,28 @@ Inode* resolve_path(kstring_view path, const kvector<kstring>& tokens)
     process::Process* proc = arch::percpu::current_process();
     Inode* current = nullptr;
 
-    if (path.front() == '/' || proc == nullptr || proc->cwd_inode == nullptr) {
+    Inode* cwd = proc != nullptr ? proc->files->cwd_inode() : nullptr;
+
+    if ((!path.empty() && path.front() == '/') || cwd == nullptr) {
         current = g_root_mountpoint->root_inode;
     } else {
-        current = proc->cwd_inode;
+        current = cwd;
     }
 
-    for (const kstring& token : tokens) {
-        if (token.empty() || token == ".") {
+    PathIterator it{path};
+    kstring_view name{""};
+
+    while (it.next(&name)) {
+        if (last && it.at_end()) {
+            *last = name;
+            return current;
+        }
+
+        if (name.length() == 1 && name[0] == '.') {
             continue;
         }
 
-        if (token == "..") {
+        if (name.length() == 2 && name[0] == '.' && name[1] == '.') {
             if (current == current->mountpoint->root_inode && current->mountpoint->mounted_on != nullptr) {
                 current = current->mountpoint->mounted_on->parent;
             } else if (current->parent != nullptr) {
@@ -88,29 +254,28 @@ Inode* resolve_path(kstring_view path, const kvector<kstring>& tokens)
             continue;
         }
 
-        Inode* next = current->lookup(token.c_str());
-
-        if (!next) {
+        if (current->type != FileType::DIRECTORY) {
             return nullptr;
         }
 
-        MountPoint* mp = find_mount_at(next);
+        current = lookup_component(current, name);
 
-        if (mp) {
-            current = mp->root_inode;
-        } else {
-            current = next;
+        if (!current) {
+            return nullptr;
         }
     }
 
+    // No final component, as in "/" or "a/.."
+    if (last) {
+        return nullptr;
+    }
+
     return current;
 }
 
 Inode* resolve_path(kstring_view path)
 {
-    kvector<kstring> tokens = algo::split(path, '/');
-
-    return resolve_path(path, tokens);
+    return walk(path, nullptr);
 }
 
 void register_mount(const char* path, MountPoint* mp)
@@ -119,7 +284,7 @@ void register_mount(const char* path, MountPoint* mp)
     mp->path = path;
 
     if (g_root_mountpoint == nullptr) {
-        log::info("VFS mount root at ", path);
+        log::info<log::Subsystem::FS>("VFS mount root at ", path);
         g_root_mountpoint = mp;
     }
 
@@ -127,26 +292,76 @@ void register_mount(const char* path, MountPoint* mp)
     g_fs_spinlock.unlock();
 }
 
-void mount(const char* path, FileSystem* fs, const char* source)
+/// @brief mount fs, from source if it needs one, on the directory at path
+///
+/// @return 0, -ENOENT/-ENOTDIR if path is not a directory, or -EINVAL if fs
+///         could not mount source
+///
+int mount(const char* path, FileSystem* fs, const char* source)
 {
+    Inode* target = resolve_path(path);
+
+    if (!target) {
+        return -ENOENT;
+    }
+
+    if (target->type != FileType::DIRECTORY) {
+        return -ENOTDIR;
+    }
+
     MountPoint* mp = fs->mount(source);
-    mp->mounted_on = resolve_path(path);
+
+    if (!mp) {
+        return -EINVAL;
+    }
+
+    mp->mounted_on = target;
 
     mp->root_inode->parent = mp->mounted_on;
     register_mount(path, mp);
+
+    // Cached walks through the mount point still stop at the directory below
+    dcache::flush();
+
+    return 0;
+}
+
+/// @brief create a regular file at path, the parent directory must exist
+///
+static Inode* create_file(kstring_view path)
+{
+    kstring_view name{""};
+    Inode* parent = walk(path, &name);
+    char buf[MAX_NAME + 1];
+
+    if (!parent || parent->type != FileType::DIRECTORY || !copy_name(name, buf)) {
+        return nullptr;
+    }
+
+    parent->create(buf, 0);
+    dcache::invalidate(parent, name);
+
+    // Looked up again rather than trusting create(), another thread may have
+    // made the file first
+    return lookup_component(parent, name);
 }
 
 FileDescriptor* open(kstring_view path, int flags)
 {
     Inode* inode = resolve_path(path);
 
+    if (!inode && (flags & O_CREAT)) {
+        inode = create_file(path);
+    }
+
     if (!inode) {
         return nullptr;
     }
 
     auto* fd = new FileDescriptor{};
 
-    fd->flags = flags;
+    // Only the status flags stay with the open file, F_GETFL reports them
+    fd->flags = flags & ~(O_CREAT | O_CLOEXEC);
     fd->inode = inode;
     fd->path = path;
     fd->offset = 0;
@@ -186,14 +401,11 @@ int readdir(const kstring& path, kvector<DirEntry>& out)
 
 int mkdir(const kstring& path, int mode)
 {
-    kvector<kstring> tokens = algo::split(path, '/');
-    kstring new_dir = tokens.back();
-
-    tokens.pop_back();
+    kstring_view new_dir{""};
+    Inode* inode = walk(path, &new_dir);
+    char buf[MAX_NAME + 1];
 
-    Inode* inode = resolve_path(path, tokens);
-
-    if (!inode) {
+    if (!inode || !copy_name(new_dir, buf)) {
         return -1;
     }
 
@@ -202,8 +414,150 @@ int mkdir(const kstring& path, int mode)
     }
 
     auto* dir = static_cast<DirectoryInode*>(inode);
+    const int result = dir->mkdir(buf, mode);
+
+    dcache::invalidate(dir, new_dir);
+
+    return result;
+}
+
+/// @brief find the directory holding path's last component
+///
+/// @param buf gets the last component, NUL terminated
+///
+/// @return 0, or -ENOENT/-ENOTDIR/-ENAMETOOLONG, or -EINVAL for a path
+///         ending in "." or ".."
+///
+static int walk_parent(kstring_view path, Inode** dir, kstring_view* name, char (&buf)[MAX_NAME + 1])
+{
+    *dir = walk(path, name);
+
+    if (!*dir) {
+        return -ENOENT;
+    }
+
+    if ((*dir)->type != FileType::DIRECTORY) {
+        return -ENOTDIR;
+    }
+
+    if (!copy_name(*name, buf)) {
+        return -ENAMETOOLONG;
+    }
+
+    if (strcmp(buf, ".") == 0 || strcmp(buf, "..") == 0) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int unlink(const kstring& path)
+{
+    Inode* dir;
+    kstring_view name{""};
+    char buf[MAX_NAME + 1];
+    const int err = walk_parent(path, &dir, &name, buf);
+
+    if (err < 0) {
+        return err;
+    }
+
+    const int result = dir->unlink(buf);
+
+    if (result == 0) {
+        dcache::invalidate(dir, name);
+    }
+
+    return result;
+}
+
+int rmdir(const kstring& path)
+{
+    Inode* dir;
+    kstring_view name{""};
+    char buf[MAX_NAME + 1];
+    const int err = walk_parent(path, &dir, &name, buf);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Inode* victim = dir->lookup(buf);
+
+    if (victim && find_mount_at(victim)) {
+        return -EBUSY;
+    }
+
+    const int result = dir->rmdir(buf);
+
+    if (result == 0) {
+        dcache::invalidate(dir, name);
+        dcache::invalidate_dir(victim);
+    }
+
+    return result;
+}
+
+int rename(const kstring& old_path, const kstring& new_path)
+{
+    Inode* old_dir;
+    Inode* new_dir;
+    kstring_view old_name{""};
+    kstring_view new_name{""};
+    char old_buf[MAX_NAME + 1];
+    char new_buf[MAX_NAME + 1];
+    int err = walk_parent(old_path, &old_dir, &old_name, old_buf);
+
+    if (err < 0) {
+        return err;
+    }
+
+    err = walk_parent(new_path, &new_dir, &new_name, new_buf);
+
+    if (err < 0) {
+        return err;
+    }
+
+    if (old_dir->mountpoint != new_dir->mountpoint) {
+        return -EXDEV;
+    }
+
+    Inode* child = old_dir->lookup(old_buf);
+    Inode* victim = new_dir->lookup(new_buf);
+
+    if ((child && find_mount_at(child)) || (victim && find_mount_at(victim))) {
+        return -EBUSY;
+    }
+
+    // A replaced directory is freed by rename(), look at it before
+    const bool replaces_dir = victim && victim != child && victim->type == FileType::DIRECTORY;
+    const int result = old_dir->rename(old_buf, new_dir, new_buf);
+
+    if (result == 0) {
+        dcache::invalidate(old_dir, old_name);
+        dcache::invalidate(new_dir, new_name);
+
+        if (replaces_dir) {
+            dcache::invalidate_dir(victim);
+        }
+    }
+
+    return result;
+}
+
+int truncate(const kstring& path, std::size_t length)
+{
+    Inode* inode = resolve_path(path);
+
+    if (!inode) {
+        return -ENOENT;
+    }
+
+    if (inode->type == FileType::DIRECTORY) {
+        return -EISDIR;
+    }
 
-    return dir->mkdir(new_dir.c_str(), mode);
+    return inode->truncate(length);
 }
 
 }
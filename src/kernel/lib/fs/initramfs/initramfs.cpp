@@ -1,10 +1,14 @@
 #include "algo/algo.hpp"
+#include "arch.hpp"
 #include "arch/x64/memory/vmm.hpp"
 #include "containers/kstring_view.hpp"
 #include "containers/kvector.hpp"
 #include "tar.hpp"
 
+#include <bit>
 #include <cerrno>
+#include <climits>
+#include <compress/lz4.hpp>
 #include <cstdint>
 #include <fs/fs.hpp>
 #include <fs/fs_file_ops.hpp>
@@ -16,8 +20,9 @@ namespace fs::initramfs {
 
 using namespace tar;
 
-InitramfsDirectoryInode::InitramfsDirectoryInode(MountPoint* mp)
+InitramfsDirectoryInode::InitramfsDirectoryInode(MountPoint* mp, std::size_t entry)
     : DirectoryInode{mp}
+    , entry{entry}
 {
     mountpoint = mp;
     type = FileType::DIRECTORY;
@@ -25,32 +30,26 @@ InitramfsDirectoryInode::InitramfsDirectoryInode(MountPoint* mp)
 
 Inode* InitramfsDirectoryInode::lookup(const char* name)
 {
-    for (std::size_t i = 0; i < children.size(); i++) {
-        Inode* child = children[i];
-
-        if (child->name == name) {
-            return child;
-        }
-    }
-
-    return nullptr;
+    return static_cast<InitramfsMountPoint*>(mountpoint)->lookup(this, name);
 }
 
-int InitramfsDirectoryInode::readdir(kvector<DirEntry>& entries)
+int InitramfsDirectoryInode::iterate(DirContext& ctx)
 {
-    for (std::size_t i = 0; i < children.size(); i++) {
-        Inode* child = children[i];
-
-        entries.emplace_back(child->name, child->type);
-    }
+    static_cast<InitramfsMountPoint*>(mountpoint)->populate(this);
 
-    return children.size();
+    return DirectoryInode::iterate(ctx);
 }
 
 int InitramfsDirectoryInode::mkdir(const char*, int) { return -EROFS; }
 
 int InitramfsDirectoryInode::create(const char*, int) { return -EROFS; }
 
+int InitramfsDirectoryInode::unlink(const char*) { return -EROFS; }
+
+int InitramfsDirectoryInode::rmdir(const char*) { return -EROFS; }
+
+int InitramfsDirectoryInode::rename(const char*, Inode*, const char*) { return -EROFS; }
+
 int InitramfsDirectoryInode::open(FileDescriptor*, int) { return 0; }
 
 int InitramfsDirectoryInode::close(FileDescriptor*) { return 0; }
@@ -66,15 +65,42 @@ InitramfsFileInode::InitramfsFileInode(MountPoint* mp, std::uint8_t* data)
 
 int InitramfsFileInode::open(FileDescriptor*, int) { return 0; }
 
-int InitramfsFileInode::read(FileDescriptor*, void* buf, std::size_t count)
+int InitramfsFileInode::read(FileDescriptor* fd, void* buf, std::size_t count)
 {
+    const void* src;
+    const int to_read = read_direct(fd, &src, count);
+
+    if (to_read <= 0) {
+        return to_read;
+    }
+
     if (arch::vmm::is_user_addr(buf)) {
-        kcopy_to_user(buf, tar_data, count);
+        if (kcopy_to_user(buf, src, to_read) < 0) {
+            return -EFAULT;
+        }
     } else {
-        memcpy(buf, tar_data, count);
+        memcpy(buf, src, to_read);
     }
 
-    return count;
+    fd->offset += to_read;
+
+    return to_read;
+}
+
+// The archive stays mapped for the life of the kernel, so file contents are
+// handed out straight from it
+int InitramfsFileInode::read_direct(FileDescriptor* fd, const void** out, std::size_t count)
+{
+    if (fd->offset >= size) {
+        return 0;
+    }
+
+    const std::size_t available = size - fd->offset;
+    const std::size_t length = count < available ? count : available;
+
+    *out = tar_data + fd->offset;
+
+    return static_cast<int>(length < INT_MAX ? length : INT_MAX);
 }
 
 int InitramfsFileInode::write(FileDescriptor*, const void*, std::size_t) { return 0; }
@@ -85,104 +111,372 @@ int InitramfsFileInode::lseek(FileDescriptor*, int, int) { return 0; }
 
 int InitramfsFileInode::stat(Stat*) { return 0; }
 
-bool InitramfsMountPoint::is_empty_header(TarHeader* header)
+/// @brief compare two paths with '/' ordered before every other character
+///
+/// In that order a directory is followed by everything below it, before
+/// any sibling whose name it is a prefix of ("a", "a/b", "a/c", "a.txt")
+///
+static int compare_paths(const char* a, std::size_t a_len, const char* b, std::size_t b_len)
 {
-    return header->filename[0] == '\0';
+    const std::size_t len = a_len < b_len ? a_len : b_len;
+    std::size_t i = 0;
+
+    // Paths in one directory share a long prefix, skip it a word at a time
+    for (; i + 8 <= len; i += 8) {
+        std::uint64_t word_a;
+        std::uint64_t word_b;
+
+        __builtin_memcpy(&word_a, a + i, 8);
+        __builtin_memcpy(&word_b, b + i, 8);
+
+        if (word_a != word_b) {
+            i += std::countr_zero(word_a ^ word_b) / 8;
+            break;
+        }
+    }
+
+    for (; i < len; i++) {
+        if (a[i] == b[i]) {
+            continue;
+        }
+
+        const int ca = a[i] == '/' ? 0 : static_cast<unsigned char>(a[i]) + 1;
+        const int cb = b[i] == '/' ? 0 : static_cast<unsigned char>(b[i]) + 1;
+
+        return ca - cb;
+    }
+
+    return a_len < b_len ? -1 : a_len > b_len;
 }
 
-void InitramfsMountPoint::insert_inode(const char* path, Inode* inode)
+/// @brief the first 8 bytes of path as an integer in compare_paths() order
+///
+/// '/' becomes 1 and the bytes below it move up one, so comparing keys
+/// orders paths like comparing their first 8 bytes. Sorting mostly compares
+/// keys and only looks at the paths, all over the archive, on a tie
+///
+static std::uint64_t path_key(const char* path, std::size_t length)
 {
-    auto* current = static_cast<InitramfsDirectoryInode*>(root_inode);
+    std::uint64_t key = 0;
 
-    kvector<kstring> tokens = algo::split(kstring_view{path}, '/');
+    for (std::size_t i = 0; i < 8; i++) {
+        const auto c = i < length ? static_cast<unsigned char>(path[i]) : 0;
 
-    for (std::size_t i = 0; i < tokens.size() - 1; i++) {
-        kstring& token = tokens[i];
+        key = (key << 8) | (c == '/' ? 1 : c < '/' && c != 0 ? c + 1 : c);
+    }
 
-        Inode* existing = current->lookup(token.c_str());
+    return key;
+}
 
-        if (existing) {
-            // static_cast here is safe because only fs::initramfs has access
-            // to the internal implementation of these data structures, so we trust
-            // that `existing` is a valid directory inode
-            current = static_cast<InitramfsDirectoryInode*>(existing);
-        } else {
-            // this token is part of a path that doesn't have an inode yet, maybe because
-            // the tar file didn't include a tar entry for it
-            auto* dir = new InitramfsDirectoryInode{this};
-            dir->ino = next_ino++;
-            dir->parent = current;
-            dir->name = token;
+/// @brief length of the parent directory part of path, 0 at the top level
+///
+static std::size_t parent_length(const char* path, std::size_t length)
+{
+    while (length > 0 && path[length - 1] != '/') {
+        length--;
+    }
 
-            current->children.push_back(dir);
+    return length > 0 ? length - 1 : 0;
+}
 
-            current = dir;
-        }
-    }
+InitramfsMountPoint::InitramfsMountPoint(std::uint8_t* buffer, std::size_t size)
+    : tar_buffer{buffer}
+    , tar_size{size}
+{
+    root_inode = new InitramfsDirectoryInode{this, ROOT};
+    root_inode->ino = 1;
+    root_inode->parent = nullptr;
+
+    index();
+}
+
+const char* InitramfsMountPoint::entry_path(const Entry& entry) const
+{
+    return paths.data() + entry.path;
+}
 
-    const kstring& last = tokens.back();
+/// @brief add a directory entry for every parent of path
+///
+/// Archives need not have entries for the directories their files are in.
+/// Consecutive files usually share a directory, so this only runs when the
+/// parent changes from the last path's, duplicates are dropped by dedup()
+///
+/// @param offset where path was copied to in the path buffer
+///
+void InitramfsMountPoint::add_parents(const char* path, std::size_t length, std::uint32_t offset, kstring_view* last_parent)
+{
+    const kstring_view parent{path, parent_length(path, length)};
 
-    inode->parent = current;
-    inode->name = last;
+    if (parent.size() == 0 || parent == *last_parent) {
+        *last_parent = parent;
+        return;
+    }
 
-    current->children.push_back(inode);
+    for (std::size_t i = 1; i <= parent.size(); i++) {
+        if (i == parent.size() || path[i] == '/') {
+            entries.push_back({path_key(path, i), offset, NO_HEADER, static_cast<std::uint16_t>(i), true});
+        }
+    }
+
+    *last_parent = parent;
 }
 
-void InitramfsMountPoint::parse_tar_headers()
+/// @brief build the sorted path table in one pass over the tar headers
+///
+void InitramfsMountPoint::index()
 {
-    log::info("Parsing tar headers");
+    const std::uint64_t start = arch::drivers::tsc::get_time_ns();
 
-    root_inode = new InitramfsDirectoryInode{this};
-    root_inode->ino = next_ino++;
-    root_inode->parent = nullptr;
+    // Offsets in the table are 32 bits
+    const std::size_t size = tar_size < UINT32_MAX ? tar_size : UINT32_MAX;
+
+    std::size_t offset = 0;
+    kstring_view last_parent{"", 0};
+
+    while (size - offset >= sizeof(TarHeader)) {
+        auto* header = reinterpret_cast<TarHeader*>(tar_buffer + offset);
 
-    std::uint8_t* addr = tar_buffer;
-    std::uint8_t* end = addr + tar_size;
+        // End of archive
+        if (header->filename[0] == '\0') {
+            break;
+        }
 
-    log::debugf("tar start = {}, end = {}", fmt::hex{addr}, fmt::hex{end});
+        const std::size_t file_size = fmt::parse_uint(header->size, sizeof(header->size), fmt::NumberFormat::OCT);
+        const std::size_t blocks = (file_size + sizeof(TarHeader) - 1) / sizeof(TarHeader);
 
-    while (addr < end) {
-        TarHeader* header = reinterpret_cast<TarHeader*>(addr);
-        Inode* new_inode = nullptr;
+        // Truncated archive
+        if (blocks >= (size - offset) / sizeof(TarHeader)) {
+            break;
+        }
 
-        std::uintmax_t size = fmt::parse_uint((const char*)header->size, 12, fmt::NumberFormat::OCT);
-        std::uintmax_t num_blocks = (size + 511) / 512;
-        char* filename = header->filename;
+        const char* path = header->filename;
+        std::size_t length = 0;
 
-        if (is_empty_header(header)) {
-            goto next;
+        // Not terminated when the name fills the field
+        while (length < sizeof(header->filename) && path[length] != '\0') {
+            length++;
         }
 
-        if (filename[0] == '.' && filename[1] == '\0') {
-            goto next;
+        // "./bin/sh" and "/bin/sh" are both bin/sh
+        while (length > 0 && (path[0] == '/' || (length >= 2 && path[0] == '.' && path[1] == '/'))) {
+            const std::size_t skip = path[0] == '/' ? 1 : 2;
+
+            path += skip;
+            length -= skip;
         }
 
-        if (filename[0] == '.' && filename[1] == '/') {
-            filename += 2;
+        while (length > 0 && path[length - 1] == '/') {
+            length--;
         }
 
-        if (filename[0] == '\0') {
-            goto next;
+        if (length > 0 && !(length == 1 && path[0] == '.')) {
+            const auto copy = static_cast<std::uint32_t>(paths.size());
+
+            paths.resize(copy + length);
+            memcpy(paths.data() + copy, path, length);
+
+            add_parents(path, length, copy, &last_parent);
+
+            entries.push_back({
+                .key = path_key(path, length),
+                .path = copy,
+                .header = static_cast<std::uint32_t>(offset),
+                .length = static_cast<std::uint16_t>(length),
+                .directory = header->typeflag == TYPEFLAG_DIR,
+            });
+        }
+
+        offset += (blocks + 1) * sizeof(TarHeader);
+    }
+
+    algo::sort(entries.data(), entries.data() + entries.size(), [this](const Entry& a, const Entry& b) {
+        if (a.key != b.key) {
+            return a.key < b.key;
         }
 
-        log::debugf("tar header found, size = {}, block = {}, name = '{}'", size, num_blocks, kstring{filename});
+        const int order = compare_paths(entry_path(a), a.length, entry_path(b), b.length);
+
+        // Same path, archive order, implied directories last
+        return order != 0 ? order < 0 : a.header < b.header;
+    });
+
+    dedup();
+
+    const std::uint64_t ns = arch::drivers::tsc::get_time_ns() - start;
+
+    log::infof<log::Subsystem::FS>("initramfs: indexed {} paths in {} us", entries.size(), ns / 1000);
+}
+
+/// @brief keep one entry per path
+///
+/// A file appended to the archive again replaces the earlier one, a
+/// directory seen again changes nothing
+///
+void InitramfsMountPoint::dedup()
+{
+    std::size_t out = 0;
+
+    for (std::size_t i = 0; i < entries.size();) {
+        const Entry& first = entries[i];
+        std::size_t keep = i;
+        std::size_t j = i + 1;
 
-        if (header->typeflag == TYPEFLAG_DIR) {
-            new_inode = new InitramfsDirectoryInode{this};
+        for (; j < entries.size(); j++) {
+            const Entry& next = entries[j];
 
-            new_inode->ino = next_ino++;
+            if (compare_paths(entry_path(first), first.length, entry_path(next), next.length) != 0) {
+                break;
+            }
+
+            if (!next.directory) {
+                keep = j;
+            }
+        }
+
+        entries[out++] = entries[keep];
+        i = j;
+    }
+
+    // resize() does not shrink
+    while (entries.size() > out) {
+        entries.pop_back();
+    }
+}
+
+/// @brief create the inode for a table entry and add it to its directory
+///
+Inode* InitramfsMountPoint::materialise(std::size_t index, InitramfsDirectoryInode* parent)
+{
+    const Entry& entry = entries[index];
+    const char* path = entry_path(entry);
+    const std::size_t parent_end = parent_length(path, entry.length);
+    const std::size_t name = parent_end > 0 ? parent_end + 1 : 0;
+    Inode* inode;
+
+    if (entry.directory) {
+        inode = new InitramfsDirectoryInode{this, index};
+    } else {
+        auto* header = reinterpret_cast<TarHeader*>(tar_buffer + entry.header);
+
+        inode = new InitramfsFileInode{this, tar_buffer + entry.header + sizeof(TarHeader)};
+        inode->size = fmt::parse_uint(header->size, sizeof(header->size), fmt::NumberFormat::OCT);
+    }
+
+    // The root is 1
+    inode->ino = index + 2;
+    inode->parent = parent;
+    inode->name = kstring{path + name, entry.length - name};
+
+    parent->children.insert(inode);
+
+    return inode;
+}
+
+Inode* InitramfsMountPoint::lookup(InitramfsDirectoryInode* dir, const char* name)
+{
+    // Paths in the table are at most a tar name long
+    char key[sizeof(TarHeader::filename)];
+
+    lock.lock();
+
+    Inode* inode = dir->children.find(name);
+
+    if (inode != nullptr || dir->populated) {
+        lock.unlock();
+        return inode;
+    }
+
+    const std::size_t name_length = strlen(name);
+    std::size_t length = 0;
+
+    if (dir->entry != ROOT) {
+        length = entries[dir->entry].length + 1;
+    }
+
+    if (length + name_length > sizeof(key)) {
+        lock.unlock();
+        return nullptr;
+    }
+
+    if (length > 0) {
+        memcpy(key, entry_path(entries[dir->entry]), length - 1);
+        key[length - 1] = '/';
+    }
+
+    memcpy(key + length, name, name_length);
+    length += name_length;
+
+    std::size_t low = 0;
+    std::size_t high = entries.size();
+
+    while (low < high) {
+        const std::size_t mid = low + (high - low) / 2;
+        const Entry& entry = entries[mid];
+
+        if (compare_paths(entry_path(entry), entry.length, key, length) < 0) {
+            low = mid + 1;
         } else {
-            new_inode = new InitramfsFileInode{this, addr + 512};
+            high = mid;
+        }
+    }
+
+    if (low < entries.size() && compare_paths(entry_path(entries[low]), entries[low].length, key, length) == 0) {
+        inode = materialise(low, dir);
+    }
+
+    lock.unlock();
+
+    return inode;
+}
+
+/// @brief create inodes for every child of dir that has none yet
+///
+void InitramfsMountPoint::populate(InitramfsDirectoryInode* dir)
+{
+    lock.lock();
+
+    if (dir->populated) {
+        lock.unlock();
+        return;
+    }
+
+    const char* prefix = nullptr;
+    std::size_t prefix_length = 0;
+    std::size_t first = 0;
 
-            new_inode->size = size;
-            new_inode->ino = next_ino++;
+    if (dir->entry != ROOT) {
+        const Entry& entry = entries[dir->entry];
+
+        prefix = entry_path(entry);
+        prefix_length = entry.length;
+        first = dir->entry + 1;
+    }
+
+    const std::size_t name = prefix_length > 0 ? prefix_length + 1 : 0;
+
+    // The subtree follows dir in the table, children are the entries in it
+    // with no '/' past the prefix
+    for (std::size_t i = first; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        const char* path = entry_path(entry);
+
+        if (prefix_length > 0
+            && (entry.length <= prefix_length || path[prefix_length] != '/' || memcmp(path, prefix, prefix_length) != 0)) {
+            break;
         }
 
-        insert_inode(filename, new_inode);
+        if (parent_length(path, entry.length) != prefix_length) {
+            continue;
+        }
 
-    next:
-        addr += 512 + (num_blocks * 512);
+        if (dir->children.find(kstring_view{path + name, entry.length - name}) == nullptr) {
+            materialise(i, dir);
+        }
     }
+
+    dir->populated = true;
+
+    lock.unlock();
 }
 
 const char* InitramfsFileSystem::name() { return "initramfs"; }
@@ -194,10 +488,62 @@ MountPoint* InitramfsFileSystem::mount_from_mem(std::uint8_t* buffer, std::size_
     return new InitramfsMountPoint{buffer, size};
 }
 
-void init(std::uint8_t*, std::size_t)
+/// @brief decompress an LZ4 frame into kernel memory
+///
+/// The archive is decoded block by block straight into the buffer its files
+/// are served from afterwards, so there is no second copy of the data
+///
+/// @return the decompressed archive, or nullptr if the frame is unusable
+///
+static std::uint8_t* decompress_lz4(const std::uint8_t* image, std::size_t image_size, std::size_t* tar_size)
 {
-    //tar::init(addr);
-    //fs::mount("/", &initramfs_fs);
+    const std::uint64_t size = compress::lz4::content_size(image, image_size);
+
+    if (size == 0) {
+        log::warn("initramfs: LZ4 frame has no content size, pack it with lz4 --content-size");
+        return nullptr;
+    }
+
+    auto* buffer = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel(size));
+
+    const std::uint64_t start = arch::drivers::tsc::get_time_ns();
+    const long decoded = compress::lz4::decompress_frame(image, image_size, buffer, size);
+    const std::uint64_t ns = arch::drivers::tsc::get_time_ns() - start;
+
+    if (decoded != static_cast<long>(size)) {
+        log::warn("initramfs: corrupt LZ4 frame");
+        arch::vmm::free_kernel(buffer);
+        return nullptr;
+    }
+
+    const std::uint64_t us = ns / 1000 > 0 ? ns / 1000 : 1;
+
+    log::infof<log::Subsystem::FS>(
+        "initramfs: LZ4 {} -> {} bytes in {} us, {} MiB/s",
+        image_size,
+        size,
+        us,
+        size * 1000000 / us / (1024 * 1024));
+
+    *tar_size = size;
+
+    return buffer;
+}
+
+InitramfsMountPoint* load(std::uint8_t* image, std::size_t size)
+{
+    if (!compress::lz4::is_frame(image, size)) {
+        return new InitramfsMountPoint{image, size};
+    }
+
+    std::size_t tar_size = 0;
+    std::uint8_t* tar = decompress_lz4(image, size, &tar_size);
+
+    if (tar == nullptr) {
+        return nullptr;
+    }
+
+    return new InitramfsMountPoint{tar, tar_size};
 }
 
 }
@@ -42,7 +42,11 @@ void parse_headers(std::uint8_t* addr)
     std::uintmax_t num_blocks = (size + 511) / 512;
     std::uint8_t* data = size > 0 ? addr + 512 : nullptr;
 
-    log::debugf("parse tar header: filename={}, size={}, num_blocks={}", filename, size, num_blocks);
+    log::debugf<log::Subsystem::FS>(
+        "parse tar header: filename={}, size={}, num_blocks={}",
+        filename,
+        size,
+        num_blocks);
 
     metas.push_back(TarMeta{
         .header = header,
@@ -59,7 +63,7 @@ void init(std::uint8_t* addr)
     parse_headers(addr);
 
     for (auto&& header : metas) {
-        log::info("TAR header: filename = ", header.filename_str,
+        log::info<log::Subsystem::FS>("TAR header: filename = ", header.filename_str,
             ", size = ", header.size_bytes,
             ", #blocks = ", header.num_blocks);
     }
@@ -80,7 +84,15 @@ std::size_t read(TarMeta* meta, void* buffer, std::size_t count, std::size_t off
 {
     std::uint8_t* data = meta->data + offset;
 
-    log::debug("tar read from ", fmt::hex{data}, " to = ", fmt::hex{buffer}, " count = ", count, " offset = ", offset);
+    log::debug<log::Subsystem::FS>(
+        "tar read from ",
+        fmt::hex{data},
+        " to = ",
+        fmt::hex{buffer},
+        " count = ",
+        count,
+        " offset = ",
+        offset);
 
     memcpy(buffer, data, count);
 
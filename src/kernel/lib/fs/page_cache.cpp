@@ -0,0 +1,766 @@
+#include <algo/algo.hpp>
+#include <arch.hpp>
+#include <block/block.hpp>
+#include <crt/crt.h>
+#include <exclusive/kspinlock.hpp>
+#include <fs/page_cache.hpp>
+#include <log/log.hpp>
+#include <process/process.hpp>
+#include <process/wait_queue.hpp>
+#include <scheduler/scheduler.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs::cache {
+
+static tunable::Tunable<std::uint32_t> g_max_mb{
+    "cache.max_mb", 64, 1, 4096, "page cache size in MiB before clean pages are evicted"};
+
+static tunable::Tunable<std::uint32_t> g_writeback_ms{
+    "cache.writeback_ms", 5000, 100, 600000, "milliseconds between writebacks of dirty pages"};
+
+static tunable::Tunable<std::uint32_t> g_readahead_kb{
+    "cache.readahead_kb", 128, 4, 1024, "largest readahead window in KiB, 4 turns readahead off"};
+
+constexpr std::size_t PAGES_PER_MB = 1024 * 1024 / arch::vmm::PAGE_SIZE;
+constexpr std::uint32_t SECTORS_PER_SUBPAGE = SUBPAGE_SIZE / block::SECTOR_SIZE;
+
+// First readahead window, and the largest one in pages (1 MiB)
+constexpr std::uint32_t MIN_READAHEAD = 4;
+constexpr std::uint32_t MAX_READAHEAD = 256;
+
+// Dirty pages one writeback pass sends to the block layer together
+constexpr std::size_t SYNC_BATCH = 64;
+
+constexpr std::size_t BUCKET_BITS = 12;
+constexpr std::size_t NUM_BUCKETS = 1 << BUCKET_BITS;
+
+static kspinlock g_lock; // Guards everything below and the fields of every page
+static Page* g_buckets[NUM_BUCKETS];
+static Page* g_lru_head; // Most recently used
+static Page* g_lru_tail;
+static std::size_t g_pages;
+static std::size_t g_dirty;
+static Stats g_stats;
+
+// Woken whenever a page stops being busy
+static process::WaitQueue g_io_queue;
+
+Mapping::Mapping(block::BlockDevice* dev)
+    : dev{dev}
+{
+}
+
+Mapping::~Mapping()
+{
+    truncate(this, 0);
+}
+
+DeviceMapping::DeviceMapping(block::BlockDevice* dev)
+    : Mapping{dev}
+{
+}
+
+std::uint64_t DeviceMapping::end()
+{
+    return (dev->size() + arch::vmm::PAGE_SIZE - 1) / arch::vmm::PAGE_SIZE;
+}
+
+int DeviceMapping::map(Page* page)
+{
+    const std::uint64_t first = page->index * (arch::vmm::PAGE_SIZE / block::SECTOR_SIZE);
+
+    for (std::size_t i = 0; i < SUBPAGES; i++) {
+        const std::uint64_t sector = first + i * SECTORS_PER_SUBPAGE;
+
+        page->sector[i] = sector + SECTORS_PER_SUBPAGE <= dev->sectors ? sector : HOLE;
+    }
+
+    return 0;
+}
+
+static std::size_t bucket_of(const Mapping* mapping, std::uint64_t index)
+{
+    const std::uint64_t key = (reinterpret_cast<std::uintptr_t>(mapping) >> 4) ^ index;
+
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - BUCKET_BITS);
+}
+
+static Page* find_locked(const Mapping* mapping, std::uint64_t index)
+{
+    for (Page* page = g_buckets[bucket_of(mapping, index)]; page; page = page->hash_next) {
+        if (page->mapping == mapping && page->index == index) {
+            return page;
+        }
+    }
+
+    return nullptr;
+}
+
+static void lru_remove(Page* page)
+{
+    if (page->lru_prev) {
+        page->lru_prev->lru_next = page->lru_next;
+    } else {
+        g_lru_head = page->lru_next;
+    }
+
+    if (page->lru_next) {
+        page->lru_next->lru_prev = page->lru_prev;
+    } else {
+        g_lru_tail = page->lru_prev;
+    }
+}
+
+static void lru_push_front(Page* page)
+{
+    page->lru_prev = nullptr;
+    page->lru_next = g_lru_head;
+
+    if (g_lru_head) {
+        g_lru_head->lru_prev = page;
+    } else {
+        g_lru_tail = page;
+    }
+
+    g_lru_head = page;
+}
+
+static void touch(Page* page)
+{
+    if (page != g_lru_head) {
+        lru_remove(page);
+        lru_push_front(page);
+    }
+}
+
+static Page* create_locked(Mapping* mapping, std::uint64_t index)
+{
+    auto* page = new Page{};
+
+    page->mapping = mapping;
+    page->index = index;
+    page->data = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel_page());
+    page->refs = 1;
+
+    for (auto& sector : page->sector) {
+        sector = HOLE;
+    }
+
+    Page*& bucket = g_buckets[bucket_of(mapping, index)];
+
+    page->hash_next = bucket;
+    bucket = page;
+
+    page->map_next = mapping->page_list;
+
+    if (mapping->page_list) {
+        mapping->page_list->map_prev = page;
+    }
+
+    mapping->page_list = page;
+    mapping->pages++;
+
+    lru_push_front(page);
+    g_pages++;
+
+    return page;
+}
+
+static void free_page(Page* page)
+{
+    arch::vmm::free_kernel_page(page->data);
+    delete page;
+}
+
+/// @brief take page out of the cache, it is freed now or by its last put()
+///
+static void drop_locked(Page* page)
+{
+    Mapping* mapping = page->mapping;
+    Page** link = &g_buckets[bucket_of(mapping, page->index)];
+
+    while (*link != page) {
+        link = &(*link)->hash_next;
+    }
+
+    *link = page->hash_next;
+
+    if (page->map_prev) {
+        page->map_prev->map_next = page->map_next;
+    } else {
+        mapping->page_list = page->map_next;
+    }
+
+    if (page->map_next) {
+        page->map_next->map_prev = page->map_prev;
+    }
+
+    mapping->pages--;
+    lru_remove(page);
+    g_pages--;
+
+    if (page->dirty) {
+        g_dirty--;
+    }
+
+    page->mapping = nullptr;
+
+    if (page->refs == 0) {
+        free_page(page);
+    }
+}
+
+static void release_locked(Page* page)
+{
+    if (--page->refs == 0 && page->mapping == nullptr) {
+        free_page(page);
+    }
+}
+
+/// @brief evict clean, unused pages from the cold end until under the limit
+///
+/// Dirty pages stay until writeback has cleaned them, so the cache can be
+/// over its limit for a while if most of it is dirty
+///
+static void evict_locked()
+{
+    const std::size_t limit = g_max_mb.value() * PAGES_PER_MB;
+    Page* page = g_lru_tail;
+
+    while (g_pages > limit && page) {
+        Page* prev = page->lru_prev;
+
+        if (page->refs == 0 && !page->busy && page->dirty == 0) {
+            drop_locked(page);
+            g_stats.evicted++;
+        }
+
+        page = prev;
+    }
+}
+
+static void wait_idle_locked(Page* page)
+{
+    while (page->busy && !page->uptodate) {
+        g_io_queue.prepare();
+        g_lock.unlock();
+        g_io_queue.sleep();
+        g_lock.lock();
+    }
+}
+
+/// @brief read pages run[0, n), consecutive pages of one mapping
+///
+/// Every subpage is its own request, the block layer merges whatever is
+/// contiguous on disk back into one transfer
+///
+static int read_pages(Page** run, std::size_t n)
+{
+    Mapping* mapping = run[0]->mapping;
+
+    for (std::size_t i = 0; i < n; i++) {
+        const int err = mapping->map(run[i]);
+
+        if (err < 0) {
+            return err;
+        }
+    }
+
+    auto* requests = new block::Request[n * SUBPAGES];
+    block::Completion completion;
+    std::size_t count = 0;
+
+    mapping->dev->plug();
+
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t j = 0; j < SUBPAGES; j++) {
+            std::uint8_t* data = run[i]->data + j * SUBPAGE_SIZE;
+
+            if (run[i]->sector[j] == HOLE) {
+                memset(data, 0, SUBPAGE_SIZE);
+                continue;
+            }
+
+            block::Request* req = &requests[count++];
+
+            req->op = block::Op::READ;
+            req->sector = run[i]->sector[j];
+            req->count = SECTORS_PER_SUBPAGE;
+            req->buffer = data;
+
+            completion.add(req);
+            mapping->dev->submit(req);
+        }
+    }
+
+    mapping->dev->unplug();
+
+    const int status = completion.wait();
+
+    delete[] requests;
+
+    return status;
+}
+
+/// @brief the page at index, read in if it is not cached
+///
+/// A miss also reads the pages after it that are not cached yet, as many
+/// as the readahead window. The window doubles each time the miss is where
+/// the last window ended, and starts over when it is not.
+///
+/// @param out gets the page, pinned until put()
+///
+/// @return 0, or -errno if the read failed
+///
+int get(Mapping* mapping, std::uint64_t index, Page** out)
+{
+    Page* run[MAX_READAHEAD];
+    std::size_t n = 0;
+
+    g_lock.lock();
+
+    Page* page = find_locked(mapping, index);
+
+    if (page) {
+        page->refs++;
+        touch(page);
+        wait_idle_locked(page);
+
+        // Truncated while asleep, look again
+        if (!page->mapping) {
+            release_locked(page);
+            g_lock.unlock();
+
+            return get(mapping, index, out);
+        }
+
+        if (page->uptodate) {
+            g_stats.hits++;
+            g_lock.unlock();
+
+            *out = page;
+            return 0;
+        }
+
+        // An earlier read failed, try again on its own
+        page->busy = true;
+        run[n++] = page;
+    } else {
+        const std::uint32_t max = g_readahead_kb.value() * 1024 / arch::vmm::PAGE_SIZE;
+        std::uint32_t window = MIN_READAHEAD;
+
+        if (index == mapping->ra_next && mapping->ra_pages > 0) {
+            window = mapping->ra_pages * 2;
+        }
+
+        if (window > max) {
+            window = max < MAX_READAHEAD ? max : MAX_READAHEAD;
+        }
+
+        const std::uint64_t end = mapping->end();
+
+        page = create_locked(mapping, index);
+        page->busy = true;
+        run[n++] = page;
+
+        while (n < window && index + n < end && !find_locked(mapping, index + n)) {
+            Page* ahead = create_locked(mapping, index + n);
+
+            ahead->busy = true;
+            run[n++] = ahead;
+        }
+
+        mapping->ra_next = index + n;
+        mapping->ra_pages = window;
+
+        g_stats.misses++;
+        g_stats.readahead += n - 1;
+
+        evict_locked();
+    }
+
+    g_lock.unlock();
+
+    const int status = read_pages(run, n);
+
+    g_lock.lock();
+
+    for (std::size_t i = 0; i < n; i++) {
+        run[i]->busy = false;
+        run[i]->uptodate = status == 0;
+
+        // Pages read ahead are not the caller's
+        if (i > 0) {
+            release_locked(run[i]);
+        }
+    }
+
+    g_io_queue.wake_all();
+
+    if (status < 0) {
+        release_locked(page);
+        g_lock.unlock();
+
+        return status;
+    }
+
+    g_lock.unlock();
+
+    *out = page;
+
+    return 0;
+}
+
+/// @brief the page at index without reading it, for a caller about to
+///        write all of it that matters
+///
+/// A page not cached yet is zero-filled with every subpage a HOLE, the
+/// caller maps what it writes. A cached page whose read failed is zeroed
+/// too, whatever the read left behind must not reach the disk.
+///
+/// @return the page, pinned until put()
+///
+Page* grab(Mapping* mapping, std::uint64_t index)
+{
+    g_lock.lock();
+
+    Page* page = find_locked(mapping, index);
+
+    if (page) {
+        page->refs++;
+        touch(page);
+        wait_idle_locked(page);
+
+        if (!page->uptodate) {
+            memset(page->data, 0, arch::vmm::PAGE_SIZE);
+            page->uptodate = true;
+        }
+    } else {
+        page = create_locked(mapping, index);
+        page->uptodate = true;
+        memset(page->data, 0, arch::vmm::PAGE_SIZE);
+
+        evict_locked();
+    }
+
+    g_lock.unlock();
+
+    return page;
+}
+
+void put(Page* page)
+{
+    g_lock.lock();
+    release_locked(page);
+    g_lock.unlock();
+}
+
+/// @brief note that [offset, offset + length) of page was written, the
+///        subpages it touches are written back whole
+///
+void mark_dirty(Page* page, std::size_t offset, std::size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    const std::size_t first = offset / SUBPAGE_SIZE;
+    const std::size_t last = (offset + length - 1) / SUBPAGE_SIZE;
+    const auto mask = static_cast<std::uint8_t>(((1u << (last + 1)) - 1) & ~((1u << first) - 1));
+
+    g_lock.lock();
+
+    if (page->mapping) {
+        if (page->dirty == 0) {
+            g_dirty++;
+        }
+
+        page->dirty |= mask;
+    }
+
+    g_lock.unlock();
+}
+
+/// @brief forget writes to [offset, offset + length) of page, whose blocks
+///        have been freed and must not be written to any more
+///
+/// Waits for a writeback in flight on the page first. Only subpages wholly
+/// inside the range are forgotten.
+///
+void discard(Page* page, std::size_t offset, std::size_t length)
+{
+    const std::size_t first = (offset + SUBPAGE_SIZE - 1) / SUBPAGE_SIZE;
+    const std::size_t end = (offset + length) / SUBPAGE_SIZE;
+
+    g_lock.lock();
+
+    while (page->busy) {
+        g_io_queue.prepare();
+        g_lock.unlock();
+        g_io_queue.sleep();
+        g_lock.lock();
+    }
+
+    const bool was_dirty = page->dirty != 0;
+
+    for (std::size_t i = first; i < end; i++) {
+        page->dirty &= static_cast<std::uint8_t>(~(1u << i));
+    }
+
+    if (was_dirty && page->dirty == 0 && page->mapping) {
+        g_dirty--;
+    }
+
+    g_lock.unlock();
+}
+
+/// @brief write back now if half the cache is dirty, so a long write
+///        does not fill memory faster than the writeback thread empties it
+///
+void balance_dirty()
+{
+    g_lock.lock();
+
+    const bool over = g_dirty > g_max_mb.value() * PAGES_PER_MB / 2;
+
+    g_lock.unlock();
+
+    if (over) {
+        sync();
+    }
+}
+
+/// @brief drop the pages of mapping from index first on, dirty or not
+///
+/// Waits for reads and writebacks in flight on them first, so no I/O
+/// lands in blocks the caller is about to free
+///
+void truncate(Mapping* mapping, std::uint64_t first)
+{
+    g_lock.lock();
+
+    Page* page = mapping->page_list;
+
+    while (page) {
+        Page* next = page->map_next;
+
+        if (page->index < first) {
+            page = next;
+            continue;
+        }
+
+        if (page->busy) {
+            g_io_queue.prepare();
+            g_lock.unlock();
+            g_io_queue.sleep();
+            g_lock.lock();
+
+            // The list may have changed while asleep
+            page = mapping->page_list;
+            continue;
+        }
+
+        drop_locked(page);
+        page = next;
+    }
+
+    g_lock.unlock();
+}
+
+struct Writeback {
+    Page* page;
+    std::uint8_t mask;
+};
+
+static std::uint64_t first_sector(const Writeback& item)
+{
+    for (std::size_t i = 0; i < SUBPAGES; i++) {
+        if (item.mask & (1 << i)) {
+            return item.page->sector[i];
+        }
+    }
+
+    return HOLE;
+}
+
+/// @brief pick up to SYNC_BATCH dirty pages, oldest first, and mark them
+///        busy and clean
+///
+static std::size_t collect_locked(Mapping* mapping, Writeback* batch)
+{
+    std::size_t n = 0;
+    Page* page = mapping ? mapping->page_list : g_lru_tail;
+
+    while (page && n < SYNC_BATCH) {
+        if (page->dirty && !page->busy) {
+            batch[n].page = page;
+            batch[n].mask = page->dirty;
+            n++;
+
+            page->busy = true;
+            page->refs++;
+            page->dirty = 0;
+            g_dirty--;
+        }
+
+        page = mapping ? page->map_next : page->lru_prev;
+    }
+
+    return n;
+}
+
+/// @brief write the dirty subpages of batch, each device's under one plug
+///
+static int write_batch(Writeback* batch, std::size_t n)
+{
+    // By device, then by sector, so each device sees one ascending sweep
+    algo::sort(batch, batch + n, [](const Writeback& a, const Writeback& b) {
+        const auto dev_a = reinterpret_cast<std::uintptr_t>(a.page->mapping->dev);
+        const auto dev_b = reinterpret_cast<std::uintptr_t>(b.page->mapping->dev);
+
+        return dev_a != dev_b ? dev_a < dev_b : first_sector(a) < first_sector(b);
+    });
+
+    auto* requests = new block::Request[n * SUBPAGES];
+    block::Completion completion;
+    block::BlockDevice* plugged = nullptr;
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < n; i++) {
+        Page* page = batch[i].page;
+
+        if (page->mapping->dev != plugged) {
+            if (plugged) {
+                plugged->unplug();
+            }
+
+            plugged = page->mapping->dev;
+            plugged->plug();
+        }
+
+        for (std::size_t j = 0; j < SUBPAGES; j++) {
+            if (!(batch[i].mask & (1 << j)) || page->sector[j] == HOLE) {
+                continue;
+            }
+
+            block::Request* req = &requests[count++];
+
+            req->op = block::Op::WRITE;
+            req->sector = page->sector[j];
+            req->count = SECTORS_PER_SUBPAGE;
+            req->buffer = page->data + j * SUBPAGE_SIZE;
+
+            completion.add(req);
+            plugged->submit(req);
+        }
+    }
+
+    if (plugged) {
+        plugged->unplug();
+    }
+
+    const int status = completion.wait();
+
+    delete[] requests;
+
+    return status;
+}
+
+/// @brief write back the dirty pages of mapping, or of every mapping
+///
+/// Pages dirtied again while this runs may be left for the next pass
+///
+/// @return 0, or the first error a write failed with. Pages that failed
+///         stay dirty
+///
+int sync(Mapping* mapping)
+{
+    Writeback batch[SYNC_BATCH];
+    int status = 0;
+
+    g_lock.lock();
+
+    std::size_t passes = g_dirty / SYNC_BATCH + 1;
+
+    g_lock.unlock();
+
+    while (passes-- > 0) {
+        g_lock.lock();
+
+        const std::size_t n = collect_locked(mapping, batch);
+
+        g_lock.unlock();
+
+        if (n == 0) {
+            break;
+        }
+
+        const int err = write_batch(batch, n);
+
+        g_lock.lock();
+
+        for (std::size_t i = 0; i < n; i++) {
+            Page* page = batch[i].page;
+
+            page->busy = false;
+
+            if (err < 0 && page->mapping) {
+                if (page->dirty == 0) {
+                    g_dirty++;
+                }
+
+                page->dirty |= batch[i].mask;
+            }
+
+            release_locked(page);
+        }
+
+        g_stats.written += n;
+        g_io_queue.wake_all();
+        g_lock.unlock();
+
+        if (err < 0) {
+            log::warn<log::Subsystem::FS>("writeback: ", n, " pages failed, error ", err);
+            status = status < 0 ? status : err;
+        }
+    }
+
+    return status;
+}
+
+Stats stats()
+{
+    g_lock.lock();
+
+    Stats stats = g_stats;
+
+    stats.pages = g_pages;
+    stats.dirty = g_dirty;
+
+    g_lock.unlock();
+
+    return stats;
+}
+
+[[noreturn]]
+static void writeback_kthread()
+{
+    auto* sched = scheduler::get_scheduler();
+
+    while (true) {
+        sched->yield_sleep(g_writeback_ms.value());
+        sync();
+    }
+}
+
+void start_writeback()
+{
+    auto* writeback = new process::KThread(writeback_kthread);
+    scheduler::get_scheduler()->add_process(writeback);
+}
+
+}
@@ -0,0 +1,170 @@
+#include <arch.hpp>
+#include <crt/crt.h>
+#include <fs/page_tree.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+PageTree::~PageTree()
+{
+    truncate(0);
+}
+
+/// @return pages the tree covers at its current height
+///
+std::size_t PageTree::capacity() const
+{
+    if (_height == 0) {
+        return 0;
+    }
+
+    // Past 64 bits of index the tree can not grow any further
+    return _height * BITS >= 64 ? SIZE_MAX : std::size_t{1} << (_height * BITS);
+}
+
+/// @brief add levels on top of the root until index fits
+///
+void PageTree::grow(std::size_t index)
+{
+    while (index >= capacity()) {
+        if (_root != nullptr) {
+            auto* node = new Node{};
+
+            node->slots[0] = _root;
+            node->count = 1;
+            _root = node;
+        }
+
+        _height++;
+    }
+}
+
+std::uint8_t* PageTree::find(std::size_t index) const
+{
+    if (index >= capacity()) {
+        return nullptr;
+    }
+
+    const Node* node = _root;
+
+    for (std::size_t height = _height; node != nullptr; height--) {
+        void* slot = node->slots[(index >> ((height - 1) * BITS)) & (SLOTS - 1)];
+
+        if (height == 1) {
+            return static_cast<std::uint8_t*>(slot);
+        }
+
+        node = static_cast<const Node*>(slot);
+    }
+
+    return nullptr;
+}
+
+/// @brief the page at index, creating it (zeroed) and the path to it if it
+///        is a hole
+///
+std::uint8_t* PageTree::find_or_create(std::size_t index)
+{
+    grow(index);
+
+    if (_root == nullptr) {
+        _root = new Node{};
+    }
+
+    Node* node = _root;
+
+    for (std::size_t height = _height; height > 1; height--) {
+        void*& slot = node->slots[(index >> ((height - 1) * BITS)) & (SLOTS - 1)];
+
+        if (slot == nullptr) {
+            slot = new Node{};
+            node->count++;
+        }
+
+        node = static_cast<Node*>(slot);
+    }
+
+    void*& slot = node->slots[index & (SLOTS - 1)];
+
+    if (slot == nullptr) {
+        auto* page = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel_page());
+
+        memset(page, 0, arch::vmm::PAGE_SIZE);
+
+        slot = page;
+        node->count++;
+        _pages++;
+    }
+
+    return static_cast<std::uint8_t*>(slot);
+}
+
+/// @brief remove every page at index first and above from the subtree at node
+///
+/// node covers the pages starting at index 0 of its own range, so first is
+/// relative to it
+///
+void PageTree::drop(Node* node, std::size_t height, std::size_t first, kvector<std::uint8_t*>* detached)
+{
+    const std::size_t shift = (height - 1) * BITS;
+    const std::size_t span = std::size_t{1} << shift; // Pages under each slot
+
+    for (std::size_t i = first >> shift; i < SLOTS && node->count > 0; i++) {
+        void*& slot = node->slots[i];
+
+        if (slot == nullptr) {
+            continue;
+        }
+
+        const std::size_t start = i * span;
+
+        if (height > 1) {
+            auto* child = static_cast<Node*>(slot);
+
+            drop(child, height - 1, first > start ? first - start : 0, detached);
+
+            if (child->count > 0) {
+                continue;
+            }
+
+            delete child;
+        } else {
+            auto* page = static_cast<std::uint8_t*>(slot);
+
+            if (detached != nullptr) {
+                detached->push_back(page);
+            } else {
+                arch::vmm::free_kernel_page(page);
+            }
+
+            _pages--;
+        }
+
+        slot = nullptr;
+        node->count--;
+    }
+}
+
+/// @brief remove every page from index first on
+///
+/// @param detached if given, the pages are handed over here instead of being
+///        freed, e.g. because they are still mapped somewhere
+///
+void PageTree::truncate(std::size_t first, kvector<std::uint8_t*>* detached)
+{
+    if (_root == nullptr || first >= capacity()) {
+        return;
+    }
+
+    drop(_root, _height, first, detached);
+
+    if (_root->count == 0) {
+        delete _root;
+        _root = nullptr;
+        _height = 0;
+    }
+}
+
+}
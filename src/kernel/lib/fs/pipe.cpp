@@ -0,0 +1,310 @@
+#include <arch.hpp>
+#include <crt/crt.h>
+#include <fs/fs.hpp>
+#include <fs/pipe.hpp>
+#include <fs/poll.hpp>
+#include <memory/memory.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace fs {
+
+// Pipes are not in any filesystem, this only tells them apart from files
+static MountPoint g_pipe_mount{};
+static std::uint64_t g_next_pipe_ino = 1;
+
+PipeInode::PipeInode()
+    : Inode{&g_pipe_mount}
+{
+    type = FileType::FIFO;
+    size = 0;
+    ino = __atomic_fetch_add(&g_next_pipe_ino, 1, __ATOMIC_RELAXED);
+
+    for (std::uint8_t*& page : _pages) {
+        page = static_cast<std::uint8_t*>(arch::vmm::alloc_kernel_page());
+    }
+}
+
+PipeInode::~PipeInode()
+{
+    for (std::uint8_t* page : _pages) {
+        arch::vmm::free_kernel_page(page);
+    }
+}
+
+/// @brief copy count bytes into the ring at byte position pos
+///
+/// src may be a user or a kernel buffer (splice, sendfile)
+///
+/// @return false if src faulted
+///
+bool PipeInode::copy_in(std::size_t pos, const std::uint8_t* src, std::size_t count)
+{
+    const bool user = arch::vmm::is_user_addr(src);
+
+    while (count > 0) {
+        const std::size_t offset = pos % arch::vmm::PAGE_SIZE;
+        const std::size_t chunk = count < arch::vmm::PAGE_SIZE - offset ? count : arch::vmm::PAGE_SIZE - offset;
+        std::uint8_t* dst = _pages[(pos / arch::vmm::PAGE_SIZE) % NUM_PAGES] + offset;
+
+        if (user) {
+            if (kcopy_from_user(dst, src, chunk) < 0) {
+                return false;
+            }
+        } else {
+            memcpy(dst, src, chunk);
+        }
+
+        pos += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return true;
+}
+
+/// @brief copy count bytes out of the ring from byte position pos
+///
+/// @return false if dst faulted
+///
+bool PipeInode::copy_out(std::size_t pos, std::uint8_t* dst, std::size_t count)
+{
+    const bool user = arch::vmm::is_user_addr(dst);
+
+    while (count > 0) {
+        const std::size_t offset = pos % arch::vmm::PAGE_SIZE;
+        const std::size_t chunk = count < arch::vmm::PAGE_SIZE - offset ? count : arch::vmm::PAGE_SIZE - offset;
+        const std::uint8_t* src = _pages[(pos / arch::vmm::PAGE_SIZE) % NUM_PAGES] + offset;
+
+        if (user) {
+            if (kcopy_to_user(dst, src, chunk) < 0) {
+                return false;
+            }
+        } else {
+            memcpy(dst, src, chunk);
+        }
+
+        pos += chunk;
+        dst += chunk;
+        count -= chunk;
+    }
+
+    return true;
+}
+
+int PipeInode::open(FileDescriptor*, int) { return 0; }
+
+/// @brief read whatever is buffered, up to count bytes
+///
+/// Blocks only while the pipe is empty, returns 0 once it is empty and
+/// every write end is closed
+///
+int PipeInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    _lock.lock();
+
+    while (_head == _tail) {
+        if (_num_writers == 0) {
+            _lock.unlock();
+            return 0;
+        }
+
+        if (fd->flags & O_NONBLOCK) {
+            _lock.unlock();
+            return -EAGAIN;
+        }
+
+        _readers.prepare();
+        _lock.unlock();
+
+        if (_readers.sleep_killable() < 0) {
+            return -EINTR;
+        }
+
+        _lock.lock();
+    }
+
+    const std::size_t available = _tail - _head;
+    const std::size_t n = count < available ? count : available;
+
+    if (!copy_out(_head, static_cast<std::uint8_t*>(buf), n)) {
+        _lock.unlock();
+        return -EFAULT;
+    }
+
+    _head += n;
+    size = _tail - _head;
+
+    _writers.wake_all();
+    _lock.unlock();
+
+    return static_cast<int>(n);
+}
+
+/// @brief write all of buf, blocking for space as needed
+///
+/// A write of up to PIPE_ATOMIC_WRITE bytes waits until it fits in one go,
+/// so it lands in the ring in one piece. Larger ones go in as space frees
+/// up and may be interleaved with other writers
+///
+int PipeInode::write(FileDescriptor* fd, const void* buf, std::size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    const auto* src = static_cast<const std::uint8_t*>(buf);
+    const bool atomic = count <= PIPE_ATOMIC_WRITE;
+    std::size_t done = 0;
+    int err = 0;
+
+    _lock.lock();
+
+    while (done < count) {
+        // No SIGPIPE, the writer only gets the error
+        if (_num_readers == 0) {
+            err = -EPIPE;
+            break;
+        }
+
+        const std::size_t space = CAPACITY - (_tail - _head);
+
+        if (space == 0 || (atomic && space < count)) {
+            if (fd->flags & O_NONBLOCK) {
+                err = -EAGAIN;
+                break;
+            }
+
+            _writers.prepare();
+            _lock.unlock();
+            err = _writers.sleep_killable();
+            _lock.lock();
+
+            if (err < 0) {
+                break;
+            }
+
+            continue;
+        }
+
+        const std::size_t n = count - done < space ? count - done : space;
+
+        if (!copy_in(_tail, src + done, n)) {
+            err = -EFAULT;
+            break;
+        }
+
+        _tail += n;
+        size = _tail - _head;
+        done += n;
+
+        // Readers can start on this while we wait for more space
+        _readers.wake_all();
+    }
+
+    _lock.unlock();
+
+    return done > 0 ? static_cast<int>(done) : err;
+}
+
+/// @brief close one end, the last close frees the pipe
+///
+int PipeInode::close(FileDescriptor* fd)
+{
+    _lock.lock();
+
+    if ((fd->flags & O_ACCMODE) == O_RDONLY) {
+        _num_readers--;
+    } else {
+        _num_writers--;
+    }
+
+    const bool last = _num_readers == 0 && _num_writers == 0;
+
+    // Blocked readers now see EOF, blocked writers EPIPE. Woken with the
+    // lock held, the other end may free the pipe as soon as it is dropped
+    _readers.wake_all();
+    _writers.wake_all();
+
+    _lock.unlock();
+
+    if (last) {
+        delete this;
+    }
+
+    return 0;
+}
+
+int PipeInode::lseek(FileDescriptor*, int, int)
+{
+    return -ESPIPE;
+}
+
+int PipeInode::stat(Stat* stat)
+{
+    stat->type = type;
+    stat->size = size;
+
+    return 0;
+}
+
+/// @brief readable with data or no writers left, writable with room for
+/// an atomic write or no readers left (the write then fails with EPIPE)
+///
+std::uint32_t PipeInode::poll(FileDescriptor* fd, PollTable* table)
+{
+    const bool reader = (fd->flags & O_ACCMODE) == O_RDONLY;
+    std::uint32_t events = 0;
+
+    _lock.lock();
+
+    if (table) {
+        table->wait(reader ? _readers : _writers);
+    }
+
+    if (reader) {
+        if (_tail != _head) {
+            events |= POLLIN | POLLRDNORM;
+        }
+
+        if (_num_writers == 0) {
+            events |= POLLHUP;
+        }
+    } else {
+        if (CAPACITY - (_tail - _head) >= PIPE_ATOMIC_WRITE) {
+            events |= POLLOUT | POLLWRNORM;
+        }
+
+        if (_num_readers == 0) {
+            events |= POLLERR;
+        }
+    }
+
+    _lock.unlock();
+
+    return events;
+}
+
+/// @brief make a new pipe and open both of its ends
+///
+/// @param flags O_NONBLOCK, applied to both ends
+///
+/// @return 0
+///
+int create_pipe(int flags, FileDescriptor** read_end, FileDescriptor** write_end)
+{
+    auto* pipe = new PipeInode{};
+
+    *read_end = new FileDescriptor{pipe, "pipe", 0, O_RDONLY | (flags & O_NONBLOCK)};
+    *write_end = new FileDescriptor{pipe, "pipe", 0, O_WRONLY | (flags & O_NONBLOCK)};
+
+    return 0;
+}
+
+}
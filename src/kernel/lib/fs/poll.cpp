@@ -0,0 +1,54 @@
+#include <arch.hpp>
+#include <fs/poll.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+
+namespace fs {
+
+// Entries of a poll() table only wake the poller, it stays registered
+// everywhere until it has re-checked every file
+static void wake_poller(process::WaitEntry* entry)
+{
+    scheduler::get_scheduler()->wake_process(entry->process, process::WaitReason::WAIT_QUEUE);
+}
+
+PollTable::PollTable(process::WakeFunc func, void* data)
+    : _func{func ? func : wake_poller}
+    , _data{data}
+{
+}
+
+PollTable::~PollTable()
+{
+    clear();
+}
+
+/// @brief register on queue, called by Inode::poll()
+///
+void PollTable::wait(process::WaitQueue& queue)
+{
+    auto* entry = new Entry{};
+
+    entry->wait.process = arch::percpu::current_process();
+    entry->wait.func = _func;
+    entry->wait.data = _data;
+    entry->next = _entries;
+    _entries = entry;
+
+    queue.add(&entry->wait);
+}
+
+/// @brief unregister from every queue
+///
+void PollTable::clear()
+{
+    while (_entries) {
+        Entry* entry = _entries;
+
+        _entries = entry->next;
+        process::WaitQueue::remove(&entry->wait);
+        delete entry;
+    }
+}
+
+}
@@ -5,6 +5,8 @@
 #include <memory/memory.hpp>
 #include <process/process.hpp>
 
+#include <cerrno>
+
 namespace fs::procfs {
 
 ProcSelfInode::ProcSelfInode(MountPoint* mp, Inode* parent, int ino)
@@ -20,7 +22,9 @@ int ProcSelfInode::read(FileDescriptor*, void* buf, std::size_t count)
     process::Process* proc = arch::percpu::current_process();
     kstring str = proc->to_string();
 
-    kcopy_to_user(buf, str.data(), algo::min(str.length(), count));
+    if (kcopy_to_user(buf, str.data(), algo::min(str.length(), count)) < 0) {
+        return -EFAULT;
+    }
 
     return str.length();
 }
@@ -0,0 +1,181 @@
+#include <arch.hpp>
+#include <fs/procfs/proc_sys.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace fs::procfs {
+
+ProcSysDirectoryInode::ProcSysDirectoryInode(MountPoint* mp, Inode* parent, int ino, kstring_view name)
+    : DirectoryInode{mp}
+{
+    this->type = FileType::DIRECTORY;
+    this->parent = parent;
+    this->ino = ino;
+    this->name = kstring{name};
+}
+
+Inode* ProcSysDirectoryInode::lookup(const char* name)
+{
+    return children.find(name);
+}
+
+int ProcSysDirectoryInode::stat(Stat* stat)
+{
+    stat->size = 0;
+    stat->type = FileType::DIRECTORY;
+
+    return 0;
+}
+
+ProcTunableInode::ProcTunableInode(MountPoint* mp, Inode* parent, int ino, kstring_view name, tunable::TunableBase* t)
+    : Inode{mp}
+    , _tunable{t}
+{
+    this->type = FileType::REGULAR;
+    this->parent = parent;
+    this->ino = ino;
+    this->name = kstring{name};
+}
+
+int ProcTunableInode::open(FileDescriptor* fd, int)
+{
+    fd->offset = 0;
+
+    return 0;
+}
+
+/// @brief read the current value followed by a newline
+///
+int ProcTunableInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    char text[64];
+    std::size_t length = _tunable->format(text, sizeof(text) - 1);
+
+    text[length++] = '\n';
+
+    if (fd->offset >= length) {
+        return 0;
+    }
+
+    const std::size_t available = length - fd->offset;
+    const std::size_t to_read = count < available ? count : available;
+
+    if (arch::vmm::is_user_addr(buf)) {
+        if (kcopy_to_user(buf, text + fd->offset, to_read) < 0) {
+            return -EFAULT;
+        }
+    } else {
+        memcpy(buf, text + fd->offset, to_read);
+    }
+
+    fd->offset += to_read;
+
+    return to_read;
+}
+
+/// @brief parse and apply a new value, e.g. `echo 60 > /proc/sys/fb/target_fps`
+///
+/// @return count on success, -EINVAL if the value does not parse or is out
+///         of range
+///
+int ProcTunableInode::write(FileDescriptor*, const void* buf, std::size_t count)
+{
+    char text[64];
+
+    if (count >= sizeof(text)) {
+        return -EINVAL;
+    }
+
+    if (arch::vmm::is_user_addr(buf)) {
+        if (kcopy_from_user(text, buf, count) < 0) {
+            return -EFAULT;
+        }
+    } else {
+        memcpy(text, buf, count);
+    }
+
+    std::size_t length = count;
+
+    while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == ' ')) {
+        length--;
+    }
+
+    std::int64_t value;
+
+    if (!_tunable->parse(kstring_view{text, length}, &value)) {
+        return -EINVAL;
+    }
+
+    const int err = _tunable->set(value);
+
+    if (err < 0) {
+        return err;
+    }
+
+    log::infof<log::Subsystem::FS>("tunable: {} = {}", _tunable->name, value);
+
+    return count;
+}
+
+int ProcTunableInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    if (whence != SEEK_SET || offset < 0) {
+        return -EINVAL;
+    }
+
+    fd->offset = offset;
+
+    return offset;
+}
+
+int ProcTunableInode::stat(Stat* stat)
+{
+    stat->size = 0;
+    stat->type = FileType::REGULAR;
+
+    return 0;
+}
+
+/// @brief create /proc/sys from the tunable registry
+///
+/// A tunable named "<group>.<name>" becomes the file /proc/sys/<group>/<name>.
+/// The registry is complete before any filesystem is mounted, so the tree is
+/// built once and never changes.
+///
+/// @param ino next free inode number of the mount, advanced for every inode created
+///
+ProcSysDirectoryInode* build_sys_tree(MountPoint* mp, Inode* parent, int* ino)
+{
+    auto* sys = new ProcSysDirectoryInode{mp, parent, (*ino)++, "sys"};
+
+    for (tunable::TunableBase* t = tunable::first(); t != nullptr; t = t->next) {
+        const kstring_view full{t->name};
+        const std::size_t dot = full.find(".");
+
+        if (dot == kstring_view::npos) {
+            log::warn<log::Subsystem::FS>("procfs: tunable '", t->name, "' has no group, not exposed");
+            continue;
+        }
+
+        const kstring_view group{full.data(), dot};
+        const kstring_view name{full.data() + dot + 1, full.length() - dot - 1};
+
+        kstring group_str{group};
+        auto* dir = static_cast<ProcSysDirectoryInode*>(sys->lookup(group_str.c_str()));
+
+        if (dir == nullptr) {
+            dir = new ProcSysDirectoryInode{mp, sys, (*ino)++, group};
+            sys->children.insert(dir);
+        }
+
+        dir->children.insert(new ProcTunableInode{mp, dir, (*ino)++, name, t});
+    }
+
+    return sys;
+}
+
+}
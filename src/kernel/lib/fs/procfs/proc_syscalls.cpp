@@ -0,0 +1,96 @@
+#include <arch.hpp>
+#include <fs/procfs/proc_syscalls.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <syscall/syscall_stats.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace fs::procfs {
+
+ProcSyscallsInode::ProcSyscallsInode(MountPoint* mp, Inode* parent, int ino)
+    : Inode{mp}
+{
+    this->type = FileType::REGULAR;
+    this->parent = parent;
+    this->ino = ino;
+    this->name = "syscalls";
+}
+
+int ProcSyscallsInode::open(FileDescriptor* fd, int)
+{
+    fd->offset = 0;
+
+    return 0;
+}
+
+/// @brief read the table, regenerated from the live counters on every read
+///
+int ProcSyscallsInode::read(FileDescriptor* fd, void* buf, std::size_t count)
+{
+    kstring text;
+
+    syscall::stats::format_header(text);
+
+    for (std::size_t i = 0; i < arch::trap::num_syscalls(); i++) {
+        const arch::trap::SyscallInfo info = arch::trap::syscall_info(i);
+
+        if (__atomic_load_n(&info.counters->calls, __ATOMIC_RELAXED) > 0) {
+            syscall::stats::format(text, info.name, *info.counters);
+        }
+    }
+
+    if (fd->offset >= text.length()) {
+        return 0;
+    }
+
+    const std::size_t available = text.length() - fd->offset;
+    const std::size_t to_read = count < available ? count : available;
+
+    if (arch::vmm::is_user_addr(buf)) {
+        if (kcopy_to_user(buf, text.data() + fd->offset, to_read) < 0) {
+            return -EFAULT;
+        }
+    } else {
+        memcpy(buf, text.data() + fd->offset, to_read);
+    }
+
+    fd->offset += to_read;
+
+    return to_read;
+}
+
+/// @brief reset every counter, e.g. `echo 0 > /proc/syscalls` before a benchmark
+///
+int ProcSyscallsInode::write(FileDescriptor*, const void*, std::size_t count)
+{
+    for (std::size_t i = 0; i < arch::trap::num_syscalls(); i++) {
+        syscall::stats::reset(*arch::trap::syscall_info(i).counters);
+    }
+
+    log::info<log::Subsystem::SYSCALL>("syscall stats reset");
+
+    return count;
+}
+
+int ProcSyscallsInode::lseek(FileDescriptor* fd, int offset, int whence)
+{
+    if (whence != SEEK_SET || offset < 0) {
+        return -EINVAL;
+    }
+
+    fd->offset = offset;
+
+    return offset;
+}
+
+int ProcSyscallsInode::stat(Stat* stat)
+{
+    stat->size = 0;
+    stat->type = FileType::REGULAR;
+
+    return 0;
+}
+
+}
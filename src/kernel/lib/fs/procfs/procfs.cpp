@@ -1,5 +1,7 @@
 #include "log/log.hpp"
 #include <fs/procfs/proc_self.hpp>
+#include <fs/procfs/proc_syscalls.hpp>
+#include <fs/procfs/proc_sys.hpp>
 #include <fs/procfs/procfs.hpp>
 
 namespace fs::procfs {
@@ -20,14 +22,34 @@ Inode* ProcDirectoryInode::lookup(const char* name)
         return proc_mp->self_inode;
     }
 
+    if (name_str == "sys") {
+        return proc_mp->sys_inode;
+    }
+
+    if (name_str == "syscalls") {
+        return proc_mp->syscalls_inode;
+    }
+
     return nullptr;
 }
 
-int ProcDirectoryInode::readdir(kvector<DirEntry>& entries)
+/// @brief list the entries, the cursor is an index into them
+///
+int ProcDirectoryInode::iterate(DirContext& ctx)
 {
-    entries.emplace_back("self", FileType::REGULAR);
+    auto proc_mp = static_cast<ProcMountPoint*>(mountpoint);
+    const Inode* inodes[] = {proc_mp->self_inode, proc_mp->sys_inode, proc_mp->syscalls_inode};
+    const char* names[] = {"self", "sys", "syscalls"};
 
-    return entries.size();
+    for (std::size_t i = ctx.pos; i < 3; i++) {
+        if (!ctx.emit(names[i], inodes[i]->ino, inodes[i]->type, i + 1)) {
+            break;
+        }
+
+        ctx.pos = i + 1;
+    }
+
+    return 0;
 }
 
 int ProcDirectoryInode::mkdir(const char*, int)
@@ -59,10 +81,12 @@ ProcMountPoint::ProcMountPoint()
 {
     int ino = PROCFS_ROOT_INODE;
 
-    log::debug("******** building proc mp ********");
+    log::debug<log::Subsystem::FS>("******** building proc mp ********");
 
     root_inode = new ProcDirectoryInode{this, ino++};
     self_inode = new ProcSelfInode{this, root_inode, ino++};
+    sys_inode = build_sys_tree(this, root_inode, &ino);
+    syscalls_inode = new ProcSyscallsInode{this, root_inode, ino++};
 }
 
 const char* ProcFileSystem::name()
@@ -72,7 +96,7 @@ const char* ProcFileSystem::name()
 
 MountPoint* ProcFileSystem::mount(const char*)
 {
-    log::debug("******** building proc fs ********");
+    log::debug<log::Subsystem::FS>("******** building proc fs ********");
     return new ProcMountPoint{};
 }
 
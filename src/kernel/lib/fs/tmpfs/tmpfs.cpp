@@ -1,10 +1,14 @@
+#include <arch.hpp>
 #include <cerrno>
 #include <containers/kvector.hpp>
+#include <crt/crt.h>
 #include <fs/fs.hpp>
 #include <fs/fs_file_ops.hpp>
 #include <fs/tmpfs/tmpfs.hpp>
 #include <log/log.hpp>
+#include <memory/memory.hpp>
 
+#include <climits>
 #include <cstddef>
 #include <cstdint>
 
@@ -23,6 +27,9 @@ TmpMountPoint::TmpMountPoint()
     root_inode->ino = next_ino++;
 }
 
+// Read back for holes, which have no page of their own
+alignas(arch::vmm::PAGE_SIZE) static const std::uint8_t g_zero_page[arch::vmm::PAGE_SIZE] = {};
+
 TmpFileInode::TmpFileInode(kstring name, Inode* parent)
     : Inode{parent->mountpoint}
 {
@@ -31,44 +38,206 @@ TmpFileInode::TmpFileInode(kstring name, Inode* parent)
     this->parent = parent;
     this->ino = static_cast<TmpMountPoint*>(parent->mountpoint)->next_ino++;
     this->size = 0;
-    this->data = {};
 }
 
-int TmpFileInode::open(FileDescriptor*, int) { return 0; }
+/// @brief free an inode taken out of its directory, or leave that to its
+///        last close
+///
+static void release(Inode* inode)
+{
+    // The old parent may be freed first, a cwd left here must not walk
+    // back up into it
+    inode->parent = nullptr;
+
+    if (inode->type == FileType::DIRECTORY) {
+        auto* dir = static_cast<TmpDirectoryInode*>(inode);
+
+        dir->unlinked = true;
 
-int TmpFileInode::close(FileDescriptor*) { return 0; }
+        if (dir->opens == 0) {
+            delete dir;
+        }
+    } else {
+        auto* file = static_cast<TmpFileInode*>(inode);
+
+        file->unlinked = true;
+
+        if (file->opens == 0 && file->maps == 0) {
+            delete file;
+        }
+    }
+}
 
-int TmpFileInode::write(FileDescriptor* fd, const void* voidp, std::size_t count)
+int TmpFileInode::open(FileDescriptor*, int)
 {
-    const auto* buff = static_cast<const std::uint8_t*>(voidp);
+    opens++;
+    return 0;
+}
 
-    data.resize(fd->offset + count);
+int TmpFileInode::close(FileDescriptor*)
+{
+    if (--opens == 0 && maps == 0 && unlinked) {
+        delete this;
+    }
 
-    for (std::size_t i = 0; i < count; i++) {
-        data[fd->offset++] = *(buff + i);
+    return 0;
+}
+
+int TmpFileInode::write(FileDescriptor* fd, const void* buf, std::size_t count)
+{
+    const bool user = arch::vmm::is_user_addr(buf);
+    const auto* src = static_cast<const std::uint8_t*>(buf);
+    std::size_t done = 0;
+
+    if (count > INT_MAX) {
+        count = INT_MAX;
+    }
+
+    // Page by page, only the pages written to are created
+    while (done < count) {
+        const std::size_t pos = fd->offset + done;
+        const std::size_t offset = pos % arch::vmm::PAGE_SIZE;
+        const std::size_t left = arch::vmm::PAGE_SIZE - offset;
+        const std::size_t chunk = count - done < left ? count - done : left;
+        std::uint8_t* page = pages.find_or_create(pos / arch::vmm::PAGE_SIZE);
+
+        if (user) {
+            if (kcopy_from_user(page + offset, src + done, chunk) < 0) {
+                break;
+            }
+        } else {
+            memcpy(page + offset, src + done, chunk);
+        }
+
+        done += chunk;
     }
 
-    size = data.size();
+    if (done == 0 && count > 0) {
+        return -EFAULT;
+    }
 
-    return count;
+    fd->offset += done;
+
+    if (fd->offset > size) {
+        size = fd->offset;
+    }
+
+    return static_cast<int>(done);
 }
 
-int TmpFileInode::read(FileDescriptor* fd, void* voidp, std::size_t count)
+int TmpFileInode::read(FileDescriptor* fd, void* buf, std::size_t count)
 {
-    auto* buff = static_cast<std::uint8_t*>(voidp);
+    const bool user = arch::vmm::is_user_addr(buf);
+    auto* dst = static_cast<std::uint8_t*>(buf);
+    std::size_t done = 0;
+
+    while (done < count) {
+        const void* src;
+        const int chunk = read_direct(fd, &src, count - done);
 
-    if (fd->offset >= data.size()) {
+        if (chunk <= 0) {
+            break;
+        }
+
+        if (user) {
+            if (kcopy_to_user(dst + done, src, chunk) < 0) {
+                break;
+            }
+        } else {
+            memcpy(dst + done, src, chunk);
+        }
+
+        fd->offset += chunk;
+        done += chunk;
+    }
+
+    if (done == 0 && count > 0 && fd->offset < size) {
+        return -EFAULT;
+    }
+
+    return static_cast<int>(done);
+}
+
+/// @brief point *out at the file from fd->offset to at most the end of its page
+///
+int TmpFileInode::read_direct(FileDescriptor* fd, const void** out, std::size_t count)
+{
+    if (fd->offset >= size) {
         return 0;
     }
 
-    const std::size_t available = data.size() - fd->offset;
-    const std::size_t to_read = count < available ? count : available;
+    const std::size_t offset = fd->offset % arch::vmm::PAGE_SIZE;
+    std::size_t length = size - fd->offset;
+
+    if (length > arch::vmm::PAGE_SIZE - offset) {
+        length = arch::vmm::PAGE_SIZE - offset;
+    }
+
+    if (length > count) {
+        length = count;
+    }
+
+    const std::uint8_t* page = pages.find(fd->offset / arch::vmm::PAGE_SIZE);
+
+    *out = (page ? page : g_zero_page) + offset;
+
+    return static_cast<int>(length);
+}
+
+int TmpFileInode::truncate(std::size_t length)
+{
+    if (length < size) {
+        const std::size_t offset = length % arch::vmm::PAGE_SIZE;
+
+        // The rest of the last page has to read back as zeros if the file
+        // grows again
+        if (offset != 0) {
+            if (std::uint8_t* page = pages.find(length / arch::vmm::PAGE_SIZE)) {
+                memset(page + offset, 0, arch::vmm::PAGE_SIZE - offset);
+            }
+        }
+
+        // Mapped pages stay where they are until unmapped, the file gets
+        // fresh ones if it grows back over them
+        const std::size_t first = (length + arch::vmm::PAGE_SIZE - 1) / arch::vmm::PAGE_SIZE;
+        pages.truncate(first, maps > 0 ? &detached : nullptr);
+    }
+
+    size = length;
+
+    return 0;
+}
+
+int TmpFileInode::map()
+{
+    maps++;
+    return 0;
+}
+
+void TmpFileInode::unmap()
+{
+    if (--maps > 0) {
+        return;
+    }
+
+    for (std::uint8_t* page : detached) {
+        arch::vmm::free_kernel_page(page);
+    }
+
+    detached.clear();
 
-    for (std::size_t i = 0; i < to_read; i++) {
-        *(buff + i) = data[fd->offset++];
+    if (opens == 0 && unlinked) {
+        delete this;
     }
+}
+
+int TmpFileInode::map_page(std::size_t index, std::uintptr_t* phys)
+{
+    const auto page = reinterpret_cast<std::uintptr_t>(pages.find_or_create(index));
 
-    return to_read;
+    *phys = arch::vmm::virt_to_phys(arch::vmm::get_kernel_pml4(), page);
+
+    return 0;
 }
 
 int TmpFileInode::lseek(FileDescriptor* fd, int offset, int whence)
@@ -99,7 +268,7 @@ int TmpFileInode::lseek(FileDescriptor* fd, int offset, int whence)
         fd->offset = size + offset;
         break;
     default:
-        log::warn("tmpfs::lseek() invalid whence=", whence);
+        log::warn<log::Subsystem::FS>("tmpfs::lseek() invalid whence=", whence);
         return -EINVAL;
     }
 
@@ -130,59 +299,144 @@ TmpDirectoryInode::TmpDirectoryInode(kstring name, Inode* parent)
 
 Inode* TmpDirectoryInode::lookup(const char* name)
 {
-    for (std::size_t i = 0; i < children.size(); i++) {
-        Inode* inode = children[i];
+    return children.find(name);
+}
 
-        if (inode->name == name) {
-            return inode;
-        }
+int TmpDirectoryInode::mkdir(const char* name, int)
+{
+    if (children.find(name)) {
+        return -EEXIST;
     }
 
-    return nullptr;
+    children.insert(new TmpDirectoryInode{name, this});
+
+    return 0;
 }
 
-int TmpDirectoryInode::readdir(kvector<DirEntry>& entries)
+int TmpDirectoryInode::create(const char* name, int)
+{
+    if (children.find(name)) {
+        return -EEXIST;
+    }
+
+    children.insert(new TmpFileInode{name, this});
+
+    return 0;
+}
+
+int TmpDirectoryInode::unlink(const char* name)
 {
-    for (std::size_t i = 0; i < children.size(); i++) {
-        Inode* inode = children[i];
+    Inode* child = children.find(name);
 
-        entries.emplace_back(inode->name, inode->type);
+    if (!child) {
+        return -ENOENT;
     }
 
-    return children.size();
+    if (child->type == FileType::DIRECTORY) {
+        return -EISDIR;
+    }
+
+    children.remove(name);
+    release(child);
+
+    return 0;
 }
 
-int TmpDirectoryInode::mkdir(const char* name, int)
+int TmpDirectoryInode::rmdir(const char* name)
 {
-    TmpDirectoryInode* parent = this;
-    Inode* existing = parent->lookup(name);
+    Inode* child = children.find(name);
 
-    if (existing) {
-        return -1;
+    if (!child) {
+        return -ENOENT;
     }
 
-    parent->children.push_back(new TmpDirectoryInode{name, parent});
+    if (child->type != FileType::DIRECTORY) {
+        return -ENOTDIR;
+    }
+
+    if (!static_cast<TmpDirectoryInode*>(child)->children.empty()) {
+        return -ENOTEMPTY;
+    }
+
+    children.remove(name);
+    release(child);
 
     return 0;
 }
 
-int TmpDirectoryInode::create(const char* name, int)
+/// @brief move name to new_name in new_dir, which the VFS has checked is a
+///        directory of this mount
+///
+int TmpDirectoryInode::rename(const char* name, Inode* new_dir, const char* new_name)
 {
-    TmpDirectoryInode* parent = this;
-    Inode* existing = parent->lookup(name);
+    auto* target = static_cast<TmpDirectoryInode*>(new_dir);
+    Inode* child = children.find(name);
+
+    if (!child) {
+        return -ENOENT;
+    }
+
+    Inode* victim = target->children.find(new_name);
+
+    if (victim == child) {
+        return 0;
+    }
+
+    if (child->type == FileType::DIRECTORY) {
+        // A directory can not be moved under itself
+        for (Inode* dir = target; dir != nullptr; dir = dir->parent) {
+            if (dir == child) {
+                return -EINVAL;
+            }
+        }
+    }
+
+    if (victim) {
+        if (child->type == FileType::DIRECTORY && victim->type != FileType::DIRECTORY) {
+            return -ENOTDIR;
+        }
+
+        if (child->type != FileType::DIRECTORY && victim->type == FileType::DIRECTORY) {
+            return -EISDIR;
+        }
+
+        if (victim->type == FileType::DIRECTORY && !static_cast<TmpDirectoryInode*>(victim)->children.empty()) {
+            return -ENOTEMPTY;
+        }
 
-    if (existing) {
-        return -1;
+        target->children.remove(new_name);
     }
 
-    parent->children.push_back(new TmpFileInode{name, parent});
+    children.remove(name);
+    child->name = new_name;
+    child->parent = target;
+    target->children.insert(child);
+
+    if (victim) {
+        release(victim);
+    }
 
     return 0;
 }
 
-int TmpDirectoryInode::open(FileDescriptor*, int) { return 0; }
+int TmpDirectoryInode::open(FileDescriptor*, int)
+{
+    opens++;
+    children.pin();
 
-int TmpDirectoryInode::close(FileDescriptor*) { return 0; }
+    return 0;
+}
+
+int TmpDirectoryInode::close(FileDescriptor*)
+{
+    children.unpin();
+
+    if (--opens == 0 && unlinked) {
+        delete this;
+    }
+
+    return 0;
+}
 
 int TmpDirectoryInode::stat(Stat* stat)
 {
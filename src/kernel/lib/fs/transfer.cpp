@@ -0,0 +1,92 @@
+#include <arch.hpp>
+#include <fs/fs.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+
+namespace fs {
+
+/// @brief copy count bytes from in to out inside the kernel
+///
+/// Sources that keep their contents in memory (initramfs, tmpfs) are
+/// written to out straight from that memory, anything else is read() a page
+/// at a time into a bounce buffer. Both offsets advance by what was written
+///
+/// Writing out can block (a full pipe), and meanwhile the source may be
+/// truncated, or unlinked and closed. A map() reference is held on it for
+/// the whole transfer so the pages read_direct() points into outlive that
+///
+/// @return the bytes transferred, or -errno if nothing was
+///
+long transfer(FileDescriptor* in, FileDescriptor* out, std::size_t count)
+{
+    // Writing a file can move its memory, so copying a file onto itself
+    // always goes through the bounce buffer
+    const bool direct = in->inode != out->inode;
+    const bool pinned = direct && in->inode->map() == 0;
+
+    void* bounce = nullptr;
+    std::size_t total = 0;
+    int err = 0;
+
+    while (total < count) {
+        std::size_t want = count - total;
+
+        if (want > INT_MAX) {
+            want = INT_MAX;
+        }
+
+        const void* data = nullptr;
+        int got = direct ? in->inode->read_direct(in, &data, want) : -EOPNOTSUPP;
+        bool bounced = false;
+
+        if (got == -EOPNOTSUPP) {
+            if (bounce == nullptr) {
+                bounce = arch::vmm::alloc_kernel_page();
+            }
+
+            got = in->inode->read(in, bounce, want < arch::vmm::PAGE_SIZE ? want : arch::vmm::PAGE_SIZE);
+            data = bounce;
+            bounced = true;
+        }
+
+        if (got <= 0) {
+            err = got;
+            break;
+        }
+
+        const int written = out->inode->write(out, data, got);
+        const int consumed = written > 0 ? written : 0;
+
+        // read() already moved the source on by everything it returned
+        if (bounced) {
+            in->offset -= got - consumed;
+        } else {
+            in->offset += consumed;
+        }
+
+        if (written <= 0) {
+            err = written;
+            break;
+        }
+
+        total += written;
+
+        if (written < got) {
+            break;
+        }
+    }
+
+    if (bounce != nullptr) {
+        arch::vmm::free_kernel_page(bounce);
+    }
+
+    if (pinned) {
+        in->inode->unmap();
+    }
+
+    return total > 0 ? static_cast<long>(total) : err;
+}
+
+}
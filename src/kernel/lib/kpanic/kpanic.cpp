@@ -1,5 +1,6 @@
 #include <arch.hpp>
 #include <kpanic/kpanic.hpp>
+#include <log/log.hpp>
 
 [[noreturn]]
 void kpanic_halt()
@@ -13,3 +14,8 @@ void kpanic_halt()
 
     __builtin_unreachable();
 }
+
+void kpanic_flush_log()
+{
+    log::flush();
+}
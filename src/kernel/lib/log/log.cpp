@@ -0,0 +1,535 @@
+#include <arch.hpp>
+#include <boot/boot.hpp>
+#include <containers/kstring_view.hpp>
+#include <crt/crt.h>
+#include <exclusive/katomic.hpp>
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <fmt/fmt.hpp>
+#include <log/log.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace log {
+
+// Records are formatted into fixed size slots, longer messages are cut short
+constexpr std::size_t RING_SLOTS = 512;
+constexpr std::size_t TEXT_MAX = 232;
+
+// Formatted "<prio>,<seq>,<usec>,-;text" lines kept around for /dev/kmsg
+constexpr std::size_t KMSG_SIZE = 64 * 1024;
+
+static tunable::Tunable<std::uint32_t> g_klogd_interval_ms{
+    "log.klogd_interval_ms", 10, 1, 1000, "how often klogd writes out new records"};
+
+Level g_levels[NUM_SUBSYSTEMS] = {
+    Level::INFO, Level::INFO, Level::INFO, Level::INFO, Level::INFO, Level::INFO, Level::INFO,
+};
+
+/**
+ * One log record. A writer claims a slot by bumping the ring head, so writers
+ * never wait on each other or on klogd, even from interrupt context.
+ *
+ * seq is the commit marker: 0 while the slot is being written, then the
+ * position the slot was claimed at plus one. The reader only trusts a slot
+ * whose seq matches the position it expects, and checks seq again after
+ * copying the text out in case a writer lapped the ring meanwhile.
+ */
+struct Slot {
+    katomic<std::uint64_t> seq;
+    std::uint64_t time_us;
+    Level level;
+    Subsystem subsystem;
+    std::uint16_t length;
+    char text[TEXT_MAX];
+};
+
+struct Ring {
+    katomic<std::uint64_t> head; // next position to claim
+    std::uint64_t tail;          // next position klogd reads, only touched while draining
+    std::uint64_t dropped;       // records overwritten before klogd got to them
+    Slot slots[RING_SLOTS];
+};
+
+// Only the boot processor exists so far, every other CPU would get its own
+// ring through PerCPU::log_ring
+static Ring g_bsp_ring;
+
+// Only one drain runs at a time, a writer that finds it busy leaves its
+// record for whoever holds it (or the next klogd pass)
+static katomic<int> g_draining;
+static katomic<int> g_klogd_running;
+
+static kspinlock_irqsave g_kmsg_lock;
+static char g_kmsg[KMSG_SIZE];
+static std::uint64_t g_kmsg_end; // total bytes ever appended
+static std::uint64_t g_kmsg_seq;
+
+static Ring* current_ring()
+{
+    auto* cpu = arch::percpu::get();
+
+    if (cpu->log_ring == nullptr) {
+        cpu->log_ring = &g_bsp_ring;
+    }
+
+    return static_cast<Ring*>(cpu->log_ring);
+}
+
+static const char* level_tag(Level level)
+{
+    switch (level) {
+    case Level::DEBUG:
+        return "<DEBUG> ";
+    case Level::INFO:
+        return "<INFO> ";
+    case Level::SUCCESS:
+        return "<SUCCESS> ";
+    case Level::WARN:
+        return "<WARN> ";
+    case Level::ERROR:
+        return "<ERROR> ";
+    }
+
+    return "<?> ";
+}
+
+// syslog(3) priorities, which is what dmesg expects to find in /dev/kmsg
+static int level_priority(Level level)
+{
+    switch (level) {
+    case Level::DEBUG:
+        return 7;
+    case Level::INFO:
+        return 6;
+    case Level::SUCCESS:
+        return 5;
+    case Level::WARN:
+        return 4;
+    case Level::ERROR:
+        return 3;
+    }
+
+    return 6;
+}
+
+const char* level_name(Level level)
+{
+    switch (level) {
+    case Level::DEBUG:
+        return "debug";
+    case Level::INFO:
+        return "info";
+    case Level::SUCCESS:
+        return "success";
+    case Level::WARN:
+        return "warn";
+    case Level::ERROR:
+        return "error";
+    }
+
+    return "?";
+}
+
+const char* subsystem_name(Subsystem subsystem)
+{
+    switch (subsystem) {
+    case Subsystem::KERNEL:
+        return "kernel";
+    case Subsystem::MEMORY:
+        return "memory";
+    case Subsystem::SCHED:
+        return "sched";
+    case Subsystem::PROCESS:
+        return "process";
+    case Subsystem::SYSCALL:
+        return "syscall";
+    case Subsystem::FS:
+        return "fs";
+    case Subsystem::DRIVER:
+        return "driver";
+    case Subsystem::COUNT:
+        break;
+    }
+
+    return "?";
+}
+
+/// @brief parse a level name ("debug", "info", ...) or number (0-4)
+///
+/// @return false if str is not a valid level
+///
+bool parse_level(kstring_view str, Level* level)
+{
+    for (int i = static_cast<int>(Level::DEBUG); i <= static_cast<int>(Level::ERROR); i++) {
+        const auto l = static_cast<Level>(i);
+
+        if (str == kstring_view{level_name(l)} || (str.length() == 1 && str[0] == '0' + i)) {
+            *level = l;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void set_level(Subsystem subsystem, Level level)
+{
+    g_levels[static_cast<std::size_t>(subsystem)] = level;
+}
+
+Level get_level(Subsystem subsystem)
+{
+    return g_levels[static_cast<std::size_t>(subsystem)];
+}
+
+/**
+ * The level of one subsystem as a tunable, log.<subsystem> in kernel.conf and
+ * /proc/sys/log/<subsystem>. Values are level names ("debug", "warn", ...)
+ * or their numbers. The level itself stays in g_levels, which is what
+ * enabled() checks.
+ */
+class LevelTunable final : public tunable::TunableBase {
+private:
+    Subsystem _subsystem;
+
+public:
+    LevelTunable(const char* name, Subsystem subsystem)
+        : TunableBase{name, "lowest log level printed"}
+        , _subsystem{subsystem}
+    {
+    }
+
+    std::int64_t get() const override { return static_cast<std::int64_t>(get_level(_subsystem)); }
+
+    int set(std::int64_t value) override
+    {
+        if (value < static_cast<int>(Level::DEBUG) || value > static_cast<int>(Level::ERROR)) {
+            return -EINVAL;
+        }
+
+        set_level(_subsystem, static_cast<Level>(value));
+
+        return 0;
+    }
+
+    bool parse(kstring_view text, std::int64_t* value) const override
+    {
+        Level level;
+
+        if (!parse_level(text, &level)) {
+            return false;
+        }
+
+        *value = static_cast<std::int64_t>(level);
+
+        return true;
+    }
+
+    std::size_t format(char* buf, std::size_t size) const override
+    {
+        const char* name = level_name(get_level(_subsystem));
+        std::size_t length = 0;
+
+        while (name[length] != '\0' && length < size) {
+            buf[length] = name[length];
+            length++;
+        }
+
+        return length;
+    }
+};
+
+static LevelTunable g_level_tunables[] = {
+    {"log.kernel", Subsystem::KERNEL},
+    {"log.memory", Subsystem::MEMORY},
+    {"log.sched", Subsystem::SCHED},
+    {"log.process", Subsystem::PROCESS},
+    {"log.syscall", Subsystem::SYSCALL},
+    {"log.fs", Subsystem::FS},
+    {"log.driver", Subsystem::DRIVER},
+};
+
+static_assert(sizeof(g_level_tunables) / sizeof(g_level_tunables[0]) == NUM_SUBSYSTEMS);
+
+/// @brief append a formatted line to the /dev/kmsg buffer
+///
+static void kmsg_append(const char* line, std::size_t length)
+{
+    g_kmsg_lock.lock();
+
+    for (std::size_t i = 0; i < length; i++) {
+        g_kmsg[(g_kmsg_end + i) % KMSG_SIZE] = line[i];
+    }
+
+    g_kmsg_end += length;
+
+    g_kmsg_lock.unlock();
+}
+
+/// @brief write one record to COM1 and the /dev/kmsg buffer
+///
+static void emit(const Slot& record)
+{
+    const kstring_view text{record.text, record.length};
+
+    kprint("[t=", record.time_us, "us] ", level_tag(record.level));
+
+    if (record.subsystem != Subsystem::KERNEL) {
+        kprint('[', subsystem_name(record.subsystem), "] ");
+    }
+
+    kprintln(text);
+
+    // The serial copy above is only for whoever watches COM1, dmesg reads this one
+    char line[TEXT_MAX + 64];
+    detail::RecordSink sink{line, sizeof(line), 0, nullptr, 0};
+
+    kprint_to(sink, level_priority(record.level), ',', g_kmsg_seq++, ',', record.time_us, ",-;");
+
+    if (record.subsystem != Subsystem::KERNEL) {
+        kprint_to(sink, subsystem_name(record.subsystem), ": ");
+    }
+
+    kprint_to(sink, text);
+
+    // Always end on a newline, even if the text filled the line buffer
+    if (sink.length == sink.capacity) {
+        sink.length--;
+    }
+
+    sink.putchar('\n');
+
+    kmsg_append(line, sink.length);
+}
+
+/// @brief print every committed record of ring, oldest first
+///
+/// @note the caller must hold g_draining
+///
+static void drain_ring(Ring& ring)
+{
+    while (true) {
+        const std::uint64_t head = ring.head.load();
+
+        if (ring.tail == head) {
+            break;
+        }
+
+        // Writers lapped the reader, everything older than one ring is gone
+        if (head - ring.tail > RING_SLOTS) {
+            ring.dropped += head - ring.tail - RING_SLOTS;
+            ring.tail = head - RING_SLOTS;
+        }
+
+        Slot& slot = ring.slots[ring.tail % RING_SLOTS];
+        const std::uint64_t seq = slot.seq.load();
+
+        // 0 means a writer is still filling the slot in, and a seq from the
+        // previous lap means its writer has not even started. Either way
+        // nothing after it can be printed in order yet
+        if (seq == 0 || seq < ring.tail + 1) {
+            break;
+        }
+
+        if (seq != ring.tail + 1) {
+            ring.dropped++;
+            ring.tail++;
+            continue;
+        }
+
+        Slot copy;
+        copy.time_us = slot.time_us;
+        copy.level = slot.level;
+        copy.subsystem = slot.subsystem;
+        copy.length = slot.length;
+        memcpy(copy.text, slot.text, copy.length);
+
+        // Overwritten while copying, the copy may be torn
+        if (slot.seq.load() != seq) {
+            ring.dropped++;
+            ring.tail++;
+            continue;
+        }
+
+        ring.tail++;
+
+        if (ring.dropped > 0) {
+            const std::uint64_t dropped = ring.dropped;
+            ring.dropped = 0;
+
+            Slot note;
+            note.time_us = copy.time_us;
+            note.level = Level::WARN;
+            note.subsystem = Subsystem::KERNEL;
+
+            detail::RecordSink sink{note.text, TEXT_MAX, 0, nullptr, 0};
+            kprint_to(sink, dropped, " log messages dropped");
+            note.length = sink.length;
+
+            emit(note);
+        }
+
+        emit(copy);
+    }
+}
+
+/// @brief print everything still sitting in the log rings
+///
+/// Returns straight away if another drain is already in progress
+///
+void flush()
+{
+    if (g_draining.exchange(1) == 1) {
+        return;
+    }
+
+    drain_ring(g_bsp_ring);
+
+    g_draining.store(0);
+}
+
+[[noreturn]]
+static void klogd_kthread()
+{
+    g_klogd_running.store(1);
+
+    auto* sched = scheduler::get_scheduler();
+
+    while (true) {
+        flush();
+        sched->yield_sleep(g_klogd_interval_ms.value());
+    }
+}
+
+/// @brief hand serial output over to klogd
+///
+/// Until klogd runs, every record is printed as soon as it is committed
+/// so nothing is lost if the kernel dies during boot
+///
+void start_klogd()
+{
+    auto* klogd = new process::KThread(klogd_kthread);
+    scheduler::get_scheduler()->add_process(klogd);
+}
+
+/// @brief apply `loglevel=` and `log.<subsystem>=` from the kernel command line
+///
+void init()
+{
+    Level level;
+    const kstring_view global = boot::get_cmdline_option("loglevel");
+
+    if (!global.empty()) {
+        if (parse_level(global, &level)) {
+            for (std::size_t i = 0; i < NUM_SUBSYSTEMS; i++) {
+                g_levels[i] = level;
+            }
+        } else {
+            warn("log: unknown loglevel '", global, "'");
+        }
+    }
+
+    for (std::size_t i = 0; i < NUM_SUBSYSTEMS; i++) {
+        const auto subsystem = static_cast<Subsystem>(i);
+
+        char key[32];
+        detail::RecordSink sink{key, sizeof(key) - 1, 0, nullptr, 0};
+        kprint_to(sink, "log.", subsystem_name(subsystem));
+        key[sink.length] = '\0';
+
+        const kstring_view value = boot::get_cmdline_option(key);
+
+        if (value.empty()) {
+            continue;
+        }
+
+        if (parse_level(value, &level)) {
+            set_level(subsystem, level);
+        } else {
+            warn("log: unknown level '", value, "' for ", key);
+        }
+    }
+
+    infof("log: {} records of {} bytes per CPU, compiled in level {}",
+          RING_SLOTS,
+          TEXT_MAX,
+          level_name(static_cast<Level>(LOG_COMPILE_LEVEL)));
+}
+
+/// @brief copy bytes of the /dev/kmsg buffer starting at *offset
+///
+/// offset counts every byte ever logged. If the buffer already wrapped past
+/// it, reading resumes at the oldest complete line still buffered.
+///
+/// @return the number of bytes copied, 0 once the reader has caught up
+///
+std::size_t read_kmsg(std::uint64_t* offset, char* buf, std::size_t size)
+{
+    g_kmsg_lock.lock();
+
+    std::uint64_t pos = *offset;
+
+    if (g_kmsg_end > KMSG_SIZE && pos < g_kmsg_end - KMSG_SIZE) {
+        pos = g_kmsg_end - KMSG_SIZE;
+
+        while (pos < g_kmsg_end && g_kmsg[pos % KMSG_SIZE] != '\n') {
+            pos++;
+        }
+
+        pos++;
+    }
+
+    std::size_t copied = 0;
+
+    while (pos < g_kmsg_end && copied < size) {
+        buf[copied++] = g_kmsg[pos++ % KMSG_SIZE];
+    }
+
+    *offset = pos;
+
+    g_kmsg_lock.unlock();
+
+    return copied;
+}
+
+namespace detail {
+
+/// @brief claim the next slot of this CPU's ring
+///
+RecordSink begin_record(Level level, Subsystem subsystem)
+{
+    Ring* ring = current_ring();
+
+    const std::uint64_t pos = ring->head++;
+    Slot& slot = ring->slots[pos % RING_SLOTS];
+
+    slot.seq.store(0);
+    slot.time_us = arch::drivers::tsc::get_time_us();
+    slot.level = level;
+    slot.subsystem = subsystem;
+
+    return RecordSink{slot.text, TEXT_MAX, 0, &slot, pos + 1};
+}
+
+/// @brief publish a record filled in through begin_record()
+///
+void commit_record(RecordSink& sink)
+{
+    auto* slot = static_cast<Slot*>(sink.slot);
+
+    slot->length = static_cast<std::uint16_t>(sink.length);
+    slot->seq.store(sink.seq);
+
+    if (g_klogd_running.load() == 0) {
+        flush();
+    }
+}
+
+}
+
+}
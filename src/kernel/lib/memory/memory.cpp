@@ -1,6 +1,3 @@
-#include "arch/x64/cpu/cpu.hpp"
-#include "arch/x64/memory/vmm.hpp"
-#include "kassert/kassert.hpp"
 #include "memory/slab.hpp"
 #include <arch.hpp>
 #include <crt/crt.h>
@@ -15,7 +12,7 @@ void* kmalloc(std::size_t size)
     void* ret = nullptr;
 
     if (size == 0) {
-        log::warn("kmalloc(0) returns NULL");
+        log::warn<log::Subsystem::MEMORY>("kmalloc(0) returns NULL");
     } else if (slab::can_alloc(size)) {
         ret = slab::alloc(size);
     } else {
@@ -38,22 +35,12 @@ void kfree(void* ptr)
     }
 }
 
-void kcopy_to_user(void* dst, const void* src, std::size_t size)
+int kcopy_to_user(void* dst, const void* src, std::size_t size)
 {
-    kassert(arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(dst), size));
-
-    std::uint64_t rflags = arch::cpu::read_rflags();
-    arch::cpu::stac();
-    memcpy(dst, src, size);
-    arch::cpu::write_rflags(rflags);
+    return arch::uaccess::copy_to_user(dst, src, size);
 }
 
-void kcopy_from_user(void* dst, const void* src, std::size_t size)
+int kcopy_from_user(void* dst, const void* src, std::size_t size)
 {
-    kassert(arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(src), size));
-
-    std::uint64_t rflags = arch::cpu::read_rflags();
-    arch::cpu::stac();
-    memcpy(dst, src, size);
-    arch::cpu::write_rflags(rflags);
+    return arch::uaccess::copy_from_user(dst, src, size);
 }
@@ -100,11 +100,15 @@ void add_free_memory(std::size_t addr, std::size_t len)
 
     if (end >= MAX_MEMORY_BYTES) {
         if (addr >= MAX_MEMORY_BYTES) {
-            log::warn("Ignoring memory region at ", fmt::hex{addr}, " (beyond max)");
+            log::warn<log::Subsystem::MEMORY>("Ignoring memory region at ", fmt::hex{addr}, " (beyond max)");
             goto cleanup;
         }
 
-        log::warn("Truncating memory region from ", fmt::hex{end}, " to ", fmt::hex{MAX_MEMORY_BYTES});
+        log::warn<log::Subsystem::MEMORY>(
+            "Truncating memory region from ",
+            fmt::hex{end},
+            " to ",
+            fmt::hex{MAX_MEMORY_BYTES});
         len = MAX_MEMORY_BYTES - addr;
     }
 
@@ -61,6 +61,7 @@
 #include <arch.hpp>
 #include <log/log.hpp>
 #include <memory/slab.hpp>
+#include <tunable/tunable.hpp>
 
 #include <cassert>
 #include <cstddef>
@@ -73,13 +74,19 @@ constexpr std::uint8_t chunks_per_slab(std::size_t chunk_size)
     return (arch::vmm::PAGE_SIZE - sizeof(Slab)) / chunk_size;
 }
 
+// Empty slabs a size class keeps instead of handing the page back. Without a
+// few spares, a workload that allocates and frees around a slab boundary
+// would create and destroy a slab (and map/unmap its page) every time
+static tunable::Tunable<std::uint32_t> g_empty_slabs_kept{
+    "slab.empty_slabs_kept", 1, 0, 64, "empty slabs kept per size class"};
+
 static SizeClass classes[] = {
-    {0, SIZE_32, 0, nullptr, chunks_per_slab(SIZE_32)},
-    {1, SIZE_64, 0, nullptr, chunks_per_slab(SIZE_64)},
-    {2, SIZE_128, 0, nullptr, chunks_per_slab(SIZE_128)},
-    {3, SIZE_256, 0, nullptr, chunks_per_slab(SIZE_256)},
-    {4, SIZE_512, 0, nullptr, chunks_per_slab(SIZE_512)},
-    {5, SIZE_1024, 0, nullptr, chunks_per_slab(SIZE_1024)}};
+    {0, SIZE_32, 0, nullptr, chunks_per_slab(SIZE_32), 0},
+    {1, SIZE_64, 0, nullptr, chunks_per_slab(SIZE_64), 0},
+    {2, SIZE_128, 0, nullptr, chunks_per_slab(SIZE_128), 0},
+    {3, SIZE_256, 0, nullptr, chunks_per_slab(SIZE_256), 0},
+    {4, SIZE_512, 0, nullptr, chunks_per_slab(SIZE_512), 0},
+    {5, SIZE_1024, 0, nullptr, chunks_per_slab(SIZE_1024), 0}};
 
 /**
  * @brief Gets the Slab containing an address, if it's a valid slab allocation.
@@ -209,6 +216,7 @@ Slab* create_slab(SizeClass* sc)
 
     sc->first_slab = slab;
     sc->num_slabs += 1;
+    sc->num_empty_slabs += 1;
 
     return slab;
 }
@@ -225,7 +233,7 @@ Slab* create_slab(SizeClass* sc)
 void destroy_slab(SizeClass* sc, Slab* slab)
 {
     if (sc == nullptr || slab == nullptr) {
-        log::warn("Attempt to destroy NULL slab");
+        log::warn<log::Subsystem::MEMORY>("Attempt to destroy NULL slab");
         return;
     }
 
@@ -233,7 +241,7 @@ void destroy_slab(SizeClass* sc, Slab* slab)
     Slab* next = slab->next_slab;
 
     if (prev == nullptr && next == nullptr) {
-        log::warn("Attempt to destroy only slab in SizeClass: ", sc->size);
+        log::warn<log::Subsystem::MEMORY>("Attempt to destroy only slab in SizeClass: ", sc->size);
         return;
     }
 
@@ -249,6 +257,10 @@ void destroy_slab(SizeClass* sc, Slab* slab)
 
     sc->num_slabs -= 1;
 
+    if (slab->free_chunks == sc->chunks_per_slab) {
+        sc->num_empty_slabs -= 1;
+    }
+
     arch::vmm::free_kernel_page(slab);
 }
 
@@ -278,6 +290,10 @@ void* alloc(std::size_t size)
 
     void* chunk = slab->free_head;
 
+    if (slab->free_chunks == sc->chunks_per_slab) {
+        sc->num_empty_slabs -= 1;
+    }
+
     slab->free_head = *(void**)slab->free_head;
     slab->free_chunks -= 1;
 
@@ -288,8 +304,9 @@ void* alloc(std::size_t size)
  * @brief Frees memory back to the slab allocator.
  *
  * Returns the chunk to its slab's free list. If the slab becomes
- * completely empty and isn't the last slab in its size class, the
- * slab is destroyed.
+ * completely empty, isn't the last slab in its size class, and the size
+ * class already holds slab.empty_slabs_kept empty slabs, the slab is
+ * destroyed.
  *
  * @param addr Pointer previously returned by slab::alloc().
  */
@@ -307,10 +324,15 @@ void free(void* addr)
     slab->free_head = addr;
     slab->free_chunks += 1;
 
-    // If freeing a chunk from this slab results in an empty slab, it is
-    // no longer needed, so destroy it, unless this is the only slab in the
-    // SizeClass
-    if (slab->free_chunks == sc->chunks_per_slab && sc->num_slabs > 1) {
+    if (slab->free_chunks != sc->chunks_per_slab) {
+        return;
+    }
+
+    sc->num_empty_slabs += 1;
+
+    // The slab is empty, keep it as a spare if there is room for one,
+    // otherwise destroy it (unless it is the only slab in the SizeClass)
+    if (sc->num_empty_slabs > g_empty_slabs_kept.value() && sc->num_slabs > 1) {
         destroy_slab(sc, slab);
     }
 }
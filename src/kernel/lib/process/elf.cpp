@@ -38,27 +38,27 @@ Elf64_File parse_file(std::uint8_t* buffer, [[maybe_unused]] std::size_t size)
         return invalid_file();
     }
 
-    log::info("Validating ELF file...");
+    log::info<log::Subsystem::PROCESS>("Validating ELF file...");
 
     auto* header = reinterpret_cast<Elf64_Header*>(buffer);
 
     if (!validate_magic(header)) {
-        log::warn("Invalid ELF magic found, not an ELF file");
+        log::warn<log::Subsystem::PROCESS>("Invalid ELF magic found, not an ELF file");
         return invalid_file();
     }
 
     if (!validate_class(header)) {
-        log::warn("Invalid ELF class, expected 64-bit");
+        log::warn<log::Subsystem::PROCESS>("Invalid ELF class, expected 64-bit");
         return invalid_file();
     }
 
     if (!validate_machine(header)) {
-        log::warn("Invalid ELF machine, expected x86-64");
+        log::warn<log::Subsystem::PROCESS>("Invalid ELF machine, expected x86-64");
         return invalid_file();
     }
 
     if (!validate_type(header)) {
-        log::warn("Invalid ELF type, exepcted executable");
+        log::warn<log::Subsystem::PROCESS>("Invalid ELF type, exepcted executable");
         return invalid_file();
     }
 
@@ -80,14 +80,14 @@ Elf64_File parse_file(std::uint8_t* buffer, [[maybe_unused]] std::size_t size)
     }
 
     for (const auto& header : file.program_headers) {
-        log::debugf("ELF program header: flags = {} vaddr = {} file sz = {} mem sz = {}",
+        log::debugf<log::Subsystem::PROCESS>("ELF program header: flags = {} vaddr = {} file sz = {} mem sz = {}",
             fmt::bin{header.p_flags},
             fmt::hex{header.p_vaddr},
             fmt::hex{header.p_filesz},
             fmt::hex{header.p_memsz});
     }
 
-    log::success("Valid ELF File found!");
+    log::success<log::Subsystem::PROCESS>("Valid ELF File found!");
 
     return file;
 }
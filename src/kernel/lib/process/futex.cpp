@@ -0,0 +1,334 @@
+#include <arch.hpp>
+#include <containers/klist.hpp>
+#include <exclusive/kspinlock_irqsave.hpp>
+#include <memory/memory.hpp>
+#include <process/futex.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace process::futex {
+
+// Waiters are spread over a fixed number of hashed buckets, each with its own
+// lock and queue, so unrelated futexes rarely contend with one another
+constexpr std::size_t NUM_BUCKETS = 256;
+
+struct Bucket {
+    kspinlock_irqsave lock;
+    klist<Waiter*> waiters;
+};
+
+static Bucket g_buckets[NUM_BUCKETS];
+
+static Bucket& bucket_for(const Key& key)
+{
+    // Fibonacci hashing, the low bits of addresses are too regular to use as is
+    const std::uint64_t hash = (key.base ^ (key.offset >> 2)) * 0x9E3779B97F4A7C15ull;
+
+    return g_buckets[hash >> 56];
+}
+
+/// @brief compute the key for a futex word of the calling process
+///
+/// @return 0 on success, -EINVAL for a misaligned address, -EFAULT if the
+///         address is not mapped user memory
+///
+static int make_key(const std::uint32_t* __user uaddr, bool is_private, Key* key)
+{
+    const auto addr = reinterpret_cast<std::uintptr_t>(uaddr);
+
+    if (addr % sizeof(std::uint32_t) != 0) {
+        return -EINVAL;
+    }
+
+    if (!arch::vmm::is_user_addr(addr, sizeof(std::uint32_t))) {
+        return -EFAULT;
+    }
+
+    AddressSpace* mm = arch::percpu::current_process()->mm;
+    const std::uintptr_t phys = arch::vmm::virt_to_phys(mm->pml4, addr);
+
+    // Checked even for private futexes, reading an unmapped word would fault
+    if (phys == 0) {
+        return -EFAULT;
+    }
+
+    if (is_private) {
+        *key = {reinterpret_cast<std::uintptr_t>(mm), addr};
+    } else {
+        // Physical pages are page aligned, bit 0 keeps shared keys from ever
+        // colliding with a private key
+        *key = {(phys & ~0xFFFull) | 1, addr & 0xFFF};
+    }
+
+    return 0;
+}
+
+/// @brief lock the bucket a waiter is queued in
+///
+/// requeue() may move a waiter to another bucket at any time, so the bucket
+/// is looked up again after locking and the lock retried if it changed
+///
+static Bucket& lock_waiter_bucket(Waiter* waiter)
+{
+    while (true) {
+        Bucket& bucket = bucket_for(waiter->key);
+        bucket.lock.lock();
+
+        if (&bucket == &bucket_for(waiter->key)) {
+            return bucket;
+        }
+
+        bucket.lock.unlock();
+    }
+}
+
+/// @brief wake up to count waiters of key queued in bucket
+///
+/// @note the caller must hold bucket.lock
+///
+static int wake_locked(Bucket& bucket, const Key& key, int count)
+{
+    int woken = 0;
+    std::size_t i = 0;
+
+    while (i < bucket.waiters.size() && woken < count) {
+        Waiter* waiter = bucket.waiters[i];
+        Process* p = waiter->process;
+
+        // A killed thread is left for cancel(), it can not take the wakeup
+        if (!(waiter->key == key) || p->is_dead() || p->is_zombie()) {
+            i++;
+            continue;
+        }
+
+        bucket.waiters.erase(i);
+        waiter->woken = true;
+        scheduler::get_scheduler()->wake_process(p, WaitReason::FUTEX);
+        woken++;
+    }
+
+    return woken;
+}
+
+/// @brief block until uaddr is woken, if it still holds the expected value
+///
+/// The value is read with the bucket lock held, and wake() takes the same
+/// lock, so a wakeup between the userspace check and this call is never lost
+///
+/// @param uaddr the futex word
+/// @param expected the value the caller saw in the futex word
+/// @param is_private true if only threads of this process use the futex
+/// @param timeout_ms relative timeout, or NO_TIMEOUT
+///
+/// @return 0 when woken, -EAGAIN if the value changed, -ETIMEDOUT on timeout,
+///         -EINTR if the thread group is killed
+///
+int wait(std::uint32_t* __user uaddr, std::uint32_t expected, bool is_private, std::uint64_t timeout_ms)
+{
+    Key key;
+    const int err = make_key(uaddr, is_private, &key);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Process* current = arch::percpu::current_process();
+    Waiter waiter{current, key, false};
+    Bucket& bucket = bucket_for(key);
+
+    bucket.lock.lock();
+
+    // A fault only redirects to the fixup, it never sleeps, so reading the
+    // word with the bucket locked is fine
+    std::uint32_t value;
+
+    if (arch::uaccess::get_user(value, uaddr) < 0) {
+        bucket.lock.unlock();
+        return -EFAULT;
+    }
+
+    if (value != expected) {
+        bucket.lock.unlock();
+        return -EAGAIN;
+    }
+
+    if (timeout_ms == 0) {
+        bucket.lock.unlock();
+        return -ETIMEDOUT;
+    }
+
+    bucket.waiters.push_back(&waiter);
+    current->futex_waiter = &waiter;
+    current->wake_pending = false;
+
+    bucket.lock.unlock();
+
+    auto* sched = scheduler::get_scheduler();
+
+    const int killed = timeout_ms == NO_TIMEOUT ? sched->yield_killable(WaitReason::FUTEX)
+                                                : sched->yield_killable_timeout(WaitReason::FUTEX, timeout_ms);
+
+    Bucket& queued = lock_waiter_bucket(&waiter);
+
+    if (!waiter.woken) {
+        queued.waiters.remove(&waiter);
+    }
+
+    // wake_process() may have flagged a wakeup that arrived after the
+    // timeout already made this task READY, it must not leak into the
+    // next unrelated yield_blocked()
+    current->futex_waiter = nullptr;
+    current->wake_pending = false;
+
+    queued.lock.unlock();
+
+    if (waiter.woken) {
+        return 0;
+    }
+
+    return killed < 0 ? killed : -ETIMEDOUT;
+}
+
+/// @brief wake up to count tasks waiting on uaddr
+///
+/// @return the number of tasks woken
+///
+int wake(std::uint32_t* __user uaddr, int count, bool is_private)
+{
+    Key key;
+    const int err = make_key(uaddr, is_private, &key);
+
+    if (err < 0) {
+        return err;
+    }
+
+    Bucket& bucket = bucket_for(key);
+
+    bucket.lock.lock();
+    const int woken = wake_locked(bucket, key, count);
+    bucket.lock.unlock();
+
+    return woken;
+}
+
+/// @brief wake up to wake_count waiters of uaddr and move up to requeue_count
+///        of the remaining ones over to uaddr2
+///
+/// Used for condition variables, so a broadcast wakes one waiter and hands
+/// the rest to the mutex instead of waking them all only to fight over it.
+///
+/// @param expected if not null, the value uaddr must still hold (FUTEX_CMP_REQUEUE)
+///
+/// @return the number of tasks woken plus the number requeued, -EAGAIN if
+///         uaddr no longer holds *expected
+///
+int requeue(std::uint32_t* __user uaddr,
+            std::uint32_t* __user uaddr2,
+            int wake_count,
+            int requeue_count,
+            bool is_private,
+            const std::uint32_t* expected)
+{
+    Key key;
+    Key key2;
+    int err = make_key(uaddr, is_private, &key);
+
+    if (err == 0) {
+        err = make_key(uaddr2, is_private, &key2);
+    }
+
+    if (err < 0) {
+        return err;
+    }
+
+    Bucket& bucket = bucket_for(key);
+    Bucket& bucket2 = bucket_for(key2);
+
+    // Always lock the lower bucket first so two opposite requeues can not deadlock
+    Bucket& first = &bucket < &bucket2 ? bucket : bucket2;
+    Bucket& second = &bucket < &bucket2 ? bucket2 : bucket;
+
+    first.lock.lock();
+
+    if (&second != &first) {
+        second.lock.lock();
+    }
+
+    int result = 0;
+
+    if (expected != nullptr) {
+        std::uint32_t value;
+
+        if (arch::uaccess::get_user(value, uaddr) < 0) {
+            result = -EFAULT;
+        } else if (value != *expected) {
+            result = -EAGAIN;
+        }
+    }
+
+    if (result == 0) {
+        result = wake_locked(bucket, key, wake_count);
+
+        int moved = 0;
+        std::size_t i = 0;
+
+        while (i < bucket.waiters.size() && moved < requeue_count) {
+            Waiter* waiter = bucket.waiters[i];
+
+            if (!(waiter->key == key)) {
+                i++;
+                continue;
+            }
+
+            waiter->key = key2;
+
+            if (&bucket2 != &bucket) {
+                bucket.waiters.erase(i);
+                bucket2.waiters.push_back(waiter);
+            } else {
+                i++;
+            }
+
+            moved++;
+        }
+
+        result += moved;
+    }
+
+    if (&second != &first) {
+        second.lock.unlock();
+    }
+
+    first.lock.unlock();
+
+    return result;
+}
+
+/// @brief forget a task that was killed while blocked in wait()
+///
+/// Its Waiter lives on the kernel stack, so it has to leave its bucket
+/// before the stack is freed
+///
+void cancel(Process* p)
+{
+    Waiter* waiter = p->futex_waiter;
+
+    if (waiter == nullptr) {
+        return;
+    }
+
+    Bucket& bucket = lock_waiter_bucket(waiter);
+
+    if (!waiter->woken) {
+        bucket.waiters.remove(waiter);
+    }
+
+    p->futex_waiter = nullptr;
+
+    bucket.lock.unlock();
+}
+
+}
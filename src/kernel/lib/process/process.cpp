@@ -8,12 +8,17 @@
 #include <fmt/fmt.hpp>
 #include <fs/devfs/dev_tty.hpp>
 #include <fs/fs.hpp>
+#include <fs/poll.hpp>
 #include <kassert/kassert.hpp>
+#include <linux/auxv.hpp>
 #include <log/log.hpp>
+#include <memory/kobject_cache.hpp>
 #include <memory/pmm.hpp>
 #include <memory/slab.hpp>
 #include <process/elf.hpp>
+#include <process/futex.hpp>
 #include <process/process.hpp>
+#include <process/wait_queue.hpp>
 #include <scheduler/scheduler.hpp>
 
 #include <cstddef>
@@ -30,8 +35,223 @@ constexpr std::uintptr_t KERNEL_STACK_SIZE = 16 * 1024; // 16KiB
 /// based on /proc/sys/vm/mmap_min_addr in Linux
 constexpr std::uintptr_t DEFAULT_MMAP_MIN_ADDR = 65536;
 
+// How many freed kernel stacks and Process objects are kept for reuse by
+// fork() and KThread, enough to absorb a burst of short-lived processes
+constexpr std::size_t KERNEL_STACK_CACHE_SIZE = 16;
+constexpr std::size_t PROCESS_CACHE_SIZE = 32;
+
 static katomic<int> g_pid{1};
 
+static kobject_cache<KERNEL_STACK_SIZE, KERNEL_STACK_CACHE_SIZE> g_kernel_stack_cache;
+static kobject_cache<sizeof(Process), PROCESS_CACHE_SIZE> g_process_cache;
+
+static std::uint8_t* alloc_kernel_stack()
+{
+    return static_cast<std::uint8_t*>(g_kernel_stack_cache.alloc());
+}
+
+/// @brief allocate a process from the process cache
+///
+/// Memory is zeroed so recycled processes never see a previous owner's fields
+///
+void* Process::operator new(std::size_t size)
+{
+    void* ptr = size == sizeof(Process) ? g_process_cache.alloc() : kmalloc(size);
+
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+void Process::operator delete(void* ptr, std::size_t size)
+{
+    if (size == sizeof(Process)) {
+        g_process_cache.free(ptr);
+    } else {
+        kfree(ptr);
+    }
+}
+
+AddressSpace::AddressSpace(arch::vmm::PML4E* pml4)
+    : refs{1}
+    , pml4{pml4}
+    , heap_break{0}
+    , mmap_min_addr{DEFAULT_MMAP_MIN_ADDR}
+    , uheap{}
+{
+}
+
+/// @brief copy the address space for fork(), the copy starts with one reference
+///
+AddressSpace* AddressSpace::clone()
+{
+    auto* copy = new AddressSpace{arch::vmm::clone_user_pml4(pml4)};
+
+    copy->heap_break = heap_break;
+    copy->uheap = arch::vmm::clone_user_heap(&uheap, copy->pml4);
+
+    // The cloned page tables already map the same frames
+    maps_lock.lock();
+
+    for (const FileMapping& mapping : file_maps) {
+        mapping.inode->map();
+        copy->file_maps.push_back(mapping);
+    }
+
+    maps_lock.unlock();
+
+    return copy;
+}
+
+void AddressSpace::get()
+{
+    refs++;
+}
+
+void AddressSpace::put()
+{
+    if (--refs == 0) {
+        arch::vmm::free_user_pml4(pml4);
+
+        for (const FileMapping& mapping : file_maps) {
+            mapping.inode->unmap();
+        }
+
+        delete this;
+    }
+}
+
+// KThreads all run in the kernel page tables, which are never freed, so they
+// share one address space that always holds an extra reference
+static AddressSpace* kernel_address_space()
+{
+    static AddressSpace* kernel_mm = nullptr;
+
+    if (kernel_mm == nullptr) {
+        kernel_mm = new AddressSpace{arch::vmm::get_kernel_pml4()};
+    }
+
+    kernel_mm->get();
+
+    return kernel_mm;
+}
+
+FileTable::FileTable()
+    : refs{1}
+    , fds{}
+    , cwd{nullptr}
+    , cloexec{}
+{
+}
+
+/// @brief open stdin, stdout and stderr on the terminal
+///
+static void open_std_fds(FileTable* files)
+{
+    files->fds.push_back(fs::open("/dev/tty1", fs::O_RDONLY));
+    files->fds.push_back(fs::open("/dev/tty1", fs::O_WRONLY));
+    files->fds.push_back(fs::open("/dev/tty1", fs::O_WRONLY));
+}
+
+void FileTable::get()
+{
+    refs++;
+}
+
+void FileTable::put()
+{
+    if (--refs != 0) {
+        return;
+    }
+
+    for (fs::FileDescriptor* fd : fds) {
+        if (fd != nullptr) {
+            fd->put();
+        }
+    }
+
+    if (cwd != nullptr) {
+        cwd->put();
+    }
+
+    delete this;
+}
+
+/// @brief copy the table for fork(), both sides share each open file
+///
+/// Like on Linux the open file (and its offset) is shared, only the fd
+/// numbers are private, which is what lets a shell hand a pipe to a child
+///
+FileTable* FileTable::clone() const
+{
+    auto* copy = new FileTable{};
+
+    if (cwd != nullptr) {
+        cwd->get();
+    }
+
+    copy->cwd = cwd;
+    copy->fds.resize(fds.size());
+    memcpy(copy->cloexec, cloexec, sizeof(cloexec));
+
+    for (std::size_t i = 0; i < fds.size(); i++) {
+        if (fds[i] != nullptr) {
+            fds[i]->get();
+        }
+
+        copy->fds[i] = fds[i];
+    }
+
+    return copy;
+}
+
+fs::Inode* FileTable::cwd_inode() const
+{
+    return cwd != nullptr ? cwd->inode : nullptr;
+}
+
+/// @brief make desc the working directory, taking over the reference the
+///        caller holds on it, and close the old one
+///
+void FileTable::set_cwd(fs::FileDescriptor* desc)
+{
+    fs::FileDescriptor* old = cwd;
+
+    cwd = desc;
+
+    if (old != nullptr) {
+        old->put();
+    }
+}
+
+bool FileTable::is_cloexec(int fd) const
+{
+    return cloexec[fd / 64] & (1UL << (fd % 64));
+}
+
+void FileTable::set_cloexec(int fd, bool on)
+{
+    if (on) {
+        cloexec[fd / 64] |= 1UL << (fd % 64);
+    } else {
+        cloexec[fd / 64] &= ~(1UL << (fd % 64));
+    }
+}
+
+/// @brief close every fd marked FD_CLOEXEC, for execve()
+///
+void FileTable::close_on_exec()
+{
+    for (std::size_t i = 0; i < fds.size(); i++) {
+        if (fds[i] != nullptr && is_cloexec(i)) {
+            fds[i]->put();
+            fds[i] = nullptr;
+        }
+    }
+
+    memset(cloexec, 0, sizeof(cloexec));
+}
+
 extern "C" void userspace_entry_trampoline();
 
 extern "C" void forked_entry_trampoline();
@@ -56,32 +276,31 @@ static void kthread_entry_trampoline()
 
 void Process::log() const
 {
-    log::debugf("**** User process ****");
-    log::debugf("* pid = {}", pid);
-    log::debugf("* kernel_stack  @ {}", fmt::hex{kernel_stack});
-    log::debugf("* kernel_rsp    @ {}", fmt::hex{kernel_rsp});
-    log::debugf("* syscall_frame @ {}", fmt::hex{syscall_frame});
-    log::debugf("* context_frame @ {}", fmt::hex{context_frame});
-    log::debugf("* k rsp saved   @ {}", fmt::hex{kernel_rsp_saved});
+    log::debugf<log::Subsystem::PROCESS>("**** User process ****");
+    log::debugf<log::Subsystem::PROCESS>("* pid = {}", pid);
+    log::debugf<log::Subsystem::PROCESS>("* kernel_stack  @ {}", fmt::hex{kernel_stack});
+    log::debugf<log::Subsystem::PROCESS>("* kernel_rsp    @ {}", fmt::hex{kernel_rsp});
+    log::debugf<log::Subsystem::PROCESS>("* syscall_frame @ {}", fmt::hex{syscall_frame});
+    log::debugf<log::Subsystem::PROCESS>("* context_frame @ {}", fmt::hex{context_frame});
+    log::debugf<log::Subsystem::PROCESS>("* k rsp saved   @ {}", fmt::hex{kernel_rsp_saved});
 }
 
 KThread::KThread(void (*func)())
 {
     pid = g_pid++;
+    tgid = pid;
     parent = nullptr;
     state = ProcessState::NEW;
     wait_reason = WaitReason::NONE;
     exit_status = 0;
-    heap_break = 0;
-    pml4 = arch::vmm::get_kernel_pml4();
-    fd_table = {};
-    kernel_stack = new std::uint8_t[KERNEL_STACK_SIZE];
+    mm = kernel_address_space();
+    files = new FileTable{};
+    kernel_stack = alloc_kernel_stack();
     kernel_rsp = reinterpret_cast<std::uintptr_t>(kernel_stack + KERNEL_STACK_SIZE);
     wake_time_ms = 0;
-    mmap_min_addr = DEFAULT_MMAP_MIN_ADDR;
     fs_base = 0;
+    fpu_state = nullptr;
     tidptr = 0;
-    cwd_inode = nullptr;
     entry = reinterpret_cast<std::uintptr_t>(func);
 
     context_frame = reinterpret_cast<arch::context::ContextFrame*>(kernel_rsp - sizeof(arch::context::ContextFrame));
@@ -96,9 +315,32 @@ KThread::KThread(void (*func)())
     kernel_rsp_saved = reinterpret_cast<std::uintptr_t>(context_frame);
 }
 
-void Process::exec_elf64(std::uint8_t* buffer, std::size_t size, char* const argv[], char* const envp[])
+/// @brief set up the initial stack for Linux ABI compatibility
+///
+/// musl libc expects: argc, argv[], NULL, envp[], NULL, auxv[], AT_NULL
+/// argc=0 and argv/envp are empty, the only auxv entry is AT_SYSINFO_EHDR so
+/// libc finds the vDSO. 8 entries = 64 bytes ensures 16-byte alignment
+/// (required by System V ABI). The user stack must be mapped and active.
+///
+/// @return the initial user stack pointer
+///
+static std::uint64_t* push_initial_stack()
+{
+    auto* stack = reinterpret_cast<std::uint64_t*>(USER_STACK_TOP);
+    *(--stack) = 0;                              // padding for 16-byte alignment
+    *(--stack) = 0;                              // AT_NULL value
+    *(--stack) = linux::AT_NULL;                 // AT_NULL type
+    *(--stack) = arch::vdso::image_base();       // AT_SYSINFO_EHDR value
+    *(--stack) = linux::AT_SYSINFO_EHDR;         // AT_SYSINFO_EHDR type
+    *(--stack) = 0;                              // envp terminator (NULL)
+    *(--stack) = 0;                              // argv terminator (NULL)
+    *(--stack) = 0;                              // argc
+
+    return stack;
+}
+
+void Process::exec_elf64(std::uint8_t* buffer, std::size_t size, const kvector<kstring>& argv, const kvector<kstring>& envp)
 {
-    (void)argv;
     (void)envp;
 
     elf::Elf64_File file = elf::parse_file(buffer, size);
@@ -107,41 +349,38 @@ void Process::exec_elf64(std::uint8_t* buffer, std::size_t size, char* const arg
         kpanic("attempted to load an invalid ELF64 file");
     }
 
-    int argc = 0;
-    kvector<kstring> argv_strs{};
-
-    arch::cpu::stac();
+    log::debug<log::Subsystem::PROCESS>("**************** execve args ****************");
 
-    log::debug("**************** execve args ****************");
-
-    while (true) {
-        const char* arg = argv[argc];
-
-        if (arg == nullptr) {
-            break;
-        }
-
-        kstring str = kstring::from_userspace(arg);
-        log::debugf("argv[{}] = {}", argc, str);
-        argv_strs.push_back(str);
-        argc++;
+    for (std::size_t i = 0; i < argv.size(); i++) {
+        log::debugf<log::Subsystem::PROCESS>("argv[{}] = {}", i, argv[i]);
     }
 
-    log::debug("done");
+    log::debug<log::Subsystem::PROCESS>("done");
 
+    arch::cpu::stac();
+
+    // The old address space may still be used by other threads until they
+    // are killed, so execve always starts from a fresh one
     arch::vmm::PML4E* new_pml4 = arch::vmm::create_user_pml4();
+    auto* new_mm = new AddressSpace{new_pml4};
     arch::vmm::switch_pml4(new_pml4);
 
     state = ProcessState::BLOCKED;
     wait_reason = WaitReason::NONE;
     exit_status = 0;
-    heap_break = 0;
     kernel_rsp = reinterpret_cast<std::uintptr_t>(kernel_stack + KERNEL_STACK_SIZE);
     wake_time_ms = 0;
-    mmap_min_addr = DEFAULT_MMAP_MIN_ADDR;
     fs_base = 0;
     tidptr = 0;
-    uheap = arch::vmm::create_user_heap(new_pml4);
+
+    // A new program starts with clean registers, kthreads get their first area here
+    if (fpu_state != nullptr) {
+        arch::fpu::reset_state(fpu_state);
+    } else {
+        fpu_state = arch::fpu::alloc_state();
+    }
+
+    new_mm->uheap = arch::vmm::create_user_heap(new_pml4);
 
     for (const elf::Elf64_ProgramHeader& header : file.program_headers) {
         auto virt = header.p_vaddr;
@@ -149,7 +388,7 @@ void Process::exec_elf64(std::uint8_t* buffer, std::size_t size, char* const arg
         auto mem_size = header.p_memsz;
         auto offset = header.p_offset;
 
-        log::debugf("mapping user mem at {} len = {}", fmt::hex{virt}, mem_size);
+        log::debugf<log::Subsystem::PROCESS>("mapping user mem at {} len = {}", fmt::hex{virt}, mem_size);
 
         arch::vmm::map_user_pages(new_pml4, virt, mem_size);
 
@@ -163,27 +402,18 @@ void Process::exec_elf64(std::uint8_t* buffer, std::size_t size, char* const arg
 
         std::uintptr_t segment_end = virt + mem_size;
 
-        if (segment_end > heap_break) {
-            heap_break = (segment_end + 0xFFF) & ~0xFFF;
+        if (segment_end > new_mm->heap_break) {
+            new_mm->heap_break = (segment_end + 0xFFF) & ~0xFFF;
         }
     }
 
     arch::vmm::map_user_pages(new_pml4, USER_STACK_BASE, USER_STACK_SIZE);
-    arch::vmm::free_user_pml4(pml4);
+    arch::vdso::map_into(new_pml4);
 
-    pml4 = new_pml4;
+    mm->put();
+    mm = new_mm;
 
-    // Set up initial stack for Linux ABI compatibility
-    // musl libc expects: argc, argv[], NULL, envp[], NULL, auxv[], AT_NULL
-    // All zeros: argc=0, argv/envp terminated by NULL, auxv terminated by AT_NULL(0,0)
-    // 6 entries = 48 bytes ensures 16-byte alignment (required by System V ABI)
-    auto* stack = reinterpret_cast<std::uint64_t*>(USER_STACK_TOP);
-    *(--stack) = 0; // padding for 16-byte alignment
-    *(--stack) = 0; // AT_NULL value
-    *(--stack) = 0; // AT_NULL type
-    *(--stack) = 0; // envp terminator (NULL)
-    *(--stack) = 0; // argv terminator (NULL)
-    *(--stack) = 0; // argc
+    std::uint64_t* stack = push_initial_stack();
 
     context_frame = reinterpret_cast<arch::context::ContextFrame*>(kernel_rsp - sizeof(arch::context::ContextFrame));
     context_frame->r15 = file.entry;
@@ -214,20 +444,19 @@ ELF64Process::ELF64Process(std::uint8_t* buffer, std::size_t size)
     arch::cpu::stac();
 
     pid = g_pid++;
+    tgid = pid;
     state = ProcessState::NEW;
     wait_reason = WaitReason::NONE;
     exit_status = 0;
-    heap_break = 0;
-    this->pml4 = pml4;
-    fd_table = {};
-    kernel_stack = new std::uint8_t[KERNEL_STACK_SIZE];
+    mm = new AddressSpace{pml4};
+    files = new FileTable{};
+    kernel_stack = alloc_kernel_stack();
     kernel_rsp = reinterpret_cast<std::uintptr_t>(kernel_stack + KERNEL_STACK_SIZE);
     wake_time_ms = 0;
-    mmap_min_addr = DEFAULT_MMAP_MIN_ADDR;
     fs_base = 0;
+    fpu_state = arch::fpu::alloc_state();
     tidptr = 0;
-    cwd_inode = nullptr;
-    uheap = arch::vmm::create_user_heap(pml4);
+    mm->uheap = arch::vmm::create_user_heap(pml4);
 
     for (const elf::Elf64_ProgramHeader& header : file.program_headers) {
         auto virt = header.p_vaddr;
@@ -235,7 +464,7 @@ ELF64Process::ELF64Process(std::uint8_t* buffer, std::size_t size)
         auto mem_size = header.p_memsz;
         auto offset = header.p_offset;
 
-        log::debugf("mapping user mem at {} len = {}", fmt::hex{virt}, mem_size);
+        log::debugf<log::Subsystem::PROCESS>("mapping user mem at {} len = {}", fmt::hex{virt}, mem_size);
 
         arch::vmm::map_pages(pml4, virt, mem_size, arch::vmm::PAGE_USER | arch::vmm::PAGE_WRITE);
 
@@ -249,24 +478,15 @@ ELF64Process::ELF64Process(std::uint8_t* buffer, std::size_t size)
 
         std::uintptr_t segment_end = virt + mem_size;
 
-        if (segment_end > heap_break) {
-            heap_break = (segment_end + 0xFFF) & ~0xFFF;
+        if (segment_end > mm->heap_break) {
+            mm->heap_break = (segment_end + 0xFFF) & ~0xFFF;
         }
     }
 
     arch::vmm::map_pages(pml4, USER_STACK_BASE, USER_STACK_SIZE, arch::vmm::PAGE_USER | arch::vmm::PAGE_WRITE);
+    arch::vdso::map_into(pml4);
 
-    // Set up initial stack for Linux ABI compatibility
-    // musl libc expects: argc, argv[], NULL, envp[], NULL, auxv[], AT_NULL
-    // All zeros: argc=0, argv/envp terminated by NULL, auxv terminated by AT_NULL(0,0)
-    // 6 entries = 48 bytes ensures 16-byte alignment (required by System V ABI)
-    auto* stack = reinterpret_cast<std::uint64_t*>(USER_STACK_TOP);
-    *(--stack) = 0; // padding for 16-byte alignment
-    *(--stack) = 0; // AT_NULL value
-    *(--stack) = 0; // AT_NULL type
-    *(--stack) = 0; // envp terminator (NULL)
-    *(--stack) = 0; // argv terminator (NULL)
-    *(--stack) = 0; // argc = 0
+    std::uint64_t* stack = push_initial_stack();
 
     context_frame = reinterpret_cast<arch::context::ContextFrame*>(kernel_rsp - sizeof(arch::context::ContextFrame));
     context_frame->r15 = file.entry;
@@ -278,13 +498,7 @@ ELF64Process::ELF64Process(std::uint8_t* buffer, std::size_t size)
     context_frame->rip = reinterpret_cast<std::uintptr_t>(userspace_entry_trampoline);
     kernel_rsp_saved = reinterpret_cast<std::uintptr_t>(context_frame);
 
-    fs::FileDescriptor* stdin = fs::open("/dev/tty1", fs::O_RDONLY);
-    fs::FileDescriptor* stdout = fs::open("/dev/tty1", fs::O_WRONLY);
-    fs::FileDescriptor* stderr = fs::open("/dev/tty1", fs::O_WRONLY);
-
-    fd_table.push_back(stdin);
-    fd_table.push_back(stdout);
-    fd_table.push_back(stderr);
+    open_std_fds(files);
 
     log();
 
@@ -294,51 +508,78 @@ ELF64Process::ELF64Process(std::uint8_t* buffer, std::size_t size)
 
 void Process::log_syscall_frame() const
 {
-    log::debugf("**** SYSCALL FRAME ****");
-    log::debugf("* r15 = {}", fmt::hex{syscall_frame->r15});
-    log::debugf("* r14 = {}", fmt::hex{syscall_frame->r14});
-    log::debugf("* r13 = {}", fmt::hex{syscall_frame->r13});
-    log::debugf("* r12 = {}", fmt::hex{syscall_frame->r12});
-    log::debugf("* r11 = {}", fmt::hex{syscall_frame->r11});
-    log::debugf("* r10 = {}", fmt::hex{syscall_frame->r10});
-    log::debugf("* r9  = {}", fmt::hex{syscall_frame->r9});
-    log::debugf("* r8  = {}", fmt::hex{syscall_frame->r8});
-    log::debugf("* rpb = {}", fmt::hex{syscall_frame->rbp});
-    log::debugf("* rdi = {}", fmt::hex{syscall_frame->rdi});
-    log::debugf("* rsi = {}", fmt::hex{syscall_frame->rsi});
-    log::debugf("* rdx = {}", fmt::hex{syscall_frame->rdx});
-    log::debugf("* rcx = {}", fmt::hex{syscall_frame->rcx});
-    log::debugf("* rbx = {}", fmt::hex{syscall_frame->rbx});
-    log::debugf("* rax = {}", fmt::hex{syscall_frame->rax});
-    log::debugf("* rsp = {}", fmt::hex{syscall_frame->rsp});
-    log::debugf("***********************");
+    log::debugf<log::Subsystem::PROCESS>("**** SYSCALL FRAME ****");
+    log::debugf<log::Subsystem::PROCESS>("* r15 = {}", fmt::hex{syscall_frame->r15});
+    log::debugf<log::Subsystem::PROCESS>("* r14 = {}", fmt::hex{syscall_frame->r14});
+    log::debugf<log::Subsystem::PROCESS>("* r13 = {}", fmt::hex{syscall_frame->r13});
+    log::debugf<log::Subsystem::PROCESS>("* r12 = {}", fmt::hex{syscall_frame->r12});
+    log::debugf<log::Subsystem::PROCESS>("* r11 = {}", fmt::hex{syscall_frame->r11});
+    log::debugf<log::Subsystem::PROCESS>("* r10 = {}", fmt::hex{syscall_frame->r10});
+    log::debugf<log::Subsystem::PROCESS>("* r9  = {}", fmt::hex{syscall_frame->r9});
+    log::debugf<log::Subsystem::PROCESS>("* r8  = {}", fmt::hex{syscall_frame->r8});
+    log::debugf<log::Subsystem::PROCESS>("* rpb = {}", fmt::hex{syscall_frame->rbp});
+    log::debugf<log::Subsystem::PROCESS>("* rdi = {}", fmt::hex{syscall_frame->rdi});
+    log::debugf<log::Subsystem::PROCESS>("* rsi = {}", fmt::hex{syscall_frame->rsi});
+    log::debugf<log::Subsystem::PROCESS>("* rdx = {}", fmt::hex{syscall_frame->rdx});
+    log::debugf<log::Subsystem::PROCESS>("* rcx = {}", fmt::hex{syscall_frame->rcx});
+    log::debugf<log::Subsystem::PROCESS>("* rbx = {}", fmt::hex{syscall_frame->rbx});
+    log::debugf<log::Subsystem::PROCESS>("* rax = {}", fmt::hex{syscall_frame->rax});
+    log::debugf<log::Subsystem::PROCESS>("* rsp = {}", fmt::hex{syscall_frame->rsp});
+    log::debugf<log::Subsystem::PROCESS>("***********************");
 }
 
 Process* Process::fork(arch::trap::SyscallFrame* parent_frame)
+{
+    return clone(parent_frame, 0, 0, 0);
+}
+
+/// @brief create a new task, either a new process or a thread of this one
+///
+/// @param parent_frame the syscall frame the child returns to userspace with
+/// @param flags CLONE_* flags selecting what the child shares with this process
+/// @param stack user stack pointer for the child, 0 to keep the parent's
+/// @param tls fs_base for the child when CLONE_SETTLS is set
+///
+/// @return the new task, not yet added to the scheduler
+///
+Process* Process::clone(arch::trap::SyscallFrame* parent_frame, std::uint64_t flags, std::uintptr_t stack, std::uintptr_t tls)
 {
     kassert_not_null(parent_frame);
 
-    arch::vmm::PML4E* cloned_pml4 = arch::vmm::clone_user_pml4(pml4);
-    arch::vmm::switch_pml4(cloned_pml4);
+    AddressSpace* child_mm = mm;
+
+    if (flags & CLONE_VM) {
+        mm->get();
+    } else {
+        child_mm = mm->clone();
+    }
+
+    arch::vmm::switch_pml4(child_mm->pml4);
     arch::cpu::stac();
 
     auto* forked = new Process{};
 
     forked->pid = g_pid++;
+    forked->tgid = (flags & CLONE_THREAD) ? tgid : forked->pid;
     forked->parent = this;
     forked->state = process::ProcessState::NEW;
     forked->wait_reason = wait_reason;
     forked->exit_status = exit_status;
-    forked->heap_break = heap_break;
-    forked->pml4 = cloned_pml4;
-    forked->kernel_stack = new std::uint8_t[KERNEL_STACK_SIZE];
+    forked->mm = child_mm;
+    forked->kernel_stack = alloc_kernel_stack();
     forked->kernel_rsp = reinterpret_cast<std::uintptr_t>(forked->kernel_stack + KERNEL_STACK_SIZE);
     forked->wake_time_ms = wake_time_ms;
-    forked->mmap_min_addr = DEFAULT_MMAP_MIN_ADDR;
-    forked->fs_base = fs_base;
-    forked->tidptr = tidptr;
-    forked->cwd_inode = cwd_inode;
-    forked->uheap = arch::vmm::clone_user_heap(&uheap, cloned_pml4);
+    forked->nice = nice;
+    forked->vruntime = vruntime;
+    forked->policy = policy;
+    forked->rt_priority = rt_priority;
+    forked->fs_base = (flags & CLONE_SETTLS) ? tls : fs_base;
+    forked->fpu_state = arch::fpu::alloc_state();
+
+    if (fpu_state != nullptr) {
+        arch::fpu::copy_state(forked->fpu_state, fpu_state);
+    }
+    forked->tidptr = nullptr;
 
     forked->syscall_frame = reinterpret_cast<arch::trap::SyscallFrame*>(forked->kernel_rsp - sizeof(arch::trap::SyscallFrame));
 
@@ -358,7 +599,7 @@ Process* Process::fork(arch::trap::SyscallFrame* parent_frame)
     forked->syscall_frame->rcx = parent_frame->rcx;
     forked->syscall_frame->rbx = parent_frame->rbx;
     forked->syscall_frame->rax = parent_frame->rax;
-    forked->syscall_frame->rsp = parent_frame->rsp;
+    forked->syscall_frame->rsp = stack != 0 ? stack : parent_frame->rsp;
 
     forked->context_frame = reinterpret_cast<arch::context::ContextFrame*>(
         forked->kernel_rsp - sizeof(arch::trap::SyscallFrame) - sizeof(arch::context::ContextFrame));
@@ -371,17 +612,18 @@ Process* Process::fork(arch::trap::SyscallFrame* parent_frame)
     forked->context_frame->rip = reinterpret_cast<std::uintptr_t>(forked_entry_trampoline);
     forked->kernel_rsp_saved = reinterpret_cast<std::uintptr_t>(forked->context_frame);
 
-    fs::FileDescriptor* stdin = fs::open("/dev/tty1", fs::O_RDONLY);
-    fs::FileDescriptor* stdout = fs::open("/dev/tty1", fs::O_WRONLY);
-    fs::FileDescriptor* stderr = fs::open("/dev/tty1", fs::O_WRONLY);
-
-    forked->fd_table.push_back(stdin);
-    forked->fd_table.push_back(stdout);
-    forked->fd_table.push_back(stderr);
+    // The working directory is shared along with the open files, which is
+    // how threads are created (CLONE_FS and CLONE_FILES are always paired)
+    if (flags & CLONE_FILES) {
+        files->get();
+        forked->files = files;
+    } else {
+        forked->files = files->clone();
+    }
 
     forked->log();
 
-    arch::vmm::switch_pml4(pml4);
+    arch::vmm::switch_pml4(mm->pml4);
     arch::cpu::clac();
 
     return forked;
@@ -409,7 +651,7 @@ const char* Process::get_state_str() const
 
 kstring Process::to_string() const
 {
-    kstring cwd = fs::getcwd(cwd_inode);
+    kstring cwd = fs::getcwd(files->cwd_inode());
     kstring format = "pid = {}\n"
                      "cwd = {}\n"
                      "state = {}\n"
@@ -424,7 +666,7 @@ kstring Process::to_string() const
         pid,
         cwd,
         get_state_str(),
-        fmt::hex{pml4},
+        fmt::hex{mm->pml4},
         fmt::hex{kernel_stack},
         fmt::hex{kernel_rsp},
         fmt::hex{entry},
@@ -456,6 +698,18 @@ bool Process::is_blocked() const
     return state == ProcessState::BLOCKED;
 }
 
+bool Process::is_realtime() const
+{
+    return policy != SchedPolicy::NORMAL;
+}
+
+/// @brief is this task a thread created with CLONE_THREAD (not the group leader)?
+///
+bool Process::is_thread() const
+{
+    return pid != tgid;
+}
+
 bool Process::is_waiting_for(WaitReason reason) const
 {
     return wait_reason == reason;
@@ -512,35 +766,37 @@ void Process::wait_for_child(int child_pid)
     wait_pid = child_pid;
 }
 
-void Process::sleep_until(std::uint64_t wake_time_ms)
-{
-    wait_for(WaitReason::SLEEP);
-    this->wake_time_ms = wake_time_ms;
-}
-
 void Process::terminate()
 {
-    log::info("========================================");
-    log::info("Terminating process ", pid);
-    log::info("========================================");
+    log::info<log::Subsystem::PROCESS>("========================================");
+    log::info<log::Subsystem::PROCESS>("Terminating process ", pid);
+    log::info<log::Subsystem::PROCESS>("========================================");
 
     const auto frames_before = pmm::get_free_frames();
     const auto slabs_before = slab::total_slabs();
 
-    for (fs::FileDescriptor* fd : fd_table) {
-        fd->inode->close(fd);
+    // A thread killed inside futex wait() is still queued in a futex bucket
+    futex::cancel(this);
+    WaitQueue::cancel(this);
+
+    if (poll_table) {
+        poll_table->clear();
     }
 
-    arch::vmm::free_user_pml4(pml4);
-    delete[] kernel_stack;
+    // Threads of the same process keep these alive until the last one exits
+    files->put();
+    mm->put();
+
+    arch::fpu::free_state(fpu_state);
+    g_kernel_stack_cache.free(kernel_stack);
 
     const auto frames_after = pmm::get_free_frames();
     const auto slabs_after = slab::total_slabs();
     const auto frames_diff = frames_after - frames_before;
 
-    log::infof("PMM frames: {} -> {} (+{})", frames_before, frames_after, frames_diff);
-    log::infof("Slabs: {} -> {}", slabs_before, slabs_after);
-    log::infof("========================================");
+    log::infof<log::Subsystem::PROCESS>("PMM frames: {} -> {} (+{})", frames_before, frames_after, frames_diff);
+    log::infof<log::Subsystem::PROCESS>("Slabs: {} -> {}", slabs_before, slabs_after);
+    log::infof<log::Subsystem::PROCESS>("========================================");
 }
 
 Process::~Process()
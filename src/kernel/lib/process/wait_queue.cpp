@@ -0,0 +1,206 @@
+#include <arch.hpp>
+#include <process/process.hpp>
+#include <process/wait_queue.hpp>
+#include <scheduler/scheduler.hpp>
+
+namespace process {
+
+void WaitQueue::link(WaitEntry* entry)
+{
+    entry->queue = this;
+    entry->prev = _tail;
+    entry->next = nullptr;
+
+    if (_tail) {
+        _tail->next = entry;
+    } else {
+        _head = entry;
+    }
+
+    _tail = entry;
+}
+
+void WaitQueue::unlink(WaitEntry* entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        _head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        _tail = entry->prev;
+    }
+
+    entry->queue = nullptr;
+    entry->prev = nullptr;
+    entry->next = nullptr;
+}
+
+void WaitQueue::add(WaitEntry* entry)
+{
+    _lock.lock();
+    link(entry);
+    _lock.unlock();
+}
+
+/// @brief take entry off whichever queue it is on, if any
+///
+void WaitQueue::remove(WaitEntry* entry)
+{
+    WaitQueue* queue = entry->queue;
+
+    if (queue == nullptr) {
+        return;
+    }
+
+    queue->_lock.lock();
+
+    // A waker may have unlinked it before we got the lock
+    if (entry->queue == queue) {
+        queue->unlink(entry);
+    }
+
+    queue->_lock.unlock();
+}
+
+/// @brief queue the current task, call with the condition's lock held
+///
+void WaitQueue::prepare()
+{
+    Process* current = arch::percpu::current_process();
+
+    current->wait_entry.process = current;
+    current->wake_pending = false;
+
+    add(&current->wait_entry);
+}
+
+/// @brief block until woken, after prepare() and dropping the condition lock
+///
+void WaitQueue::sleep()
+{
+    scheduler::get_scheduler()->yield_blocked(WaitReason::WAIT_QUEUE);
+    finish();
+}
+
+/// @brief like sleep(), but wake up after timeout_ms at the latest
+///
+void WaitQueue::sleep_timeout(std::uint64_t timeout_ms)
+{
+    scheduler::get_scheduler()->yield_blocked_timeout(WaitReason::WAIT_QUEUE, timeout_ms);
+    finish();
+}
+
+/// @brief like sleep(), but also woken when the thread group is killed
+///
+/// @return 0, or -EINTR if the task was killed
+///
+int WaitQueue::sleep_killable()
+{
+    const int err = scheduler::get_scheduler()->yield_killable(WaitReason::WAIT_QUEUE);
+    finish();
+
+    return err;
+}
+
+/// @brief like sleep_timeout(), but also woken when the thread group is killed
+///
+/// @return 0, or -EINTR if the task was killed
+///
+int WaitQueue::sleep_killable_timeout(std::uint64_t timeout_ms)
+{
+    const int err = scheduler::get_scheduler()->yield_killable_timeout(WaitReason::WAIT_QUEUE, timeout_ms);
+    finish();
+
+    return err;
+}
+
+/// @brief leave the queue after prepare(), without sleeping if not done yet
+///
+void WaitQueue::finish()
+{
+    Process* current = arch::percpu::current_process();
+
+    // Still queued if something other than this queue woke us
+    remove(&current->wait_entry);
+
+    current->wake_pending = false;
+}
+
+/// @brief run one entry's wakeup, with the queue locked
+///
+/// @return true if a task was woken
+///
+static bool wake_entry(WaitEntry* entry)
+{
+    if (entry->func) {
+        entry->func(entry);
+        return false;
+    }
+
+    Process* p = entry->process;
+
+    // A killed task is only waiting to be reaped, it can not take the wakeup
+    if (p->is_dead() || p->is_zombie()) {
+        return false;
+    }
+
+    scheduler::get_scheduler()->wake_process(p, WaitReason::WAIT_QUEUE);
+
+    return true;
+}
+
+/// @brief wake the first sleeping task, entries with a func all see it
+///
+void WaitQueue::wake_one()
+{
+    _lock.lock();
+
+    WaitEntry* entry = _head;
+    bool woken = false;
+
+    while (entry) {
+        WaitEntry* next = entry->next;
+
+        if (entry->func) {
+            wake_entry(entry);
+        } else if (!woken) {
+            unlink(entry);
+            woken = wake_entry(entry);
+        }
+
+        entry = next;
+    }
+
+    _lock.unlock();
+}
+
+void WaitQueue::wake_all()
+{
+    _lock.lock();
+
+    WaitEntry* entry = _head;
+
+    while (entry) {
+        WaitEntry* next = entry->next;
+
+        if (entry->func == nullptr) {
+            unlink(entry);
+        }
+
+        wake_entry(entry);
+        entry = next;
+    }
+
+    _lock.unlock();
+}
+
+void WaitQueue::cancel(Process* p)
+{
+    remove(&p->wait_entry);
+}
+
+}
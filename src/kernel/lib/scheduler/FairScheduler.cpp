@@ -0,0 +1,293 @@
+#include <arch.hpp>
+#include <kassert/kassert.hpp>
+#include <log/log.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cstdint>
+
+namespace scheduler {
+
+// A completely fair scheduler in the spirit of Linux CFS.
+//
+// Every process accumulates "virtual runtime": the real time it spent on the
+// CPU scaled by NICE_0_WEIGHT / weight. Heavier (lower nice) processes age
+// slower, so they get proportionally more CPU before they stop being the
+// process with the smallest vruntime. READY processes live in a red-black tree
+// ordered by vruntime and the leftmost one always runs next.
+//
+// The running process is not in the tree. It is preempted when it has used up
+// its share of the scheduling period, or when a waking process is far enough
+// behind it in vruntime (wakeup preemption, bounded by the granularities below).
+
+constexpr std::uint64_t NSEC_PER_MSEC = 1'000'000;
+
+// Once more than latency / min_granularity processes are runnable, the period
+// stretches so that nobody gets a slice shorter than the minimum granularity.
+//
+// Processes waking from sleep are placed at most half a period behind
+// min_vruntime, so interactive processes run promptly without banking
+// unbounded credit.
+static tunable::Tunable<std::uint64_t> g_latency_ns{
+    "sched.latency_ns", 6 * NSEC_PER_MSEC, 100'000, 1'000 * NSEC_PER_MSEC, "fair scheduler period"};
+static tunable::Tunable<std::uint64_t> g_min_granularity_ns{
+    "sched.min_granularity_ns", 750'000, 100'000, 1'000 * NSEC_PER_MSEC, "shortest fair time slice"};
+static tunable::Tunable<std::uint64_t> g_wakeup_granularity_ns{
+    "sched.wakeup_granularity_ns", 1 * NSEC_PER_MSEC, 0, 1'000 * NSEC_PER_MSEC, "vruntime lead needed to preempt on wakeup"};
+
+constexpr int NICE_MIN = -20;
+constexpr int NICE_MAX = 19;
+constexpr std::uint32_t NICE_0_WEIGHT = 1024;
+
+// Same table as Linux: each nice level is ~10% more/less CPU than its neighbour
+constexpr std::uint32_t NICE_TO_WEIGHT[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+};
+
+/// @brief convert a nice value into a scheduling weight
+///
+/// @param nice the nice value, clamped to [-20, 19]
+///
+/// @return the weight, 1024 for nice 0
+///
+std::uint32_t nice_to_weight(int nice)
+{
+    if (nice < NICE_MIN) {
+        nice = NICE_MIN;
+    } else if (nice > NICE_MAX) {
+        nice = NICE_MAX;
+    }
+
+    return NICE_TO_WEIGHT[nice - NICE_MIN];
+}
+
+static std::uint64_t now_ns()
+{
+    return arch::drivers::tsc::get_time_ns();
+}
+
+static std::uint64_t max_vruntime(std::uint64_t a, std::uint64_t b)
+{
+    return static_cast<std::int64_t>(a - b) > 0 ? a : b;
+}
+
+static std::uint64_t min_vruntime(std::uint64_t a, std::uint64_t b)
+{
+    return static_cast<std::int64_t>(a - b) < 0 ? a : b;
+}
+
+FairScheduler::FairScheduler()
+    : _min_vruntime{0}
+    , _queued_weight{0}
+{
+}
+
+/// @brief charge the running process for the CPU time it used since exec_start_ns
+///
+void FairScheduler::update_current(process::Process* current, std::uint64_t now)
+{
+    if (current == arch::percpu::idle_process() || current->is_realtime()) {
+        return;
+    }
+
+    const std::uint64_t delta = now - current->exec_start_ns;
+
+    current->exec_start_ns = now;
+    current->sum_exec_runtime_ns += delta;
+    current->vruntime += delta * NICE_0_WEIGHT / nice_to_weight(current->nice);
+}
+
+/// @brief advance min_vruntime, which never moves backwards
+///
+/// min_vruntime tracks the smallest vruntime among the running and queued
+/// processes and is used to place new and waking processes in the tree
+///
+void FairScheduler::update_min_vruntime(process::Process* current)
+{
+    const bool current_queued = current != arch::percpu::idle_process()
+        && current->is_running()
+        && !current->is_realtime();
+    process::Process* leftmost = _runqueue.first();
+
+    std::uint64_t vruntime = _min_vruntime;
+
+    if (current_queued && leftmost != nullptr) {
+        vruntime = min_vruntime(current->vruntime, leftmost->vruntime);
+    } else if (current_queued) {
+        vruntime = current->vruntime;
+    } else if (leftmost != nullptr) {
+        vruntime = leftmost->vruntime;
+    }
+
+    _min_vruntime = max_vruntime(_min_vruntime, vruntime);
+}
+
+/// @brief the wall-clock time p may run before it should yield to others
+///
+/// Every runnable process runs once per scheduling period, each for a share
+/// of the period proportional to its weight
+///
+std::uint64_t FairScheduler::ideal_slice(const process::Process* p) const
+{
+    const std::uint64_t nr_running = _runqueue.size() + 1;
+    const std::uint64_t weight = nice_to_weight(p->nice);
+
+    const std::uint64_t latency_ns = g_latency_ns.value();
+    const std::uint64_t min_granularity_ns = g_min_granularity_ns.value();
+
+    std::uint64_t period = latency_ns;
+
+    if (nr_running > latency_ns / min_granularity_ns) {
+        period = nr_running * min_granularity_ns;
+    }
+
+    const std::uint64_t slice = period * weight / (_queued_weight + weight);
+
+    return slice < min_granularity_ns ? min_granularity_ns : slice;
+}
+
+/// @brief decide whether the running process should give up the CPU
+///
+bool FairScheduler::should_preempt(const process::Process* current) const
+{
+    const process::Process* leftmost = _runqueue.first();
+
+    if (leftmost == nullptr) {
+        return false;
+    }
+
+    const std::uint64_t ran = current->sum_exec_runtime_ns - current->slice_start_ns;
+
+    if (ran >= ideal_slice(current)) {
+        return true;
+    }
+
+    // Always let a process run for a minimum amount of time, otherwise a
+    // stream of wakeups could make it thrash without getting work done
+    if (ran < g_min_granularity_ns.value()) {
+        return false;
+    }
+
+    const auto lag = static_cast<std::int64_t>(current->vruntime - leftmost->vruntime);
+
+    return lag > static_cast<std::int64_t>(g_wakeup_granularity_ns.value());
+}
+
+/// @brief finds the next process to run
+///
+/// 1. charges the current process for the time it has been running
+/// 2. keeps the current process if it is still within its slice
+/// 3. otherwise picks the READY process with the smallest vruntime
+/// 4. defaults to the idle process if nothing is READY
+///
+/// @return pointer to the next process to run
+///
+process::Process* FairScheduler::next_ready_process()
+{
+    process::Process* current = arch::percpu::current_process();
+    process::Process* idle = arch::percpu::idle_process();
+    const std::uint64_t now = now_ns();
+
+    // a running real-time process only gets here when it is being throttled,
+    // so it is treated like any other process that is giving up the CPU
+    const bool current_runnable = current != idle && current->is_running() && !current->is_realtime();
+
+    update_current(current, now);
+    update_min_vruntime(current);
+
+    if (current_runnable && !should_preempt(current)) {
+        return current;
+    }
+
+    process::Process* next = _runqueue.pop_first();
+
+    if (next == nullptr) {
+        // Nothing else wants the CPU, a running process just keeps it
+        return current_runnable ? current : idle;
+    }
+
+    _queued_weight -= nice_to_weight(next->nice);
+
+    next->exec_start_ns = now;
+    next->slice_start_ns = next->sum_exec_runtime_ns;
+
+    return next;
+}
+
+/// @brief queue a READY process in the vruntime tree
+///
+/// @param p the process
+/// @param wakeup true if p was blocked or sleeping, which earns sleeper credit
+///
+void FairScheduler::enqueue_ready(process::Process* p, bool wakeup)
+{
+    kassert_not_null(p);
+
+    // Processes can be added before the idle process exists, so compare
+    // against the raw per-CPU field instead of idle_process()
+    if (p == arch::percpu::get()->idle_process || _runqueue.contains(p)) {
+        return;
+    }
+
+    // The running process is being requeued because it was preempted,
+    // charge it for the time since the last update first
+    if (p == arch::percpu::get()->process) {
+        update_current(p, now_ns());
+    }
+
+    if (wakeup) {
+        const std::uint64_t credit = _min_vruntime - g_latency_ns.value() / 2;
+
+        p->vruntime = max_vruntime(p->vruntime, credit);
+    }
+
+    _runqueue.insert(p);
+    _queued_weight += nice_to_weight(p->nice);
+}
+
+/// @brief remove a READY process from the vruntime tree
+///
+/// @param p the process
+///
+void FairScheduler::dequeue(process::Process* p)
+{
+    kassert_not_null(p);
+
+    if (!_runqueue.contains(p)) {
+        return;
+    }
+
+    _runqueue.erase(p);
+    _queued_weight -= nice_to_weight(p->nice);
+}
+
+/// @brief add a new process to the scheduler
+///
+/// New processes start at min_vruntime (or their parent's vruntime, if that
+/// is larger) so that forking can not be used to get extra CPU time
+///
+/// @param p the process
+///
+void FairScheduler::add_process(process::Process* p)
+{
+    kassert_not_null(p);
+
+    _processes_lock.lock();
+
+    p->vruntime = max_vruntime(p->vruntime, _min_vruntime);
+
+    _processes.push_back(p);
+    enqueue(p, false);
+
+    _processes_lock.unlock();
+}
+
+}
@@ -0,0 +1,74 @@
+#include <kassert/kassert.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+
+namespace scheduler {
+
+RealtimeRunQueue::RealtimeRunQueue()
+    : _bitmap{0, 0}
+    , _size{0}
+{
+}
+
+/// @brief queue a READY real-time process at its priority level
+///
+/// @param p the process
+/// @param at_head true to run p before others of the same priority (used when
+///                a FIFO process is preempted, so it resumes where it left off)
+///
+void RealtimeRunQueue::enqueue(process::Process* p, bool at_head)
+{
+    kassert_not_null(p);
+    kassert(p->rt_priority >= RT_PRIORITY_MIN && p->rt_priority <= RT_PRIORITY_MAX);
+
+    const int prio = p->rt_priority;
+
+    if (at_head) {
+        _queues[prio].push_front(p);
+    } else {
+        _queues[prio].push_back(p);
+    }
+
+    _bitmap[prio / 64] |= 1UL << (prio % 64);
+    _size++;
+}
+
+/// @brief remove a process from the queue of its current priority
+///
+/// @return false if p was not queued
+///
+bool RealtimeRunQueue::dequeue(process::Process* p)
+{
+    kassert_not_null(p);
+
+    const int prio = p->rt_priority;
+
+    if (prio < RT_PRIORITY_MIN || prio > RT_PRIORITY_MAX || !_queues[prio].remove(p)) {
+        return false;
+    }
+
+    if (_queues[prio].empty()) {
+        _bitmap[prio / 64] &= ~(1UL << (prio % 64));
+    }
+
+    _size--;
+
+    return true;
+}
+
+/// @brief the first process of the highest non-empty priority level
+///
+process::Process* RealtimeRunQueue::first() const
+{
+    for (int word = 1; word >= 0; word--) {
+        if (_bitmap[word] != 0) {
+            const int prio = word * 64 + (63 - __builtin_clzll(_bitmap[word]));
+
+            return _queues[prio].front();
+        }
+    }
+
+    return nullptr;
+}
+
+}
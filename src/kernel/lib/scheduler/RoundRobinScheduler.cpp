@@ -11,23 +11,21 @@ namespace scheduler {
 
 /// @brief finds the next ready process to schedule
 ///
-/// 1. wakes all sleeping processes
-/// 2. attempts to find a process that is READY or NEW
-/// 3. if found, rotates the queue of processes
-/// 4. defaults to the idle process if no process found
+/// 1. attempts to find a normal (not real-time) process that is READY or NEW
+/// 2. if found, rotates the queue of processes
+/// 3. defaults to the idle process if no process found
 ///
 /// @return pointer to the next ready process
 ///
 process::Process* RoundRobinScheduler::next_ready_process()
 {
-    wake_sleepers();
-
     for (std::size_t i = 0; i < _processes.size(); i++) {
         process::Process* p = _processes[i];
 
         kassert_not_null(p);
 
-        if (p->is_ready()) {
+        // real-time processes are queued and picked by Scheduler::pick_next()
+        if (p->is_ready() && !p->is_realtime()) {
             _processes.rotate_next();
             return p;
         }
@@ -36,31 +34,16 @@ process::Process* RoundRobinScheduler::next_ready_process()
     return arch::percpu::idle_process();
 };
 
-process::Process* RoundRobinScheduler::find_child(process::Process* parent, int pid)
+/// @brief nothing to do, next_ready_process() scans every process for READY ones
+///
+void RoundRobinScheduler::enqueue_ready(process::Process*, bool)
 {
-    process::Process* first_match = nullptr;
-
-    for (std::size_t i = 0; i < _processes.size(); i++) {
-        process::Process* p = _processes[i];
-
-        if (pid != -1 && p->pid != pid) {
-            continue;
-        }
-
-        if (p->parent == nullptr || p->parent->pid != parent->pid) {
-            continue;
-        }
-
-        if (p->is_zombie()) {
-            return p;
-        }
-
-        if (first_match == nullptr) {
-            first_match = p;
-        }
-    }
+}
 
-    return first_match;
+/// @brief nothing to do, READY processes are never held in a separate queue
+///
+void RoundRobinScheduler::dequeue(process::Process*)
+{
 }
 
 }
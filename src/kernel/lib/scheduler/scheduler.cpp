@@ -1,10 +1,12 @@
 #include <arch.hpp>
+#include <boot/boot.hpp>
 #include <kassert/kassert.hpp>
 #include <kpanic/kpanic.hpp>
 #include <log/log.hpp>
 #include <process/process.hpp>
 #include <scheduler/scheduler.hpp>
 #include <timer/timer.hpp>
+#include <tunable/tunable.hpp>
 
 #include <cerrno>
 #include <cstdint>
@@ -29,6 +31,531 @@ Scheduler* get_scheduler()
 ///
 extern "C" void context_switch(std::uint64_t* old_rsp_ptr, std::uint64_t new_rsp);
 
+constexpr std::uint64_t NSEC_PER_MSEC = 1'000'000;
+
+// Real-time processes run round robin within a priority for this long
+static tunable::Tunable<std::uint32_t> g_rr_timeslice_ms{
+    "sched.rr_timeslice_ms", 100, 1, 10'000, "SCHED_RR time slice"};
+
+// Real-time processes may use at most rt_runtime_ms of every rt_period_ms, the
+// rest is left for normal processes (the reaper, the shell, ...) so a runaway
+// SCHED_FIFO loop can not lock up the system. A runtime equal to the period
+// turns throttling off
+static tunable::Tunable<std::uint32_t> g_rt_period_ms{
+    "sched.rt_period_ms", 1000, 10, 60'000, "real-time throttling period"};
+static tunable::Tunable<std::uint32_t> g_rt_runtime_ms{
+    "sched.rt_runtime_ms", 950, 0, 60'000, "real-time runtime allowed per period"};
+
+static std::uint64_t rr_timeslice_ns()
+{
+    return g_rr_timeslice_ms.value() * NSEC_PER_MSEC;
+}
+
+Scheduler::Scheduler()
+    : _reaper{nullptr}
+    , _rt_period_start_ns{0}
+    , _rt_period_runtime_ns{0}
+    , _rt_throttled{false}
+{
+}
+
+/// @brief mark a blocked process READY and hand it to the scheduling policy
+///
+/// @param p the process to wake
+///
+void Scheduler::make_ready(process::Process* p)
+{
+    p->wake();
+    enqueue(p, true);
+}
+
+/// @brief queue a READY process in the real-time queue or the normal policy
+///
+/// A real-time process that wakes up while a normal (or lower priority)
+/// process is running requests an immediate reschedule instead of waiting
+/// for the next timer tick.
+///
+/// @param p the process
+/// @param wakeup true if p was blocked, false if it was preempted or is new
+///
+void Scheduler::enqueue(process::Process* p, bool wakeup)
+{
+    if (!p->is_realtime()) {
+        enqueue_ready(p, wakeup);
+        return;
+    }
+
+    // A preempted FIFO process (or RR process with slice left) goes back to
+    // the head of its queue, everything else waits its turn at the tail
+    const bool keeps_turn = !wakeup
+        && (p->policy == process::SchedPolicy::FIFO || p->rt_slice_left_ns > 0);
+
+    if (p->rt_slice_left_ns == 0) {
+        p->rt_slice_left_ns = rr_timeslice_ns();
+    }
+
+    _rt_queue.enqueue(p, keeps_turn);
+
+    auto* cpu = arch::percpu::get();
+    process::Process* current = cpu->process;
+
+    if (wakeup && current != nullptr
+        && (!current->is_realtime() || current->rt_priority < p->rt_priority)) {
+        cpu->need_resched = true;
+    }
+}
+
+/// @brief remove a READY process from whichever queue holds it
+///
+void Scheduler::remove_from_queue(process::Process* p)
+{
+    if (!_rt_queue.dequeue(p)) {
+        dequeue(p);
+    }
+}
+
+/// @brief charge the running real-time process for its CPU time
+///
+void Scheduler::account_realtime(process::Process* current, std::uint64_t now)
+{
+    const std::uint64_t delta = now - current->exec_start_ns;
+
+    current->exec_start_ns = now;
+    current->sum_exec_runtime_ns += delta;
+
+    _rt_period_runtime_ns += delta;
+
+    if (current->policy == process::SchedPolicy::RR) {
+        current->rt_slice_left_ns = delta >= current->rt_slice_left_ns ? 0 : current->rt_slice_left_ns - delta;
+    }
+}
+
+/// @brief check (and update) whether real-time processes are throttled
+///
+bool Scheduler::realtime_throttled(std::uint64_t now)
+{
+    const std::uint64_t period_ns = g_rt_period_ms.value() * NSEC_PER_MSEC;
+    const std::uint64_t runtime_ns = g_rt_runtime_ms.value() * NSEC_PER_MSEC;
+
+    if (now - _rt_period_start_ns >= period_ns) {
+        _rt_period_start_ns = now;
+        _rt_period_runtime_ns = 0;
+        _rt_throttled = false;
+    }
+
+    if (!_rt_throttled && runtime_ns < period_ns && _rt_period_runtime_ns >= runtime_ns) {
+        log::warn<log::Subsystem::SCHED>("scheduler: real-time runtime exceeded, throttling real-time processes");
+        _rt_throttled = true;
+    }
+
+    return _rt_throttled;
+}
+
+/// @brief should the running real-time process give up the CPU to `waiting`?
+///
+/// @param current the running real-time process
+/// @param waiting the first queued real-time process, may be null
+///
+bool Scheduler::realtime_should_yield(process::Process* current, process::Process* waiting) const
+{
+    if (waiting == nullptr) {
+        return false;
+    }
+
+    if (waiting->rt_priority != current->rt_priority) {
+        return waiting->rt_priority > current->rt_priority;
+    }
+
+    // Equal priority: FIFO runs until it blocks, RR takes turns per slice
+    return current->policy == process::SchedPolicy::RR && current->rt_slice_left_ns == 0;
+}
+
+/// @brief choose the process to run next
+///
+/// Real-time processes always win over the normal scheduling policy: the
+/// highest priority queued one runs unless the current real-time process
+/// outranks it. Only when no real-time process can run (or they are
+/// throttled) is the policy's next_ready_process() consulted.
+///
+/// @note the caller must hold _processes_lock
+///
+/// @return the next process to run, possibly the current one or the idle process
+///
+process::Process* Scheduler::pick_next()
+{
+    process::Process* current = arch::percpu::current_process();
+    process::Process* idle = arch::percpu::idle_process();
+    const std::uint64_t now = arch::drivers::tsc::get_time_ns();
+    const bool current_rt_running = current->is_realtime() && current->is_running();
+
+    wake_sleepers();
+
+    if (current->is_realtime() && current != idle) {
+        account_realtime(current, now);
+    }
+
+    const bool throttled = realtime_throttled(now);
+    process::Process* waiting = _rt_queue.first();
+
+    if (!throttled) {
+        if (current_rt_running && !realtime_should_yield(current, waiting)) {
+            if (current->rt_slice_left_ns == 0) {
+                current->rt_slice_left_ns = rr_timeslice_ns();
+            }
+
+            return current;
+        }
+
+        if (waiting != nullptr) {
+            _rt_queue.dequeue(waiting);
+            waiting->exec_start_ns = now;
+            return waiting;
+        }
+    }
+
+    process::Process* next = next_ready_process();
+
+    // Throttling only exists to let normal processes run, if there are none
+    // the real-time processes may as well keep going
+    if (throttled && next == idle) {
+        if (current_rt_running) {
+            return current;
+        }
+
+        if (waiting != nullptr) {
+            _rt_queue.dequeue(waiting);
+            waiting->exec_start_ns = now;
+            return waiting;
+        }
+    }
+
+    return next;
+}
+
+/// @brief find any process known to the scheduler by its pid
+///
+/// @note the caller must hold _processes_lock
+///
+/// @param pid the pid to look for
+///
+/// @return the process, or nullptr if no process has that pid
+///
+process::Process* Scheduler::find_process(int pid)
+{
+    for (std::size_t i = 0; i < _processes.size(); i++) {
+        process::Process* p = _processes[i];
+
+        if (p->pid == pid) {
+            return p;
+        }
+    }
+
+    return nullptr;
+}
+
+/// @brief read the nice value of a process
+///
+/// @param pid the process pid
+/// @param nice where to store the nice value
+///
+/// @return false if no process has that pid
+///
+bool Scheduler::get_nice(int pid, int* nice)
+{
+    _processes_lock.lock();
+
+    process::Process* p = find_process(pid);
+
+    if (p != nullptr) {
+        *nice = p->nice;
+    }
+
+    _processes_lock.unlock();
+
+    return p != nullptr;
+}
+
+/// @brief change the nice value of a process
+///
+/// A queued process is pulled out and re-queued so the scheduling policy
+/// accounts for its new weight
+///
+/// @param pid the process pid
+/// @param nice the new nice value
+///
+/// @return false if no process has that pid
+///
+bool Scheduler::set_nice(int pid, int nice)
+{
+    _processes_lock.lock();
+
+    process::Process* p = find_process(pid);
+
+    if (p == nullptr) {
+        _processes_lock.unlock();
+        return false;
+    }
+
+    const bool queued = p->is_ready() && p != arch::percpu::current_process();
+
+    if (queued) {
+        remove_from_queue(p);
+    }
+
+    p->nice = nice;
+
+    if (queued) {
+        enqueue(p, false);
+    }
+
+    _processes_lock.unlock();
+
+    return true;
+}
+
+/// @brief read the scheduling policy and real-time priority of a process
+///
+/// @return 0 on success, -ESRCH if no process has that pid
+///
+int Scheduler::get_policy(int pid, process::SchedPolicy* policy, int* rt_priority)
+{
+    _processes_lock.lock();
+
+    process::Process* p = find_process(pid);
+
+    if (p != nullptr) {
+        *policy = p->policy;
+        *rt_priority = p->rt_priority;
+    }
+
+    _processes_lock.unlock();
+
+    return p != nullptr ? 0 : -ESRCH;
+}
+
+/// @brief move a process between the normal and real-time scheduling classes
+///
+/// @param pid the process pid
+/// @param policy the new policy
+/// @param rt_priority 1-99 for FIFO/RR (higher runs first), 0 for NORMAL
+///
+/// @return 0 on success, -EINVAL for a bad priority, -ESRCH for a bad pid
+///
+int Scheduler::set_policy(int pid, process::SchedPolicy policy, int rt_priority)
+{
+    const bool realtime = policy != process::SchedPolicy::NORMAL;
+
+    if (realtime && (rt_priority < RT_PRIORITY_MIN || rt_priority > RT_PRIORITY_MAX)) {
+        return -EINVAL;
+    }
+
+    if (!realtime && rt_priority != 0) {
+        return -EINVAL;
+    }
+
+    _processes_lock.lock();
+
+    process::Process* p = find_process(pid);
+
+    if (p == nullptr) {
+        _processes_lock.unlock();
+        return -ESRCH;
+    }
+
+    process::Process* current = arch::percpu::current_process();
+    const bool queued = p->is_ready() && p != current;
+
+    if (queued) {
+        remove_from_queue(p);
+    }
+
+    p->policy = policy;
+    p->rt_priority = rt_priority;
+    p->rt_slice_left_ns = rr_timeslice_ns();
+    p->exec_start_ns = arch::drivers::tsc::get_time_ns();
+
+    if (queued) {
+        enqueue(p, true);
+    }
+
+    // Re-evaluate the running process at the next opportunity, it may have
+    // just been demoted below something that is waiting
+    if (p == current) {
+        arch::percpu::get()->need_resched = true;
+    }
+
+    _processes_lock.unlock();
+
+    return 0;
+}
+
+/// @brief terminate every other task in the thread group of self
+///
+/// Used by exit_group() and execve(). The other tasks are only told to go:
+/// each one may be anywhere in the kernel, holding locks or with requests
+/// on its stack, so it unwinds by itself and exits with exit_status on its
+/// way back to user mode (syscall::exit_killed()). One asleep in a
+/// killable wait is woken for that, others finish what they are doing
+/// first. The group leader exits as a ZOMBIE like with sys_exit(), so its
+/// parent can still wait() for it once its last thread is gone.
+///
+/// A group exit that is already under way keeps its status, and tasks
+/// added since (a clone() that raced with it) are told too.
+///
+/// @param self the calling task, which is left running
+/// @param exit_status status the group exits with
+///
+/// @return the status the group exits with
+///
+int Scheduler::kill_other_threads(process::Process* self, int exit_status)
+{
+    _processes_lock.lock();
+
+    if (self->kill_pending) {
+        exit_status = self->exit_status;
+    }
+
+    for (std::size_t i = 0; i < _processes.size(); i++) {
+        process::Process* p = _processes[i];
+
+        if (p == self || p->tgid != self->tgid || p->is_dead() || p->is_zombie() || p->kill_pending) {
+            continue;
+        }
+
+        p->kill_pending = true;
+        p->exit_status = exit_status;
+
+        if (p->is_blocked() && p->killable) {
+            make_ready(p);
+        }
+    }
+
+    _processes_lock.unlock();
+
+    return exit_status;
+}
+
+/// @brief block the group leader self until every other task of its
+///        group has exited, after kill_other_threads()
+///
+/// @return 0, or -EINTR if self was killed in turn
+///
+int Scheduler::wait_other_threads(process::Process* self)
+{
+    while (true) {
+        _processes_lock.lock();
+
+        if (self->kill_pending) {
+            _processes_lock.unlock();
+            return -EINTR;
+        }
+
+        if (!has_live_threads(self)) {
+            _processes_lock.unlock();
+            return 0;
+        }
+
+        // thread_exited() wakes us
+        self->killable = true;
+        self->wait_for(process::WaitReason::GROUP_EXIT);
+
+        process::Process* p = pick_next();
+
+        activate_process(p);
+        _processes_lock.unlock();
+        context_switch(&self->kernel_rsp_saved, p->kernel_rsp_saved);
+    }
+}
+
+/// @brief whether any task of the group led by leader has not exited yet
+///
+/// @note the caller must hold _processes_lock
+///
+bool Scheduler::has_live_threads(const process::Process* leader) const
+{
+    for (std::size_t i = 0; i < _processes.size(); i++) {
+        const process::Process* other = _processes[i];
+
+        if (other != leader && other->tgid == leader->pid && !other->is_dead() && !other->is_zombie()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// @brief whether wait() can collect p: a ZOMBIE whose threads are all gone
+///
+/// A group leader that exits first is parked as a ZOMBIE until its last
+/// thread exits, as on Linux. The threads still carry its pid as their tgid,
+/// so it must not be freed, and reused, before them.
+///
+/// @note the caller must hold _processes_lock
+///
+bool Scheduler::is_waitable(const process::Process* p) const
+{
+    return p->is_zombie() && !has_live_threads(p);
+}
+
+/// @brief wake whoever waits for the group of thread to empty: the parent
+///        of a parked group leader, or the leader itself in execve()
+///
+/// @note the caller must hold _processes_lock
+///
+void Scheduler::thread_exited(process::Process* thread)
+{
+    process::Process* leader = find_process(thread->tgid);
+
+    if (leader == nullptr || has_live_threads(leader)) {
+        return;
+    }
+
+    if (leader->is_zombie()) {
+        wake_parents(leader->pid);
+    } else if (leader->is_blocked() && leader->is_waiting_for(process::WaitReason::GROUP_EXIT)) {
+        make_ready(leader);
+    }
+}
+
+/// @brief find a child of parent to wait on
+///
+/// @param parent the waiting process
+/// @param pid the child pid, or -1 for any child
+///
+/// @return a waitable child if one exists, otherwise the first matching child
+///
+process::Process* Scheduler::find_child(process::Process* parent, int pid)
+{
+    process::Process* first_match = nullptr;
+
+    for (std::size_t i = 0; i < _processes.size(); i++) {
+        process::Process* p = _processes[i];
+
+        if (pid != -1 && p->pid != pid) {
+            continue;
+        }
+
+        if (p->parent == nullptr || p->parent->pid != parent->pid) {
+            continue;
+        }
+
+        // threads are not waitable children, only their group leader is
+        if (p->is_thread()) {
+            continue;
+        }
+
+        if (is_waitable(p)) {
+            return p;
+        }
+
+        if (first_match == nullptr) {
+            first_match = p;
+        }
+    }
+
+    return first_match;
+}
+
 /// @brief wakes the first processes that is blocked for wait_reason
 ///
 /// @param wait_reason the reason to wake the process
@@ -50,7 +577,7 @@ void Scheduler::wake_single(process::WaitReason reason)
             continue;
         }
 
-        p->wake();
+        make_ready(p);
 
         goto cleanup;
     }
@@ -80,7 +607,7 @@ void Scheduler::wake_all(process::WaitReason reason)
             continue;
         }
 
-        p->wake();
+        make_ready(p);
     }
 
     _processes_lock.unlock();
@@ -101,11 +628,35 @@ void Scheduler::wake_parents(int pid)
             continue;
         }
 
-        p->wake();
+        make_ready(p);
     }
 }
 
-/// @brief wake all sleeping processes that have a wake_time_ms in the past
+/// @brief wake a specific process if it is blocked for reason
+///
+/// If p has not blocked yet (it is still on its way into yield_blocked())
+/// the wakeup is remembered in wake_pending, so yield_blocked() returns
+/// straight away instead of sleeping through it
+///
+/// @param p the process to wake
+/// @param reason the reason p is expected to be blocked for
+///
+void Scheduler::wake_process(process::Process* p, process::WaitReason reason)
+{
+    _processes_lock.lock();
+
+    if (p->is_blocked() && p->is_waiting_for(reason)) {
+        make_ready(p);
+    } else {
+        p->wake_pending = true;
+    }
+
+    _processes_lock.unlock();
+}
+
+/// @brief wake all blocked processes that have a wake_time_ms in the past
+///
+/// This covers both sleeping processes and blocked ones with a timeout
 ///
 void Scheduler::wake_sleepers()
 {
@@ -120,15 +671,11 @@ void Scheduler::wake_sleepers()
             continue;
         }
 
-        if (!p->is_waiting_for(process::WaitReason::SLEEP)) {
-            continue;
-        }
-
         if (p->wake_time_ms == 0 || ticks < p->wake_time_ms) {
             continue;
         }
 
-        p->wake();
+        make_ready(p);
     }
 }
 
@@ -149,12 +696,13 @@ void Scheduler::activate_process(process::Process* p)
     cpu->process = p;
     cpu->kernel_rsp = p->kernel_rsp;
 
-    arch::vmm::switch_pml4(p->pml4);
+    arch::vmm::switch_pml4(p->mm->pml4);
     arch::tls::set_fs_base(p->fs_base);
+    arch::fpu::switch_to(p->fpu_state);
     arch::gdt::set_kernel_stack(p->kernel_rsp);
 }
 
-/// @brief Periodically terminate DEAD processes
+/// @brief Terminate DEAD processes as they are released
 ///
 /// @return this function should never return
 ///
@@ -171,35 +719,74 @@ static void reaper_kthread()
     kpanic("reaper_kthread terminated");
 }
 
+/// @brief mark a process DEAD and hand it to the reaper
+///
+/// @note the caller must hold _processes_lock
+///
+/// @param p the process, which must never run again
+///
+void Scheduler::release(process::Process* p)
+{
+    p->kill();
+    _reap_list.push_back(p);
+
+    if (_reaper != nullptr && _reaper->is_blocked() && _reaper->is_waiting_for(process::WaitReason::REAPER)) {
+        make_ready(_reaper);
+    }
+}
+
+/// @brief free one DEAD process, or block until there is one
+///
 void Scheduler::reap()
 {
     _processes_lock.lock();
 
     process::Process* self = arch::percpu::current_process();
 
-    for (std::size_t i = 0; i < _processes.size(); i++) {
-        process::Process* p = _processes[i];
-
-        kassert_not_null(p);
+    // Checking the list and blocking happen under the same lock, so a
+    // release() can never slip in between and have its wakeup lost
+    if (_reap_list.empty()) {
+        self->wait_for(process::WaitReason::REAPER);
+        process::Process* next = pick_next();
 
-        if (!p->is_dead()) {
-            continue;
+        if (next == self) {
+            self->resume();
+            _processes_lock.unlock();
+            return;
         }
 
-        // the reaper_kthread should never attempt to terminate itself,
-        // even if it gets marked DEAD for some reason
-        if (p == self) {
-            kpanic("reaper_kthread wants to kill itself");
-        }
+        activate_process(next);
+        _processes_lock.unlock();
+        context_switch(&self->kernel_rsp_saved, next->kernel_rsp_saved);
+        return;
+    }
+
+    process::Process* p = _reap_list.front();
+    _reap_list.pop_front();
 
-        delete p;
+    kassert(p->is_dead());
 
-        _processes.erase(i--);
+    // the reaper_kthread should never attempt to terminate itself,
+    // even if it gets marked DEAD for some reason
+    if (p == self) {
+        kpanic("reaper_kthread wants to kill itself");
     }
 
+    _processes.remove(p);
     _processes_lock.unlock();
 
-    yield_sleep(REAP_INTERVAL_MS);
+    // Nothing can reach p anymore, so the (slow) teardown runs unlocked
+    delete p;
+}
+
+/// @brief create the reaper kthread, which sleeps until a process is released
+///
+void Scheduler::start_reaper()
+{
+    kassert(_reaper == nullptr);
+
+    _reaper = new process::KThread(reaper_kthread);
+    add_process(_reaper);
 }
 
 /// @brief interrupt the current process to schedule a new one
@@ -213,6 +800,8 @@ void Scheduler::preempt()
         return;
     }
 
+    arch::percpu::get()->need_resched = false;
+
     // ********************************
     // **** Begin Mutual Exclusion ****
     // ********************************
@@ -228,7 +817,7 @@ void Scheduler::preempt()
     _processes_lock.lock();
 
     process::Process* current = arch::percpu::current_process();
-    process::Process* next = next_ready_process();
+    process::Process* next = pick_next();
 
     // We never want a process to context switch to itself, so we can
     // just leave early if a process wants to switch to itself, after
@@ -239,6 +828,12 @@ void Scheduler::preempt()
     }
 
     current->pause();
+
+    // the idle process is never queued, it only runs when nothing else can
+    if (current != arch::percpu::idle_process()) {
+        enqueue(current, false);
+    }
+
     activate_process(next);
     _processes_lock.unlock();
     context_switch(&current->kernel_rsp_saved, next->kernel_rsp_saved);
@@ -254,8 +849,13 @@ void Scheduler::yield_dead()
     _processes_lock.lock();
 
     process::Process* current = arch::percpu::current_process();
-    current->kill();
-    process::Process* p = next_ready_process();
+    release(current);
+
+    if (current->is_thread()) {
+        thread_exited(current);
+    }
+
+    process::Process* p = pick_next();
 
     kassert(current != p);
     activate_process(p);
@@ -270,7 +870,7 @@ void Scheduler::yield_dead()
 }
 
 /// mark the current process as ZOMBIE, wake all parents that are
-/// waiting on this pid, and schedule a new process
+/// waiting on this pid if it has no threads left, and schedule a new process
 ///
 /// @return this function should never return
 ///
@@ -281,8 +881,13 @@ void Scheduler::yield_zombie()
 
     process::Process* current = arch::percpu::current_process();
     current->zombify();
-    wake_parents(current->pid);
-    process::Process* p = next_ready_process();
+
+    // A leader with threads left is parked, the last of them wakes the parent
+    if (is_waitable(current)) {
+        wake_parents(current->pid);
+    }
+
+    process::Process* p = pick_next();
 
     kassert(current != p);
     activate_process(p);
@@ -297,7 +902,7 @@ void Scheduler::yield_zombie()
 ///
 /// @param child_pid the child pid
 ///
-/// @return the exit status of the child
+/// @return the exit status of the child, or -EINTR if the caller is killed
 ///
 int Scheduler::yield_to_child(int child_pid)
 {
@@ -307,30 +912,37 @@ int Scheduler::yield_to_child(int child_pid)
         _processes_lock.lock();
 
         process::Process* parent = arch::percpu::current_process();
+
+        if (parent->kill_pending) {
+            _processes_lock.unlock();
+            return -EINTR;
+        }
+
         process::Process* child = find_child(parent, child_pid);
 
         // return early if a parent calls wake() but has no children to wait on
         if (child == nullptr) {
-            log::warn("yield_to_child() found no children");
+            log::warn<log::Subsystem::SCHED>("yield_to_child() found no children");
             _processes_lock.unlock();
             return -ECHILD;
         }
 
         // once we find a zombie child we no longer need to block anymore,
         // mark the child as dead so that it can be freed and resume the parent
-        if (child->is_zombie()) {
+        if (is_waitable(child)) {
             const int exit_status = child->exit_status;
 
-            child->kill();
+            release(child);
             parent->resume();
             _processes_lock.unlock();
 
             return exit_status;
         }
 
+        parent->killable = true;
         parent->wait_for_child(child_pid);
 
-        process::Process* p = next_ready_process();
+        process::Process* p = pick_next();
 
         activate_process(p);
         _processes_lock.unlock();
@@ -338,15 +950,13 @@ int Scheduler::yield_to_child(int child_pid)
     }
 }
 
-/// @brief put the current process to sleep
+/// @brief put the current process to sleep, a kill cuts the sleep short
 ///
 /// @param sleep_time_ms time in ms to sleep for
 ///
 void Scheduler::yield_sleep(std::uint64_t sleep_time_ms)
 {
-    process::Process* current = arch::percpu::current_process();
-    current->sleep_until(timer::get_ticks() + sleep_time_ms);
-    yield_blocked(process::WaitReason::SLEEP);
+    block_current(process::WaitReason::SLEEP, timer::get_ticks() + sleep_time_ms, true);
 }
 
 /// @brief block the current process and schedule a new one
@@ -354,26 +964,96 @@ void Scheduler::yield_sleep(std::uint64_t sleep_time_ms)
 /// @param wait_reason the reason the process is blocked
 ///
 void Scheduler::yield_blocked(process::WaitReason reason)
+{
+    block_current(reason, 0, false);
+}
+
+/// @brief block the current process until it is woken or timeout_ms passes
+///
+/// @param wait_reason the reason the process is blocked
+/// @param timeout_ms time in ms after which the process wakes up regardless
+///
+void Scheduler::yield_blocked_timeout(process::WaitReason reason, std::uint64_t timeout_ms)
+{
+    block_current(reason, timer::get_ticks() + timeout_ms, false);
+}
+
+/// @brief like yield_blocked(), but a kill of the group wakes the process
+///
+/// For waits on user space (pipes, futexes, poll(), ...), which may never
+/// end otherwise. The caller backs out of its syscall on -EINTR
+///
+/// @return 0, or -EINTR if the process was killed
+///
+int Scheduler::yield_killable(process::WaitReason reason)
+{
+    return block_current(reason, 0, true);
+}
+
+/// @brief like yield_blocked_timeout(), but a kill of the group wakes the process
+///
+/// @return 0, or -EINTR if the process was killed
+///
+int Scheduler::yield_killable_timeout(process::WaitReason reason, std::uint64_t timeout_ms)
+{
+    return block_current(reason, timer::get_ticks() + timeout_ms, true);
+}
+
+/// @brief block the current process, optionally until a tick count
+///
+/// The wake time is set under _processes_lock, activate_process() clears it,
+/// so setting it earlier would be lost if the process got preempted first
+///
+/// @param wait_reason the reason the process is blocked
+/// @param wake_time_ms tick at which wake_sleepers() wakes it, 0 for never
+/// @param killable whether kill_other_threads() wakes it
+///
+/// @return -EINTR if killable and the process is killed, otherwise 0
+///
+int Scheduler::block_current(process::WaitReason reason, std::uint64_t wake_time_ms, bool killable)
 {
     _processes_lock.lock();
 
     process::Process* current = arch::percpu::current_process();
+
+    if (killable && current->kill_pending) {
+        current->wake_time_ms = 0;
+        _processes_lock.unlock();
+        return -EINTR;
+    }
+
+    // Woken before it even got to block, see wake_process()
+    if (current->wake_pending) {
+        current->wake_pending = false;
+        current->wake_time_ms = 0;
+        _processes_lock.unlock();
+        return 0;
+    }
+
+    current->killable = killable;
     current->wait_for(reason);
-    process::Process* next = next_ready_process();
 
-    // find_next_ready_process() wakes all sleeping processes that are past
+    if (wake_time_ms != 0) {
+        current->wake_time_ms = wake_time_ms;
+    }
+
+    process::Process* next = pick_next();
+
+    // pick_next() wakes all sleeping processes that are past
     // their wake time, which could include this very process that is
     // trying to yield itself while sleeping. We do not want to context
     // switch a process to itself, so simply set its state back to RUNNING and carry on
     if (current == next) {
         current->resume();
         _processes_lock.unlock();
-        return;
+        return 0;
     }
 
     activate_process(next);
     _processes_lock.unlock();
     context_switch(&current->kernel_rsp_saved, next->kernel_rsp_saved);
+
+    return killable && current->kill_pending ? -EINTR : 0;
 }
 
 void Scheduler::yield_new_process()
@@ -381,11 +1061,12 @@ void Scheduler::yield_new_process()
     _processes_lock.lock();
 
     process::Process* current = arch::percpu::current_process();
-    process::Process* next = next_ready_process();
+    process::Process* next = pick_next();
 
     kassert(current != next);
 
     current->wake();
+    enqueue(current, false);
     activate_process(next);
     _processes_lock.unlock();
 
@@ -406,6 +1087,7 @@ void RoundRobinScheduler::add_process(process::Process* p)
 
     _processes_lock.lock();
     _processes.push_back(p);
+    enqueue(p, false);
     _processes_lock.unlock();
 }
 
@@ -419,12 +1101,42 @@ void tick()
     g_scheduler->preempt();
 }
 
+/// @brief preempt the current process if a more important one became READY
+///
+/// Called on the way out of interrupt handlers and syscalls, so a woken
+/// real-time process does not have to wait for the next timer tick.
+///
+void preempt_if_needed()
+{
+    if (g_scheduler == nullptr || !arch::percpu::get()->need_resched) {
+        return;
+    }
+
+    g_scheduler->preempt();
+}
+
+/// @brief create the global scheduler
+///
+/// The scheduling policy is picked with `sched=rr` or `sched=fair` on the
+/// kernel command line (see limine.conf), defaulting to round robin.
+///
 void init()
 {
-    log::info("scheduler: Round Robin scheduler initialized");
+    const kstring_view policy = boot::get_cmdline_option("sched");
+
+    if (policy == kstring_view{"fair"}) {
+        g_scheduler = new FairScheduler{};
+    } else {
+        if (!policy.empty() && policy != kstring_view{"rr"}) {
+            log::warn<log::Subsystem::SCHED>("scheduler: unknown policy '", policy, "', using round robin");
+        }
+
+        g_scheduler = new RoundRobinScheduler{};
+    }
+
+    log::infof<log::Subsystem::SCHED>("scheduler: {} scheduler initialized", g_scheduler->name());
 
-    g_scheduler = new RoundRobinScheduler{};
-    g_scheduler->add_process(new process::KThread(reaper_kthread));
+    g_scheduler->start_reaper();
 }
 
 }
@@ -1,57 +1,152 @@
 #include <arch.hpp>
 #include <console/console.hpp>
 #include <containers/kstring.hpp>
+#include <fs/ext2/ext2.hpp>
 #include <fs/fs.hpp>
+#include <fs/page_cache.hpp>
+#include <fs/pipe.hpp>
+#include <fs/tmpfs/tmpfs.hpp>
 #include <linux/dirent.hpp>
+#include <linux/fcntl.hpp>
 #include <log/log.hpp>
 #include <memory/memory.hpp>
 #include <process/process.hpp>
 #include <syscall/sys_fd.hpp>
 
 #include <cerrno>
+#include <climits>
 #include <cstddef>
+#include <cstdint>
 
 namespace syscall {
-static int alloc_fd(process::Process* process)
+static_assert(MAX_FDS <= sizeof(process::FileTable::cloexec) * CHAR_BIT);
+
+/// @brief find the lowest free fd that is at least min
+///
+static int alloc_fd(process::Process* process, int min)
 {
-    for (std::size_t i = 0; i < process->fd_table.size(); i++) {
-        if (process->fd_table[i]->inode == nullptr) {
+    kvector<fs::FileDescriptor*>& fds = process->files->fds;
+
+    for (std::size_t i = min; i < fds.size(); i++) {
+        if (fds[i] == nullptr) {
             return i;
         }
     }
 
-    process->fd_table.push_back({});
+    const std::size_t fd = fds.size() > static_cast<std::size_t>(min) ? fds.size() : min;
+
+    if (fd >= MAX_FDS) {
+        return -EMFILE;
+    }
+
+    fds.resize(fd + 1);
 
-    return process->fd_table.size() - 1;
+    return fd;
 }
 
-static fs::FileDescriptor* get_fd(int fd)
+/// @brief put desc in the lowest free slot, at least min, of the current fd table
+///
+/// On failure the reference to desc is dropped, so callers can hand over a
+/// freshly opened file and just return the result
+///
+/// @param flags O_CLOEXEC to mark the new fd close-on-exec
+///
+/// @return the new fd, or -EMFILE if the table is full
+///
+int install_fd(fs::FileDescriptor* desc, int flags, int min)
 {
     process::Process* process = arch::percpu::current_process();
+    const int fd = alloc_fd(process, min);
+
+    if (fd < 0) {
+        desc->put();
+        return fd;
+    }
 
-    if (fd < 0 || process == nullptr || (std::size_t)fd >= process->fd_table.size()) {
+    process->files->fds[fd] = desc;
+    process->files->set_cloexec(fd, flags & fs::O_CLOEXEC);
+
+    return fd;
+}
+
+fs::FileDescriptor* get_fd(int fd)
+{
+    process::Process* process = arch::percpu::current_process();
+
+    if (fd < 0 || process == nullptr || (std::size_t)fd >= process->files->fds.size()) {
         return nullptr;
     }
 
-    return process->fd_table[fd];
+    return process->files->fds[fd];
+}
+
+// Most a single read, write or transfer moves, as on Linux
+constexpr std::size_t MAX_RW_COUNT = INT_MAX & ~(arch::vmm::PAGE_SIZE - 1);
+
+/// @brief copy a path argument into the kernel
+///
+/// @return 0, -EFAULT or -ENAMETOOLONG
+///
+static int copy_path(const char* __user path, kstring& out)
+{
+    return kstring::from_user(path, fs::MAX_PATH - 1, out);
+}
+
+/// @brief copy a user iovec array in one go and check every buffer in it
+///
+/// Inodes tell user buffers from kernel ones by address, so a kernel address
+/// must never get through as iov_base
+///
+/// @return 0, -EINVAL for a bad count or a total that does not fit the
+///         return value, -EFAULT for a bad pointer
+///
+static int copy_iovecs(const linux::iovec* __user iov, int iovcnt, kvector<linux::iovec>& out)
+{
+    if (iovcnt < 0 || iovcnt > linux::UIO_MAXIOV) {
+        return -EINVAL;
+    }
+
+    out.resize(iovcnt);
+
+    if (arch::uaccess::copy_array_from_user(out.data(), iov, iovcnt) < 0) {
+        return -EFAULT;
+    }
+
+    std::size_t total = 0;
+
+    for (const linux::iovec& vec : out) {
+        if (vec.iov_len > static_cast<std::size_t>(INT_MAX) - total) {
+            return -EINVAL;
+        }
+
+        if (!arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(vec.iov_base), vec.iov_len)) {
+            return -EFAULT;
+        }
+
+        total += vec.iov_len;
+    }
+
+    return 0;
 }
 
 int sys_open(const char* __user path, int flags)
 {
-    kstring path_str = kstring::from_userspace(path);
+    kstring path_str;
+    const int err = copy_path(path, path_str);
 
-    log::debugf("sys open dir = {}", path_str);
+    if (err < 0) {
+        return err;
+    }
+
+    log::debugf<log::Subsystem::SYSCALL>("sys open dir = {}", path_str);
 
-    process::Process* process = arch::percpu::current_process();
     fs::FileDescriptor* desc = fs::open(path_str, flags);
 
     if (!desc) {
         return -ENOENT;
     }
 
-    int fd = alloc_fd(process);
-    process->fd_table[fd] = desc;
-    return fd;
+    return install_fd(desc, flags);
 }
 
 int sys_read(int fd, void* buffer, std::size_t count)
@@ -62,6 +157,10 @@ int sys_read(int fd, void* buffer, std::size_t count)
         return -EBADF;
     }
 
+    if (!arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(buffer), count)) {
+        return -EFAULT;
+    }
+
     int read = desc->inode->read(desc, buffer, count);
 
     return read;
@@ -75,72 +174,79 @@ int sys_write(int fd, const void* buffer, std::size_t count)
         return -EBADF;
     }
 
+    if (!arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(buffer), count)) {
+        return -EFAULT;
+    }
+
     return desc->inode->write(desc, buffer, count);
 }
 
-int sys_readv(int fd, const linux::iovec* iov, int iovcnt)
+int sys_readv(int fd, const linux::iovec* __user iov, int iovcnt)
 {
     fs::FileDescriptor* desc = get_fd(fd);
 
     if (!desc) {
-        log::debug("sys_writev fd = null");
+        log::debug<log::Subsystem::SYSCALL>("sys_readv fd = null");
         return -EBADF;
     }
 
-    if (iovcnt < 0) {
-        log::debug("sys_writev iovcnt < 0");
-        return -EINVAL;
+    kvector<linux::iovec> iovecs;
+    const int err = copy_iovecs(iov, iovcnt, iovecs);
+
+    if (err < 0) {
+        log::debug<log::Subsystem::SYSCALL>("sys_readv bad iovec array");
+        return err;
     }
 
     int total = 0;
 
-    arch::cpu::stac();
-
-    for (int i = 0; i < iovcnt; i++) {
-        if (iov[i].iov_len == 0) {
+    for (const linux::iovec& vec : iovecs) {
+        if (vec.iov_len == 0) {
             continue;
         }
 
-        int read = desc->inode->read(desc, iov[i].iov_base, iov[i].iov_len);
+        int read = desc->inode->read(desc, vec.iov_base, vec.iov_len);
 
         if (read < 0) {
             return total > 0 ? total : read;
         }
 
         total += read;
-    }
 
-    arch::cpu::clac();
+        // A short read means there is nothing more right now
+        if (static_cast<std::size_t>(read) < vec.iov_len) {
+            break;
+        }
+    }
 
     return total;
 }
 
-int sys_writev(int fd, const linux::iovec* iov, int iovcnt)
+int sys_writev(int fd, const linux::iovec* __user iov, int iovcnt)
 {
     fs::FileDescriptor* desc = get_fd(fd);
 
     if (!desc) {
-        log::debug("sys_writev fd = null");
+        log::debug<log::Subsystem::SYSCALL>("sys_writev fd = null");
         return -EBADF;
     }
 
-    if (iovcnt < 0) {
-        log::debug("sys_writev iovcnt < 0");
-        return -EINVAL;
+    kvector<linux::iovec> iovecs;
+    const int err = copy_iovecs(iov, iovcnt, iovecs);
+
+    if (err < 0) {
+        log::debug<log::Subsystem::SYSCALL>("sys_writev bad iovec array");
+        return err;
     }
 
     int total = 0;
 
-    for (int i = 0; i < iovcnt; i++) {
-        linux::iovec iovec;
-
-        kcopy_from_user(&iovec, iov + i, sizeof(linux::iovec));
-
-        if (iovec.iov_len == 0) {
+    for (const linux::iovec& vec : iovecs) {
+        if (vec.iov_len == 0) {
             continue;
         }
 
-        int written = desc->inode->write(desc, iovec.iov_base, iovec.iov_len);
+        int written = desc->inode->write(desc, vec.iov_base, vec.iov_len);
 
         if (written < 0) {
             return total > 0 ? total : written;
@@ -172,25 +278,55 @@ int sys_close(int fd)
         return -EBADF;
     }
 
-    int result = desc->inode->close(desc);
-    process->fd_table[fd] = nullptr;
-    return result;
+    process->files->fds[fd] = nullptr;
+    process->files->set_cloexec(fd, false);
+
+    return desc->put();
 }
 
-int sys_stat(const char* path, fs::Stat* stat)
+int sys_stat(const char* __user path, fs::Stat* __user stat)
 {
-    return fs::stat(path, stat);
+    kstring path_str;
+    fs::Stat st{};
+    int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    err = fs::stat(path_str, &st);
+
+    if (err < 0) {
+        return err;
+    }
+
+    if (kcopy_to_user(stat, &st, sizeof(st)) < 0) {
+        return -EFAULT;
+    }
+
+    return err;
 }
 
-int sys_fstat(int fd, fs::Stat* stat)
+int sys_fstat(int fd, fs::Stat* __user stat)
 {
     fs::FileDescriptor* desc = get_fd(fd);
+    fs::Stat st{};
 
     if (!desc) {
         return -EBADF;
     }
 
-    return desc->inode->stat(stat);
+    const int err = desc->inode->stat(&st);
+
+    if (err < 0) {
+        return err;
+    }
+
+    if (kcopy_to_user(stat, &st, sizeof(st)) < 0) {
+        return -EFAULT;
+    }
+
+    return err;
 }
 
 int sys_lseek(int fd, std::size_t offset, int whence)
@@ -207,20 +343,34 @@ int sys_lseek(int fd, std::size_t offset, int whence)
 long sys_getcwd(char* __user buffer, std::size_t size)
 {
     process::Process* proc = arch::percpu::current_process();
-    kstring cwd = fs::getcwd(proc->cwd_inode);
+    const fs::Inode* inode = proc->files->cwd_inode();
+
+    // A removed directory is cut off from the tree and has no path
+    if (inode != nullptr && inode->parent == nullptr && inode != inode->mountpoint->root_inode) {
+        return -ENOENT;
+    }
+
+    kstring cwd = fs::getcwd(inode);
 
     if (cwd.length() + 1 > size) {
         return -ERANGE;
     }
 
-    kcopy_to_user(buffer, cwd.c_str(), cwd.size() + 1);
+    if (kcopy_to_user(buffer, cwd.c_str(), cwd.size() + 1) < 0) {
+        return -EFAULT;
+    }
 
     return reinterpret_cast<long>(buffer);
 }
 
 int sys_chdir(const char* __user path)
 {
-    kstring path_str = kstring::from_userspace(path);
+    kstring path_str;
+    const int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
 
     auto* proc = arch::percpu::current_process();
     auto* fd = fs::open(path_str, fs::O_RDONLY);
@@ -230,10 +380,11 @@ int sys_chdir(const char* __user path)
     }
 
     if (fd->inode->type != fs::FileType::DIRECTORY) {
+        fd->put();
         return -ENOTDIR;
     }
 
-    proc->cwd_inode = fd->inode;
+    proc->files->set_cwd(fd);
 
     return 0;
 }
@@ -251,67 +402,576 @@ int sys_fchdir(int fd)
         return -ENOTDIR;
     }
 
-    proc->cwd_inode = desc->inode;
+    // The cwd shares the open directory with fd, which can then be closed
+    desc->get();
+    proc->files->set_cwd(desc);
 
     return 0;
 }
 
-int sys_mkdir(const char* path, int mode)
+int sys_mkdir(const char* __user path, int mode)
 {
-    kstring path_str = kstring::from_userspace(path);
+    kstring path_str;
+    const int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
 
     return fs::mkdir(path_str, mode);
 }
 
-int sys_fcntl(int, unsigned int, unsigned long)
+int sys_unlink(const char* __user path)
+{
+    kstring path_str;
+    const int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    return fs::unlink(path_str);
+}
+
+int sys_rmdir(const char* __user path)
 {
-    log::warn("SYS_FCNTL is not implemented yet");
-    return 1;
+    kstring path_str;
+    const int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    return fs::rmdir(path_str);
+}
+
+int sys_rename(const char* __user old_path, const char* __user new_path)
+{
+    kstring old_str;
+    kstring new_str;
+    int err = copy_path(old_path, old_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    err = copy_path(new_path, new_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    return fs::rename(old_str, new_str);
+}
+
+int sys_truncate(const char* __user path, long length)
+{
+    if (length < 0) {
+        return -EINVAL;
+    }
+
+    kstring path_str;
+    const int err = copy_path(path, path_str);
+
+    if (err < 0) {
+        return err;
+    }
+
+    return fs::truncate(path_str, static_cast<std::size_t>(length));
+}
+
+int sys_ftruncate(int fd, long length)
+{
+    fs::FileDescriptor* desc = get_fd(fd);
+
+    if (!desc) {
+        return -EBADF;
+    }
+
+    if (length < 0 || (desc->flags & fs::O_ACCMODE) == fs::O_RDONLY) {
+        return -EINVAL;
+    }
+
+    return desc->inode->truncate(static_cast<std::size_t>(length));
 }
 
-int sys_getdents64(int fd, void* buffer, unsigned int count)
+/// @brief fd and open file flags, and dup to a minimum fd
+///
+/// F_SETFL can only change O_NONBLOCK, the access mode is fixed at open
+///
+int sys_fcntl(int fd, unsigned int cmd, unsigned long arg)
 {
+    process::Process* process = arch::percpu::current_process();
     fs::FileDescriptor* desc = get_fd(fd);
 
     if (!desc) {
         return -EBADF;
     }
 
-    kvector<fs::DirEntry> entries;
+    switch (cmd) {
+    case linux::F_DUPFD:
+    case linux::F_DUPFD_CLOEXEC:
+        if (arg >= MAX_FDS) {
+            return -EINVAL;
+        }
 
-    fs::readdir(desc->path, entries);
+        desc->get();
 
-    if (desc->offset >= entries.size()) {
+        return install_fd(desc, cmd == linux::F_DUPFD_CLOEXEC ? fs::O_CLOEXEC : 0, static_cast<int>(arg));
+    case linux::F_GETFD:
+        return process->files->is_cloexec(fd) ? linux::FD_CLOEXEC : 0;
+    case linux::F_SETFD:
+        process->files->set_cloexec(fd, arg & linux::FD_CLOEXEC);
+        return 0;
+    case linux::F_GETFL:
+        return desc->flags & (fs::O_ACCMODE | fs::O_NONBLOCK);
+    case linux::F_SETFL:
+        desc->flags = (desc->flags & ~fs::O_NONBLOCK) | (arg & fs::O_NONBLOCK);
         return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief write back the file's dirty pages
+///
+/// Writes back every dirty page, like sync(). The file's data has a mapping
+/// of its own, but its inode, the bitmaps and the indirect blocks sit in the
+/// device mapping among every other file's, and the VFS can not tell which
+/// of those are this file's
+///
+int sys_fsync(int fd)
+{
+    if (!get_fd(fd)) {
+        return -EBADF;
+    }
+
+    return fs::cache::sync();
+}
+
+int sys_sync()
+{
+    fs::cache::sync();
+
+    return 0;
+}
+
+/// @brief mount a filesystem of type fstype, from the block device source
+///        for ext2, on the directory target
+///
+/// flags and data are ignored, and nothing can be unmounted again
+///
+/// @return 0, -ENODEV for an unknown fstype, -ENOENT/-ENOTDIR for a bad
+///         target, -EINVAL if source holds no filesystem fstype can mount
+///
+int sys_mount(const char* __user source,
+              const char* __user target,
+              const char* __user fstype,
+              unsigned long,
+              const void* __user)
+{
+    kstring source_str;
+    kstring target_str;
+    kstring type_str;
+    int err = source ? copy_path(source, source_str) : 0;
+
+    if (err == 0) {
+        err = copy_path(target, target_str);
+    }
+
+    if (err == 0) {
+        err = kstring::from_user(fstype, fs::MAX_NAME, type_str);
+    }
+
+    if (err < 0) {
+        return err;
+    }
+
+    fs::FileSystem* filesystem;
+
+    if (type_str == "ext2") {
+        filesystem = new fs::ext2::Ext2FileSystem{};
+    } else if (type_str == "tmpfs") {
+        filesystem = new fs::tmpfs::TmpFileSystem{};
+    } else {
+        return -ENODEV;
+    }
+
+    // The mount table keeps the path for as long as the mount lives
+    auto* path = new char[target_str.size() + 1];
+
+    memcpy(path, target_str.c_str(), target_str.size() + 1);
+
+    err = fs::mount(path, filesystem, source ? source_str.c_str() : nullptr);
+
+    if (err < 0) {
+        delete filesystem;
+        delete[] path;
     }
 
-    const std::size_t max_entries = count / sizeof(linux::linux_dirent64);
+    return err;
+}
+
+// Packs linux_dirent64 records straight into the user buffer, each as long
+// as its name needs rather than the full struct
+class DirentWriter final : public fs::DirContext {
+public:
+    std::uint8_t* __user buffer;
+    std::size_t count;
+    std::size_t written = 0;
+    bool full = false;
+    bool fault = false;
+
+    DirentWriter(void* __user buffer, std::size_t count)
+        : buffer{static_cast<std::uint8_t*>(buffer)}
+        , count{count}
+    {
+    }
+
+    bool emit(kstring_view name, std::uint64_t ino, fs::FileType type, std::size_t next) override
+    {
+        constexpr std::size_t header = offsetof(linux::linux_dirent64, d_name);
+        static_assert(sizeof(linux::linux_dirent64) >= header + fs::MAX_NAME + 1);
+
+        // Name and NUL, padded so the next record is 8 byte aligned
+        const std::size_t reclen = (header + name.length() + 1 + 7) & ~std::size_t{7};
+
+        if (written + reclen > count) {
+            full = true;
+            return false;
+        }
+
+        // Sized for the longest name, the padding goes out zeroed
+        std::uint8_t record[(header + fs::MAX_NAME + 1 + 7) & ~std::size_t{7}] = {};
+        auto* dirent = reinterpret_cast<linux::linux_dirent64*>(record);
+
+        dirent->d_ino = ino;
+        dirent->d_off = next;
+        dirent->d_reclen = static_cast<unsigned short>(reclen);
+        dirent->d_type = static_cast<std::uint8_t>(type);
+        memcpy(dirent->d_name, name.data(), name.length());
+
+        if (kcopy_to_user(buffer + written, record, reclen) < 0) {
+            fault = true;
+            return false;
+        }
+
+        written += reclen;
+
+        return true;
+    }
+};
+
+/// @brief list a directory from the fd's cursor, which is left after the
+///        last entry returned
+///
+/// @return bytes written, 0 at the end, or -EINVAL if the buffer can not
+///         hold the next entry
+///
+int sys_getdents64(int fd, void* __user buffer, unsigned int count)
+{
+    fs::FileDescriptor* desc = get_fd(fd);
+
+    if (!desc) {
+        return -EBADF;
+    }
+
+    DirentWriter writer{buffer, count};
+    writer.pos = desc->offset;
 
-    int inode = 1;
+    const int err = desc->inode->iterate(writer);
 
-    kvector<linux::linux_dirent64> dirents{};
+    if (err < 0) {
+        return err;
+    }
 
-    while (desc->offset < entries.size() && dirents.size() < max_entries) {
-        const auto& entry = entries[desc->offset];
-        linux::linux_dirent64 dirent{};
+    // Entries already copied out stay valid, the cursor only covers them
+    desc->offset = writer.pos;
+
+    if (writer.written == 0) {
+        if (writer.fault) {
+            return -EFAULT;
+        }
 
-        dirent.d_ino = inode++;
-        dirent.d_off = 0;
-        dirent.d_reclen = sizeof(linux::linux_dirent64);
-        dirent.d_type = static_cast<std::uint8_t>(entry.type);
+        if (writer.full) {
+            return -EINVAL;
+        }
+    }
 
-        strncpy(dirent.d_name, entry.name.c_str(), sizeof(dirent.d_name));
+    return static_cast<int>(writer.written);
+}
 
-        dirents.push_back(std::move(dirent));
+/// @brief read a user file position for the transfer syscalls
+///
+/// @return 0, -EFAULT, or -EINVAL for a negative position
+///
+static int get_pos(const std::int64_t* __user offset, std::size_t* pos)
+{
+    std::int64_t value;
 
-        desc->offset++;
+    if (arch::uaccess::get_user(value, offset) < 0) {
+        return -EFAULT;
     }
 
-    const std::size_t buffer_len = dirents.size() * sizeof(linux::linux_dirent64);
+    if (value < 0) {
+        return -EINVAL;
+    }
+
+    *pos = static_cast<std::size_t>(value);
+
+    return 0;
+}
 
-    kcopy_to_user(buffer, dirents.data(), buffer_len);
+/// @brief move data between two fds without a trip through user memory
+///
+/// An end given an explicit position is read or written there and keeps
+/// its own file position, the new position is stored back through the
+/// pointer instead
+///
+static long transfer_fds(int in_fd, std::int64_t* __user off_in, int out_fd, std::int64_t* __user off_out, std::size_t count)
+{
+    fs::FileDescriptor* in = get_fd(in_fd);
+    fs::FileDescriptor* out = get_fd(out_fd);
+
+    if (!in || !out) {
+        return -EBADF;
+    }
+
+    std::size_t in_pos = in->offset;
+    std::size_t out_pos = out->offset;
+
+    if (off_in != nullptr) {
+        if (const int err = get_pos(off_in, &in_pos); err < 0) {
+            return err;
+        }
+    }
+
+    if (off_out != nullptr) {
+        if (const int err = get_pos(off_out, &out_pos); err < 0) {
+            return err;
+        }
+    }
+
+    // Capped like Linux caps read()/write(), so the total always fits an int
+    if (count > MAX_RW_COUNT) {
+        count = MAX_RW_COUNT;
+    }
+
+    const std::size_t saved_in = in->offset;
+    const std::size_t saved_out = out->offset;
+
+    in->offset = in_pos;
+    out->offset = out_pos;
+
+    const long result = fs::transfer(in, out, count);
+
+    in_pos = in->offset;
+    out_pos = out->offset;
+
+    if (off_in != nullptr) {
+        in->offset = saved_in;
+    }
+
+    if (off_out != nullptr) {
+        out->offset = saved_out;
+    }
+
+    if (off_in != nullptr && arch::uaccess::put_user(static_cast<std::int64_t>(in_pos), off_in) < 0) {
+        return -EFAULT;
+    }
+
+    if (off_out != nullptr && arch::uaccess::put_user(static_cast<std::int64_t>(out_pos), off_out) < 0) {
+        return -EFAULT;
+    }
+
+    return result;
+}
+
+long sys_sendfile(int out_fd, int in_fd, std::int64_t* __user offset, std::size_t count)
+{
+    return transfer_fds(in_fd, offset, out_fd, nullptr, count);
+}
+
+/// @brief transfer between any two fds
+///
+/// Linux only splices to or from a pipe, here either end can be any file.
+/// The SPLICE_F_* flags are hints and are ignored
+///
+long sys_splice(int fd_in,
+                std::int64_t* __user off_in,
+                int fd_out,
+                std::int64_t* __user off_out,
+                std::size_t len,
+                unsigned int)
+{
+    return transfer_fds(fd_in, off_in, fd_out, off_out, len);
+}
+
+long sys_copy_file_range(int fd_in,
+                         std::int64_t* __user off_in,
+                         int fd_out,
+                         std::int64_t* __user off_out,
+                         std::size_t len,
+                         unsigned int flags)
+{
+    fs::FileDescriptor* in = get_fd(fd_in);
+    fs::FileDescriptor* out = get_fd(fd_out);
+
+    if (!in || !out) {
+        return -EBADF;
+    }
+
+    if (flags != 0) {
+        return -EINVAL;
+    }
+
+    if (in->inode->type == fs::FileType::DIRECTORY || out->inode->type == fs::FileType::DIRECTORY) {
+        return -EISDIR;
+    }
+
+    if (in->inode->type != fs::FileType::REGULAR || out->inode->type != fs::FileType::REGULAR) {
+        return -EINVAL;
+    }
+
+    // A range copied over itself would read back what it just wrote
+    if (in->inode == out->inode) {
+        std::size_t in_pos = in->offset;
+        std::size_t out_pos = out->offset;
+
+        if (off_in != nullptr) {
+            if (const int err = get_pos(off_in, &in_pos); err < 0) {
+                return err;
+            }
+        }
+
+        if (off_out != nullptr) {
+            if (const int err = get_pos(off_out, &out_pos); err < 0) {
+                return err;
+            }
+        }
+
+        if (in_pos < out_pos + len && out_pos < in_pos + len) {
+            return -EINVAL;
+        }
+    }
+
+    return transfer_fds(fd_in, off_in, fd_out, off_out, len);
+}
+
+
+/// @brief create a pipe, fds[0] is the read end and fds[1] the write end
+///
+/// @param flags O_NONBLOCK and/or O_CLOEXEC, for both ends
+///
+int sys_pipe2(int* __user fds, int flags)
+{
+    if ((flags & ~(fs::O_NONBLOCK | fs::O_CLOEXEC)) != 0) {
+        return -EINVAL;
+    }
+
+    fs::FileDescriptor* read_end;
+    fs::FileDescriptor* write_end;
+
+    fs::create_pipe(flags, &read_end, &write_end);
+
+    const int pair[2] = {install_fd(read_end, flags), install_fd(write_end, flags)};
+
+    if (pair[0] < 0 || pair[1] < 0) {
+        if (pair[0] >= 0) {
+            sys_close(pair[0]);
+        }
+
+        if (pair[1] >= 0) {
+            sys_close(pair[1]);
+        }
+
+        return -EMFILE;
+    }
+
+    if (arch::uaccess::copy_to_user(fds, pair, sizeof(pair)) < 0) {
+        sys_close(pair[0]);
+        sys_close(pair[1]);
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int sys_pipe(int* __user fds)
+{
+    return sys_pipe2(fds, 0);
+}
+
+/// @brief duplicate oldfd onto the lowest free fd
+///
+/// Both fds share the open file, offset and flags included
+///
+int sys_dup(int oldfd)
+{
+    fs::FileDescriptor* desc = get_fd(oldfd);
+
+    if (!desc) {
+        return -EBADF;
+    }
+
+    desc->get();
+
+    return install_fd(desc);
+}
+
+/// @brief make newfd refer to the same open file as oldfd
+///
+/// Whatever newfd referred to before is closed first
+///
+/// @param flags O_CLOEXEC to mark newfd close-on-exec, it is cleared otherwise
+///
+static int dup_to(int oldfd, int newfd, int flags)
+{
+    fs::FileDescriptor* desc = get_fd(oldfd);
+
+    if (!desc) {
+        return -EBADF;
+    }
+
+    if (newfd < 0 || newfd >= MAX_FDS) {
+        return -EBADF;
+    }
+
+    if (oldfd == newfd) {
+        return newfd;
+    }
+
+    kvector<fs::FileDescriptor*>& fds = arch::percpu::current_process()->files->fds;
+
+    if (static_cast<std::size_t>(newfd) >= fds.size()) {
+        fds.resize(newfd + 1);
+    }
+
+    fs::FileDescriptor* old = fds[newfd];
+
+    desc->get();
+    fds[newfd] = desc;
+    arch::percpu::current_process()->files->set_cloexec(newfd, flags & fs::O_CLOEXEC);
+
+    if (old != nullptr) {
+        old->put();
+    }
+
+    return newfd;
+}
+
+int sys_dup2(int oldfd, int newfd)
+{
+    return dup_to(oldfd, newfd, 0);
+}
+
+int sys_dup3(int oldfd, int newfd, int flags)
+{
+    if (oldfd == newfd || (flags & ~fs::O_CLOEXEC) != 0) {
+        return -EINVAL;
+    }
 
-    return buffer_len;
+    return dup_to(oldfd, newfd, flags);
 }
 
 }
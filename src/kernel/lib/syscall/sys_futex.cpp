@@ -0,0 +1,79 @@
+#include <arch.hpp>
+#include <memory/memory.hpp>
+#include <process/futex.hpp>
+#include <syscall/sys_futex.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace syscall {
+
+/// @brief convert a relative FUTEX_WAIT timeout to timer ticks (ms)
+///
+/// Rounded up, so a waiter never wakes before its timeout has passed
+///
+/// @return 0 on success, -EFAULT/-EINVAL for a bad timespec
+///
+static int timeout_to_ms(const futex_timespec* __user timeout, std::uint64_t* timeout_ms)
+{
+    if (timeout == nullptr) {
+        *timeout_ms = process::futex::NO_TIMEOUT;
+        return 0;
+    }
+
+    futex_timespec ts;
+
+    if (kcopy_from_user(&ts, timeout, sizeof(ts)) < 0) {
+        return -EFAULT;
+    }
+
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1'000'000'000) {
+        return -EINVAL;
+    }
+
+    *timeout_ms = static_cast<std::uint64_t>(ts.tv_sec) * 1000 + (ts.tv_nsec + 999'999) / 1'000'000;
+
+    return 0;
+}
+
+/// @brief fast userspace mutex operations, what musl builds pthreads on
+///
+/// Supports FUTEX_WAIT, FUTEX_WAKE, FUTEX_REQUEUE and FUTEX_CMP_REQUEUE,
+/// with or without FUTEX_PRIVATE_FLAG
+///
+long sys_futex(std::uint32_t* __user uaddr,
+               int op,
+               std::uint32_t val,
+               std::uintptr_t timeout_or_val2,
+               std::uint32_t* __user uaddr2,
+               std::uint32_t val3)
+{
+    const bool is_private = (op & FUTEX_PRIVATE_FLAG) != 0;
+    const int cmd = op & ~FUTEX_PRIVATE_FLAG;
+
+    // FUTEX_REQUEUE takes its requeue count where FUTEX_WAIT takes a timeout
+    const int val2 = static_cast<int>(timeout_or_val2);
+
+    switch (cmd) {
+    case FUTEX_WAIT: {
+        std::uint64_t timeout_ms;
+        const int err = timeout_to_ms(reinterpret_cast<const futex_timespec*>(timeout_or_val2), &timeout_ms);
+
+        if (err < 0) {
+            return err;
+        }
+
+        return process::futex::wait(uaddr, val, is_private, timeout_ms);
+    }
+    case FUTEX_WAKE:
+        return process::futex::wake(uaddr, static_cast<int>(val), is_private);
+    case FUTEX_REQUEUE:
+        return process::futex::requeue(uaddr, uaddr2, static_cast<int>(val), val2, is_private, nullptr);
+    case FUTEX_CMP_REQUEUE:
+        return process::futex::requeue(uaddr, uaddr2, static_cast<int>(val), val2, is_private, &val3);
+    default:
+        return -ENOSYS;
+    }
+}
+
+}
@@ -0,0 +1,455 @@
+#include <arch.hpp>
+#include <fs/fs.hpp>
+#include <linux/io_uring.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <syscall/sys_fd.hpp>
+#include <syscall/sys_io_uring.hpp>
+
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall {
+
+namespace {
+
+// Layout of the rings region userspace hands to io_uring_setup(), reported
+// back through io_uring_params so programs never hard code it. Heads and
+// tails get their own cache lines like on Linux, the producer of one ring is
+// the consumer of the other
+constexpr std::uint32_t SQ_HEAD = 0;
+constexpr std::uint32_t SQ_TAIL = 4;
+constexpr std::uint32_t CQ_HEAD = 64;
+constexpr std::uint32_t CQ_TAIL = 68;
+constexpr std::uint32_t SQ_RING_MASK = 128;
+constexpr std::uint32_t CQ_RING_MASK = 132;
+constexpr std::uint32_t SQ_RING_ENTRIES = 136;
+constexpr std::uint32_t CQ_RING_ENTRIES = 140;
+constexpr std::uint32_t SQ_DROPPED = 144;
+constexpr std::uint32_t SQ_FLAGS = 148;
+constexpr std::uint32_t CQ_FLAGS = 152;
+constexpr std::uint32_t CQ_OVERFLOW = 156;
+constexpr std::uint32_t CQES = 192;
+
+constexpr std::uint64_t CURRENT_POSITION = ~0ULL;
+
+// Every ring inode points here, which is how io_uring_enter() tells a ring
+// fd from any other file
+fs::MountPoint g_ring_mount{};
+
+/**
+ * @brief A submission/completion ring pair, owned by its fd.
+ *
+ * The rings live in user memory and are only ever touched through uaccess,
+ * so a program that unmaps or scribbles over them gets -EFAULT rather than
+ * taking the kernel down. Our own position in each ring is kept here, never
+ * read back from user memory.
+ */
+class IoRing final : public fs::Inode {
+public:
+    std::uint8_t* __user rings;
+    linux::io_uring_sqe* __user sqes;
+
+    std::uint32_t sq_entries;
+    std::uint32_t cq_entries;
+
+    std::uint32_t sq_head = 0; // Next sqe to consume
+    std::uint32_t cq_tail = 0; // Next cqe slot to fill
+    std::uint32_t dropped = 0; // Array entries naming a non-existent sqe
+
+    // Set while a thread is inside io_uring_enter() on this ring
+    bool busy = false;
+
+    IoRing(std::uint8_t* __user rings, linux::io_uring_sqe* __user sqes, std::uint32_t sq_entries, std::uint32_t cq_entries)
+        : fs::Inode{&g_ring_mount}
+        , rings{rings}
+        , sqes{sqes}
+        , sq_entries{sq_entries}
+        , cq_entries{cq_entries}
+    {
+        type = fs::FileType::NONE;
+        size = 0;
+    }
+
+    std::uint32_t* __user field(std::uint32_t offset) const
+    {
+        return reinterpret_cast<std::uint32_t*>(rings + offset);
+    }
+
+    std::uint32_t* __user sq_array() const
+    {
+        return reinterpret_cast<std::uint32_t*>(rings + CQES + cq_entries * sizeof(linux::io_uring_cqe));
+    }
+
+    linux::io_uring_cqe* __user cqes() const
+    {
+        return reinterpret_cast<linux::io_uring_cqe*>(rings + CQES);
+    }
+
+    int open(fs::FileDescriptor*, int) override { return 0; }
+    int read(fs::FileDescriptor*, void*, std::size_t) override { return -EINVAL; }
+    int write(fs::FileDescriptor*, const void*, std::size_t) override { return -EINVAL; }
+    int lseek(fs::FileDescriptor*, int, int) override { return -ESPIPE; }
+
+    int close(fs::FileDescriptor*) override
+    {
+        delete this;
+        return 0;
+    }
+
+    int stat(fs::Stat* stat) override
+    {
+        stat->type = type;
+        stat->size = 0;
+
+        return 0;
+    }
+};
+
+std::size_t rings_size(std::uint32_t sq_entries, std::uint32_t cq_entries)
+{
+    return CQES + cq_entries * sizeof(linux::io_uring_cqe) + sq_entries * sizeof(std::uint32_t);
+}
+
+/// @brief write the fixed part of the ring header, done once at setup
+///
+int init_rings(const IoRing* ring)
+{
+    struct {
+        std::uint32_t offset;
+        std::uint32_t value;
+    } const fields[] = {
+        {SQ_HEAD, 0},
+        {SQ_TAIL, 0},
+        {CQ_HEAD, 0},
+        {CQ_TAIL, 0},
+        {SQ_RING_MASK, ring->sq_entries - 1},
+        {CQ_RING_MASK, ring->cq_entries - 1},
+        {SQ_RING_ENTRIES, ring->sq_entries},
+        {CQ_RING_ENTRIES, ring->cq_entries},
+        {SQ_DROPPED, 0},
+        {SQ_FLAGS, 0},
+        {CQ_FLAGS, 0},
+        {CQ_OVERFLOW, 0},
+    };
+
+    for (const auto& f : fields) {
+        if (arch::uaccess::put_user(f.value, ring->field(f.offset)) < 0) {
+            return -EFAULT;
+        }
+    }
+
+    return 0;
+}
+
+/// @brief read or write at sqe->off, or at the file position if it is -1
+///
+int op_rw(const IoRing* ring, const linux::io_uring_sqe& sqe, bool is_write)
+{
+    fs::FileDescriptor* desc = get_fd(sqe.fd);
+
+    if (!desc || desc->inode == ring) {
+        return -EBADF;
+    }
+
+    void* buffer = reinterpret_cast<void*>(sqe.addr);
+
+    if (!arch::vmm::is_user_addr(sqe.addr, sqe.len)) {
+        return -EFAULT;
+    }
+
+    const std::size_t saved = desc->offset;
+
+    if (sqe.off != CURRENT_POSITION) {
+        desc->offset = sqe.off;
+    }
+
+    const int result = is_write ? desc->inode->write(desc, buffer, sqe.len) : desc->inode->read(desc, buffer, sqe.len);
+
+    // Positioned I/O leaves the file position alone, like pread/pwrite
+    if (sqe.off != CURRENT_POSITION) {
+        desc->offset = saved;
+    }
+
+    return result;
+}
+
+int op_openat(const linux::io_uring_sqe& sqe)
+{
+    // There are no per-directory lookups yet, paths resolve from the cwd
+    if (sqe.fd != linux::AT_FDCWD) {
+        return -EINVAL;
+    }
+
+    return sys_open(reinterpret_cast<const char*>(sqe.addr), static_cast<int>(sqe.op_flags));
+}
+
+int op_close(const IoRing* ring, const linux::io_uring_sqe& sqe)
+{
+    fs::FileDescriptor* desc = get_fd(sqe.fd);
+
+    // Closing the ring from inside itself would free it under our feet
+    if (!desc || desc->inode == ring) {
+        return -EBADF;
+    }
+
+    return sys_close(sqe.fd);
+}
+
+int op_fsync(const linux::io_uring_sqe& sqe)
+{
+    return sys_fsync(sqe.fd);
+}
+
+int execute(IoRing* ring, const linux::io_uring_sqe& sqe)
+{
+    if (sqe.flags != 0) {
+        return -EINVAL;
+    }
+
+    switch (sqe.opcode) {
+    case linux::IORING_OP_NOP:
+        return 0;
+    case linux::IORING_OP_READ:
+        return op_rw(ring, sqe, false);
+    case linux::IORING_OP_WRITE:
+        return op_rw(ring, sqe, true);
+    case linux::IORING_OP_OPENAT:
+        return op_openat(sqe);
+    case linux::IORING_OP_CLOSE:
+        return op_close(ring, sqe);
+    case linux::IORING_OP_FSYNC:
+        return op_fsync(sqe);
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief consume up to to_submit sqes, completing each one before the next
+///
+/// Stops early when the completion ring is full, so a completion is never
+/// dropped. The caller reaps and calls again
+///
+/// @return the number of sqes consumed, or -EFAULT if the rings are unusable
+///
+long submit(IoRing* ring, std::uint32_t to_submit)
+{
+    std::uint32_t sq_tail;
+    std::uint32_t cq_head;
+
+    if (arch::uaccess::get_user(sq_tail, ring->field(SQ_TAIL)) < 0
+        || arch::uaccess::get_user(cq_head, ring->field(CQ_HEAD)) < 0) {
+        return -EFAULT;
+    }
+
+    // Both are free running counters, so this is right across wraparound
+    const std::uint32_t queued = sq_tail - ring->sq_head;
+
+    if (queued > ring->sq_entries) {
+        return -EINVAL;
+    }
+
+    if (to_submit > queued) {
+        to_submit = queued;
+    }
+
+    long submitted = 0;
+
+    while (static_cast<std::uint32_t>(submitted) < to_submit) {
+        if (ring->cq_tail - cq_head >= ring->cq_entries) {
+            // Userspace may have reaped while we were working
+            if (arch::uaccess::get_user(cq_head, ring->field(CQ_HEAD)) < 0) {
+                return -EFAULT;
+            }
+
+            if (ring->cq_tail - cq_head >= ring->cq_entries) {
+                break;
+            }
+        }
+
+        std::uint32_t index;
+
+        if (arch::uaccess::get_user(index, ring->sq_array() + (ring->sq_head & (ring->sq_entries - 1))) < 0) {
+            return -EFAULT;
+        }
+
+        ring->sq_head++;
+        submitted++;
+
+        if (index >= ring->sq_entries) {
+            ring->dropped++;
+            arch::uaccess::put_user(ring->dropped, ring->field(SQ_DROPPED));
+            continue;
+        }
+
+        linux::io_uring_sqe sqe;
+
+        if (arch::uaccess::copy_from_user(&sqe, ring->sqes + index, sizeof(sqe)) < 0) {
+            return -EFAULT;
+        }
+
+        const linux::io_uring_cqe cqe = {
+            .user_data = sqe.user_data,
+            .res = execute(ring, sqe),
+            .flags = 0,
+        };
+
+        if (arch::uaccess::copy_to_user(ring->cqes() + (ring->cq_tail & (ring->cq_entries - 1)), &cqe, sizeof(cqe)) < 0) {
+            return -EFAULT;
+        }
+
+        // The cqe must be visible before the tail that publishes it. x86
+        // keeps stores in order, put_user() stops the compiler reordering
+        ring->cq_tail++;
+
+        if (arch::uaccess::put_user(ring->cq_tail, ring->field(CQ_TAIL)) < 0) {
+            return -EFAULT;
+        }
+    }
+
+    if (arch::uaccess::put_user(ring->sq_head, ring->field(SQ_HEAD)) < 0) {
+        return -EFAULT;
+    }
+
+    return submitted;
+}
+
+}
+
+/// @brief create a submission/completion ring pair
+///
+/// Only IORING_SETUP_NO_MMAP rings are supported: userspace allocates the
+/// sqe array (sq_off.user_addr) and the rings (cq_off.user_addr) itself,
+/// and the kernel reports the layout of the rings in sq_off/cq_off
+///
+/// @return the ring fd, or -EINVAL/-EFAULT
+///
+long sys_io_uring_setup(std::uint32_t entries, linux::io_uring_params* __user params)
+{
+    linux::io_uring_params p;
+
+    if (arch::uaccess::copy_from_user(&p, params, sizeof(p)) < 0) {
+        return -EFAULT;
+    }
+
+    constexpr std::uint32_t supported = linux::IORING_SETUP_CQSIZE | linux::IORING_SETUP_NO_MMAP;
+
+    if ((p.flags & ~supported) != 0 || (p.flags & linux::IORING_SETUP_NO_MMAP) == 0) {
+        return -EINVAL;
+    }
+
+    if (entries == 0 || entries > IORING_MAX_ENTRIES) {
+        return -EINVAL;
+    }
+
+    const std::uint32_t sq_entries = std::bit_ceil(entries);
+    std::uint32_t cq_entries = sq_entries * 2;
+
+    if (p.flags & linux::IORING_SETUP_CQSIZE) {
+        if (p.cq_entries < sq_entries || p.cq_entries > IORING_MAX_ENTRIES * 2) {
+            return -EINVAL;
+        }
+
+        cq_entries = std::bit_ceil(p.cq_entries);
+    }
+
+    const std::uintptr_t sqes = p.sq_off.user_addr;
+    const std::uintptr_t rings = p.cq_off.user_addr;
+
+    if (sqes % alignof(linux::io_uring_sqe) != 0 || rings % alignof(linux::io_uring_cqe) != 0) {
+        return -EINVAL;
+    }
+
+    if (!arch::vmm::is_user_addr(sqes, sq_entries * sizeof(linux::io_uring_sqe))
+        || !arch::vmm::is_user_addr(rings, rings_size(sq_entries, cq_entries))) {
+        return -EFAULT;
+    }
+
+    auto* ring = new IoRing{reinterpret_cast<std::uint8_t*>(rings),
+                            reinterpret_cast<linux::io_uring_sqe*>(sqes),
+                            sq_entries,
+                            cq_entries};
+
+    p.sq_entries = sq_entries;
+    p.cq_entries = cq_entries;
+    p.features = linux::IORING_FEAT_SINGLE_MMAP;
+    p.sq_off.head = SQ_HEAD;
+    p.sq_off.tail = SQ_TAIL;
+    p.sq_off.ring_mask = SQ_RING_MASK;
+    p.sq_off.ring_entries = SQ_RING_ENTRIES;
+    p.sq_off.flags = SQ_FLAGS;
+    p.sq_off.dropped = SQ_DROPPED;
+    p.sq_off.array = static_cast<std::uint32_t>(rings_size(0, cq_entries));
+    p.cq_off.head = CQ_HEAD;
+    p.cq_off.tail = CQ_TAIL;
+    p.cq_off.ring_mask = CQ_RING_MASK;
+    p.cq_off.ring_entries = CQ_RING_ENTRIES;
+    p.cq_off.overflow = CQ_OVERFLOW;
+    p.cq_off.cqes = CQES;
+    p.cq_off.flags = CQ_FLAGS;
+
+    if (init_rings(ring) < 0 || arch::uaccess::copy_to_user(params, &p, sizeof(p)) < 0) {
+        delete ring;
+        return -EFAULT;
+    }
+
+    auto* desc = new fs::FileDescriptor{};
+
+    desc->inode = ring;
+    desc->path = "io_uring";
+    desc->offset = 0;
+    desc->flags = fs::O_RDWR;
+
+    return install_fd(desc, fs::O_CLOEXEC);
+}
+
+/// @brief submit queued sqes and wait for completions
+///
+/// Operations run inline, one after the other, in the calling thread, so
+/// everything submitted has completed by the time this returns and
+/// min_complete never has to wait. sig is accepted for compatibility and
+/// ignored, there are no signals
+///
+/// @return the number of sqes consumed, or -errno
+///
+long sys_io_uring_enter(unsigned int fd,
+                        std::uint32_t to_submit,
+                        std::uint32_t,
+                        std::uint32_t flags,
+                        const void* __user,
+                        std::size_t)
+{
+    fs::FileDescriptor* desc = get_fd(static_cast<int>(fd));
+
+    if (!desc) {
+        return -EBADF;
+    }
+
+    if (desc->inode->mountpoint != &g_ring_mount) {
+        return -EOPNOTSUPP;
+    }
+
+    if ((flags & ~linux::IORING_ENTER_GETEVENTS) != 0) {
+        return -EINVAL;
+    }
+
+    auto* ring = static_cast<IoRing*>(desc->inode);
+
+    // Threads sharing the fd table may share a ring, but the kernel side
+    // positions are not safe to advance from two threads at once
+    if (__atomic_exchange_n(&ring->busy, true, __ATOMIC_ACQUIRE)) {
+        return -EBUSY;
+    }
+
+    const long submitted = submit(ring, to_submit);
+
+    __atomic_store_n(&ring->busy, false, __ATOMIC_RELEASE);
+
+    log::debugf<log::Subsystem::SYSCALL>("io_uring_enter fd = {} submitted = {}", fd, submitted);
+
+    return submitted;
+}
+
+}
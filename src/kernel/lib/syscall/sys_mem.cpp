@@ -1,8 +1,12 @@
 #include "log/log.hpp"
 #include <arch.hpp>
+#include <fs/fs.hpp>
 #include <process/process.hpp>
+#include <syscall/sys_fd.hpp>
 #include <syscall/sys_mem.hpp>
 
+#include <cerrno>
+
 namespace syscall {
 
 std::uintptr_t sys_brk(void* addr)
@@ -10,10 +14,10 @@ std::uintptr_t sys_brk(void* addr)
     auto* proc = arch::percpu::current_process();
 
     if (addr == nullptr) {
-        return proc->heap_break;
+        return proc->mm->heap_break;
     }
 
-    std::uintptr_t hb_start = proc->heap_break;
+    std::uintptr_t hb_start = proc->mm->heap_break;
     std::uintptr_t hb_end = reinterpret_cast<std::uintptr_t>(addr);
 
     if (hb_end <= hb_start) {
@@ -22,34 +26,145 @@ std::uintptr_t sys_brk(void* addr)
 
     std::uintptr_t size = hb_end - hb_start;
 
-    arch::vmm::map_pages(proc->pml4, hb_start, size, arch::vmm::PAGE_USER | arch::vmm::PAGE_WRITE);
-    proc->heap_break = hb_end;
+    arch::vmm::map_pages(proc->mm->pml4, hb_start, size, arch::vmm::PAGE_USER | arch::vmm::PAGE_WRITE);
+    proc->mm->heap_break = hb_end;
 
     return hb_end;
 }
 
-std::uintptr_t sys_mmap(void*, std::size_t length, int, int flags, int, std::size_t)
+static std::uintptr_t mmap_error(int err)
+{
+    return static_cast<std::uintptr_t>(static_cast<std::intptr_t>(err));
+}
+
+/// @brief map a file MAP_SHARED, the pages are the file's own frames so
+///        every mapping and read()/write() see the same data
+///
+static std::uintptr_t mmap_file(std::size_t length, int prot, int fd, std::size_t offset)
+{
+    fs::FileDescriptor* desc = get_fd(fd);
+
+    if (!desc) {
+        return mmap_error(-EBADF);
+    }
+
+    if (length == 0 || (offset & arch::vmm::PAGE_MASK) != 0) {
+        return mmap_error(-EINVAL);
+    }
+
+    if ((prot & linux::PROT_WRITE) && (desc->flags & fs::O_ACCMODE) == fs::O_RDONLY) {
+        return mmap_error(-EACCES);
+    }
+
+    fs::Inode* inode = desc->inode;
+    const int err = inode->map();
+
+    if (err < 0) {
+        return mmap_error(err);
+    }
+
+    auto* mm = arch::percpu::current_process()->mm;
+    const std::size_t num_pages = (length + arch::vmm::PAGE_SIZE - 1) / arch::vmm::PAGE_SIZE;
+    const std::size_t first_index = offset / arch::vmm::PAGE_SIZE;
+    const std::uintptr_t start = arch::vmm::reserve_heap_pages(&mm->uheap, num_pages);
+
+    int vmm_flags = arch::vmm::PAGE_USER | arch::vmm::PAGE_SHARED;
+
+    if (prot & linux::PROT_WRITE) {
+        vmm_flags |= arch::vmm::PAGE_WRITE;
+    }
+
+    for (std::size_t page = 0; page < num_pages; page++) {
+        std::uintptr_t phys = 0;
+        const int result = inode->map_page(first_index + page, &phys);
+
+        if (result < 0) {
+            if (page > 0) {
+                arch::vmm::unmap_mem_at(mm->pml4, start, page);
+            }
+
+            inode->unmap();
+
+            return mmap_error(result);
+        }
+
+        arch::vmm::map_frame(mm->pml4, start + page * arch::vmm::PAGE_SIZE, phys, vmm_flags);
+    }
+
+    mm->maps_lock.lock();
+    mm->file_maps.push_back({start, num_pages, inode});
+    mm->maps_lock.unlock();
+
+    return start;
+}
+
+std::uintptr_t sys_mmap(void*, std::size_t length, int prot, int flags, int fd, std::size_t offset)
 {
     if ((flags & linux::MAP_ANONYMOUS) == 0) {
-        log::warn("Invalid call to sys_mmap with flags = ", flags, ", only MAP_ANONYMOUS supported for now.");
+        if (flags & linux::MAP_SHARED) {
+            return mmap_file(length, prot, fd, offset);
+        }
+
+        log::warn<log::Subsystem::SYSCALL>(
+            "Invalid call to sys_mmap with flags = ",
+            flags,
+            ", only MAP_ANONYMOUS and MAP_SHARED files supported for now.");
         return static_cast<std::uintptr_t>(-1);
     }
 
     auto* proc = arch::percpu::current_process();
 
-    log::debug("sys mmap");
+    log::debug<log::Subsystem::SYSCALL>("sys mmap");
 
     int vmm_flags = arch::vmm::PAGE_WRITE | arch::vmm::PAGE_USER;
-    void* virt_addr = arch::vmm::map_heap_pages(proc->pml4, &proc->uheap, length, vmm_flags);
+    void* virt_addr = arch::vmm::map_heap_pages(proc->mm->pml4, &proc->mm->uheap, length, vmm_flags);
 
-    log::debugf("sys_mmap virt = {}", virt_addr);
+    log::debugf<log::Subsystem::SYSCALL>("sys_mmap virt = {}", virt_addr);
 
     return reinterpret_cast<std::uintptr_t>(virt_addr);
 }
 
-int sys_munmap(void*, std::size_t)
+/// mmap() maps every page read/write, so there is nothing to change yet. musl
+/// maps thread stacks PROT_NONE and then mprotect()s them, so this must succeed
+int sys_mprotect(void*, std::size_t, int)
 {
     return 0;
 }
 
+/// Only file mappings that lie entirely in the range are unmapped, anonymous
+/// memory stays until the process exits
+int sys_munmap(void* addr, std::size_t length)
+{
+    const auto start = reinterpret_cast<std::uintptr_t>(addr);
+
+    if ((start & arch::vmm::PAGE_MASK) != 0 || length == 0) {
+        return -EINVAL;
+    }
+
+    const std::uintptr_t end = start + ((length + arch::vmm::PAGE_SIZE - 1) & ~arch::vmm::PAGE_MASK);
+    auto* mm = arch::percpu::current_process()->mm;
+
+    mm->maps_lock.lock();
+
+    for (std::size_t i = 0; i < mm->file_maps.size();) {
+        const process::FileMapping mapping = mm->file_maps[i];
+
+        if (mapping.start < start || mapping.start + mapping.pages * arch::vmm::PAGE_SIZE > end) {
+            i++;
+            continue;
+        }
+
+        // The frames are PAGE_SHARED, unmapping leaves them to the file
+        arch::vmm::unmap_mem_at(mm->pml4, mapping.start, mapping.pages);
+        mapping.inode->unmap();
+
+        mm->file_maps[i] = mm->file_maps.back();
+        mm->file_maps.pop_back();
+    }
+
+    mm->maps_lock.unlock();
+
+    return 0;
+}
+
 }
@@ -0,0 +1,387 @@
+#include <arch.hpp>
+#include <containers/kvector.hpp>
+#include <fs/epoll.hpp>
+#include <fs/fs.hpp>
+#include <fs/poll.hpp>
+#include <linux/poll.hpp>
+#include <memory/memory.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <syscall/sys_fd.hpp>
+#include <syscall/sys_poll.hpp>
+#include <timer/timer.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall {
+
+/// @brief poll every file once, hooking table onto their queues if given
+///
+/// @return the number of entries with revents set
+///
+static int poll_files(kvector<linux::pollfd>& fds, kvector<fs::FileDescriptor*>& files, fs::PollTable* table)
+{
+    int count = 0;
+
+    for (std::size_t i = 0; i < fds.size(); i++) {
+        fs::FileDescriptor* file = files[i];
+        std::uint32_t events = 0;
+
+        if (fds[i].fd < 0) {
+            events = 0;
+        } else if (file == nullptr) {
+            events = fs::POLLNVAL;
+        } else {
+            const std::uint32_t wanted = static_cast<std::uint16_t>(fds[i].events) | fs::POLL_ALWAYS;
+
+            events = file->inode->poll(file, table) & wanted;
+        }
+
+        fds[i].revents = static_cast<short>(events);
+
+        if (events) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/// @brief wait until one of fds is ready, the core of poll, ppoll and select
+///
+/// The caller is registered on every file's wait queues and sleeps until
+/// any of them is woken, then everything is polled again
+///
+/// @param timeout_ms 0 to not wait at all, negative to wait forever
+///
+/// @return the number of entries with revents set, or -EINTR if the thread
+///         group is killed
+///
+static int do_poll(kvector<linux::pollfd>& fds, long timeout_ms)
+{
+    process::Process* current = arch::percpu::current_process();
+    kvector<fs::FileDescriptor*> files;
+
+    // Referenced while waiting, so another thread closing one can't free it
+    for (const linux::pollfd& pfd : fds) {
+        fs::FileDescriptor* file = pfd.fd >= 0 ? get_fd(pfd.fd) : nullptr;
+
+        if (file) {
+            file->get();
+        }
+
+        files.push_back(file);
+    }
+
+    const std::uint64_t deadline = timer::get_ticks() + (timeout_ms > 0 ? timeout_ms : 0);
+    fs::PollTable table;
+    int count;
+
+    current->poll_table = &table;
+
+    while (true) {
+        // Any wakeup from here on is kept for the yield below
+        current->wake_pending = false;
+
+        count = poll_files(fds, files, timeout_ms != 0 ? &table : nullptr);
+
+        if (count > 0 || timeout_ms == 0) {
+            break;
+        }
+
+        const std::uint64_t now = timer::get_ticks();
+
+        if (timeout_ms > 0 && now >= deadline) {
+            break;
+        }
+
+        auto* sched = scheduler::get_scheduler();
+        const int err = timeout_ms > 0 ? sched->yield_killable_timeout(process::WaitReason::WAIT_QUEUE, deadline - now)
+                                       : sched->yield_killable(process::WaitReason::WAIT_QUEUE);
+
+        table.clear();
+
+        if (err < 0) {
+            count = err;
+            break;
+        }
+    }
+
+    table.clear();
+    current->poll_table = nullptr;
+    current->wake_pending = false;
+
+    for (fs::FileDescriptor* file : files) {
+        if (file) {
+            file->put();
+        }
+    }
+
+    return count;
+}
+
+/// @brief poll() on an array of pollfds in user memory
+///
+static int poll_user(linux::pollfd* __user ufds, unsigned int nfds, long timeout_ms)
+{
+    if (nfds > MAX_FDS) {
+        return -EINVAL;
+    }
+
+    kvector<linux::pollfd> fds(nfds);
+
+    if (arch::uaccess::copy_array_from_user(fds.data(), ufds, nfds) < 0) {
+        return -EFAULT;
+    }
+
+    const int count = do_poll(fds, timeout_ms);
+
+    if (arch::uaccess::copy_to_user(ufds, fds.data(), nfds * sizeof(linux::pollfd)) < 0) {
+        return -EFAULT;
+    }
+
+    return count;
+}
+
+int sys_poll(linux::pollfd* __user fds, unsigned int nfds, int timeout_ms)
+{
+    return poll_user(fds, nfds, timeout_ms);
+}
+
+int sys_ppoll(linux::pollfd* __user fds,
+              unsigned int nfds,
+              const kernel_timespec* __user timeout,
+              const void* __user,
+              std::size_t)
+{
+    long timeout_ms = -1;
+
+    if (timeout != nullptr) {
+        kernel_timespec ts;
+
+        if (arch::uaccess::copy_from_user(&ts, timeout, sizeof(ts)) < 0) {
+            return -EFAULT;
+        }
+
+        if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1'000'000'000) {
+            return -EINVAL;
+        }
+
+        // Rounded up, so it never returns before the timeout has passed
+        timeout_ms = ts.tv_sec * 1000 + (ts.tv_nsec + 999'999) / 1'000'000;
+    }
+
+    return poll_user(fds, nfds, timeout_ms);
+}
+
+static bool fd_isset(const linux::fd_set& set, int fd)
+{
+    return set.bits[fd / 64] & (1UL << (fd % 64));
+}
+
+static void fd_set_bit(linux::fd_set& set, int fd)
+{
+    set.bits[fd / 64] |= 1UL << (fd % 64);
+}
+
+/// @brief select() as a poll() over the fds set in any of the three sets
+///
+/// The timeout is not updated with the time left, POSIX allows either
+///
+int sys_select(int nfds,
+               linux::fd_set* __user readfds,
+               linux::fd_set* __user writefds,
+               linux::fd_set* __user exceptfds,
+               kernel_timeval* __user timeout)
+{
+    if (nfds < 0 || nfds > linux::FD_SETSIZE) {
+        return -EINVAL;
+    }
+
+    linux::fd_set* __user user_sets[3] = {readfds, writefds, exceptfds};
+    linux::fd_set sets[3] = {};
+
+    // Only the words covering the first nfds bits are read and written back
+    const std::size_t set_bytes = (nfds + 63) / 64 * sizeof(std::uint64_t);
+
+    for (int i = 0; i < 3; i++) {
+        if (user_sets[i] && arch::uaccess::copy_from_user(&sets[i], user_sets[i], set_bytes) < 0) {
+            return -EFAULT;
+        }
+    }
+
+    long timeout_ms = -1;
+
+    if (timeout != nullptr) {
+        kernel_timeval tv;
+
+        if (arch::uaccess::copy_from_user(&tv, timeout, sizeof(tv)) < 0) {
+            return -EFAULT;
+        }
+
+        if (tv.tv_sec < 0 || tv.tv_usec < 0 || tv.tv_usec >= 1'000'000) {
+            return -EINVAL;
+        }
+
+        timeout_ms = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+    }
+
+    kvector<linux::pollfd> fds;
+
+    for (int fd = 0; fd < nfds; fd++) {
+        short events = 0;
+
+        if (fd_isset(sets[0], fd)) {
+            events |= fs::POLLIN;
+        }
+
+        if (fd_isset(sets[1], fd)) {
+            events |= fs::POLLOUT;
+        }
+
+        if (fd_isset(sets[2], fd)) {
+            events |= fs::POLLPRI;
+        }
+
+        if (events == 0) {
+            continue;
+        }
+
+        if (get_fd(fd) == nullptr) {
+            return -EBADF;
+        }
+
+        fds.push_back(linux::pollfd{fd, events, 0});
+    }
+
+    do_poll(fds, timeout_ms);
+
+    linux::fd_set results[3] = {};
+    int count = 0;
+
+    for (const linux::pollfd& pfd : fds) {
+        const std::uint32_t revents = static_cast<std::uint16_t>(pfd.revents);
+
+        if ((pfd.events & fs::POLLIN) && (revents & (fs::POLLIN | fs::POLLHUP | fs::POLLERR))) {
+            fd_set_bit(results[0], pfd.fd);
+            count++;
+        }
+
+        if ((pfd.events & fs::POLLOUT) && (revents & (fs::POLLOUT | fs::POLLERR))) {
+            fd_set_bit(results[1], pfd.fd);
+            count++;
+        }
+
+        if ((pfd.events & fs::POLLPRI) && (revents & fs::POLLPRI)) {
+            fd_set_bit(results[2], pfd.fd);
+            count++;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (user_sets[i] && arch::uaccess::copy_to_user(user_sets[i], &results[i], set_bytes) < 0) {
+            return -EFAULT;
+        }
+    }
+
+    return count;
+}
+
+int sys_epoll_create(int size)
+{
+    // Only a hint since Linux 2.6.8, but still has to be positive
+    if (size <= 0) {
+        return -EINVAL;
+    }
+
+    return sys_epoll_create1(0);
+}
+
+/// @brief create an epoll instance
+///
+/// @param flags EPOLL_CLOEXEC, the same bit as O_CLOEXEC
+///
+int sys_epoll_create1(int flags)
+{
+    if (flags & ~linux::EPOLL_CLOEXEC) {
+        return -EINVAL;
+    }
+
+    return install_fd(fs::create_epoll(), flags);
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, linux::epoll_event* __user event)
+{
+    fs::FileDescriptor* ep_file = get_fd(epfd);
+    fs::FileDescriptor* file = get_fd(fd);
+
+    if (!ep_file || !file) {
+        return -EBADF;
+    }
+
+    fs::EpollInode* epoll = fs::to_epoll(ep_file);
+
+    if (epoll == nullptr || epfd == fd) {
+        return -EINVAL;
+    }
+
+    linux::epoll_event ev{};
+
+    // DEL ignores the event, it may even be null
+    if (op != linux::EPOLL_CTL_DEL && arch::uaccess::copy_from_user(&ev, event, sizeof(ev)) < 0) {
+        return -EFAULT;
+    }
+
+    return epoll->ctl(op, fd, file, ev.events, ev.data);
+}
+
+int sys_epoll_wait(int epfd, linux::epoll_event* __user events, int max_events, int timeout_ms)
+{
+    if (max_events <= 0) {
+        return -EINVAL;
+    }
+
+    fs::FileDescriptor* ep_file = get_fd(epfd);
+
+    if (!ep_file) {
+        return -EBADF;
+    }
+
+    fs::EpollInode* epoll = fs::to_epoll(ep_file);
+
+    if (epoll == nullptr) {
+        return -EINVAL;
+    }
+
+    // Bounds the kernel buffer, any further ready items are left for the
+    // next call
+    if (max_events > MAX_FDS) {
+        max_events = MAX_FDS;
+    }
+
+    kvector<linux::epoll_event> ready(max_events);
+
+    ep_file->get();
+    const int count = epoll->wait(ready.data(), max_events, timeout_ms);
+    ep_file->put();
+
+    if (arch::uaccess::copy_to_user(events, ready.data(), count * sizeof(linux::epoll_event)) < 0) {
+        return -EFAULT;
+    }
+
+    return count;
+}
+
+int sys_epoll_pwait(int epfd,
+                    linux::epoll_event* __user events,
+                    int max_events,
+                    int timeout_ms,
+                    const void* __user,
+                    std::size_t)
+{
+    return sys_epoll_wait(epfd, events, max_events, timeout_ms);
+}
+
+}
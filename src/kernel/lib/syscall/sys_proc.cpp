@@ -2,19 +2,92 @@
 #include <fs/fs.hpp>
 #include <kassert/kassert.hpp>
 #include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <process/futex.hpp>
 #include <process/process.hpp>
 #include <scheduler/scheduler.hpp>
 #include <syscall/sys_proc.hpp>
 
+#include <cerrno>
 #include <cstdint>
 
 namespace syscall {
 
+// Bounds on what execve() copies into the kernel heap
+constexpr std::size_t MAX_ARG_STRINGS = 4096;
+constexpr std::size_t MAX_ARG_STRLEN = 32 * 4096;
+
 int sys_getpid()
 {
     auto* proc = arch::percpu::current_process();
 
-    return proc->pid;
+    return proc->tgid;
+}
+
+static bool valid_tid_ptr(const int* __user ptr)
+{
+    return ptr != nullptr && arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(ptr), sizeof(int));
+}
+
+/// @brief create a thread or process, see process::Process::clone()
+///
+/// The argument order is the x86_64 one: flags, stack, parent_tid, child_tid, tls
+///
+int sys_clone(arch::trap::SyscallFrame* syscall_frame,
+    std::uint64_t flags,
+    std::uintptr_t stack,
+    int* __user parent_tid,
+    int* __user child_tid,
+    std::uintptr_t tls)
+{
+    // A thread can only exist inside the address space of its group
+    if ((flags & process::CLONE_THREAD) && !(flags & process::CLONE_VM)) {
+        return -EINVAL;
+    }
+
+    if ((flags & process::CLONE_PARENT_SETTID) && !valid_tid_ptr(parent_tid)) {
+        return -EFAULT;
+    }
+
+    if ((flags & (process::CLONE_CHILD_SETTID | process::CLONE_CHILD_CLEARTID)) && !valid_tid_ptr(child_tid)) {
+        return -EFAULT;
+    }
+
+    if (stack != 0 && !arch::vmm::is_user_addr(stack, 1)) {
+        return -EFAULT;
+    }
+
+    process::Process* current = arch::percpu::current_process();
+    process::Process* created = current->clone(syscall_frame, flags, stack, tls);
+
+    kassert_not_null(created);
+
+    if (flags & process::CLONE_CHILD_CLEARTID) {
+        created->tidptr = child_tid;
+    }
+
+    // Both were checked above, a fault here leaves the word unset like Linux does
+    if (flags & process::CLONE_PARENT_SETTID) {
+        arch::uaccess::put_user(created->pid, parent_tid);
+    }
+
+    // child_tid lives in the child's address space, which is only the
+    // current one when CLONE_VM is set
+    if (flags & process::CLONE_CHILD_SETTID) {
+        arch::vmm::switch_pml4(created->mm->pml4);
+        arch::uaccess::put_user(created->pid, child_tid);
+        arch::vmm::switch_pml4(current->mm->pml4);
+    }
+
+    scheduler::get_scheduler()->add_process(created);
+
+    // A group exit that came in since the caller was copied could not see
+    // the new thread yet
+    if (current->kill_pending && (flags & process::CLONE_THREAD)) {
+        scheduler::get_scheduler()->kill_other_threads(current, current->exit_status);
+    }
+
+    return created->pid;
 }
 
 int sys_fork(arch::trap::SyscallFrame* syscall_frame)
@@ -29,13 +102,67 @@ int sys_fork(arch::trap::SyscallFrame* syscall_frame)
     return created->pid;
 }
 
-int sys_execve(const char* path, char* argv[], char* envp[])
+/// @brief copy a NULL terminated user array of strings, e.g. argv
+///
+/// @return 0, -EFAULT for a bad pointer, -E2BIG when there are too many or
+///         too long strings
+///
+static int copy_strings(char* const __user* array, kvector<kstring>& out)
 {
-    kstring path_str = kstring::from_userspace(path);
+    if (array == nullptr) {
+        return 0;
+    }
+
+    for (std::size_t i = 0;; i++) {
+        if (i == MAX_ARG_STRINGS) {
+            return -E2BIG;
+        }
+
+        char* str;
+
+        if (arch::uaccess::get_user(str, array + i) < 0) {
+            return -EFAULT;
+        }
+
+        if (str == nullptr) {
+            return 0;
+        }
+
+        kstring arg;
+        const int err = kstring::from_user(str, MAX_ARG_STRLEN, arg);
+
+        if (err < 0) {
+            return err == -ENAMETOOLONG ? -E2BIG : err;
+        }
+
+        out.push_back(std::move(arg));
+    }
+}
+
+int sys_execve(const char* __user path, char* const __user argv[], char* const __user envp[])
+{
+    kstring path_str;
+    kvector<kstring> argv_strs;
+    kvector<kstring> envp_strs;
+
+    int err = kstring::from_user(path, fs::MAX_PATH - 1, path_str);
+
+    if (err == 0) {
+        err = copy_strings(argv, argv_strs);
+    }
+
+    if (err == 0) {
+        err = copy_strings(envp, envp_strs);
+    }
+
+    if (err < 0) {
+        return err;
+    }
+
     fs::FileDescriptor* fd = fs::open(path_str, 0);
 
     if (!fd) {
-        log::errorf("sys_execve failed to open file at {}", path_str);
+        log::errorf<log::Subsystem::SYSCALL>("sys_execve failed to open file at {}", path_str);
         return -1;
     }
 
@@ -43,34 +170,111 @@ int sys_execve(const char* path, char* argv[], char* envp[])
     auto* data = new std::uint8_t[size];
 
     fd->inode->read(fd, data, size);
+    fd->put();
 
     process::Process* current = arch::percpu::current_process();
 
-    current->exec_elf64(data, size, argv, envp);
+    // Only the group leader can replace the process image for now, a thread
+    // would have to take over the leader's pid first
+    if (current->is_thread()) {
+        delete[] data;
+        return -EINVAL;
+    }
+
+    // The other threads still use the address space and the files until
+    // they are gone
+    auto* sched = scheduler::get_scheduler();
+
+    sched->kill_other_threads(current, 0);
+
+    if (sched->wait_other_threads(current) < 0) {
+        delete[] data;
+        return -EINTR;
+    }
+
+    current->files->close_on_exec();
+
+    current->exec_elf64(data, size, argv_strs, envp_strs);
 
     scheduler::get_scheduler()->yield_new_process();
 }
 
 int sys_vfork()
 {
-    log::warn("sys_vfork not implemented");
+    log::warn<log::Subsystem::SYSCALL>("sys_vfork not implemented");
     return -1;
 }
 
 int sys_wait4(int pid, int*, int, void*)
 {
-    log::debugf("parent pid={} waiting on child pid={}", arch::percpu::current_process()->pid, pid);
+    log::debugf<log::Subsystem::SYSCALL>(
+        "parent pid={} waiting on child pid={}",
+        arch::percpu::current_process()->pid,
+        pid);
 
     return scheduler::get_scheduler()->yield_to_child(pid);
 }
 
+/// @brief CLONE_CHILD_CLEARTID: tell pthread_join() that this thread is gone
+///
+static void clear_child_tid(process::Process* proc)
+{
+    if (!valid_tid_ptr(proc->tidptr)) {
+        return;
+    }
+
+    arch::uaccess::put_user(0, proc->tidptr);
+
+    // pthread_join() sleeps on this word, it may have used either kind of futex
+    auto* word = reinterpret_cast<std::uint32_t*>(proc->tidptr);
+    process::futex::wake(word, 1, true);
+    process::futex::wake(word, 1, false);
+
+    proc->tidptr = nullptr;
+}
+
+/// @brief terminate the calling task
+///
+/// A thread disappears immediately, nobody wait()s for it. The group leader
+/// becomes a ZOMBIE until its parent collects the exit status, which can
+/// not happen before the last of its threads has exited too.
+///
 int sys_exit(int status)
 {
     auto* proc = arch::percpu::current_process();
 
     proc->exit_status = status;
 
+    clear_child_tid(proc);
+
+    if (proc->is_thread()) {
+        scheduler::get_scheduler()->yield_dead();
+    }
+
     scheduler::get_scheduler()->yield_zombie();
 }
 
+/// @brief terminate every thread of the calling process
+///
+/// The others exit as soon as they are back on their way to user mode, see
+/// Scheduler::kill_other_threads()
+///
+int sys_exit_group(int status)
+{
+    auto* proc = arch::percpu::current_process();
+
+    sys_exit(scheduler::get_scheduler()->kill_other_threads(proc, status));
+}
+
+/// @brief exit a task whose thread group was killed by another task's
+///        exit_group() or execve()
+///
+/// Called on the way back to user mode, where the task has unwound its
+/// syscall and holds nothing in the kernel anymore
+///
+void exit_killed()
+{
+    sys_exit(arch::percpu::current_process()->exit_status);
+}
+
 }
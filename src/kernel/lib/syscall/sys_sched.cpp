@@ -0,0 +1,226 @@
+#include <arch.hpp>
+#include <memory/memory.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <syscall/sys_sched.hpp>
+
+#include <cerrno>
+
+namespace syscall {
+
+constexpr int NICE_MIN = -20;
+constexpr int NICE_MAX = 19;
+
+/// @brief resolve the `who` argument of get/setpriority to a pid
+///
+/// Only PRIO_PROCESS is supported, there are no process groups or users yet
+///
+static int priority_target(int which, int who)
+{
+    if (which != PRIO_PROCESS || who < 0) {
+        return -EINVAL;
+    }
+
+    if (who == 0) {
+        return arch::percpu::current_process()->pid;
+    }
+
+    return who;
+}
+
+/// @brief get the nice value of a process
+///
+/// Like Linux, the raw syscall returns 20 - nice (a value in [1, 40]) so that
+/// a successful result can never be mistaken for an error; libc undoes this
+///
+int sys_getpriority(int which, int who)
+{
+    const int pid = priority_target(which, who);
+
+    if (pid < 0) {
+        return pid;
+    }
+
+    int nice;
+
+    if (!scheduler::get_scheduler()->get_nice(pid, &nice)) {
+        return -ESRCH;
+    }
+
+    return 20 - nice;
+}
+
+/// @brief set the nice value of a process, this is also how libc implements nice()
+///
+int sys_setpriority(int which, int who, int prio)
+{
+    const int pid = priority_target(which, who);
+
+    if (pid < 0) {
+        return pid;
+    }
+
+    if (prio < NICE_MIN) {
+        prio = NICE_MIN;
+    } else if (prio > NICE_MAX) {
+        prio = NICE_MAX;
+    }
+
+    if (!scheduler::get_scheduler()->set_nice(pid, prio)) {
+        return -ESRCH;
+    }
+
+    return 0;
+}
+
+/// @brief resolve a sched_* pid argument, 0 means the calling process
+///
+static int sched_target(int pid)
+{
+    if (pid < 0) {
+        return -EINVAL;
+    }
+
+    return pid == 0 ? arch::percpu::current_process()->pid : pid;
+}
+
+static bool valid_param(const sched_param* __user param)
+{
+    return param != nullptr && arch::vmm::is_user_addr(reinterpret_cast<std::uintptr_t>(param), sizeof(sched_param));
+}
+
+/// @brief translate a user SCHED_* constant
+///
+/// @return false for policies we do not implement (SCHED_BATCH, SCHED_IDLE, ...)
+///
+static bool to_policy(int policy, process::SchedPolicy* out)
+{
+    switch (policy) {
+    case SCHED_OTHER:
+        *out = process::SchedPolicy::NORMAL;
+        return true;
+    case SCHED_FIFO:
+        *out = process::SchedPolicy::FIFO;
+        return true;
+    case SCHED_RR:
+        *out = process::SchedPolicy::RR;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// @brief change the scheduling policy and real-time priority of a process
+///
+int sys_sched_setscheduler(int pid, int policy, const sched_param* __user param)
+{
+    process::SchedPolicy sched_policy;
+
+    pid = sched_target(pid);
+
+    if (pid < 0 || !valid_param(param) || !to_policy(policy, &sched_policy)) {
+        return -EINVAL;
+    }
+
+    sched_param kparam;
+
+    if (kcopy_from_user(&kparam, param, sizeof(kparam)) < 0) {
+        return -EFAULT;
+    }
+
+    return scheduler::get_scheduler()->set_policy(pid, sched_policy, kparam.sched_priority);
+}
+
+/// @brief change only the real-time priority of a process, keeping its policy
+///
+int sys_sched_setparam(int pid, const sched_param* __user param)
+{
+    process::SchedPolicy policy;
+    int rt_priority;
+
+    pid = sched_target(pid);
+
+    if (pid < 0 || !valid_param(param)) {
+        return -EINVAL;
+    }
+
+    const int result = scheduler::get_scheduler()->get_policy(pid, &policy, &rt_priority);
+
+    if (result < 0) {
+        return result;
+    }
+
+    sched_param kparam;
+
+    if (kcopy_from_user(&kparam, param, sizeof(kparam)) < 0) {
+        return -EFAULT;
+    }
+
+    return scheduler::get_scheduler()->set_policy(pid, policy, kparam.sched_priority);
+}
+
+int sys_sched_getparam(int pid, sched_param* __user param)
+{
+    process::SchedPolicy policy;
+    int rt_priority;
+
+    pid = sched_target(pid);
+
+    if (pid < 0 || !valid_param(param)) {
+        return -EINVAL;
+    }
+
+    const int result = scheduler::get_scheduler()->get_policy(pid, &policy, &rt_priority);
+
+    if (result < 0) {
+        return result;
+    }
+
+    sched_param kparam{rt_priority};
+
+    return kcopy_to_user(param, &kparam, sizeof(kparam));
+}
+
+int sys_sched_getscheduler(int pid)
+{
+    process::SchedPolicy policy;
+    int rt_priority;
+
+    pid = sched_target(pid);
+
+    if (pid < 0) {
+        return -EINVAL;
+    }
+
+    const int result = scheduler::get_scheduler()->get_policy(pid, &policy, &rt_priority);
+
+    if (result < 0) {
+        return result;
+    }
+
+    return static_cast<int>(policy);
+}
+
+int sys_sched_get_priority_max(int policy)
+{
+    process::SchedPolicy sched_policy;
+
+    if (!to_policy(policy, &sched_policy)) {
+        return -EINVAL;
+    }
+
+    return sched_policy == process::SchedPolicy::NORMAL ? 0 : scheduler::RT_PRIORITY_MAX;
+}
+
+int sys_sched_get_priority_min(int policy)
+{
+    process::SchedPolicy sched_policy;
+
+    if (!to_policy(policy, &sched_policy)) {
+        return -EINVAL;
+    }
+
+    return sched_policy == process::SchedPolicy::NORMAL ? 0 : scheduler::RT_PRIORITY_MIN;
+}
+
+}
@@ -11,4 +11,9 @@ long sys_set_tid_address(int* tidptr)
 
     return proc->pid;
 }
+
+long sys_gettid()
+{
+    return arch::percpu::current_process()->pid;
+}
 }
@@ -0,0 +1,91 @@
+#include <arch.hpp>
+#include <memory/memory.hpp>
+#include <syscall/sys_time.hpp>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace syscall {
+
+constexpr std::uint64_t NSEC_PER_SEC = 1'000'000'000;
+
+/// @brief read a clock
+///
+/// @return 0 on success, -EINVAL for an unsupported clock, -EFAULT for a bad pointer
+///
+int sys_clock_gettime(int clock, kernel_timespec* __user ts)
+{
+    std::uint64_t ns;
+    const int err = arch::vdso::clock_gettime_ns(clock, &ns);
+
+    if (err < 0) {
+        return err;
+    }
+
+    const kernel_timespec result{
+        .tv_sec = static_cast<long>(ns / NSEC_PER_SEC),
+        .tv_nsec = static_cast<long>(ns % NSEC_PER_SEC)};
+
+    return kcopy_to_user(ts, &result, sizeof(result));
+}
+
+/// @brief set the wall clock, only CLOCK_REALTIME can be set
+///
+int sys_clock_settime(int clock, const kernel_timespec* __user ts)
+{
+    if (clock != CLOCK_REALTIME) {
+        return -EINVAL;
+    }
+
+    kernel_timespec value;
+
+    if (kcopy_from_user(&value, ts, sizeof(value)) < 0) {
+        return -EFAULT;
+    }
+
+    if (value.tv_sec < 0 || value.tv_nsec < 0 || value.tv_nsec >= static_cast<long>(NSEC_PER_SEC)) {
+        return -EINVAL;
+    }
+
+    arch::vdso::set_realtime_ns(static_cast<std::uint64_t>(value.tv_sec) * NSEC_PER_SEC + value.tv_nsec);
+
+    return 0;
+}
+
+/// @brief CLOCK_REALTIME in microseconds, the timezone is ignored (always UTC)
+///
+int sys_gettimeofday(kernel_timeval* __user tv, void* __user tz)
+{
+    (void)tz;
+
+    if (tv == nullptr) {
+        return 0;
+    }
+
+    std::uint64_t ns;
+    arch::vdso::clock_gettime_ns(CLOCK_REALTIME, &ns);
+
+    const kernel_timeval result{
+        .tv_sec = static_cast<long>(ns / NSEC_PER_SEC),
+        .tv_usec = static_cast<long>(ns % NSEC_PER_SEC / 1000)};
+
+    return kcopy_to_user(tv, &result, sizeof(result));
+}
+
+/// @brief seconds since the UNIX epoch, also stored in *t if t is not null
+///
+long sys_time(long* __user t)
+{
+    std::uint64_t ns;
+    arch::vdso::clock_gettime_ns(CLOCK_REALTIME, &ns);
+
+    const long secs = static_cast<long>(ns / NSEC_PER_SEC);
+
+    if (t != nullptr && arch::uaccess::put_user(secs, t) < 0) {
+        return -EFAULT;
+    }
+
+    return secs;
+}
+
+}
@@ -0,0 +1,176 @@
+#include <arch.hpp>
+#include <fmt/fmt.hpp>
+#include <syscall/syscall_stats.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace syscall::stats {
+
+static tunable::Tunable<std::uint32_t> g_enabled{
+    "syscall.stats", 1, 0, 1, "count calls, errors and latency per syscall (/proc/syscalls)"};
+
+// Highest value of a negative errno, anything in [-MAX_ERRNO, -1] is an error
+constexpr std::int64_t MAX_ERRNO = 4095;
+
+constexpr std::size_t NAME_WIDTH = 24;
+constexpr std::size_t COLUMN_WIDTH = 12;
+
+static void add(std::uint64_t* counter, std::uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static std::size_t bucket_of(std::uint64_t ns)
+{
+    if (ns == 0) {
+        return 0;
+    }
+
+    const std::size_t bucket = 63 - __builtin_clzll(ns);
+
+    return bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1;
+}
+
+static std::uint64_t cycles_to_ns(std::uint64_t cycles)
+{
+    static std::uint64_t tsc_mhz = 0;
+
+    if (tsc_mhz == 0) {
+        tsc_mhz = arch::drivers::tsc::get_tsc_freq() / 1'000'000;
+    }
+
+    return cycles * 1000 / tsc_mhz;
+}
+
+std::uint64_t begin(Counters& counters)
+{
+    if (g_enabled.value() == 0) {
+        return 0;
+    }
+
+    add(&counters.calls, 1);
+
+    return arch::drivers::tsc::get_ticks();
+}
+
+void end(Counters& counters, std::uint64_t start, std::uint64_t result)
+{
+    if (start == 0) {
+        return;
+    }
+
+    const std::uint64_t ns = cycles_to_ns(arch::drivers::tsc::get_ticks() - start);
+    const auto value = static_cast<std::int64_t>(result);
+
+    if (value < 0 && value >= -MAX_ERRNO) {
+        add(&counters.errors, 1);
+    }
+
+    add(&counters.total_ns, ns);
+    __atomic_fetch_add(&counters.histogram[bucket_of(ns)], 1, __ATOMIC_RELAXED);
+
+    std::uint64_t max = __atomic_load_n(&counters.max_ns, __ATOMIC_RELAXED);
+
+    while (ns > max && !__atomic_compare_exchange_n(&counters.max_ns, &max, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void reset(Counters& counters)
+{
+    __atomic_store_n(&counters.calls, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters.errors, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters.total_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters.max_ns, 0, __ATOMIC_RELAXED);
+
+    for (std::size_t i = 0; i < NUM_BUCKETS; i++) {
+        __atomic_store_n(&counters.histogram[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+static void append_padded(kstring& out, const char* str, std::size_t width, bool left_align)
+{
+    std::size_t length = 0;
+
+    while (str[length] != '\0') {
+        length++;
+    }
+
+    if (left_align) {
+        out += str;
+    }
+
+    for (std::size_t i = length; i < width; i++) {
+        out += " ";
+    }
+
+    if (!left_align) {
+        out += str;
+    }
+}
+
+static void append_number(kstring& out, std::uint64_t value, std::size_t width)
+{
+    char buffer[32];
+    append_padded(out, fmt::to_string(value, buffer), width, false);
+}
+
+// 2^i ns as a short label: 1, 2, ..., 512, 1k, 2k, ..., 512k, 1M, ...
+static void append_bucket_label(kstring& out, std::size_t bucket)
+{
+    static constexpr const char* SUFFIXES[] = {"", "k", "M", "G"};
+
+    char buffer[32];
+
+    out += fmt::to_string(std::uint64_t{1} << (bucket % 10), buffer);
+    out += SUFFIXES[bucket / 10];
+}
+
+void format_header(kstring& out)
+{
+    append_padded(out, "syscall", NAME_WIDTH, true);
+    append_padded(out, "calls", COLUMN_WIDTH, false);
+    append_padded(out, "errors", COLUMN_WIDTH, false);
+    append_padded(out, "avg_ns", COLUMN_WIDTH, false);
+    append_padded(out, "max_ns", COLUMN_WIDTH, false);
+    out += "  latency (ns bucket:count, k = 1024)\n";
+}
+
+void format(kstring& out, const char* name, const Counters& counters)
+{
+    const std::uint64_t calls = __atomic_load_n(&counters.calls, __ATOMIC_RELAXED);
+    std::uint64_t returned = 0;
+
+    for (std::size_t i = 0; i < NUM_BUCKETS; i++) {
+        returned += __atomic_load_n(&counters.histogram[i], __ATOMIC_RELAXED);
+    }
+
+    const std::uint64_t total_ns = __atomic_load_n(&counters.total_ns, __ATOMIC_RELAXED);
+
+    append_padded(out, name, NAME_WIDTH, true);
+    append_number(out, calls, COLUMN_WIDTH);
+    append_number(out, __atomic_load_n(&counters.errors, __ATOMIC_RELAXED), COLUMN_WIDTH);
+    append_number(out, returned > 0 ? total_ns / returned : 0, COLUMN_WIDTH);
+    append_number(out, __atomic_load_n(&counters.max_ns, __ATOMIC_RELAXED), COLUMN_WIDTH);
+    out += " ";
+
+    for (std::size_t i = 0; i < NUM_BUCKETS; i++) {
+        const std::uint32_t count = __atomic_load_n(&counters.histogram[i], __ATOMIC_RELAXED);
+
+        if (count == 0) {
+            continue;
+        }
+
+        char buffer[32];
+
+        out += " ";
+        append_bucket_label(out, i);
+        out += ":";
+        out += fmt::to_string(count, buffer);
+    }
+
+    out += "\n";
+}
+
+}
@@ -1,16 +1,24 @@
 #include <containers/kvector.hpp>
 #include <cstdint>
 #include <timer/timer.hpp>
+#include <tunable/tunable.hpp>
 
 namespace timer {
 static kvector<TickHandler> handlers;
 static std::uintmax_t ticks = 0;
 
+// A longer period means fewer timer interrupts but coarser sleeps and
+// preemption. Read on every tick, so a change applies from the next one
+static tunable::Tunable<std::uint32_t> g_tick_ms{
+    "timer.tick_ms", 1, 1, 10, "milliseconds between timer interrupts"};
+
 std::uintmax_t get_ticks() { return ticks; }
 
-void tick(arch::irq::InterruptFrame* frame)
+std::uint64_t tick_period_ms() { return g_tick_ms.value(); }
+
+void tick(arch::irq::InterruptFrame* frame, std::uint64_t elapsed_ms)
 {
-    ticks++;
+    ticks += elapsed_ms;
 
     for (const auto& handler : handlers) {
         if (handler) {
@@ -0,0 +1,221 @@
+#include <containers/kstring_view.hpp>
+#include <crt/crt.h>
+#include <fmt/fmt.hpp>
+#include <fs/fs.hpp>
+#include <log/log.hpp>
+#include <tunable/tunable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tunable {
+
+// Every tunable links itself in here from its constructor. Constructors of
+// globals run before kernel_main(), one at a time, so no lock is needed
+static TunableBase* g_first = nullptr;
+
+TunableBase::TunableBase(const char* name, const char* description)
+    : name{name}
+    , description{description}
+    , next{g_first}
+{
+    g_first = this;
+}
+
+/// @brief parse a decimal integer, with an optional leading '-'
+///
+bool TunableBase::parse(kstring_view text, std::int64_t* value) const
+{
+    std::size_t i = 0;
+    bool negative = false;
+
+    if (i < text.length() && text[i] == '-') {
+        negative = true;
+        i++;
+    }
+
+    if (i == text.length()) {
+        return false;
+    }
+
+    std::int64_t result = 0;
+
+    for (; i < text.length(); i++) {
+        if (!fmt::is_numeric(text[i]) || result > (INT64_MAX - 9) / 10) {
+            return false;
+        }
+
+        result = result * 10 + (text[i] - '0');
+    }
+
+    *value = negative ? -result : result;
+
+    return true;
+}
+
+/// @brief write the current value into buf
+///
+/// @return the number of characters written, not null terminated
+///
+std::size_t TunableBase::format(char* buf, std::size_t size) const
+{
+    char number[32];
+    const char* str = fmt::to_string(static_cast<std::intmax_t>(get()), number);
+
+    std::size_t length = 0;
+
+    while (str[length] != '\0' && length < size) {
+        buf[length] = str[length];
+        length++;
+    }
+
+    return length;
+}
+
+TunableBase* first()
+{
+    return g_first;
+}
+
+TunableBase* find(kstring_view name)
+{
+    for (TunableBase* t = g_first; t != nullptr; t = t->next) {
+        if (name == kstring_view{t->name}) {
+            return t;
+        }
+    }
+
+    return nullptr;
+}
+
+/// @brief set a tunable from its text form
+///
+/// @return 0 on success, -ENOENT for an unknown name, -EINVAL for a value
+///         that does not parse or is out of range
+///
+int set(kstring_view name, kstring_view value)
+{
+    TunableBase* t = find(name);
+
+    if (t == nullptr) {
+        return -ENOENT;
+    }
+
+    std::int64_t parsed;
+
+    if (!t->parse(value, &parsed)) {
+        return -EINVAL;
+    }
+
+    return t->set(parsed);
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static kstring_view trim(const char* start, const char* end)
+{
+    while (start < end && is_space(*start)) {
+        start++;
+    }
+
+    while (end > start && is_space(end[-1])) {
+        end--;
+    }
+
+    return kstring_view{start, static_cast<std::size_t>(end - start)};
+}
+
+/// @brief apply one "name = value" line of a config file
+///
+static void apply_line(const char* path, std::size_t line_no, const char* start, const char* end)
+{
+    // Everything after a '#' is a comment
+    for (const char* c = start; c < end; c++) {
+        if (*c == '#') {
+            end = c;
+            break;
+        }
+    }
+
+    const kstring_view line = trim(start, end);
+
+    if (line.empty()) {
+        return;
+    }
+
+    const char* eq = nullptr;
+
+    for (std::size_t i = 0; i < line.length(); i++) {
+        if (line[i] == '=') {
+            eq = line.data() + i;
+            break;
+        }
+    }
+
+    if (eq == nullptr) {
+        log::warn(path, ":", line_no, ": expected 'name = value'");
+        return;
+    }
+
+    const kstring_view name = trim(line.data(), eq);
+    const kstring_view value = trim(eq + 1, line.data() + line.length());
+    const int err = set(name, value);
+
+    if (err == -ENOENT) {
+        log::warn(path, ":", line_no, ": unknown tunable '", name, "'");
+    } else if (err < 0) {
+        log::warn(path, ":", line_no, ": invalid value '", value, "' for ", name);
+    } else {
+        log::infof("tunable: {} = {}", name, value);
+    }
+}
+
+/// @brief set tunables from a "name = value" per line config file
+///
+/// Unknown names and bad values are logged and skipped, the rest of the file
+/// still applies
+///
+void load_config(const char* path)
+{
+    fs::FileDescriptor* fd = fs::open(path, fs::O_RDONLY);
+
+    if (fd == nullptr) {
+        log::warn("tunable: no ", path, ", using built-in defaults");
+        return;
+    }
+
+    const std::size_t size = fd->inode->size;
+    auto* data = new char[size];
+    const int read = fd->inode->read(fd, data, size);
+
+    fd->inode->close(fd);
+    delete fd;
+
+    if (read < 0) {
+        log::warn("tunable: failed to read ", path);
+        delete[] data;
+        return;
+    }
+
+    const char* end = data + read;
+    const char* line = data;
+    std::size_t line_no = 1;
+
+    while (line < end) {
+        const char* eol = line;
+
+        while (eol < end && *eol != '\n') {
+            eol++;
+        }
+
+        apply_line(path, line_no++, line, eol);
+        line = eol + 1;
+    }
+
+    delete[] data;
+}
+
+}
@@ -201,6 +201,65 @@ void test_tokenize_leading_trailing()
     test::assert_true(parts[3] == "", "tokenize leading/trailing: [3] is empty");
 }
 
+static bool is_sorted(const kvector<int>& v)
+{
+    for (std::size_t i = 1; i < v.size(); i++) {
+        if (v[i - 1] > v[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void test_sort_empty()
+{
+    kvector<int> v;
+    algo::sort(v.data(), v.data() + v.size(), [](int a, int b) { return a < b; });
+    test::assert_true(v.empty(), "sort empty: still empty");
+}
+
+void test_sort_basic()
+{
+    kvector<int> v = {5, 3, 9, 1, 7, 3, 0, 8};
+    algo::sort(v.data(), v.data() + v.size(), [](int a, int b) { return a < b; });
+    test::assert_true(is_sorted(v), "sort basic: ascending");
+    test::assert_eq(v.size(), 8ul, "sort basic: keeps every element");
+    test::assert_eq(v[1] + v[2], 4, "sort basic: duplicates kept");
+}
+
+void test_sort_large()
+{
+    kvector<int> v;
+    unsigned int seed = 12345;
+    long sum = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        seed = seed * 1103515245 + 12345;
+        v.push_back(static_cast<int>((seed >> 16) % 500));
+        sum += v.back();
+    }
+
+    algo::sort(v.data(), v.data() + v.size(), [](int a, int b) { return a < b; });
+
+    long sorted_sum = 0;
+
+    for (int x : v) {
+        sorted_sum += x;
+    }
+
+    test::assert_true(is_sorted(v), "sort large: ascending");
+    test::assert_eq(sorted_sum, sum, "sort large: same elements");
+}
+
+void test_sort_descending()
+{
+    kvector<int> v = {1, 2, 3, 4, 5};
+    algo::sort(v.data(), v.data() + v.size(), [](int a, int b) { return a > b; });
+    test::assert_eq(v[0], 5, "sort descending: largest first");
+    test::assert_eq(v[4], 1, "sort descending: smallest last");
+}
+
 void run()
 {
     log::info("Running algo tests...");
@@ -225,6 +284,11 @@ void run()
     test_tokenize_basic();
     test_tokenize_keeps_empty();
     test_tokenize_leading_trailing();
+
+    test_sort_empty();
+    test_sort_basic();
+    test_sort_large();
+    test_sort_descending();
 }
 }
 
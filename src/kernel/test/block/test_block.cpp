@@ -0,0 +1,312 @@
+#ifdef KERNEL_TESTS
+
+#include <block/block.hpp>
+#include <block/ramdisk.hpp>
+#include <crt/crt.h>
+#include <fs/devfs/dev_block.hpp>
+#include <fs/fs.hpp>
+#include <log/log.hpp>
+#include <test/test.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace test_block {
+
+constexpr std::size_t MAX_SEEN = 8;
+
+// Records every batch it is handed and completes it straight away
+class FakeDisk final : public block::BlockDevice {
+public:
+    std::size_t transfers = 0;
+    std::uint64_t starts[MAX_SEEN];
+    std::uint32_t counts[MAX_SEEN];
+    std::uint32_t requests[MAX_SEEN];
+    block::Op ops[MAX_SEEN];
+    bool contiguous = true; // Every batch's requests in order, end to end
+
+    explicit FakeDisk(std::uint32_t max_sectors)
+        : BlockDevice{"fake", 1024, max_sectors}
+    {
+    }
+
+protected:
+    void transfer(block::Batch* batch) override
+    {
+        if (transfers < MAX_SEEN) {
+            starts[transfers] = batch->sector;
+            counts[transfers] = batch->count;
+            requests[transfers] = batch->requests;
+            ops[transfers] = batch->op;
+        }
+
+        std::uint64_t sector = batch->sector;
+
+        for (const block::Request* req = batch->first; req; req = req->next) {
+            contiguous &= req->sector == sector;
+            sector += req->count;
+        }
+
+        contiguous &= sector == batch->sector + batch->count;
+
+        transfers++;
+        complete(batch, 0);
+    }
+};
+
+static int g_done;
+static int g_status;
+
+static void count_done(block::Request*, int status)
+{
+    g_done++;
+    g_status = status;
+}
+
+static void make(block::Request* req, block::Op op, std::uint64_t sector, std::uint32_t count)
+{
+    req->op = op;
+    req->sector = sector;
+    req->count = count;
+    req->buffer = nullptr;
+    req->done = count_done;
+}
+
+void test_unplugged_dispatches_at_once()
+{
+    FakeDisk disk{64};
+    block::Request req;
+
+    g_done = 0;
+    make(&req, block::Op::READ, 0, 8);
+    disk.submit(&req);
+
+    test::assert_eq(disk.transfers, std::size_t{1}, "block: unplugged request is dispatched");
+    test::assert_eq(g_done, 1, "block: unplugged request has completed");
+}
+
+void test_adjacent_requests_merge()
+{
+    FakeDisk disk{64};
+    block::Request reqs[4];
+
+    // Out of order, front and back merges both needed
+    make(&reqs[0], block::Op::WRITE, 8, 8);
+    make(&reqs[1], block::Op::WRITE, 0, 8);
+    make(&reqs[2], block::Op::WRITE, 24, 8);
+    make(&reqs[3], block::Op::WRITE, 16, 8);
+
+    g_done = 0;
+    disk.plug();
+
+    for (auto& req : reqs) {
+        disk.submit(&req);
+    }
+
+    test::assert_eq(disk.transfers, std::size_t{0}, "block: plugged requests wait");
+
+    disk.unplug();
+
+    test::assert_eq(disk.transfers, std::size_t{1}, "block: four adjacent requests are one transfer");
+    test::assert_eq(disk.starts[0], std::uint64_t{0}, "block: merged run starts at the lowest sector");
+    test::assert_eq(disk.counts[0], std::uint32_t{32}, "block: merged run covers all four");
+    test::assert_eq(disk.requests[0], std::uint32_t{4}, "block: merged run holds four requests");
+    test::assert_true(disk.contiguous, "block: merged requests are in sector order");
+    test::assert_eq(g_done, 4, "block: every merged request completes");
+    test::assert_eq(disk.stats().merged, std::uint64_t{2}, "block: two requests joined a queued run");
+}
+
+void test_runs_are_sorted()
+{
+    FakeDisk disk{64};
+    block::Request reqs[3];
+
+    make(&reqs[0], block::Op::READ, 100, 4);
+    make(&reqs[1], block::Op::READ, 10, 4);
+    make(&reqs[2], block::Op::READ, 50, 4);
+
+    disk.plug();
+
+    for (auto& req : reqs) {
+        disk.submit(&req);
+    }
+
+    disk.unplug();
+
+    test::assert_eq(disk.transfers, std::size_t{3}, "block: separate runs stay separate");
+    test::assert_eq(disk.starts[0], std::uint64_t{10}, "block: lowest sector first");
+    test::assert_eq(disk.starts[1], std::uint64_t{50}, "block: then the middle one");
+    test::assert_eq(disk.starts[2], std::uint64_t{100}, "block: highest sector last");
+}
+
+void test_merge_limits()
+{
+    FakeDisk disk{16};
+    block::Request reqs[4];
+
+    // A read next to a write, and a run that would pass max_sectors
+    make(&reqs[0], block::Op::READ, 0, 8);
+    make(&reqs[1], block::Op::WRITE, 8, 8);
+    make(&reqs[2], block::Op::WRITE, 16, 8);
+    make(&reqs[3], block::Op::WRITE, 24, 8);
+
+    disk.plug();
+
+    for (auto& req : reqs) {
+        disk.submit(&req);
+    }
+
+    disk.unplug();
+
+    test::assert_eq(disk.transfers, std::size_t{3}, "block: no merge across ops or past max_sectors");
+    test::assert_true(disk.ops[0] == block::Op::READ, "block: the read stays on its own");
+    test::assert_eq(disk.counts[1], std::uint32_t{16}, "block: writes merge up to max_sectors");
+    test::assert_eq(disk.counts[2], std::uint32_t{8}, "block: the rest is a run of its own");
+}
+
+void test_gap_filler_joins_runs()
+{
+    FakeDisk disk{64};
+    block::Request reqs[3];
+
+    make(&reqs[0], block::Op::READ, 0, 8);
+    make(&reqs[1], block::Op::READ, 16, 8);
+    make(&reqs[2], block::Op::READ, 8, 8);
+
+    disk.plug();
+
+    for (auto& req : reqs) {
+        disk.submit(&req);
+    }
+
+    disk.unplug();
+
+    test::assert_eq(disk.transfers, std::size_t{1}, "block: filling the gap joins two runs");
+    test::assert_eq(disk.counts[0], std::uint32_t{24}, "block: joined run covers all three");
+    test::assert_true(disk.contiguous, "block: joined run is in sector order");
+}
+
+void test_overlap_keeps_order()
+{
+    FakeDisk disk{64};
+    block::Request write;
+    block::Request read;
+
+    make(&write, block::Op::WRITE, 0, 8);
+    make(&read, block::Op::READ, 4, 8);
+
+    disk.plug();
+    disk.submit(&write);
+    disk.submit(&read);
+
+    test::assert_eq(disk.transfers, std::size_t{1}, "block: overlapping request flushes the queue");
+    test::assert_true(disk.ops[0] == block::Op::WRITE, "block: the earlier write goes first");
+
+    disk.unplug();
+
+    test::assert_eq(disk.transfers, std::size_t{2}, "block: the read follows on unplug");
+}
+
+void test_out_of_range()
+{
+    FakeDisk disk{64};
+    block::Request req;
+
+    g_done = 0;
+    g_status = 0;
+    make(&req, block::Op::READ, 1020, 8);
+    disk.submit(&req);
+
+    test::assert_eq(disk.transfers, std::size_t{0}, "block: request past the end is not dispatched");
+    test::assert_eq(g_done, 1, "block: request past the end completes");
+    test::assert_eq(g_status, -EIO, "block: request past the end fails with EIO");
+}
+
+void test_ramdisk_read_write()
+{
+    block::RamDisk disk{"test", 64 * 1024};
+    static std::uint8_t buf[4096];
+    bool ok = true;
+
+    memset(buf, 0xFF, sizeof(buf));
+    test::assert_eq(block::read(&disk, 10, 8, buf), 0, "ramdisk: read of a hole");
+
+    for (std::size_t i = 0; i < sizeof(buf); i++) {
+        ok &= buf[i] == 0;
+    }
+
+    test::assert_true(ok, "ramdisk: a hole reads as zeros");
+    test::assert_eq(disk.pages(), std::size_t{0}, "ramdisk: reading allocates nothing");
+
+    for (std::size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = static_cast<std::uint8_t>(i * 7);
+    }
+
+    // Straddles the first two pages
+    test::assert_eq(block::write(&disk, 4, 8, buf), 0, "ramdisk: write across a page boundary");
+    test::assert_eq(disk.pages(), std::size_t{2}, "ramdisk: only the pages written are allocated");
+
+    memset(buf, 0, sizeof(buf));
+    test::assert_eq(block::read(&disk, 4, 8, buf), 0, "ramdisk: read back");
+
+    ok = true;
+
+    for (std::size_t i = 0; i < sizeof(buf); i++) {
+        ok &= buf[i] == static_cast<std::uint8_t>(i * 7);
+    }
+
+    test::assert_true(ok, "ramdisk: read back what was written");
+    test::assert_eq(block::read(&disk, 127, 2, buf), -EIO, "ramdisk: read past the end fails");
+}
+
+void test_dev_block_unaligned()
+{
+    block::RamDisk disk{"test", 64 * 1024};
+    fs::MountPoint mp{};
+    fs::devfs::DevBlockInode inode{&mp, nullptr, 1, &disk};
+    fs::FileDescriptor fd{};
+    static char buf[9002];
+
+    inode.open(&fd, fs::O_RDWR);
+
+    for (std::size_t i = 0; i < 9000; i++) {
+        buf[i] = static_cast<char>('a' + i % 26);
+    }
+
+    // Starts and ends inside a page, spans three
+    inode.lseek(&fd, 1000, fs::SEEK_SET);
+    test::assert_eq(inode.write(&fd, buf, 9000), 9000, "dev_block: unaligned write");
+    test::assert_eq(fd.offset, std::size_t{10000}, "dev_block: write moves the offset");
+
+    memset(buf, 0, sizeof(buf));
+    inode.lseek(&fd, 999, fs::SEEK_SET);
+    test::assert_eq(inode.read(&fd, buf, 9002), 9002, "dev_block: unaligned read");
+    test::assert_eq(buf[0], '\0', "dev_block: byte before the write is untouched");
+    test::assert_eq(buf[1], 'a', "dev_block: first byte written");
+    test::assert_eq(buf[9000], 'a' + 8999 % 26, "dev_block: last byte written");
+    test::assert_eq(buf[9001], '\0', "dev_block: byte after the write is untouched");
+
+    inode.lseek(&fd, -10, fs::SEEK_END);
+    test::assert_eq(inode.read(&fd, buf, 100), 10, "dev_block: read stops at the end of the device");
+    test::assert_eq(inode.read(&fd, buf, 100), 0, "dev_block: read at the end is EOF");
+    test::assert_eq(inode.write(&fd, buf, 1), -ENOSPC, "dev_block: write at the end is ENOSPC");
+}
+
+void run()
+{
+    log::info("Running block tests...");
+
+    test_unplugged_dispatches_at_once();
+    test_adjacent_requests_merge();
+    test_runs_are_sorted();
+    test_merge_limits();
+    test_gap_filler_joins_runs();
+    test_overlap_keeps_order();
+    test_out_of_range();
+    test_ramdisk_read_write();
+    test_dev_block_unaligned();
+}
+}
+
+#endif // KERNEL_TESTS
@@ -0,0 +1,115 @@
+#ifdef KERNEL_TESTS
+
+#include <compress/lz4.hpp>
+#include <crt/crt.h>
+#include <log/log.hpp>
+#include <test/test.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace test_lz4 {
+
+// Frame header: magic, FLG (version 01, independent blocks, content size),
+// BD, the 8-byte content size and a header checksum the decoder skips
+#define FRAME_HEADER(size) 0x04, 0x22, 0x4D, 0x18, 0x68, 0x40, (size) & 0xFF, (size) >> 8, 0, 0, 0, 0, 0, 0, 0x00
+
+#define END_MARK 0, 0, 0, 0
+
+constexpr std::size_t OUT_SIZE = 512;
+
+static std::uint8_t out[OUT_SIZE];
+
+static long decode(const std::uint8_t* frame, std::size_t size, std::size_t out_size = OUT_SIZE)
+{
+    memset(out, 0xCC, sizeof(out));
+
+    return compress::lz4::decompress_frame(frame, size, out, out_size);
+}
+
+void test_literals_only()
+{
+    const std::uint8_t frame[] = {FRAME_HEADER(5), 6, 0, 0, 0, 0x50, 'h', 'e', 'l', 'l', 'o', END_MARK};
+
+    test::assert_true(compress::lz4::is_frame(frame, sizeof(frame)), "lz4: frame is recognised");
+    test::assert_eq(compress::lz4::content_size(frame, sizeof(frame)), std::uint64_t{5}, "lz4: content size");
+    test::assert_eq(decode(frame, sizeof(frame)), 5L, "lz4: literals decode to 5 bytes");
+    test::assert_true(memcmp(out, "hello", 5) == 0, "lz4: literals decode to 'hello'");
+}
+
+void test_overlapping_match()
+{
+    // "abc", then 11 bytes from 3 back, then a last literal
+    const std::uint8_t frame[] = {
+        FRAME_HEADER(15), 8, 0, 0, 0, 0x37, 'a', 'b', 'c', 3, 0, 0x10, 'x', END_MARK};
+
+    test::assert_eq(decode(frame, sizeof(frame)), 15L, "lz4: overlapping match length");
+    test::assert_true(memcmp(out, "abcabcabcabcabx", 15) == 0, "lz4: overlapping match repeats the pattern");
+}
+
+void test_long_run()
+{
+    // One literal and a 300 byte match 1 back, the match length needs two
+    // extra bytes (15 + 255 + 26 + 4)
+    const std::uint8_t frame[] = {FRAME_HEADER(301), 7, 0, 0, 0, 0x1F, 'z', 1, 0, 0xFF, 0x1A, 0x00, END_MARK};
+
+    bool all_z = true;
+
+    test::assert_eq(decode(frame, sizeof(frame)), 301L, "lz4: run decodes to 301 bytes");
+
+    for (std::size_t i = 0; i < 301; i++) {
+        all_z &= out[i] == 'z';
+    }
+
+    test::assert_true(all_z, "lz4: run is all 'z'");
+    test::assert_eq(out[301], std::uint8_t{0xCC}, "lz4: nothing written past the run");
+}
+
+void test_match_into_previous_block()
+{
+    // The second block copies from the first, as linked blocks do
+    const std::uint8_t frame[] = {
+        FRAME_HEADER(8), 5, 0, 0, 0, 0x40, 'a', 'b', 'c', 'd', 4, 0, 0, 0, 0x00, 4, 0, 0x00, END_MARK};
+
+    test::assert_eq(decode(frame, sizeof(frame)), 8L, "lz4: two blocks decode to 8 bytes");
+    test::assert_true(memcmp(out, "abcdabcd", 8) == 0, "lz4: match reaches into the previous block");
+}
+
+void test_uncompressed_block()
+{
+    const std::uint8_t frame[] = {FRAME_HEADER(3), 3, 0, 0, 0x80, 'r', 'a', 'w', END_MARK};
+
+    test::assert_eq(decode(frame, sizeof(frame)), 3L, "lz4: raw block length");
+    test::assert_true(memcmp(out, "raw", 3) == 0, "lz4: raw block is copied as is");
+}
+
+void test_corrupt_frames()
+{
+    // Offset 5 with only 2 bytes decoded
+    const std::uint8_t bad_offset[] = {FRAME_HEADER(6), 6, 0, 0, 0, 0x20, 'a', 'b', 5, 0, 0x00, END_MARK};
+    // Block size runs past the end of the frame
+    const std::uint8_t truncated[] = {FRAME_HEADER(5), 6, 0, 0, 0, 0x50, 'h', 'e'};
+    const std::uint8_t hello[] = {FRAME_HEADER(5), 6, 0, 0, 0, 0x50, 'h', 'e', 'l', 'l', 'o', END_MARK};
+    const std::uint8_t tar[] = {'b', 'i', 'n', '/', 0, 0, 0, 0, 0, 0, 0, 0};
+
+    test::assert_eq(decode(bad_offset, sizeof(bad_offset)), static_cast<long>(-EINVAL), "lz4: offset before start");
+    test::assert_eq(decode(truncated, sizeof(truncated)), static_cast<long>(-EINVAL), "lz4: truncated frame");
+    test::assert_eq(decode(hello, sizeof(hello), 4), static_cast<long>(-EINVAL), "lz4: output does not fit");
+    test::assert_true(!compress::lz4::is_frame(tar, sizeof(tar)), "lz4: a tar header is not a frame");
+}
+
+void run()
+{
+    log::info("Running lz4 tests...");
+
+    test_literals_only();
+    test_overlapping_match();
+    test_long_run();
+    test_match_into_previous_block();
+    test_uncompressed_block();
+    test_corrupt_frames();
+}
+}
+
+#endif // KERNEL_TESTS
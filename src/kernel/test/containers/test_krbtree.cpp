@@ -0,0 +1,156 @@
+#ifdef KERNEL_TESTS
+
+#include <containers/krbtree.hpp>
+#include <log/log.hpp>
+#include <test/test.hpp>
+
+#include <cstdint>
+
+namespace test_krbtree {
+struct Item {
+    int key;
+    int id;
+    krbnode<Item> node;
+};
+
+struct ItemLess {
+    bool operator()(const Item& a, const Item& b) const { return a.key < b.key; }
+};
+
+using ItemTree = krbtree<Item, &Item::node, ItemLess>;
+
+void test_empty()
+{
+    ItemTree t;
+    test::assert_true(t.empty(), "default constructed krbtree is empty");
+    test::assert_null(t.first(), "empty krbtree has no first element");
+    test::assert_null(t.pop_first(), "pop_first on empty krbtree returns null");
+    test::assert_eq(t.validate(), 1, "empty krbtree is valid");
+}
+
+void test_insert_ordering()
+{
+    Item items[] = {{5, 0, {}}, {1, 1, {}}, {9, 2, {}}, {3, 3, {}}, {7, 4, {}}};
+    ItemTree t;
+
+    for (auto& item : items) {
+        t.insert(&item);
+    }
+
+    test::assert_eq(t.size(), 5ul, "insert increases size");
+    test::assert_eq(t.first()->key, 1, "first() returns the smallest key");
+    test::assert_true(t.validate() > 0, "krbtree is valid after inserts");
+
+    int expected[] = {1, 3, 5, 7, 9};
+    int i = 0;
+    bool ordered = true;
+
+    for (Item* it = t.first(); it != nullptr; it = t.next(it)) {
+        ordered = ordered && it->key == expected[i++];
+    }
+
+    test::assert_true(ordered && i == 5, "next() walks keys in order");
+}
+
+void test_equal_keys_fifo()
+{
+    Item items[] = {{4, 0, {}}, {4, 1, {}}, {4, 2, {}}};
+    ItemTree t;
+
+    for (auto& item : items) {
+        t.insert(&item);
+    }
+
+    test::assert_eq(t.pop_first()->id, 0, "equal keys pop in insertion order (1)");
+    test::assert_eq(t.pop_first()->id, 1, "equal keys pop in insertion order (2)");
+    test::assert_eq(t.pop_first()->id, 2, "equal keys pop in insertion order (3)");
+    test::assert_true(t.empty(), "krbtree empty after popping everything");
+}
+
+void test_erase_middle()
+{
+    Item items[] = {{2, 0, {}}, {4, 1, {}}, {6, 2, {}}, {8, 3, {}}};
+    ItemTree t;
+
+    for (auto& item : items) {
+        t.insert(&item);
+    }
+
+    t.erase(&items[2]);
+
+    test::assert_true(!t.contains(&items[2]), "erased element is unlinked");
+    test::assert_eq(t.size(), 3ul, "erase decreases size");
+    test::assert_true(t.validate() > 0, "krbtree is valid after erase");
+
+    t.erase(&items[2]);
+    test::assert_eq(t.size(), 3ul, "erasing an unlinked element is a no-op");
+}
+
+void test_erase_leftmost_updates_first()
+{
+    Item items[] = {{10, 0, {}}, {20, 1, {}}, {30, 2, {}}};
+    ItemTree t;
+
+    for (auto& item : items) {
+        t.insert(&item);
+    }
+
+    t.erase(&items[0]);
+    test::assert_eq(t.first()->key, 20, "first() updated after erasing leftmost");
+
+    t.insert(&items[0]);
+    test::assert_eq(t.first()->key, 10, "first() updated after reinserting smaller key");
+}
+
+void test_stress_invariants()
+{
+    constexpr int COUNT = 256;
+    auto* items = new Item[COUNT];
+    ItemTree t;
+
+    // simple LCG so the insertion order is scrambled but deterministic
+    std::uint32_t seed = 12345;
+
+    for (int i = 0; i < COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        items[i] = {static_cast<int>((seed >> 16) % 1000), i, {}};
+        t.insert(&items[i]);
+    }
+
+    test::assert_true(t.validate() > 0, "krbtree valid after 256 random inserts");
+
+    for (int i = 0; i < COUNT; i += 2) {
+        t.erase(&items[i]);
+    }
+
+    test::assert_eq(t.size(), static_cast<std::size_t>(COUNT / 2), "half of the items erased");
+    test::assert_true(t.validate() > 0, "krbtree valid after erasing half");
+
+    int prev = -1;
+    bool sorted = true;
+
+    while (!t.empty()) {
+        Item* it = t.pop_first();
+        sorted = sorted && it->key >= prev;
+        prev = it->key;
+    }
+
+    test::assert_true(sorted, "pop_first drains in sorted order");
+
+    delete[] items;
+}
+
+void run()
+{
+    log::info("Running krbtree tests...");
+
+    test_empty();
+    test_insert_ordering();
+    test_equal_keys_fifo();
+    test_erase_middle();
+    test_erase_leftmost_updates_first();
+    test_stress_invariants();
+}
+}
+
+#endif // KERNEL_TESTS
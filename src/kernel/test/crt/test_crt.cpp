@@ -0,0 +1,233 @@
+#ifdef KERNEL_TESTS
+
+#include <crt/crt.h>
+#include <log/log.hpp>
+#include <test/test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace test_crt {
+constexpr std::size_t BUF_SIZE = 512;
+constexpr std::size_t GUARD = 16;
+
+static std::uint8_t src_buf[BUF_SIZE];
+static std::uint8_t dst_buf[BUF_SIZE];
+
+static void fill_pattern(std::uint8_t* buf, std::size_t size, std::uint8_t seed)
+{
+    for (std::size_t i = 0; i < size; i++) {
+        buf[i] = static_cast<std::uint8_t>(seed + i * 7);
+    }
+}
+
+// Sizes around every word and threshold boundary the variants care about
+static constexpr std::size_t SIZES[] = {0, 1, 7, 8, 9, 15, 16, 31, 63, 64, 65, 127, 200, 257, 400};
+
+// =========================================================================
+// memcpy()/memset() variants
+// =========================================================================
+
+void test_copy_variants()
+{
+    bool ok = true;
+
+    for (std::size_t v = 0; v < crt_num_mem_impls(); v++) {
+        const crt_mem_impl* impl = crt_get_mem_impl(v);
+
+        for (std::size_t dst_off = 0; dst_off < 8; dst_off++) {
+            for (std::size_t src_off = 0; src_off < 8; src_off += 3) {
+                for (std::size_t size : SIZES) {
+                    fill_pattern(src_buf, BUF_SIZE, 1);
+                    fill_pattern(dst_buf, BUF_SIZE, 99);
+
+                    void* ret = impl->copy(dst_buf + GUARD + dst_off, src_buf + src_off, size);
+                    ok &= ret == dst_buf + GUARD + dst_off;
+
+                    for (std::size_t i = 0; i < BUF_SIZE; i++) {
+                        const bool inside = i >= GUARD + dst_off && i < GUARD + dst_off + size;
+                        const std::uint8_t expected = inside ? src_buf[src_off + i - GUARD - dst_off]
+                                                             : static_cast<std::uint8_t>(99 + i * 7);
+                        ok &= dst_buf[i] == expected;
+                    }
+                }
+            }
+        }
+    }
+
+    test::assert_true(ok, "every memcpy variant copies exactly size bytes at any alignment");
+}
+
+void test_set_variants()
+{
+    bool ok = true;
+
+    for (std::size_t v = 0; v < crt_num_mem_impls(); v++) {
+        const crt_mem_impl* impl = crt_get_mem_impl(v);
+
+        for (std::size_t off = 0; off < 8; off++) {
+            for (std::size_t size : SIZES) {
+                fill_pattern(dst_buf, BUF_SIZE, 99);
+
+                // Only the low byte of the value is used
+                impl->set(dst_buf + GUARD + off, 0x1A5, size);
+
+                for (std::size_t i = 0; i < BUF_SIZE; i++) {
+                    const bool inside = i >= GUARD + off && i < GUARD + off + size;
+                    const std::uint8_t expected = inside ? 0xA5 : static_cast<std::uint8_t>(99 + i * 7);
+                    ok &= dst_buf[i] == expected;
+                }
+            }
+        }
+    }
+
+    test::assert_true(ok, "every memset variant fills exactly size bytes at any alignment");
+}
+
+void test_active_variant_is_listed()
+{
+    bool found = false;
+
+    for (std::size_t v = 0; v < crt_num_mem_impls(); v++) {
+        found |= crt_get_mem_impl(v) == crt_active_mem_impl();
+    }
+
+    test::assert_true(found, "active memcpy variant is one of the listed ones");
+    test::assert_null(crt_get_mem_impl(crt_num_mem_impls()), "out of range variant is null");
+}
+
+// =========================================================================
+// memmove()
+// =========================================================================
+
+static bool check_move(std::size_t dst_off, std::size_t src_off, std::size_t size)
+{
+    std::uint8_t expected[BUF_SIZE];
+
+    fill_pattern(dst_buf, BUF_SIZE, 3);
+    fill_pattern(expected, BUF_SIZE, 3);
+
+    // Reference result, copied through a temporary so overlap can not matter
+    std::uint8_t tmp[BUF_SIZE];
+
+    for (std::size_t i = 0; i < size; i++) {
+        tmp[i] = expected[src_off + i];
+    }
+
+    for (std::size_t i = 0; i < size; i++) {
+        expected[dst_off + i] = tmp[i];
+    }
+
+    memmove(dst_buf + dst_off, dst_buf + src_off, size);
+
+    return memcmp(dst_buf, expected, BUF_SIZE) == 0;
+}
+
+void test_memmove_overlap_forward()
+{
+    bool ok = true;
+
+    for (std::size_t shift = 1; shift < 20; shift++) {
+        for (std::size_t size : SIZES) {
+            ok &= check_move(GUARD, GUARD + shift, size);
+        }
+    }
+
+    test::assert_true(ok, "memmove with dst below an overlapping src");
+}
+
+void test_memmove_overlap_backward()
+{
+    bool ok = true;
+
+    for (std::size_t shift = 1; shift < 20; shift++) {
+        for (std::size_t size : SIZES) {
+            ok &= check_move(GUARD + shift, GUARD, size);
+        }
+    }
+
+    test::assert_true(ok, "memmove with dst above an overlapping src");
+}
+
+void test_memmove_same()
+{
+    test::assert_true(check_move(GUARD, GUARD, 100), "memmove onto itself is a no-op");
+}
+
+// =========================================================================
+// memcmp()
+// =========================================================================
+
+void test_memcmp()
+{
+    fill_pattern(src_buf, BUF_SIZE, 5);
+    fill_pattern(dst_buf, BUF_SIZE, 5);
+
+    test::assert_eq(memcmp(src_buf, dst_buf, BUF_SIZE), 0, "memcmp equal buffers");
+    test::assert_eq(memcmp(src_buf, dst_buf, 0), 0, "memcmp zero length");
+
+    bool ok = true;
+
+    for (std::size_t pos = 0; pos < 40; pos++) {
+        fill_pattern(dst_buf, BUF_SIZE, 5);
+        dst_buf[pos + 3] = static_cast<std::uint8_t>(src_buf[pos + 3] + 1);
+
+        ok &= memcmp(src_buf + 3, dst_buf + 3, 64) < 0;
+        ok &= memcmp(dst_buf + 3, src_buf + 3, 64) > 0;
+        ok &= memcmp(src_buf + 3, dst_buf + 3, pos) == 0;
+    }
+
+    test::assert_true(ok, "memcmp finds the first difference at any offset");
+
+    const std::uint8_t a[] = {0x01, 0x80};
+    const std::uint8_t b[] = {0x01, 0x7F};
+
+    test::assert_true(memcmp(a, b, 2) > 0, "memcmp compares bytes as unsigned");
+}
+
+// =========================================================================
+// strlen()
+// =========================================================================
+
+void test_strlen()
+{
+    char str[64];
+    bool ok = true;
+
+    for (std::size_t start = 0; start < 8; start++) {
+        for (std::size_t len = 0; len < 40; len++) {
+            for (std::size_t i = 0; i < sizeof(str); i++) {
+                str[i] = 'x';
+            }
+
+            str[start + len] = '\0';
+
+            ok &= strlen(str + start) == len;
+        }
+    }
+
+    test::assert_true(ok, "strlen at every alignment and length");
+
+    const char high[] = {'\x80', '\xFF', '\x81', 'a', '\0'};
+
+    test::assert_eq(strlen(high), std::size_t{4}, "strlen with high bit bytes");
+}
+
+void run()
+{
+    log::info("Running crt tests...");
+
+    test_copy_variants();
+    test_set_variants();
+    test_active_variant_is_listed();
+
+    test_memmove_overlap_forward();
+    test_memmove_overlap_backward();
+    test_memmove_same();
+
+    test_memcmp();
+    test_strlen();
+}
+}
+
+#endif // KERNEL_TESTS
@@ -0,0 +1,117 @@
+#ifdef KERNEL_TESTS
+
+#include <arch.hpp>
+#include <exclusive/kmutex.hpp>
+#include <log/log.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <test/test.hpp>
+
+namespace test_kmutex {
+
+// Shared with the lockers, which run as kthreads of the real scheduler
+static kmutex* g_mutex;
+static kmutex* g_gate;
+static process::Process* g_lockers[2];
+static int g_owners;
+static int g_done;
+
+// Takes the mutex, then holds it until the gate opens
+static void locker()
+{
+    g_mutex->lock();
+    g_owners++;
+
+    g_gate->lock();
+    g_gate->unlock();
+
+    g_mutex->unlock();
+    g_done++;
+}
+
+static bool lockers_blocked()
+{
+    return g_lockers[0]->is_blocked() && g_lockers[1]->is_blocked();
+}
+
+// Let the lockers run from here, the boot context is the idle task, which
+// preempt() switches away from until nothing else is ready
+static void run_lockers_until(bool (*done)())
+{
+    for (int i = 0; i < 100 && !done(); i++) {
+        scheduler::get_scheduler()->preempt();
+    }
+}
+
+void test_contended_lock_sleeps_until_unlock()
+{
+    kmutex mutex;
+    kmutex gate;
+
+    g_mutex = &mutex;
+    g_gate = &gate;
+    g_owners = 0;
+    g_done = 0;
+
+    mutex.lock();
+    gate.lock();
+
+    for (auto*& p : g_lockers) {
+        p = new process::KThread(locker);
+        scheduler::get_scheduler()->add_process(p);
+    }
+
+    run_lockers_until(lockers_blocked);
+    test::assert_true(lockers_blocked(), "kmutex: contended lock() sleeps");
+    test::assert_eq(g_owners, 0, "kmutex: nobody gets a held mutex");
+
+    // One unlock() hands the mutex to exactly one sleeper
+    mutex.unlock();
+    run_lockers_until([] { return g_owners == 1 && lockers_blocked(); });
+    test::assert_eq(g_owners, 1, "kmutex: unlock() wakes one waiter");
+    test::assert_true(lockers_blocked(), "kmutex: the other waiter keeps sleeping");
+
+    // The first owner's unlock() passes it on to the second
+    gate.unlock();
+    run_lockers_until([] { return g_done == 2; });
+    test::assert_eq(g_owners, 2, "kmutex: every waiter gets the mutex in turn");
+    test::assert_eq(g_done, 2, "kmutex: both lockers finish");
+    test::assert_true(mutex.try_lock(), "kmutex: free once the last owner unlocks");
+    mutex.unlock();
+}
+
+void test_try_lock()
+{
+    kmutex mutex;
+
+    test::assert_true(mutex.try_lock(), "kmutex: try_lock() takes a free mutex");
+    test::assert_true(!mutex.try_lock(), "kmutex: try_lock() fails while held");
+
+    mutex.unlock();
+
+    test::assert_true(mutex.try_lock(), "kmutex: try_lock() succeeds after unlock()");
+
+    mutex.unlock();
+}
+
+void test_preemptible_while_held()
+{
+    kmutex mutex;
+    const bool before = arch::percpu::preemption_enabled();
+
+    mutex.lock();
+    test::assert_eq(arch::percpu::preemption_enabled(), before, "kmutex: holding it leaves preemption alone");
+    mutex.unlock();
+}
+
+void run()
+{
+    log::info("Running kmutex tests...");
+
+    test_contended_lock_sleeps_until_unlock();
+    test_try_lock();
+    test_preemptible_while_held();
+}
+}
+
+#endif // KERNEL_TESTS
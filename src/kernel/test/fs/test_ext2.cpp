@@ -0,0 +1,460 @@
+#ifdef KERNEL_TESTS
+
+#include <arch.hpp>
+#include <block/block.hpp>
+#include <block/ramdisk.hpp>
+#include <crt/crt.h>
+#include <fs/ext2/ext2.hpp>
+#include <fs/fs.hpp>
+#include <fs/page_cache.hpp>
+#include <log/log.hpp>
+#include <test/test.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace test_ext2 {
+
+using namespace fs::ext2;
+
+// The smallest useful filesystem: 1 KiB blocks, one group, and only the
+// root directory. Blocks 1-4 are the superblock, group descriptors and
+// bitmaps, then the inode table, then the root directory's one block
+constexpr std::uint32_t BLOCK = 1024;
+constexpr std::uint32_t BLOCKS = 2048;
+constexpr std::uint32_t INODES = 128;
+constexpr std::uint32_t INODE_TABLE = 5;
+constexpr std::uint32_t ROOT_BLOCK = INODE_TABLE + INODES * sizeof(DiskInode) / BLOCK;
+constexpr std::uint32_t USED_BLOCKS = ROOT_BLOCK; // Blocks 1 to ROOT_BLOCK
+constexpr std::uint32_t RESERVED_INODES = 10;
+
+static void set_bit(std::uint8_t* bits, std::uint32_t bit)
+{
+    bits[bit / 8] |= static_cast<std::uint8_t>(1 << (bit % 8));
+}
+
+static void put_entry(std::uint8_t* block, std::size_t offset, std::uint32_t ino, std::uint16_t rec_len, const char* name)
+{
+    DirEntryHeader header{ino, rec_len, static_cast<std::uint8_t>(strlen(name)), FT_DIR};
+
+    memcpy(block + offset, &header, sizeof(header));
+    memcpy(block + offset + sizeof(header), name, header.name_len);
+}
+
+// Write an empty filesystem to dev, what mke2fs -r 1 -O filetype would
+static void format(block::BlockDevice* dev)
+{
+    const std::size_t bytes = (ROOT_BLOCK + 1) * BLOCK;
+    auto* image = static_cast<std::uint8_t*>(kmalloc(bytes));
+
+    memset(image, 0, bytes);
+
+    auto* sb = reinterpret_cast<Superblock*>(image + SUPERBLOCK_OFFSET);
+    sb->inodes_count = INODES;
+    sb->blocks_count = BLOCKS;
+    sb->free_blocks_count = BLOCKS - 1 - USED_BLOCKS;
+    sb->free_inodes_count = INODES - RESERVED_INODES;
+    sb->first_data_block = 1;
+    sb->blocks_per_group = BLOCK * 8;
+    sb->frags_per_group = BLOCK * 8;
+    sb->inodes_per_group = INODES;
+    sb->max_mnt_count = -1;
+    sb->magic = MAGIC;
+    sb->state = 1;
+    sb->errors = 1;
+    sb->rev_level = 1;
+    sb->first_ino = RESERVED_INODES + 1;
+    sb->inode_size = sizeof(DiskInode);
+    sb->feature_incompat = INCOMPAT_FILETYPE;
+    sb->feature_ro_compat = RO_COMPAT_SPARSE_SUPER | RO_COMPAT_LARGE_FILE;
+
+    auto* gd = reinterpret_cast<GroupDesc*>(image + 2 * BLOCK);
+    gd->block_bitmap = 3;
+    gd->inode_bitmap = 4;
+    gd->inode_table = INODE_TABLE;
+    gd->free_blocks_count = static_cast<std::uint16_t>(sb->free_blocks_count);
+    gd->free_inodes_count = static_cast<std::uint16_t>(sb->free_inodes_count);
+    gd->used_dirs_count = 1;
+
+    // Bit i is block i + 1, bits past the end of the disk stay set
+    std::uint8_t* block_bits = image + 3 * BLOCK;
+
+    for (std::uint32_t bit = 0; bit < BLOCK * 8; bit++) {
+        if (bit < USED_BLOCKS || bit >= BLOCKS - 1) {
+            set_bit(block_bits, bit);
+        }
+    }
+
+    std::uint8_t* inode_bits = image + 4 * BLOCK;
+
+    for (std::uint32_t bit = 0; bit < BLOCK * 8; bit++) {
+        if (bit < RESERVED_INODES || bit >= INODES) {
+            set_bit(inode_bits, bit);
+        }
+    }
+
+    auto* root = reinterpret_cast<DiskInode*>(image + INODE_TABLE * BLOCK + (ROOT_INO - 1) * sizeof(DiskInode));
+    root->mode = S_IFDIR | 0755;
+    root->size = BLOCK;
+    root->links_count = 2;
+    root->blocks = BLOCK / block::SECTOR_SIZE;
+    root->block[0] = ROOT_BLOCK;
+
+    std::uint8_t* dir = image + ROOT_BLOCK * BLOCK;
+    put_entry(dir, 0, ROOT_INO, 12, ".");
+    put_entry(dir, 12, ROOT_INO, BLOCK - 12, "..");
+
+    block::write(dev, 0, bytes / block::SECTOR_SIZE, image);
+    kfree(image);
+}
+
+static Ext2MountPoint* g_mp;
+
+// Mounted once, a mount is never undone
+static Ext2MountPoint* mount()
+{
+    if (!g_mp) {
+        auto* disk = new block::RamDisk("ext2test", BLOCKS * BLOCK);
+        auto* ext2 = new Ext2FileSystem{};
+
+        block::register_device(disk);
+        format(disk);
+        g_mp = static_cast<Ext2MountPoint*>(ext2->mount("/dev/ext2test"));
+    }
+
+    return g_mp;
+}
+
+static void fill(std::uint8_t* buf, std::size_t count, std::size_t seed)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        buf[i] = static_cast<std::uint8_t>((seed + i) * 7 + (seed + i) / 251);
+    }
+}
+
+static bool matches(const std::uint8_t* buf, std::size_t count, std::size_t seed)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        if (buf[i] != static_cast<std::uint8_t>((seed + i) * 7 + (seed + i) / 251)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static fs::Inode* create(const char* name)
+{
+    fs::Inode* root = mount()->root_inode;
+
+    root->create(name, 0644);
+
+    return root->lookup(name);
+}
+
+// =========================================================================
+// Page cache
+// =========================================================================
+
+void test_cache_reads_and_writes_back()
+{
+    block::RamDisk disk{"cachetest", 64 * 1024};
+    auto* buf = static_cast<std::uint8_t*>(kmalloc(arch::vmm::PAGE_SIZE));
+
+    fill(buf, arch::vmm::PAGE_SIZE, 1);
+    block::write(&disk, 8, 8, buf);
+
+    {
+        fs::cache::DeviceMapping mapping{&disk};
+        fs::cache::Page* page;
+        const fs::cache::Stats before = fs::cache::stats();
+
+        test::assert_eq(fs::cache::get(&mapping, 1, &page), 0, "cache: get() reads a page");
+        test::assert_true(matches(page->data, arch::vmm::PAGE_SIZE, 1), "cache: page holds what is on disk");
+        test::assert_eq(page->sector[1], std::uint64_t{10}, "cache: subpages are mapped to their sectors");
+        fs::cache::put(page);
+
+        test::assert_eq(fs::cache::get(&mapping, 1, &page), 0, "cache: second get() of the page");
+        test::assert_eq(fs::cache::stats().hits, before.hits + 1, "cache: second get() is a hit");
+
+        // Only the dirty subpage goes back to disk
+        memset(page->data, 'x', arch::vmm::PAGE_SIZE);
+        fs::cache::mark_dirty(page, 1500, 10);
+        fs::cache::put(page);
+
+        test::assert_eq(fs::cache::sync(&mapping), 0, "cache: sync() of the mapping");
+        block::read(&disk, 8, 8, buf);
+        test::assert_true(matches(buf, fs::cache::SUBPAGE_SIZE, 1), "cache: clean subpage is not written");
+        test::assert_eq(buf[fs::cache::SUBPAGE_SIZE], 'x', "cache: dirty subpage is written whole");
+        test::assert_eq(buf[2 * fs::cache::SUBPAGE_SIZE - 1], 'x', "cache: up to its end");
+        test::assert_true(matches(buf + 2 * fs::cache::SUBPAGE_SIZE, 2 * fs::cache::SUBPAGE_SIZE, 1 + 2 * fs::cache::SUBPAGE_SIZE),
+            "cache: later subpages are not written");
+
+        test::assert_true(mapping.pages > 0, "cache: mapping keeps its pages");
+        fs::cache::truncate(&mapping, 0);
+        test::assert_eq(mapping.pages, std::size_t{0}, "cache: truncate() drops every page");
+    }
+
+    kfree(buf);
+}
+
+void test_cache_reads_ahead()
+{
+    block::RamDisk disk{"cachetest", 256 * 1024};
+    fs::cache::DeviceMapping mapping{&disk};
+    fs::cache::Page* page;
+    const fs::cache::Stats before = fs::cache::stats();
+
+    test::assert_eq(fs::cache::get(&mapping, 0, &page), 0, "cache: first page");
+    fs::cache::put(page);
+
+    const fs::cache::Stats after = fs::cache::stats();
+
+    test::assert_eq(after.misses, before.misses + 1, "cache: one miss");
+    test::assert_true(after.readahead > before.readahead, "cache: the miss reads pages ahead");
+
+    test::assert_eq(fs::cache::get(&mapping, 1, &page), 0, "cache: next page");
+    fs::cache::put(page);
+    test::assert_eq(fs::cache::stats().misses, after.misses, "cache: next page was read ahead");
+
+    fs::cache::truncate(&mapping, 0);
+}
+
+// =========================================================================
+// ext2
+// =========================================================================
+
+void test_ext2_rejects_unformatted_device()
+{
+    Ext2FileSystem ext2;
+    auto* disk = new block::RamDisk("ext2blank", 64 * 1024);
+
+    block::register_device(disk);
+    test::assert_null(ext2.mount("/dev/ext2blank"), "ext2: no mount without a superblock");
+    test::assert_null(ext2.mount("/dev/nosuchdisk"), "ext2: no mount without a device");
+}
+
+void test_ext2_mounts_empty_root()
+{
+    Ext2MountPoint* mp = mount();
+
+    test::assert_not_null(mp, "ext2: formatted device mounts");
+
+    if (!mp) {
+        return;
+    }
+
+    test::assert_eq(mp->block_size, BLOCK, "ext2: block size from the superblock");
+    test::assert_eq(mp->root_inode->type, fs::FileType::DIRECTORY, "ext2: root is a directory");
+
+    kvector<fs::DirEntry> entries;
+    test::assert_eq(mp->root_inode->readdir(entries), 0, "ext2: new root lists nothing but . and ..");
+}
+
+void test_ext2_write_then_read_roundtrip()
+{
+    fs::Inode* file = create("roundtrip");
+    const std::size_t count = 3 * arch::vmm::PAGE_SIZE + 100;
+    auto* buf = static_cast<std::uint8_t*>(kmalloc(count));
+    fs::FileDescriptor fd{};
+
+    test::assert_not_null(file, "ext2: created file is found");
+
+    fill(buf, count, 5);
+    file->open(&fd, fs::O_RDWR);
+    fd.offset = 300;
+    test::assert_eq(file->write(&fd, buf, count), static_cast<int>(count), "ext2: write across pages");
+    test::assert_eq(file->size, std::uint64_t{300 + count}, "ext2: write grows the file");
+
+    memset(buf, 0, count);
+    fd.offset = 0;
+    test::assert_eq(file->read(&fd, buf, 300), 300, "ext2: read the unwritten start");
+    test::assert_eq(buf[0] | buf[299], 0, "ext2: unwritten start reads as zeros");
+    test::assert_eq(file->read(&fd, buf, count), static_cast<int>(count), "ext2: read back");
+    test::assert_true(matches(buf, count, 5), "ext2: read returns what was written");
+    test::assert_eq(file->read(&fd, buf, count), 0, "ext2: read at the end is EOF");
+    file->close(&fd);
+
+    kfree(buf);
+}
+
+void test_ext2_data_survives_writeback()
+{
+    auto* file = static_cast<Ext2FileInode*>(create("writeback"));
+    std::uint8_t buf[1000];
+    fs::FileDescriptor fd{};
+
+    fill(buf, sizeof(buf), 9);
+    file->open(&fd, fs::O_RDWR);
+    file->write(&fd, buf, sizeof(buf));
+
+    // With its pages dropped, the file is read back from the disk
+    test::assert_eq(fs::cache::sync(), 0, "ext2: sync() writes every dirty page");
+    test::assert_eq(fs::cache::stats().dirty, std::size_t{0}, "ext2: nothing dirty after sync()");
+    fs::cache::truncate(&file->node.data, 0);
+
+    memset(buf, 0, sizeof(buf));
+    fd.offset = 0;
+    test::assert_eq(file->read(&fd, buf, sizeof(buf)), static_cast<int>(sizeof(buf)), "ext2: read after writeback");
+    test::assert_true(matches(buf, sizeof(buf), 9), "ext2: what was written reached the disk");
+    file->close(&fd);
+}
+
+void test_ext2_sparse_file_uses_indirect_blocks()
+{
+    auto* file = static_cast<Ext2FileInode*>(create("sparse"));
+    // Past the 12 direct and 256 single indirect blocks
+    const std::size_t far = 300 * BLOCK + 10;
+    std::uint8_t buf[100];
+    fs::FileDescriptor fd{};
+
+    fill(buf, sizeof(buf), 3);
+    file->open(&fd, fs::O_RDWR);
+    fd.offset = far;
+    test::assert_eq(file->write(&fd, buf, sizeof(buf)), static_cast<int>(sizeof(buf)), "ext2: write far into a file");
+
+    test::assert_true(file->node.disk.block[DIND_BLOCK] != 0, "ext2: double indirect block allocated");
+    test::assert_eq(file->node.disk.block[0], std::uint32_t{0}, "ext2: the start stays a hole");
+    // The data block, the double indirect block and one indirect block
+    test::assert_eq(file->node.disk.blocks, std::uint32_t{3 * BLOCK / block::SECTOR_SIZE}, "ext2: only written blocks count");
+
+    memset(buf, 0xFF, sizeof(buf));
+    fd.offset = 5000;
+    file->read(&fd, buf, sizeof(buf));
+    test::assert_eq(buf[0] | buf[99], 0, "ext2: hole reads as zeros");
+
+    fd.offset = far;
+    file->read(&fd, buf, sizeof(buf));
+    test::assert_true(matches(buf, sizeof(buf), 3), "ext2: data behind indirect blocks reads back");
+    file->close(&fd);
+}
+
+void test_ext2_truncate_frees_blocks()
+{
+    Ext2MountPoint* mp = mount();
+    const std::uint32_t free_before = mp->sb->free_blocks_count;
+    fs::Inode* file = create("truncate");
+    const std::size_t count = 40 * BLOCK;
+    auto* buf = static_cast<std::uint8_t*>(kmalloc(count));
+    fs::FileDescriptor fd{};
+
+    fill(buf, count, 11);
+    file->open(&fd, fs::O_RDWR);
+    file->write(&fd, buf, count);
+    test::assert_true(mp->sb->free_blocks_count < free_before - 40, "ext2: write allocates blocks");
+
+    test::assert_eq(file->truncate(1500), 0, "ext2: truncate");
+    test::assert_eq(mp->sb->free_blocks_count, free_before - 2, "ext2: blocks past the end are freed");
+
+    // Growing again brings zeros back, not the old data
+    test::assert_eq(file->truncate(3000), 0, "ext2: truncate to grow");
+    memset(buf, 0xFF, count);
+    fd.offset = 0;
+    test::assert_eq(file->read(&fd, buf, count), 3000, "ext2: read the grown file");
+    test::assert_true(matches(buf, 1500, 11), "ext2: kept bytes are unchanged");
+    test::assert_eq(buf[1500] | buf[2047] | buf[2999], 0, "ext2: bytes past the old end read as zeros");
+    file->close(&fd);
+
+    kfree(buf);
+}
+
+void test_ext2_directories()
+{
+    fs::Inode* root = mount()->root_inode;
+
+    test::assert_eq(root->mkdir("dir", 0755), 0, "ext2: mkdir");
+    test::assert_eq(root->mkdir("dir", 0755), -EEXIST, "ext2: mkdir of an existing name");
+
+    fs::Inode* dir = root->lookup("dir");
+    test::assert_not_null(dir, "ext2: lookup of the new directory");
+
+    if (!dir) {
+        return;
+    }
+
+    test::assert_eq(dir->create("a", 0644), 0, "ext2: create in a subdirectory");
+    test::assert_eq(root->rmdir("dir"), -ENOTEMPTY, "ext2: rmdir of a directory with files");
+    test::assert_eq(dir->rename("a", root, "moved"), 0, "ext2: rename across directories");
+    test::assert_null(dir->lookup("a"), "ext2: old name is gone");
+    test::assert_not_null(root->lookup("moved"), "ext2: new name is found");
+    test::assert_eq(root->unlink("moved"), 0, "ext2: unlink");
+    test::assert_null(root->lookup("moved"), "ext2: unlinked name is gone");
+    test::assert_eq(root->rmdir("dir"), 0, "ext2: rmdir of an empty directory");
+    test::assert_null(root->lookup("dir"), "ext2: removed directory is gone");
+}
+
+void test_ext2_rename_replaces_existing_name()
+{
+    Ext2MountPoint* mp = mount();
+    fs::Inode* root = mp->root_inode;
+    fs::Inode* from = create("rename-from");
+
+    test::assert_not_null(create("rename-to"), "ext2: file to rename over");
+    test::assert_not_null(from, "ext2: file to rename");
+
+    if (!from) {
+        return;
+    }
+
+    const std::uint64_t ino = from->ino;
+    const std::uint32_t free_inodes = mp->sb->free_inodes_count;
+    const std::size_t size = root->size;
+
+    test::assert_eq(root->rename("rename-from", root, "rename-to"), 0, "ext2: rename over an existing name");
+    test::assert_null(root->lookup("rename-from"), "ext2: old name is gone");
+
+    fs::Inode* found = root->lookup("rename-to");
+    test::assert_true(found && found->ino == ino, "ext2: the name now holds the renamed file");
+    test::assert_eq(mp->sb->free_inodes_count, free_inodes + 1, "ext2: the replaced file is freed");
+    test::assert_eq(root->size, size, "ext2: the entry is rewritten where it was");
+    root->unlink("rename-to");
+}
+
+void test_ext2_large_directory()
+{
+    fs::Inode* root = mount()->root_inode;
+
+    root->mkdir("many", 0755);
+    fs::Inode* dir = root->lookup("many");
+
+    if (!dir) {
+        test::assert_not_null(dir, "ext2: directory for many entries");
+        return;
+    }
+
+    // More entries than fit in one block
+    char name[] = "entry-with-a-long-name-00";
+
+    for (int i = 0; i < 60; i++) {
+        name[sizeof(name) - 3] = static_cast<char>('0' + i / 10);
+        name[sizeof(name) - 2] = static_cast<char>('0' + i % 10);
+        dir->create(name, 0644);
+    }
+
+    test::assert_true(dir->size > BLOCK, "ext2: directory grows past one block");
+
+    kvector<fs::DirEntry> entries;
+    test::assert_eq(dir->readdir(entries), 60, "ext2: every entry is listed");
+    test::assert_not_null(dir->lookup("entry-with-a-long-name-59"), "ext2: lookup in the second block");
+}
+
+void run()
+{
+    log::info("Running ext2 and page cache tests...");
+
+    test_cache_reads_and_writes_back();
+    test_cache_reads_ahead();
+    test_ext2_rejects_unformatted_device();
+    test_ext2_mounts_empty_root();
+    test_ext2_write_then_read_roundtrip();
+    test_ext2_data_survives_writeback();
+    test_ext2_sparse_file_uses_indirect_blocks();
+    test_ext2_truncate_frees_blocks();
+    test_ext2_directories();
+    test_ext2_rename_replaces_existing_name();
+    test_ext2_large_directory();
+}
+}
+
+#endif // KERNEL_TESTS
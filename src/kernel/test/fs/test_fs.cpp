@@ -1,11 +1,21 @@
 #ifdef KERNEL_TESTS
 
+#include <arch.hpp>
 #include <cerrno>
+#include <crt/crt.h>
+#include <fmt/fmt.hpp>
+#include <fs/dcache.hpp>
 #include <fs/devfs/dev_null.hpp>
 #include <fs/devfs/devfs.hpp>
+#include <fs/epoll.hpp>
 #include <fs/fs.hpp>
+#include <fs/initramfs/initramfs.hpp>
+#include <fs/path.hpp>
+#include <fs/pipe.hpp>
+#include <fs/poll.hpp>
 #include <fs/tmpfs/tmpfs.hpp>
 #include <log/log.hpp>
+#include <process/process.hpp>
 #include <test/test.hpp>
 
 namespace test_fs {
@@ -336,6 +346,388 @@ void test_tmpfs_lseek_invalid_whence_returns_einval()
     test::assert_eq(result, -EINVAL, "tmpfs: lseek with invalid whence returns -EINVAL");
 }
 
+void test_tmpfs_overwrite_keeps_size()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    root->create("over.txt", 0);
+    auto* file = static_cast<fs::tmpfs::TmpFileInode*>(root->lookup("over.txt"));
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    file->write(&fd, "hello world", 11);
+
+    fd.offset = 0;
+    file->write(&fd, "HELLO", 5);
+    test::assert_eq(file->size, 11ul, "tmpfs: write inside the file keeps its size");
+
+    fd.offset = 0;
+    char buf[11] = {};
+    file->read(&fd, buf, sizeof(buf));
+    test::assert_eq(kstring(buf, 11), kstring("HELLO world"), "tmpfs: overwrite replaces only the written bytes");
+}
+
+void test_tmpfs_read_direct()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    root->create("direct.txt", 0);
+    auto* file = static_cast<fs::tmpfs::TmpFileInode*>(root->lookup("direct.txt"));
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    file->write(&fd, "hello", 5);
+
+    fd.offset = 1;
+    const void* data = nullptr;
+    int available = file->read_direct(&fd, &data, 100);
+    test::assert_eq(available, 4, "tmpfs: read_direct clamps to the end of the file");
+    test::assert_eq(kstring(static_cast<const char*>(data), 4), kstring("ello"), "tmpfs: read_direct points at the offset");
+    test::assert_eq(fd.offset, 1ul, "tmpfs: read_direct leaves the offset alone");
+
+    fd.offset = 5;
+    test::assert_eq(file->read_direct(&fd, &data, 100), 0, "tmpfs: read_direct at EOF returns 0");
+}
+
+void test_transfer_tmpfs_to_tmpfs()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    root->create("src.txt", 0);
+    root->create("dst.txt", 0);
+
+    fs::FileDescriptor in{};
+    in.inode = root->lookup("src.txt");
+    in.inode->write(&in, "0123456789", 10);
+    in.offset = 2;
+
+    fs::FileDescriptor out{};
+    out.inode = root->lookup("dst.txt");
+
+    long moved = fs::transfer(&in, &out, 100);
+    test::assert_eq(moved, 8l, "transfer: stops at the end of the source");
+    test::assert_eq(in.offset, 10ul, "transfer: advances the source offset");
+    test::assert_eq(out.offset, 8ul, "transfer: advances the destination offset");
+
+    out.offset = 0;
+    char buf[8] = {};
+    out.inode->read(&out, buf, sizeof(buf));
+    test::assert_eq(kstring(buf, 8), kstring("23456789"), "transfer: destination holds the copied bytes");
+
+    test::assert_eq(fs::transfer(&in, &out, 100), 0l, "transfer: at EOF returns 0");
+    test::assert_eq(static_cast<fs::tmpfs::TmpFileInode*>(in.inode)->maps, 0, "transfer: drops its pin on the source");
+}
+
+void test_transfer_pin_outlives_truncate()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    root->create("pinned.txt", 0);
+    auto* file = static_cast<fs::tmpfs::TmpFileInode*>(root->lookup("pinned.txt"));
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    file->write(&fd, "pinned", 6);
+    fd.offset = 0;
+
+    // What transfer() holds while a write to a full pipe sleeps
+    test::assert_eq(file->map(), 0, "transfer: tmpfs source can be pinned");
+
+    const void* data = nullptr;
+    file->read_direct(&fd, &data, 100);
+    file->truncate(0);
+
+    test::assert_eq(file->detached.size(), 1ul, "transfer: truncate keeps a pinned page");
+    test::assert_eq(kstring(static_cast<const char*>(data), 6), kstring("pinned"), "transfer: pinned page still holds the data");
+
+    file->unmap();
+    test::assert_eq(file->detached.size(), 0ul, "transfer: the page is freed when the pin is dropped");
+}
+
+void test_transfer_within_one_file()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    root->create("self.txt", 0);
+    fs::Inode* file = root->lookup("self.txt");
+
+    fs::FileDescriptor in{};
+    in.inode = file;
+    file->write(&in, "abcd", 4);
+    in.offset = 0;
+
+    fs::FileDescriptor out{};
+    out.inode = file;
+    out.offset = 4;
+
+    long moved = fs::transfer(&in, &out, 4);
+    test::assert_eq(moved, 4l, "transfer: copies a file onto its own end");
+
+    in.offset = 0;
+    char buf[8] = {};
+    file->read(&in, buf, sizeof(buf));
+    test::assert_eq(kstring(buf, 8), kstring("abcdabcd"), "transfer: same-file copy goes through the bounce buffer");
+}
+
+void test_tmpfs_unlink_removes_file()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+
+    root->create("gone.txt", 0);
+    root->mkdir("dir", 0);
+    test::assert_eq(root->unlink("gone.txt"), 0, "tmpfs: unlink returns 0");
+    test::assert_null(root->lookup("gone.txt"), "tmpfs: unlinked file no longer found");
+    test::assert_eq(root->unlink("gone.txt"), -ENOENT, "tmpfs: unlink missing name returns -ENOENT");
+    test::assert_eq(root->unlink("dir"), -EISDIR, "tmpfs: unlink of a directory returns -EISDIR");
+}
+
+void test_tmpfs_rmdir_only_empty_dirs()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+
+    root->mkdir("full", 0);
+    root->create("file.txt", 0);
+    static_cast<fs::tmpfs::TmpDirectoryInode*>(root->lookup("full"))->create("x", 0);
+
+    test::assert_eq(root->rmdir("full"), -ENOTEMPTY, "tmpfs: rmdir non-empty returns -ENOTEMPTY");
+    test::assert_eq(root->rmdir("file.txt"), -ENOTDIR, "tmpfs: rmdir of a file returns -ENOTDIR");
+
+    static_cast<fs::tmpfs::TmpDirectoryInode*>(root->lookup("full"))->unlink("x");
+    test::assert_eq(root->rmdir("full"), 0, "tmpfs: rmdir once empty");
+    test::assert_null(root->lookup("full"), "tmpfs: removed directory no longer found");
+}
+
+void test_tmpfs_rename_moves_and_replaces()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+
+    root->mkdir("sub", 0);
+    root->create("a", 0);
+    root->create("b", 0);
+    fs::Inode* a = root->lookup("a");
+    auto* sub = static_cast<fs::tmpfs::TmpDirectoryInode*>(root->lookup("sub"));
+
+    test::assert_eq(root->rename("a", root, "b"), 0, "tmpfs: rename over an existing file");
+    test::assert_null(root->lookup("a"), "tmpfs: old name gone after rename");
+    test::assert_true(root->lookup("b") == a, "tmpfs: new name is the renamed inode");
+
+    test::assert_eq(root->rename("b", sub, "c"), 0, "tmpfs: rename into another directory");
+    test::assert_true(sub->lookup("c") == a && a->parent == sub, "tmpfs: moved inode has its new parent");
+
+    test::assert_eq(root->rename("sub", sub, "loop"), -EINVAL, "tmpfs: directory can not move under itself");
+    root->create("file", 0);
+    test::assert_eq(root->rename("sub", root, "file"), -ENOTDIR, "tmpfs: directory can not replace a file");
+}
+
+static kstring numbered_name(int i)
+{
+    char digits[32];
+
+    return kstring{"f"} + fmt::to_string(i, digits);
+}
+
+void test_tmpfs_large_directory()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    int found = 0;
+
+    for (int i = 0; i < 10000; i++) {
+        root->create(numbered_name(i).c_str(), 0);
+    }
+
+    // Every other one, so positions have holes
+    for (int i = 0; i < 10000; i += 2) {
+        root->unlink(numbered_name(i).c_str());
+    }
+
+    for (int i = 0; i < 10000; i++) {
+        if (root->lookup(numbered_name(i).c_str()) != nullptr) {
+            found++;
+        }
+    }
+
+    kvector<fs::DirEntry> entries;
+    root->readdir(entries);
+
+    test::assert_eq(found, 5000, "tmpfs: 10k entry directory finds every remaining name");
+    test::assert_eq(entries.size(), 5000ul, "tmpfs: readdir skips removed entries");
+    test::assert_eq(entries[0].name, kstring{"f1"}, "tmpfs: readdir keeps creation order");
+
+    for (int i = 1; i < 10000; i += 2) {
+        root->unlink(numbered_name(i).c_str());
+    }
+}
+
+// Takes up to limit entries per iterate() call
+class LimitedDirContext final : public fs::DirContext {
+public:
+    kvector<kstring> names;
+    std::size_t limit;
+    std::size_t taken = 0;
+
+    explicit LimitedDirContext(std::size_t limit)
+        : limit{limit}
+    {
+    }
+
+    bool emit(kstring_view name, std::uint64_t, fs::FileType, std::size_t) override
+    {
+        if (taken == limit) {
+            return false;
+        }
+
+        names.push_back(kstring{name});
+        taken++;
+
+        return true;
+    }
+};
+
+void test_tmpfs_iterate_resumes_at_cursor()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    fs::FileDescriptor fd{};
+
+    for (int i = 0; i < 5; i++) {
+        root->create(numbered_name(i).c_str(), 0);
+    }
+
+    root->open(&fd, 0);
+
+    LimitedDirContext ctx{2};
+    root->iterate(ctx);
+    test::assert_eq(ctx.names.size(), 2ul, "iterate: stops when emit() has no room");
+    test::assert_eq(ctx.pos, 2ul, "iterate: cursor is past the last entry taken");
+
+    // Removing entries already listed must not shift the rest
+    root->unlink("f0");
+    root->unlink("f1");
+
+    ctx.taken = 0;
+    ctx.limit = 10;
+    root->iterate(ctx);
+    test::assert_eq(ctx.names.size(), 5ul, "iterate: resumes at the cursor after unlinks");
+    test::assert_eq(ctx.names[2], kstring{"f2"}, "iterate: no entry skipped after unlinks");
+
+    ctx.taken = 0;
+    root->iterate(ctx);
+    test::assert_eq(ctx.taken, 0ul, "iterate: nothing left at the end");
+
+    root->close(&fd);
+}
+
+static fs::tmpfs::TmpFileInode* create_tmp_file(fs::tmpfs::TmpDirectoryInode* root, const char* name)
+{
+    root->create(name, 0);
+
+    return static_cast<fs::tmpfs::TmpFileInode*>(root->lookup(name));
+}
+
+void test_tmpfs_sparse_write_leaves_holes()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    auto* file = create_tmp_file(root, "sparse.bin");
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    fd.offset = 3 * arch::vmm::PAGE_SIZE + 10;
+    file->write(&fd, "x", 1);
+
+    test::assert_eq(file->size, 3 * arch::vmm::PAGE_SIZE + 11, "tmpfs: write past the end sets the size");
+    test::assert_eq(file->pages.pages(), 1ul, "tmpfs: only the written page exists");
+
+    fd.offset = 0;
+    char buf[16];
+    memset(buf, 'z', sizeof(buf));
+    file->read(&fd, buf, sizeof(buf));
+
+    bool zeros = true;
+
+    for (char c : buf) {
+        zeros = zeros && c == 0;
+    }
+
+    test::assert_true(zeros, "tmpfs: a hole reads as zeros");
+}
+
+void test_tmpfs_write_spans_pages()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    auto* file = create_tmp_file(root, "span.bin");
+    static char in[10000];
+    static char out[10000];
+
+    for (std::size_t i = 0; i < sizeof(in); i++) {
+        in[i] = static_cast<char>(i * 7);
+    }
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    fd.offset = arch::vmm::PAGE_SIZE - 6;
+
+    test::assert_eq(file->write(&fd, in, sizeof(in)), 10000, "tmpfs: write across pages writes everything");
+
+    fd.offset = arch::vmm::PAGE_SIZE - 6;
+
+    test::assert_eq(file->read(&fd, out, sizeof(out)), 10000, "tmpfs: read across pages reads everything");
+    test::assert_eq(memcmp(in, out, sizeof(in)), 0, "tmpfs: read across pages returns what was written");
+}
+
+void test_tmpfs_truncate_frees_and_zero_fills()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    auto* file = create_tmp_file(root, "trunc.bin");
+    static char data[3 * arch::vmm::PAGE_SIZE];
+
+    memset(data, 'a', sizeof(data));
+
+    fs::FileDescriptor fd{};
+    fd.inode = file;
+    file->write(&fd, data, sizeof(data));
+
+    test::assert_eq(file->truncate(100), 0, "tmpfs: truncate returns 0");
+    test::assert_eq(file->size, 100ul, "tmpfs: truncate sets the size");
+    test::assert_eq(file->pages.pages(), 1ul, "tmpfs: truncate frees the pages past the end");
+
+    file->truncate(2 * arch::vmm::PAGE_SIZE);
+
+    char buf[8];
+    memset(buf, 'z', sizeof(buf));
+    fd.offset = 100;
+    file->read(&fd, buf, sizeof(buf));
+    test::assert_eq(buf[0] + buf[7], 0, "tmpfs: growing back reads zeros, not old data");
+}
+
+void test_tmpfs_truncate_keeps_mapped_pages()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    auto* root = static_cast<fs::tmpfs::TmpDirectoryInode*>(mp.root_inode);
+    auto* file = create_tmp_file(root, "mapped.bin");
+    std::uintptr_t first = 0;
+    std::uintptr_t again = 0;
+
+    file->map();
+    file->map_page(0, &first);
+    file->map_page(0, &again);
+
+    test::assert_ne(first, 0ul, "tmpfs: map_page fills a hole");
+    test::assert_eq(first, again, "tmpfs: map_page gives the same frame every time");
+
+    file->truncate(0);
+    test::assert_eq(file->detached.size(), 1ul, "tmpfs: truncate keeps a page that may be mapped");
+
+    file->unmap();
+    test::assert_eq(file->detached.size(), 0ul, "tmpfs: the last unmap frees truncated pages");
+}
+
 // =========================================================================
 // getcwd tests
 // =========================================================================
@@ -462,6 +854,102 @@ void test_devfs_readdir_has_devices()
     test::assert_true(found_tty2, "devfs: readdir contains 'tty2'");
 }
 
+// =========================================================================
+// initramfs unit tests (archives built in memory)
+// =========================================================================
+
+alignas(512) static std::uint8_t g_tar[512 * 16];
+
+/// @brief append a tar entry at offset, returns the offset past it
+static std::size_t add_tar_entry(std::size_t offset, const char* path, const char* data, char typeflag = '0')
+{
+    auto* header = reinterpret_cast<fs::initramfs::tar::TarHeader*>(g_tar + offset);
+    const std::size_t size = data != nullptr ? strlen(data) : 0;
+
+    memset(header, 0, sizeof(*header));
+    strncpy(header->filename, path, sizeof(header->filename));
+    header->typeflag = typeflag;
+
+    // 11 octal digits, as tar writes them
+    for (int i = 10; i >= 0; i--) {
+        header->size[i] = static_cast<char>('0' + ((size >> (3 * (10 - i))) & 7));
+    }
+
+    memcpy(g_tar + offset + 512, data, size);
+
+    return offset + 512 + (size + 511) / 512 * 512;
+}
+
+/// @brief an archive with a dir entry, implied dirs and a file appended twice
+static std::size_t build_tar()
+{
+    memset(g_tar, 0, sizeof(g_tar));
+
+    std::size_t offset = add_tar_entry(0, "./bin/", nullptr, fs::initramfs::tar::TYPEFLAG_DIR);
+    offset = add_tar_entry(offset, "./bin/sh", "ELF!");
+    offset = add_tar_entry(offset, "etc/init/conf", "old");
+    offset = add_tar_entry(offset, "etc.txt", "txt");
+    offset = add_tar_entry(offset, "etc/init/conf", "new");
+
+    // Two zero blocks end the archive
+    return offset + 1024;
+}
+
+void test_initramfs_lookup_is_lazy()
+{
+    fs::initramfs::InitramfsMountPoint mp{g_tar, build_tar()};
+    auto* root = static_cast<fs::initramfs::InitramfsDirectoryInode*>(mp.root_inode);
+
+    test::assert_eq(mp.size(), 6ul, "initramfs: one entry per path, implied dirs included");
+    test::assert_eq(root->children.size(), 0ul, "initramfs: no inodes before the first lookup");
+
+    fs::Inode* bin = root->lookup("bin");
+    test::assert_not_null(bin, "initramfs: lookup finds a dir entry");
+    test::assert_eq(root->children.size(), 1ul, "initramfs: lookup creates only that inode");
+
+    fs::Inode* sh = bin->lookup("sh");
+    test::assert_not_null(sh, "initramfs: lookup finds a file in a dir");
+    test::assert_eq(sh->size, 4ul, "initramfs: file size from the header");
+    test::assert_true(memcmp(static_cast<fs::initramfs::InitramfsFileInode*>(sh)->tar_data, "ELF!", 4) == 0,
+        "initramfs: file data is in the archive");
+    test::assert_true(bin->lookup("sh") == sh, "initramfs: second lookup returns the same inode");
+
+    fs::Inode* init = root->lookup("etc") != nullptr ? root->lookup("etc")->lookup("init") : nullptr;
+    test::assert_not_null(init, "initramfs: dirs only implied by a path exist");
+    test::assert_eq(init->type, fs::FileType::DIRECTORY, "initramfs: implied dir is a DIRECTORY");
+
+    fs::Inode* conf = init->lookup("conf");
+    test::assert_true(conf != nullptr && memcmp(static_cast<fs::initramfs::InitramfsFileInode*>(conf)->tar_data, "new", 3) == 0,
+        "initramfs: a file appended again replaces the first");
+
+    test::assert_null(root->lookup("etc.tx"), "initramfs: prefix of a name is not found");
+    test::assert_null(bin->lookup("missing"), "initramfs: missing name is not found");
+}
+
+void test_initramfs_iterate_lists_children()
+{
+    fs::initramfs::InitramfsMountPoint mp{g_tar, build_tar()};
+    fs::Inode* root = mp.root_inode;
+
+    root->lookup("etc");
+
+    LimitedDirContext ctx{10};
+    root->iterate(ctx);
+
+    test::assert_eq(ctx.names.size(), 3ul, "initramfs: iterate lists each child once");
+
+    bool found_bin = false;
+    bool found_etc_txt = false;
+
+    for (const kstring& name : ctx.names) {
+        found_bin |= name == "bin";
+        found_etc_txt |= name == "etc.txt";
+    }
+
+    test::assert_true(found_bin && found_etc_txt, "initramfs: iterate lists children not looked up yet");
+    test::assert_null(root->lookup("sh"), "initramfs: grandchildren are not children");
+}
+
 // =========================================================================
 // VFS integration tests (require kernel VFS to be initialized)
 // =========================================================================
@@ -621,6 +1109,477 @@ void test_vfs_readdir_on_file()
     test::assert_eq(result, -1, "vfs: readdir on file returns -1");
 }
 
+void test_vfs_initramfs_read_at_offset()
+{
+    fs::FileDescriptor* fd = fs::open("/bin/shell", fs::O_RDONLY);
+    test::assert_not_null(fd, "vfs: open /bin/shell for offset read");
+    if (fd) {
+        char buf[4] = {};
+        int result = fd->inode->read(fd, buf, sizeof(buf));
+        test::assert_eq(result, 4, "vfs: initramfs read returns byte count");
+        test::assert_eq(kstring(buf + 1, 3), kstring("ELF"), "vfs: initramfs read starts at offset 0");
+        test::assert_eq(fd->offset, 4ul, "vfs: initramfs read advances offset");
+
+        fd->offset = fd->inode->size - 2;
+        result = fd->inode->read(fd, buf, sizeof(buf));
+        test::assert_eq(result, 2, "vfs: initramfs read clamps to the end of the file");
+
+        result = fd->inode->read(fd, buf, sizeof(buf));
+        test::assert_eq(result, 0, "vfs: initramfs read at EOF returns 0");
+        delete fd;
+    }
+}
+
+void test_vfs_transfer_from_dev_null()
+{
+    fs::FileDescriptor* in = fs::open("/dev/null", fs::O_RDONLY);
+    fs::FileDescriptor* out = fs::open("/dev/null", fs::O_WRONLY);
+    test::assert_not_null(in, "vfs: open /dev/null as transfer source");
+    if (in && out) {
+        test::assert_eq(fs::transfer(in, out, 4096), 0l, "vfs: transfer from /dev/null returns 0 (EOF)");
+    }
+    delete in;
+    delete out;
+}
+
+// Pipes are non-blocking here, the tests run without a process to block
+
+void test_pipe_write_then_read()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    const char data[] = "through the pipe";
+    char buf[32] = {};
+    test::assert_eq(w->inode->write(w, data, sizeof(data)), (int)sizeof(data), "pipe: write returns byte count");
+    test::assert_eq(r->inode->read(r, buf, 7), 7, "pipe: short read returns requested count");
+    test::assert_eq(r->inode->read(r, buf + 7, sizeof(buf) - 7), (int)sizeof(data) - 7, "pipe: read returns the rest");
+    test::assert_eq(kstring(buf), kstring(data), "pipe: data read back in order");
+
+    r->put();
+    w->put();
+}
+
+void test_pipe_empty_read_returns_eagain()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    char buf[8];
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), -EAGAIN, "pipe: empty read returns -EAGAIN");
+
+    r->put();
+    w->put();
+}
+
+void test_pipe_read_after_writer_closed_returns_eof()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    char buf[8];
+    w->inode->write(w, "abc", 3);
+    w->put();
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), 3, "pipe: buffered data outlives the writer");
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), 0, "pipe: read with no writers returns 0 (EOF)");
+
+    r->put();
+}
+
+void test_pipe_write_after_reader_closed_returns_epipe()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    r->put();
+    test::assert_eq(w->inode->write(w, "abc", 3), -EPIPE, "pipe: write with no readers returns -EPIPE");
+
+    w->put();
+}
+
+void test_pipe_wraps_around_pages()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    // Fill, then keep pushing odd sized chunks so the ring wraps across
+    // page boundaries
+    static std::uint8_t buf[fs::PipeInode::CAPACITY];
+    for (std::size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = static_cast<std::uint8_t>(i);
+    }
+
+    test::assert_eq(w->inode->write(w, buf, sizeof(buf)), (int)sizeof(buf), "pipe: fills to capacity");
+    test::assert_eq(w->inode->write(w, buf, 1), -EAGAIN, "pipe: full pipe returns -EAGAIN");
+
+    bool ok = true;
+    std::uint8_t out[1000];
+    std::size_t written = sizeof(buf);
+    std::size_t read = 0;
+
+    for (int i = 0; i < 200 && ok; i++) {
+        ok = r->inode->read(r, out, sizeof(out)) == (int)sizeof(out);
+        for (std::size_t j = 0; j < sizeof(out) && ok; j++) {
+            ok = out[j] == static_cast<std::uint8_t>(read + j);
+        }
+        read += sizeof(out);
+
+        for (std::size_t j = 0; j < sizeof(out); j++) {
+            out[j] = static_cast<std::uint8_t>(written + j);
+        }
+        ok = ok && w->inode->write(w, out, sizeof(out)) == (int)sizeof(out);
+        written += sizeof(out);
+    }
+    test::assert_true(ok, "pipe: data intact across ring wraparound");
+
+    r->put();
+    w->put();
+}
+
+void test_pipe_atomic_write_does_not_split()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    static std::uint8_t buf[fs::PipeInode::CAPACITY];
+    char small[8];
+    w->inode->write(w, buf, sizeof(buf) - 100);
+    test::assert_eq(w->inode->write(w, buf, 200), -EAGAIN, "pipe: small write that does not fit returns -EAGAIN");
+    test::assert_eq(w->inode->write(w, buf, fs::PIPE_ATOMIC_WRITE + 1), 100, "pipe: large write is split");
+    test::assert_eq(r->inode->read(r, small, sizeof(small)), (int)sizeof(small), "pipe: read frees space");
+
+    r->put();
+    w->put();
+}
+
+void test_fd_refcount_closes_on_last_put()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    char buf[8];
+    w->get();
+    w->put();
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), -EAGAIN, "fd: pipe writer still open after one of two puts");
+    w->put();
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), 0, "fd: pipe writer closed after last put");
+
+    r->put();
+}
+
+void test_pipe_poll_readiness()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+
+    test::assert_eq(r->inode->poll(r, nullptr), 0u, "poll: empty pipe not readable");
+    test::assert_eq(w->inode->poll(w, nullptr), fs::POLLOUT | fs::POLLWRNORM, "poll: empty pipe writable");
+
+    w->inode->write(w, "x", 1);
+    test::assert_eq(r->inode->poll(r, nullptr), fs::POLLIN | fs::POLLRDNORM, "poll: pipe with data readable");
+
+    w->put();
+    test::assert_true(r->inode->poll(r, nullptr) & fs::POLLHUP, "poll: POLLHUP once the writer is gone");
+
+    r->put();
+}
+
+void test_epoll_level_triggered()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    fs::FileDescriptor* ep = fs::create_epoll();
+    fs::EpollInode* epoll = fs::to_epoll(ep);
+    linux::epoll_event events[4];
+    char buf[8];
+
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN, 42), 0, "epoll: add pipe read end");
+    test::assert_eq(epoll->wait(events, 4, 0), 0, "epoll: nothing ready on an empty pipe");
+
+    w->inode->write(w, "abc", 3);
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: write makes the read end ready");
+    test::assert_eq(events[0].events, fs::POLLIN, "epoll: reports POLLIN");
+    test::assert_eq(events[0].data, 42ul, "epoll: reports the registered data");
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: level-triggered stays ready until drained");
+
+    r->inode->read(r, buf, sizeof(buf));
+    test::assert_eq(epoll->wait(events, 4, 0), 0, "epoll: not ready once drained");
+
+    ep->put();
+    r->put();
+    w->put();
+}
+
+void test_epoll_edge_triggered()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    fs::FileDescriptor* ep = fs::create_epoll();
+    fs::EpollInode* epoll = fs::to_epoll(ep);
+    linux::epoll_event events[4];
+
+    epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN | linux::EPOLLET, 0);
+
+    w->inode->write(w, "a", 1);
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: edge-triggered reports a write");
+    test::assert_eq(epoll->wait(events, 4, 0), 0, "epoll: edge-triggered reports it only once");
+
+    w->inode->write(w, "b", 1);
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: edge-triggered reports the next write");
+
+    ep->put();
+    r->put();
+    w->put();
+}
+
+void test_epoll_oneshot_until_rearmed()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    fs::FileDescriptor* ep = fs::create_epoll();
+    fs::EpollInode* epoll = fs::to_epoll(ep);
+    linux::epoll_event events[4];
+
+    epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN | linux::EPOLLONESHOT, 0);
+
+    w->inode->write(w, "a", 1);
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: oneshot reports once");
+    w->inode->write(w, "b", 1);
+    test::assert_eq(epoll->wait(events, 4, 0), 0, "epoll: oneshot disarmed after reporting");
+
+    epoll->ctl(linux::EPOLL_CTL_MOD, 3, r, fs::POLLIN | linux::EPOLLONESHOT, 0);
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: EPOLL_CTL_MOD rearms oneshot");
+
+    ep->put();
+    r->put();
+    w->put();
+}
+
+void test_epoll_ctl_errors()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    fs::FileDescriptor* ep = fs::create_epoll();
+    fs::EpollInode* epoll = fs::to_epoll(ep);
+
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_MOD, 3, r, fs::POLLIN, 0), -ENOENT, "epoll: MOD of unwatched fd returns -ENOENT");
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_DEL, 3, r, 0, 0), -ENOENT, "epoll: DEL of unwatched fd returns -ENOENT");
+    epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN, 0);
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN, 0), -EEXIST, "epoll: second ADD returns -EEXIST");
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_ADD, 5, ep, fs::POLLIN, 0), -EINVAL, "epoll: watching an epoll returns -EINVAL");
+    test::assert_eq(epoll->ctl(linux::EPOLL_CTL_DEL, 3, r, 0, 0), 0, "epoll: DEL of watched fd");
+
+    ep->put();
+    r->put();
+    w->put();
+}
+
+void test_epoll_forgets_closed_file()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    fs::FileDescriptor* ep = fs::create_epoll();
+    fs::EpollInode* epoll = fs::to_epoll(ep);
+    linux::epoll_event events[4];
+
+    epoll->ctl(linux::EPOLL_CTL_ADD, 3, r, fs::POLLIN, 0);
+    epoll->ctl(linux::EPOLL_CTL_ADD, 4, w, fs::POLLOUT, 0);
+    r->put();
+    test::assert_not_null(w->epoll_items, "epoll: other file still watched");
+    test::assert_eq(epoll->wait(events, 4, 0), 1, "epoll: only the open file is reported");
+    test::assert_eq(events[0].events, fs::POLLOUT | fs::POLLERR, "epoll: write end reports POLLERR with no reader");
+
+    w->put();
+    ep->put();
+}
+
+void test_path_iterator_skips_empty_components()
+{
+    fs::PathIterator it{"//usr///bin/"};
+    kstring_view name{""};
+
+    test::assert_true(it.next(&name), "path: first component");
+    test::assert_true(name.length() == 3 && memcmp(name.data(), "usr", 3) == 0, "path: first component is 'usr'");
+    test::assert_true(!it.at_end(), "path: more after 'usr'");
+    test::assert_true(it.next(&name), "path: second component");
+    test::assert_true(name.length() == 3 && memcmp(name.data(), "bin", 3) == 0, "path: second component is 'bin'");
+    test::assert_true(it.at_end(), "path: trailing slash is not a component");
+    test::assert_true(!it.next(&name), "path: no third component");
+}
+
+void test_dcache_caches_hits_and_misses()
+{
+    fs::Stat st{};
+    fs::stat("/dev/null", &st);
+    fs::stat("/tmp/dcache_missing", &st);
+
+    const fs::dcache::Stats before = fs::dcache::stats();
+
+    test::assert_eq(fs::stat("/dev/null", &st), 0, "dcache: stat /dev/null again");
+    test::assert_eq(st.type, fs::FileType::CHAR_DEVICE, "dcache: cached walk crosses the /dev mount");
+    test::assert_eq(fs::stat("/tmp/dcache_missing", &st), -1, "dcache: missing file still missing");
+
+    const fs::dcache::Stats after = fs::dcache::stats();
+
+    test::assert_eq(after.hits - before.hits, 3ul, "dcache: every existing component is a hit");
+    test::assert_eq(after.negative_hits - before.negative_hits, 1ul, "dcache: missing file is a negative hit");
+    test::assert_eq(after.misses, before.misses, "dcache: nothing goes to the filesystem");
+}
+
+void test_dcache_negative_entry_dropped_on_create()
+{
+    fs::Stat st{};
+
+    test::assert_eq(fs::stat("/tmp/dcache_dir", &st), -1, "dcache: dir missing before mkdir");
+    test::assert_eq(fs::mkdir("/tmp/dcache_dir", 0), 0, "dcache: mkdir");
+    test::assert_eq(fs::stat("/tmp/dcache_dir", &st), 0, "dcache: dir found after mkdir");
+
+    test::assert_eq(fs::stat("/tmp/dcache_dir/file", &st), -1, "dcache: file missing before create");
+    fs::FileDescriptor* fd = fs::open("/tmp/dcache_dir/file", fs::O_WRONLY | fs::O_CREAT);
+    test::assert_not_null(fd, "dcache: create file");
+    fd->put();
+    test::assert_eq(fs::stat("/tmp/dcache_dir//file", &st), 0, "dcache: file found after create");
+    test::assert_eq(fs::stat("/tmp/dcache_dir/../dcache_dir/./file", &st), 0, "dcache: . and .. around cached entries");
+}
+
+void test_dcache_drops_fill_raced_by_invalidate()
+{
+    fs::tmpfs::TmpMountPoint mp{};
+    fs::Inode* root = mp.root_inode;
+    fs::Inode* found = nullptr;
+
+    // A walker saw "x" missing, then someone created it before the walker
+    // got to cache that
+    const std::uint64_t seq = fs::dcache::begin_fill(root, "x");
+    fs::dcache::invalidate(root, "x");
+    fs::dcache::fill(root, "x", nullptr, nullptr, seq);
+
+    test::assert_true(fs::dcache::lookup(root, "x", &found) == fs::dcache::Lookup::MISS,
+        "dcache: stale negative entry is not cached");
+
+    fs::dcache::fill(root, "x", nullptr, nullptr, fs::dcache::begin_fill(root, "x"));
+    test::assert_true(fs::dcache::lookup(root, "x", &found) == fs::dcache::Lookup::NEGATIVE,
+        "dcache: negative entry cached");
+
+    // The mount point is about to go away
+    fs::dcache::invalidate(root, "x");
+}
+
+void test_vfs_unlink_open_file_stays_readable()
+{
+    fs::FileDescriptor* fd = fs::open("/tmp/unlink_me", fs::O_RDWR | fs::O_CREAT);
+    fs::Stat st{};
+    char buf[4] = {};
+
+    test::assert_not_null(fd, "vfs: create file to unlink");
+    fd->inode->write(fd, "data", 4);
+    fd->offset = 0;
+
+    test::assert_eq(fs::unlink("/tmp/unlink_me"), 0, "vfs: unlink open file");
+    test::assert_eq(fs::stat("/tmp/unlink_me", &st), -1, "vfs: unlinked name is gone");
+    test::assert_eq(fd->inode->read(fd, buf, 4), 4, "vfs: open fd still reads the unlinked file");
+    test::assert_eq(fs::unlink("/tmp/unlink_me"), -ENOENT, "vfs: second unlink returns -ENOENT");
+
+    fd->put();
+}
+
+void test_vfs_rename_and_rmdir()
+{
+    fs::Stat st{};
+
+    fs::mkdir("/tmp/ren_a", 0);
+    fs::FileDescriptor* fd = fs::open("/tmp/ren_a/file", fs::O_WRONLY | fs::O_CREAT);
+    fd->put();
+
+    test::assert_eq(fs::rename("/tmp/ren_a", "/tmp/ren_b"), 0, "vfs: rename directory");
+    test::assert_eq(fs::stat("/tmp/ren_a/file", &st), -1, "vfs: old path gone after rename");
+    test::assert_eq(fs::stat("/tmp/ren_b/file", &st), 0, "vfs: contents reachable under the new name");
+    test::assert_eq(fs::rename("/tmp/ren_b/file", "/dev/file"), -EXDEV, "vfs: rename across mounts returns -EXDEV");
+    test::assert_eq(fs::rmdir("/tmp/ren_b"), -ENOTEMPTY, "vfs: rmdir non-empty returns -ENOTEMPTY");
+    test::assert_eq(fs::rmdir("/tmp"), -EBUSY, "vfs: rmdir of a mount point returns -EBUSY");
+    test::assert_eq(fs::unlink("/tmp/ren_b/file"), 0, "vfs: unlink file");
+    test::assert_eq(fs::rmdir("/tmp/ren_b"), 0, "vfs: rmdir empty directory");
+    test::assert_eq(fs::stat("/tmp/ren_b", &st), -1, "vfs: removed directory is gone");
+    test::assert_eq(fs::mkdir("/tmp/ren_b", 0), 0, "vfs: name can be reused");
+    test::assert_eq(fs::stat("/tmp/ren_b/file", &st), -1, "vfs: new directory does not inherit old entries");
+    fs::rmdir("/tmp/ren_b");
+}
+
+void test_close_on_exec_only_closes_marked_fds()
+{
+    fs::FileDescriptor* r;
+    fs::FileDescriptor* w;
+    fs::create_pipe(fs::O_NONBLOCK, &r, &w);
+    auto* files = new process::FileTable{};
+    char buf[8];
+
+    files->fds.push_back(r);
+    files->fds.push_back(w);
+    files->set_cloexec(1, true);
+
+    process::FileTable* child = files->clone();
+    test::assert_true(child->is_cloexec(1), "cloexec: fork keeps FD_CLOEXEC");
+    test::assert_true(!child->is_cloexec(0), "cloexec: unmarked fd stays unmarked across fork");
+
+    files->close_on_exec();
+    test::assert_not_null(files->fds[0], "cloexec: unmarked fd survives exec");
+    test::assert_true(files->fds[1] == nullptr, "cloexec: marked fd closed by exec");
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), -EAGAIN, "cloexec: write end still open in the other table");
+
+    child->close_on_exec();
+    test::assert_eq(r->inode->read(r, buf, sizeof(buf)), 0, "cloexec: write end closed once both tables exec");
+
+    child->put();
+    files->put();
+}
+
+void test_cwd_keeps_removed_directory_open()
+{
+    fs::mkdir("/tmp/cwd_dir", 0);
+
+    fs::FileDescriptor* desc = fs::open("/tmp/cwd_dir", fs::O_RDONLY);
+    test::assert_not_null(desc, "cwd: open the directory");
+
+    if (!desc) {
+        return;
+    }
+
+    auto* dir = static_cast<fs::tmpfs::TmpDirectoryInode*>(desc->inode);
+    auto* files = new process::FileTable{};
+
+    // As fchdir() does, the fd itself is closed right after
+    desc->get();
+    files->set_cwd(desc);
+    desc->put();
+
+    process::FileTable* child = files->clone();
+    test::assert_eq(desc->refs, 2, "cwd: fork shares the working directory");
+
+    test::assert_eq(fs::rmdir("/tmp/cwd_dir"), 0, "cwd: rmdir of a working directory");
+    test::assert_eq(dir->opens, 1, "cwd: removed directory stays open");
+    test::assert_null(dir->parent, "cwd: removed directory is cut off from its parent");
+    test::assert_true(files->cwd_inode() == dir, "cwd: still the working directory");
+
+    child->put();
+    test::assert_eq(desc->refs, 1, "cwd: child's reference dropped with its table");
+
+    files->set_cwd(nullptr);
+    files->put();
+}
+
 void run()
 {
     log::info("Running filesystem tests...");
@@ -648,6 +1607,20 @@ void run()
     test_tmpfs_lseek_end();
     test_tmpfs_lseek_negative_result_returns_einval();
     test_tmpfs_lseek_invalid_whence_returns_einval();
+    test_tmpfs_overwrite_keeps_size();
+    test_tmpfs_read_direct();
+    test_transfer_tmpfs_to_tmpfs();
+    test_transfer_pin_outlives_truncate();
+    test_transfer_within_one_file();
+    test_tmpfs_unlink_removes_file();
+    test_tmpfs_rmdir_only_empty_dirs();
+    test_tmpfs_rename_moves_and_replaces();
+    test_tmpfs_large_directory();
+    test_tmpfs_iterate_resumes_at_cursor();
+    test_tmpfs_sparse_write_leaves_holes();
+    test_tmpfs_write_spans_pages();
+    test_tmpfs_truncate_frees_and_zero_fills();
+    test_tmpfs_truncate_keeps_mapped_pages();
 
     // getcwd tests
     test_getcwd_root();
@@ -663,6 +1636,10 @@ void run()
     test_devfs_dir_lookup_missing();
     test_devfs_readdir_has_devices();
 
+    // initramfs unit tests
+    test_initramfs_lookup_is_lazy();
+    test_initramfs_iterate_lists_children();
+
     // VFS integration tests
     test_vfs_open_existing_file();
     test_vfs_open_nonexistent_file();
@@ -680,6 +1657,37 @@ void run()
     test_vfs_readdir_dev();
     test_vfs_readdir_nonexistent();
     test_vfs_readdir_on_file();
+    test_vfs_initramfs_read_at_offset();
+    test_vfs_transfer_from_dev_null();
+
+    // pipe tests
+    test_pipe_write_then_read();
+    test_pipe_empty_read_returns_eagain();
+    test_pipe_read_after_writer_closed_returns_eof();
+    test_pipe_write_after_reader_closed_returns_epipe();
+    test_pipe_wraps_around_pages();
+    test_pipe_atomic_write_does_not_split();
+    test_fd_refcount_closes_on_last_put();
+
+    // poll/epoll tests
+    test_pipe_poll_readiness();
+    test_epoll_level_triggered();
+    test_epoll_edge_triggered();
+    test_epoll_oneshot_until_rearmed();
+    test_epoll_ctl_errors();
+    test_epoll_forgets_closed_file();
+
+    // dentry cache tests
+    test_path_iterator_skips_empty_components();
+    test_dcache_caches_hits_and_misses();
+    test_dcache_negative_entry_dropped_on_create();
+    test_dcache_drops_fill_raced_by_invalidate();
+    test_vfs_unlink_open_file_stays_readable();
+    test_vfs_rename_and_rmdir();
+
+    // close-on-exec tests
+    test_close_on_exec_only_closes_marked_fds();
+    test_cwd_keeps_removed_directory_open();
 }
 }
 
@@ -0,0 +1,91 @@
+#ifdef KERNEL_TESTS
+
+#include <log/log.hpp>
+#include <memory/kobject_cache.hpp>
+#include <test/test.hpp>
+
+#include <cstdint>
+
+namespace test_kobject_cache {
+void test_alloc_from_empty()
+{
+    kobject_cache<64, 4> cache;
+
+    void* p = cache.alloc();
+    test::assert_not_null(p, "alloc from an empty cache falls back to kmalloc");
+    test::assert_eq(cache.cached(), 0ul, "empty cache stays empty after alloc");
+
+    cache.free(p);
+    test::assert_eq(cache.cached(), 1ul, "freed block is cached");
+}
+
+void test_reuse_lifo()
+{
+    kobject_cache<128, 4> cache;
+
+    void* a = cache.alloc();
+    void* b = cache.alloc();
+
+    cache.free(a);
+    cache.free(b);
+
+    test::assert_true(cache.alloc() == b, "most recently freed block is reused first");
+    test::assert_true(cache.alloc() == a, "older cached block is reused next");
+    test::assert_eq(cache.cached(), 0ul, "cache drained after reusing both blocks");
+
+    cache.free(a);
+    cache.free(b);
+}
+
+void test_capacity()
+{
+    constexpr std::size_t CAPACITY = 3;
+    kobject_cache<32, CAPACITY> cache;
+    void* blocks[CAPACITY + 2];
+
+    for (auto& block : blocks) {
+        block = cache.alloc();
+    }
+
+    for (auto& block : blocks) {
+        cache.free(block);
+    }
+
+    test::assert_eq(cache.cached(), CAPACITY, "cache never holds more than its capacity");
+
+    cache.free(nullptr);
+    test::assert_eq(cache.cached(), CAPACITY, "freeing null is a no-op");
+}
+
+void test_block_usable()
+{
+    kobject_cache<256, 2> cache;
+
+    auto* bytes = static_cast<std::uint8_t*>(cache.alloc());
+
+    for (int i = 0; i < 256; i++) {
+        bytes[i] = static_cast<std::uint8_t>(i);
+    }
+
+    cache.free(bytes);
+
+    auto* again = static_cast<std::uint8_t*>(cache.alloc());
+
+    test::assert_true(again == bytes, "cached block handed back out");
+    test::assert_eq(again[255], static_cast<std::uint8_t>(255), "bytes past the free list link are untouched");
+
+    cache.free(again);
+}
+
+void run()
+{
+    log::info("Running kobject_cache tests...");
+
+    test_alloc_from_empty();
+    test_reuse_lifo();
+    test_capacity();
+    test_block_usable();
+}
+}
+
+#endif // KERNEL_TESTS
@@ -0,0 +1,122 @@
+#ifdef KERNEL_TESTS
+
+#include <arch.hpp>
+#include <containers/kstring.hpp>
+#include <log/log.hpp>
+#include <memory/memory.hpp>
+#include <test/test.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace test_uaccess {
+
+// Tests run on the kernel page tables, where nothing below the higher half
+// is mapped, so any user address faults
+static auto* const UNMAPPED = reinterpret_cast<std::uint8_t*>(0x10000);
+
+void test_copy_from_unmapped_user_faults()
+{
+    std::uint8_t buf[16] = {};
+
+    test::assert_eq(kcopy_from_user(buf, UNMAPPED, sizeof(buf)), -EFAULT, "kcopy_from_user of an unmapped page returns -EFAULT");
+}
+
+void test_copy_to_unmapped_user_faults()
+{
+    const std::uint8_t buf[16] = {};
+
+    test::assert_eq(kcopy_to_user(UNMAPPED, buf, sizeof(buf)), -EFAULT, "kcopy_to_user of an unmapped page returns -EFAULT");
+}
+
+void test_copy_rejects_kernel_pointer()
+{
+    std::uint8_t src[16] = {1, 2, 3};
+    std::uint8_t dst[16] = {};
+
+    test::assert_eq(kcopy_from_user(dst, src, sizeof(src)), -EFAULT, "kcopy_from_user rejects a kernel source");
+    test::assert_eq(dst[0], std::uint8_t{0}, "kernel source is not read");
+    test::assert_eq(kcopy_to_user(dst, src, sizeof(src)), -EFAULT, "kcopy_to_user rejects a kernel destination");
+}
+
+void test_copy_rejects_range_past_user_space()
+{
+    std::uint8_t buf[16] = {};
+    auto* near_end = reinterpret_cast<std::uint8_t*>(arch::vmm::USER_MAX_ADDR - 8);
+
+    test::assert_eq(kcopy_from_user(buf, near_end, sizeof(buf)), -EFAULT, "range crossing the end of user space is rejected");
+}
+
+void test_copy_zero_bytes()
+{
+    std::uint8_t buf[1] = {};
+
+    test::assert_eq(kcopy_from_user(buf, UNMAPPED, 0), 0, "zero byte copy never touches memory");
+}
+
+void test_get_put_user_fault()
+{
+    std::uint64_t value = 0xDEAD;
+    auto* ptr = reinterpret_cast<std::uint64_t*>(UNMAPPED);
+
+    test::assert_eq(arch::uaccess::get_user(value, ptr), -EFAULT, "get_user of an unmapped page returns -EFAULT");
+    test::assert_eq(value, std::uint64_t{0}, "get_user zeroes the value on a fault");
+    test::assert_eq(arch::uaccess::put_user(std::uint64_t{1}, ptr), -EFAULT, "put_user of an unmapped page returns -EFAULT");
+
+    std::uint32_t kernel_word = 7;
+    std::uint32_t out = 0;
+
+    test::assert_eq(arch::uaccess::get_user(out, &kernel_word), -EFAULT, "get_user rejects a kernel pointer");
+}
+
+void test_strncpy_from_user_fault()
+{
+    char buf[32];
+
+    test::assert_eq(arch::uaccess::strncpy_from_user(buf, reinterpret_cast<const char*>(UNMAPPED), sizeof(buf)),
+        static_cast<long>(-EFAULT),
+        "strncpy_from_user of an unmapped page returns -EFAULT");
+
+    kstring str;
+
+    test::assert_eq(kstring::from_user(reinterpret_cast<const char*>(UNMAPPED), 64, str), -EFAULT, "kstring::from_user of an unmapped page returns -EFAULT");
+}
+
+void test_copy_array_overflow()
+{
+    std::uint64_t buf[1];
+
+    test::assert_eq(arch::uaccess::copy_array_from_user(buf, reinterpret_cast<const std::uint64_t*>(UNMAPPED), SIZE_MAX / 4),
+        -EFAULT,
+        "copy_array_from_user rejects a count that overflows");
+}
+
+void test_sections_restore_smap()
+{
+    std::uint8_t buf[8];
+
+    (void)kcopy_from_user(buf, UNMAPPED, sizeof(buf));
+
+    constexpr std::uint64_t RFLAGS_AC = 1 << 18;
+
+    test::assert_true((arch::cpu::read_rflags() & RFLAGS_AC) == 0, "SMAP is closed again after a faulting copy");
+}
+
+void run()
+{
+    log::info("Running uaccess tests...");
+
+    test_copy_from_unmapped_user_faults();
+    test_copy_to_unmapped_user_faults();
+    test_copy_rejects_kernel_pointer();
+    test_copy_rejects_range_past_user_space();
+    test_copy_zero_bytes();
+    test_get_put_user_fault();
+    test_strncpy_from_user_fault();
+    test_copy_array_overflow();
+    test_sections_restore_smap();
+}
+}
+
+#endif // KERNEL_TESTS
@@ -0,0 +1,186 @@
+#ifdef KERNEL_TESTS
+
+#include <exclusive/kmutex.hpp>
+#include <log/log.hpp>
+#include <process/process.hpp>
+#include <scheduler/scheduler.hpp>
+#include <test/test.hpp>
+
+#include <cerrno>
+
+namespace test_scheduler {
+
+// Never run, these only stand in for a parent and its children
+static void idle_entry()
+{
+}
+
+// A parent, a group leader child and one thread of the leader, on a
+// scheduler of their own so the running one never sees them
+struct Group {
+    scheduler::RoundRobinScheduler sched;
+    process::Process* parent;
+    process::Process* leader;
+    process::Process* thread;
+
+    Group()
+    {
+        parent = new process::KThread(idle_entry);
+        leader = new process::KThread(idle_entry);
+        thread = new process::KThread(idle_entry);
+
+        leader->parent = parent;
+        thread->parent = parent;
+        thread->tgid = leader->pid;
+
+        sched.add_process(parent);
+        sched.add_process(leader);
+        sched.add_process(thread);
+    }
+
+    ~Group()
+    {
+        delete thread;
+        delete leader;
+        delete parent;
+    }
+};
+
+void test_leader_exit_waits_for_threads()
+{
+    Group group{};
+
+    // sys_exit() of the leader while its thread runs on
+    group.leader->exit_status = 7;
+    group.leader->zombify();
+
+    test::assert_true(!group.sched.is_waitable(group.leader), "sched: leader with a live thread is parked");
+    test::assert_true(group.sched.find_child(group.parent, -1) == group.leader, "sched: parked leader is still a child");
+
+    group.thread->kill();
+
+    test::assert_true(group.sched.is_waitable(group.leader), "sched: leader is waitable once its last thread exits");
+    test::assert_true(group.sched.find_child(group.parent, -1) == group.leader, "sched: wait() finds the leader");
+    test::assert_eq(group.leader->exit_status, 7, "sched: leader keeps its exit status");
+}
+
+void test_thread_exit_group_parks_leader()
+{
+    Group group{};
+
+    // exit_group() from the thread: the leader is only told to go, it
+    // exits by itself on its way back to user mode
+    test::assert_eq(group.sched.kill_other_threads(group.thread, 3), 3, "sched: exit_group exits with its own status");
+    test::assert_true(group.leader->kill_pending, "sched: exit_group tells the leader to exit");
+    test::assert_true(!group.leader->is_zombie(), "sched: exit_group does not stop the leader where it is");
+    test::assert_eq(group.leader->exit_status, 3, "sched: leader gets the group's exit status");
+    test::assert_true(!group.thread->kill_pending, "sched: exit_group leaves the caller running");
+
+    // The leader calling exit_group() too before it got to exit
+    test::assert_eq(group.sched.kill_other_threads(group.leader, 5), 3, "sched: the first group exit's status wins");
+
+    // What syscall::exit_killed() ends in
+    group.leader->zombify();
+
+    test::assert_true(!group.sched.is_waitable(group.leader), "sched: leader waits for the calling thread");
+
+    group.thread->kill();
+
+    test::assert_true(group.sched.is_waitable(group.leader), "sched: leader waitable after the caller exits");
+}
+
+// Shared with the kthreads of test_kill_while_holding_kmutex(), which run
+// on the real scheduler
+static kmutex* g_mutex;
+static process::WaitQueue* g_never;
+static process::Process* g_holder;
+static process::Process* g_waiter;
+static int g_holder_err;
+static bool g_waiter_locked;
+static int g_exited;
+
+// Takes the mutex, then sleeps on a queue nobody wakes until it is killed
+static void holder()
+{
+    g_mutex->lock();
+
+    g_never->prepare();
+    g_holder_err = g_never->sleep_killable();
+
+    g_mutex->unlock();
+    g_exited++;
+}
+
+static void waiter()
+{
+    g_mutex->lock();
+    g_waiter_locked = true;
+    g_mutex->unlock();
+    g_exited++;
+}
+
+// Let the kthreads run from here, the boot context is the idle task, which
+// preempt() switches away from until nothing else is ready
+static void run_until(bool (*done)())
+{
+    for (int i = 0; i < 100 && !done(); i++) {
+        scheduler::get_scheduler()->preempt();
+    }
+}
+
+void test_kill_while_holding_kmutex()
+{
+    auto* sched = scheduler::get_scheduler();
+    auto* leader = new process::KThread(idle_entry);
+    kmutex mutex;
+    process::WaitQueue never;
+
+    g_mutex = &mutex;
+    g_never = &never;
+    g_holder_err = 0;
+    g_waiter_locked = false;
+    g_exited = 0;
+
+    // Threads of a leader that never runs, so the kill comes from outside
+    g_holder = new process::KThread(holder);
+    g_holder->tgid = leader->pid;
+    sched->add_process(g_holder);
+    run_until([] { return g_holder->is_blocked(); });
+
+    g_waiter = new process::KThread(waiter);
+    g_waiter->tgid = leader->pid;
+    sched->add_process(g_waiter);
+    run_until([] { return g_waiter->is_blocked(); });
+
+    test::assert_true(!mutex.try_lock(), "sched: a sleeping holder keeps its kmutex");
+
+    sched->kill_other_threads(leader, 9);
+
+    test::assert_true(g_holder->kill_pending && g_waiter->kill_pending, "sched: kill tells the whole group");
+    test::assert_true(!g_holder->is_blocked(), "sched: kill wakes a killable sleeper");
+    test::assert_true(g_waiter->is_blocked(), "sched: kill leaves a kmutex waiter asleep");
+
+    // Both are freed by the reaper once they exit, only the globals are left
+    run_until([] { return g_exited == 2; });
+
+    test::assert_eq(g_holder_err, -EINTR, "sched: the killed sleep returns -EINTR");
+    test::assert_true(g_waiter_locked, "sched: the killed holder unlocks its kmutex on the way out");
+    test::assert_eq(g_exited, 2, "sched: both killed threads exit");
+    test::assert_true(mutex.try_lock(), "sched: the kmutex is free after the kill");
+
+    mutex.unlock();
+
+    delete leader;
+}
+
+void run()
+{
+    log::info("Running scheduler tests...");
+
+    test_leader_exit_waits_for_threads();
+    test_thread_exit_group_parks_leader();
+    test_kill_while_holding_kmutex();
+}
+}
+
+#endif // KERNEL_TESTS
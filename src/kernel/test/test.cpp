@@ -17,9 +17,15 @@ void run();
 namespace test_slab {
 void run();
 }
+namespace test_uaccess {
+void run();
+}
 namespace test_kmalloc {
 void run();
 }
+namespace test_kobject_cache {
+void run();
+}
 namespace test_kvector {
 void run();
 }
@@ -38,6 +44,9 @@ void run();
 namespace test_kspinlock_irqsave {
 void run();
 }
+namespace test_kmutex {
+void run();
+}
 namespace test_kstring {
 void run();
 }
@@ -47,6 +56,9 @@ void run();
 namespace test_klist {
 void run();
 }
+namespace test_krbtree {
+void run();
+}
 namespace test_fmt {
 void run();
 }
@@ -56,6 +68,21 @@ void run();
 namespace test_algo {
 void run();
 }
+namespace test_crt {
+void run();
+}
+namespace test_lz4 {
+void run();
+}
+namespace test_block {
+void run();
+}
+namespace test_ext2 {
+void run();
+}
+namespace test_scheduler {
+void run();
+}
 
 namespace test {
 static Results results = {0, 0};
@@ -93,19 +120,28 @@ void run_all()
     test_pmm::run();
     test_vmm::run();
     test_slab::run();
+    test_uaccess::run();
     test_kmalloc::run();
+    test_kobject_cache::run();
     test_kvector::run();
     test_kunique_ptr::run();
     test_kshared_ptr::run();
     test_katomic::run();
     test_kspinlock::run();
     test_kspinlock_irqsave::run();
+    test_kmutex::run();
     test_kstring::run();
     test_kstring_view::run();
     test_klist::run();
+    test_krbtree::run();
     test_fmt::run();
     test_fs::run();
     test_algo::run();
+    test_crt::run();
+    test_lz4::run();
+    test_block::run();
+    test_ext2::run();
+    test_scheduler::run();
 
     auto frames_after_test = pmm::get_free_frames();
     auto slabs_after_test = slab::total_slabs();
@@ -0,0 +1,162 @@
+/**
+ * Block device throughput benchmark for hltOS
+ *
+ * Writes the whole of /dev/ram0 sequentially and reads it back, once per
+ * transfer size, and prints MiB/s for each. Every read is checked against
+ * what was written. Then times RANDOM_READS reads of 4 KiB at random
+ * page-aligned offsets.
+ *
+ * /dev/ram0 is sized by block.ram0_mb in /etc/kernel.conf, only the first
+ * MAX_MB of it are used.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PATH "/dev/ram0"
+#define MAX_MB 64
+#define MAX_CHUNK (1024 * 1024)
+#define RANDOM_READS 8192
+#define PAGE 4096
+
+#define BLKGETSIZE64_REQ 0x80081272
+
+static char g_buffer[MAX_CHUNK];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t mib_per_s(uint64_t bytes, uint64_t ns)
+{
+    return ns ? bytes * 1000000000ULL / ns / (1024 * 1024) : 0;
+}
+
+// Each chunk starts with its own index, so a read from the wrong place shows
+static void fill(size_t index, size_t chunk)
+{
+    memset(g_buffer, (int)(index & 0xFF), chunk);
+    memcpy(g_buffer, &index, sizeof(index));
+}
+
+static int bench_sequential(int fd, uint64_t size, size_t chunk)
+{
+    const size_t chunks = size / chunk;
+
+    lseek(fd, 0, SEEK_SET);
+
+    const uint64_t write_start = now_ns();
+
+    for (size_t i = 0; i < chunks; i++) {
+        fill(i, chunk);
+
+        if (write(fd, g_buffer, chunk) != (ssize_t)chunk) {
+            printf("write failed at chunk %zu\n", i);
+            return -1;
+        }
+    }
+
+    const uint64_t write_ns = now_ns() - write_start;
+
+    lseek(fd, 0, SEEK_SET);
+
+    const uint64_t read_start = now_ns();
+    int wrong = 0;
+
+    for (size_t i = 0; i < chunks; i++) {
+        size_t index;
+
+        if (read(fd, g_buffer, chunk) != (ssize_t)chunk) {
+            printf("read failed at chunk %zu\n", i);
+            return -1;
+        }
+
+        memcpy(&index, g_buffer, sizeof(index));
+        wrong |= index != i || (unsigned char)g_buffer[chunk - 1] != (i & 0xFF);
+    }
+
+    const uint64_t read_ns = now_ns() - read_start;
+
+    printf("%7zu B chunks: write %5llu MiB/s, read %5llu MiB/s%s\n", chunk,
+        (unsigned long long)mib_per_s(chunks * chunk, write_ns), (unsigned long long)mib_per_s(chunks * chunk, read_ns),
+        wrong ? "  WRONG DATA" : "");
+
+    return wrong ? -1 : 0;
+}
+
+static int bench_random(int fd, uint64_t size)
+{
+    const uint64_t pages = size / PAGE;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < RANDOM_READS; i++) {
+        // xorshift, cheap enough not to show in the timing
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        lseek(fd, (off_t)(seed % pages) * PAGE, SEEK_SET);
+
+        if (read(fd, g_buffer, PAGE) != PAGE) {
+            puts("random read failed");
+            return -1;
+        }
+    }
+
+    const uint64_t ns = now_ns() - start;
+
+    printf("random 4 KiB reads: %llu ns/read, %llu MiB/s\n", (unsigned long long)(ns / RANDOM_READS),
+        (unsigned long long)mib_per_s((uint64_t)RANDOM_READS * PAGE, ns));
+
+    return 0;
+}
+
+int main(void)
+{
+    const int fd = open(PATH, O_RDWR);
+    uint64_t size = 0;
+
+    if (fd < 0) {
+        puts("cannot open " PATH ", is block.ram0_mb 0?");
+        return 1;
+    }
+
+    if (ioctl(fd, BLKGETSIZE64_REQ, &size) < 0 || size < MAX_CHUNK) {
+        puts("BLKGETSIZE64 failed or device too small");
+        close(fd);
+        return 1;
+    }
+
+    printf(PATH ": %llu MiB\n", (unsigned long long)(size / (1024 * 1024)));
+
+    if (size > (uint64_t)MAX_MB * 1024 * 1024) {
+        size = (uint64_t)MAX_MB * 1024 * 1024;
+    }
+
+    const size_t chunks[] = {4096, 65536, MAX_CHUNK};
+    int status = 0;
+
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        status |= bench_sequential(fd, size, chunks[i]) < 0;
+    }
+
+    status |= bench_random(fd, size) < 0;
+
+    close(fd);
+
+    return status;
+}
@@ -0,0 +1,48 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Copies each file named on the command line to stdout, or stdin when there
+// are none, so it can sit at either end of a shell pipeline.
+
+static char g_buffer[4096];
+
+static int copy(int fd)
+{
+    ssize_t n;
+
+    while ((n = read(fd, g_buffer, sizeof(g_buffer))) > 0) {
+        if (write(1, g_buffer, n) != n) {
+            return -1;
+        }
+    }
+
+    return n < 0 ? -1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        return copy(0) < 0 ? 1 : 0;
+    }
+
+    int status = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const int fd = open(argv[i], O_RDONLY);
+
+        if (fd < 0) {
+            fprintf(stderr, "cat: %s: cannot open\n", argv[i]);
+            status = 1;
+            continue;
+        }
+
+        if (copy(fd) < 0) {
+            status = 1;
+        }
+
+        close(fd);
+    }
+
+    return status;
+}
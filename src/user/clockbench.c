@@ -0,0 +1,95 @@
+/**
+ * Clock benchmark for hltOS
+ *
+ * Reads CLOCK_MONOTONIC a million times through libc, which musl serves
+ * from the vDSO without entering the kernel, then a million times through
+ * the raw clock_gettime syscall, and reports the cost of each.
+ *
+ * Also checks that the two agree and that neither ever goes backwards,
+ * and prints the wall clock and cpu libc sees.
+ */
+
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ITERATIONS 1000000
+
+static uint64_t to_ns(const struct timespec* ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static int raw_clock_gettime(clockid_t clock, struct timespec* ts)
+{
+    return syscall(SYS_clock_gettime, clock, ts);
+}
+
+// Returns the average ns per call, or 0 if the clock ever went backwards
+static uint64_t bench(const char* name, int (*read_clock)(clockid_t, struct timespec*))
+{
+    struct timespec ts;
+    uint64_t prev = 0;
+    int backwards = 0;
+
+    read_clock(CLOCK_MONOTONIC, &ts);
+    const uint64_t start = to_ns(&ts);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        read_clock(CLOCK_MONOTONIC, &ts);
+
+        const uint64_t now = to_ns(&ts);
+
+        if (now < prev) {
+            backwards++;
+        }
+
+        prev = now;
+    }
+
+    const uint64_t per_call = (prev - start) / ITERATIONS;
+
+    printf("%-8s %d reads in %llu ms, %llu ns/read", name, ITERATIONS,
+        (unsigned long long)((prev - start) / 1000000),
+        (unsigned long long)per_call);
+
+    if (backwards) {
+        printf(", WENT BACKWARDS %d times\n", backwards);
+        return 0;
+    }
+
+    printf("\n");
+
+    return per_call;
+}
+
+int main(void)
+{
+    struct timespec vdso;
+    struct timespec sys;
+
+    clock_gettime(CLOCK_MONOTONIC, &vdso);
+    raw_clock_gettime(CLOCK_MONOTONIC, &sys);
+
+    printf("vdso/syscall skew: %lld ns\n", (long long)(to_ns(&sys) - to_ns(&vdso)));
+
+    const uint64_t vdso_ns = bench("vdso", clock_gettime);
+    const uint64_t sys_ns = bench("syscall", raw_clock_gettime);
+
+    if (vdso_ns > 0 && sys_ns > 0) {
+        printf("vdso is %llux faster\n", (unsigned long long)(sys_ns / vdso_ns));
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    printf("time() = %lld, CLOCK_REALTIME = %lld.%09ld, cpu = %d\n",
+        (long long)time(NULL), (long long)now.tv_sec, now.tv_nsec, sched_getcpu());
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * File copy benchmark for hltOS
+ *
+ * Copies /bin/shell from the initramfs into /tmp over and over, three ways:
+ * read()/write() through a user buffer like cp, sendfile(), and
+ * copy_file_range(). The last two never bring the data into userspace.
+ *
+ * Reports the time per copy for each and checks every copy against the
+ * original.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ITERATIONS 200
+#define BUFFER_SIZE 4096
+
+#define SOURCE "/bin/shell"
+
+static char g_buffer[BUFFER_SIZE];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static long copy_read_write(int in, int out, size_t size)
+{
+    size_t total = 0;
+
+    while (total < size) {
+        const ssize_t n = read(in, g_buffer, sizeof(g_buffer));
+
+        if (n <= 0 || write(out, g_buffer, n) != n) {
+            return -1;
+        }
+
+        total += n;
+    }
+
+    return total;
+}
+
+static long copy_sendfile(int in, int out, size_t size)
+{
+    return sendfile(out, in, NULL, size);
+}
+
+static long copy_range(int in, int out, size_t size)
+{
+    // Called through syscall() as older musl has no wrapper
+    return syscall(SYS_copy_file_range, in, NULL, out, NULL, size, 0);
+}
+
+static int verify(const char* path, const char* original, size_t size)
+{
+    char* copy = malloc(size);
+    const int fd = open(path, O_RDONLY);
+    const int ok = fd >= 0 && read(fd, copy, size) == (ssize_t)size && memcmp(copy, original, size) == 0;
+
+    close(fd);
+    free(copy);
+
+    return ok;
+}
+
+static void bench(const char* name, const char* dest, long (*copy)(int, int, size_t), const char* original, size_t size)
+{
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        const int in = open(SOURCE, O_RDONLY);
+        const int out = open(dest, O_WRONLY | O_CREAT, 0644);
+
+        if (copy(in, out, size) != (long)size) {
+            printf("%-16s copy %d failed\n", name, i);
+            return;
+        }
+
+        close(in);
+        close(out);
+    }
+
+    const uint64_t ns = now_ns() - start;
+
+    printf("%-16s %d copies of %zu bytes in %llu ms, %llu us/copy%s\n", name, ITERATIONS, size,
+        (unsigned long long)(ns / 1000000), (unsigned long long)(ns / ITERATIONS / 1000),
+        verify(dest, original, size) ? "" : ", COPY DIFFERS");
+}
+
+// Reads the whole of path into a malloc'd buffer
+static char* slurp(const char* path, size_t* size)
+{
+    const int fd = open(path, O_RDONLY);
+    size_t capacity = 64 * 1024;
+    char* data = malloc(capacity);
+    ssize_t n;
+
+    *size = 0;
+
+    if (fd < 0) {
+        free(data);
+        return NULL;
+    }
+
+    while ((n = read(fd, data + *size, capacity - *size)) > 0) {
+        *size += n;
+
+        if (*size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+
+    close(fd);
+
+    return data;
+}
+
+int main(void)
+{
+    size_t size;
+    char* original = slurp(SOURCE, &size);
+
+    if (original == NULL || size == 0) {
+        printf("cannot read %s\n", SOURCE);
+        return 1;
+    }
+
+    bench("read/write", "/tmp/copy_rw", copy_read_write, original, size);
+    bench("sendfile", "/tmp/copy_sendfile", copy_sendfile, original, size);
+    bench("copy_file_range", "/tmp/copy_range", copy_range, original, size);
+
+    free(original);
+
+    return 0;
+}
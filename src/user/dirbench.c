@@ -0,0 +1,172 @@
+/**
+ * Large directory benchmark for hltOS
+ *
+ * Runs a spool-like workload in one tmpfs directory: create FILES entries,
+ * open each by name, rename each, list the directory, then unlink them all.
+ * Every name operation is a hash probe, so the time per operation should
+ * stay flat as FILES grows instead of growing with the directory.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILES 10000
+
+#define ROOT "/tmp/dirbench"
+
+static char g_dents[4096];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char* name, uint64_t start, int failed)
+{
+    const uint64_t ns = now_ns() - start;
+
+    printf("%-8s %d in %llu ms, %llu ns/op%s\n", name, FILES, (unsigned long long)(ns / 1000000),
+        (unsigned long long)(ns / FILES), failed ? ", FAILED" : "");
+}
+
+static int create_all(void)
+{
+    char path[64];
+    int failed = 0;
+
+    for (int i = 0; i < FILES; i++) {
+        snprintf(path, sizeof(path), ROOT "/msg%d", i);
+
+        const int fd = open(path, O_WRONLY | O_CREAT, 0644);
+
+        if (fd < 0) {
+            failed++;
+            continue;
+        }
+
+        close(fd);
+    }
+
+    return failed;
+}
+
+static int open_all(void)
+{
+    char path[64];
+    int failed = 0;
+
+    for (int i = 0; i < FILES; i++) {
+        snprintf(path, sizeof(path), ROOT "/msg%d", i);
+
+        const int fd = open(path, O_RDONLY);
+
+        if (fd < 0) {
+            failed++;
+            continue;
+        }
+
+        close(fd);
+    }
+
+    return failed;
+}
+
+static int rename_all(void)
+{
+    char from[64];
+    char to[64];
+    int failed = 0;
+
+    for (int i = 0; i < FILES; i++) {
+        snprintf(from, sizeof(from), ROOT "/msg%d", i);
+        snprintf(to, sizeof(to), ROOT "/done%d", i);
+
+        if (rename(from, to) < 0) {
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+static int list_all(void)
+{
+    const int fd = open(ROOT, O_RDONLY);
+
+    if (fd < 0) {
+        return FILES;
+    }
+
+    int entries = 0;
+    long n;
+
+    while ((n = syscall(SYS_getdents64, fd, g_dents, sizeof(g_dents))) > 0) {
+        for (long pos = 0; pos < n;) {
+            const unsigned short reclen = *(unsigned short*)(g_dents + pos + 16);
+
+            entries++;
+            pos += reclen;
+        }
+    }
+
+    close(fd);
+
+    return entries != FILES;
+}
+
+static int unlink_all(void)
+{
+    char path[64];
+    int failed = 0;
+
+    for (int i = 0; i < FILES; i++) {
+        snprintf(path, sizeof(path), ROOT "/done%d", i);
+
+        if (unlink(path) < 0) {
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    if (mkdir(ROOT, 0755) < 0) {
+        puts("cannot create " ROOT);
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    report("create", start, create_all());
+
+    start = now_ns();
+    report("open", start, open_all());
+
+    start = now_ns();
+    report("rename", start, rename_all());
+
+    start = now_ns();
+    report("list", start, list_all());
+
+    start = now_ns();
+    report("unlink", start, unlink_all());
+
+    if (rmdir(ROOT) < 0) {
+        puts("rmdir " ROOT " failed, directory not empty");
+        return 1;
+    }
+
+    return 0;
+}
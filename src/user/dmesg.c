@@ -0,0 +1,82 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Prints the kernel log from /dev/kmsg. Each record there is a line of the
+// form "<priority>,<sequence>,<usec>,-;<text>", the header is turned into a
+// "[seconds.micros]" timestamp like the real dmesg.
+
+static const char* priority_name(int priority)
+{
+    switch (priority) {
+    case 3:
+        return "err";
+    case 4:
+        return "warn";
+    case 5:
+        return "notice";
+    case 6:
+        return "info";
+    case 7:
+        return "debug";
+    default:
+        return "?";
+    }
+}
+
+static void print_record(char* line, int show_level)
+{
+    char* text = strchr(line, ';');
+
+    if (text == NULL) {
+        printf("%s\n", line);
+        return;
+    }
+
+    *text++ = '\0';
+
+    int priority = 0;
+    unsigned long long seq = 0;
+    unsigned long long usec = 0;
+
+    sscanf(line, "%d,%llu,%llu", &priority, &seq, &usec);
+
+    if (show_level) {
+        printf("%-6s ", priority_name(priority));
+    }
+
+    printf("[%5llu.%06llu] %s\n", usec / 1000000, usec % 1000000, text);
+}
+
+int main(int argc, char** argv)
+{
+    int show_level = argc > 1 && strcmp(argv[1], "-l") == 0;
+    int fd = open("/dev/kmsg", O_RDONLY);
+
+    if (fd < 0) {
+        printf("dmesg: can not open /dev/kmsg\n");
+        return 1;
+    }
+
+    char buf[1024];
+    char line[512];
+    size_t line_len = 0;
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                line[line_len] = '\0';
+                print_record(line, show_level);
+                line_len = 0;
+            } else if (line_len < sizeof(line) - 1) {
+                line[line_len++] = buf[i];
+            }
+        }
+    }
+
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * epoll event loop demo for hltOS
+ *
+ * One process waits on the keyboard, a pipe and a timer at once: a forked
+ * child writes a tick into the pipe every second, lines typed at the
+ * keyboard are echoed back, and epoll_wait()'s timeout prints a note when
+ * nothing happened for a while. Type "quit" to stop.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define IDLE_TIMEOUT_MS 2500
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void ticker(int fd)
+{
+    for (int n = 1;; n++) {
+        syscall(SYS_nanosleep, 1000);
+
+        if (write(fd, &n, sizeof(n)) != sizeof(n)) {
+            _exit(0);
+        }
+    }
+}
+
+int main(void)
+{
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        puts("pipe failed");
+        return 1;
+    }
+
+    const pid_t child = fork();
+
+    if (child == 0) {
+        close(fds[0]);
+        ticker(fds[1]);
+    }
+
+    close(fds[1]);
+
+    // Drained until EAGAIN below, as an edge or a slow loop may see several
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    const int ep = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = 0};
+
+    epoll_ctl(ep, EPOLL_CTL_ADD, 0, &ev);
+    ev.data.fd = fds[0];
+    epoll_ctl(ep, EPOLL_CTL_ADD, fds[0], &ev);
+
+    puts("waiting on the keyboard, a pipe and a timer, type 'quit' to stop");
+
+    int running = 1;
+
+    while (running) {
+        struct epoll_event events[2];
+        const int n = epoll_wait(ep, events, 2, IDLE_TIMEOUT_MS);
+
+        if (n == 0) {
+            puts("timer: idle");
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == 0) {
+                char line[128];
+                const ssize_t len = read(0, line, sizeof(line) - 1);
+
+                line[len > 0 ? len : 0] = '\0';
+                running = strcmp(line, "quit") != 0;
+                printf("keyboard: '%s'\n", line);
+            } else {
+                int tick;
+
+                while (read(fds[0], &tick, sizeof(tick)) == sizeof(tick)) {
+                    printf("pipe: tick %d\n", tick);
+                }
+            }
+        }
+    }
+
+    // The ticker fails its next write and exits
+    close(fds[0]);
+    close(ep);
+    waitpid(child, NULL, 0);
+
+    return 0;
+}
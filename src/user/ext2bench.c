@@ -0,0 +1,226 @@
+/**
+ * ext2 and page cache benchmark for hltOS
+ *
+ * Writes a FILE_MB MiB file on an ext2 mount (/mnt by default, or the
+ * directory given) and times fsync(), then reads it back three times: once
+ * from the disk and twice from the page cache. Every read is checked
+ * against what was written. A plain memcpy of the same size is timed for
+ * comparison, a cached read should come close to it.
+ *
+ * The cache is emptied before the first read by dropping cache.max_mb to 1
+ * through /proc/sys/cache/max_mb and creating a file, which evicts every
+ * clean page. The old limit is put back before reading.
+ *
+ *     mkfs && mount /dev/ram0 /mnt && ext2bench
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FILE_MB 16
+#define CHUNK (64 * 1024)
+#define MAX_MB_PATH "/proc/sys/cache/max_mb"
+
+static char g_buffer[CHUNK];
+static char g_path[256];
+static char g_scratch[256];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t mib_per_s(uint64_t bytes, uint64_t ns)
+{
+    return ns ? bytes * 1000000000ULL / ns / (1024 * 1024) : 0;
+}
+
+// Each chunk starts with its own index, so a read from the wrong place shows
+static void fill(size_t index)
+{
+    memset(g_buffer, (int)(index & 0xFF), CHUNK);
+    memcpy(g_buffer, &index, sizeof(index));
+}
+
+static int write_file(void)
+{
+    const size_t chunks = (size_t)FILE_MB * 1024 * 1024 / CHUNK;
+    const int fd = open(g_path, O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0) {
+        printf("cannot create %s\n", g_path);
+        return -1;
+    }
+
+    const uint64_t start = now_ns();
+
+    for (size_t i = 0; i < chunks; i++) {
+        fill(i);
+
+        if (write(fd, g_buffer, CHUNK) != CHUNK) {
+            printf("write failed at chunk %zu\n", i);
+            close(fd);
+            return -1;
+        }
+    }
+
+    const uint64_t write_ns = now_ns() - start;
+
+    fsync(fd);
+
+    const uint64_t sync_ns = now_ns() - start - write_ns;
+
+    close(fd);
+
+    printf("write: %5llu MiB/s, fsync: %llu ms\n", (unsigned long long)mib_per_s(chunks * CHUNK, write_ns),
+        (unsigned long long)(sync_ns / 1000000));
+
+    return 0;
+}
+
+static int read_file(const char* what)
+{
+    const size_t chunks = (size_t)FILE_MB * 1024 * 1024 / CHUNK;
+    const int fd = open(g_path, O_RDONLY);
+    int wrong = 0;
+
+    if (fd < 0) {
+        printf("cannot open %s\n", g_path);
+        return -1;
+    }
+
+    const uint64_t start = now_ns();
+
+    for (size_t i = 0; i < chunks; i++) {
+        size_t index;
+
+        if (read(fd, g_buffer, CHUNK) != CHUNK) {
+            printf("read failed at chunk %zu\n", i);
+            close(fd);
+            return -1;
+        }
+
+        memcpy(&index, g_buffer, sizeof(index));
+        wrong |= index != i || (unsigned char)g_buffer[CHUNK - 1] != (i & 0xFF);
+    }
+
+    const uint64_t ns = now_ns() - start;
+
+    close(fd);
+
+    printf("%-12s %5llu MiB/s%s\n", what, (unsigned long long)mib_per_s(chunks * CHUNK, ns), wrong ? "  WRONG DATA" : "");
+
+    return wrong ? -1 : 0;
+}
+
+static int set_max_mb(const char* value)
+{
+    const int fd = open(MAX_MB_PATH, O_WRONLY);
+    const int ok = fd >= 0 && write(fd, value, strlen(value)) == (ssize_t)strlen(value);
+
+    close(fd);
+
+    return ok ? 0 : -1;
+}
+
+// Evict every clean page, then put the limit back
+static int drop_cache(void)
+{
+    char old[32] = {0};
+    int fd = open(MAX_MB_PATH, O_RDONLY);
+
+    if (fd < 0 || read(fd, old, sizeof(old) - 1) <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+
+    if (set_max_mb("1") < 0) {
+        return -1;
+    }
+
+    // A new page is what makes the cache evict
+    fd = open(g_scratch, O_WRONLY | O_CREAT, 0644);
+
+    if (fd >= 0) {
+        const int written = write(fd, "x", 1) == 1;
+
+        close(fd);
+        unlink(g_scratch);
+
+        if (!written) {
+            set_max_mb(old);
+            return -1;
+        }
+    }
+
+    return set_max_mb(old);
+}
+
+static void bench_memcpy(void)
+{
+    const size_t size = (size_t)FILE_MB * 1024 * 1024;
+    char* src = malloc(size);
+    char* dst = malloc(size);
+
+    if (!src || !dst) {
+        free(src);
+        free(dst);
+        return;
+    }
+
+    memset(src, 1, size);
+    memset(dst, 0, size);
+
+    const uint64_t start = now_ns();
+
+    for (size_t off = 0; off < size; off += CHUNK) {
+        memcpy(dst + off, src + off, CHUNK);
+    }
+
+    const uint64_t ns = now_ns() - start;
+
+    printf("%-12s %5llu MiB/s\n", "memcpy:", (unsigned long long)mib_per_s(size, ns));
+
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argc > 1 ? argv[1] : "/mnt";
+    int status = 0;
+
+    snprintf(g_path, sizeof(g_path), "%s/ext2bench.dat", dir);
+    snprintf(g_scratch, sizeof(g_scratch), "%s/ext2bench.tmp", dir);
+
+    if (write_file() < 0) {
+        puts("is an ext2 filesystem mounted there? mkfs && mount /dev/ram0 /mnt");
+        return 1;
+    }
+
+    if (drop_cache() < 0) {
+        puts("cannot write " MAX_MB_PATH ", the first read may be cached");
+    }
+
+    status |= read_file("disk read:") < 0;
+    status |= read_file("cached read:") < 0;
+    status |= read_file("cached read:") < 0;
+    bench_memcpy();
+
+    unlink(g_path);
+
+    return status;
+}
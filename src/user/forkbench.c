@@ -0,0 +1,74 @@
+/**
+ * fork/exit benchmark for hltOS
+ *
+ * Repeatedly forks a child that exits immediately and waits for it, then
+ * reports the average cost of one fork + exit + wait round trip. Freed
+ * processes and kernel stacks are recycled by the kernel, so after the first
+ * few iterations no new allocations should be needed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define ITERATIONS 1000
+#define WARMUP 16
+
+static uint64_t tsc_per_ms;
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void calibrate(void)
+{
+    uint64_t start = __rdtsc();
+    syscall(SYS_nanosleep, 100);
+    tsc_per_ms = (__rdtsc() - start) / 100;
+}
+
+static int fork_and_wait(void)
+{
+    const pid_t pid = fork();
+
+    if (pid == 0) {
+        _exit(0);
+    }
+
+    if (pid < 0) {
+        return -1;
+    }
+
+    int status;
+    wait4(pid, &status, 0, NULL);
+
+    return 0;
+}
+
+int main(void)
+{
+    calibrate();
+
+    for (int i = 0; i < WARMUP; i++) {
+        fork_and_wait();
+    }
+
+    const uint64_t start = __rdtsc();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (fork_and_wait() < 0) {
+            printf("forkbench: fork failed after %d iterations\n", i);
+            return 1;
+        }
+    }
+
+    const uint64_t elapsed = __rdtsc() - start;
+
+    printf("forkbench: %d fork/exit/wait iterations in %lu ms, %lu us each\n",
+        ITERATIONS,
+        (unsigned long)(elapsed / tsc_per_ms),
+        (unsigned long)(elapsed * 1000 / ITERATIONS / tsc_per_ms));
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * Futex benchmark for hltOS
+ *
+ * Runs several threads that increment a shared counter under one pthread
+ * mutex and reports the cost of each lock/unlock pair, then checks that no
+ * increment was lost.
+ *
+ * A second run holds the mutex while sleeping, with the other threads
+ * stuck in pthread_mutex_lock(). A counting thread measures how much CPU
+ * time is left over. Blocked waiters sleep in the kernel, so the count
+ * should match a run with no waiters. If they spun, it would drop sharply.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define NUM_THREADS 4
+#define ITERATIONS 20000
+#define HOLD_MS 500
+
+static uint64_t tsc_per_ms;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint64_t counter;
+static volatile int counting;
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void sleep_ms(long ms)
+{
+    syscall(SYS_nanosleep, ms);
+}
+
+static void calibrate(void)
+{
+    uint64_t start = __rdtsc();
+    sleep_ms(100);
+    tsc_per_ms = (__rdtsc() - start) / 100;
+}
+
+static void* increment_thread(void* arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        pthread_mutex_lock(&lock);
+        counter++;
+        pthread_mutex_unlock(&lock);
+    }
+
+    return NULL;
+}
+
+static void* waiter_thread(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+static void* count_thread(void* arg)
+{
+    uint64_t* iterations = arg;
+
+    while (counting) {
+        (*iterations)++;
+    }
+
+    return NULL;
+}
+
+// Count how far count_thread gets while the main thread sleeps holding the
+// mutex and `waiters` threads are blocked on it
+static uint64_t hold_and_count(int waiters)
+{
+    pthread_t threads[NUM_THREADS];
+    pthread_t counter_thread;
+    uint64_t iterations = 0;
+
+    pthread_mutex_lock(&lock);
+
+    for (int i = 0; i < waiters; i++) {
+        pthread_create(&threads[i], NULL, waiter_thread, NULL);
+    }
+
+    counting = 1;
+    pthread_create(&counter_thread, NULL, count_thread, &iterations);
+
+    sleep_ms(HOLD_MS);
+
+    counting = 0;
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(counter_thread, NULL);
+
+    for (int i = 0; i < waiters; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return iterations;
+}
+
+int main(void)
+{
+    pthread_t threads[NUM_THREADS];
+
+    calibrate();
+
+    const uint64_t start = __rdtsc();
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_create(&threads[i], NULL, increment_thread, NULL);
+    }
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    const uint64_t elapsed = __rdtsc() - start;
+    const uint64_t expected = (uint64_t)NUM_THREADS * ITERATIONS;
+
+    printf("futexbench: %d threads x %d lock/unlock in %lu ms, %lu ns each\n",
+        NUM_THREADS,
+        ITERATIONS,
+        (unsigned long)(elapsed / tsc_per_ms),
+        (unsigned long)(elapsed * 1000000 / expected / tsc_per_ms));
+
+    printf("futexbench: counter %lu, expected %lu (%s)\n",
+        (unsigned long)counter,
+        (unsigned long)expected,
+        counter == expected ? "ok" : "LOST UPDATES");
+
+    const uint64_t idle = hold_and_count(0);
+    const uint64_t contended = hold_and_count(NUM_THREADS);
+
+    printf("futexbench: spare cpu while mutex held %d ms: %lu iterations alone, %lu with %d blocked waiters (%lu%%)\n",
+        HOLD_MS,
+        (unsigned long)idle,
+        (unsigned long)contended,
+        NUM_THREADS,
+        (unsigned long)(idle != 0 ? contended * 100 / idle : 0));
+
+    return counter == expected ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+/**
+ * ext2 formatter for hltOS
+ *
+ * Usage: mkfs [-b block_size] [device]
+ *
+ * Writes an empty ext2 filesystem (revision 1, 128-byte inodes, typed
+ * directory entries) over the whole of device, /dev/ram0 by default. Block
+ * size is 1024, 2048 or 4096, default 1024. Every group keeps a copy of the
+ * superblock and group descriptors, so sparse_super is not needed. Only the
+ * root directory is created, e2fsck makes lost+found if it is wanted.
+ *
+ * Then: mount /dev/ram0 /mnt ext2
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BLKGETSIZE64_REQ 0x80081272
+
+#define EXT2_MAGIC 0xEF53
+#define ROOT_INO 2
+#define FIRST_INO 11
+#define INODE_SIZE 128
+#define BYTES_PER_INODE 8192
+#define INCOMPAT_FILETYPE 0x0002
+#define RO_COMPAT_LARGE_FILE 0x0002
+#define FT_DIR 2
+
+struct superblock {
+    uint32_t inodes_count;
+    uint32_t blocks_count;
+    uint32_t r_blocks_count;
+    uint32_t free_blocks_count;
+    uint32_t free_inodes_count;
+    uint32_t first_data_block;
+    uint32_t log_block_size;
+    uint32_t log_frag_size;
+    uint32_t blocks_per_group;
+    uint32_t frags_per_group;
+    uint32_t inodes_per_group;
+    uint32_t mtime;
+    uint32_t wtime;
+    uint16_t mnt_count;
+    int16_t max_mnt_count;
+    uint16_t magic;
+    uint16_t state;
+    uint16_t errors;
+    uint16_t minor_rev_level;
+    uint32_t lastcheck;
+    uint32_t checkinterval;
+    uint32_t creator_os;
+    uint32_t rev_level;
+    uint16_t def_resuid;
+    uint16_t def_resgid;
+    uint32_t first_ino;
+    uint16_t inode_size;
+    uint16_t block_group_nr;
+    uint32_t feature_compat;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint8_t uuid[16];
+    char volume_name[16];
+    char last_mounted[64];
+    uint32_t algo_bitmap;
+    uint8_t reserved[820];
+} __attribute__((packed));
+
+struct group_desc {
+    uint32_t block_bitmap;
+    uint32_t inode_bitmap;
+    uint32_t inode_table;
+    uint16_t free_blocks_count;
+    uint16_t free_inodes_count;
+    uint16_t used_dirs_count;
+    uint16_t padding;
+    uint8_t reserved[12];
+} __attribute__((packed));
+
+struct inode {
+    uint16_t mode;
+    uint16_t uid;
+    uint32_t size;
+    uint32_t atime;
+    uint32_t ctime;
+    uint32_t mtime;
+    uint32_t dtime;
+    uint16_t gid;
+    uint16_t links_count;
+    uint32_t blocks;
+    uint32_t flags;
+    uint32_t osd1;
+    uint32_t block[15];
+    uint32_t generation;
+    uint32_t file_acl;
+    uint32_t size_high;
+    uint32_t faddr;
+    uint8_t osd2[12];
+} __attribute__((packed));
+
+struct dir_entry {
+    uint32_t inode;
+    uint16_t rec_len;
+    uint8_t name_len;
+    uint8_t file_type;
+    char name[4];
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct superblock) == 1024, "superblock is 1024 bytes");
+_Static_assert(sizeof(struct group_desc) == 32, "group descriptor is 32 bytes");
+_Static_assert(sizeof(struct inode) == INODE_SIZE, "inode is 128 bytes");
+
+static int g_fd;
+static uint32_t g_block_size;
+
+static int write_block(uint32_t block, const void* data)
+{
+    const off_t offset = (off_t)block * g_block_size;
+
+    if (pwrite(g_fd, data, g_block_size, offset) != (ssize_t)g_block_size) {
+        printf("write of block %u failed\n", block);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void set_bits(uint8_t* bits, uint32_t first, uint32_t end)
+{
+    for (uint32_t bit = first; bit < end; bit++) {
+        bits[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+static uint64_t device_size(void)
+{
+    uint64_t size = 0;
+    struct stat st;
+
+    if (ioctl(g_fd, BLKGETSIZE64_REQ, &size) == 0 && size > 0) {
+        return size;
+    }
+
+    return fstat(g_fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = "/dev/ram0";
+
+    g_block_size = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            g_block_size = (uint32_t)atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (g_block_size != 1024 && g_block_size != 2048 && g_block_size != 4096) {
+        puts("usage: mkfs [-b 1024|2048|4096] [device]");
+        return 1;
+    }
+
+    g_fd = open(path, O_RDWR);
+
+    if (g_fd < 0) {
+        printf("cannot open %s\n", path);
+        return 1;
+    }
+
+    const uint32_t bs = g_block_size;
+    const uint64_t size = device_size();
+    const uint32_t first_data_block = bs == 1024 ? 1 : 0;
+    const uint32_t blocks_per_group = bs * 8;
+    const uint32_t inodes_per_block = bs / INODE_SIZE;
+    uint64_t blocks = size / bs;
+
+    if (blocks > 0xFFFFFFFFULL) {
+        blocks = 0xFFFFFFFFULL;
+    }
+
+    uint32_t groups = (uint32_t)((blocks - first_data_block + blocks_per_group - 1) / blocks_per_group);
+    uint32_t inodes_per_group = (uint32_t)(blocks_per_group * (uint64_t)bs / BYTES_PER_INODE);
+
+    inodes_per_group = (inodes_per_group + inodes_per_block - 1) / inodes_per_block * inodes_per_block;
+
+    if (inodes_per_group < 16) {
+        inodes_per_group = 16;
+    }
+
+    const uint32_t gdt_blocks = (groups * (uint32_t)sizeof(struct group_desc) + bs - 1) / bs;
+    const uint32_t table_blocks = inodes_per_group / inodes_per_block;
+    // Superblock, descriptors, two bitmaps, inode table
+    const uint32_t overhead = 1 + gdt_blocks + 2 + table_blocks;
+
+    // A last group too small for its own metadata is left off the end
+    const uint32_t last_blocks = (uint32_t)(blocks - first_data_block - (uint64_t)(groups - 1) * blocks_per_group);
+
+    if (groups > 1 && last_blocks < overhead + 16) {
+        groups--;
+        blocks = first_data_block + (uint64_t)groups * blocks_per_group;
+    }
+
+    if (groups == 0 || blocks < first_data_block + overhead + 16) {
+        printf("%s is too small for ext2\n", path);
+        close(g_fd);
+        return 1;
+    }
+
+    struct superblock sb;
+    struct group_desc* gdt = calloc(gdt_blocks, bs);
+    uint8_t* block = malloc(bs);
+    uint8_t* zeros = calloc(1, bs);
+    const uint32_t now = (uint32_t)time(NULL);
+    uint32_t free_blocks = 0;
+
+    memset(&sb, 0, sizeof(sb));
+    sb.inodes_count = groups * inodes_per_group;
+    sb.blocks_count = (uint32_t)blocks;
+    sb.first_data_block = first_data_block;
+    sb.log_block_size = bs == 1024 ? 0 : bs == 2048 ? 1 : 2;
+    sb.log_frag_size = sb.log_block_size;
+    sb.blocks_per_group = blocks_per_group;
+    sb.frags_per_group = blocks_per_group;
+    sb.inodes_per_group = inodes_per_group;
+    sb.wtime = now;
+    sb.lastcheck = now;
+    sb.max_mnt_count = -1;
+    sb.magic = EXT2_MAGIC;
+    sb.state = 1;  // Clean
+    sb.errors = 1; // Continue
+    sb.rev_level = 1;
+    sb.first_ino = FIRST_INO;
+    sb.inode_size = INODE_SIZE;
+    sb.feature_incompat = INCOMPAT_FILETYPE;
+    sb.feature_ro_compat = RO_COMPAT_LARGE_FILE;
+    strcpy(sb.volume_name, "hltos");
+
+    for (int i = 0; i < 16; i++) {
+        sb.uuid[i] = (uint8_t)((now >> (i % 4 * 8)) * 31 + i * 17);
+    }
+
+    const uint32_t root_block = first_data_block + overhead;
+
+    for (uint32_t g = 0; g < groups; g++) {
+        const uint32_t base = first_data_block + g * blocks_per_group;
+        const uint64_t left = blocks - base;
+        const uint32_t count = left < blocks_per_group ? (uint32_t)left : blocks_per_group;
+        // Group 0 also holds the root directory's block
+        const uint32_t used = overhead + (g == 0);
+
+        gdt[g].block_bitmap = base + 1 + gdt_blocks;
+        gdt[g].inode_bitmap = gdt[g].block_bitmap + 1;
+        gdt[g].inode_table = gdt[g].inode_bitmap + 1;
+        gdt[g].free_blocks_count = (uint16_t)(count - used);
+        gdt[g].free_inodes_count = (uint16_t)(inodes_per_group - (g == 0 ? FIRST_INO - 1 : 0));
+        gdt[g].used_dirs_count = g == 0;
+
+        free_blocks += count - used;
+
+        // Bit i is block base + i, bits past the end of the disk stay set
+        memset(block, 0, bs);
+        set_bits(block, 0, used);
+        set_bits(block, count, bs * 8);
+
+        if (write_block(gdt[g].block_bitmap, block) < 0) {
+            return 1;
+        }
+
+        memset(block, 0, bs);
+        set_bits(block, inodes_per_group, bs * 8);
+
+        if (g == 0) {
+            set_bits(block, 0, FIRST_INO - 1);
+        }
+
+        if (write_block(gdt[g].inode_bitmap, block) < 0) {
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < table_blocks; i++) {
+            if (write_block(gdt[g].inode_table + i, zeros) < 0) {
+                return 1;
+            }
+        }
+    }
+
+    sb.free_blocks_count = free_blocks;
+    sb.free_inodes_count = sb.inodes_count - (FIRST_INO - 1);
+
+    // Superblock and descriptors, the primary copy and one per group
+    for (uint32_t g = 0; g < groups; g++) {
+        const uint32_t base = first_data_block + g * blocks_per_group;
+
+        sb.block_group_nr = (uint16_t)g;
+        memset(block, 0, bs);
+
+        if (g == 0 && bs > 1024) {
+            memcpy(block + 1024, &sb, sizeof(sb));
+        } else {
+            memcpy(block, &sb, sizeof(sb));
+        }
+
+        if (write_block(base, block) < 0) {
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < gdt_blocks; i++) {
+            if (write_block(base + 1 + i, (uint8_t*)gdt + (size_t)i * bs) < 0) {
+                return 1;
+            }
+        }
+    }
+
+    // The root directory: "." and ".." in one block
+    memset(block, 0, bs);
+
+    struct dir_entry dot = {ROOT_INO, 12, 1, FT_DIR, "."};
+    struct dir_entry dotdot = {ROOT_INO, (uint16_t)(bs - 12), 2, FT_DIR, ".."};
+
+    memcpy(block, &dot, sizeof(dot));
+    memcpy(block + 12, &dotdot, sizeof(dotdot));
+
+    if (write_block(root_block, block) < 0) {
+        return 1;
+    }
+
+    struct inode root;
+
+    memset(&root, 0, sizeof(root));
+    root.mode = 040755;
+    root.size = bs;
+    root.atime = root.ctime = root.mtime = now;
+    root.links_count = 2;
+    root.blocks = bs / 512;
+    root.block[0] = root_block;
+
+    memset(block, 0, bs);
+    memcpy(block + (ROOT_INO - 1) * INODE_SIZE, &root, sizeof(root));
+
+    if (write_block(gdt[0].inode_table, block) < 0) {
+        return 1;
+    }
+
+    fsync(g_fd);
+    close(g_fd);
+
+    printf("%s: ext2, %u blocks of %u bytes, %u groups, %u inodes\n", path, sb.blocks_count, bs, groups,
+        sb.inodes_count);
+
+    free(gdt);
+    free(block);
+    free(zeros);
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mount.h>
+
+// Mounts a filesystem: "mount /dev/ram0 /mnt ext2", or "mount none /tmp2
+// tmpfs". The type defaults to ext2. The directory must already exist.
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        puts("usage: mount <device> <dir> [ext2|tmpfs]");
+        return 1;
+    }
+
+    const char* type = argc > 3 ? argv[3] : "ext2";
+
+    if (mount(argv[1], argv[2], type, 0, NULL) < 0) {
+        printf("mount %s on %s: %s\n", argv[1], argv[2], strerror(errno));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Path lookup benchmark for hltOS
+ *
+ * Builds a directory tree DEPTH levels deep under /tmp with FILES_PER_DIR
+ * entries at every level, then opens a file at the bottom (and one that is
+ * not there) over and over, with the dentry cache off and on. Without the
+ * cache each component is a scan of its directory, with it a hash probe.
+ *
+ * The cache is switched through /proc/sys/fs/dcache and left on at exit.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEPTH 8
+#define FILES_PER_DIR 500
+#define ITERATIONS 20000
+
+#define ROOT "/tmp/pathbench"
+
+static char g_deep_file[256];
+static char g_missing_file[256];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int set_dcache(int on)
+{
+    const int fd = open("/proc/sys/fs/dcache", O_WRONLY);
+    const int ok = fd >= 0 && write(fd, on ? "1" : "0", 1) == 1;
+
+    close(fd);
+
+    return ok ? 0 : -1;
+}
+
+// Fills dir with FILES_PER_DIR files, the subdirectory to descend into is
+// created last so a lookup of it scans past all of them
+static int fill_dir(const char* dir)
+{
+    char path[256];
+
+    for (int i = 0; i < FILES_PER_DIR; i++) {
+        snprintf(path, sizeof(path), "%s/file%d", dir, i);
+
+        const int fd = open(path, O_WRONLY | O_CREAT, 0644);
+
+        if (fd < 0) {
+            printf("failed to create %s\n", path);
+            return -1;
+        }
+
+        close(fd);
+    }
+
+    return 0;
+}
+
+static int build_tree(void)
+{
+    char dir[256] = ROOT;
+
+    mkdir(dir, 0755);
+
+    for (int level = 0; level < DEPTH; level++) {
+        if (fill_dir(dir) < 0) {
+            return -1;
+        }
+
+        const size_t len = strlen(dir);
+
+        snprintf(dir + len, sizeof(dir) - len, "/level%d", level);
+        mkdir(dir, 0755);
+    }
+
+    if (fill_dir(dir) < 0) {
+        return -1;
+    }
+
+    snprintf(g_deep_file, sizeof(g_deep_file), "%s/file%d", dir, FILES_PER_DIR - 1);
+    snprintf(g_missing_file, sizeof(g_missing_file), "%s/missing", dir);
+
+    return 0;
+}
+
+static void bench(const char* name, const char* path, int expect_found)
+{
+    int wrong = 0;
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        const int fd = open(path, O_RDONLY);
+
+        if ((fd >= 0) != expect_found) {
+            wrong++;
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    const uint64_t ns = now_ns() - start;
+
+    printf("%-24s %d opens in %llu ms, %llu ns/open%s\n", name, ITERATIONS, (unsigned long long)(ns / 1000000),
+        (unsigned long long)(ns / ITERATIONS), wrong ? ", WRONG RESULT" : "");
+}
+
+int main(void)
+{
+    if (build_tree() < 0) {
+        return 1;
+    }
+
+    printf("%d levels, %d entries per directory\n", DEPTH, FILES_PER_DIR + 1);
+
+    if (set_dcache(0) < 0) {
+        puts("cannot switch /proc/sys/fs/dcache");
+        return 1;
+    }
+
+    bench("deep file, no dcache", g_deep_file, 1);
+    bench("missing file, no dcache", g_missing_file, 0);
+
+    set_dcache(1);
+
+    bench("deep file, dcache", g_deep_file, 1);
+    bench("missing file, dcache", g_missing_file, 0);
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Pipe benchmark for hltOS
+ *
+ * Bandwidth: a forked child pushes 64 MiB through a pipe in 64 KiB writes
+ * while the parent reads it back, reported in MiB/s.
+ *
+ * Latency: parent and child bounce a single byte back and forth over two
+ * pipes, reported as the average time for one round trip. Each trip is a
+ * write, a wakeup and a context switch in each direction.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOTAL_BYTES (64ULL * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+#define ROUND_TRIPS 10000
+
+static char g_chunk[CHUNK_SIZE];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_bandwidth(void)
+{
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        puts("pipe failed");
+        return -1;
+    }
+
+    const pid_t pid = fork();
+
+    if (pid == 0) {
+        close(fds[0]);
+        memset(g_chunk, 0xa5, sizeof(g_chunk));
+
+        for (uint64_t sent = 0; sent < TOTAL_BYTES; sent += CHUNK_SIZE) {
+            if (write(fds[1], g_chunk, CHUNK_SIZE) != CHUNK_SIZE) {
+                _exit(1);
+            }
+        }
+
+        _exit(0);
+    }
+
+    close(fds[1]);
+
+    const uint64_t start = now_ns();
+    uint64_t received = 0;
+    ssize_t n;
+
+    while ((n = read(fds[0], g_chunk, sizeof(g_chunk))) > 0) {
+        received += n;
+    }
+
+    const uint64_t ns = now_ns() - start;
+    int status;
+
+    close(fds[0]);
+    wait4(pid, &status, 0, NULL);
+
+    if (received != TOTAL_BYTES) {
+        printf("bandwidth: received %llu of %llu bytes\n", (unsigned long long)received,
+            (unsigned long long)TOTAL_BYTES);
+        return -1;
+    }
+
+    printf("bandwidth  %llu MiB in %llu ms, %llu MiB/s\n", (unsigned long long)(TOTAL_BYTES >> 20),
+        (unsigned long long)(ns / 1000000), (unsigned long long)((TOTAL_BYTES >> 20) * 1000000000ULL / ns));
+
+    return 0;
+}
+
+static int bench_latency(void)
+{
+    int ping[2];
+    int pong[2];
+    char byte = 0;
+
+    if (pipe(ping) < 0 || pipe(pong) < 0) {
+        puts("pipe failed");
+        return -1;
+    }
+
+    const pid_t pid = fork();
+
+    if (pid == 0) {
+        close(ping[1]);
+        close(pong[0]);
+
+        while (read(ping[0], &byte, 1) == 1) {
+            write(pong[1], &byte, 1);
+        }
+
+        _exit(0);
+    }
+
+    close(ping[0]);
+    close(pong[1]);
+
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        if (write(ping[1], &byte, 1) != 1 || read(pong[0], &byte, 1) != 1) {
+            printf("latency: round trip %d failed\n", i);
+            return -1;
+        }
+    }
+
+    const uint64_t ns = now_ns() - start;
+    int status;
+
+    // Closing the write end is what tells the child to exit
+    close(ping[1]);
+    close(pong[0]);
+    wait4(pid, &status, 0, NULL);
+
+    printf("latency    %d round trips in %llu ms, %llu ns/round trip\n", ROUND_TRIPS,
+        (unsigned long long)(ns / 1000000), (unsigned long long)(ns / ROUND_TRIPS));
+
+    return 0;
+}
+
+int main(void)
+{
+    if (bench_bandwidth() < 0 || bench_latency() < 0) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * poll/epoll benchmark for hltOS
+ *
+ * Opens NUM_PIPES pipes and keeps data in just one of them, then times
+ * how long it takes to find it: poll() and select() look at every fd on
+ * each call, epoll_wait() only at the ones that became ready.
+ */
+
+#define _GNU_SOURCE
+
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_PIPES 256
+#define ITERATIONS 10000
+
+static int g_pipes[NUM_PIPES][2];
+static struct pollfd g_pollfds[NUM_PIPES];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char* name, uint64_t ns, int found)
+{
+    printf("%-12s %d fds, %d calls in %llu ms, %llu ns/call%s\n", name, NUM_PIPES, ITERATIONS,
+        (unsigned long long)(ns / 1000000), (unsigned long long)(ns / ITERATIONS),
+        found == ITERATIONS ? "" : ", MISSED EVENTS");
+}
+
+static void bench_poll(void)
+{
+    int found = 0;
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (poll(g_pollfds, NUM_PIPES, 0) == 1) {
+            found++;
+        }
+    }
+
+    report("poll", now_ns() - start, found);
+}
+
+static void bench_select(void)
+{
+    const int nfds = g_pipes[NUM_PIPES - 1][1] + 1;
+    int found = 0;
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        fd_set readfds;
+        struct timeval tv = {0, 0};
+
+        FD_ZERO(&readfds);
+
+        for (int p = 0; p < NUM_PIPES; p++) {
+            FD_SET(g_pipes[p][0], &readfds);
+        }
+
+        if (select(nfds, &readfds, NULL, NULL, &tv) == 1) {
+            found++;
+        }
+    }
+
+    report("select", now_ns() - start, found);
+}
+
+static int bench_epoll(void)
+{
+    const int ep = epoll_create1(0);
+
+    if (ep < 0) {
+        puts("epoll_create1 failed");
+        return -1;
+    }
+
+    for (int p = 0; p < NUM_PIPES; p++) {
+        struct epoll_event ev = {.events = EPOLLIN, .data.u32 = p};
+
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, g_pipes[p][0], &ev) < 0) {
+            printf("epoll_ctl failed for pipe %d\n", p);
+            return -1;
+        }
+    }
+
+    struct epoll_event events[8];
+    int found = 0;
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (epoll_wait(ep, events, 8, 0) == 1 && events[0].data.u32 == NUM_PIPES / 2) {
+            found++;
+        }
+    }
+
+    report("epoll_wait", now_ns() - start, found);
+    close(ep);
+
+    return 0;
+}
+
+int main(void)
+{
+    for (int p = 0; p < NUM_PIPES; p++) {
+        if (pipe(g_pipes[p]) < 0) {
+            printf("pipe %d failed\n", p);
+            return 1;
+        }
+
+        g_pollfds[p].fd = g_pipes[p][0];
+        g_pollfds[p].events = POLLIN;
+    }
+
+    // The one ready fd, never read so it stays ready
+    write(g_pipes[NUM_PIPES / 2][1], "x", 1);
+
+    bench_poll();
+    bench_select();
+
+    return bench_epoll() < 0 ? 1 : 0;
+}
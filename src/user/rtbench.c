@@ -0,0 +1,124 @@
+/**
+ * Real-time scheduling benchmark for hltOS
+ *
+ * Starts a few CPU-bound children and measures how late a process wakes up
+ * from a short sleep, first as a normal process and then again after
+ * switching itself to SCHED_FIFO. A real-time process should preempt the
+ * hogs as soon as its timer expires, so its wakeup latency stays low no
+ * matter how many hogs are running.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define NUM_HOGS 4
+#define HOG_RUN_MS 3000
+#define SLEEP_MS 2
+#define SLEEP_ROUNDS 200
+#define RT_PRIORITY 50
+
+#define POLICY_OTHER 0
+#define POLICY_FIFO 1
+
+struct rt_param {
+    int sched_priority;
+};
+
+static uint64_t tsc_per_ms;
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void sleep_ms(long ms)
+{
+    syscall(SYS_nanosleep, ms);
+}
+
+// musl implements sched_setscheduler() as a stub that always fails, so the
+// syscall is made directly
+static long set_policy(int policy, int priority)
+{
+    struct rt_param param = {priority};
+
+    return syscall(SYS_sched_setscheduler, 0, policy, &param);
+}
+
+static void calibrate(void)
+{
+    uint64_t start = __rdtsc();
+    sleep_ms(100);
+    tsc_per_ms = (__rdtsc() - start) / 100;
+}
+
+static void hog(void)
+{
+    const uint64_t end = __rdtsc() + HOG_RUN_MS * tsc_per_ms;
+    volatile uint64_t iterations = 0;
+
+    while (__rdtsc() < end) {
+        iterations++;
+    }
+
+    _exit(0);
+}
+
+static void measure(const char* label)
+{
+    uint64_t total_late = 0;
+    uint64_t max_late = 0;
+
+    for (int i = 0; i < SLEEP_ROUNDS; i++) {
+        const uint64_t start = __rdtsc();
+        sleep_ms(SLEEP_MS);
+        const uint64_t elapsed = __rdtsc() - start;
+        const uint64_t asked = SLEEP_MS * tsc_per_ms;
+        const uint64_t late = elapsed > asked ? elapsed - asked : 0;
+
+        total_late += late;
+
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+
+    printf("  %-8s avg %lu us, max %lu us\n",
+        label,
+        (unsigned long)(total_late * 1000 / SLEEP_ROUNDS / tsc_per_ms),
+        (unsigned long)(max_late * 1000 / tsc_per_ms));
+}
+
+int main(void)
+{
+    int pids[NUM_HOGS];
+
+    calibrate();
+
+    printf("rtbench: %d hogs, wakeup latency over %d sleeps of %d ms\n", NUM_HOGS, SLEEP_ROUNDS, SLEEP_MS);
+
+    for (int i = 0; i < NUM_HOGS; i++) {
+        pids[i] = fork();
+
+        if (pids[i] == 0) {
+            hog();
+        }
+    }
+
+    measure("normal:");
+
+    if (set_policy(POLICY_FIFO, RT_PRIORITY) < 0) {
+        printf("rtbench: sched_setscheduler(SCHED_FIFO) failed\n");
+    } else {
+        measure("fifo:");
+        set_policy(POLICY_OTHER, 0);
+    }
+
+    for (int i = 0; i < NUM_HOGS; i++) {
+        int status;
+        wait4(pids[i], &status, 0, NULL);
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * Scheduler benchmark for hltOS
+ *
+ * Runs a few CPU-bound children at different nice levels next to an
+ * "interactive" parent that repeatedly sleeps for a short time. Reports how
+ * much work each hog got done (its CPU share) and how late the interactive
+ * process woke up compared to the time it asked for (wakeup latency).
+ *
+ * Boot with `sched=fair` or `sched=rr` in limine.conf to compare schedulers.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define NUM_HOGS 3
+#define HOG_RUN_MS 2000
+#define SLEEP_MS 5
+#define SLEEP_ROUNDS 100
+
+static uint64_t tsc_per_ms;
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void sleep_ms(long ms)
+{
+    syscall(SYS_nanosleep, ms);
+}
+
+static void calibrate(void)
+{
+    uint64_t start = __rdtsc();
+    sleep_ms(100);
+    tsc_per_ms = (__rdtsc() - start) / 100;
+}
+
+static void hog(int nice_value)
+{
+    nice(nice_value);
+
+    const uint64_t end = __rdtsc() + HOG_RUN_MS * tsc_per_ms;
+    volatile uint64_t iterations = 0;
+
+    while (__rdtsc() < end) {
+        iterations++;
+    }
+
+    printf("  hog pid=%d nice=%d: %lu iterations\n", getpid(), nice_value, (unsigned long)iterations);
+    _exit(0);
+}
+
+int main(void)
+{
+    static const int nice_levels[NUM_HOGS] = {0, 5, 10};
+    int pids[NUM_HOGS];
+
+    calibrate();
+
+    printf("schedbench: %lu tsc ticks/ms, %d hogs for %d ms\n",
+        (unsigned long)tsc_per_ms, NUM_HOGS, HOG_RUN_MS);
+
+    for (int i = 0; i < NUM_HOGS; i++) {
+        pids[i] = fork();
+
+        if (pids[i] == 0) {
+            hog(nice_levels[i]);
+        }
+    }
+
+    uint64_t total_late = 0;
+    uint64_t max_late = 0;
+
+    for (int i = 0; i < SLEEP_ROUNDS; i++) {
+        const uint64_t start = __rdtsc();
+        sleep_ms(SLEEP_MS);
+        const uint64_t elapsed = __rdtsc() - start;
+        const uint64_t asked = SLEEP_MS * tsc_per_ms;
+        const uint64_t late = elapsed > asked ? elapsed - asked : 0;
+
+        total_late += late;
+
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+
+    printf("wakeup latency over %d sleeps of %d ms: avg %lu us, max %lu us\n",
+        SLEEP_ROUNDS,
+        SLEEP_MS,
+        (unsigned long)(total_late * 1000 / SLEEP_ROUNDS / tsc_per_ms),
+        (unsigned long)(max_late * 1000 / tsc_per_ms));
+
+    for (int i = 0; i < NUM_HOGS; i++) {
+        int status;
+        wait4(pids[i], &status, 0, NULL);
+    }
+
+    return 0;
+}
@@ -32,6 +32,7 @@ void cmd_help(void)
     puts("  mmap     - Test mmap syscall");
     puts("  mkdir    - Test mkdir syscall");
     puts("  fork     - Test forking this shell");
+    puts("  A | B    - Run /bin programs with each one's output piped into the next");
     puts("  exit     - Exit shell");
 }
 
@@ -150,6 +151,126 @@ void cmd_mkdir(const char* path)
     }
 }
 
+// ============================================================================
+// Pipelines
+// ============================================================================
+
+#define MAX_STAGES 8
+#define MAX_ARGS 16
+
+// Splits str in place on spaces into argv, returns the number of arguments
+static int split_args(char* str, char** argv)
+{
+    int argc = 0;
+
+    while (*str && argc < MAX_ARGS - 1) {
+        while (*str == ' ')
+            *str++ = '\0';
+
+        if (*str == '\0')
+            break;
+
+        argv[argc++] = str;
+
+        while (*str && *str != ' ')
+            str++;
+    }
+
+    argv[argc] = NULL;
+
+    return argc;
+}
+
+static void run_stage(char** argv, int in, int out)
+{
+    char path[128];
+
+    if (in != 0) {
+        dup2(in, 0);
+        close(in);
+    }
+
+    if (out != 1) {
+        dup2(out, 1);
+        close(out);
+    }
+
+    // Bare names are looked up in /bin
+    if (strchr(argv[0], '/')) {
+        snprintf(path, sizeof(path), "%s", argv[0]);
+    } else {
+        snprintf(path, sizeof(path), "/bin/%s", argv[0]);
+    }
+
+    execve(path, argv, NULL);
+
+    fprintf(stderr, "%s: command not found\n", argv[0]);
+    exit(127);
+}
+
+// Runs "a | b | c", each stage in its own child with stdout of one stage
+// wired to stdin of the next through a pipe
+void cmd_pipeline(char* line)
+{
+    char* stages[MAX_STAGES];
+    int num_stages = 0;
+
+    for (char* s = strtok(line, "|"); s && num_stages < MAX_STAGES; s = strtok(NULL, "|")) {
+        stages[num_stages++] = s;
+    }
+
+    int pids[MAX_STAGES];
+    int in = 0;
+
+    for (int i = 0; i < num_stages; i++) {
+        char* argv[MAX_ARGS];
+        int fds[2] = {-1, 1};
+
+        if (split_args(stages[i], argv) == 0) {
+            puts("pipeline: empty command");
+            num_stages = i;
+            break;
+        }
+
+        if (i < num_stages - 1 && pipe(fds) < 0) {
+            puts("pipeline: pipe failed");
+            num_stages = i;
+            break;
+        }
+
+        pids[i] = fork();
+
+        if (pids[i] == 0) {
+            if (fds[0] >= 0) {
+                close(fds[0]);
+            }
+
+            run_stage(argv, in, fds[1]);
+        }
+
+        // The children hold their own copies of the ends they use, closing
+        // ours is what lets each reader see EOF
+        if (in != 0) {
+            close(in);
+        }
+
+        if (fds[1] != 1) {
+            close(fds[1]);
+        }
+
+        in = fds[0];
+    }
+
+    if (in > 0) {
+        close(in);
+    }
+
+    for (int i = 0; i < num_stages; i++) {
+        int status;
+        wait4(pids[i], &status, 0, NULL);
+    }
+}
+
 // ============================================================================
 // Command parser
 // ============================================================================
@@ -164,6 +285,11 @@ void process_command(char* cmd)
     if (*cmd == '\0')
         return;
 
+    if (strchr(cmd, '|')) {
+        cmd_pipeline(cmd);
+        return;
+    }
+
     // Parse command and argument
     char* arg = cmd;
     while (*arg && *arg != ' ' && *arg != '\n')
@@ -0,0 +1,89 @@
+/**
+ * Thread benchmark for hltOS
+ *
+ * Creates and joins threads with pthreads and reports the average cost of a
+ * pthread_create + pthread_join round trip. Each thread writes into a shared
+ * array, so the final check also verifies that the threads really share the
+ * address space of the main thread.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define ITERATIONS 200
+#define PARALLEL_THREADS 4
+
+static uint64_t tsc_per_ms;
+static volatile int results[PARALLEL_THREADS];
+
+// The kernel's nanosleep currently takes milliseconds directly rather than
+// a struct timespec, so call it raw instead of going through libc
+static void calibrate(void)
+{
+    uint64_t start = __rdtsc();
+    syscall(SYS_nanosleep, 100);
+    tsc_per_ms = (__rdtsc() - start) / 100;
+}
+
+static void* empty_thread(void* arg)
+{
+    return arg;
+}
+
+static void* worker_thread(void* arg)
+{
+    const int index = (int)(intptr_t)arg;
+
+    results[index] = (int)syscall(SYS_gettid);
+
+    return NULL;
+}
+
+int main(void)
+{
+    calibrate();
+
+    const uint64_t start = __rdtsc();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, empty_thread, NULL) != 0) {
+            printf("threadbench: pthread_create failed after %d iterations\n", i);
+            return 1;
+        }
+
+        pthread_join(thread, NULL);
+    }
+
+    const uint64_t elapsed = __rdtsc() - start;
+
+    printf("threadbench: %d create/join iterations in %lu ms, %lu us each\n",
+        ITERATIONS,
+        (unsigned long)(elapsed / tsc_per_ms),
+        (unsigned long)(elapsed * 1000 / ITERATIONS / tsc_per_ms));
+
+    pthread_t threads[PARALLEL_THREADS];
+
+    for (int i = 0; i < PARALLEL_THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker_thread, (void*)(intptr_t)i);
+    }
+
+    for (int i = 0; i < PARALLEL_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    printf("threadbench: pid %d, thread tids:", getpid());
+
+    for (int i = 0; i < PARALLEL_THREADS; i++) {
+        printf(" %d", results[i]);
+    }
+
+    printf("\n");
+
+    return 0;
+}
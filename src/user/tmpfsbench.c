@@ -0,0 +1,132 @@
+/**
+ * tmpfs file benchmark for hltOS
+ *
+ * Appends TOTAL_MB to a file in /tmp in 4 KiB writes and prints the time
+ * for each 10 MiB, which should stay flat as the file grows: a write only
+ * ever touches the pages it covers.
+ *
+ * Then checks that a MAP_SHARED mapping and read()/write() see the same
+ * bytes, and that ftruncate() makes a hole that reads back as zeros.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOTAL_MB 100
+#define STEP_MB 10
+#define WRITE_SIZE 4096
+
+#define PATH "/tmp/tmpfsbench"
+
+static char g_buffer[WRITE_SIZE];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_append(void)
+{
+    const int fd = open(PATH, O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0) {
+        puts("cannot create " PATH);
+        return -1;
+    }
+
+    memset(g_buffer, 'a', sizeof(g_buffer));
+
+    const int writes_per_step = STEP_MB * 1024 * 1024 / WRITE_SIZE;
+
+    for (int mb = 0; mb < TOTAL_MB; mb += STEP_MB) {
+        const uint64_t start = now_ns();
+
+        for (int i = 0; i < writes_per_step; i++) {
+            if (write(fd, g_buffer, sizeof(g_buffer)) != sizeof(g_buffer)) {
+                printf("write failed at %d MiB\n", mb);
+                close(fd);
+                return -1;
+            }
+        }
+
+        const uint64_t ns = now_ns() - start;
+
+        printf("append %3d-%3d MiB: %llu ms, %llu ns/write\n", mb, mb + STEP_MB, (unsigned long long)(ns / 1000000),
+            (unsigned long long)(ns / writes_per_step));
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+static int check_mmap(void)
+{
+    const size_t size = 1024 * 1024;
+    const int fd = open(PATH, O_RDWR);
+
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        puts("ftruncate failed");
+        return -1;
+    }
+
+    char* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED) {
+        puts("mmap MAP_SHARED failed");
+        close(fd);
+        return -1;
+    }
+
+    int wrong = map[0] != 'a';
+
+    // Through the mapping, then back with read()
+    memcpy(map + size - 5, "mmap!", 5);
+
+    char buf[5];
+    lseek(fd, size - 5, SEEK_SET);
+    read(fd, buf, sizeof(buf));
+    wrong |= memcmp(buf, "mmap!", 5) != 0;
+
+    // With write(), then back through the mapping
+    lseek(fd, 4096, SEEK_SET);
+    write(fd, "write", 5);
+    wrong |= memcmp(map + 4096, "write", 5) != 0;
+
+    munmap(map, size);
+
+    // Cut the file down and grow it back, the middle is a hole now
+    ftruncate(fd, 10);
+    ftruncate(fd, size);
+    lseek(fd, 4096, SEEK_SET);
+    read(fd, buf, sizeof(buf));
+    wrong |= buf[0] != 0 || buf[4] != 0;
+
+    close(fd);
+
+    puts(wrong ? "mmap/ftruncate: WRONG DATA" : "mmap/ftruncate: ok");
+
+    return wrong ? -1 : 0;
+}
+
+int main(void)
+{
+    unlink(PATH);
+
+    const int status = bench_append() < 0 || check_mmap() < 0;
+
+    unlink(PATH);
+
+    return status;
+}
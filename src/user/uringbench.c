@@ -0,0 +1,427 @@
+/**
+ * io_uring benchmark for hltOS
+ *
+ * Creates 10000 small files under /tmp, then reads every one of them back
+ * twice: once with an open/read/close syscall per step, and once through an
+ * io_uring, queueing a batch of opens, then a batch of reads, then a batch
+ * of closes, with one io_uring_enter() per batch.
+ *
+ * Reports the time and the number of kernel entries each way, and checks
+ * that both read back what was written.
+ *
+ * Given an ext2 directory, also checks that IORING_OP_FSYNC writes a dirty
+ * file back: right after the fsync completes, the file's contents must be
+ * on /dev/ram0, which is read around the page cache.
+ *
+ *     mkfs && mount /dev/ram0 /mnt && uringbench /mnt
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_DIRS 100
+#define FILES_PER_DIR 100
+#define NUM_FILES (NUM_DIRS * FILES_PER_DIR)
+#define FILE_SIZE 64
+
+#define RING_ENTRIES 256
+
+#define FSYNC_DEVICE "/dev/ram0"
+#define SYNC_SIZE 1024
+
+#define SYS_IO_URING_SETUP 425
+#define SYS_IO_URING_ENTER 426
+
+#define IORING_SETUP_NO_MMAP (1U << 14)
+#define IORING_ENTER_GETEVENTS (1U << 0)
+
+#define IORING_OP_FSYNC 3
+#define IORING_OP_OPENAT 18
+#define IORING_OP_CLOSE 19
+#define IORING_OP_READ 22
+
+// Same layouts as <linux/io_uring.h>, which musl does not ship
+struct sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t ioprio;
+    int32_t fd;
+    uint64_t off;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t op_flags;
+    uint64_t user_data;
+    uint64_t pad[3];
+};
+
+struct cqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+struct sqring_offsets {
+    uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+    uint64_t user_addr;
+};
+
+struct cqring_offsets {
+    uint32_t head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+    uint64_t user_addr;
+};
+
+struct uring_params {
+    uint32_t sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle, features, wq_fd, resv[3];
+    struct sqring_offsets sq_off;
+    struct cqring_offsets cq_off;
+};
+
+struct ring {
+    int fd;
+    uint8_t* mem;
+    struct sqe* sqes;
+    volatile uint32_t* sq_head;
+    volatile uint32_t* sq_tail;
+    uint32_t* sq_array;
+    uint32_t sq_mask;
+    volatile uint32_t* cq_head;
+    volatile uint32_t* cq_tail;
+    struct cqe* cqes;
+    uint32_t cq_mask;
+};
+
+static char g_paths[NUM_FILES][32];
+static char g_buffers[NUM_FILES][FILE_SIZE];
+static int g_fds[NUM_FILES];
+static unsigned long g_syscalls;
+static char g_sync[SYNC_SIZE];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    // Served by the vDSO, so not counted as a kernel entry
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void expected_contents(int i, char* out)
+{
+    memset(out, 0, FILE_SIZE);
+    snprintf(out, FILE_SIZE, "file %d\n", i);
+}
+
+static int create_files(void)
+{
+    char dir[32];
+    char contents[FILE_SIZE];
+
+    mkdir("/tmp/uringbench", 0755);
+
+    for (int d = 0; d < NUM_DIRS; d++) {
+        snprintf(dir, sizeof(dir), "/tmp/uringbench/%d", d);
+        mkdir(dir, 0755);
+
+        for (int f = 0; f < FILES_PER_DIR; f++) {
+            const int i = d * FILES_PER_DIR + f;
+
+            snprintf(g_paths[i], sizeof(g_paths[i]), "%s/%d", dir, f);
+            expected_contents(i, contents);
+
+            const int fd = open(g_paths[i], O_WRONLY | O_CREAT, 0644);
+
+            if (fd < 0 || write(fd, contents, FILE_SIZE) != FILE_SIZE) {
+                printf("failed to create %s\n", g_paths[i]);
+                return -1;
+            }
+
+            close(fd);
+        }
+    }
+
+    return 0;
+}
+
+static int check_buffers(const char* name)
+{
+    char contents[FILE_SIZE];
+    int bad = 0;
+
+    for (int i = 0; i < NUM_FILES; i++) {
+        expected_contents(i, contents);
+
+        if (memcmp(g_buffers[i], contents, FILE_SIZE) != 0) {
+            bad++;
+        }
+    }
+
+    if (bad) {
+        printf("%s: %d files read back wrong\n", name, bad);
+    }
+
+    memset(g_buffers, 0, sizeof(g_buffers));
+
+    return bad;
+}
+
+static void report(const char* name, uint64_t ns)
+{
+    printf("%-8s %d files in %llu ms, %llu ns/file, %lu kernel entries\n", name, NUM_FILES,
+        (unsigned long long)(ns / 1000000), (unsigned long long)(ns / NUM_FILES), g_syscalls);
+}
+
+static void bench_syscalls(void)
+{
+    g_syscalls = 0;
+
+    const uint64_t start = now_ns();
+
+    for (int i = 0; i < NUM_FILES; i++) {
+        const int fd = open(g_paths[i], O_RDONLY);
+
+        read(fd, g_buffers[i], FILE_SIZE);
+        close(fd);
+
+        g_syscalls += 3;
+    }
+
+    report("syscall", now_ns() - start);
+}
+
+static int ring_setup(struct ring* r)
+{
+    struct uring_params p;
+
+    memset(&p, 0, sizeof(p));
+
+    // Generously sized, the kernel reports the real layout back
+    const size_t rings_size = 4096 + RING_ENTRIES * 3 * sizeof(struct cqe);
+
+    r->mem = aligned_alloc(4096, rings_size);
+    r->sqes = aligned_alloc(4096, RING_ENTRIES * sizeof(struct sqe));
+
+    p.flags = IORING_SETUP_NO_MMAP;
+    p.sq_off.user_addr = (uintptr_t)r->sqes;
+    p.cq_off.user_addr = (uintptr_t)r->mem;
+
+    r->fd = syscall(SYS_IO_URING_SETUP, RING_ENTRIES, &p);
+
+    if (r->fd < 0) {
+        printf("io_uring_setup failed: %d\n", r->fd);
+        return -1;
+    }
+
+    r->sq_head = (uint32_t*)(r->mem + p.sq_off.head);
+    r->sq_tail = (uint32_t*)(r->mem + p.sq_off.tail);
+    r->sq_array = (uint32_t*)(r->mem + p.sq_off.array);
+    r->sq_mask = *(uint32_t*)(r->mem + p.sq_off.ring_mask);
+    r->cq_head = (uint32_t*)(r->mem + p.cq_off.head);
+    r->cq_tail = (uint32_t*)(r->mem + p.cq_off.tail);
+    r->cqes = (struct cqe*)(r->mem + p.cq_off.cqes);
+    r->cq_mask = *(uint32_t*)(r->mem + p.cq_off.ring_mask);
+
+    return 0;
+}
+
+// The n-th sqe past the tail, not visible to the kernel until ring_submit()
+static struct sqe* ring_get_sqe(struct ring* r, uint32_t n)
+{
+    const uint32_t index = (*r->sq_tail + n) & r->sq_mask;
+
+    r->sq_array[index] = index;
+    memset(&r->sqes[index], 0, sizeof(struct sqe));
+
+    return &r->sqes[index];
+}
+
+// Publishes count queued sqes, enters once and hands every completion to
+// the caller through results[user_data]
+static int ring_submit(struct ring* r, uint32_t count, int* results)
+{
+    __atomic_store_n(r->sq_tail, *r->sq_tail + count, __ATOMIC_RELEASE);
+
+    const int submitted = syscall(SYS_IO_URING_ENTER, r->fd, count, count, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    g_syscalls++;
+
+    if (submitted != (int)count) {
+        printf("io_uring_enter submitted %d of %u\n", submitted, count);
+        return -1;
+    }
+
+    uint32_t head = *r->cq_head;
+    const uint32_t tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        const struct cqe* c = &r->cqes[head & r->cq_mask];
+
+        results[c->user_data] = c->res;
+    }
+
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static int bench_uring(struct ring* r)
+{
+    static int results[NUM_FILES];
+
+    g_syscalls = 0;
+
+    const uint64_t start = now_ns();
+
+    for (int base = 0; base < NUM_FILES; base += RING_ENTRIES) {
+        const uint32_t count = NUM_FILES - base < RING_ENTRIES ? NUM_FILES - base : RING_ENTRIES;
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct sqe* s = ring_get_sqe(r, i);
+
+            s->opcode = IORING_OP_OPENAT;
+            s->fd = AT_FDCWD;
+            s->addr = (uintptr_t)g_paths[base + i];
+            s->op_flags = O_RDONLY;
+            s->user_data = base + i;
+        }
+
+        if (ring_submit(r, count, g_fds) < 0) {
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct sqe* s = ring_get_sqe(r, i);
+
+            s->opcode = IORING_OP_READ;
+            s->fd = g_fds[base + i];
+            s->off = 0;
+            s->addr = (uintptr_t)g_buffers[base + i];
+            s->len = FILE_SIZE;
+            s->user_data = base + i;
+        }
+
+        if (ring_submit(r, count, results) < 0) {
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct sqe* s = ring_get_sqe(r, i);
+
+            s->opcode = IORING_OP_CLOSE;
+            s->fd = g_fds[base + i];
+            s->user_data = base + i;
+        }
+
+        if (ring_submit(r, count, results) < 0) {
+            return -1;
+        }
+    }
+
+    report("io_uring", now_ns() - start);
+
+    return 0;
+}
+
+// Whether g_sync is anywhere on the device, ext2 blocks are 1 KiB aligned
+static int on_device(void)
+{
+    static char chunk[64 * 1024];
+    const int fd = open(FSYNC_DEVICE, O_RDONLY);
+    int found = 0;
+
+    while (fd >= 0 && !found && read(fd, chunk, sizeof(chunk)) == (ssize_t)sizeof(chunk)) {
+        for (size_t off = 0; off < sizeof(chunk) && !found; off += SYNC_SIZE) {
+            found = memcmp(chunk + off, g_sync, SYNC_SIZE) == 0;
+        }
+    }
+
+    close(fd);
+
+    return found;
+}
+
+static int check_fsync(struct ring* r, const char* dir)
+{
+    char path[256];
+    int results[2] = {0, 0};
+    int bad = 0;
+
+    snprintf(path, sizeof(path), "%s/uringbench.sync", dir);
+
+    // Different on every run, so an earlier run's blocks never match
+    for (size_t off = 0; off + 32 <= SYNC_SIZE; off += 32) {
+        snprintf(g_sync + off, 32, "uringbench %llu", (unsigned long long)now_ns());
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0 || write(fd, g_sync, SYNC_SIZE) != SYNC_SIZE) {
+        printf("fsync: cannot write %s\n", path);
+        close(fd);
+        return 1;
+    }
+
+    struct sqe* s = ring_get_sqe(r, 0);
+
+    s->opcode = IORING_OP_FSYNC;
+    s->fd = fd;
+    s->user_data = 0;
+
+    s = ring_get_sqe(r, 1);
+    s->opcode = IORING_OP_FSYNC;
+    s->fd = -1;
+    s->user_data = 1;
+
+    if (ring_submit(r, 2, results) < 0) {
+        bad = 1;
+    } else if (results[0] != 0 || results[1] != -EBADF) {
+        printf("fsync: returned %d, and %d for a bad fd\n", results[0], results[1]);
+        bad = 1;
+    } else if (!on_device()) {
+        printf("fsync: %s is not on %s\n", path, FSYNC_DEVICE);
+        bad = 1;
+    } else {
+        puts("fsync: written back");
+    }
+
+    close(fd);
+    unlink(path);
+
+    return bad;
+}
+
+int main(int argc, char** argv)
+{
+    struct ring ring;
+
+    if (create_files() < 0 || ring_setup(&ring) < 0) {
+        return 1;
+    }
+
+    bench_syscalls();
+    int bad = check_buffers("syscall");
+
+    if (bench_uring(&ring) < 0) {
+        return 1;
+    }
+
+    bad += check_buffers("io_uring");
+
+    if (argc > 1) {
+        bad += check_fsync(&ring, argv[1]);
+    }
+
+    close(ring.fd);
+
+    return bad ? 1 : 0;
+}